@@ -0,0 +1,83 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_ALLOCATION_COUNTER_H_
+#define MOZC_BASE_ALLOCATION_COUNTER_H_
+
+#include "base/port.h"
+
+namespace mozc {
+
+// Counts global heap allocations, for tests that guard hot paths against
+// allocation regressions.  Linking the allocation_counter target replaces
+// the global operator new/delete with counting versions, so TESTONLY:
+// production targets must not depend on it.  The counters cover all
+// threads of the process; scoped measurements are only meaningful while
+// no other thread allocates.
+class AllocationCounter {
+ public:
+  // Number of allocations since process startup.
+  static uint64 GetAllocationCount();
+
+  // Total requested bytes since process startup.
+  static uint64 GetAllocatedBytes();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(AllocationCounter);
+};
+
+// Measures allocations performed while the object is alive:
+//
+//   ScopedAllocationCounter counter;
+//   session->SendKey(...);
+//   EXPECT_EQ(0, counter.allocation_count());
+class ScopedAllocationCounter {
+ public:
+  ScopedAllocationCounter()
+      : start_count_(AllocationCounter::GetAllocationCount()),
+        start_bytes_(AllocationCounter::GetAllocatedBytes()) {}
+
+  uint64 allocation_count() const {
+    return AllocationCounter::GetAllocationCount() - start_count_;
+  }
+
+  uint64 allocated_bytes() const {
+    return AllocationCounter::GetAllocatedBytes() - start_bytes_;
+  }
+
+ private:
+  const uint64 start_count_;
+  const uint64 start_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedAllocationCounter);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_ALLOCATION_COUNTER_H_
@@ -0,0 +1,75 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/allocation_counter.h"
+
+#include <memory>
+#include <vector>
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(AllocationCounterTest, CountsNewExpressions) {
+  ScopedAllocationCounter counter;
+  std::unique_ptr<int> value(new int(42));
+  EXPECT_EQ(1, counter.allocation_count());
+  EXPECT_LE(sizeof(int), counter.allocated_bytes());
+
+  std::unique_ptr<char[]> buffer(new char[128]);
+  EXPECT_EQ(2, counter.allocation_count());
+  EXPECT_LE(sizeof(int) + 128, counter.allocated_bytes());
+}
+
+TEST(AllocationCounterTest, ZeroWithoutAllocation) {
+  int values[16];
+  ScopedAllocationCounter counter;
+  for (size_t i = 0; i < arraysize(values); ++i) {
+    values[i] = static_cast<int>(i);
+  }
+  EXPECT_EQ(15, values[15]);
+  EXPECT_EQ(0, counter.allocation_count());
+  EXPECT_EQ(0, counter.allocated_bytes());
+}
+
+TEST(AllocationCounterTest, CountsContainerGrowth) {
+  std::vector<int> values;
+  values.reserve(1);
+  ScopedAllocationCounter counter;
+  values.push_back(0);  // Within the reserved capacity.
+  EXPECT_EQ(0, counter.allocation_count());
+  for (int i = 0; i < 100; ++i) {
+    values.push_back(i);
+  }
+  EXPECT_LT(0, counter.allocation_count());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -39,12 +39,16 @@
       'type': 'static_library',
       'toolsets': ['host', 'target'],
       'sources': [
+        'cpu_affinity.cc',
         'cpu_stats.cc',
         'process.cc',
         'process_mutex.cc',
         'run_level.cc',
         'scheduler.cc',
+        'startup_stats.cc',
         'stopwatch.cc',
+        'thread_pool.cc',
+        'trace.cc',
         'unnamed_event.cc',
       ],
       'dependencies': [
@@ -108,6 +112,7 @@
         'logging.cc',
         'mmap.cc',
         'number_util.cc',
+        'shared_memory.cc',
         'system_util.cc',
         'text_normalizer.cc',
         'thread.cc',
@@ -141,6 +146,13 @@
             },
           },
         }],
+        ['OS=="linux" and target_platform=="Linux"', {
+          'link_settings': {
+            'libraries': [
+              '-lrt',  # shm_open in 'shared_memory.cc'
+            ],
+          },
+        }],
         ['target_platform=="Linux" and server_dir!=""', {
           'defines': [
             'MOZC_SERVER_DIRECTORY="<(server_dir)"',
@@ -217,6 +229,16 @@
         'singleton',
       ],
     },
+    {
+      'target_name': 'allocation_counter',
+      # TESTONLY: linking this target replaces the global operator
+      # new/delete with counting versions.
+      'type': 'static_library',
+      'toolsets': ['host', 'target'],
+      'sources': [
+        'allocation_counter.cc',
+      ],
+    },
     {
       'target_name': 'clock',
       'type': 'static_library',
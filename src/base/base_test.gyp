@@ -80,9 +80,13 @@
       'type': 'executable',
       'sources': [
         'codegen_bytearray_stream_test.cc',
+        'cpu_affinity_test.cc',
         'cpu_stats_test.cc',
         'process_mutex_test.cc',
+        'startup_stats_test.cc',
         'stopwatch_test.cc',
+        'thread_pool_test.cc',
+        'trace_test.cc',
         'unnamed_event_test.cc',
       ],
       'conditions': [
@@ -135,9 +139,11 @@
       'sources': [
         'bitarray_test.cc',
         'flags_test.cc',
+        'freelist_test.cc',
         'iterator_adapter_test.cc',
         'logging_test.cc',
         'mmap_test.cc',
+        'shared_memory_test.cc',
         'singleton_test.cc',
         'stl_util_test.cc',
         'string_piece_test.cc',
@@ -250,6 +256,20 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'allocation_counter_test',
+      'type': 'executable',
+      'sources': [
+        'allocation_counter_test.cc',
+      ],
+      'dependencies': [
+        '../testing/testing.gyp:gtest_main',
+        'base.gyp:allocation_counter',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'clock_test',
       'type': 'executable',
@@ -471,6 +491,7 @@
       'target_name': 'base_all_test',
       'type': 'none',
       'dependencies': [
+        'allocation_counter_test',
         'base_core_test',
         'base_test',
         'clock_mock_test',
@@ -63,6 +63,32 @@ class BitArray {
     array_[(index >> 5)] &= ~(0x00000001 << (index & 0x0000001F));
   }
 
+  // Stores the 32-bit |word| as bits [32 * word_index, 32 * word_index + 32).
+  // Bit i of |word| becomes the (32 * word_index + i) -th bit of the array,
+  // so building a large array word by word is equivalent to (but much
+  // faster than) 32 set()/clear() calls.
+  void SetWord(uint32 word_index, uint32 word) {
+    array_[word_index] = word;
+  }
+
+  // Returns bits [32 * word_index, 32 * word_index + 32) as a 32-bit word.
+  uint32 GetWord(uint32 word_index) const {
+    return array_[word_index];
+  }
+
+  // Returns the index of the first true bit at or after |from|, or size()
+  // if there is no such bit.
+  size_t FindNextSet(uint32 from) const {
+    return FindNextSet(reinterpret_cast<const char *>(array_.get()),
+                       size_, from);
+  }
+
+  // Returns the number of true bits in the range [begin, end).
+  size_t PopCount(uint32 begin, uint32 end) const {
+    return PopCount(reinterpret_cast<const char *>(array_.get()),
+                    begin, end);
+  }
+
   // Returns the body of bit vector.
   const char *array() const {
     return reinterpret_cast<const char *>(array_.get());
@@ -78,14 +104,86 @@ class BitArray {
     return size_;
   }
 
-  // Immutable accessor.
+  // Immutable accessors.  These also work on a saved image (e.g. the
+  // mmapped data returned by array()) without copying it back into a
+  // BitArray instance.
   static bool GetValue(const char *array, uint32 index) {
     const uint32 *uarray = reinterpret_cast<const uint32 *>(array);
     return static_cast<bool>(
         (uarray[(index >> 5)] >> (index & 0x0000001F)) & 0x00000001);
   }
 
+  // Immutable version of FindNextSet() for an array of |size| bits.
+  static size_t FindNextSet(const char *array, size_t size, uint32 from) {
+    const uint32 *uarray = reinterpret_cast<const uint32 *>(array);
+    if (from >= size) {
+      return size;
+    }
+    uint32 word_index = from >> 5;
+    uint32 word = uarray[word_index] & (0xFFFFFFFF << (from & 0x0000001F));
+    while (true) {
+      if (word != 0) {
+        const size_t index = (static_cast<size_t>(word_index) << 5) +
+                             BitScanForward(word);
+        return index < size ? index : size;
+      }
+      ++word_index;
+      if ((static_cast<size_t>(word_index) << 5) >= size) {
+        return size;
+      }
+      word = uarray[word_index];
+    }
+  }
+
+  // Immutable version of PopCount().
+  static size_t PopCount(const char *array, uint32 begin, uint32 end) {
+    const uint32 *uarray = reinterpret_cast<const uint32 *>(array);
+    if (begin >= end) {
+      return 0;
+    }
+    const uint32 begin_word = begin >> 5;
+    const uint32 end_word = (end - 1) >> 5;
+    const uint32 begin_mask = 0xFFFFFFFF << (begin & 0x0000001F);
+    const uint32 end_mask = 0xFFFFFFFF >> (31 - ((end - 1) & 0x0000001F));
+    if (begin_word == end_word) {
+      return BitCount(uarray[begin_word] & begin_mask & end_mask);
+    }
+    size_t count = BitCount(uarray[begin_word] & begin_mask);
+    for (uint32 i = begin_word + 1; i < end_word; ++i) {
+      count += BitCount(uarray[i]);
+    }
+    count += BitCount(uarray[end_word] & end_mask);
+    return count;
+  }
+
  private:
+  static int BitCount(uint32 x) {
+#ifdef __GNUC__
+    return __builtin_popcount(x);
+#else
+    x = ((x & 0xaaaaaaaa) >> 1) + (x & 0x55555555);
+    x = ((x & 0xcccccccc) >> 2) + (x & 0x33333333);
+    x = ((x >> 4) + x) & 0x0f0f0f0f;
+    x = (x >> 8) + x;
+    x = ((x >> 16) + x) & 0x3f;
+    return x;
+#endif
+  }
+
+  // Returns the 0-origin position of the lowest 1-bit of |x|.
+  // REQUIRES: x != 0.
+  static int BitScanForward(uint32 x) {
+#ifdef __GNUC__
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+    for (; (x & 1) == 0; x >>= 1) {
+      ++n;
+    }
+    return n;
+#endif
+  }
+
   std::unique_ptr<uint32[]> array_;
   const size_t size_;
 
@@ -96,5 +96,70 @@ TEST(BitArray, BitArrayTest) {
   }
 }
 
+TEST(BitArray, SetWordTest) {
+  BitArray word_array(64);
+  word_array.SetWord(0, 0x80000001);
+  word_array.SetWord(1, 0x00010000);
+
+  BitArray bit_array(64);
+  bit_array.set(0);
+  bit_array.set(31);
+  bit_array.set(48);
+
+  for (size_t i = 0; i < 64; ++i) {
+    EXPECT_EQ(bit_array.get(i), word_array.get(i)) << i;
+  }
+  EXPECT_EQ(0x80000001, word_array.GetWord(0));
+  EXPECT_EQ(0x00010000, word_array.GetWord(1));
+}
+
+TEST(BitArray, FindNextSetTest) {
+  BitArray array(100);
+  array.set(3);
+  array.set(31);
+  array.set(32);
+  array.set(70);
+
+  EXPECT_EQ(3, array.FindNextSet(0));
+  EXPECT_EQ(3, array.FindNextSet(3));
+  EXPECT_EQ(31, array.FindNextSet(4));
+  EXPECT_EQ(32, array.FindNextSet(32));
+  EXPECT_EQ(70, array.FindNextSet(33));
+  EXPECT_EQ(100, array.FindNextSet(71));  // no more set bits
+
+  // The immutable accessor sees the same bits.
+  EXPECT_EQ(31, BitArray::FindNextSet(array.array(), array.size(), 4));
+
+  BitArray empty(100);
+  EXPECT_EQ(100, empty.FindNextSet(0));
+}
+
+TEST(BitArray, PopCountTest) {
+  const size_t kSize = 1000;
+  BitArray array(kSize);
+  std::vector<int> target(kSize);
+  for (size_t i = 0; i < kSize; ++i) {
+    if (Util::Random(2) == 0) {
+      target[i] = 1;
+      array.set(i);
+    }
+  }
+
+  const size_t kRanges[][2] = {
+    {0, 0}, {0, 1}, {0, 32}, {5, 17}, {5, 64}, {31, 33},
+    {100, 1000}, {0, 1000}, {999, 1000},
+  };
+  for (size_t i = 0; i < arraysize(kRanges); ++i) {
+    const size_t begin = kRanges[i][0];
+    const size_t end = kRanges[i][1];
+    size_t expected = 0;
+    for (size_t j = begin; j < end; ++j) {
+      expected += target[j];
+    }
+    EXPECT_EQ(expected, array.PopCount(begin, end)) << begin << " " << end;
+    EXPECT_EQ(expected, BitArray::PopCount(array.array(), begin, end));
+  }
+}
+
 }  // namespace
 }  // namespace mozc
@@ -41,11 +41,122 @@
 #include <sys/time.h>
 #endif  // OS_WIN
 
+#include <atomic>
+
+#include "base/mutex.h"
 #include "base/singleton.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || \
+    defined(__x86_64__) || defined(__i386__)
+#define MOZC_CLOCK_HAVE_RDTSC
+#ifdef OS_WIN
+#include <intrin.h>
+#endif  // OS_WIN
+#endif  // x86
+
 namespace mozc {
 namespace {
 
+#ifdef MOZC_CLOCK_HAVE_RDTSC
+
+inline uint64 ReadTsc() {
+#ifdef OS_WIN
+  return __rdtsc();
+#else  // OS_WIN
+  uint32 lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return (static_cast<uint64>(hi) << 32) | lo;
+#endif  // OS_WIN
+}
+
+// Converts the TSC into the unit of ClockInterface::GetTicks() using a rate
+// calibrated against the slow clock.  Calibration needs two slow-clock
+// samples taken at least 10 msec apart, so the first GetCheapTicks() calls
+// after startup are served by the slow clock.
+class TscCalibration {
+ public:
+  TscCalibration()
+      : calibrated_(false),
+        failed_(false),
+        has_first_sample_(false),
+        base_ticks_(0),
+        base_tsc_(0),
+        first_sample_ticks_(0),
+        first_sample_tsc_(0),
+        ticks_per_tsc_(0.0) {}
+
+  // Returns true and sets |*ticks| if calibration is complete and the
+  // current TSC reading is usable.
+  bool GetTicks(uint64 *ticks) {
+    if (!calibrated_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    const uint64 tsc = ReadTsc();
+    if (tsc < base_tsc_) {
+      // The TSC went backwards, e.g. after a migration across sockets with
+      // unsynchronized counters.  Let the caller use the slow clock.
+      return false;
+    }
+    *ticks = base_ticks_ +
+             static_cast<uint64>((tsc - base_tsc_) * ticks_per_tsc_);
+    return true;
+  }
+
+  // Feeds a slow-clock sample.  |ticks| and |frequency| come from
+  // GetTicks() and GetFrequency() of the owning clock.
+  void AddSample(uint64 ticks, uint64 frequency) {
+    const uint64 tsc = ReadTsc();
+    scoped_lock l(&mutex_);
+    if (failed_ || calibrated_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    if (!has_first_sample_) {
+      first_sample_ticks_ = ticks;
+      first_sample_tsc_ = tsc;
+      has_first_sample_ = true;
+      return;
+    }
+    // 10 msec gives sub-percent accuracy and still finishes during startup.
+    const uint64 kMinIntervalTicks = frequency / 100;
+    if (ticks < first_sample_ticks_ + kMinIntervalTicks) {
+      return;
+    }
+    if (tsc <= first_sample_tsc_) {
+      failed_ = true;
+      return;
+    }
+    const double ticks_per_tsc =
+        static_cast<double>(ticks - first_sample_ticks_) /
+        static_cast<double>(tsc - first_sample_tsc_);
+    // An implausible rate means the TSC is not a reliable time source here,
+    // e.g. on some virtual machines.  Keep using the slow clock.
+    const double tsc_hz = frequency / ticks_per_tsc;
+    if (tsc_hz < 1.0e6 || tsc_hz > 1.0e11) {
+      failed_ = true;
+      return;
+    }
+    ticks_per_tsc_ = ticks_per_tsc;
+    base_ticks_ = ticks;
+    base_tsc_ = tsc;
+    calibrated_.store(true, std::memory_order_release);
+  }
+
+ private:
+  Mutex mutex_;
+  std::atomic<bool> calibrated_;
+  bool failed_;
+  bool has_first_sample_;
+  uint64 base_ticks_;
+  uint64 base_tsc_;
+  uint64 first_sample_ticks_;
+  uint64 first_sample_tsc_;
+  double ticks_per_tsc_;
+
+  DISALLOW_COPY_AND_ASSIGN(TscCalibration);
+};
+
+#endif  // MOZC_CLOCK_HAVE_RDTSC
+
 class ClockImpl : public ClockInterface {
  public:
 #ifndef OS_NACL
@@ -151,14 +262,33 @@ class ClockImpl : public ClockInterface {
 #endif  // platforms (OS_WIN, OS_MACOSX, OS_LINUX, ...)
   }
 
+  virtual uint64 GetCheapTicks() {
+#ifdef MOZC_CLOCK_HAVE_RDTSC
+    uint64 ticks;
+    if (tsc_calibration_.GetTicks(&ticks)) {
+      return ticks;
+    }
+    ticks = GetTicks();
+    tsc_calibration_.AddSample(ticks, GetFrequency());
+    return ticks;
+#else  // MOZC_CLOCK_HAVE_RDTSC
+    return GetTicks();
+#endif  // MOZC_CLOCK_HAVE_RDTSC
+  }
+
 #ifdef OS_NACL
   virtual void SetTimezoneOffset(int32 timezone_offset_sec) {
     timezone_offset_sec_ = timezone_offset_sec;
   }
+#endif  // OS_NACL
 
  private:
+#ifdef OS_NACL
   int32 timezone_offset_sec_;
 #endif  // OS_NACL
+#ifdef MOZC_CLOCK_HAVE_RDTSC
+  TscCalibration tsc_calibration_;
+#endif  // MOZC_CLOCK_HAVE_RDTSC
 };
 
 ClockInterface *g_clock = nullptr;
@@ -189,6 +319,10 @@ uint64 Clock::GetTicks() {
   return GetClock()->GetTicks();
 }
 
+uint64 Clock::GetCheapTicks() {
+  return GetClock()->GetCheapTicks();
+}
+
 #ifdef OS_NACL
 void Clock::SetTimezoneOffset(int32 timezone_offset_sec) {
   return GetClock()->SetTimezoneOffset(timezone_offset_sec);
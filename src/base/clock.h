@@ -48,6 +48,11 @@ class ClockInterface {
   virtual uint64 GetFrequency() = 0;
   virtual uint64 GetTicks() = 0;
 
+  // Cheap clock; see Clock::GetCheapTicks() below.  The default
+  // implementation falls back to GetTicks() so that mock clocks used in
+  // unit tests stay consistent without overriding this method.
+  virtual uint64 GetCheapTicks() { return GetTicks(); }
+
 #ifdef OS_NACL
   virtual void SetTimezoneOffset(int32 timezone_offset_sec) = 0;
 #endif  // OS_NACL
@@ -85,6 +90,14 @@ class Clock {
   // GetFrequency().
   static uint64 GetTicks();
 
+  // Gets the current ticks in the same unit as GetTicks(), but from a time
+  // source that is cheap to read.  On x86 this reads the TSC and converts it
+  // with a rate calibrated against GetTicks() at startup; on other
+  // architectures it falls back to GetTicks().  The result may drift from
+  // GetTicks() by the calibration error (roughly 0.1%), so use it for
+  // elapsed-time measurements rather than for wall clock timestamps.
+  static uint64 GetCheapTicks();
+
 #ifdef OS_NACL
   // Sets the time difference between local time and UTC time in seconds.
   // We use this function in NaCl Mozc because we can't know the local timezone
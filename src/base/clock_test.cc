@@ -30,6 +30,7 @@
 #include "base/clock.h"
 
 #include "base/clock_mock.h"
+#include "base/util.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -121,5 +122,32 @@ TEST(ClockTest, TimeTestWithoutMock) {
       << "when system is busy and slow.";
 }
 
+TEST(ClockTest, CheapTicksTestWithMock) {
+  ClockMock clock_mock(kTestSeconds, kTestMicroSeconds);
+  Clock::SetClockForUnitTest(&clock_mock);
+
+  // ClockMock does not override GetCheapTicks(), so it falls back to the
+  // mocked GetTicks().
+  const uint64 kTicks = 54321;
+  clock_mock.SetTicks(kTicks);
+  EXPECT_EQ(kTicks, Clock::GetCheapTicks());
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
+TEST(ClockTest, CheapTicksTestWithoutMock) {
+  // GetCheapTicks() may drift from GetTicks() by the calibration error, but
+  // the two must stay close on the time scale of this test.
+  const uint64 kToleranceTicks = Clock::GetFrequency() / 10;  // 100 msec
+  for (int i = 0; i < 10; ++i) {
+    const uint64 ticks = Clock::GetTicks();
+    const uint64 cheap_ticks = Clock::GetCheapTicks();
+    const uint64 diff = (cheap_ticks > ticks) ? cheap_ticks - ticks
+                                              : ticks - cheap_ticks;
+    EXPECT_LE(diff, kToleranceTicks);
+    Util::Sleep(5);
+  }
+}
+
 }  // namespace
 }  // namespace mozc
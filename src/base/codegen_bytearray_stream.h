@@ -73,9 +73,14 @@
 // string literals for other toolchains.
 //
 // The generated code with a string literal looks like:
-//   const char kVAR_data[] =
+//   alignas(8) const char kVAR_data[] =
 //       "\\x12\\x34\\x56\\x78...";
 //   const size_t kVAR_size = 123;
+//
+// The array is 8-byte aligned in both modes (the word array by its element
+// type) so that consumers can reinterpret the embedded data in place
+// instead of copying it into an aligned buffer; see base/embedded_file.h
+// for the same contract.
 #define MOZC_CODEGEN_BYTEARRAY_STREAM_USES_WORD_ARRAY
 #endif  // OS_WIN
 
@@ -142,7 +147,8 @@ class BasicCodeGenByteArrayStreamBuf : public std::streambuf {
     output_stream_->unsetf(std::ios_base::showbase);
     word_buffer_ = 0;
 #else
-    *output_stream_ << "const char k" << var_name_base_ << "_data[] =\n";
+    *output_stream_ << "alignas(8) const char k" << var_name_base_
+                    << "_data[] =\n";
 #endif
     output_count_ = 0;
     return is_open_ = !output_stream_->fail();
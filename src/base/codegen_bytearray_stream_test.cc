@@ -73,7 +73,7 @@ class CodeGenByteArrayStreamTest : public testing::Test {
         "const size_t k" + var_name_base + "_size = " + count + ";\n";
 #else
     return
-        "const char k" + var_name_base + "_data[] =\n"
+        "alignas(8) const char k" + var_name_base + "_data[] =\n"
         + body + "\n"
         ";\n"
         "const size_t k" + var_name_base + "_size = " + count + ";\n";
@@ -39,6 +39,7 @@
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/port.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
@@ -89,6 +90,116 @@ class OnMemoryFileMap {
   std::map<string, string> map_;
 };
 
+// Stream buffer reading directly from a constant memory block.  Used
+// to serve the embedded system:// resources without copying them on
+// every open.
+class ReadOnlyMemoryStreamBuf : public std::streambuf {
+ public:
+  ReadOnlyMemoryStreamBuf(const char *data, size_t size) {
+    char *begin = const_cast<char *>(data);
+    setg(begin, begin, begin + size);
+  }
+
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override {
+    if (!(which & std::ios_base::in)) {
+      return pos_type(off_type(-1));
+    }
+    char *target = NULL;
+    if (dir == std::ios_base::beg) {
+      target = eback() + off;
+    } else if (dir == std::ios_base::cur) {
+      target = gptr() + off;
+    } else {
+      target = egptr() + off;
+    }
+    if (target < eback() || target > egptr()) {
+      return pos_type(off_type(-1));
+    }
+    setg(eback(), target, egptr());
+    return pos_type(target - eback());
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+class ReadOnlyMemoryStream : public std::istream {
+ public:
+  ReadOnlyMemoryStream(const char *data, size_t size)
+      : std::istream(NULL), buf_(data, size) {
+    rdbuf(&buf_);
+  }
+
+ private:
+  ReadOnlyMemoryStreamBuf buf_;
+};
+
+// Cache of the contents of the disk-backed config files.  The same few
+// keymap and romaji table files are re-read whenever a session or a
+// tool requests them, so the contents are kept here keyed by file name
+// and open mode and validated against the file modification time.
+// AtomicUpdate() additionally invalidates the updated file explicitly,
+// which covers in-process rewrites faster than the mtime granularity.
+class FileContentCache {
+ public:
+  // Returns a stream over the (possibly cached) contents of |filename|,
+  // or NULL if the file cannot be opened.
+  std::istream *Open(const string &filename, std::ios_base::openmode mode) {
+    FileTimeStamp mtime = 0;
+    if (!FileUtil::GetModificationTime(filename, &mtime)) {
+      return NULL;
+    }
+    const string key = BuildKey(filename, mode);
+    scoped_lock l(&mutex_);
+    Entry &entry = map_[key];
+    if (!entry.valid || entry.mtime != mtime) {
+      InputFileStream ifs(filename.c_str(), mode);
+      if (!ifs.good()) {
+        map_.erase(key);
+        return NULL;
+      }
+      std::ostringstream contents;
+      contents << ifs.rdbuf();
+      entry.contents = contents.str();
+      entry.mtime = mtime;
+      entry.valid = true;
+    }
+    return new std::istringstream(entry.contents, mode);
+  }
+
+  void Invalidate(const string &filename) {
+    scoped_lock l(&mutex_);
+    map_.erase(BuildKey(filename, std::ios_base::in));
+    map_.erase(BuildKey(filename, std::ios_base::in | std::ios_base::binary));
+  }
+
+  void clear() {
+    scoped_lock l(&mutex_);
+    map_.clear();
+  }
+
+ private:
+  // The open mode is part of the key because text and binary mode can
+  // produce different contents on Windows.
+  static string BuildKey(const string &filename,
+                         std::ios_base::openmode mode) {
+    return ((mode & std::ios_base::binary) ? "b:" : "t:") + filename;
+  }
+
+  struct Entry {
+    Entry() : valid(false), mtime(0) {}
+    bool valid;
+    FileTimeStamp mtime;
+    string contents;
+  };
+
+  Mutex mutex_;
+  std::map<string, Entry> map_;
+};
+
 #include "base/config_file_stream_data.inc"
 }  // namespace
 
@@ -99,14 +210,9 @@ std::istream *ConfigFileStream::Open(const string &filename,
     const string new_filename = RemovePrefix(kSystemPrefix, filename);
     for (size_t i = 0; i < arraysize(kFileData); ++i) {
       if (new_filename == kFileData[i].name) {
-        std::istringstream *ifs = new std::istringstream(
-            string(kFileData[i].data, kFileData[i].size), mode);
-        CHECK(ifs);
-        if (ifs->good()) {
-          return ifs;
-        }
-        delete ifs;
-        return NULL;
+        // The embedded data is immutable, so it is served in place
+        // without copying it into the stream.
+        return new ReadOnlyMemoryStream(kFileData[i].data, kFileData[i].size);
       }
     }
   // user://foo.bar.txt
@@ -114,23 +220,11 @@ std::istream *ConfigFileStream::Open(const string &filename,
     const string new_filename =
         FileUtil::JoinPath(SystemUtil::GetUserProfileDirectory(),
                            RemovePrefix(kUserPrefix, filename));
-    InputFileStream *ifs = new InputFileStream(new_filename.c_str(), mode);
-    CHECK(ifs);
-    if (ifs->good()) {
-      return ifs;
-    }
-    delete ifs;
-    return NULL;
+    return Singleton<FileContentCache>::get()->Open(new_filename, mode);
   // file:///foo.map
   } else if (Util::StartsWith(filename, kFilePrefix)) {
     const string new_filename = RemovePrefix(kFilePrefix, filename);
-    InputFileStream *ifs = new InputFileStream(new_filename.c_str(), mode);
-    CHECK(ifs);
-    if (ifs->good()) {
-      return ifs;
-    }
-    delete ifs;
-    return NULL;
+    return Singleton<FileContentCache>::get()->Open(new_filename, mode);
   } else if (Util::StartsWith(filename, kMemoryPrefix)) {
     std::istringstream *ifs = new std::istringstream(
         Singleton<OnMemoryFileMap>::get()->get(filename), mode);
@@ -187,6 +281,10 @@ bool ConfigFileStream::AtomicUpdate(const string &filename,
     return false;
   }
 
+  // Drop the cached contents; a rewrite within the modification time
+  // granularity would otherwise go unnoticed.
+  Singleton<FileContentCache>::get()->Invalidate(real_filename);
+
 #ifdef OS_WIN
   // If file name doesn't end with ".db", the file
   // is more likely a temporary file.
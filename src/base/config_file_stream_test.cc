@@ -133,6 +133,34 @@ TEST_F(ConfigFileStreamTest, AtomicUpdate) {
   }
 }
 
+TEST_F(ConfigFileStreamTest, CachedContentsInvalidation) {
+  const string kPath = "user://cache_invalidation_test";
+  const string filename = ConfigFileStream::GetFileName(kPath);
+
+  ASSERT_TRUE(ConfigFileStream::AtomicUpdate(kPath, "first"));
+  for (int i = 0; i < 2; ++i) {
+    // The second iteration is served from the content cache.
+    std::unique_ptr<std::istream> ifs(ConfigFileStream::OpenReadBinary(kPath));
+    ASSERT_NE(nullptr, ifs.get());
+    string line;
+    getline(*ifs, line);
+    EXPECT_EQ("first", line);
+  }
+
+  // AtomicUpdate() invalidates the cached contents even when the
+  // rewrite happens within the modification time granularity.
+  ASSERT_TRUE(ConfigFileStream::AtomicUpdate(kPath, "second"));
+  {
+    std::unique_ptr<std::istream> ifs(ConfigFileStream::OpenReadBinary(kPath));
+    ASSERT_NE(nullptr, ifs.get());
+    string line;
+    getline(*ifs, line);
+    EXPECT_EQ("second", line);
+  }
+
+  EXPECT_TRUE(FileUtil::Unlink(filename));
+}
+
 TEST_F(ConfigFileStreamTest, OpenReadBinary) {
   // At first, generate a binary data file in (temporary) user directory
   // so that we can load it as "user://my_binary_file.dat"
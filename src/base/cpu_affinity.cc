@@ -0,0 +1,117 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/cpu_affinity.h"
+
+#ifdef OS_WIN
+#include <windows.h>
+#elif defined(OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif  // OS_WIN, OS_LINUX
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/number_util.h"
+#include "base/util.h"
+
+namespace mozc {
+
+bool CpuAffinity::ParseCpuList(StringPiece spec, std::vector<int> *cpus) {
+  DCHECK(cpus);
+  std::vector<int> result;
+  std::vector<StringPiece> ranges;
+  Util::SplitStringUsing(spec, ",", &ranges);
+  if (ranges.empty()) {
+    return false;
+  }
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    const StringPiece range = ranges[i];
+    const StringPiece::size_type dash = range.find('-');
+    uint32 begin = 0;
+    uint32 end = 0;
+    if (dash == StringPiece::npos) {
+      if (!NumberUtil::SafeStrToUInt32(range, &begin)) {
+        return false;
+      }
+      end = begin;
+    } else {
+      if (!NumberUtil::SafeStrToUInt32(range.substr(0, dash), &begin) ||
+          !NumberUtil::SafeStrToUInt32(range.substr(dash + 1), &end) ||
+          begin > end) {
+        return false;
+      }
+    }
+    for (uint32 cpu = begin; cpu <= end; ++cpu) {
+      result.push_back(static_cast<int>(cpu));
+    }
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  cpus->swap(result);
+  return true;
+}
+
+bool CpuAffinity::SetCurrentThreadAffinity(const std::vector<int> &cpus) {
+  if (cpus.empty()) {
+    return false;
+  }
+#if defined(OS_WIN)
+  DWORD_PTR mask = 0;
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    if (cpus[i] < 0 || cpus[i] >= static_cast<int>(8 * sizeof(mask))) {
+      return false;
+    }
+    mask |= static_cast<DWORD_PTR>(1) << cpus[i];
+  }
+  return ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0;
+#elif defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpus[i], &cpu_set);
+  }
+  const int result =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (result != 0) {
+    LOG(WARNING) << "pthread_setaffinity_np failed: " << result;
+    return false;
+  }
+  return true;
+#else  // OS_MACOSX, OS_ANDROID, OS_NACL, ...
+  // No usable thread affinity API on these platforms.
+  return false;
+#endif
+}
+
+}  // namespace mozc
@@ -0,0 +1,63 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_CPU_AFFINITY_H_
+#define MOZC_BASE_CPU_AFFINITY_H_
+
+#include <vector>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+
+// Helpers to restrict threads to a set of logical CPUs.  Shared server
+// deployments (see server/mozc_rpc_server_main.cc) use this to keep the
+// worker threads on the socket whose node holds the mmapped dictionary
+// pages instead of bouncing between sockets.  The desktop IME never
+// sets an affinity.
+class CpuAffinity {
+ public:
+  // Parses a Linux taskset style CPU list such as "0-3,8,10-11" into
+  // ascending CPU indices.  Returns false (leaving |cpus| unspecified)
+  // on malformed input.
+  static bool ParseCpuList(StringPiece spec, std::vector<int> *cpus);
+
+  // Restricts the calling thread to the given CPUs.  Returns false if
+  // the set is empty, contains an unknown CPU, or the platform does
+  // not support thread affinity (only Linux and Windows do).
+  static bool SetCurrentThreadAffinity(const std::vector<int> &cpus);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(CpuAffinity);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_CPU_AFFINITY_H_
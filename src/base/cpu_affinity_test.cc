@@ -0,0 +1,73 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/cpu_affinity.h"
+
+#include <vector>
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+
+TEST(CpuAffinityTest, ParseCpuList) {
+  std::vector<int> cpus;
+
+  ASSERT_TRUE(CpuAffinity::ParseCpuList("0", &cpus));
+  ASSERT_EQ(1, cpus.size());
+  EXPECT_EQ(0, cpus[0]);
+
+  ASSERT_TRUE(CpuAffinity::ParseCpuList("0-3,8,10-11", &cpus));
+  ASSERT_EQ(7, cpus.size());
+  EXPECT_EQ(0, cpus[0]);
+  EXPECT_EQ(3, cpus[3]);
+  EXPECT_EQ(8, cpus[4]);
+  EXPECT_EQ(11, cpus[6]);
+
+  // Duplicates and overlapping ranges collapse.
+  ASSERT_TRUE(CpuAffinity::ParseCpuList("1,1,0-2", &cpus));
+  ASSERT_EQ(3, cpus.size());
+
+  EXPECT_FALSE(CpuAffinity::ParseCpuList("", &cpus));
+  EXPECT_FALSE(CpuAffinity::ParseCpuList("a", &cpus));
+  EXPECT_FALSE(CpuAffinity::ParseCpuList("1-", &cpus));
+  EXPECT_FALSE(CpuAffinity::ParseCpuList("3-1", &cpus));
+}
+
+TEST(CpuAffinityTest, SetCurrentThreadAffinity) {
+  std::vector<int> cpus;
+  EXPECT_FALSE(CpuAffinity::SetCurrentThreadAffinity(cpus));
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+  // CPU 0 always exists.
+  cpus.push_back(0);
+  EXPECT_TRUE(CpuAffinity::SetCurrentThreadAffinity(cpus));
+#endif  // OS_LINUX && !OS_ANDROID && !OS_NACL
+}
+
+}  // namespace mozc
@@ -299,6 +299,248 @@ bool FileUtil::IsEqualFile(const string &filename1,
   return memcmp(mmap1.begin(), mmap2.begin(), mmap1.size()) == 0;
 }
 
+namespace {
+
+// Shadow buffer layout used by FileUtil::WritePaged():
+//   |magic|version|generation(uint64)|total_size(uint64)|num_pages|
+//   num_pages records of |page_index|page_length|page_data|
+//   |tail magic|
+// The tail magic is written last, so a shadow without it was
+// interrupted while it was written and must be ignored.
+const uint32 kShadowMagic = 0x7368646f;
+const uint32 kShadowFormatVersion = 1;
+const uint32 kShadowTailMagic = 0x646f6e65;
+const size_t kShadowPageSize = 4096;
+const char kShadowFileSuffix[] = ".shadow";
+
+uint64 NextShadowGeneration() {
+  static Mutex mutex;
+  static uint64 generation = 0;
+  scoped_lock l(&mutex);
+  return ++generation;
+}
+
+template <typename T>
+void WriteShadowValue(const T &value, std::ostream *ofs) {
+  ofs->write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool ReadShadowValue(const char **begin, const char *end, T *value) {
+  if (*begin + sizeof(*value) > end) {
+    return false;
+  }
+  memcpy(value, *begin, sizeof(*value));
+  *begin += sizeof(*value);
+  return true;
+}
+
+struct ShadowPage {
+  uint32 index;
+  uint32 length;
+  const char *data;
+};
+
+// Patches the pages recorded in |shadow_filename| into |filename|.
+// A shadow which does not parse to its very end is reported via
+// |*valid| = false and leaves the target file untouched.
+bool ApplyShadow(const string &filename, const string &shadow_filename,
+                 bool *valid) {
+  *valid = false;
+  Mmap mmap;
+  if (!mmap.Open(shadow_filename.c_str(), "r")) {
+    LOG(ERROR) << "Cannot open: " << shadow_filename;
+    return false;
+  }
+
+  const char *begin = mmap.begin();
+  const char *end = mmap.end();
+  uint32 magic = 0, version = 0, num_pages = 0;
+  uint64 generation = 0, total_size = 0;
+  if (!ReadShadowValue(&begin, end, &magic) || magic != kShadowMagic ||
+      !ReadShadowValue(&begin, end, &version) ||
+      version != kShadowFormatVersion ||
+      !ReadShadowValue(&begin, end, &generation) ||
+      !ReadShadowValue(&begin, end, &total_size) ||
+      !ReadShadowValue(&begin, end, &num_pages)) {
+    return false;
+  }
+
+  std::vector<ShadowPage> pages;
+  for (uint32 i = 0; i < num_pages; ++i) {
+    ShadowPage page;
+    if (!ReadShadowValue(&begin, end, &page.index) ||
+        !ReadShadowValue(&begin, end, &page.length) ||
+        page.length == 0 || page.length > kShadowPageSize ||
+        begin + page.length > end ||
+        static_cast<uint64>(page.index) * kShadowPageSize + page.length >
+            total_size) {
+      return false;
+    }
+    page.data = begin;
+    begin += page.length;
+    pages.push_back(page);
+  }
+
+  uint32 tail = 0;
+  if (!ReadShadowValue(&begin, end, &tail) || tail != kShadowTailMagic ||
+      begin != end) {
+    return false;
+  }
+  *valid = true;
+
+  // "r+"; the pages are sorted by offset, so a growing file is extended
+  // contiguously.
+  OutputFileStream ofs(filename.c_str(),
+                       std::ios::in | std::ios::out | std::ios::binary);
+  if (!ofs) {
+    LOG(ERROR) << "Cannot open: " << filename;
+    return false;
+  }
+  for (size_t i = 0; i < pages.size(); ++i) {
+    ofs.seekp(static_cast<std::streamoff>(
+        static_cast<uint64>(pages[i].index) * kShadowPageSize));
+    ofs.write(pages[i].data, pages[i].length);
+  }
+  if (!ofs.good()) {
+    LOG(ERROR) << "Cannot write: " << filename;
+    return false;
+  }
+  return true;
+}
+
+bool WriteFullImage(const string &filename, const string &content) {
+  const string tmp_filename = filename + ".tmp";
+  {
+    OutputFileStream ofs(tmp_filename.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      LOG(ERROR) << "Cannot open: " << tmp_filename;
+      return false;
+    }
+    ofs.write(content.data(), content.size());
+    if (!ofs.good()) {
+      LOG(ERROR) << "Cannot write: " << tmp_filename;
+      return false;
+    }
+  }
+  return FileUtil::AtomicRename(tmp_filename, filename);
+}
+
+}  // namespace
+
+bool FileUtil::WritePaged(const string &filename, const string &content) {
+  if (!RecoverPagedWrite(filename)) {
+    return false;
+  }
+
+  std::vector<size_t> dirty_pages;
+  {
+    Mmap mmap;
+    if (!FileExists(filename) || !mmap.Open(filename.c_str(), "r")) {
+      return WriteFullImage(filename, content);
+    }
+    if (content.size() < mmap.size()) {
+      // Patching in place cannot truncate the file.
+      return WriteFullImage(filename, content);
+    }
+
+    const size_t num_pages =
+        (content.size() + kShadowPageSize - 1) / kShadowPageSize;
+    size_t dirty_bytes = 0;
+    for (size_t i = 0; i < num_pages; ++i) {
+      const size_t offset = i * kShadowPageSize;
+      const size_t length = (offset + kShadowPageSize <= content.size())
+                                ? kShadowPageSize
+                                : content.size() - offset;
+      if (offset + length > mmap.size() ||
+          memcmp(mmap.begin() + offset, content.data() + offset,
+                 length) != 0) {
+        dirty_pages.push_back(i);
+        dirty_bytes += length;
+      }
+    }
+    if (dirty_pages.empty()) {
+      return true;  // the image is unchanged.
+    }
+    // Each dirty page goes to the disk twice (shadow, then in place), so
+    // the scheme only pays off while the dirty ratio stays low.
+    if (2 * dirty_bytes >= content.size()) {
+      return WriteFullImage(filename, content);
+    }
+  }  // The mapping must be closed before the file is patched.
+
+  // Write the shadow buffer first; until it is complete the target file
+  // is untouched, and once it is complete a crash during the in-place
+  // patch below is repaired by RecoverPagedWrite().
+  const string shadow_filename = filename + kShadowFileSuffix;
+  {
+    OutputFileStream ofs(shadow_filename.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      LOG(ERROR) << "Cannot open: " << shadow_filename;
+      return false;
+    }
+    WriteShadowValue<uint32>(kShadowMagic, &ofs);
+    WriteShadowValue<uint32>(kShadowFormatVersion, &ofs);
+    WriteShadowValue<uint64>(NextShadowGeneration(), &ofs);
+    WriteShadowValue<uint64>(content.size(), &ofs);
+    WriteShadowValue<uint32>(static_cast<uint32>(dirty_pages.size()), &ofs);
+    for (size_t i = 0; i < dirty_pages.size(); ++i) {
+      const size_t offset = dirty_pages[i] * kShadowPageSize;
+      const size_t length = (offset + kShadowPageSize <= content.size())
+                                ? kShadowPageSize
+                                : content.size() - offset;
+      WriteShadowValue<uint32>(static_cast<uint32>(dirty_pages[i]), &ofs);
+      WriteShadowValue<uint32>(static_cast<uint32>(length), &ofs);
+      ofs.write(content.data() + offset, length);
+    }
+    WriteShadowValue<uint32>(kShadowTailMagic, &ofs);
+    if (!ofs.good()) {
+      LOG(ERROR) << "Cannot write: " << shadow_filename;
+      ofs.close();
+      Unlink(shadow_filename);
+      return false;
+    }
+  }
+
+  bool valid = false;
+  if (!ApplyShadow(filename, shadow_filename, &valid)) {
+    // The shadow is kept; the next RecoverPagedWrite() retries.
+    LOG(ERROR) << "Cannot patch: " << filename;
+    return false;
+  }
+  Unlink(shadow_filename);
+  return true;
+}
+
+bool FileUtil::RecoverPagedWrite(const string &filename) {
+  const string shadow_filename = filename + kShadowFileSuffix;
+  if (!FileExists(shadow_filename)) {
+    return true;
+  }
+  if (!FileExists(filename)) {
+    // The target is gone; the shadow alone is useless.
+    Unlink(shadow_filename);
+    return true;
+  }
+  bool valid = false;
+  if (!ApplyShadow(filename, shadow_filename, &valid)) {
+    if (!valid) {
+      // The shadow itself was interrupted; the target file is intact.
+      LOG(WARNING) << "Dropping incomplete shadow buffer: "
+                   << shadow_filename;
+      Unlink(shadow_filename);
+      return true;
+    }
+    LOG(ERROR) << "Cannot apply shadow buffer: " << shadow_filename;
+    return false;
+  }
+  VLOG(1) << "Replayed shadow buffer: " << shadow_filename;
+  Unlink(shadow_filename);
+  return true;
+}
+
 bool FileUtil::AtomicRename(const string &from, const string &to) {
 #ifdef OS_WIN
   std::wstring fromw, tow;
@@ -108,6 +108,24 @@ class FileUtil {
   // Returns true if the file is renamed successfully.
   static bool AtomicRename(const string &from, const string &to);
 
+  // Writes |content| to |filename|, rewriting only the 4-KiB pages that
+  // differ from the current file content.  The dirty pages are first
+  // written to a shadow buffer file ("<filename>.shadow") under a
+  // generation header and are then patched into |filename| in place, so
+  // every page of the new image is always present in one of the two
+  // buffers.  An update interrupted between the two steps is repaired by
+  // RecoverPagedWrite(), which writers run automatically and readers
+  // should run before opening the file.  Falls back to a full rewrite
+  // via AtomicRename() when the file does not exist, shrinks, or most of
+  // its pages changed.
+  static bool WritePaged(const string &filename, const string &content);
+
+  // Applies the shadow buffer left by a WritePaged() call that was
+  // interrupted after the shadow was completely written.  An incomplete
+  // shadow is discarded; the target file then still holds the previous
+  // image.  Returns false only when a complete shadow cannot be applied.
+  static bool RecoverPagedWrite(const string &filename);
+
   // Joins the give path components using the OS-specific path delimiter.
   static string JoinPath(const std::vector<StringPiece> &components);
   static void JoinPath(const std::vector<StringPiece> &components,
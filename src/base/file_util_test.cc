@@ -377,6 +377,112 @@ TEST_F(FileUtilTest, AtomicRename) {
   FileUtil::Unlink(to);
 }
 
+namespace {
+
+string ReadTestFile(const string &filename) {
+  InputFileStream ifs(filename.c_str(), std::ios::binary);
+  EXPECT_TRUE(ifs.good());
+  string content;
+  char buf[4096];
+  while (ifs.read(buf, sizeof(buf))) {
+    content.append(buf, sizeof(buf));
+  }
+  content.append(buf, static_cast<size_t>(ifs.gcount()));
+  return content;
+}
+
+template <typename T>
+void WriteValueForTest(const T &value, std::ostream *ofs) {
+  ofs->write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+}  // namespace
+
+TEST_F(FileUtilTest, WritePaged) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                             "write_paged_test");
+  const string shadow_filename = filename + ".shadow";
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(shadow_filename);
+
+  // First write creates the file.
+  string content(16 * 1024, 'a');
+  EXPECT_TRUE(FileUtil::WritePaged(filename, content));
+  EXPECT_EQ(content, ReadTestFile(filename));
+
+  // A small change touches a single page.
+  content[100] = 'b';
+  EXPECT_TRUE(FileUtil::WritePaged(filename, content));
+  EXPECT_EQ(content, ReadTestFile(filename));
+  EXPECT_FALSE(FileUtil::FileExists(shadow_filename));
+
+  // Identical content is a no-op.
+  EXPECT_TRUE(FileUtil::WritePaged(filename, content));
+  EXPECT_EQ(content, ReadTestFile(filename));
+
+  // Growing by a partial page.
+  content.append(100, 'c');
+  EXPECT_TRUE(FileUtil::WritePaged(filename, content));
+  EXPECT_EQ(content, ReadTestFile(filename));
+
+  // Shrinking falls back to the full rewrite.
+  content.resize(4000);
+  EXPECT_TRUE(FileUtil::WritePaged(filename, content));
+  EXPECT_EQ(content, ReadTestFile(filename));
+
+  FileUtil::Unlink(filename);
+}
+
+TEST_F(FileUtilTest, RecoverPagedWrite) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                             "recover_paged_write_test");
+  const string shadow_filename = filename + ".shadow";
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(shadow_filename);
+
+  // No shadow: nothing to do.
+  EXPECT_TRUE(FileUtil::RecoverPagedWrite(filename));
+
+  const string old_content(8 * 1024, 'a');
+  CreateTestFile(filename, old_content);
+
+  // Hand-craft a complete shadow which patches the first page, as a
+  // crash after the shadow was written would leave it.
+  const string page(4096, 'b');
+  {
+    OutputFileStream ofs(shadow_filename.c_str(),
+                         std::ios::binary | std::ios::trunc);
+    WriteValueForTest<uint32>(0x7368646f, &ofs);   // magic
+    WriteValueForTest<uint32>(1, &ofs);            // version
+    WriteValueForTest<uint64>(1, &ofs);            // generation
+    WriteValueForTest<uint64>(old_content.size(), &ofs);
+    WriteValueForTest<uint32>(1, &ofs);            // num_pages
+    WriteValueForTest<uint32>(0, &ofs);            // page index
+    WriteValueForTest<uint32>(page.size(), &ofs);
+    ofs.write(page.data(), page.size());
+    WriteValueForTest<uint32>(0x646f6e65, &ofs);   // tail magic
+  }
+  EXPECT_TRUE(FileUtil::RecoverPagedWrite(filename));
+  EXPECT_FALSE(FileUtil::FileExists(shadow_filename));
+  EXPECT_EQ(page + old_content.substr(4096), ReadTestFile(filename));
+
+  // An incomplete shadow (no tail magic) is discarded and the target is
+  // left as is.
+  {
+    OutputFileStream ofs(shadow_filename.c_str(),
+                         std::ios::binary | std::ios::trunc);
+    WriteValueForTest<uint32>(0x7368646f, &ofs);
+    WriteValueForTest<uint32>(1, &ofs);
+    WriteValueForTest<uint64>(2, &ofs);
+  }
+  const string patched_content = ReadTestFile(filename);
+  EXPECT_TRUE(FileUtil::RecoverPagedWrite(filename));
+  EXPECT_FALSE(FileUtil::FileExists(shadow_filename));
+  EXPECT_EQ(patched_content, ReadTestFile(filename));
+
+  FileUtil::Unlink(filename);
+}
+
 #ifdef OS_WIN
 #define SP "\\"
 #else
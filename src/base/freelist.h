@@ -30,7 +30,9 @@
 #ifndef MOZC_BASE_FREELIST_H_
 #define MOZC_BASE_FREELIST_H_
 
+#include <algorithm>
 #include <vector>
+
 #include "base/port.h"
 
 namespace mozc {
@@ -47,7 +49,7 @@ namespace mozc {
 template <class T> class FreeList {
  public:
   explicit FreeList(size_t size)
-      : current_index_(0), chunk_index_(0), size_(size) {
+      : current_index_(0), chunk_index_(0), size_(size), generation_(0) {
   }
 
   ~FreeList() {
@@ -56,8 +58,14 @@ template <class T> class FreeList {
     }
   }
 
+  // Starts a new generation in O(1): every object handed out so far
+  // becomes free again, but the chunks are retained, so the next
+  // generation allocates without touching the heap.  Pointers obtained
+  // before Reset() belong to the old generation and must not be used
+  // afterwards.
   void Reset() {
     chunk_index_ = current_index_ = 0;
+    ++generation_;
   }
 
   void Free() {
@@ -69,6 +77,21 @@ template <class T> class FreeList {
     }
     current_index_ = 0;
     chunk_index_ = 0;
+    ++generation_;
+  }
+
+  // Deletes chunks from which the current generation has not allocated,
+  // keeping at least |keep_chunks| chunks.  All pointers returned by
+  // Alloc() since the last Reset()/Free() stay valid; only the cold tail
+  // left behind by a larger past generation is given back to the heap.
+  void ReleaseFreeChunks(size_t keep_chunks) {
+    const size_t keep = std::max(used_chunk_count(), keep_chunks);
+    for (size_t i = keep; i < pool_.size(); ++i) {
+      delete [] pool_[i];
+    }
+    if (pool_.size() > keep) {
+      pool_.resize(keep);
+    }
   }
 
   T* Alloc() {
@@ -94,11 +117,34 @@ template <class T> class FreeList {
     size_ = size;
   }
 
+  // Number of allocated chunks; each chunk holds size() objects.
+  size_t chunk_count() const {
+    return pool_.size();
+  }
+
+  // Approximate heap bytes retained by the chunks.  Heap owned by the
+  // objects themselves (e.g. string contents) is not included.
+  size_t RetainedBytes() const {
+    return pool_.size() * size_ * sizeof(T);
+  }
+
+  // Number of chunks the current generation has allocated from.
+  size_t used_chunk_count() const {
+    return chunk_index_ + (current_index_ > 0 ? 1 : 0);
+  }
+
+  // Incremented by every Reset()/Free().  Callers that cache pointers
+  // can remember the generation they allocated in and DCHECK it on use.
+  uint64 generation() const {
+    return generation_;
+  }
+
  private:
   std::vector<T *> pool_;
   size_t current_index_;
   size_t chunk_index_;
   size_t size_;
+  uint64 generation_;
 
   DISALLOW_COPY_AND_ASSIGN(FreeList);
 };
@@ -116,6 +162,15 @@ template <class T> class ObjectPool {
     freelist_.Free();
   }
 
+  // Makes all objects available again without releasing the chunks.
+  // Note that recycled objects keep their previous state (including
+  // e.g. string capacities), so the caller must re-initialize every
+  // object obtained from Alloc().
+  void Reset() {
+    released_.clear();
+    freelist_.Reset();
+  }
+
   T* Alloc() {
     if (!released_.empty()) {
       T *result = released_.back();
@@ -133,6 +188,26 @@ template <class T> class ObjectPool {
     freelist_.set_size(size);
   }
 
+  // See FreeList<T>::ReleaseFreeChunks().  Objects in released_ always
+  // come from chunks the current generation has allocated from, so they
+  // survive the trimming.
+  void ReleaseFreeChunks(size_t keep_chunks) {
+    freelist_.ReleaseFreeChunks(keep_chunks);
+  }
+
+  size_t chunk_count() const {
+    return freelist_.chunk_count();
+  }
+
+  size_t used_chunk_count() const {
+    return freelist_.used_chunk_count();
+  }
+
+  // See FreeList<T>::RetainedBytes().
+  size_t RetainedBytes() const {
+    return freelist_.RetainedBytes() + released_.capacity() * sizeof(T *);
+  }
+
  private:
   std::vector<T *> released_;
   FreeList<T> freelist_;
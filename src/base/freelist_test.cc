@@ -0,0 +1,101 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/freelist.h"
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+struct Stub {
+  int value;
+};
+
+TEST(FreeListTest, ResetStartsNewGenerationInPlace) {
+  FreeList<Stub> freelist(4);
+  EXPECT_EQ(0, freelist.generation());
+  EXPECT_EQ(0, freelist.used_chunk_count());
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(freelist.Alloc() != NULL);
+  }
+  const size_t chunks = freelist.chunk_count();
+  EXPECT_GT(chunks, 1);
+  EXPECT_EQ(chunks, freelist.used_chunk_count());
+
+  freelist.Reset();
+  EXPECT_EQ(1, freelist.generation());
+  EXPECT_EQ(0, freelist.used_chunk_count());
+  // Reset() retains the chunks; the next generation reuses them.
+  EXPECT_EQ(chunks, freelist.chunk_count());
+}
+
+TEST(FreeListTest, ReleaseFreeChunksKeepsLiveObjects) {
+  FreeList<Stub> freelist(4);
+  for (int i = 0; i < 40; ++i) {
+    freelist.Alloc();
+  }
+  const size_t peak_chunks = freelist.chunk_count();
+
+  // A smaller generation leaves most chunks cold.
+  freelist.Reset();
+  Stub *live = freelist.Alloc();
+  live->value = 42;
+
+  freelist.ReleaseFreeChunks(2);
+  EXPECT_EQ(2, freelist.chunk_count());
+  EXPECT_LT(freelist.chunk_count(), peak_chunks);
+  EXPECT_EQ(42, live->value);
+
+  // Never trims below the chunks the current generation has used.
+  for (int i = 0; i < 40; ++i) {
+    freelist.Alloc();
+  }
+  freelist.ReleaseFreeChunks(1);
+  EXPECT_EQ(freelist.used_chunk_count(), freelist.chunk_count());
+}
+
+TEST(ObjectPoolTest, ReleaseFreeChunksKeepsRecycledObjects) {
+  ObjectPool<Stub> pool(4);
+  for (int i = 0; i < 40; ++i) {
+    pool.Alloc();
+  }
+  pool.Reset();
+
+  Stub *first = pool.Alloc();
+  pool.Release(first);
+  pool.ReleaseFreeChunks(1);
+  EXPECT_EQ(1, pool.chunk_count());
+  // The released object is recycled from the retained chunk.
+  EXPECT_EQ(first, pool.Alloc());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -29,6 +29,9 @@
 
 #include "base/hash.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "base/port.h"
 
 namespace mozc {
@@ -37,6 +40,20 @@ namespace {
 const uint32 kFingerPrint32Seed = 0xfd12deff;
 const uint32 kFingerPrintSeed0 = 0x6d6f;
 const uint32 kFingerPrintSeed1 = 0x7a63;
+const uint32 kFingerPrint128Seed = 0x6d6f7a63;
+
+uint64 Rotl64(uint64 x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+uint64 FMix64(uint64 k) {
+  k ^= k >> 33;
+  k *= GG_ULONGLONG(0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= GG_ULONGLONG(0xc4ceb9fe1a85ec53);
+  k ^= k >> 33;
+  return k;
+}
 
 }  // namespace
 
@@ -117,6 +134,118 @@ uint32 Hash::Fingerprint32WithSeed(StringPiece str, uint32 seed) {
 #undef U32
 }
 
+void Hash::Fingerprint128(StringPiece str, uint64 *high, uint64 *low) {
+  Fingerprint128WithSeed(str, kFingerPrint128Seed, high, low);
+}
+
+// MurmurHash3 x64 128-bit variant by Austin Appleby (public domain).
+void Hash::Fingerprint128WithSeed(StringPiece str, uint32 seed,
+                                  uint64 *high, uint64 *low) {
+  const char *data = str.data();
+  const size_t size = str.size();
+  const size_t nblocks = size / 16;
+
+  uint64 h1 = seed;
+  uint64 h2 = seed;
+  const uint64 c1 = GG_ULONGLONG(0x87c37b91114253d5);
+  const uint64 c2 = GG_ULONGLONG(0x4cf5ad432745937f);
+
+  for (size_t i = 0; i < nblocks; ++i) {
+    uint64 k1, k2;
+    memcpy(&k1, data + 16 * i, 8);
+    memcpy(&k2, data + 16 * i + 8, 8);
+
+    k1 *= c1;
+    k1 = Rotl64(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+    h1 = Rotl64(h1, 27);
+    h1 += h2;
+    h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= c2;
+    k2 = Rotl64(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+    h2 = Rotl64(h2, 31);
+    h2 += h1;
+    h2 = h2 * 5 + 0x38495ab5;
+  }
+
+#define U64(i) static_cast<uint64>(static_cast<uint8>(tail[i]))
+  const char *tail = data + 16 * nblocks;
+  uint64 k1 = 0;
+  uint64 k2 = 0;
+  switch (size & 15) {
+    case 15:
+      k2 ^= U64(14) << 48;
+      FALLTHROUGH_INTENDED;
+    case 14:
+      k2 ^= U64(13) << 40;
+      FALLTHROUGH_INTENDED;
+    case 13:
+      k2 ^= U64(12) << 32;
+      FALLTHROUGH_INTENDED;
+    case 12:
+      k2 ^= U64(11) << 24;
+      FALLTHROUGH_INTENDED;
+    case 11:
+      k2 ^= U64(10) << 16;
+      FALLTHROUGH_INTENDED;
+    case 10:
+      k2 ^= U64(9) << 8;
+      FALLTHROUGH_INTENDED;
+    case 9:
+      k2 ^= U64(8);
+      k2 *= c2;
+      k2 = Rotl64(k2, 33);
+      k2 *= c1;
+      h2 ^= k2;
+      FALLTHROUGH_INTENDED;
+    case 8:
+      k1 ^= U64(7) << 56;
+      FALLTHROUGH_INTENDED;
+    case 7:
+      k1 ^= U64(6) << 48;
+      FALLTHROUGH_INTENDED;
+    case 6:
+      k1 ^= U64(5) << 40;
+      FALLTHROUGH_INTENDED;
+    case 5:
+      k1 ^= U64(4) << 32;
+      FALLTHROUGH_INTENDED;
+    case 4:
+      k1 ^= U64(3) << 24;
+      FALLTHROUGH_INTENDED;
+    case 3:
+      k1 ^= U64(2) << 16;
+      FALLTHROUGH_INTENDED;
+    case 2:
+      k1 ^= U64(1) << 8;
+      FALLTHROUGH_INTENDED;
+    case 1:
+      k1 ^= U64(0);
+      k1 *= c1;
+      k1 = Rotl64(k1, 31);
+      k1 *= c2;
+      h1 ^= k1;
+      break;
+  }
+#undef U64
+
+  h1 ^= static_cast<uint64>(size);
+  h2 ^= static_cast<uint64>(size);
+  h1 += h2;
+  h2 += h1;
+  h1 = FMix64(h1);
+  h2 = FMix64(h2);
+  h1 += h2;
+  h2 += h1;
+
+  *high = h2;
+  *low = h1;
+}
+
 uint64 Hash::Fingerprint(StringPiece str) {
   return FingerprintWithSeed(str, kFingerPrintSeed0);
 }
@@ -131,4 +260,100 @@ uint64 Hash::FingerprintWithSeed(StringPiece str, uint32 seed) {
   return result;
 }
 
+#define U32(x) static_cast<uint32>(x)
+#define ToUint32(a, b, c, d) \
+  (U32(a) + (U32(b) << 8) + (U32(c) << 16) + (U32(d) << 24))
+
+FingerprintAccumulator::FingerprintAccumulator()
+    : total_size_(0), buffered_size_(0) {
+  hi_.a = hi_.b = 0x9e3779b9;
+  hi_.c = kFingerPrintSeed0;
+  lo_.a = lo_.b = 0x9e3779b9;
+  lo_.c = kFingerPrintSeed1;
+}
+
+void FingerprintAccumulator::Append(StringPiece str) {
+  total_size_ += U32(str.size());
+  while (!str.empty()) {
+    const size_t count =
+        std::min(str.size(), sizeof(buffer_) - buffered_size_);
+    memcpy(buffer_ + buffered_size_, str.data(), count);
+    buffered_size_ += count;
+    str.remove_prefix(count);
+    if (buffered_size_ < sizeof(buffer_)) {
+      break;
+    }
+    // Mix the completed 12-byte block into both states, exactly like
+    // the block loop of Fingerprint32WithSeed().
+    hi_.a += ToUint32(buffer_[0], buffer_[1], buffer_[2], buffer_[3]);
+    hi_.b += ToUint32(buffer_[4], buffer_[5], buffer_[6], buffer_[7]);
+    hi_.c += ToUint32(buffer_[8], buffer_[9], buffer_[10], buffer_[11]);
+    Mix(hi_.a, hi_.b, hi_.c);
+    lo_.a += ToUint32(buffer_[0], buffer_[1], buffer_[2], buffer_[3]);
+    lo_.b += ToUint32(buffer_[4], buffer_[5], buffer_[6], buffer_[7]);
+    lo_.c += ToUint32(buffer_[8], buffer_[9], buffer_[10], buffer_[11]);
+    Mix(lo_.a, lo_.b, lo_.c);
+    buffered_size_ = 0;
+  }
+}
+
+uint32 FingerprintAccumulator::Get32(const State32 &state) const {
+  uint32 a = state.a;
+  uint32 b = state.b;
+  uint32 c = state.c;
+
+  c += total_size_;
+  switch (buffered_size_) {
+    case 11:
+      c += U32(buffer_[10]) << 24;
+      FALLTHROUGH_INTENDED;
+    case 10:
+      c += U32(buffer_[9]) << 16;
+      FALLTHROUGH_INTENDED;
+    case 9:
+      c += U32(buffer_[8]) << 8;
+      FALLTHROUGH_INTENDED;
+    case 8:
+      b += U32(buffer_[7]) << 24;
+      FALLTHROUGH_INTENDED;
+    case 7:
+      b += U32(buffer_[6]) << 16;
+      FALLTHROUGH_INTENDED;
+    case 6:
+      b += U32(buffer_[5]) << 8;
+      FALLTHROUGH_INTENDED;
+    case 5:
+      b += U32(buffer_[4]);
+      FALLTHROUGH_INTENDED;
+    case 4:
+      a += U32(buffer_[3]) << 24;
+      FALLTHROUGH_INTENDED;
+    case 3:
+      a += U32(buffer_[2]) << 16;
+      FALLTHROUGH_INTENDED;
+    case 2:
+      a += U32(buffer_[1]) << 8;
+      FALLTHROUGH_INTENDED;
+    case 1:
+      a += U32(buffer_[0]);
+      break;
+  }
+  Mix(a, b, c);
+
+  return c;
+}
+
+#undef ToUint32
+#undef U32
+
+uint64 FingerprintAccumulator::Get() const {
+  const uint32 hi = Get32(hi_);
+  const uint32 lo = Get32(lo_);
+  uint64 result = static_cast<uint64>(hi) << 32 | static_cast<uint64>(lo);
+  if ((hi == 0) && (lo < 2)) {
+    result ^= GG_ULONGLONG(0x130f9bef94a0a928);
+  }
+  return result;
+}
+
 }  // namespace mozc
@@ -57,6 +57,32 @@ TEST(HashTest, Basic) {
   EXPECT_EQ(0xe3fd29979d4f0b39, Hash::FingerprintWithSeed(s, 0xdeadbeef));
 }
 
+TEST(HashTest, Fingerprint128) {
+  // Expected values are from the reference MurmurHash3 x64 128-bit
+  // implementation with seed 0x6d6f7a63 (resp. the explicit seed).
+  uint64 high = 0;
+  uint64 low = 0;
+
+  Hash::Fingerprint128("", &high, &low);
+  EXPECT_EQ(0x59e0d33ff83ab2e1, high);
+  EXPECT_EQ(0x8bff7f52fe9ff716, low);
+
+  Hash::Fingerprint128("google", &high, &low);
+  EXPECT_EQ(0x8f8e8347711a46d7, high);
+  EXPECT_EQ(0x0146f10127e6699a, low);
+
+  // Longer than one 16-byte block.
+  Hash::Fingerprint128(
+      "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.",
+      &high, &low);
+  EXPECT_EQ(0x120c503783a1a3d6, high);
+  EXPECT_EQ(0x5a0187e498fec830, low);
+
+  Hash::Fingerprint128WithSeed("google", 0xdeadbeef, &high, &low);
+  EXPECT_EQ(0x80ab5e72ecdeca6a, high);
+  EXPECT_EQ(0xd7e7e2b278216284, low);
+}
+
 TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   const uint32 seed = 0xabcdef;
   {
@@ -97,5 +123,36 @@ TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   }
 }
 
+TEST(HashTest, FingerprintAccumulator) {
+  // The accumulator must reproduce Fingerprint() of the concatenation
+  // for any chunking, including chunks crossing 12-byte block borders.
+  const string s =
+      "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.";
+  for (size_t split = 0; split <= s.size(); ++split) {
+    FingerprintAccumulator accum;
+    accum.Append(s.substr(0, split));
+    accum.Append(s.substr(split));
+    EXPECT_EQ(Hash::Fingerprint(s), accum.Get()) << "split at " << split;
+  }
+
+  // Get() does not finalize the state; appending may continue.
+  FingerprintAccumulator accum;
+  accum.Append("foo");
+  EXPECT_EQ(Hash::Fingerprint("foo"), accum.Get());
+  accum.Append("bar");
+  EXPECT_EQ(Hash::Fingerprint("foobar"), accum.Get());
+
+  // A copied accumulator shares the prefix state and diverges freely.
+  FingerprintAccumulator prefix;
+  prefix.Append("foo");
+  FingerprintAccumulator copy = prefix;
+  copy.Append("baz");
+  EXPECT_EQ(Hash::Fingerprint("foobaz"), copy.Get());
+  EXPECT_EQ(Hash::Fingerprint("foo"), prefix.Get());
+
+  // The empty accumulator equals the fingerprint of the empty string.
+  EXPECT_EQ(Hash::Fingerprint(""), FingerprintAccumulator().Get());
+}
+
 }  // namespace
 }  // namespace mozc
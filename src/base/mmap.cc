@@ -41,6 +41,7 @@
 #endif  // OS_WIN
 
 #include <cstring>
+#include <memory>
 
 #include "base/port.h"
 #include "base/logging.h"
@@ -298,4 +299,125 @@ int Mmap::MaybeMUnlock(const void *addr, size_t len) {
 
 #undef MOZC_HAVE_MLOCK
 
+// Define a macro (MOZC_HAVE_MADVISE) to indicate madvise/mincore support.
+// Unlike mlock, madvise needs no privilege, so Android is included.
+#if defined(OS_WIN) || defined(OS_NACL) || defined(MOZC_USE_PEPPER_FILE_IO)
+# define MOZC_HAVE_MADVISE 0
+#else  // defined(OS_WIN) || defined(OS_NACL) ||
+       // defined(MOZC_USE_PEPPER_FILE_IO)
+# define MOZC_HAVE_MADVISE 1
+#endif  // defined(OS_WIN) || defined(OS_NACL) ||
+        // defined(MOZC_USE_PEPPER_FILE_IO)
+
+#if MOZC_HAVE_MADVISE
+
+namespace {
+
+int ToNativeAdvice(Mmap::Advice advice) {
+  switch (advice) {
+    case Mmap::ADVICE_RANDOM:
+      return MADV_RANDOM;
+    case Mmap::ADVICE_WILL_NEED:
+      return MADV_WILLNEED;
+    case Mmap::ADVICE_DONT_NEED:
+      return MADV_DONTNEED;
+    default:
+      return MADV_NORMAL;
+  }
+}
+
+// Aligns [addr, addr + len) down to a page boundary as madvise and
+// mincore require page-aligned addresses.
+void AlignToPage(const void *addr, size_t len,
+                 void **aligned_addr, size_t *aligned_len) {
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  const uintptr_t aligned_begin = begin - begin % page_size;
+  *aligned_addr = reinterpret_cast<void *>(aligned_begin);
+  *aligned_len = len + (begin - aligned_begin);
+}
+
+}  // namespace
+
+bool Mmap::IsMAdviseSupported() {
+  return true;
+}
+
+int Mmap::MaybeMAdvise(const void *addr, size_t len, Advice advice) {
+  void *aligned_addr = NULL;
+  size_t aligned_len = 0;
+  AlignToPage(addr, len, &aligned_addr, &aligned_len);
+  return madvise(aligned_addr, aligned_len, ToNativeAdvice(advice));
+}
+
+int Mmap::MaybeCountResidentPages(const void *addr, size_t len,
+                                  size_t *resident_pages,
+                                  size_t *total_pages) {
+  DCHECK(resident_pages);
+  DCHECK(total_pages);
+  void *aligned_addr = NULL;
+  size_t aligned_len = 0;
+  AlignToPage(addr, len, &aligned_addr, &aligned_len);
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t num_pages = (aligned_len + page_size - 1) / page_size;
+  std::unique_ptr<unsigned char[]> residency(new unsigned char[num_pages]);
+#ifdef OS_MACOSX
+  if (mincore(aligned_addr, aligned_len,
+              reinterpret_cast<char *>(residency.get())) != 0) {
+#else  // OS_MACOSX
+  if (mincore(aligned_addr, aligned_len, residency.get()) != 0) {
+#endif  // OS_MACOSX
+    return -1;
+  }
+  size_t resident = 0;
+  for (size_t i = 0; i < num_pages; ++i) {
+    resident += (residency[i] & 1);
+  }
+  *resident_pages = resident;
+  *total_pages = num_pages;
+  return 0;
+}
+
+#else  // MOZC_HAVE_MADVISE
+
+bool Mmap::IsMAdviseSupported() {
+  return false;
+}
+
+int Mmap::MaybeMAdvise(const void *addr, size_t len, Advice advice) {
+  return -1;
+}
+
+int Mmap::MaybeCountResidentPages(const void *addr, size_t len,
+                                  size_t *resident_pages,
+                                  size_t *total_pages) {
+  return -1;
+}
+
+#endif  // MOZC_HAVE_MADVISE
+
+#undef MOZC_HAVE_MADVISE
+
+bool Mmap::Advise(Advice advice) {
+  return Advise(0, size_, advice);
+}
+
+bool Mmap::Advise(size_t offset, size_t len, Advice advice) {
+  if (begin() == NULL || size_ == 0 || offset >= size_) {
+    return false;
+  }
+  if (len > size_ - offset) {
+    len = size_ - offset;
+  }
+  return MaybeMAdvise(begin() + offset, len, advice) == 0;
+}
+
+bool Mmap::Residency(size_t *resident_pages, size_t *total_pages) const {
+  if (begin() == NULL || size_ == 0) {
+    return false;
+  }
+  return MaybeCountResidentPages(begin(), size_, resident_pages,
+                                 total_pages) == 0;
+}
+
 }  // namespace mozc
@@ -63,6 +63,33 @@ class Mmap : public MmapSyncInterface {
   static int MaybeMLock(const void *addr, size_t len);
   static int MaybeMUnlock(const void *addr, size_t len);
 
+  // Page residency advice for a mapped region.  As with mlock above, the
+  // actual system call is only issued on platforms that have it (everything
+  // but Windows and NaCl); elsewhere MaybeMAdvise() returns -1 and the call
+  // is a no-op.  The address range is aligned down to page boundaries
+  // internally, so callers can pass section pointers as is.
+  enum Advice {
+    ADVICE_NORMAL = 0,
+    ADVICE_RANDOM,     // Expect random access; disables kernel readahead.
+    ADVICE_WILL_NEED,  // Starts asynchronous readahead of the range.
+    ADVICE_DONT_NEED,  // The range will not be accessed in the near future.
+  };
+  static bool IsMAdviseSupported();
+  static int MaybeMAdvise(const void *addr, size_t len, Advice advice);
+
+  // Counts how many pages of [addr, addr + len) are resident in memory
+  // (mincore).  Returns 0 on success, -1 if unsupported or on failure.
+  static int MaybeCountResidentPages(const void *addr, size_t len,
+                                     size_t *resident_pages,
+                                     size_t *total_pages);
+
+  // Convenience wrappers applying the above to (a part of) this mapping.
+  // |offset| and |len| are clamped to the mapped region.  They return
+  // false when nothing is mapped or the platform has no madvise/mincore.
+  bool Advise(Advice advice);
+  bool Advise(size_t offset, size_t len, Advice advice);
+  bool Residency(size_t *resident_pages, size_t *total_pages) const;
+
 #ifndef MOZC_USE_PEPPER_FILE_IO
   char &operator[](size_t n) { return *(text_ + n); }
   char operator[](size_t n) const { return *(text_ + n); }
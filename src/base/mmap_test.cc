@@ -97,6 +97,50 @@ TEST(MmapTest, MmapTest) {
   }
 }
 
+TEST(MmapTest, AdviseAndResidencyTest) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                             "test_advise.db");
+  FileUtil::Unlink(filename);
+  {
+    OutputFileStream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+    const string buf(64 * 1024, 'a');
+    ofs.write(buf.data(), buf.size());
+  }
+
+  {
+    Mmap mmap;
+    ASSERT_TRUE(mmap.Open(filename.c_str(), "r"));
+    if (Mmap::IsMAdviseSupported()) {
+      EXPECT_TRUE(mmap.Advise(Mmap::ADVICE_RANDOM));
+      EXPECT_TRUE(mmap.Advise(0, mmap.size(), Mmap::ADVICE_WILL_NEED));
+      // Unaligned section pointers are accepted.
+      EXPECT_TRUE(mmap.Advise(100, 1000, Mmap::ADVICE_WILL_NEED));
+      // Ranges are clamped to the mapping.
+      EXPECT_TRUE(mmap.Advise(0, mmap.size() * 2, Mmap::ADVICE_NORMAL));
+      EXPECT_FALSE(mmap.Advise(mmap.size(), 1, Mmap::ADVICE_NORMAL));
+
+      size_t resident_pages = 0, total_pages = 0;
+      EXPECT_TRUE(mmap.Residency(&resident_pages, &total_pages));
+      EXPECT_GT(total_pages, 0);
+      EXPECT_LE(resident_pages, total_pages);
+    } else {
+      EXPECT_FALSE(mmap.Advise(Mmap::ADVICE_RANDOM));
+      size_t resident_pages = 0, total_pages = 0;
+      EXPECT_FALSE(mmap.Residency(&resident_pages, &total_pages));
+    }
+  }
+
+  // Nothing mapped.
+  {
+    Mmap mmap;
+    EXPECT_FALSE(mmap.Advise(Mmap::ADVICE_WILL_NEED));
+    size_t resident_pages = 0, total_pages = 0;
+    EXPECT_FALSE(mmap.Residency(&resident_pages, &total_pages));
+  }
+
+  FileUtil::Unlink(filename);
+}
+
 TEST(MmapTest, MaybeMLockTest) {
   const size_t data_len = 32;
   std::unique_ptr<void, void (*)(void*)> addr(malloc(data_len), &free);
@@ -106,25 +106,6 @@ struct NumberStringVariation {
   const NumberUtil::NumberString::Style style;
 };
 
-// Judges given string is a decimal number (including integer) or not.
-// It accepts strings whose last point is a decimal point like "123456."
-bool IsDecimalNumber(StringPiece str) {
-  int num_point = 0;
-  for (size_t i = 0; i < str.size(); ++i) {
-    if (str[i] == '.') {
-      ++num_point;
-      // A valid decimal number has at most one decimal point.
-      if (num_point >= 2) {
-        return false;
-      }
-    } else if (!isdigit(str[i])) {
-      return false;
-    }
-  }
-
-  return true;
-}
-
 const char kAsciiZero = '0';
 const char kAsciiOne = '1';
 const char kAsciiNine = '9';
@@ -185,6 +166,50 @@ bool NumberUtil::IsDecimalInteger(StringPiece str) {
   return true;
 }
 
+void NumberUtil::ParseDecimalString(StringPiece input,
+                                    DecimalStringInfo *info) {
+  DCHECK(info);
+  info->is_decimal_integer = !input.empty();
+  // A decimal number accepts strings whose last character is a decimal
+  // point like "123456.", and the empty string counts as one.
+  info->is_decimal_number = true;
+  info->fits_in_uint64 = false;
+  info->value = 0;
+
+  int num_point = 0;
+  bool overflow = false;
+  uint64 value = 0;
+  for (size_t i = 0; i < input.size(); ++i) {
+    const char c = input[i];
+    if (c == '.') {
+      info->is_decimal_integer = false;
+      // A valid decimal number has at most one decimal point.
+      ++num_point;
+      if (num_point >= 2) {
+        info->is_decimal_number = false;
+        return;
+      }
+      continue;
+    }
+    if (!isdigit(c)) {
+      info->is_decimal_integer = false;
+      info->is_decimal_number = false;
+      return;
+    }
+    const uint64 digit = static_cast<uint64>(c - kAsciiZero);
+    if (value > (kuint64max - digit) / 10) {
+      overflow = true;
+    } else {
+      value = value * 10 + digit;
+    }
+  }
+
+  if (info->is_decimal_integer && !overflow) {
+    info->fits_in_uint64 = true;
+    info->value = value;
+  }
+}
+
 namespace {
 
 // To know what "大字" means, please refer
@@ -208,11 +233,19 @@ const char kOldTwenty[] = "廿";
 
 bool NumberUtil::ArabicToKanji(StringPiece input_num,
                                std::vector<NumberString> *output) {
+  DecimalStringInfo info;
+  ParseDecimalString(input_num, &info);
+  return ArabicToKanji(input_num, info, output);
+}
+
+bool NumberUtil::ArabicToKanji(StringPiece input_num,
+                               const DecimalStringInfo &info,
+                               std::vector<NumberString> *output) {
   DCHECK(output);
   const char *const kNumZero = "零";
   const int kDigitsInBigRank = 4;
 
-  if (!IsDecimalInteger(input_num)) {
+  if (!info.is_decimal_integer) {
     return false;
   }
 
@@ -346,9 +379,17 @@ const NumberStringVariation kNumDigitsVariations[] = {
 
 bool NumberUtil::ArabicToSeparatedArabic(
     StringPiece input_num, std::vector<NumberString> *output) {
+  DecimalStringInfo info;
+  ParseDecimalString(input_num, &info);
+  return ArabicToSeparatedArabic(input_num, info, output);
+}
+
+bool NumberUtil::ArabicToSeparatedArabic(
+    StringPiece input_num, const DecimalStringInfo &info,
+    std::vector<NumberString> *output) {
   DCHECK(output);
 
-  if (!IsDecimalNumber(input_num)) {
+  if (!info.is_decimal_number) {
     return false;
   }
 
@@ -415,9 +456,17 @@ const NumberStringVariation kSingleDigitsVariations[] = {
 
 bool NumberUtil::ArabicToWideArabic(
     StringPiece input_num, std::vector<NumberString> *output) {
+  DecimalStringInfo info;
+  ParseDecimalString(input_num, &info);
+  return ArabicToWideArabic(input_num, info, output);
+}
+
+bool NumberUtil::ArabicToWideArabic(
+    StringPiece input_num, const DecimalStringInfo &info,
+    std::vector<NumberString> *output) {
   DCHECK(output);
 
-  if (!IsDecimalInteger(input_num)) {
+  if (!info.is_decimal_integer) {
     return false;
   }
 
@@ -453,9 +502,17 @@ const NumberStringVariation kSpecialNumericVariations[] = {
 
 bool NumberUtil::ArabicToOtherForms(
     StringPiece input_num, std::vector<NumberString> *output) {
+  DecimalStringInfo info;
+  ParseDecimalString(input_num, &info);
+  return ArabicToOtherForms(input_num, info, output);
+}
+
+bool NumberUtil::ArabicToOtherForms(
+    StringPiece input_num, const DecimalStringInfo &info,
+    std::vector<NumberString> *output) {
   DCHECK(output);
 
-  if (!IsDecimalInteger(input_num)) {
+  if (!info.is_decimal_integer) {
     return false;
   }
 
@@ -476,10 +533,10 @@ bool NumberUtil::ArabicToOtherForms(
   }
 
   // Following conversions require uint64 number.
-  uint64 n;
-  if (!SafeStrToUInt64(input_num, &n)) {
+  if (!info.fits_in_uint64) {
     return converted;
   }
+  const uint64 n = info.value;
 
   // Special forms
   for (size_t i = 0; i < arraysize(kSpecialNumericVariations); ++i) {
@@ -505,16 +562,20 @@ const int kMaxInt64Size = 24;
 
 bool NumberUtil::ArabicToOtherRadixes(
     StringPiece input_num, std::vector<NumberString> *output) {
-  DCHECK(output);
+  DecimalStringInfo info;
+  ParseDecimalString(input_num, &info);
+  return ArabicToOtherRadixes(input_num, info, output);
+}
 
-  if (!IsDecimalInteger(input_num)) {
-    return false;
-  }
+bool NumberUtil::ArabicToOtherRadixes(
+    StringPiece input_num, const DecimalStringInfo &info,
+    std::vector<NumberString> *output) {
+  DCHECK(output);
 
-  uint64 n;
-  if (!SafeStrToUInt64(input_num, &n)) {
+  if (!info.fits_in_uint64) {
     return false;
   }
+  const uint64 n = info.value;
 
   // Hexadecimal
   if (n > 9) {
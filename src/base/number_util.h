@@ -142,6 +142,39 @@ class NumberUtil {
   static bool ArabicToOtherRadixes(StringPiece input_num,
                                    std::vector<NumberString> *output);
 
+  // Properties of a decimal-number string computed in one scan, so that
+  // several of the converters above can run on the same input without
+  // each re-validating and re-parsing it (e.g. NumberRewriter fans one
+  // candidate out to every style).  Fill it with ParseDecimalString()
+  // and pass it to the overloads below.
+  struct DecimalStringInfo {
+    bool is_decimal_integer;  // consists of ASCII digits only
+    bool is_decimal_number;   // digits with at most one decimal point
+    bool fits_in_uint64;      // |value| holds the parsed integer
+    uint64 value;
+  };
+
+  // Scans |input| once and fills |info|.
+  static void ParseDecimalString(StringPiece input, DecimalStringInfo *info);
+
+  // Overloads of the five converters above taking the precomputed
+  // properties; |info| must have been filled from |input_num|.
+  static bool ArabicToKanji(StringPiece input_num,
+                            const DecimalStringInfo &info,
+                            std::vector<NumberString> *output);
+  static bool ArabicToSeparatedArabic(StringPiece input_num,
+                                      const DecimalStringInfo &info,
+                                      std::vector<NumberString> *output);
+  static bool ArabicToWideArabic(StringPiece input_num,
+                                 const DecimalStringInfo &info,
+                                 std::vector<NumberString> *output);
+  static bool ArabicToOtherForms(StringPiece input_num,
+                                 const DecimalStringInfo &info,
+                                 std::vector<NumberString> *output);
+  static bool ArabicToOtherRadixes(StringPiece input_num,
+                                   const DecimalStringInfo &info,
+                                   std::vector<NumberString> *output);
+
   // Converts the string to a 32-/64-bit signed/unsigned int.  Returns true if
   // success or false if the string is in the wrong format.
   static bool SafeStrToInt16(StringPiece str, int16 *value);
@@ -554,6 +554,60 @@ TEST(NumberUtilTest, IsDecimalInteger) {
   EXPECT_FALSE(NumberUtil::IsDecimalInteger("グーグル"));
 }
 
+TEST(NumberUtilTest, ParseDecimalString) {
+  NumberUtil::DecimalStringInfo info;
+
+  NumberUtil::ParseDecimalString("", &info);
+  EXPECT_FALSE(info.is_decimal_integer);
+  EXPECT_TRUE(info.is_decimal_number);
+  EXPECT_FALSE(info.fits_in_uint64);
+
+  NumberUtil::ParseDecimalString("0", &info);
+  EXPECT_TRUE(info.is_decimal_integer);
+  EXPECT_TRUE(info.is_decimal_number);
+  EXPECT_TRUE(info.fits_in_uint64);
+  EXPECT_EQ(0, info.value);
+
+  NumberUtil::ParseDecimalString("01234567890123456789", &info);
+  EXPECT_TRUE(info.is_decimal_integer);
+  EXPECT_TRUE(info.is_decimal_number);
+  EXPECT_TRUE(info.fits_in_uint64);
+  EXPECT_EQ(1234567890123456789, info.value);
+
+  // Maximum uint64 value and one above it.
+  NumberUtil::ParseDecimalString("18446744073709551615", &info);
+  EXPECT_TRUE(info.is_decimal_integer);
+  EXPECT_TRUE(info.fits_in_uint64);
+  EXPECT_EQ(18446744073709551615ull, info.value);
+
+  NumberUtil::ParseDecimalString("18446744073709551616", &info);
+  EXPECT_TRUE(info.is_decimal_integer);
+  EXPECT_FALSE(info.fits_in_uint64);
+
+  // Decimal numbers are not integers; trailing points are accepted.
+  NumberUtil::ParseDecimalString("123.456", &info);
+  EXPECT_FALSE(info.is_decimal_integer);
+  EXPECT_TRUE(info.is_decimal_number);
+  EXPECT_FALSE(info.fits_in_uint64);
+
+  NumberUtil::ParseDecimalString("123456.", &info);
+  EXPECT_FALSE(info.is_decimal_integer);
+  EXPECT_TRUE(info.is_decimal_number);
+
+  NumberUtil::ParseDecimalString("1.2.3", &info);
+  EXPECT_FALSE(info.is_decimal_integer);
+  EXPECT_FALSE(info.is_decimal_number);
+
+  NumberUtil::ParseDecimalString("abc", &info);
+  EXPECT_FALSE(info.is_decimal_integer);
+  EXPECT_FALSE(info.is_decimal_number);
+  EXPECT_FALSE(info.fits_in_uint64);
+
+  NumberUtil::ParseDecimalString("１０", &info);
+  EXPECT_FALSE(info.is_decimal_integer);
+  EXPECT_FALSE(info.is_decimal_number);
+}
+
 TEST(NumberUtilTest, KanjiNumberToArabicNumber) {
   const char *inputs[] = {"十", "百", "千", "万", "億", "兆", "京"};
   const char *expects[] = {"10", "100", "1000", "10000", "100000000",
@@ -47,6 +47,7 @@
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/singleton.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
 #include "base/util.h"
 #ifdef OS_WIN
@@ -71,6 +72,14 @@ string CreateProcessMutexFileName(const char *name) {
 
   return FileUtil::JoinPath(SystemUtil::GetUserProfileDirectory(), basename);
 }
+
+#if !defined(MOZC_USE_PEPPER_FILE_IO)
+// Lock acquisitions slower than this are logged as warnings.  The lock
+// file lives in the user profile directory, which can be on a
+// networked file system where each open/lock round trip costs
+// milliseconds and serializes tool launches.
+const int64 kSlowLockThresholdMsec = 50;
+#endif  // !MOZC_USE_PEPPER_FILE_IO
 }  // namespace
 
 bool ProcessMutex::Lock() {
@@ -106,10 +115,17 @@ bool ProcessMutex::LockAndWrite(const string &message) {
                                           &serucity_attributes)) {
     return false;
   }
+  Stopwatch stopwatch = Stopwatch::StartNew();
   handle_.reset(::CreateFileW(
       wfilename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &serucity_attributes,
       CREATE_ALWAYS, kAttribute, NULL));
   ::LocalFree(serucity_attributes.lpSecurityDescriptor);
+  const int64 elapsed_msec = stopwatch.GetElapsedMilliseconds();
+  VLOG(1) << "Locking " << filename_ << " took " << elapsed_msec << " msec";
+  if (elapsed_msec >= kSlowLockThresholdMsec) {
+    LOG(WARNING) << "Slow lock acquisition for " << filename_ << ": "
+                 << elapsed_msec << " msec";
+  }
 
   locked_ = (handle_.get() != NULL);
 
@@ -300,8 +316,23 @@ ProcessMutex::~ProcessMutex() {
 }
 
 bool ProcessMutex::LockAndWrite(const string &message) {
+  if (locked_) {
+    // The lock state is cached here; re-probing an already-held mutex
+    // must not touch the lock file at all.
+    VLOG(1) << filename_ << " is already locked";
+    return false;
+  }
+
+  Stopwatch stopwatch = Stopwatch::StartNew();
   int fd = -1;
-  if (!Singleton<FileLockManager>::get()->Lock(filename_, &fd)) {
+  const bool acquired = Singleton<FileLockManager>::get()->Lock(filename_, &fd);
+  const int64 elapsed_msec = stopwatch.GetElapsedMilliseconds();
+  VLOG(1) << "Locking " << filename_ << " took " << elapsed_msec << " msec";
+  if (elapsed_msec >= kSlowLockThresholdMsec) {
+    LOG(WARNING) << "Slow lock acquisition for " << filename_ << ": "
+                 << elapsed_msec << " msec (networked profile directory?)";
+  }
+  if (!acquired) {
     VLOG(1) << filename_ << " is already locked";
     return false;
   }
@@ -146,7 +146,17 @@ bool IsElevatedByUAC(const HANDLE hToken) {
 #endif   // OS_WIN
 }  // namespace
 
-RunLevel::RunLevelType RunLevel::GetRunLevel(RunLevel::RequestType type) {
+namespace {
+
+#ifndef OS_WIN
+// Cached results of GetRunLevel(), one per RequestType, or -1 when not
+// computed yet.  Plain ints without a mutex because GetRunLevel() runs
+// before InitMozc(); the worst case of a race is a duplicated
+// computation of the same value.
+int g_run_level_cache[RunLevel::REQUEST_TYPE_SIZE] = {-1, -1, -1};
+#endif  // !OS_WIN
+
+RunLevel::RunLevelType GetRunLevelImpl(RunLevel::RequestType type) {
 #ifdef OS_WIN
   bool is_service_process = false;
   if (!WinUtil::IsServiceProcess(&is_service_process)) {
@@ -168,7 +178,7 @@ RunLevel::RunLevelType RunLevel::GetRunLevel(RunLevel::RequestType type) {
   ScopedHandle process_token(hProcessToken);
 
   // Opt out of elevated process.
-  if (CLIENT == type &&
+  if (RunLevel::CLIENT == type &&
       GetElevatedProcessDisabled() &&
       mozc::IsElevatedByUAC(process_token.get())) {
     return RunLevel::DENY;
@@ -197,11 +207,12 @@ RunLevel::RunLevelType RunLevel::GetRunLevel(RunLevel::RequestType type) {
   }
 
   // Check whether the server/renderer is running inside sandbox.
-  if (type == SERVER || type == RENDERER) {
+  if (type == RunLevel::SERVER || type == RunLevel::RENDERER) {
     // Restricted token must be created by sandbox.
     // Server is launched with NON_ADMIN so that it can use SSL access.
     // This is why it doesn't have restricted token. b/5502343
-    if (type != SERVER && !::IsTokenRestricted(process_token.get())) {
+    if (type != RunLevel::SERVER &&
+        !::IsTokenRestricted(process_token.get())) {
       return RunLevel::DENY;
     }
 
@@ -255,7 +266,7 @@ RunLevel::RunLevelType RunLevel::GetRunLevel(RunLevel::RequestType type) {
   // All DENY checks are passed.
 
   // Check whether the server/renderer is running as RunAs.
-  if (type == SERVER || type == RENDERER) {
+  if (type == RunLevel::SERVER || type == RunLevel::RENDERER) {
     // It's ok to do this check after RevertToSelf, as it's a process token
     // and also its handle was opened before.
     if (IsDifferentUser(process_token.get())) {
@@ -268,7 +279,7 @@ RunLevel::RunLevelType RunLevel::GetRunLevel(RunLevel::RequestType type) {
   return RunLevel::NORMAL;
 
 #else  // OS_WIN
-  if (type == SERVER || type == RENDERER) {
+  if (type == RunLevel::SERVER || type == RunLevel::RENDERER) {
     if (::geteuid() == 0) {
       // This process is started by root, or the executable is setuid to root.
 
@@ -300,6 +311,35 @@ RunLevel::RunLevelType RunLevel::GetRunLevel(RunLevel::RequestType type) {
 #endif  // OS_WIN
 }
 
+}  // namespace
+
+RunLevel::RunLevelType RunLevel::GetRunLevel(RunLevel::RequestType type) {
+#ifdef OS_WIN
+  // The result can depend on the calling thread's impersonation token,
+  // so it is recomputed on every call on Windows.
+  return GetRunLevelImpl(type);
+#else  // OS_WIN
+  if (type < 0 || type >= RunLevel::REQUEST_TYPE_SIZE) {
+    return RunLevel::DENY;
+  }
+  // The run level depends only on the process credentials, which do
+  // not change spontaneously, so the first result is reused for the
+  // lifetime of the process; see InvalidateRunLevelCache().
+  if (g_run_level_cache[type] < 0) {
+    g_run_level_cache[type] = GetRunLevelImpl(type);
+  }
+  return static_cast<RunLevel::RunLevelType>(g_run_level_cache[type]);
+#endif  // OS_WIN
+}
+
+void RunLevel::InvalidateRunLevelCache() {
+#ifndef OS_WIN
+  for (size_t i = 0; i < RunLevel::REQUEST_TYPE_SIZE; ++i) {
+    g_run_level_cache[i] = -1;
+  }
+#endif  // !OS_WIN
+}
+
 bool RunLevel::IsProcessInJob() {
 #ifdef OS_WIN
   // Check to see if we're in a job where
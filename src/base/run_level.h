@@ -63,6 +63,13 @@ class RunLevel {
     return (GetRunLevel(RunLevel::CLIENT) <= RunLevel::RESTRICTED);
   }
 
+  // Clear the cached results of GetRunLevel().  On Linux and Mac the
+  // run level depends only on the process credentials, so the first
+  // result is reused for the lifetime of the process; call this if the
+  // effective user of the process has been changed on purpose.  No-op
+  // on Windows, where the result is never cached.
+  static void InvalidateRunLevelCache();
+
   // return true if the current process is in other JOB.
   // returns always false on Linux/Mac
   static bool IsProcessInJob();
@@ -29,10 +29,12 @@
 
 #include "base/scheduler.h"
 
+#include <algorithm>
 #include <cstdlib>
-#include <functional>
 #include <map>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include "base/clock.h"
 #include "base/logging.h"
@@ -46,252 +48,270 @@
 namespace mozc {
 namespace {
 
-class TimerThread final : public Thread {
- public:
-  TimerThread(std::function<void()> callback,
-              uint32 due_time,
-              uint32 interval)
-      : callback_(callback),
-        due_time_(due_time),
-        interval_(interval) {
-    CHECK(due_time_ != 0 || interval_ != 0)
-        << "Either of due_time or interval must be non 0.";
-  }
+// Upper bound of the per-job coalescing window.  A job may fire up to
+// this much (or a tenth of its interval, whichever is smaller) early
+// so that jobs whose deadlines fall close together share one wakeup.
+const uint32 kMaxCoalesceWindowMSec = 1000;
 
-  ~TimerThread() override {
-    SignalQuit();
-    Join();
-  }
+// The user is considered idle when no activity has been reported for
+// this long; PRIORITY_IDLE jobs wait for this state.
+const uint32 kUserIdleThresholdMSec = 5 * 1000;
 
-  void Run() override {
-    if (event_.Wait(due_time_)) {
-      VLOG(1) << "Received notification event";
-      return;
-    }
-
-    VLOG(2) << "call TimerCallback()";
-    callback_();
+// The timer thread re-scans the job list at least this often as a
+// backstop; one wakeup per minute is negligible for power.
+const int kMaxWaitMSec = 60 * 1000;
 
-    if (interval_ == 0) {
-      VLOG(2) << "Run() end";
-      return;
-    }
-
-    while (true) {
-      if (event_.Wait(interval_)) {
-        VLOG(1) << "Received notification event";
-        return;
-      }
-      VLOG(2) << "call TimerCallback()";
-      callback_();
-    }
-  }
-
- private:
-  void SignalQuit() {
-    const bool result = event_.Notify();
-    DCHECK(result);
-  }
-
-  std::function<void()> callback_;
-
-  // The amount of time to elapse before the timer is to be set to the
-  // signaled state for the first time, in milliseconds.
-  uint32 due_time_;
-
-  // The period of the timer, in milliseconds. If this is zero, the
-  // timer is one-shot timer. If this is greater than zero, the timer
-  // is periodic.
-  uint32 interval_;
-
-  UnnamedEvent event_;
+uint64 NowMSec() {
+  const uint64 frequency = Clock::GetFrequency();
+  const uint64 ticks = Clock::GetTicks();
+  return (ticks / frequency) * 1000 + (ticks % frequency) * 1000 / frequency;
+}
 
-  DISALLOW_COPY_AND_ASSIGN(TimerThread);
-};
+class SchedulerImpl;
 
-class QueueTimer final {
+// Runs one firing of a job's callback so that a slow or blocking
+// callback does not delay the timer thread or the other jobs.
+class CallbackRunner final : public Thread {
  public:
-  QueueTimer(std::function<void()> callback,
-             uint32 due_time,
-             uint32 period)
-      : timer_thread_(callback, due_time, period) {
+  CallbackRunner(SchedulerImpl *scheduler, const string &job_name)
+      : scheduler_(scheduler), job_name_(job_name) {
+    SetJoinable(true);
   }
 
-  void Start() {
-    timer_thread_.Start("QueueTimer");
+  ~CallbackRunner() override {
+    Join();
   }
 
+  void Run() override;
+
  private:
-  TimerThread timer_thread_;
+  SchedulerImpl *scheduler_;
+  const string job_name_;
 
-  DISALLOW_COPY_AND_ASSIGN(QueueTimer);
+  DISALLOW_COPY_AND_ASSIGN(CallbackRunner);
 };
 
 class Job {
  public:
-  explicit Job(const Scheduler::JobSetting &setting) :
-      setting_(setting),
-      skip_count_(0),
-      backoff_count_(0),
-      timer_(NULL),
-      running_(false) {}
+  explicit Job(const Scheduler::JobSetting &setting)
+      : setting_(setting),
+        backoff_count_(0),
+        due_msec_(0),
+        running_(false) {}
 
   ~Job() {
-    set_timer(NULL);
-  }
-
-  const Scheduler::JobSetting setting() const {
-    return setting_;
+    // Joins a possibly running callback before the members go away.
+    runner_.reset();
   }
 
-  void set_skip_count(uint32 skip_count) {
-    skip_count_ = skip_count;
-  }
-
-  uint32 skip_count() const {
-    return skip_count_;
-  }
+  const Scheduler::JobSetting &setting() const { return setting_; }
 
   void set_backoff_count(uint32 backoff_count) {
     backoff_count_ = backoff_count;
   }
+  uint32 backoff_count() const { return backoff_count_; }
 
-  uint32 backoff_count() const {
-    return backoff_count_;
-  }
-
-  void set_timer(QueueTimer *timer) {
-    if (timer_ != NULL) {
-      delete timer_;
-    }
-    timer_ = timer;
-  }
-
-  const QueueTimer *timer() const {
-    return timer_;
-  }
-
-  QueueTimer *mutable_timer() {
-    return timer_;
-  }
+  void set_due_msec(uint64 due_msec) { due_msec_ = due_msec; }
+  uint64 due_msec() const { return due_msec_; }
 
-  void set_running(bool running) {
-    running_ = running;
-  }
+  void set_running(bool running) { running_ = running; }
+  bool running() const { return running_; }
 
-  bool running() const {
-    return running_;
+  void StartRunner(CallbackRunner *runner) {
+    // The previous firing has finished (|running_| is false), so this
+    // joins an already exited thread at worst.
+    runner_.reset(runner);
+    runner_->Start("SchedulerCallback");
   }
 
  private:
-  Scheduler::JobSetting setting_;
-  uint32 skip_count_;
+  const Scheduler::JobSetting setting_;
   uint32 backoff_count_;
-  QueueTimer *timer_;
+  // Absolute NowMSec() time of the next firing, ignoring deferral.
+  uint64 due_msec_;
   bool running_;
+  std::unique_ptr<CallbackRunner> runner_;
 
-  // TODO(hsumita): Use DISALLOW_COPY_AND_ASSIGN(Job).
+  DISALLOW_COPY_AND_ASSIGN(Job);
 };
 
+// All jobs share one timer thread.  The thread sleeps until the
+// earliest effective deadline, fires every job whose deadline falls
+// within its coalescing window, and hands each callback to a
+// CallbackRunner thread.
 class SchedulerImpl : public Scheduler::SchedulerInterface {
  public:
-  SchedulerImpl() {
+  SchedulerImpl()
+      : timer_thread_(this),
+        timer_started_(false),
+        quit_(false),
+        last_activity_msec_(0) {
     Util::SetRandomSeed(static_cast<uint32>(Clock::GetTime()));
   }
 
-  virtual ~SchedulerImpl() {
+  ~SchedulerImpl() override {
     RemoveAllJobs();
+    {
+      scoped_lock l(&mutex_);
+      quit_ = true;
+    }
+    event_.Notify();
+    if (timer_started_) {
+      timer_thread_.Join();
+    }
   }
 
-  virtual void RemoveAllJobs() {
-    scoped_lock l(&mutex_);
-    jobs_.clear();
-  }
-
-  void ValidateSetting(const Scheduler::JobSetting &job_setting) const {
-    DCHECK_GT(job_setting.name().size(), 0);
-    DCHECK_NE(0, job_setting.default_interval());
-    DCHECK_NE(0, job_setting.max_interval());
-    // do not use DCHECK_NE as a type checker raises an error.
-    DCHECK(job_setting.callback() != NULL);
+  bool AddJob(const Scheduler::JobSetting &job_setting) override {
+    std::unique_ptr<Job> job(new Job(job_setting));
+    {
+      scoped_lock l(&mutex_);
+      ValidateSetting(job_setting);
+      if (jobs_.find(job_setting.name()) != jobs_.end()) {
+        LOG(WARNING) << "Job " << job_setting.name()
+                     << " is already registered";
+        return false;
+      }
+      job->set_due_msec(NowMSec() + CalcDelay(job_setting));
+      jobs_[job_setting.name()] = std::move(job);
+      if (!timer_started_) {
+        timer_thread_.Start("SchedulerTimer");
+        timer_started_ = true;
+      }
+    }
+    event_.Notify();
+    return true;
   }
 
-  virtual bool AddJob(const Scheduler::JobSetting &job_setting) {
-    scoped_lock l(&mutex_);
-
-    ValidateSetting(job_setting);
-    if (HasJob(job_setting.name())) {
-      LOG(WARNING) << "Job " << job_setting.name() << " is already registered";
-      return false;
+  bool RemoveJob(const string &name) override {
+    std::unique_ptr<Job> job;
+    {
+      scoped_lock l(&mutex_);
+      std::map<string, std::unique_ptr<Job> >::iterator it = jobs_.find(name);
+      if (it == jobs_.end()) {
+        LOG(WARNING) << "Job " << name << " is not registered";
+        return false;
+      }
+      job = std::move(it->second);
+      jobs_.erase(it);
     }
+    // |job| is destroyed here, outside the lock: its destructor waits
+    // for a running callback, which needs |mutex_| to finish.
+    return true;
+  }
 
-    std::pair<std::map<string, Job>::iterator, bool> insert_result =
-        jobs_.insert(std::make_pair(job_setting.name(), Job(job_setting)));
-    if (!insert_result.second) {
-      LOG(ERROR) << "insert failed";
-      return false;
+  void RemoveAllJobs() override {
+    std::map<string, std::unique_ptr<Job> > jobs;
+    {
+      scoped_lock l(&mutex_);
+      jobs.swap(jobs_);
     }
-    Job *job = &insert_result.first->second;
-    DCHECK(job);
-
-    const uint32 delay = CalcDelay(job_setting);
-    // DON'T copy job instance after set_timer() not to delete timer twice.
-    // TODO(hsumita): Make Job class uncopiable.
-    job->set_timer(new QueueTimer(std::bind(TimerCallback, job), delay,
-                                  job_setting.default_interval()));
-    if (job->timer() == NULL) {
-      LOG(ERROR) << "failed to create QueueTimer";
-      return false;
-    }
-    job->mutable_timer()->Start();
-    return true;
+    // Destroyed outside the lock; see RemoveJob().
   }
 
-  virtual bool RemoveJob(const string &name) {
+  bool HasJob(const string &name) const override {
     scoped_lock l(&mutex_);
-    if (!HasJob(name)) {
-      LOG(WARNING) << "Job " << name << " is not registered";
-      return false;
-    }
-    return (jobs_.erase(name) != 0);
+    return jobs_.find(name) != jobs_.end();
   }
 
-  virtual bool HasJob(const string &name) const {
-    return (jobs_.find(name) != jobs_.end());
+  void NotifyUserActivity() override {
+    scoped_lock l(&mutex_);
+    last_activity_msec_ = NowMSec();
   }
 
- private:
-  static void TimerCallback(void *param) {
-    Job *job = reinterpret_cast<Job *>(param);
-    DCHECK(job);
-    if (job->running()) {
-      return;
+  // Called on the timer thread.
+  void TimerLoop() {
+    while (true) {
+      int wait_msec = kMaxWaitMSec;
+      std::vector<Job *> due_jobs;
+      {
+        scoped_lock l(&mutex_);
+        if (quit_) {
+          return;
+        }
+        const uint64 now = NowMSec();
+        uint64 earliest = kuint64max;
+        for (std::map<string, std::unique_ptr<Job> >::iterator it =
+                 jobs_.begin(); it != jobs_.end(); ++it) {
+          Job *job = it->second.get();
+          if (job->running()) {
+            continue;  // rechecked when the callback finishes
+          }
+          const uint64 due = EffectiveDueMSec(*job);
+          if (due <= now + CoalesceWindowMSec(job->setting())) {
+            job->set_running(true);
+            due_jobs.push_back(job);
+          } else {
+            earliest = std::min(earliest, due);
+          }
+        }
+        if (earliest != kuint64max) {
+          wait_msec = static_cast<int>(std::min<uint64>(
+              earliest - now, kMaxWaitMSec));
+        }
+        for (size_t i = 0; i < due_jobs.size(); ++i) {
+          due_jobs[i]->StartRunner(
+              new CallbackRunner(this, due_jobs[i]->setting().name()));
+        }
+      }
+      event_.Wait(wait_msec);
     }
-    if (job->skip_count()) {
-      job->set_skip_count(job->skip_count() - 1);
-      VLOG(3) << "Backoff = " << job->backoff_count()
-              << " skip_count = " << job->skip_count();
-      return;
+  }
+
+  // Called on a CallbackRunner thread.
+  void RunJob(const string &job_name) {
+    Scheduler::JobSetting::CallbackFunc callback = NULL;
+    void *data = NULL;
+    {
+      scoped_lock l(&mutex_);
+      const Job *job = FindJob(job_name);
+      if (job == NULL) {
+        return;
+      }
+      callback = job->setting().callback();
+      data = job->setting().data();
     }
-    job->set_running(true);
-    Scheduler::JobSetting::CallbackFunc callback = job->setting().callback();
     DCHECK(callback != NULL);
-    const bool success = callback(job->setting().data());
-    job->set_running(false);
-    if (success) {
-      job->set_backoff_count(0);
-    } else {
-      const uint32 new_backoff_count = (job->backoff_count() == 0) ?
-          1 : job->backoff_count() * 2;
-      if (new_backoff_count * job->setting().default_interval()
-          < job->setting().max_interval()) {
-        job->set_backoff_count(new_backoff_count);
+    const bool success = callback(data);
+    {
+      scoped_lock l(&mutex_);
+      Job *job = FindJob(job_name);
+      if (job == NULL) {
+        return;  // removed while the callback was running
+      }
+      if (success) {
+        job->set_backoff_count(0);
+      } else {
+        const uint32 new_backoff_count = (job->backoff_count() == 0)
+            ? 1 : job->backoff_count() * 2;
+        if (new_backoff_count * job->setting().default_interval()
+            < job->setting().max_interval()) {
+          job->set_backoff_count(new_backoff_count);
+        }
       }
-      job->set_skip_count(job->backoff_count());
+      // On failure the next firing is delayed by the backed-off
+      // multiple of the interval, never exceeding max_interval.
+      job->set_due_msec(NowMSec() +
+                        (job->backoff_count() + 1) *
+                        job->setting().default_interval());
+      job->set_running(false);
     }
+    event_.Notify();  // the earliest deadline may have changed
   }
 
-  uint32 CalcDelay(const Scheduler::JobSetting &job_setting) {
+ private:
+  static void ValidateSetting(const Scheduler::JobSetting &job_setting) {
+    DCHECK_GT(job_setting.name().size(), 0);
+    DCHECK_NE(0, job_setting.default_interval());
+    DCHECK_NE(0, job_setting.max_interval());
+    // do not use DCHECK_NE as a type checker raises an error.
+    DCHECK(job_setting.callback() != NULL);
+  }
+
+  static uint32 CoalesceWindowMSec(const Scheduler::JobSetting &setting) {
+    return std::min(setting.default_interval() / 10, kMaxCoalesceWindowMSec);
+  }
+
+  static uint32 CalcDelay(const Scheduler::JobSetting &job_setting) {
     uint32 delay = job_setting.delay_start();
     if (job_setting.random_delay() != 0) {
       delay += Util::Random(job_setting.random_delay());
@@ -299,12 +319,59 @@ class SchedulerImpl : public Scheduler::SchedulerInterface {
     return delay;
   }
 
-  std::map<string, Job> jobs_;
-  Mutex mutex_;
+  // Must be called with |mutex_| held.
+  Job *FindJob(const string &name) {
+    std::map<string, std::unique_ptr<Job> >::iterator it = jobs_.find(name);
+    return (it == jobs_.end()) ? NULL : it->second.get();
+  }
+
+  // Must be called with |mutex_| held.  An idle-priority job whose
+  // deadline falls into a period of user activity is deferred until
+  // the user has been idle for kUserIdleThresholdMSec, but never past
+  // due + max_interval so that it runs even during sustained typing.
+  uint64 EffectiveDueMSec(const Job &job) const {
+    const uint64 due = job.due_msec();
+    if (job.setting().priority() != Scheduler::JobSetting::PRIORITY_IDLE ||
+        last_activity_msec_ == 0) {
+      return due;
+    }
+    const uint64 idle_at = last_activity_msec_ + kUserIdleThresholdMSec;
+    if (idle_at <= due) {
+      return due;
+    }
+    return std::min(idle_at, due + job.setting().max_interval());
+  }
+
+  class TimerThread final : public Thread {
+   public:
+    explicit TimerThread(SchedulerImpl *scheduler) : scheduler_(scheduler) {
+      SetJoinable(true);
+    }
+    void Run() override {
+      scheduler_->TimerLoop();
+    }
+
+   private:
+    SchedulerImpl *scheduler_;
+
+    DISALLOW_COPY_AND_ASSIGN(TimerThread);
+  };
+
+  TimerThread timer_thread_;
+  bool timer_started_;
+  bool quit_;
+  uint64 last_activity_msec_;
+  std::map<string, std::unique_ptr<Job> > jobs_;
+  mutable Mutex mutex_;
+  UnnamedEvent event_;
 
   DISALLOW_COPY_AND_ASSIGN(SchedulerImpl);
 };
 
+void CallbackRunner::Run() {
+  scheduler_->RunJob(job_name_);
+}
+
 Scheduler::SchedulerInterface *g_scheduler_handler = NULL;
 
 Scheduler::SchedulerInterface *GetSchedulerHandler() {
@@ -332,6 +399,10 @@ bool Scheduler::HasJob(const string &name) {
   return GetSchedulerHandler()->HasJob(name);
 }
 
+void Scheduler::NotifyUserActivity() {
+  GetSchedulerHandler()->NotifyUserActivity();
+}
+
 void Scheduler::SetSchedulerHandler(SchedulerInterface *handler) {
   g_scheduler_handler = handler;
 }
@@ -34,6 +34,12 @@
 //    - Interval will be doubled as long as callback returns false, but
 //      will not exceed max_interval.
 //  2. Randomised delayed start to reduce server traffic peak.
+//  3. All jobs share a single timer thread, and firings that fall close
+//    together are coalesced into one wakeup to reduce idle power use.
+//    Callbacks run on their own thread, so a slow job does not delay
+//    the other jobs.
+//  4. PRIORITY_IDLE jobs are deferred while the user is actively
+//    typing; see JobSetting::Priority and NotifyUserActivity().
 //
 // usage:
 // // start scheduled job
@@ -60,6 +66,16 @@ class Scheduler {
    public:
     typedef bool (*CallbackFunc)(void *);
 
+    enum Priority {
+      // Runs at the scheduled time.
+      PRIORITY_DEFAULT,
+      // Background maintenance work (stats upload, cache flush, ...):
+      // while the user is actively typing, the run is deferred until
+      // the process has been idle for a while, but never by more than
+      // max_interval past the scheduled time.
+      PRIORITY_IDLE,
+    };
+
     JobSetting(const string &name,
             uint32 default_interval,
             uint32 max_interval,
@@ -73,10 +89,19 @@ class Scheduler {
         delay_start_(delay_start),
         random_delay_(random_delay),
         callback_(callback),
-        data_(data) {}
+        data_(data),
+        priority_(PRIORITY_DEFAULT) {}
 
     ~JobSetting() {}
 
+    // Allows inline use:
+    //   Scheduler::AddJob(Scheduler::JobSetting(...).set_priority(
+    //       Scheduler::JobSetting::PRIORITY_IDLE));
+    JobSetting &set_priority(Priority priority) {
+      priority_ = priority;
+      return *this;
+    }
+
     string name() const { return name_; }
     uint32 default_interval() const { return default_interval_; }
     uint32 max_interval() const { return max_interval_; }
@@ -84,6 +109,7 @@ class Scheduler {
     uint32 random_delay() const { return random_delay_; }
     CallbackFunc callback() const { return callback_; }
     void *data() const { return data_; }
+    Priority priority() const { return priority_; }
 
    private:
     string name_;
@@ -93,6 +119,7 @@ class Scheduler {
     uint32 random_delay_;
     CallbackFunc callback_;
     void *data_;
+    Priority priority_;
   };
 
   // start scheduled job
@@ -109,6 +136,11 @@ class Scheduler {
   // returns true is the job has been registered.
   static bool HasJob(const string &name);
 
+  // Tells the scheduler that the user is actively using the IME
+  // (typically called per key event by the session layer).
+  // PRIORITY_IDLE jobs are deferred while activity is recent.
+  static void NotifyUserActivity();
+
   // This function is provided for test.
   // The behavior of scheduler can be customized by replacing an underlying
   // helper class inside this.
@@ -124,6 +156,8 @@ class Scheduler {
     virtual bool RemoveJob(const string &name) = 0;
     virtual void RemoveAllJobs() = 0;
     virtual bool HasJob(const string &name) const = 0;
+    // Default is a no-op so that test schedulers do not need to care.
+    virtual void NotifyUserActivity() {}
   };
 
  private:
@@ -256,6 +256,51 @@ TEST_F(SchedulerTest, DontBlockOtherJobs) {
   EXPECT_TRUE(info.quit_event.Notify());
 }
 
+TEST_F(SchedulerTest, IdleJobIsDeferredWhileTyping) {
+  class TestCallback {
+   public:
+    static bool Do(void *ptr) {
+      UnnamedEvent *event = static_cast<UnnamedEvent *>(ptr);
+      EXPECT_TRUE(event->Notify());
+      return false;
+    }
+  };
+
+  UnnamedEvent event;
+  ASSERT_TRUE(event.IsAvailable());
+  Scheduler::NotifyUserActivity();
+  // With a huge max_interval the deferral cap does not apply, so the
+  // job must wait for the idle threshold, which is well beyond
+  // |kMediumPeriod|.
+  ScopedJob job(Scheduler::JobSetting(
+      "Test", kShortPeriod, kTooLongTime, kImmediately, kNoRandomDelay,
+      &TestCallback::Do,
+      &event).set_priority(Scheduler::JobSetting::PRIORITY_IDLE));
+  EXPECT_FALSE(event.Wait(kMediumPeriod));
+}
+
+TEST_F(SchedulerTest, IdleJobDeferralIsCappedByMaxInterval) {
+  class TestCallback {
+   public:
+    static bool Do(void *ptr) {
+      UnnamedEvent *event = static_cast<UnnamedEvent *>(ptr);
+      EXPECT_TRUE(event->Notify());
+      return false;
+    }
+  };
+
+  UnnamedEvent event;
+  ASSERT_TRUE(event.IsAvailable());
+  Scheduler::NotifyUserActivity();
+  // max_interval bounds how far past its deadline an idle job can be
+  // deferred, so the job must fire even though the user looks active.
+  ScopedJob job(Scheduler::JobSetting(
+      "Test", kShortPeriod, kShortPeriod, kImmediately, kNoRandomDelay,
+      &TestCallback::Do,
+      &event).set_priority(Scheduler::JobSetting::PRIORITY_IDLE));
+  EXPECT_TRUE(event.Wait(kTimeout));
+}
+
 class NameCheckScheduler : public Scheduler::SchedulerInterface {
  public:
   explicit NameCheckScheduler(const string &expected_name)
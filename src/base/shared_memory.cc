@@ -0,0 +1,168 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/shared_memory.h"
+
+#if !defined(OS_WIN) && !defined(OS_ANDROID) && !defined(OS_NACL)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif  // !OS_WIN && !OS_ANDROID && !OS_NACL
+
+#include "base/logging.h"
+
+namespace mozc {
+
+SharedMemory::SharedMemory()
+    : data_(nullptr), size_(0), created_(false), fd_(-1) {}
+
+#if defined(OS_WIN) || defined(OS_ANDROID) || defined(OS_NACL)
+
+// TODO(team): Implement the Windows version with CreateFileMapping() when a
+// caller needs it.  On Android and NaCl each session runs in one process, so
+// there is nothing to share.
+bool SharedMemory::OpenOrCreate(const string &name, size_t size) {
+  LOG(ERROR) << "Shared memory is not supported on this platform";
+  return false;
+}
+
+void SharedMemory::MarkReady() {}
+
+void SharedMemory::Close() {}
+
+bool SharedMemory::Unlink(const string &name) {
+  return false;
+}
+
+#else  // OS_WIN || OS_ANDROID || OS_NACL
+
+namespace {
+
+// POSIX shared memory names must start with '/' and contain no other
+// slashes.  Prefix the caller's identifier so that unrelated users of the
+// namespace don't collide with us.
+string MakeSegmentName(const string &name) {
+  DCHECK_EQ(name.find('/'), string::npos) << name;
+  return "/mozc." + name;
+}
+
+}  // namespace
+
+bool SharedMemory::OpenOrCreate(const string &name, size_t size) {
+  Close();
+
+  if (size == 0) {
+    LOG(WARNING) << "Empty shared memory is requested: " << name;
+    return false;
+  }
+
+  const string segment_name = MakeSegmentName(name);
+  bool created = false;
+  int fd = ::shm_open(segment_name.c_str(), O_RDWR | O_CREAT | O_EXCL,
+                      S_IRUSR | S_IWUSR);
+  if (fd >= 0) {
+    created = true;
+    // Hold an exclusive lock while this process fills the segment; other
+    // openers block on the shared lock below until MarkReady() or Close()
+    // releases it.
+    if (::flock(fd, LOCK_EX) != 0 || ::ftruncate(fd, size) != 0) {
+      LOG(WARNING) << "Failed to initialize shared memory: " << segment_name;
+      ::close(fd);
+      ::shm_unlink(segment_name.c_str());
+      return false;
+    }
+  } else {
+    fd = ::shm_open(segment_name.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+      LOG(WARNING) << "shm_open() failed: " << segment_name;
+      return false;
+    }
+    // Wait until the creator has finished filling the segment.
+    if (::flock(fd, LOCK_SH) != 0) {
+      LOG(WARNING) << "flock() failed: " << segment_name;
+      ::close(fd);
+      return false;
+    }
+    ::flock(fd, LOCK_UN);
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != size) {
+      LOG(WARNING) << "Shared memory size mismatch: " << segment_name;
+      ::close(fd);
+      return false;
+    }
+  }
+
+  void *ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED) {
+    LOG(WARNING) << "mmap() failed: " << segment_name;
+    ::close(fd);
+    if (created) {
+      ::shm_unlink(segment_name.c_str());
+    }
+    return false;
+  }
+
+  data_ = reinterpret_cast<char *>(ptr);
+  size_ = size;
+  created_ = created;
+  fd_ = fd;
+  return true;
+}
+
+void SharedMemory::MarkReady() {
+  if (created_ && fd_ >= 0) {
+    ::flock(fd_, LOCK_UN);
+  }
+}
+
+void SharedMemory::Close() {
+  if (data_ != nullptr) {
+    ::munmap(data_, size_);
+  }
+  if (fd_ >= 0) {
+    // Closing the descriptor also releases the flock, so a creator that
+    // failed before MarkReady() doesn't block other processes forever.
+    ::close(fd_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  created_ = false;
+  fd_ = -1;
+}
+
+bool SharedMemory::Unlink(const string &name) {
+  return ::shm_unlink(MakeSegmentName(name).c_str()) == 0;
+}
+
+#endif  // OS_WIN || OS_ANDROID || OS_NACL
+
+}  // namespace mozc
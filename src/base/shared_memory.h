@@ -0,0 +1,108 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_SHARED_MEMORY_H_
+#define MOZC_BASE_SHARED_MEMORY_H_
+
+#include <string>
+
+#include "base/port.h"
+
+namespace mozc {
+
+// SharedMemory maps a named memory segment shared across processes, so that
+// data derived from read-only resources (e.g. dictionary rank directories)
+// can be built once by the first process and mapped by the others instead of
+// being rebuilt and duplicated in every process.
+//
+// The first process that opens a name creates the segment and is expected to
+// fill it; processes opening the same name afterwards block until the
+// creator calls MarkReady() (or closes the segment), and then observe the
+// filled contents.  The stored data must be position independent because the
+// segment may be mapped at a different address in each process.
+//
+// Usage:
+//   SharedMemory shm;
+//   if (shm.OpenOrCreate("some_unique_name", size)) {
+//     if (shm.created()) {
+//       ... fill shm.data() ...
+//       shm.MarkReady();
+//     }
+//     ... read shm.data() ...
+//   }
+//
+// On Windows, Android, and NaCl this class is not implemented;
+// OpenOrCreate() always fails there and callers should fall back to private
+// memory.
+class SharedMemory {
+ public:
+  SharedMemory();
+  ~SharedMemory() { Close(); }
+
+  // Opens the segment of the given name and size, creating it if it doesn't
+  // exist yet.  |name| is an identifier, not a file path, and must not
+  // contain '/'.  If the segment already exists, blocks until its creator
+  // calls MarkReady() or closes it.  Returns false on failure, e.g. when the
+  // existing segment has a different size (which typically means that it was
+  // left by an incompatible version; Unlink() and retry in that case).
+  bool OpenOrCreate(const string &name, size_t size);
+
+  // Declares that the creator has finished filling the segment, unblocking
+  // the other processes waiting in OpenOrCreate().  No-op unless this
+  // instance created the segment.
+  void MarkReady();
+
+  // Unmaps the segment.  The segment itself is kept in the system until
+  // Unlink() is called, even when no process has it open.
+  void Close();
+
+  // Removes the name from the system.  Existing mappings stay valid; new
+  // OpenOrCreate() calls with the name will create a fresh segment.
+  static bool Unlink(const string &name);
+
+  char *data() { return data_; }
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Returns true if OpenOrCreate() created the segment, i.e. this process is
+  // responsible for filling it and calling MarkReady().
+  bool created() const { return created_; }
+
+ private:
+  char *data_;
+  size_t size_;
+  bool created_;
+  int fd_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemory);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_SHARED_MEMORY_H_
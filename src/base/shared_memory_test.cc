@@ -0,0 +1,108 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/shared_memory.h"
+
+#include <cstring>
+#include <string>
+
+#include "base/port.h"
+#include "testing/base/public/gunit.h"
+
+// The class is not implemented on these platforms; see shared_memory.cc.
+#if !defined(OS_WIN) && !defined(OS_ANDROID) && !defined(OS_NACL)
+
+namespace mozc {
+namespace {
+
+TEST(SharedMemoryTest, CreateAndOpen) {
+  const string name = "shared_memory_test.create_and_open";
+  SharedMemory::Unlink(name);  // In case a previous run left the segment.
+
+  const char kTestData[] = "shared memory test data";
+  SharedMemory creator;
+  ASSERT_TRUE(creator.OpenOrCreate(name, sizeof(kTestData)));
+  EXPECT_TRUE(creator.created());
+  ASSERT_EQ(sizeof(kTestData), creator.size());
+  memcpy(creator.data(), kTestData, sizeof(kTestData));
+  creator.MarkReady();
+
+  {
+    SharedMemory opener;
+    ASSERT_TRUE(opener.OpenOrCreate(name, sizeof(kTestData)));
+    EXPECT_FALSE(opener.created());
+    ASSERT_EQ(sizeof(kTestData), opener.size());
+    EXPECT_EQ(0, memcmp(opener.data(), kTestData, sizeof(kTestData)));
+
+    // Both mappings observe a write through either of them.
+    opener.data()[0] = 'X';
+    EXPECT_EQ('X', creator.data()[0]);
+  }
+
+  EXPECT_TRUE(SharedMemory::Unlink(name));
+  EXPECT_FALSE(SharedMemory::Unlink(name));  // Already removed.
+}
+
+TEST(SharedMemoryTest, SizeMismatch) {
+  const string name = "shared_memory_test.size_mismatch";
+  SharedMemory::Unlink(name);
+
+  SharedMemory creator;
+  ASSERT_TRUE(creator.OpenOrCreate(name, 64));
+  creator.MarkReady();
+
+  // Opening an existing segment with a different size must fail.
+  SharedMemory opener;
+  EXPECT_FALSE(opener.OpenOrCreate(name, 128));
+
+  EXPECT_TRUE(SharedMemory::Unlink(name));
+}
+
+TEST(SharedMemoryTest, UnlinkAllowsRecreation) {
+  const string name = "shared_memory_test.recreation";
+  SharedMemory::Unlink(name);
+
+  SharedMemory shm1;
+  ASSERT_TRUE(shm1.OpenOrCreate(name, 16));
+  EXPECT_TRUE(shm1.created());
+  EXPECT_TRUE(SharedMemory::Unlink(name));
+
+  // The old mapping stays valid, and the name is free for a new segment.
+  shm1.data()[0] = 'a';
+  SharedMemory shm2;
+  ASSERT_TRUE(shm2.OpenOrCreate(name, 16));
+  EXPECT_TRUE(shm2.created());
+
+  EXPECT_TRUE(SharedMemory::Unlink(name));
+}
+
+}  // namespace
+}  // namespace mozc
+
+#endif  // !OS_WIN && !OS_ANDROID && !OS_NACL
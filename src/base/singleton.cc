@@ -35,6 +35,7 @@
 #include <cstdlib>
 #endif  // OS_WIN
 
+#include "base/logging.h"
 #include "base/mutex.h"
 
 namespace mozc {
@@ -86,4 +87,68 @@ void SingletonFinalizer::Finalize() {
   }
   g_finalizers_size = 0;
 }
+
+namespace {
+
+const size_t kMaxInstantiatorsSize = 256;
+size_t g_instantiators_size = 0;
+// Index of the first instantiator not yet run by WarmupAll().
+size_t g_instantiators_warmed_up = 0;
+SingletonWarmup::InstantiateFunc g_instantiators[kMaxInstantiatorsSize];
+
+bool g_warmup_done = false;
+bool g_warmup_in_progress = false;
+
+// Singletons constructed after warmup, waiting to be logged.  Entries
+// are the static function name strings from Singleton<T>::Init, so no
+// ownership is involved.
+const size_t kMaxLazyConstructionsSize = 64;
+size_t g_lazy_constructions_size = 0;
+const char *g_lazy_constructions[kMaxLazyConstructionsSize];
+
+}  // namespace
+
+void SingletonWarmup::AddInstantiator(InstantiateFunc func) {
+  // Like AddFinalizer() above, this is called from single-threaded
+  // contexts (static registrars and module initialization) and is not
+  // thread safe.
+  if (g_instantiators_size >= kMaxInstantiatorsSize) {
+    ExitWithError();
+  }
+  g_instantiators[g_instantiators_size++] = func;
+}
+
+void SingletonWarmup::ReportConstruction(const char *type_name) {
+  // Constructions during warmup are the point of the exercise; only
+  // record the ones that slipped past it.  No logging here: this runs
+  // inside Singleton<T>::Init and the logging singleton may be T (see
+  // the comment on ExitWithError() above for the recursion hazard).
+  if (!g_warmup_done || g_warmup_in_progress) {
+    return;
+  }
+  if (g_lazy_constructions_size >= kMaxLazyConstructionsSize) {
+    return;  // Drop on overflow; the first entries are the useful ones.
+  }
+  g_lazy_constructions[g_lazy_constructions_size++] = type_name;
+}
+
+void SingletonWarmup::WarmupAll() {
+  g_warmup_in_progress = true;
+  for (; g_instantiators_warmed_up < g_instantiators_size;
+       ++g_instantiators_warmed_up) {
+    (*g_instantiators[g_instantiators_warmed_up])();
+  }
+  g_warmup_in_progress = false;
+  g_warmup_done = true;
+}
+
+void SingletonWarmup::LogLazyConstructions() {
+  for (size_t i = 0; i < g_lazy_constructions_size; ++i) {
+    LOG(INFO) << "Singleton constructed after warmup: "
+              << g_lazy_constructions[i]
+              << " (consider registering it with SingletonWarmupRegistrar)";
+  }
+  g_lazy_constructions_size = 0;
+}
+
 }  // namespace mozc
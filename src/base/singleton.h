@@ -51,6 +51,41 @@ class SingletonFinalizer {
   static void Finalize();
 };
 
+// Explicit pre-initialization of singletons.  Singleton<T> constructs
+// lazily on the first get(), which on the server can fall inside a
+// keystroke.  Modules can declare their singletons for warmup (see
+// SingletonWarmupRegistrar below); SingletonWarmup::WarmupAll(),
+// called from server boot or the engine warmup stage, then constructs
+// them all before user traffic.  Any singleton still constructed after
+// warmup is recorded so its initialization can be moved to warmup too.
+class SingletonWarmup {
+ public:
+  typedef void (*InstantiateFunc)();
+
+  // Do not call these methods directly; use SingletonWarmupRegistrar.
+  static void AddInstantiator(InstantiateFunc func);
+  static void ReportConstruction(const char *type_name);
+
+  // Constructs every singleton registered so far.  Safe to call more
+  // than once; instantiators registered later are picked up by the next
+  // call.
+  static void WarmupAll();
+
+  // Writes one log line per singleton constructed after the last
+  // WarmupAll() and forgets them.  Must not be called from inside a
+  // singleton constructor (logging itself uses a singleton); a periodic
+  // task such as SessionHandler::Cleanup() is a good place.
+  static void LogLazyConstructions();
+};
+
+// The name of the enclosing function including template arguments; used
+// to identify T in Singleton<T>::Init without RTTI.
+#ifdef _MSC_VER
+#define MOZC_SINGLETON_FUNCTION_NAME __FUNCSIG__
+#else  // _MSC_VER
+#define MOZC_SINGLETON_FUNCTION_NAME __PRETTY_FUNCTION__
+#endif  // _MSC_VER
+
 // Thread-safe Singleton class.
 // Usage:
 //
@@ -67,6 +102,10 @@ class Singleton {
 
  private:
   static void Init() {
+    // Records the construction when it happens after warmup.  This must
+    // not log by itself: the logging singleton may be the one under
+    // construction here (see the deadlock note in singleton.cc).
+    SingletonWarmup::ReportConstruction(MOZC_SINGLETON_FUNCTION_NAME);
     SingletonFinalizer::AddFinalizer(&Singleton<T>::Delete);
     instance_ = new T;
   }
@@ -86,6 +125,30 @@ once_t Singleton<T>::once_ = MOZC_ONCE_INIT;
 
 template <typename T>
 T* Singleton<T>::instance_ = NULL;
+
+// Declares Singleton<T> for pre-initialization.  Define one at
+// namespace scope in the .cc file owning the singleton:
+//
+//   namespace {
+//   const SingletonWarmupRegistrar<CharacterFormManager> warmup_registrar;
+//   }  // namespace
+//
+// The registrar only appends a function pointer to a zero-initialized
+// array, so it is safe regardless of static initialization order, and
+// it has no destructor.
+template <typename T>
+class SingletonWarmupRegistrar {
+ public:
+  SingletonWarmupRegistrar() {
+    SingletonWarmup::AddInstantiator(&SingletonWarmupRegistrar<T>::Instantiate);
+  }
+
+ private:
+  static void Instantiate() {
+    Singleton<T>::get();
+  }
+};
+
 }  // namespace mozc
 
 #endif  // MOZC_BASE_SINGLETON_H_
@@ -70,6 +70,17 @@ class ThreadTest : public Thread {
  private:
   ThreadInstance *instance_;
 };
+
+static int g_warmup_counter = 0;
+
+class WarmupInstance {
+ public:
+  WarmupInstance() {
+    ++g_warmup_counter;
+  }
+};
+
+const SingletonWarmupRegistrar<WarmupInstance> g_warmup_registrar;
 }  // namespace
 
 // Cannot have a testcase for Singleton::SingletonFinalizer,
@@ -110,4 +121,16 @@ TEST(SingletonTest, ThreadTest) {
   EXPECT_EQ(test1.get(), test2.get());
   EXPECT_EQ(test2.get(), test3.get());
 }
+
+TEST(SingletonTest, WarmupConstructsRegisteredSingletons) {
+  EXPECT_EQ(0, g_warmup_counter);
+  SingletonWarmup::WarmupAll();
+  EXPECT_EQ(1, g_warmup_counter);
+  // A second warmup must not re-construct it.
+  SingletonWarmup::WarmupAll();
+  EXPECT_EQ(1, g_warmup_counter);
+  // Normal access returns the pre-constructed instance.
+  Singleton<WarmupInstance>::get();
+  EXPECT_EQ(1, g_warmup_counter);
+}
 }  // namespace mozc
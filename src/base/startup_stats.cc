@@ -0,0 +1,108 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/startup_stats.h"
+
+#include <algorithm>
+
+#include "base/clock.h"
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
+
+namespace mozc {
+namespace {
+
+// Enough for the per-phase granularity we record during boot; oldest
+// entries are overwritten if the buffer ever overflows.
+const size_t kRingBufferSize = 32;
+
+uint64 GetCurrentUSec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000000 + usec;
+}
+
+class PhaseRingBuffer {
+ public:
+  PhaseRingBuffer() : next_index_(0), recorded_(0) {}
+
+  void Record(const string &name, uint64 begin_usec, uint64 duration_usec) {
+    scoped_lock l(&mutex_);
+    StartupStats::Phase &phase = phases_[next_index_];
+    phase.name = name;
+    phase.begin_usec = begin_usec;
+    phase.duration_usec = duration_usec;
+    next_index_ = (next_index_ + 1) % kRingBufferSize;
+    ++recorded_;
+  }
+
+  void Get(std::vector<StartupStats::Phase> *phases) const {
+    DCHECK(phases);
+    phases->clear();
+    scoped_lock l(&mutex_);
+    const size_t size = std::min(recorded_, kRingBufferSize);
+    // |next_index_| points at the oldest entry once the buffer wrapped.
+    const size_t oldest = (recorded_ < kRingBufferSize) ? 0 : next_index_;
+    for (size_t i = 0; i < size; ++i) {
+      phases->push_back(phases_[(oldest + i) % kRingBufferSize]);
+    }
+  }
+
+ private:
+  mutable Mutex mutex_;
+  StartupStats::Phase phases_[kRingBufferSize];
+  size_t next_index_;
+  size_t recorded_;
+
+  DISALLOW_COPY_AND_ASSIGN(PhaseRingBuffer);
+};
+
+}  // namespace
+
+void StartupStats::RecordPhase(const string &name,
+                               uint64 begin_usec, uint64 duration_usec) {
+  Singleton<PhaseRingBuffer>::get()->Record(name, begin_usec, duration_usec);
+  VLOG(1) << "Startup phase " << name << ": " << duration_usec << " usec";
+}
+
+void StartupStats::GetPhases(std::vector<Phase> *phases) {
+  Singleton<PhaseRingBuffer>::get()->Get(phases);
+}
+
+ScopedStartupTimer::ScopedStartupTimer(const char *name)
+    : name_(name), begin_usec_(GetCurrentUSec()) {}
+
+ScopedStartupTimer::~ScopedStartupTimer() {
+  StartupStats::RecordPhase(name_, begin_usec_,
+                            GetCurrentUSec() - begin_usec_);
+}
+
+}  // namespace mozc
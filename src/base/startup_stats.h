@@ -0,0 +1,92 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_STARTUP_STATS_H_
+#define MOZC_BASE_STARTUP_STATS_H_
+
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+
+// StartupStats records the wall time spent in named startup phases
+// (dataset open, dictionary construction, IPC setup, ...) into a small
+// process-wide ring buffer.  The recorded phases can be retrieved later
+// to track boot-latency regressions; the server exposes them through
+// the GET_STARTUP_STATS command.
+//
+// Recording is cheap (two gettimeofday calls and a mutex acquisition
+// per phase) and the buffer is fixed-size, so the timers can stay
+// enabled in release builds.  All methods are thread-safe.
+class StartupStats {
+ public:
+  struct Phase {
+    string name;
+    // Microseconds since the epoch when the phase began.
+    uint64 begin_usec;
+    uint64 duration_usec;
+  };
+
+  static void RecordPhase(const string &name,
+                          uint64 begin_usec, uint64 duration_usec);
+
+  // Copies the recorded phases, oldest first.  When more phases were
+  // recorded than the ring buffer holds, the oldest ones are lost.
+  static void GetPhases(std::vector<Phase> *phases);
+
+ private:
+  StartupStats() {}
+  ~StartupStats() {}
+
+  DISALLOW_COPY_AND_ASSIGN(StartupStats);
+};
+
+// Measures the scope it lives in and records it under |name|.
+//
+//   {
+//     ScopedStartupTimer timer("Engine::Init");
+//     ...
+//   }  // recorded here
+class ScopedStartupTimer {
+ public:
+  explicit ScopedStartupTimer(const char *name);
+  ~ScopedStartupTimer();
+
+ private:
+  const char *name_;
+  uint64 begin_usec_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedStartupTimer);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_STARTUP_STATS_H_
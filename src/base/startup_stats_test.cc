@@ -0,0 +1,98 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/startup_stats.h"
+
+#include <memory>
+#include <vector>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+
+class StartupStatsTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    clock_mock_.reset(new ClockMock(1000, 0));
+    Clock::SetClockForUnitTest(clock_mock_.get());
+  }
+
+  void TearDown() override {
+    Clock::SetClockForUnitTest(nullptr);
+  }
+
+  std::unique_ptr<ClockMock> clock_mock_;
+};
+
+// StartupStats is process-wide, so this test only inspects the phases
+// appended after its own snapshot.
+TEST_F(StartupStatsTest, ScopedTimerRecordsPhase) {
+  std::vector<StartupStats::Phase> before;
+  StartupStats::GetPhases(&before);
+
+  {
+    ScopedStartupTimer timer("TestPhase");
+    clock_mock_->PutClockForward(1, 500000);  // 1.5 sec
+  }
+
+  std::vector<StartupStats::Phase> after;
+  StartupStats::GetPhases(&after);
+  ASSERT_EQ(before.size() + 1, after.size());
+
+  const StartupStats::Phase &phase = after.back();
+  EXPECT_EQ("TestPhase", phase.name);
+  EXPECT_EQ(1000 * 1000000ull, phase.begin_usec);
+  EXPECT_EQ(1500000ull, phase.duration_usec);
+}
+
+TEST_F(StartupStatsTest, PhasesAreOrderedOldestFirst) {
+  std::vector<StartupStats::Phase> before;
+  StartupStats::GetPhases(&before);
+
+  {
+    ScopedStartupTimer timer("First");
+    clock_mock_->PutClockForward(0, 100);
+  }
+  {
+    ScopedStartupTimer timer("Second");
+    clock_mock_->PutClockForward(0, 200);
+  }
+
+  std::vector<StartupStats::Phase> after;
+  StartupStats::GetPhases(&after);
+  ASSERT_EQ(before.size() + 2, after.size());
+  EXPECT_EQ("First", after[after.size() - 2].name);
+  EXPECT_EQ("Second", after[after.size() - 1].name);
+  EXPECT_LT(after[after.size() - 2].begin_usec,
+            after[after.size() - 1].begin_usec);
+}
+
+}  // namespace mozc
@@ -56,14 +56,14 @@ void Stopwatch::Reset() {
 
 void Stopwatch::Start() {
   if (state_ == STOPWATCH_STOPPED) {
-    start_timestamp_ = Clock::GetTicks();
+    start_timestamp_ = Clock::GetCheapTicks();
     state_ = STOPWATCH_RUNNING;
   }
 }
 
 void Stopwatch::Stop() {
   if (state_ == STOPWATCH_RUNNING) {
-    const int64 stop_timestamp = Clock::GetTicks();
+    const int64 stop_timestamp = Clock::GetCheapTicks();
     elapsed_timestamp_ += (stop_timestamp - start_timestamp_);
     start_timestamp_ = 0;
     state_ = STOPWATCH_STOPPED;
@@ -87,7 +87,7 @@ int64 Stopwatch::GetElapsedTicks() {
     return elapsed_timestamp_;
   }
 
-  const int64 current_timestamp = Clock::GetTicks();
+  const int64 current_timestamp = Clock::GetCheapTicks();
   elapsed_timestamp_ += (current_timestamp - start_timestamp_);
   start_timestamp_ = current_timestamp;
 
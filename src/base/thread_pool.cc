@@ -0,0 +1,168 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/thread_pool.h"
+
+#include <utility>
+
+#include "base/cpu_stats.h"
+#include "base/logging.h"
+#include "base/singleton.h"
+#include "base/thread.h"
+
+namespace mozc {
+namespace {
+
+// Backstop period for waits on the auto-reset events below.  An
+// UnnamedEvent stores at most one pending notification, so a burst of
+// notifications can leave some waiters unsignaled; the timeout makes
+// them re-check the queues instead of sleeping forever.
+const int kEventTimeoutMSec = 100;
+
+}  // namespace
+
+class ThreadPool::WorkerThread : public Thread {
+ public:
+  explicit WorkerThread(ThreadPool *pool) : pool_(pool) {
+    SetJoinable(true);
+  }
+
+  ~WorkerThread() override {
+    Join();
+  }
+
+  void Run() override {
+    std::function<void()> task;
+    while (pool_->NextTask(&task)) {
+      task();
+      // Release the closure's captured state before blocking on the
+      // next task.
+      task = nullptr;
+      pool_->OnTaskDone();
+    }
+  }
+
+ private:
+  ThreadPool *pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerThread);
+};
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : num_pending_(0), quit_(false) {
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  workers_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(new WorkerThread(this));
+    workers_.back()->Start("ThreadPoolWorker");
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+  {
+    scoped_lock l(&mutex_);
+    quit_ = true;
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    task_event_.Notify();
+  }
+  workers_.clear();  // joins every worker
+}
+
+ThreadPool *ThreadPool::GetDefault() {
+  // A trivial subclass gives Singleton the default constructor it needs.
+  class DefaultThreadPool : public ThreadPool {
+   public:
+    DefaultThreadPool() : ThreadPool(CPUStats().GetNumberOfProcessors()) {}
+  };
+  return Singleton<DefaultThreadPool>::get();
+}
+
+void ThreadPool::Schedule(std::function<void()> task, Priority priority) {
+  DCHECK(task);
+  DCHECK(priority == PRIORITY_HIGH || priority == PRIORITY_LOW);
+  {
+    scoped_lock l(&mutex_);
+    if (quit_) {
+      LOG(DFATAL) << "Schedule() called on a shut-down ThreadPool";
+      return;
+    }
+    queues_[priority].push(std::move(task));
+    ++num_pending_;
+  }
+  task_event_.Notify();
+}
+
+void ThreadPool::Wait() {
+  for (;;) {
+    {
+      scoped_lock l(&mutex_);
+      if (num_pending_ == 0) {
+        return;
+      }
+    }
+    idle_event_.Wait(kEventTimeoutMSec);
+  }
+}
+
+bool ThreadPool::NextTask(std::function<void()> *task) {
+  for (;;) {
+    {
+      scoped_lock l(&mutex_);
+      for (int i = 0; i < PRIORITY_SIZE; ++i) {
+        if (!queues_[i].empty()) {
+          *task = std::move(queues_[i].front());
+          queues_[i].pop();
+          return true;
+        }
+      }
+      if (quit_) {
+        return false;
+      }
+    }
+    task_event_.Wait(kEventTimeoutMSec);
+  }
+}
+
+void ThreadPool::OnTaskDone() {
+  bool idle = false;
+  {
+    scoped_lock l(&mutex_);
+    --num_pending_;
+    idle = (num_pending_ == 0);
+  }
+  if (idle) {
+    idle_event_.Notify();
+  }
+}
+
+}  // namespace mozc
@@ -0,0 +1,115 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_THREAD_POOL_H_
+#define MOZC_BASE_THREAD_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/unnamed_event.h"
+
+namespace mozc {
+
+// A fixed-size pool of worker threads.  Engine subsystems that need
+// parallelism should schedule tasks here instead of spawning their own
+// dedicated Thread subclasses, so that the process keeps a bounded number
+// of worker threads regardless of how many subsystems are active.
+//
+// Usage:
+//   ThreadPool::GetDefault()->Schedule([&] { ... });
+//   ...
+//   ThreadPool::GetDefault()->Wait();
+//
+// Tasks scheduled with the same priority run in FIFO order, but possibly
+// concurrently on different workers; tasks must do their own locking for
+// shared state.
+class ThreadPool {
+ public:
+  // Scheduling priority.  High priority tasks are dequeued before low
+  // priority ones; use PRIORITY_LOW for background maintenance work that
+  // must not delay conversion-critical tasks.
+  enum Priority {
+    PRIORITY_HIGH = 0,
+    PRIORITY_LOW = 1,
+    PRIORITY_SIZE = 2,
+  };
+
+  // Creates a pool with |num_threads| workers (at least one).
+  explicit ThreadPool(size_t num_threads);
+
+  // Waits for every scheduled task to finish, then joins the workers.
+  ~ThreadPool();
+
+  // Returns the process-wide pool, sized by the number of processors
+  // reported by CPUStats.  It is created on first use and finalized
+  // through SingletonFinalizer, so tasks must not outlive Singleton
+  // finalization.
+  static ThreadPool *GetDefault();
+
+  // Enqueues |task| for execution on some worker thread.
+  void Schedule(std::function<void()> task, Priority priority);
+  void Schedule(std::function<void()> task) {
+    Schedule(std::move(task), PRIORITY_HIGH);
+  }
+
+  // Blocks until every task scheduled so far has finished.  Tasks
+  // scheduled concurrently with Wait() may or may not be waited for.
+  void Wait();
+
+  size_t num_threads() const { return workers_.size(); }
+
+ private:
+  class WorkerThread;
+
+  // Dequeues the next task into |*task|; blocks while the queues are
+  // empty and returns false on shutdown.
+  bool NextTask(std::function<void()> *task);
+  void OnTaskDone();
+
+  std::vector<std::unique_ptr<WorkerThread> > workers_;
+
+  Mutex mutex_;
+  std::queue<std::function<void()> > queues_[PRIORITY_SIZE];
+  size_t num_pending_;  // queued plus running tasks
+  bool quit_;
+
+  UnnamedEvent task_event_;  // raised when a task is queued or on shutdown
+  UnnamedEvent idle_event_;  // raised when |num_pending_| drops to zero
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_THREAD_POOL_H_
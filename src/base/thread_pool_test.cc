@@ -0,0 +1,116 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/thread_pool.h"
+
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/unnamed_event.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(ThreadPoolTest, ScheduleAndWait) {
+  ThreadPool pool(4);
+  EXPECT_EQ(4, pool.num_threads());
+
+  Mutex mutex;
+  int counter = 0;
+  const int kNumTasks = 100;
+  for (int i = 0; i < kNumTasks; ++i) {
+    pool.Schedule([&mutex, &counter] {
+      scoped_lock l(&mutex);
+      ++counter;
+    });
+  }
+  pool.Wait();
+  EXPECT_EQ(kNumTasks, counter);
+
+  // The pool stays usable after Wait().
+  pool.Schedule([&mutex, &counter] {
+    scoped_lock l(&mutex);
+    ++counter;
+  });
+  pool.Wait();
+  EXPECT_EQ(kNumTasks + 1, counter);
+}
+
+TEST(ThreadPoolTest, HighPriorityRunsFirst) {
+  // With a single worker blocked on a gate, queued high priority tasks
+  // must run before the low priority one scheduled ahead of them.
+  ThreadPool pool(1);
+
+  UnnamedEvent gate;
+  pool.Schedule([&gate] { gate.Wait(-1); });
+
+  Mutex mutex;
+  std::vector<int> order;
+  pool.Schedule([&mutex, &order] {
+    scoped_lock l(&mutex);
+    order.push_back(1);
+  }, ThreadPool::PRIORITY_LOW);
+  pool.Schedule([&mutex, &order] {
+    scoped_lock l(&mutex);
+    order.push_back(2);
+  }, ThreadPool::PRIORITY_HIGH);
+
+  gate.Notify();
+  pool.Wait();
+
+  ASSERT_EQ(2, order.size());
+  EXPECT_EQ(2, order[0]);
+  EXPECT_EQ(1, order[1]);
+}
+
+TEST(ThreadPoolTest, DestructorDrainsQueuedTasks) {
+  Mutex mutex;
+  int counter = 0;
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 10; ++i) {
+      pool.Schedule([&mutex, &counter] {
+        scoped_lock l(&mutex);
+        ++counter;
+      });
+    }
+  }
+  EXPECT_EQ(10, counter);
+}
+
+TEST(ThreadPoolTest, GetDefault) {
+  ThreadPool *pool = ThreadPool::GetDefault();
+  ASSERT_TRUE(pool != nullptr);
+  EXPECT_GE(pool->num_threads(), 1);
+  EXPECT_EQ(pool, ThreadPool::GetDefault());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -0,0 +1,192 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/trace.h"
+
+#ifdef OS_WIN
+#include <windows.h>
+#else  // OS_WIN
+#include <pthread.h>
+#endif  // OS_WIN
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+#include "base/clock.h"
+#include "base/logging.h"
+#include "base/singleton.h"
+
+namespace mozc {
+namespace {
+
+// 4096 events keep several seconds of typical typing activity while
+// the buffer stays well under a mebibyte.  Must be a power of two so
+// that the cursor can wrap with a mask.
+const uint64 kRingBufferSize = 4096;
+
+uint64 CurrentThreadId() {
+#if defined(OS_WIN)
+  return ::GetCurrentThreadId();
+#elif defined(OS_NACL)
+  // pthread_self() returns __nc_basic_thread_data*.
+  return reinterpret_cast<uintptr_t>(pthread_self());
+#elif defined(OS_MACOSX)
+  return reinterpret_cast<uintptr_t>(pthread_self());
+#else  // = OS_LINUX
+  // It returns unsigned long.
+  return pthread_self();
+#endif
+}
+
+struct Event {
+  const char *name;
+  uint64 begin_ticks;
+  uint64 duration_ticks;
+  uint64 thread_id;
+};
+
+// A fixed-size ring buffer shared by all threads.  Writers claim a
+// slot with an atomic cursor increment and publish it with a per-slot
+// sequence number (the usual sequence-lock protocol): the sequence is
+// odd while the slot is being written and the final value encodes the
+// cursor ticket, so a reader can tell apart complete, in-progress and
+// already overwritten slots and simply skips the latter two.
+class EventRingBuffer {
+ public:
+  EventRingBuffer() : cursor_(0) {
+    for (uint64 i = 0; i < kRingBufferSize; ++i) {
+      seq_[i].store(1, std::memory_order_relaxed);  // odd: never valid
+    }
+  }
+
+  void Record(const char *name, uint64 begin_ticks, uint64 duration_ticks) {
+    const uint64 ticket = cursor_.fetch_add(1, std::memory_order_relaxed);
+    const uint64 index = ticket & (kRingBufferSize - 1);
+    seq_[index].store(2 * ticket + 1, std::memory_order_release);
+    Event &event = events_[index];
+    event.name = name;
+    event.begin_ticks = begin_ticks;
+    event.duration_ticks = duration_ticks;
+    event.thread_id = CurrentThreadId();
+    seq_[index].store(2 * ticket + 2, std::memory_order_release);
+  }
+
+  // Copies the complete events, oldest first.
+  void Get(std::vector<Event> *events) const {
+    DCHECK(events);
+    events->clear();
+    const uint64 cursor = cursor_.load(std::memory_order_acquire);
+    const uint64 size = std::min(cursor, kRingBufferSize);
+    for (uint64 ticket = cursor - size; ticket < cursor; ++ticket) {
+      const uint64 index = ticket & (kRingBufferSize - 1);
+      const uint64 seq = seq_[index].load(std::memory_order_acquire);
+      if (seq != 2 * ticket + 2) {
+        continue;  // in progress or already overwritten
+      }
+      const Event event = events_[index];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_[index].load(std::memory_order_relaxed) != seq) {
+        continue;  // overwritten while we were copying
+      }
+      events->push_back(event);
+    }
+  }
+
+  void Clear() {
+    for (uint64 i = 0; i < kRingBufferSize; ++i) {
+      seq_[i].store(1, std::memory_order_relaxed);
+    }
+    cursor_.store(0, std::memory_order_release);
+  }
+
+ private:
+  std::atomic<uint64> cursor_;
+  std::atomic<uint64> seq_[kRingBufferSize];
+  Event events_[kRingBufferSize];
+
+  DISALLOW_COPY_AND_ASSIGN(EventRingBuffer);
+};
+
+uint64 TicksToMicroSeconds(uint64 ticks, uint64 frequency) {
+  // Split the division to avoid overflowing uint64 for large tick
+  // values; |frequency| is at most a few GHz so the remainder part
+  // cannot overflow.
+  return (ticks / frequency) * 1000000 + (ticks % frequency) * 1000000 /
+      frequency;
+}
+
+}  // namespace
+
+void Trace::Record(const char *name, uint64 begin_ticks,
+                   uint64 duration_ticks) {
+  Singleton<EventRingBuffer>::get()->Record(name, begin_ticks,
+                                            duration_ticks);
+}
+
+void Trace::DumpJson(string *json) {
+  DCHECK(json);
+  std::vector<Event> events;
+  Singleton<EventRingBuffer>::get()->Get(&events);
+  const uint64 frequency = Clock::GetFrequency();
+  json->append("{\"traceEvents\":[");
+  char buf[256];
+  for (size_t i = 0; i < events.size(); ++i) {
+    const Event &event = events[i];
+    // Event names are string literals from the instrumentation points,
+    // so no JSON escaping is needed.  Chrome's trace viewer expects
+    // microseconds in "ts" and "dur".
+    snprintf(buf, sizeof(buf),
+             "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,"
+             "\"ts\":%llu,\"dur\":%llu}",
+             (i == 0) ? "" : ",",
+             event.name,
+             static_cast<unsigned long long>(event.thread_id),
+             static_cast<unsigned long long>(
+                 TicksToMicroSeconds(event.begin_ticks, frequency)),
+             static_cast<unsigned long long>(
+                 TicksToMicroSeconds(event.duration_ticks, frequency)));
+    json->append(buf);
+  }
+  json->append("]}");
+}
+
+void Trace::Clear() {
+  Singleton<EventRingBuffer>::get()->Clear();
+}
+
+ScopedTraceEvent::ScopedTraceEvent(const char *name)
+    : name_(name), begin_ticks_(Clock::GetCheapTicks()) {}
+
+ScopedTraceEvent::~ScopedTraceEvent() {
+  Trace::Record(name_, begin_ticks_, Clock::GetCheapTicks() - begin_ticks_);
+}
+
+}  // namespace mozc
@@ -0,0 +1,97 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_TRACE_H_
+#define MOZC_BASE_TRACE_H_
+
+#include <string>
+
+#include "base/port.h"
+
+namespace mozc {
+
+// Trace records causally ordered timing events (key event, conversion
+// phases, IPC reply, ...) into a fixed-size process-wide ring buffer.
+// Unlike UsageStats, which only aggregates, a trace keeps the
+// individual events with their Clock::GetCheapTicks() timestamps so that
+// one slow key stroke can be broken down into its phases after the
+// fact.
+//
+// Recording one event is an atomic cursor increment and a few plain
+// stores; there is no lock, so the instrumentation points can stay
+// enabled in release builds.  When the buffer overflows, the oldest
+// events are overwritten.  The recorded events are dumped on demand
+// through the server's DUMP_PERFORMANCE_TRACE command in the JSON
+// format understood by Chrome's about:tracing viewer.
+class Trace {
+ public:
+  // Records one complete event.  |name| must be a string literal (or
+  // otherwise outlive the process): only the pointer is stored so
+  // that recording stays lock-free.  Timestamps are in
+  // Clock::GetCheapTicks() units (the same unit as Clock::GetTicks()).
+  static void Record(const char *name, uint64 begin_ticks,
+                     uint64 duration_ticks);
+
+  // Appends the recorded events to |json| as a Chrome trace document
+  // ({"traceEvents":[...]}), oldest first.  Events that are being
+  // overwritten concurrently are skipped.
+  static void DumpJson(string *json);
+
+  // Discards all recorded events.  Not meant to be called
+  // concurrently with Record(); mainly for tests.
+  static void Clear();
+
+ private:
+  Trace() {}
+  ~Trace() {}
+
+  DISALLOW_COPY_AND_ASSIGN(Trace);
+};
+
+// Measures the scope it lives in and records it under |name|.
+//
+//   {
+//     ScopedTraceEvent event("Session::SendKey");
+//     ...
+//   }  // recorded here
+class ScopedTraceEvent {
+ public:
+  explicit ScopedTraceEvent(const char *name);
+  ~ScopedTraceEvent();
+
+ private:
+  const char *name_;
+  uint64 begin_ticks_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_TRACE_H_
@@ -0,0 +1,104 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/trace.h"
+
+#include <memory>
+#include <string>
+
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+
+class TraceTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    clock_mock_.reset(new ClockMock(1000, 0));
+    // ClockMock ticks run at 1MHz from 0, so ticks equal microseconds.
+    clock_mock_->SetFrequency(1000000);
+    Clock::SetClockForUnitTest(clock_mock_.get());
+    Trace::Clear();
+  }
+
+  void TearDown() override {
+    Trace::Clear();
+    Clock::SetClockForUnitTest(nullptr);
+  }
+
+  std::unique_ptr<ClockMock> clock_mock_;
+};
+
+TEST_F(TraceTest, RecordAndDump) {
+  Trace::Record("foo", 100, 25);
+
+  string json;
+  Trace::DumpJson(&json);
+  EXPECT_NE(string::npos,
+            json.find("\"name\":\"foo\",\"ph\":\"X\"")) << json;
+  EXPECT_NE(string::npos, json.find("\"ts\":100,\"dur\":25")) << json;
+}
+
+TEST_F(TraceTest, ScopedTraceEventMeasuresItsScope) {
+  {
+    ScopedTraceEvent event("scoped");
+    clock_mock_->PutClockForwardByTicks(1500);  // 1500 usec
+  }
+
+  string json;
+  Trace::DumpJson(&json);
+  EXPECT_NE(string::npos, json.find("\"name\":\"scoped\"")) << json;
+  EXPECT_NE(string::npos, json.find("\"dur\":1500")) << json;
+}
+
+TEST_F(TraceTest, EventsAreOrderedOldestFirst) {
+  Trace::Record("first", 10, 1);
+  Trace::Record("second", 20, 1);
+
+  string json;
+  Trace::DumpJson(&json);
+  const size_t first_pos = json.find("\"first\"");
+  const size_t second_pos = json.find("\"second\"");
+  ASSERT_NE(string::npos, first_pos);
+  ASSERT_NE(string::npos, second_pos);
+  EXPECT_LT(first_pos, second_pos);
+}
+
+TEST_F(TraceTest, ClearDiscardsEvents) {
+  Trace::Record("stale", 10, 1);
+  Trace::Clear();
+
+  string json;
+  Trace::DumpJson(&json);
+  EXPECT_EQ(string::npos, json.find("\"stale\"")) << json;
+  EXPECT_NE(string::npos, json.find("{\"traceEvents\":[]}")) << json;
+}
+
+}  // namespace mozc
@@ -65,6 +65,7 @@
 #include "base/japanese_util_rule.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/singleton.h"
 #include "base/string_piece.h"
 
 
@@ -229,6 +230,22 @@ void Util::SplitStringAllowEmpty(StringPiece str,
   }
 }
 
+void Util::SplitStringAllowEmpty(StringPiece str,
+                                 const char *delim,
+                                 std::vector<StringPiece> *output) {
+  if (delim[0] != '\0' && delim[1] == '\0') {
+    for (SplitIterator<SingleDelimiter, AllowEmpty> iter(str, delim);
+         !iter.Done(); iter.Next()) {
+      output->push_back(iter.Get());
+    }
+  } else {
+    for (SplitIterator<MultiDelimiter, AllowEmpty> iter(str, delim);
+         !iter.Done(); iter.Next()) {
+      output->push_back(iter.Get());
+    }
+  }
+}
+
 void Util::SplitStringToUtf8Chars(StringPiece str,
                                   std::vector<string> *output) {
   const char *begin = str.data();
@@ -518,6 +535,38 @@ bool IsUTF8TrailingByte(uint8 c) {
   return (c & 0xc0) == 0x80;
 }
 
+// Returns the length of the leading ASCII-only run of |s|.  Scans eight
+// bytes at a time so that callers can handle long ASCII runs in bulk
+// without decoding UTF-8 character by character.  We deliberately stick
+// to portable word-sized loads here as this file has to build with every
+// supported toolchain; compilers widen this loop to SIMD where available.
+size_t AsciiRunLength(StringPiece s) {
+  const uint64 kMsbMask = GG_ULONGLONG(0x8080808080808080);
+  size_t i = 0;
+  uint64 word = 0;
+  for (; i + sizeof(word) <= s.size(); i += sizeof(word)) {
+    memcpy(&word, s.data() + i, sizeof(word));
+    if (word & kMsbMask) {
+      break;
+    }
+  }
+  while (i < s.size() && (static_cast<uint8>(s[i]) & 0x80) == 0) {
+    ++i;
+  }
+  return i;
+}
+
+// Returns the length of the leading run of |s| with no ASCII byte in it.
+// UTF-8 multi byte sequences consist solely of bytes with the MSB set, so
+// the run boundary never splits a character.
+size_t NonAsciiRunLength(StringPiece s) {
+  size_t i = 0;
+  while (i < s.size() && (static_cast<uint8>(s[i]) & 0x80) != 0) {
+    ++i;
+  }
+  return i;
+}
+
 }  // namespace
 
 // Return length of a single UTF-8 source character
@@ -526,12 +575,19 @@ size_t Util::OneCharLen(const char *src) {
 }
 
 size_t Util::CharsLen(const char *src, size_t length) {
-  const char *begin = src;
-  const char *end = src + length;
-  int result = 0;
-  while (begin < end) {
+  StringPiece s(src, length);
+  size_t result = 0;
+  while (!s.empty()) {
+    // ASCII characters are one byte each, so a leading ASCII run can be
+    // counted in bulk without stepping over it.
+    const size_t ascii_len = AsciiRunLength(s);
+    result += ascii_len;
+    s.remove_prefix(ascii_len);
+    if (s.empty()) {
+      break;
+    }
     ++result;
-    begin += OneCharLen(begin);
+    s.remove_prefix(std::min(OneCharLen(s.data()), s.size()));
   }
   return result;
 }
@@ -680,6 +736,21 @@ bool Util::SplitLastChar32(StringPiece s,
   return true;
 }
 
+bool Util::IsValidUtf8(StringPiece s) {
+  while (!s.empty()) {
+    // Every ASCII byte is a valid character by itself; skip runs of
+    // them in bulk and decode only the multi byte sequences.
+    s.remove_prefix(AsciiRunLength(s));
+    if (s.empty()) {
+      break;
+    }
+    if (!SplitFirstChar32(s, NULL, &s)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void Util::UCS4ToUTF8(char32 c, string *output) {
   output->clear();
   UCS4ToUTF8Append(c, output);
@@ -1108,13 +1179,10 @@ int LookupDoubleArray(const japanese_util_rule::DoubleArray *array,
   return seekto;
 }
 
-}  // namespace
-
-void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
+void ConvertUsingDoubleArrayAppend(const japanese_util_rule::DoubleArray *da,
                                    const char *ctable,
                                    StringPiece input,
                                    string *output) {
-  output->clear();
   const char *begin = input.data();
   const char *const end = input.data() + input.size();
   while (begin < end) {
@@ -1128,13 +1196,23 @@ void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
       mblen -= static_cast<int32>(p[len + 1]);
       begin += mblen;
     } else {
-      mblen = OneCharLen(begin);
+      mblen = Util::OneCharLen(begin);
       output->append(begin, mblen);
       begin += mblen;
     }
   }
 }
 
+}  // namespace
+
+void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
+                                   const char *ctable,
+                                   StringPiece input,
+                                   string *output) {
+  output->clear();
+  ConvertUsingDoubleArrayAppend(da, ctable, input, output);
+}
+
 void Util::HiraganaToKatakana(StringPiece input, string *output) {
   ConvertUsingDoubleArray(japanese_util_rule::hiragana_to_katakana_da,
                           japanese_util_rule::hiragana_to_katakana_table,
@@ -1163,22 +1241,81 @@ void Util::HiraganaToRomanji(StringPiece input, string *output) {
                           output);
 }
 
+namespace {
+
+// Per-character expansions of the printable ASCII range, precomputed from
+// |halfwidthascii_to_fullwidthascii_da| at first use, so that ASCII runs
+// are converted by direct indexing instead of one double-array traversal
+// per character.  Note that the mapping is not a simple codepoint offset:
+// e.g. '"' becomes RIGHT DOUBLE QUOTATION MARK and '-' becomes MINUS SIGN.
+class HalfWidthAsciiExpansionTable {
+ public:
+  HalfWidthAsciiExpansionTable() {
+    for (int c = kFirstChar; c <= kLastChar; ++c) {
+      const char key = static_cast<char>(c);
+      Util::ConvertUsingDoubleArray(
+          japanese_util_rule::halfwidthascii_to_fullwidthascii_da,
+          japanese_util_rule::halfwidthascii_to_fullwidthascii_table,
+          StringPiece(&key, 1), &expansions_[c - kFirstChar]);
+    }
+  }
+
+  // Appends the conversion of the ASCII character |c| to |output|.
+  void Append(char c, string *output) const {
+    if (c >= kFirstChar && c <= kLastChar) {
+      output->append(expansions_[c - kFirstChar]);
+    } else {
+      // Control characters have no full width form and pass through.
+      output->push_back(c);
+    }
+  }
+
+ private:
+  static const int kFirstChar = 0x20;  // SPACE
+  static const int kLastChar = 0x7E;   // TILDE
+
+  string expansions_[kLastChar - kFirstChar + 1];
+};
+
+}  // namespace
+
 void Util::HalfWidthAsciiToFullWidthAscii(StringPiece input,
                                           string *output) {
-  ConvertUsingDoubleArray(
-      japanese_util_rule::halfwidthascii_to_fullwidthascii_da,
-      japanese_util_rule::halfwidthascii_to_fullwidthascii_table,
-      input,
-      output);
+  output->clear();
+  const HalfWidthAsciiExpansionTable *table =
+      Singleton<HalfWidthAsciiExpansionTable>::get();
+  while (!input.empty()) {
+    // Convert ASCII runs through the precomputed table; only ASCII
+    // characters have an entry in the double array, so non-ASCII runs
+    // pass through unchanged.
+    const size_t ascii_len = AsciiRunLength(input);
+    for (size_t i = 0; i < ascii_len; ++i) {
+      table->Append(input[i], output);
+    }
+    input.remove_prefix(ascii_len);
+    const size_t non_ascii_len = NonAsciiRunLength(input);
+    output->append(input.data(), non_ascii_len);
+    input.remove_prefix(non_ascii_len);
+  }
 }
 
 void Util::FullWidthAsciiToHalfWidthAscii(StringPiece input,
                                           string *output) {
-  ConvertUsingDoubleArray(
-      japanese_util_rule::fullwidthascii_to_halfwidthascii_da,
-      japanese_util_rule::fullwidthascii_to_halfwidthascii_table,
-      input,
-      output);
+  output->clear();
+  while (!input.empty()) {
+    // ASCII characters are already half width; copy runs through in bulk
+    // and run the double array only over the non-ASCII runs.
+    const size_t ascii_len = AsciiRunLength(input);
+    output->append(input.data(), ascii_len);
+    input.remove_prefix(ascii_len);
+    const size_t non_ascii_len = NonAsciiRunLength(input);
+    ConvertUsingDoubleArrayAppend(
+        japanese_util_rule::fullwidthascii_to_halfwidthascii_da,
+        japanese_util_rule::fullwidthascii_to_halfwidthascii_table,
+        input.substr(0, non_ascii_len),
+        output);
+    input.remove_prefix(non_ascii_len);
+  }
 }
 
 void Util::HiraganaToFullwidthRomanji(StringPiece input, string *output) {
@@ -1640,6 +1777,18 @@ Util::ScriptType Util::GetScriptType(const char *begin,
 
 namespace {
 
+// GetScriptType() restricted to ASCII characters; used by the bulk loops
+// below to classify ASCII runs without UTF-8 decoding.
+inline Util::ScriptType AsciiScriptType(char c) {
+  if (c >= '0' && c <= '9') {
+    return Util::NUMBER;
+  }
+  if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+    return Util::ALPHABET;
+  }
+  return Util::UNKNOWN_SCRIPT;
+}
+
 Util::ScriptType GetScriptTypeInternal(StringPiece str, bool ignore_symbols) {
   Util::ScriptType result = Util::SCRIPT_TYPE_SIZE;
 
@@ -1703,6 +1852,16 @@ Util::ScriptType Util::GetScriptTypeWithoutSymbols(const string &str) {
 
 // return true if all script_type in str is "type"
 bool Util::IsScriptType(StringPiece str, Util::ScriptType type) {
+  // Classify the leading ASCII run in bulk; the exceptional characters
+  // handled below are all non-ASCII, so plain byte classification is
+  // exact there.
+  const size_t ascii_len = AsciiRunLength(str);
+  for (size_t i = 0; i < ascii_len; ++i) {
+    if (AsciiScriptType(str[i]) != type) {
+      return false;
+    }
+  }
+  str.remove_prefix(ascii_len);
   for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
     const char32 w = iter.Get();
     // Exception: 30FC (PROLONGEDSOUND MARK is categorized as HIRAGANA as well)
@@ -1715,6 +1874,27 @@ bool Util::IsScriptType(StringPiece str, Util::ScriptType type) {
 
 // return true if the string contains script_type char
 bool Util::ContainsScriptType(StringPiece str, ScriptType type) {
+  if (type == KANJI || type == HIRAGANA || type == KATAKANA ||
+      type == EMOJI) {
+    // No ASCII character belongs to these scripts, so skip over ASCII
+    // runs in bulk and decode only the non-ASCII characters.
+    while (!str.empty()) {
+      str.remove_prefix(AsciiRunLength(str));
+      if (str.empty()) {
+        return false;
+      }
+      size_t mblen = 0;
+      if (type == GetScriptType(str.data(), str.data() + str.size(),
+                                &mblen)) {
+        return true;
+      }
+      if (mblen == 0) {  // Broken UTF-8; give up as the iterator would.
+        return false;
+      }
+      str.remove_prefix(mblen);
+    }
+    return false;
+  }
   for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
     if (type == GetScriptType(iter.Get())) {
       return true;
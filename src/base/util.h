@@ -120,6 +120,9 @@ class Util {
   static void SplitStringAllowEmpty(StringPiece str,
                                     const char *delm,
                                     std::vector<string> *output);
+  static void SplitStringAllowEmpty(StringPiece str,
+                                    const char *delm,
+                                    std::vector<StringPiece> *output);
 
   static void SplitStringToUtf8Chars(StringPiece str,
                                      std::vector<string> *output);
@@ -222,6 +225,14 @@ class Util {
                               StringPiece *rest,
                               char32 *last_char32);
 
+  // Returns true if |s| is a valid UTF-8 string under the same rules as
+  // SplitFirstChar32(), i.e. redundant (overlong) sequences, lone
+  // trailing bytes, truncated sequences and 0xFE/0xFF are rejected.
+  // ASCII runs are tested in bulk, so the cost on mostly-ASCII input is
+  // far below decoding every character; use this to sanitize externally
+  // provided strings before iterating over them.
+  static bool IsValidUtf8(StringPiece s);
+
 #ifdef OS_WIN
   // Returns how many wide characters are necessary in UTF-16 to represent
   // given UTF-8 string. Note that the result of this method becomes greater
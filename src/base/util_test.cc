@@ -499,6 +499,18 @@ TEST(UtilTest, SplitStringAllowEmpty) {
     EXPECT_EQ(output.size(), 1);
     EXPECT_EQ(input, output[0]);
   }
+  {
+    // StringPiece output.
+    const string input = "a b  c def";
+    std::vector<StringPiece> output;
+    Util::SplitStringAllowEmpty(input, " ", &output);
+    EXPECT_EQ(output.size(), 5);
+    EXPECT_EQ("a", output[0]);
+    EXPECT_EQ("b", output[1]);
+    EXPECT_EQ("", output[2]);
+    EXPECT_EQ("c", output[3]);
+    EXPECT_EQ("def", output[4]);
+  }
 }
 
 TEST(UtilTest, StripWhiteSpaces) {
@@ -807,6 +819,33 @@ TEST(UtilTest, UCS4ToUTF8) {
 TEST(UtilTest, CharsLen) {
   const string src = "私の名前は中野です";
   EXPECT_EQ(Util::CharsLen(src.c_str(), src.size()), 9);
+
+  // Mixed ASCII runs and multi byte characters; the ASCII runs are
+  // counted in bulk.
+  const string mixed = "my name is 中野 (Nakano) です。";
+  EXPECT_EQ(Util::CharsLen(mixed.c_str(), mixed.size()), 26);
+  EXPECT_EQ(Util::CharsLen("", 0), 0);
+}
+
+TEST(UtilTest, IsValidUtf8) {
+  EXPECT_TRUE(Util::IsValidUtf8(""));
+  EXPECT_TRUE(Util::IsValidUtf8("abc"));
+  EXPECT_TRUE(Util::IsValidUtf8("あいう"));
+  EXPECT_TRUE(Util::IsValidUtf8("abc あいう xyz"));
+  EXPECT_TRUE(Util::IsValidUtf8("\xF0\x9F\x98\x80"));  // U+1F600
+
+  // Lone trailing byte.
+  EXPECT_FALSE(Util::IsValidUtf8("\x80"));
+  EXPECT_FALSE(Util::IsValidUtf8("abc\xBF xyz"));
+  // Truncated sequence.
+  EXPECT_FALSE(Util::IsValidUtf8("\xE3\x81"));
+  // Lead byte followed by a non-trailing byte.
+  EXPECT_FALSE(Util::IsValidUtf8("\xE3\x41\x81"));
+  // Redundant (overlong) encoding of '/'.
+  EXPECT_FALSE(Util::IsValidUtf8("\xC0\xAF"));
+  // 0xFE and 0xFF never appear in UTF-8.
+  EXPECT_FALSE(Util::IsValidUtf8("\xFE"));
+  EXPECT_FALSE(Util::IsValidUtf8("\xFF"));
 }
 
 TEST(UtilTest, SubStringPiece) {
@@ -1177,6 +1216,16 @@ TEST(UtilTest, FullWidthAndHalfWidth) {
   Util::HalfWidthAsciiToFullWidthAscii("  ", &output);
   EXPECT_EQ("　　", output);  // 2 full-width spaces
 
+  // Mixed ASCII and non-ASCII runs, long enough to exercise the bulk
+  // conversion paths.  Note the irregular mappings of '-' and '"'.
+  Util::HalfWidthAsciiToFullWidthAscii("abcdefghijklmnop「あ」-\"xyz",
+                                       &output);
+  EXPECT_EQ("ａｂｃｄｅｆｇｈｉｊｋｌｍｎｏｐ「あ」−”ｘｙｚ", output);
+
+  Util::FullWidthAsciiToHalfWidthAscii("ＡＢＣａｂｃABCDEFGHIJKLMNOP０１あ",
+                                       &output);
+  EXPECT_EQ("ABCabcABCDEFGHIJKLMNOP01あ", output);
+
   // Half- and full-width spaces
   Util::FullWidthKatakanaToHalfWidthKatakana(" 　", &output);
   EXPECT_EQ(" 　", output);  // Not changed
@@ -1391,8 +1440,21 @@ TEST(UtilTest, ScriptType) {
   EXPECT_FALSE(Util::IsScriptType("ぐーぐるグ", Util::HIRAGANA));
   EXPECT_FALSE(Util::IsScriptType("グーグルぐ", Util::KATAKANA));
 
+  // Long ASCII inputs exercise the bulk classification path.
+  EXPECT_TRUE(Util::IsScriptType("abcdefghijklmnopqrstuvwxyz",
+                                 Util::ALPHABET));
+  EXPECT_TRUE(Util::IsScriptType("01234567890123456789", Util::NUMBER));
+  EXPECT_FALSE(Util::IsScriptType("abcdefghijklmnopqrstuvwxyz0",
+                                  Util::ALPHABET));
+  EXPECT_FALSE(Util::IsScriptType("abcdefghijklmnopqrstuvwxyzあ",
+                                  Util::ALPHABET));
+
   EXPECT_TRUE(Util::ContainsScriptType("グーグルsuggest", Util::ALPHABET));
   EXPECT_FALSE(Util::ContainsScriptType("グーグルサジェスト", Util::ALPHABET));
+  EXPECT_TRUE(Util::ContainsScriptType("this is a pen with ペン",
+                                       Util::KATAKANA));
+  EXPECT_FALSE(Util::ContainsScriptType("this is just a pen",
+                                        Util::KATAKANA));
 
   EXPECT_EQ(Util::HIRAGANA, Util::GetScriptType("くどう"));
   EXPECT_EQ(Util::KANJI, Util::GetScriptType("京都"));
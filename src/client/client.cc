@@ -53,6 +53,7 @@
 #include "ipc/ipc.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/session_handler_interface.h"
 
 #ifdef OS_WIN
 #include "base/win_util.h"
@@ -87,6 +88,7 @@ const int kDeleteSessionOnDestructorTimeout = 1000;  // 1 sec
 
 Client::Client()
     : id_(0),
+      session_handler_(NULL),
       server_launcher_(new ServerLauncher),
       result_(new char[kResultBufferSize]),
       timeout_(kDefaultTimeout),
@@ -106,6 +108,10 @@ void Client::SetIPCClientFactory(IPCClientFactoryInterface *client_factory) {
   client_factory_ = client_factory;
 }
 
+void Client::SetSessionHandler(SessionHandlerInterface *session_handler) {
+  session_handler_ = session_handler;
+}
+
 void Client::SetServerLauncher(
     ServerLauncherInterface *server_launcher) {
   server_launcher_.reset(server_launcher);
@@ -546,6 +552,10 @@ bool Client::NoOperation() {
 
 // PingServer ignores all server status
 bool Client::PingServer() const {
+  if (session_handler_ != NULL) {
+    return session_handler_->IsAvailable();
+  }
+
   if (client_factory_ == NULL) {
     return false;
   }
@@ -620,13 +630,33 @@ bool Client::Call(const commands::Input &input,
     return false;
   }
 
+  // Embedded mode: the session handler lives in this process, so the
+  // command is dispatched directly with no serialization or transport.
+  if (session_handler_ != NULL) {
+    // Caller and callee trivially run the same version.
+    server_protocol_version_ = IPC_PROTOCOL_VERSION;
+    server_product_version_ = Version::GetMozcVersion();
+    server_process_id_ = 0;
+
+    commands::Command command;
+    command.mutable_input()->CopyFrom(input);
+    if (!session_handler_->EvalCommand(&command)) {
+      LOG(ERROR) << "EvalCommand failure";
+      server_status_ = SERVER_SHUTDOWN;
+      return false;
+    }
+    output->CopyFrom(command.output());
+    VLOG(2) << "commands::Output: " << std::endl
+            << output->DebugString();
+    return true;
+  }
+
   if (client_factory_ == NULL) {
     return false;
   }
 
   // Serialize
-  string request;
-  input.SerializeToString(&request);
+  input.SerializeToString(&request_);
 
   // Call IPC
   std::unique_ptr<IPCClientInterface> client(
@@ -673,7 +703,7 @@ bool Client::Call(const commands::Input &input,
   // http://b/2126375
   // TODO(taku): Investigate the error in detail.
   size_t size = kResultBufferSize;
-  if (!client->Call(request.data(), request.size(),
+  if (!client->Call(request_.data(), request_.size(),
                     result_.get(), &size, timeout_)) {
     LOG(ERROR) << "Call failure";
     //               << input.DebugString();
@@ -706,6 +736,11 @@ bool Client::Call(const commands::Input &input,
 }
 
 bool Client::StartServer() {
+  // In the embedded mode the "server" lives in this process; there is
+  // nothing to launch.
+  if (session_handler_ != NULL) {
+    return true;
+  }
   if (server_launcher_.get() != NULL) {
     return server_launcher_->StartServer(this);
   }
@@ -941,6 +976,14 @@ ClientInterface *ClientFactory::NewClient() {
   }
 }
 
+ClientInterface *ClientFactory::NewEmbeddedClient(
+    SessionHandlerInterface *session_handler) {
+  DCHECK(session_handler);
+  Client *client = new Client;
+  client->SetSessionHandler(session_handler);
+  return client;
+}
+
 void ClientFactory::SetClientFactory(
     ClientFactoryInterface *client_factory) {
   g_client_factory = client_factory;
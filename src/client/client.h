@@ -44,6 +44,7 @@
 
 namespace mozc {
 class IPCClientFactoryInterface;
+class SessionHandlerInterface;
 
 namespace config {
 class Config;
@@ -99,6 +100,14 @@ class Client : public ClientInterface {
   virtual ~Client();
   void SetIPCClientFactory(IPCClientFactoryInterface *client_factory);
 
+  // Sets the in-process session handler and enables the embedded mode:
+  // every command is dispatched to |session_handler| directly instead
+  // of through IPC, with no serialization.  For single-client
+  // deployments which link the engine into the client process; see
+  // ClientFactory::NewEmbeddedClient().  This method doesn't take the
+  // ownership of |session_handler|, which must outlive this instance.
+  void SetSessionHandler(SessionHandlerInterface *session_handler);
+
   // set ServerLauncher.
   // ServerLauncher is used as default
   // NOTE: Client class takes the owership of start_server_handler.
@@ -242,9 +251,15 @@ class Client : public ClientInterface {
   void GetHistoryInputs(std::vector<commands::Input> *result) const;
 
   uint64 id_;
+  // In-process session handler for the embedded mode; NULL when the
+  // commands go through IPC.  Not owned.
+  SessionHandlerInterface *session_handler_;
   IPCClientFactoryInterface *client_factory_;
   std::unique_ptr<ServerLauncherInterface> server_launcher_;
   std::unique_ptr<char[]> result_;
+  // Scratch buffer for the serialized request in Call().  A member so
+  // that its capacity is reused across calls.
+  string request_;
   std::unique_ptr<config::Config> preferences_;
   int timeout_;
   ServerStatus server_status_;
@@ -39,6 +39,7 @@
 namespace mozc {
 
 class IPCClientFactoryInterface;
+class SessionHandlerInterface;
 
 namespace config {
 class Config;
@@ -247,6 +248,15 @@ class ClientFactory {
   // Return a new client.
   static ClientInterface *NewClient();
 
+  // Returns a new client which dispatches every command to
+  // |session_handler| directly inside the process instead of through
+  // IPC.  For single-client deployments (e.g. kiosks) which link the
+  // engine into the client process and don't benefit from the
+  // client/server isolation.  The caller keeps the ownership of
+  // |session_handler|, which must outlive the returned client.
+  static ClientInterface *NewEmbeddedClient(
+      SessionHandlerInterface *session_handler);
+
   // Set a ClientFactoryInterface for unittesting.
   static void SetClientFactory(ClientFactoryInterface *client_factory);
 
@@ -40,6 +40,7 @@
 #include "base/version.h"
 #include "ipc/ipc_mock.h"
 #include "protocol/commands.pb.h"
+#include "session/session_handler_interface.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -664,6 +665,69 @@ TEST_F(ClientTest, TranslateProtoBufToMozcToolArgTest) {
   EXPECT_EQ("word_register_dialog", mode);
 }
 
+namespace {
+// Minimal in-process session handler for testing the embedded mode: it
+// accepts any session and echoes back the session id.
+class EchoSessionHandler : public SessionHandlerInterface {
+ public:
+  EchoSessionHandler() : eval_count_(0) {}
+
+  virtual bool IsAvailable() const {
+    return true;
+  }
+
+  virtual bool EvalCommand(commands::Command *command) {
+    ++eval_count_;
+    commands::Output *output = command->mutable_output();
+    if (command->input().type() == commands::Input::CREATE_SESSION) {
+      output->set_id(1);
+    } else {
+      output->set_id(command->input().id());
+    }
+    output->set_consumed(true);
+    return true;
+  }
+
+  virtual bool StartWatchDog() {
+    return false;
+  }
+
+  virtual void AddObserver(session::SessionObserverInterface *observer) {}
+
+  virtual StringPiece GetDataVersion() const {
+    return StringPiece();
+  }
+
+  int eval_count() const {
+    return eval_count_;
+  }
+
+ private:
+  int eval_count_;
+};
+}  // namespace
+
+TEST(EmbeddedClientTest, SendKeyGoesThroughSessionHandler) {
+  EchoSessionHandler handler;
+  std::unique_ptr<ClientInterface> client(
+      ClientFactory::NewEmbeddedClient(&handler));
+
+  commands::KeyEvent key_event;
+  key_event.set_special_key(commands::KeyEvent::ENTER);
+  commands::Output output;
+  EXPECT_TRUE(client->SendKey(key_event, &output));
+  EXPECT_TRUE(output.consumed());
+  // CREATE_SESSION and SEND_KEY; no IPC client factory is involved.
+  EXPECT_EQ(2, handler.eval_count());
+}
+
+TEST(EmbeddedClientTest, PingServerUsesHandlerAvailability) {
+  EchoSessionHandler handler;
+  std::unique_ptr<ClientInterface> client(
+      ClientFactory::NewEmbeddedClient(&handler));
+  EXPECT_TRUE(client->PingServer());
+}
+
 class SessionPlaybackTestServerLauncher : public ServerLauncherInterface {
  public:
   explicit SessionPlaybackTestServerLauncher(IPCClientFactoryMock *factory)
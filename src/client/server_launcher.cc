@@ -69,6 +69,12 @@ const uint32 kServerWaitTimeout = 20000;  // 20 sec
 // for every 1000m sec, check server
 const uint32 kRetryIntervalForServer = 1000;
 
+// Add a random jitter of at most kRetryIntervalJitter msec to each
+// retry so that clients started at the same time (e.g. a login storm
+// bringing up one client per session) spread their connection attempts
+// instead of hitting the server's accept loop in lockstep.
+const uint32 kRetryIntervalJitter = 500;
+
 // Try 20 times to check mozc_server is running
 const uint32 kTrial = 20;
 
@@ -215,7 +221,8 @@ bool ServerLauncher::StartServer(ClientInterface *client) {
   } else {
     // maybe another process is trying to launch mozc_server.
     LOG(ERROR) << "cannot make NamedEventListener ";
-    Util::Sleep(kRetryIntervalForServer);
+    Util::Sleep(kRetryIntervalForServer +
+                Util::Random(kRetryIntervalJitter));
   }
 
   // Try to connect mozc_server just in case.
@@ -223,7 +230,8 @@ bool ServerLauncher::StartServer(ClientInterface *client) {
     if (client->PingServer()) {
       return true;
     }
-    Util::Sleep(kRetryIntervalForServer);
+    Util::Sleep(kRetryIntervalForServer +
+                Util::Random(kRetryIntervalJitter));
   }
 
   LOG(ERROR) << kProductNameInEnglish << " cannot be launched";
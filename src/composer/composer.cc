@@ -31,6 +31,10 @@
 
 #include "composer/composer.h"
 
+#include <atomic>
+#include <map>
+#include <utility>
+
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/util.h"
@@ -192,6 +196,11 @@ transliteration::TransliterationType GetTransliterationTypeFromCompositionMode(
 
 const size_t kMaxPreeditLength = 256;
 
+// Process-wide revision counter; see Composer::revision().  Sharing one
+// counter across all instances makes a revision identify one state of
+// one composer, so caches keyed by it never confuse two composers.
+std::atomic<uint64> g_composer_revision(0);
+
 }  // namespace
 
 Composer::Composer(const Table *table,
@@ -209,6 +218,7 @@ Composer::Composer(const Table *table,
                         FLAGS_max_typing_correction_query_candidates,
                         FLAGS_max_typing_correction_query_results),
       max_length_(kMaxPreeditLength),
+      revision_(0),
       request_(request),
       config_(config) {
   SetInputMode(transliteration::HIRAGANA);
@@ -238,19 +248,26 @@ bool Composer::Empty() const {
   return (GetLength() == 0);
 }
 
+void Composer::UpdateRevision() {
+  revision_ = ++g_composer_revision;
+}
+
 void Composer::SetTable(const Table *table) {
   composition_->SetTable(table);
 
   typing_corrector_.SetTable(table);
+  UpdateRevision();
 }
 
 void Composer::SetRequest(const commands::Request *request) {
   request_ = request;
+  UpdateRevision();
 }
 
 void Composer::SetConfig(const config::Config *config) {
   config_ = config;
   typing_corrector_.SetConfig(config);
+  UpdateRevision();
 }
 
 void Composer::SetInputMode(transliteration::TransliterationType mode) {
@@ -259,6 +276,7 @@ void Composer::SetInputMode(transliteration::TransliterationType mode) {
   shifted_sequence_count_ = 0;
   is_new_input_ = true;
   composition_->SetInputMode(GetTransliterator(mode));
+  UpdateRevision();
 }
 
 void Composer::SetTemporaryInputMode(
@@ -269,6 +287,7 @@ void Composer::SetTemporaryInputMode(
   shifted_sequence_count_ = 0;
   is_new_input_ = true;
   composition_->SetInputMode(GetTransliterator(mode));
+  UpdateRevision();
 }
 
 void Composer::UpdateInputMode() {
@@ -286,6 +305,7 @@ void Composer::UpdateInputMode() {
       shifted_sequence_count_ = 0;
       is_new_input_ = true;
       composition_->SetInputMode(GetTransliterator(input_mode_));
+      UpdateRevision();
       return;
     }
   }
@@ -320,6 +340,7 @@ void Composer::SetOutputMode(transliteration::TransliterationType mode) {
   composition_->SetTransliterator(
       0, composition_->GetLength(), GetTransliterator(mode));
   position_ = composition_->GetLength();
+  UpdateRevision();
 }
 
 void Composer::ApplyTemporaryInputMode(const string &input, bool caps_locked) {
@@ -396,6 +417,7 @@ bool Composer::InsertCharacterInternal(const string &key) {
   input.set_is_new_input(is_new_input_);
   position_ = composition_->InsertInput(position_, input);
   is_new_input_ = false;
+  UpdateRevision();
   return true;
 }
 
@@ -465,6 +487,7 @@ bool Composer::InsertCharacterKeyAndPreeditInternal(const string &key,
   input.set_is_new_input(is_new_input_);
   position_ = composition_->InsertInput(position_, input);
   is_new_input_ = false;
+  UpdateRevision();
   return true;
 }
 
@@ -582,6 +605,7 @@ void Composer::DeleteAt(size_t pos) {
   // 1. In composition mode, UpdateInputMode finalizes pending chunk.
   // 2. In conversion mode, InputMode needs not to change.
   typing_corrector_.Invalidate();
+  UpdateRevision();
 }
 
 void Composer::Delete() {
@@ -589,6 +613,7 @@ void Composer::Delete() {
   UpdateInputMode();
 
   typing_corrector_.Invalidate();
+  UpdateRevision();
 }
 
 void Composer::DeleteRange(size_t pos, size_t length) {
@@ -603,6 +628,7 @@ void Composer::EditErase() {
   position_ = 0;
   SetInputMode(comeback_input_mode_);
   typing_corrector_.Reset();
+  UpdateRevision();
 }
 
 void Composer::Backspace() {
@@ -627,6 +653,7 @@ void Composer::Backspace() {
   position_ = composition_->DeleteAt(position_);
 
   typing_corrector_.Invalidate();
+  UpdateRevision();
 }
 
 void Composer::MoveCursorLeft() {
@@ -873,6 +900,10 @@ void Composer::GetRawString(string *raw_string) const {
   GetRawSubString(0, GetLength(), raw_string);
 }
 
+size_t Composer::GetRawInputSize() const {
+  return composition_->GetRawInputSize();
+}
+
 void Composer::GetRawSubString(
     const size_t position,
     const size_t size,
@@ -903,11 +934,27 @@ void Composer::GetSubTransliterations(
     const size_t position,
     const size_t size,
     transliteration::Transliterations *transliterations) const {
+  // The transliteration types are derived from only five underlying
+  // transliterators; e.g. all the ASCII case variants are cheap string
+  // transforms of the same HALF_ASCII or FULL_ASCII text.  Walking the
+  // composition is the expensive part, so the base text is generated
+  // once per underlying transliterator and shared by every type
+  // derived from it.
+  std::map<Transliterators::Transliterator, string> base_texts;
   string t13n;
   for (size_t i = 0; i < transliteration::NUM_T13N_TYPES; ++i) {
     const transliteration::TransliterationType t13n_type =
       transliteration::TransliterationTypeArray[i];
-    GetSubTransliteration(t13n_type, position, size, &t13n);
+    const Transliterators::Transliterator t12r = GetTransliterator(t13n_type);
+    std::map<Transliterators::Transliterator, string>::iterator it =
+        base_texts.find(t12r);
+    if (it == base_texts.end()) {
+      string base_text;
+      GetTransliteratedText(t12r, position, size, &base_text);
+      it = base_texts.insert(std::make_pair(t12r, base_text)).first;
+    }
+    t13n.clear();
+    Transliterate(t13n_type, it->second, &t13n);
     transliterations->push_back(t13n);
   }
 }
@@ -1232,6 +1279,8 @@ void Composer::CopyFrom(const Composer &src) {
   config_ = src.config_;
 
   typing_corrector_.CopyFrom(src.typing_corrector_);
+  // A copy is a new state; it must not share the revision of |src|.
+  UpdateRevision();
 }
 
 bool Composer::is_new_input() const {
@@ -1255,6 +1304,10 @@ void Composer::set_source_text(const string &source_text) {
 size_t Composer::max_length() const {
   return max_length_;
 }
+
+uint64 Composer::revision() const {
+  return revision_;
+}
 void Composer::set_max_length(size_t length) {
   max_length_ = length;
 }
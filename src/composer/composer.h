@@ -185,6 +185,10 @@ class Composer {
   // The main purpose is Transliteration.
   void GetRawString(string *raw_string) const;
 
+  // Returns the byte size of the raw input without building the
+  // string; a cheap precheck for the callers of GetRawString().
+  size_t GetRawInputSize() const;
+
   // Returns substring of raw input.  The position and size is based on the
   // composed string.  For example, when [さ|sa][し|shi][み|mi] is the
   // composition, GetRawSubString(0, 2) returns "sashi".
@@ -245,6 +249,12 @@ class Composer {
   size_t max_length() const;
   void set_max_length(size_t length);
 
+  // Returns the revision of the composition state.  The revision changes
+  // on every mutation which may affect the composed strings or
+  // transliterations, and is unique across Composer instances, so it can
+  // be used as a cache key for derived data (e.g. transliterations).
+  uint64 revision() const;
+
  private:
   FRIEND_TEST(ComposerTest, ApplyTemporaryInputMode);
 
@@ -265,6 +275,10 @@ class Composer {
                              const size_t size,
                              string *output) const;
 
+  // Updates |revision_| from a process-wide counter; called by every
+  // mutating method.  See revision().
+  void UpdateRevision();
+
   size_t position_;
   // Whether the next insertion is the beginning of typing after an
   // editing command like SetInputMode or not.  Some conversion rules
@@ -290,6 +304,9 @@ class Composer {
 
   size_t max_length_;
 
+  // See revision().
+  uint64 revision_;
+
   const commands::Request *request_;
   const config::Config *config_;
 
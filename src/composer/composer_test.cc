@@ -194,6 +194,33 @@ TEST_F(ComposerTest, Empty) {
   EXPECT_TRUE(composer_->Empty());
 }
 
+TEST_F(ComposerTest, Revision) {
+  // The revision changes on mutations...
+  uint64 revision = composer_->revision();
+  composer_->InsertCharacter("mozuku");
+  EXPECT_NE(revision, composer_->revision());
+
+  revision = composer_->revision();
+  composer_->Backspace();
+  EXPECT_NE(revision, composer_->revision());
+
+  revision = composer_->revision();
+  composer_->SetInputMode(transliteration::FULL_KATAKANA);
+  EXPECT_NE(revision, composer_->revision());
+
+  // ... but not on queries.
+  revision = composer_->revision();
+  string result;
+  composer_->GetStringForPreedit(&result);
+  composer_->GetQueryForConversion(&result);
+  EXPECT_EQ(revision, composer_->revision());
+
+  // Copies do not share the revision of the source.
+  Composer dest(table_.get(), request_.get(), config_.get());
+  dest.CopyFrom(*composer_);
+  EXPECT_NE(composer_->revision(), dest.revision());
+}
+
 TEST_F(ComposerTest, EnableInsert) {
   composer_->set_max_length(6);
 
@@ -82,6 +82,11 @@ class CompositionInterface {
 
   virtual size_t GetLength() const = 0;
 
+  // Return the byte size of the raw input, i.e. the size of the string
+  // GetStringWithTransliterator() builds for
+  // Transliterators::RAW_STRING, without building it.
+  virtual size_t GetRawInputSize() const = 0;
+
   // Return string with the default translitarator of each char_chunk
   // and TrimeMode::ASIS.
   virtual void GetString(string *composition) const = 0;
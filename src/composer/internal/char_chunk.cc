@@ -29,8 +29,10 @@
 
 #include "composer/internal/char_chunk.h"
 
+#include <map>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/logging.h"
@@ -123,21 +125,67 @@ void CharChunk::Clear() {
   ambiguous_.clear();
 }
 
+const CharChunk::T13nMemoEntry &CharChunk::GetT13nMemoEntry(
+    Transliterators::Transliterator t12r) const {
+  // The result depends only on the resolved transliterator and the two
+  // strings below, so comparing them against the memoized sources is
+  // enough to reuse the previous results; see the comment on
+  // |t13n_memo_| in the header.
+  const Transliterators::Transliterator t12r_resolved =
+      GetTransliterator(t12r);
+  const string raw = Table::DeleteSpecialKey(raw_);
+  const string converted = Table::DeleteSpecialKey(conversion_ + pending_);
+  if (t13n_memo_raw_ != raw || t13n_memo_converted_ != converted) {
+    t13n_memo_.clear();
+    t13n_memo_raw_ = raw;
+    t13n_memo_converted_ = converted;
+  }
+  std::map<Transliterators::Transliterator, T13nMemoEntry>::iterator it =
+      t13n_memo_.find(t12r_resolved);
+  if (it == t13n_memo_.end()) {
+    T13nMemoEntry entry;
+    entry.text = Transliterators::GetTransliterator(t12r_resolved)
+        ->Transliterate(raw, converted);
+    entry.length = Util::CharsLen(entry.text);
+    it = t13n_memo_.insert(std::make_pair(t12r_resolved, entry)).first;
+  }
+  return it->second;
+}
+
+const string &CharChunk::GetTransliteratedResult(
+    Transliterators::Transliterator t12r) const {
+  return GetT13nMemoEntry(t12r).text;
+}
+
+size_t CharChunk::GetRawSize() const {
+  // Equals Table::DeleteSpecialKey(raw_).size() without building the
+  // string: the special keys are enclosed in the "\x0F"..."\x0E"
+  // markers and do not appear in the raw string.
+  size_t size = 0;
+  for (size_t cursor = 0; cursor < raw_.size();) {
+    const size_t open_pos = raw_.find('\x0F', cursor);
+    if (open_pos == string::npos) {
+      size += raw_.size() - cursor;
+      break;
+    }
+    const size_t close_pos = raw_.find('\x0E', open_pos);
+    if (close_pos == string::npos) {
+      size += raw_.size() - cursor;
+      break;
+    }
+    size += open_pos - cursor;
+    cursor = close_pos + 1;
+  }
+  return size;
+}
+
 size_t CharChunk::GetLength(Transliterators::Transliterator t12r) const {
-  const string t13n = Transliterate(
-      t12r,
-      Table::DeleteSpecialKey(raw_),
-      Table::DeleteSpecialKey(conversion_ + pending_));
-  return Util::CharsLen(t13n);
+  return GetT13nMemoEntry(t12r).length;
 }
 
 void CharChunk::AppendResult(Transliterators::Transliterator t12r,
                              string *result) const {
-  const string t13n = Transliterate(
-      t12r,
-      Table::DeleteSpecialKey(raw_),
-      Table::DeleteSpecialKey(conversion_ + pending_));
-  result->append(t13n);
+  result->append(GetTransliteratedResult(t12r));
 }
 
 void CharChunk::AppendTrimedResult(Transliterators::Transliterator t12r,
@@ -30,6 +30,7 @@
 #ifndef MOZC_COMPOSER_INTERNAL_CHAR_CHUNK_H_
 #define MOZC_COMPOSER_INTERNAL_CHAR_CHUNK_H_
 
+#include <map>
 #include <set>
 #include <string>
 
@@ -61,6 +62,11 @@ class CharChunk {
 
   size_t GetLength(Transliterators::Transliterator transliterator) const;
 
+  // Return the byte size of the raw string of this chunk, i.e. the
+  // size of the string AppendResult() builds for
+  // Transliterators::RAW_STRING, without building it.
+  size_t GetRawSize() const;
+
   // Append the characters representing this CharChunk accoring to the
   // transliterator.  If the transliterator is LOCAL, the local
   // transliterator specified via SetTransliterator is used.
@@ -163,6 +169,21 @@ class CharChunk {
   FRIEND_TEST(CharChunkTest, Clone);
   FRIEND_TEST(CharChunkTest, GetTransliterator);
 
+  // Returns the transliteration of this chunk under |transliterator|,
+  // serving it from |t13n_memo_| when the chunk content has not changed
+  // since the last call.
+  // Memoized transliterated output of this chunk together with its
+  // length in characters.
+  struct T13nMemoEntry {
+    string text;
+    size_t length;
+  };
+
+  const T13nMemoEntry &GetT13nMemoEntry(
+      Transliterators::Transliterator transliterator) const;
+  const string &GetTransliteratedResult(
+      Transliterators::Transliterator transliterator) const;
+
   Transliterators::Transliterator transliterator_;
   const Table *table_;
 
@@ -171,6 +192,22 @@ class CharChunk {
   string pending_;
   string ambiguous_;
   TableAttributes attributes_;
+
+  // Memo of transliterated results keyed by the resolved
+  // transliterator.  GetLength() and AppendResult() transliterate the
+  // whole chunk content on every call and are invoked for every chunk
+  // whenever the preedit is regenerated, which happens several times
+  // per key event, so the results are cached here.  The character
+  // length is cached with each result so that the cursor and preedit
+  // span bookkeeping in Composition reads a stored offset per chunk
+  // instead of re-decoding the UTF-8 output.  Instead of being
+  // invalidated from every mutator, the memo is validated against the
+  // strings it was computed from, which makes it correct by
+  // construction; only the chunks actually mutated by a key event
+  // recompute their output.
+  mutable string t13n_memo_raw_;
+  mutable string t13n_memo_converted_;
+  mutable std::map<Transliterators::Transliterator, T13nMemoEntry> t13n_memo_;
 };
 
 }  // namespace composer
@@ -218,6 +218,37 @@ TEST(CharChunkTest, GetLength) {
   EXPECT_EQ(2, chunk3.GetLength(Transliterators::HALF_ASCII));
 }
 
+TEST(CharChunkTest, AppendResultAfterMutation) {
+  // AppendResult() and GetLength() memoize the transliterated output.
+  // The memo must not survive a content mutation.
+  CharChunk chunk(Transliterators::CONVERSION_STRING, NULL);
+  chunk.set_conversion("か");
+  chunk.set_raw("ka");
+
+  string result;
+  chunk.AppendResult(Transliterators::CONVERSION_STRING, &result);
+  EXPECT_EQ("か", result);
+  EXPECT_EQ(1, chunk.GetLength(Transliterators::CONVERSION_STRING));
+
+  // Repeated calls return the same output.
+  result.clear();
+  chunk.AppendResult(Transliterators::CONVERSION_STRING, &result);
+  EXPECT_EQ("か", result);
+  result.clear();
+  chunk.AppendResult(Transliterators::RAW_STRING, &result);
+  EXPECT_EQ("ka", result);
+
+  chunk.set_conversion("かん");
+  chunk.set_raw("kan");
+  result.clear();
+  chunk.AppendResult(Transliterators::CONVERSION_STRING, &result);
+  EXPECT_EQ("かん", result);
+  EXPECT_EQ(2, chunk.GetLength(Transliterators::CONVERSION_STRING));
+  result.clear();
+  chunk.AppendResult(Transliterators::RAW_STRING, &result);
+  EXPECT_EQ("kan", result);
+}
+
 TEST(CharChunkTest, AddInputAndConvertedChar) {
   Table table;
   table.AddRule("す゛", "ず", "");
@@ -42,7 +42,10 @@ namespace mozc {
 namespace composer {
 
 Composition::Composition(const Table *table)
-    : table_(table), input_t12r_(Transliterators::CONVERSION_STRING) {}
+    : table_(table), input_t12r_(Transliterators::CONVERSION_STRING),
+      pivot_valid_(false),
+      pivot_t12r_(Transliterators::CONVERSION_STRING),
+      pivot_start_position_(0) {}
 
 Composition::~Composition() {
   Erase();
@@ -54,6 +57,7 @@ void Composition::Erase() {
     delete *it;
   }
   chunks_.clear();
+  pivot_valid_ = false;
 }
 
 size_t Composition::InsertAt(size_t pos, const string &input) {
@@ -92,6 +96,8 @@ size_t Composition::InsertInput(size_t pos, const CompositionInput &input) {
     left_chunk = InsertChunk(&right_chunk);
     mutable_input.set_is_new_input(false);
   }
+  // The insertion changed the length of the chunk(s) around the pivot.
+  pivot_valid_ = false;
 
   return GetPosition(Transliterators::LOCAL, right_chunk);
 }
@@ -120,12 +126,14 @@ size_t Composition::DeleteAt(const size_t position) {
     if ((*chunk_it)->GetLength(Transliterators::LOCAL) <= 1) {
       delete *chunk_it;
       chunks_.erase(chunk_it);
+      pivot_valid_ = false;
       continue;
     }
 
     CharChunk *left_deleted_chunk_ptr = NULL;
     (*chunk_it)->SplitChunk(Transliterators::LOCAL, 1, &left_deleted_chunk_ptr);
     std::unique_ptr<CharChunk> left_deleted_chunk(left_deleted_chunk_ptr);
+    pivot_valid_ = false;
   }
   return new_position;
 }
@@ -220,6 +228,8 @@ void Composition::SetTransliterator(
     ++chunk_it;
   }
   (*end_it)->SetTransliterator(transliterator);
+  // Changing transliterators changes the local lengths of the chunks.
+  pivot_valid_ = false;
 }
 
 Transliterators::Transliterator
@@ -236,6 +246,15 @@ size_t Composition::GetLength() const {
   return GetPosition(Transliterators::LOCAL, chunks_.end());
 }
 
+size_t Composition::GetRawInputSize() const {
+  size_t size = 0;
+  for (CharChunkList::const_iterator it = chunks_.begin();
+       it != chunks_.end(); ++it) {
+    size += (*it)->GetRawSize();
+  }
+  return size;
+}
+
 void Composition::GetStringWithModes(
     Transliterators::Transliterator transliterator,
     const TrimMode trim_mode,
@@ -344,12 +363,26 @@ void Composition::GetChunkAt(const size_t position,
   }
 
   size_t rest_pos = position;
-  CharChunkList::iterator it;
-  for (it = chunks_.begin(); it != chunks_.end(); ++it) {
+  CharChunkList::iterator it = chunks_.begin();
+  // Resume the walk from the pivot of the previous call when possible.
+  // This is valid only for positions strictly behind the pivot: every
+  // chunk before the pivot ends at or before |pivot_start_position_|,
+  // so none of them can be the first chunk covering |position| and the
+  // result is the same as a walk from the head.
+  if (pivot_valid_ && transliterator == pivot_t12r_ &&
+      position > pivot_start_position_) {
+    it = pivot_chunk_it_;
+    rest_pos = position - pivot_start_position_;
+  }
+  for (; it != chunks_.end(); ++it) {
     const size_t chunk_length = (*it)->GetLength(transliterator);
     if (rest_pos <= chunk_length) {
       *inner_position = rest_pos;
       *chunk_it = it;
+      pivot_valid_ = true;
+      pivot_t12r_ = transliterator;
+      pivot_start_position_ = position - rest_pos;
+      pivot_chunk_it_ = it;
       return;
     }
     rest_pos -= chunk_length;
@@ -357,6 +390,7 @@ void Composition::GetChunkAt(const size_t position,
   *chunk_it = chunks_.end();
   --(*chunk_it);
   *inner_position = (**chunk_it)->GetLength(transliterator);
+  pivot_valid_ = false;
 }
 
 size_t Composition::GetPosition(
@@ -391,6 +425,7 @@ CharChunk *Composition::MaybeSplitChunkAt(const size_t pos,
   CharChunk *left_chunk = NULL;
   chunk->SplitChunk(Transliterators::LOCAL, inner_position, &left_chunk);
   chunks_.insert(*it, left_chunk);
+  pivot_valid_ = false;
   return left_chunk;
 }
 
@@ -411,12 +446,14 @@ void Composition::CombinePendingChunks(
     (*it)->Combine(**left_it);
     delete *left_it;
     chunks_.erase(left_it);
+    pivot_valid_ = false;
   }
 }
 
 // Insert a chunk to the prev of it.
 CharChunkList::iterator Composition::InsertChunk(CharChunkList::iterator *it) {
   CharChunk *new_chunk = new CharChunk(input_t12r_, table_);
+  pivot_valid_ = false;
   return chunks_.insert(*it, new_chunk);
 }
 
@@ -476,6 +513,7 @@ void Composition::SetInputMode(Transliterators::Transliterator transliterator) {
 
 void Composition::SetTable(const Table *table) {
   table_ = table;
+  pivot_valid_ = false;
 }
 
 }  // namespace composer
@@ -81,6 +81,7 @@ class Composition : public CompositionInterface {
   virtual Transliterators::Transliterator GetTransliterator(size_t position);
 
   virtual size_t GetLength() const;
+  virtual size_t GetRawInputSize() const;
   virtual void GetString(string *composition) const;
   virtual void GetStringWithTransliterator(
       Transliterators::Transliterator transliterator,
@@ -150,6 +151,17 @@ class Composition : public CompositionInterface {
   CharChunkList chunks_;
   Transliterators::Transliterator input_t12r_;
 
+  // Pivot of the last GetChunkAt() walk: the chunk it found and the
+  // position at which that chunk starts.  Cursor operations cluster
+  // around one spot, so the next walk resumes from the pivot instead
+  // of the list head, which makes them O(1) amortized for long
+  // compositions.  Every mutation of the chunk list or of a chunk's
+  // content invalidates the pivot.
+  bool pivot_valid_;
+  Transliterators::Transliterator pivot_t12r_;
+  size_t pivot_start_position_;
+  CharChunkList::iterator pivot_chunk_it_;
+
   DISALLOW_COPY_AND_ASSIGN(Composition);
 };
 
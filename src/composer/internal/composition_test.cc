@@ -239,6 +239,26 @@ TEST_F(CompositionTest, GetChunkAt) {
   TestGetChunkAt(composition_.get(), Transliterators::RAW_STRING, 13, 4, 3);
 }
 
+TEST_F(CompositionTest, GetChunkAtRepeatedWalk) {
+  InitComposition(composition_.get());
+
+  // Walking back and forth exercises the cached pivot of GetChunkAt():
+  // ascending moves resume from the pivot while backward moves fall
+  // back to a walk from the head, and both must agree.
+  static const size_t kExpected[][2] = {
+      {0, 0}, {0, 1}, {1, 1}, {1, 2}, {2, 1},
+      {3, 1}, {3, 2}, {4, 1}, {4, 2}, {4, 3},
+  };
+  for (int pos = 9; pos >= 0; --pos) {
+    TestGetChunkAt(composition_.get(), Transliterators::CONVERSION_STRING,
+                   pos, kExpected[pos][0], kExpected[pos][1]);
+  }
+  for (int pos = 0; pos <= 9; ++pos) {
+    TestGetChunkAt(composition_.get(), Transliterators::CONVERSION_STRING,
+                   pos, kExpected[pos][0], kExpected[pos][1]);
+  }
+}
+
 TEST_F(CompositionTest, GetString) {
   InitComposition(composition_.get());
   string composition;
@@ -372,6 +392,24 @@ TEST_F(CompositionTest, GetLength) {
   EXPECT_EQ(2, composition_->GetLength());
 }
 
+TEST_F(CompositionTest, GetRawInputSize) {
+  EXPECT_EQ(0, composition_->GetRawInputSize());
+
+  AppendChunk("も", "", "mo", composition_.get());
+  AppendChunk("ず", "", "zu", composition_.get());
+  EXPECT_EQ(4, composition_->GetRawInputSize());
+
+  // The size should not count special keys.
+  AppendChunk("", "", Table::ParseSpecialKey("{<}").c_str(),
+              composition_.get());
+  EXPECT_EQ(4, composition_->GetRawInputSize());
+
+  string raw_string;
+  composition_->GetStringWithTransliterator(
+      Transliterators::RAW_STRING, &raw_string);
+  EXPECT_EQ(raw_string.size(), composition_->GetRawInputSize());
+}
+
 TEST_F(CompositionTest, MaybeSplitChunkAt) {
   static const struct TestCase {
     const int position;
@@ -45,20 +45,10 @@ Converter::Converter(const Table& table)
   : table_(table) {}
 
 void Converter::Convert(const string& input, string* output) const {
-  string key = input;
-  output->clear();  // equivalent to output->assign("")
-  while (!key.empty()) {
-    size_t key_length;
-    bool fixed;
-    const Entry* entry = table_.LookUpPrefix(key, &key_length, &fixed);
-    if (entry == NULL) {
-      output->append(key, 0, 1);
-      key.erase(0, 1);
-    } else {
-      output->append(entry->result());
-      key = entry->pending() + key.substr(key_length);
-    }
-  }
+  // Table::ConvertString() performs the per-character LookUpPrefix()
+  // loop that used to live here in a single scan over the compiled
+  // rules, without copying the remainder around at every step.
+  table_.ConvertString(input, output);
 }
 
 }  // namespace composer
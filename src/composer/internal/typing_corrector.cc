@@ -77,6 +77,15 @@ inline int Cost(double prob) {
   return static_cast<int>(-500.0 * log(prob));
 }
 
+// Beam width for the correction search, in cost units.  Cost(prob) is
+// -500 * log(prob), so 6000 corresponds to a probability ratio of
+// about e^12 (~160,000).  A correction that much less probable than
+// the best key sequence never wins against the candidates generated
+// from better sequences, but it would still occupy one of the
+// |max_correction_query_candidates_| slots and trigger its own
+// dictionary lookup in the predictor.
+const int kCorrectionBeamCostDiff = 6000;
+
 }  // namespace
 
 
@@ -134,6 +143,13 @@ void TypingCorrector::InsertCharacter(
   std::partial_sort(tmp.begin(), tmp.begin() + cutoff_size, tmp.end(),
                     KeyAndPenaltyLess());
   tmp.resize(cutoff_size);
+  // Beam pruning: key sequences far less probable than the best one are
+  // dropped here instead of surviving up to the hard candidates limit.
+  // |tmp| is sorted, so trimming the tail is enough.
+  while (tmp.size() > 1 &&
+         tmp.back().second > tmp.front().second + kCorrectionBeamCostDiff) {
+    tmp.pop_back();
+  }
   top_n_.swap(tmp);
 }
 
@@ -413,6 +413,28 @@ TEST_F(TypingCorrectorTest, TypingCorrection) {
   }
 }
 
+TEST_F(TypingCorrectorTest, BeamPruning) {
+  // Even with an effectively unlimited candidates slot, the corrector
+  // keeps only the key sequences whose penalty is within the beam of
+  // the best one (see kCorrectionBeamCostDiff in typing_corrector.cc).
+  TypingCorrector corrector(&qwerty_table_, 1000, 1000);
+  corrector.SetConfig(&config_);
+  ASSERT_TRUE(corrector.IsAvailable());
+
+  InsertOneByOne("orukaresama", &corrector);
+  std::vector<TypeCorrectedQuery> queries;
+  corrector.GetQueriesForPrediction(&queries);
+  ASSERT_FALSE(queries.empty());
+
+  // The intended correction survives the pruning.
+  EXPECT_TRUE(FindKey(queries, "おつかれさま"));
+  // Queries are sorted by penalty and stay within the beam.
+  for (size_t i = 1; i < queries.size(); ++i) {
+    EXPECT_LE(queries[i - 1].cost, queries[i].cost);
+  }
+  EXPECT_LE(queries.back().cost - queries.front().cost, 6000);
+}
+
 TEST_F(TypingCorrectorTest, Invalidate) {
   const CostTableForTest *table = Singleton<CostTableForTest>::get();
 
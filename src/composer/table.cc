@@ -31,18 +31,21 @@
 
 #include "composer/table.h"
 
+#include <algorithm>
 #include <istream>  // NOLINT
 #include <map>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/config_file_stream.h"
 #include "base/file_stream.h"
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "base/trie.h"
 #include "base/util.h"
 #include "composer/internal/typing_model.h"
@@ -101,8 +104,40 @@ Entry::Entry(const string &input,
 // ========================================
 // Table
 // ========================================
+namespace {
+
+// Packs one UTF-8 character (1 to 4 bytes) into an uint32.  The packed
+// values order the characters the same way as a lexicographic byte
+// comparison, since no UTF-8 character is a prefix of another one.
+uint32 PackLookUpKey(const char *data, size_t length) {
+  uint32 key = 0;
+  for (size_t i = 0; i < length; ++i) {
+    key = (key << 8) | static_cast<uint8>(data[i]);
+  }
+  return key;
+}
+
+// Same as PackLookUpKey() except that the character is lowered the way
+// Util::LowerString() lowers it.  Used for case insensitive scans that
+// cannot afford to copy and normalize the whole input up front.
+uint32 PackLookUpKeyLowered(const char *data, size_t length) {
+  size_t mblen = 0;
+  const char32 ucs4 = Util::UTF8ToUCS4(data, data + length, &mblen);
+  // ('A' <= ucs4 && ucs4 <= 'Z') || ('Ａ' <= ucs4 && ucs4 <= 'Ｚ')
+  if ((0x0041 <= ucs4 && ucs4 <= 0x005A) ||
+      (0xFF21 <= ucs4 && ucs4 <= 0xFF3A)) {
+    char lowered[8];
+    const size_t lowered_length = Util::UCS4ToUTF8(ucs4 + 0x0020, lowered);
+    return PackLookUpKey(lowered, lowered_length);
+  }
+  return PackLookUpKey(data, length);
+}
+
+}  // namespace
+
 Table::Table()
     : entries_(new EntryTrie),
+      lookup_states_dirty_(true),
       case_sensitive_(false) {}
 
 Table::~Table() {
@@ -346,6 +381,7 @@ const Entry *Table::AddRuleWithAttributes(const string &escaped_input,
   Entry *entry = new Entry(input, output, pending, attributes);
   entries_->AddEntry(input, entry);
   entry_set_.insert(entry);
+  lookup_states_dirty_ = true;
 
   // Check if the input has a large captal character.
   // Invisible character is exception.
@@ -376,6 +412,7 @@ void Table::DeleteRule(const string &input) {
     DeleteEntry(old_entry);
   }
   entries_->DeleteEntry(input);
+  lookup_states_dirty_ = true;
 }
 
 bool Table::LoadFromString(const string &str) {
@@ -398,20 +435,20 @@ const TypingModel* Table::typing_model() const {
 namespace {
 const char kAttributeDelimiter[] = " ";
 
-TableAttributes ParseAttributes(const string &input) {
+TableAttributes ParseAttributes(StringPiece input) {
   TableAttributes attributes = NO_TABLE_ATTRIBUTE;
 
-  std::vector<string> attribute_strings;
-  Util::SplitStringAllowEmpty(input, kAttributeDelimiter, &attribute_strings);
-
-  for (size_t i = 0; i < attribute_strings.size(); ++i) {
-    if (attribute_strings[i] == "NewChunk") {
+  for (SplitIterator<SingleDelimiter, AllowEmpty> iter(input,
+                                                       kAttributeDelimiter);
+       !iter.Done(); iter.Next()) {
+    const StringPiece attribute_string = iter.Get();
+    if (attribute_string == "NewChunk") {
       attributes |= NEW_CHUNK;
-    } else if (attribute_strings[i] == "NoTransliteration") {
+    } else if (attribute_string == "NoTransliteration") {
       attributes |= NO_TRANSLITERATION;
-    } else if (attribute_strings[i] == "DirectInput") {
+    } else if (attribute_string == "DirectInput") {
       attributes |= DIRECT_INPUT;
-    } else if (attribute_strings[i] == "EndChunk") {
+    } else if (attribute_string == "EndChunk") {
       attributes |= END_CHUNK;
     }
   }
@@ -423,6 +460,8 @@ bool Table::LoadFromStream(std::istream *is) {
   DCHECK(is);
   string line;
   const string empty_pending("");
+  // |rules| is reused across lines; the StringPieces point into |line|.
+  std::vector<StringPiece> rules;
   while (!is->eof()) {
     getline(*is, line);
     Util::ChopReturns(&line);
@@ -430,15 +469,16 @@ bool Table::LoadFromStream(std::istream *is) {
       continue;
     }
 
-    std::vector<string> rules;
+    rules.clear();
     Util::SplitStringAllowEmpty(line, "\t", &rules);
     if (rules.size() == 4) {
       const TableAttributes attributes = ParseAttributes(rules[3]);
-      AddRuleWithAttributes(rules[0], rules[1], rules[2], attributes);
+      AddRuleWithAttributes(string(rules[0]), string(rules[1]),
+                            string(rules[2]), attributes);
     } else if (rules.size() == 3) {
-      AddRule(rules[0], rules[1], rules[2]);
+      AddRule(string(rules[0]), string(rules[1]), string(rules[2]));
     } else if (rules.size() == 2) {
-      AddRule(rules[0], rules[1], empty_pending);
+      AddRule(string(rules[0]), string(rules[1]), empty_pending);
     } else {
       if (line[0] != '#') {
         LOG(ERROR) << "Format error: " << line;
@@ -462,18 +502,183 @@ const Entry *Table::LookUp(const string &input) const {
   return entry;
 }
 
+void Table::CompileLookUpStates() const {
+  // Temporary node-based trie keyed by one UTF-8 character, flattened
+  // into |lookup_states_| and |lookup_transitions_| in BFS order so
+  // that the transitions of each state form one contiguous range.
+  struct BuildNode {
+    BuildNode() : entry(NULL) {}
+    const Entry *entry;
+    std::map<string, BuildNode *> children;
+  };
+
+  std::vector<BuildNode *> nodes;
+  nodes.push_back(new BuildNode);
+  for (EntrySet::const_iterator it = entry_set_.begin();
+       it != entry_set_.end(); ++it) {
+    const string &input = (*it)->input();
+    BuildNode *node = nodes[0];
+    for (size_t pos = 0; pos < input.size(); ) {
+      const size_t char_length =
+          std::min(static_cast<size_t>(Util::OneCharLen(input.data() + pos)),
+                   input.size() - pos);
+      BuildNode **child = &node->children[input.substr(pos, char_length)];
+      if (*child == NULL) {
+        *child = new BuildNode;
+      }
+      node = *child;
+      pos += char_length;
+    }
+    node->entry = *it;
+  }
+
+  lookup_states_.clear();
+  lookup_transitions_.clear();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const BuildNode *node = nodes[i];
+    LookUpState state;
+    state.entry = node->entry;
+    state.transition_begin = static_cast<uint32>(lookup_transitions_.size());
+    // std::map iterates the children in lexicographic order, which is
+    // also the numeric order of the packed keys.
+    for (std::map<string, BuildNode *>::const_iterator it =
+             node->children.begin();
+         it != node->children.end(); ++it) {
+      LookUpTransition transition;
+      transition.key = PackLookUpKey(it->first.data(), it->first.size());
+      transition.state = static_cast<uint32>(nodes.size());
+      lookup_transitions_.push_back(transition);
+      nodes.push_back(it->second);
+    }
+    state.transition_end = static_cast<uint32>(lookup_transitions_.size());
+    lookup_states_.push_back(state);
+  }
+
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    delete nodes[i];
+  }
+  lookup_states_dirty_ = false;
+}
+
 const Entry *Table::LookUpPrefix(const string &input,
                                  size_t *key_length,
                                  bool *fixed) const {
-  const Entry *entry = NULL;
-  if (case_sensitive_) {
-    entries_->LookUpPrefix(input, &entry, key_length, fixed);
-  } else {
-    string normalized_input = input;
+  if (lookup_states_dirty_) {
+    CompileLookUpStates();
+  }
+
+  string normalized_input;
+  const string *key = &input;
+  if (!case_sensitive_) {
+    normalized_input = input;
     Util::LowerString(&normalized_input);
-    entries_->LookUpPrefix(normalized_input, &entry, key_length, fixed);
+    key = &normalized_input;
+  }
+
+  // Follows the transitions character by character as far as possible;
+  // the state where the walk stops determines the result.  This
+  // reproduces the semantics of Trie::LookUpPrefix() without the
+  // per-character string allocations of the node-based trie.
+  uint32 state_index = 0;
+  size_t pos = 0;
+  while (pos < key->size()) {
+    const size_t char_length =
+        std::min(static_cast<size_t>(Util::OneCharLen(key->data() + pos)),
+                 key->size() - pos);
+    const uint32 transition_key = PackLookUpKey(key->data() + pos, char_length);
+    const LookUpState &state = lookup_states_[state_index];
+    const std::vector<LookUpTransition>::const_iterator begin =
+        lookup_transitions_.begin() + state.transition_begin;
+    const std::vector<LookUpTransition>::const_iterator end =
+        lookup_transitions_.begin() + state.transition_end;
+    const std::vector<LookUpTransition>::const_iterator it = std::lower_bound(
+        begin, end, transition_key,
+        [](const LookUpTransition &transition, uint32 packed_key) {
+          return transition.key < packed_key;
+        });
+    if (it == end || it->key != transition_key) {
+      break;
+    }
+    state_index = it->state;
+    pos += char_length;
+  }
+
+  const LookUpState &state = lookup_states_[state_index];
+  *key_length = pos;
+  if (state.entry != NULL) {
+    *fixed = (state.transition_begin == state.transition_end);
+    return state.entry;
+  }
+  *fixed = true;
+  return NULL;
+}
+
+void Table::ConvertString(const string &input, string *output) const {
+  output->clear();
+  if (input.empty()) {
+    return;
+  }
+  if (lookup_states_dirty_) {
+    CompileLookUpStates();
+  }
+
+  // Working buffer holding the not-yet-consumed text.  Pending text is
+  // spliced over the tail of the rule input it replaces, so the
+  // unconsumed remainder never has to be shifted; everything before
+  // |pos| has already been emitted and is dead.
+  string key = input;
+  size_t pos = 0;
+  while (pos < key.size()) {
+    // Follow the transitions as far as possible, as LookUpPrefix() does.
+    uint32 state_index = 0;
+    size_t walk_pos = pos;
+    while (walk_pos < key.size()) {
+      const size_t char_length =
+          std::min(static_cast<size_t>(Util::OneCharLen(key.data() + walk_pos)),
+                   key.size() - walk_pos);
+      const uint32 transition_key =
+          case_sensitive_
+              ? PackLookUpKey(key.data() + walk_pos, char_length)
+              : PackLookUpKeyLowered(key.data() + walk_pos, char_length);
+      const LookUpState &state = lookup_states_[state_index];
+      const std::vector<LookUpTransition>::const_iterator begin =
+          lookup_transitions_.begin() + state.transition_begin;
+      const std::vector<LookUpTransition>::const_iterator end =
+          lookup_transitions_.begin() + state.transition_end;
+      const std::vector<LookUpTransition>::const_iterator it = std::lower_bound(
+          begin, end, transition_key,
+          [](const LookUpTransition &transition, uint32 packed_key) {
+            return transition.key < packed_key;
+          });
+      if (it == end || it->key != transition_key) {
+        break;
+      }
+      state_index = it->state;
+      walk_pos += char_length;
+    }
+
+    const Entry *entry = lookup_states_[state_index].entry;
+    if (entry == NULL) {
+      // No rule; copy one byte through and restart from the next one,
+      // which is what the per-character LookUpPrefix() loop did.
+      output->append(key, pos, 1);
+      ++pos;
+      continue;
+    }
+    output->append(entry->result());
+    const string &pending = entry->pending();
+    if (pending.empty()) {
+      pos = walk_pos;
+    } else if (pending.size() <= walk_pos) {
+      pos = walk_pos - pending.size();
+      key.replace(pos, pending.size(), pending);
+    } else {
+      // The pending text is longer than everything consumed so far;
+      // rebuilding the buffer is unavoidable (and rare).
+      key.replace(0, walk_pos, pending);
+      pos = 0;
+    }
   }
-  return entry;
 }
 
 void Table::LookUpPredictiveAll(const string &input,
@@ -128,6 +128,15 @@ class Table {
                             bool *fixed) const;
   void LookUpPredictiveAll(const string &input,
                            std::vector<const Entry *> *results) const;
+  // Applies the conversion rules to the whole |input| in one scan over
+  // the compiled rules and stores the transliterated text in |output|.
+  // The semantics are those of repeatedly calling LookUpPrefix() on the
+  // remaining text: the rule where the prefix walk stops is applied,
+  // its pending text re-enters the scan, and characters matching no
+  // rule are copied through verbatim.  This is meant for bulk
+  // conversion of complete strings (pasted text, reconversion
+  // readings); incremental typing should keep using LookUpPrefix().
+  void ConvertString(const string &input, string *output) const;
   // TODO(komatsu): Delete this function.
   bool HasSubRules(const string &input) const;
 
@@ -155,11 +164,36 @@ class Table {
   void DeleteEntry(const Entry *entry);
   void ResetEntrySet();
 
+  // Compiles the conversion rules into |lookup_states_| and
+  // |lookup_transitions_|; see the comment on |lookup_states_|.
+  void CompileLookUpStates() const;
+
   typedef Trie<const Entry*> EntryTrie;
   std::unique_ptr<EntryTrie> entries_;
   typedef std::set<const Entry*> EntrySet;
   EntrySet entry_set_;
 
+  // Compiled, immutable form of the conversion rules used by
+  // LookUpPrefix(), which runs for every key event.  The node-based
+  // trie allocates a string per visited character; this flat automaton
+  // walks sorted transition ranges of a single array instead.  It is
+  // (re)compiled lazily on the first lookup after a rule mutation.
+  // The table is shared by the sessions but conversion requests are
+  // serialized by the session layer, so the mutable members need no
+  // locking.
+  struct LookUpState {
+    const Entry *entry;       // Rule ending at this state, or NULL.
+    uint32 transition_begin;  // Range in |lookup_transitions_|.
+    uint32 transition_end;
+  };
+  struct LookUpTransition {
+    uint32 key;    // One UTF-8 character packed into an uint32.
+    uint32 state;  // Index into |lookup_states_|.
+  };
+  mutable std::vector<LookUpState> lookup_states_;
+  mutable std::vector<LookUpTransition> lookup_transitions_;
+  mutable bool lookup_states_dirty_;
+
   // If false, input alphabet characters are normalized to lower
   // characters.  The default value is false.
   bool case_sensitive_;
@@ -143,6 +143,35 @@ TEST_F(TableTest, LookUpPredictiveAll) {
   EXPECT_EQ(6, results.size());
 }
 
+TEST_F(TableTest, ConvertString) {
+  Table table;
+  InitTable(&table);
+
+  string output;
+  table.ConvertString("", &output);
+  EXPECT_EQ("", output);
+
+  table.ConvertString("akika", &output);
+  EXPECT_EQ("あきか", output);
+
+  // "kka" consumes "kk" first, whose pending "k" re-enters the scan.
+  table.ConvertString("kkakki", &output);
+  EXPECT_EQ("っかっき", output);
+
+  // Characters matching no rule are copied through verbatim.
+  table.ConvertString("xaky", &output);
+  EXPECT_EQ("xあky", output);
+
+  // Case insensitive matching keeps unmatched characters as-is.
+  table.ConvertString("KAXnA", &output);
+  EXPECT_EQ("かXな", output);
+
+  // Mutating a rule invalidates the compiled rules used by the scan.
+  table.AddRule("xa", "ぁ", "");
+  table.ConvertString("xaky", &output);
+  EXPECT_EQ("ぁky", output);
+}
+
 TEST_F(TableTest, Punctuations) {
   static const struct TestCase {
     config::Config::PunctuationMethod method;
@@ -467,6 +496,35 @@ TEST_F(TableTest, CaseSensitive) {
   }
 }
 
+TEST_F(TableTest, LookUpPrefixAfterRuleMutation) {
+  Table table;
+  table.AddRule("ka", "か", "");
+
+  const Entry *entry = NULL;
+  size_t key_length = 0;
+  bool fixed = false;
+  entry = table.LookUpPrefix("kan", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("か", entry->result());
+  EXPECT_EQ(2, key_length);
+  EXPECT_TRUE(fixed);
+
+  // Rules added after a lookup must be reflected by the next lookup;
+  // this exercises the recompilation of the lookup states.
+  table.AddRule("kan", "かん", "");
+  entry = table.LookUpPrefix("kan", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("かん", entry->result());
+  EXPECT_EQ(3, key_length);
+  EXPECT_TRUE(fixed);
+
+  entry = table.LookUpPrefix("kao", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("か", entry->result());
+  EXPECT_EQ(2, key_length);
+  EXPECT_FALSE(fixed);
+}
+
 TEST_F(TableTest, CaseSensitivity) {
   commands::Request request;
   {
@@ -92,6 +92,24 @@ class CharacterFormManagerImpl {
   }
 
  private:
+  // A run of consecutive codepoints sharing one form preference.
+  // The active rules compile down to a few dozen such runs, so form
+  // resolution is a binary search over |conversion_ranges_| instead of
+  // a map lookup per candidate character.
+  struct FormRange {
+    uint16 first;
+    uint16 last;
+    Config::CharacterForm form;
+  };
+
+  // Rebuilds |conversion_ranges_| from |conversion_table_|.  Called
+  // whenever the rules change; lookups never see a stale table.
+  void RebuildConversionRanges();
+
+  // Returns the form preference for |ucs2|, or Config::NO_CONVERSION
+  // when no rule covers it.
+  Config::CharacterForm LookupForm(uint16 ucs2) const;
+
   Config::CharacterForm GetCharacterFormFromStorage(uint16 ucs2) const;
 
   void SaveCharacterFormToStorage(uint16 ucs2, Config::CharacterForm);
@@ -110,9 +128,14 @@ class CharacterFormManagerImpl {
 
   LRUStorage *storage_;
 
-  // store the setting of a character
+  // store the setting of a character.  The map is the mutable rule
+  // source; |conversion_ranges_| below is its flattened form used for
+  // lookups.
   std::map<uint16, Config::CharacterForm> conversion_table_;
 
+  // Sorted, non-overlapping runs compiled from |conversion_table_|.
+  std::vector<FormRange> conversion_ranges_;
+
   std::map<uint16, std::vector<uint16>> group_table_;
 
   // When this flag is true,
@@ -249,6 +272,36 @@ CharacterFormManagerImpl::CharacterFormManagerImpl()
 
 CharacterFormManagerImpl::~CharacterFormManagerImpl() {}
 
+Config::CharacterForm CharacterFormManagerImpl::LookupForm(uint16 ucs2) const {
+  // Finds the first range whose |last| is not below |ucs2|; it is the
+  // only candidate that can contain it.
+  const std::vector<FormRange>::const_iterator it = std::lower_bound(
+      conversion_ranges_.begin(), conversion_ranges_.end(), ucs2,
+      [](const FormRange &range, uint16 value) { return range.last < value; });
+  if (it == conversion_ranges_.end() || ucs2 < it->first) {
+    return Config::NO_CONVERSION;
+  }
+  return it->form;
+}
+
+void CharacterFormManagerImpl::RebuildConversionRanges() {
+  conversion_ranges_.clear();
+  // std::map iterates in codepoint order, so merging adjacent entries
+  // with the same form yields sorted, non-overlapping ranges.
+  for (std::map<uint16, Config::CharacterForm>::const_iterator it =
+           conversion_table_.begin();
+       it != conversion_table_.end(); ++it) {
+    if (!conversion_ranges_.empty() &&
+        conversion_ranges_.back().last + 1 == it->first &&
+        conversion_ranges_.back().form == it->second) {
+      conversion_ranges_.back().last = it->first;
+    } else {
+      const FormRange range = { it->first, it->first, it->second };
+      conversion_ranges_.push_back(range);
+    }
+  }
+}
+
 Config::CharacterForm CharacterFormManagerImpl::GetCharacterForm(
     const string &str) const {
   const uint16 ucs2 = GetNormalizedCharacter(str);
@@ -256,17 +309,12 @@ Config::CharacterForm CharacterFormManagerImpl::GetCharacterForm(
     return Config::NO_CONVERSION;
   }
 
-  std::map<uint16, Config::CharacterForm>::const_iterator it =
-      conversion_table_.find(ucs2);
-  if (it == conversion_table_.end()) {
-    return Config::NO_CONVERSION;
-  }
-
-  if (it->second == Config::LAST_FORM) {
+  const Config::CharacterForm form = LookupForm(ucs2);
+  if (form == Config::LAST_FORM) {
     return GetCharacterFormFromStorage(ucs2);
   }
 
-  return it->second;
+  return form;
 }
 
 void CharacterFormManagerImpl::ClearHistory() {
@@ -296,15 +344,8 @@ void CharacterFormManagerImpl::SetCharacterForm(
     return;
   }
 
-  std::map<uint16, Config::CharacterForm>::const_iterator it =
-      conversion_table_.find(ucs2);
-  if (it == conversion_table_.end()) {
-    return;
-  }
-
-  if (it->second == Config::LAST_FORM) {
+  if (LookupForm(ucs2) == Config::LAST_FORM) {
     SaveCharacterFormToStorage(ucs2, form);
-    return;
   }
 }
 
@@ -489,6 +530,7 @@ bool CharacterFormManagerImpl::ConvertStringWithAlternative(
 
 void CharacterFormManagerImpl::Clear() {
   conversion_table_.clear();
+  conversion_ranges_.clear();
   group_table_.clear();
 }
 
@@ -544,6 +586,8 @@ void CharacterFormManagerImpl::AddRule(
       group_table_[ucs2] = group;  // overwrite
     }
   }
+
+  RebuildConversionRanges();
 }
 
 }  // namespace
@@ -582,6 +626,13 @@ CharacterFormManager::Data::Data() {
   conversion_->set_storage(storage_.get());
 }
 
+namespace {
+// Pre-construct the manager at warmup instead of on the first
+// conversion's character form lookup, which loads the form preference
+// storage.
+const SingletonWarmupRegistrar<CharacterFormManager> g_warmup_registrar;
+}  // namespace
+
 CharacterFormManager *CharacterFormManager::GetCharacterFormManager() {
   return Singleton<CharacterFormManager>::get();
 }
@@ -77,7 +77,7 @@ bool GetPlatformSpecificDefaultEmojiSetting() {
 
 class ConfigHandlerImpl {
  public:
-  ConfigHandlerImpl() {
+  ConfigHandlerImpl() : merged_config_(new Config), generation_(0) {
     // <user_profile>/config1.db
     filename_ = kFileNamePrefix;
     filename_ += std::to_string(CONFIG_VERSION);
@@ -87,6 +87,8 @@ class ConfigHandlerImpl {
   }
   virtual ~ConfigHandlerImpl() {}
   bool GetConfig(Config *config) const;
+  std::shared_ptr<const Config> GetSharedConfig() const;
+  uint64 GetConfigGeneration() const;
   const Config &DefaultConfig() const;
   bool GetStoredConfig(Config *config) const;
   bool SetConfig(const Config &config);
@@ -104,8 +106,12 @@ class ConfigHandlerImpl {
   string filename_;
   Config stored_config_;
   Config imposed_config_;
-  // equals to config_.MergeFrom(imposed_config_)
-  Config merged_config_;
+  // Immutable snapshot of stored_config_.MergeFrom(imposed_config_);
+  // replaced as a whole on every change so that handles returned by
+  // GetSharedConfig() stay valid without copying the proto.
+  std::shared_ptr<const Config> merged_config_;
+  // Incremented whenever |merged_config_| is replaced.
+  uint64 generation_;
   Config default_config_;
   mutable Mutex mutex_;
 };
@@ -117,10 +123,20 @@ ConfigHandlerImpl *GetConfigHandlerImpl() {
 // return current Config
 bool ConfigHandlerImpl::GetConfig(Config *config) const {
   scoped_lock lock(&mutex_);
-  config->CopyFrom(merged_config_);
+  config->CopyFrom(*merged_config_);
   return true;
 }
 
+std::shared_ptr<const Config> ConfigHandlerImpl::GetSharedConfig() const {
+  scoped_lock lock(&mutex_);
+  return merged_config_;
+}
+
+uint64 ConfigHandlerImpl::GetConfigGeneration() const {
+  scoped_lock lock(&mutex_);
+  return generation_;
+}
+
 const Config &ConfigHandlerImpl::DefaultConfig() const {
   return default_config_;
 }
@@ -167,8 +183,11 @@ bool ConfigHandlerImpl::SetConfigInternal(const Config &config) {
 }
 
 void ConfigHandlerImpl::UpdateMergedConfig() {
-  merged_config_.CopyFrom(stored_config_);
-  merged_config_.MergeFrom(imposed_config_);
+  std::shared_ptr<Config> merged(new Config);
+  merged->CopyFrom(stored_config_);
+  merged->MergeFrom(imposed_config_);
+  merged_config_ = merged;
+  ++generation_;
 }
 
 bool ConfigHandlerImpl::SetConfig(const Config &config) {
@@ -248,6 +267,14 @@ bool ConfigHandler::GetConfig(Config *config) {
   return GetConfigHandlerImpl()->GetConfig(config);
 }
 
+std::shared_ptr<const Config> ConfigHandler::GetSharedConfig() {
+  return GetConfigHandlerImpl()->GetSharedConfig();
+}
+
+uint64 ConfigHandler::GetConfigGeneration() {
+  return GetConfigHandlerImpl()->GetConfigGeneration();
+}
+
 // Returns Stored Config
 bool ConfigHandler::GetStoredConfig(Config *config) {
   return GetConfigHandlerImpl()->GetStoredConfig(config);
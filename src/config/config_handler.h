@@ -32,6 +32,7 @@
 #ifndef MOZC_CONFIG_CONFIG_HANDLER_H_
 #define MOZC_CONFIG_CONFIG_HANDLER_H_
 
+#include <memory>
 #include <string>
 
 #include "base/port.h"
@@ -50,6 +51,18 @@ class ConfigHandler {
   // Returns current config.
   static bool GetConfig(Config *config);
 
+  // Returns an immutable snapshot of the current config without
+  // copying the proto.  The snapshot stays valid (and unchanged) even
+  // when the config is updated afterwards, so hot paths should fetch
+  // one snapshot per event instead of calling GetConfig().
+  static std::shared_ptr<const Config> GetSharedConfig();
+
+  // Returns a counter which is incremented whenever the result of
+  // GetConfig() may have changed (SetConfig, SetImposedConfig, Reload
+  // and SetConfigFileName).  Callers caching data derived from the
+  // config can compare generations instead of comparing protos.
+  static uint64 GetConfigGeneration();
+
   // Returns stored config.
   // If imposed config is not set, the result is the same as GetConfig().
   static bool GetStoredConfig(Config *config);
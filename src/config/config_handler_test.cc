@@ -34,6 +34,7 @@
 #endif  // OS_WIN
 
 #include <atomic>
+#include <memory>
 #include <string>
 
 #include "base/file_util.h"
@@ -149,6 +150,51 @@ TEST_F(ConfigHandlerTest, SetConfig) {
 #endif  // OS_ANDROID && CHANNEL_DEV
 }
 
+TEST_F(ConfigHandlerTest, SharedConfigAndGeneration) {
+  const string config_file = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                                "mozc_config_test_tmp");
+  FileUtil::Unlink(config_file);
+  ScopedSetConfigFileName scoped_config_file_name(config_file);
+  ASSERT_TRUE(ConfigHandler::Reload())
+      << "failed to reload: " << ConfigHandler::GetConfigFileName();
+
+  // The snapshot matches what GetConfig() copies out.
+  std::shared_ptr<const Config> snapshot = ConfigHandler::GetSharedConfig();
+  Config copied;
+  EXPECT_TRUE(ConfigHandler::GetConfig(&copied));
+  EXPECT_EQ(copied.DebugString(), snapshot->DebugString());
+
+  // Fetching again without a change returns the same object and the
+  // generation stays put.
+  const uint64 generation = ConfigHandler::GetConfigGeneration();
+  EXPECT_EQ(snapshot.get(), ConfigHandler::GetSharedConfig().get());
+  EXPECT_EQ(generation, ConfigHandler::GetConfigGeneration());
+
+  // SetConfig() bumps the generation and replaces the snapshot, but an
+  // already fetched handle keeps observing the old values.
+  Config input;
+  ConfigHandler::GetDefaultConfig(&input);
+  input.set_incognito_mode(!snapshot->incognito_mode());
+  EXPECT_TRUE(ConfigHandler::SetConfig(input));
+  EXPECT_LT(generation, ConfigHandler::GetConfigGeneration());
+  std::shared_ptr<const Config> new_snapshot =
+      ConfigHandler::GetSharedConfig();
+  EXPECT_NE(snapshot.get(), new_snapshot.get());
+  EXPECT_NE(snapshot->incognito_mode(), new_snapshot->incognito_mode());
+
+  // SetImposedConfig() changes the merged config, too.
+  const uint64 set_generation = ConfigHandler::GetConfigGeneration();
+  Config imposed;
+  imposed.set_incognito_mode(true);
+  ConfigHandler::SetImposedConfig(imposed);
+  EXPECT_LT(set_generation, ConfigHandler::GetConfigGeneration());
+  EXPECT_TRUE(ConfigHandler::GetSharedConfig()->incognito_mode());
+
+  // Restore the imposed config.
+  Config empty;
+  ConfigHandler::SetImposedConfig(empty);
+}
+
 TEST_F(ConfigHandlerTest, SetImposedConfig) {
   Config input;
   Config output;
@@ -235,9 +235,9 @@ class AndroidStatsConfigUtilImpl : public StatsConfigUtilInterface {
   virtual ~AndroidStatsConfigUtilImpl() {
   }
   virtual bool IsEnabled() {
-    Config config;
-    ConfigHandler::GetConfig(&config);
-    return config.general_config().upload_usage_stats();
+    // Called per recorded stat; the snapshot avoids copying the proto.
+    return ConfigHandler::GetSharedConfig()
+        ->general_config().upload_usage_stats();
   }
   virtual bool SetEnabled(bool val) {
     // TODO(horo): Implement this.
@@ -257,9 +257,9 @@ class NaclStatsConfigUtilImpl : public StatsConfigUtilInterface {
   virtual ~NaclStatsConfigUtilImpl() {
   }
   virtual bool IsEnabled() {
-    Config config;
-    ConfigHandler::GetConfig(&config);
-    return config.general_config().upload_usage_stats();
+    // Called per recorded stat; the snapshot avoids copying the proto.
+    return ConfigHandler::GetSharedConfig()
+        ->general_config().upload_usage_stats();
   }
   virtual bool SetEnabled(bool val) {
     return false;
@@ -37,8 +37,10 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "base/util.h"
 #include "converter/node.h"
 #include "converter/segments.h"
@@ -139,6 +141,14 @@ inline bool IsConnectedWeakCompound(const std::vector<const Node *> &nodes,
   return false;
 }
 
+// Returns the fingerprint of the candidate value, reusing the one
+// precomputed by NBestGenerator at materialization time when present.
+uint64 ValueFingerprint(const Segment::Candidate &candidate) {
+  return (candidate.value_fingerprint != 0)
+             ? candidate.value_fingerprint
+             : Hash::Fingerprint(candidate.value);
+}
+
 bool IsIsolatedWordOrGeneralSymbol(const dictionary::POSMatcher &pos_matcher,
                                    uint16 pos_id) {
   return pos_matcher.IsIsolatedWord(pos_id) ||
@@ -181,8 +191,78 @@ CandidateFilter::CandidateFilter(
 
 CandidateFilter::~CandidateFilter() {}
 
+namespace {
+// Initial bucket count of SeenSet.  Must be a power of 2.  Large enough
+// for the usual kMaxCandidatesSize expansions without rehashing.
+const size_t kSeenSetInitialSize = 512;
+// Bucket value representing an empty slot.
+const uint64 kSeenSetEmpty = 0;
+}  // namespace
+
+CandidateFilter::SeenSet::SeenSet() : size_(0) {}
+
+CandidateFilter::SeenSet::~SeenSet() {}
+
+void CandidateFilter::SeenSet::Clear() {
+  buckets_.clear();
+  size_ = 0;
+}
+
+size_t CandidateFilter::SeenSet::FindBucket(uint64 fp) const {
+  const size_t mask = buckets_.size() - 1;
+  size_t index = static_cast<size_t>(fp) & mask;
+  while (buckets_[index] != kSeenSetEmpty && buckets_[index] != fp) {
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+bool CandidateFilter::SeenSet::Insert(StringPiece value) {
+  return Insert(Hash::Fingerprint(value));
+}
+
+bool CandidateFilter::SeenSet::Insert(uint64 fp) {
+  if (buckets_.empty()) {
+    buckets_.resize(kSeenSetInitialSize, kSeenSetEmpty);
+  } else if (size_ * 2 >= buckets_.size()) {
+    // Keep the load factor below 0.5 so that probe chains stay short.
+    std::vector<uint64> old_buckets;
+    old_buckets.swap(buckets_);
+    buckets_.resize(old_buckets.size() * 2, kSeenSetEmpty);
+    for (size_t i = 0; i < old_buckets.size(); ++i) {
+      if (old_buckets[i] != kSeenSetEmpty) {
+        buckets_[FindBucket(old_buckets[i])] = old_buckets[i];
+      }
+    }
+  }
+  if (fp == kSeenSetEmpty) {  // do not collide with the empty marker
+    fp = 1;
+  }
+  const size_t index = FindBucket(fp);
+  if (buckets_[index] == fp) {
+    return false;
+  }
+  buckets_[index] = fp;
+  ++size_;
+  return true;
+}
+
+bool CandidateFilter::SeenSet::Contains(StringPiece value) const {
+  return Contains(Hash::Fingerprint(value));
+}
+
+bool CandidateFilter::SeenSet::Contains(uint64 fp) const {
+  if (buckets_.empty()) {
+    return false;
+  }
+  if (fp == kSeenSetEmpty) {
+    fp = 1;
+  }
+  return buckets_[FindBucket(fp)] == fp;
+}
+
 void CandidateFilter::Reset() {
-  seen_.clear();
+  seen_.Clear();
   top_candidate_ = nullptr;
 }
 
@@ -224,7 +304,8 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
       // displayed to users.  Therefore, it's better to filter unfavorable words
       // in this mode.
       CHECK(suggestion_filter_);
-      if (suggestion_filter_->IsBadSuggestion(candidate->value)) {
+      if (suggestion_filter_->IsBadSuggestion(candidate->value,
+                                              ValueFingerprint(*candidate))) {
         return BAD_CANDIDATE;
       }
       // TODO(noriyukit): In the implementation below, the possibility remains
@@ -290,7 +371,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   }
 
   // The candidate is already seen.
-  if (seen_.find(candidate->value) != seen_.end()) {
+  if (seen_.Contains(ValueFingerprint(*candidate))) {
     return CandidateFilter::BAD_CANDIDATE;
   }
 
@@ -492,6 +573,83 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   return CandidateFilter::GOOD_CANDIDATE;
 }
 
+bool CandidateFilter::ExceedsCostBound(
+    const std::vector<const Node *> &nodes,
+    int32 cost, int32 structure_cost,
+    Segments::RequestType request_type) const {
+  // The reverse conversion path only deduplicates; there is no cost
+  // bound to exceed.
+  if (request_type == Segments::REVERSE_CONVERSION) {
+    return false;
+  }
+  // Mirror the conditions under which FilterCandidateInternal() returns
+  // STOP_ENUMERATION for too expensive candidates; see the cost checks
+  // there for the rationale of the offsets.
+  if (top_candidate_ == nullptr ||
+      seen_.size() < static_cast<size_t>(kStopEnmerationCacheSize)) {
+    return false;
+  }
+  DCHECK(!nodes.empty());
+  // Rules running before the cost bound may still accept the candidate.
+  const uint16 lid = nodes.front()->lid;
+  if (lid == pos_matcher_->GetLastNameId() ||
+      lid == pos_matcher_->GetFirstNameId()) {
+    return false;
+  }
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const Node *node = nodes[i];
+    if (node->attributes & Node::USER_DICTIONARY) {
+      return false;
+    }
+    if (node->constrained_prev != NULL ||
+        (node->next != NULL && node->next->constrained_prev == node)) {
+      // CONTEXT_SENSITIVE candidates bypass the cost checks.
+      return false;
+    }
+  }
+  // A candidate sharing the boundary POS ids with a zero-structure-cost
+  // top candidate is accepted regardless of its cost; see the lid/rid
+  // rule in FilterCandidateInternal().
+  if (top_candidate_->structure_cost == 0 &&
+      nodes.front()->lid == top_candidate_->lid &&
+      nodes.back()->rid == top_candidate_->rid) {
+    return false;
+  }
+  // So is a candidate whose functional suffix equals the top candidate's
+  // (the shared non-content-value rule).  Mirror the content split of
+  // NBestGenerator::MakeCandidate(): the non-content part starts at the
+  // first node with a functional lid.  When every node is functional the
+  // real candidate would fall back to an empty suffix; the mismatch here
+  // errs on returning false, which only keeps the enumeration going.
+  if (top_candidate_->content_value != top_candidate_->value) {
+    StringPiece top_suffix(top_candidate_->value);
+    top_suffix.remove_prefix(top_candidate_->content_value.size());
+    size_t first_functional = 0;
+    while (first_functional < nodes.size() &&
+           !pos_matcher_->IsFunctional(nodes[first_functional]->lid)) {
+      ++first_functional;
+    }
+    bool same_suffix = true;
+    for (size_t i = first_functional; i < nodes.size(); ++i) {
+      const string &value = nodes[i]->value;
+      if (value.size() > top_suffix.size() ||
+          top_suffix.substr(0, value.size()) != value) {
+        same_suffix = false;
+        break;
+      }
+      top_suffix.remove_prefix(value.size());
+    }
+    if (same_suffix && top_suffix.empty()) {
+      return false;
+    }
+  }
+  const int64 top_cost = std::max(kMinCost, top_candidate_->cost);
+  const int64 top_structure_cost =
+      std::max(kMinCost, top_candidate_->structure_cost);
+  return (top_cost + kCostOffset < cost &&
+          top_structure_cost + kMinStructureCostOffset < structure_cost);
+}
+
 CandidateFilter::ResultType CandidateFilter::FilterCandidate(
     const string &original_key,
     const Segment::Candidate *candidate,
@@ -501,7 +659,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidate(
     // In reverse conversion, only remove duplicates because the filtering
     // criteria of FilterCandidateInternal() are completely designed for
     // (forward) conversion.
-    const bool inserted = seen_.insert(candidate->value).second;
+    const bool inserted = seen_.Insert(ValueFingerprint(*candidate));
     return inserted ? GOOD_CANDIDATE : BAD_CANDIDATE;
   } else {
     const ResultType result = FilterCandidateInternal(original_key, candidate,
@@ -509,7 +667,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidate(
     if (result != GOOD_CANDIDATE) {
       return result;
     }
-    seen_.insert(candidate->value);
+    seen_.Insert(ValueFingerprint(*candidate));
     return result;
   }
 }
@@ -30,11 +30,11 @@
 #ifndef MOZC_CONVERTER_CANDIDATE_FILTER_H_
 #define MOZC_CONVERTER_CANDIDATE_FILTER_H_
 
-#include <set>
 #include <string>
 #include <vector>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
@@ -70,7 +70,50 @@ class CandidateFilter {
   // Resets the internal state.
   void Reset();
 
+  // Returns true if a candidate assembled from |nodes| with the given
+  // |cost| and |structure_cost| can never survive the cost checks in
+  // FilterCandidate(), so the caller may stop the n-best enumeration
+  // without materializing the candidate at all.  The check is
+  // conservative: it returns false whenever a rule of
+  // FilterCandidateInternal() that overrides the cost bound (user
+  // dictionary, personal names, constrained nodes, lid/rid equal to a
+  // zero-structure-cost top candidate, a functional suffix shared with
+  // the top candidate, ...) could still accept the candidate.
+  bool ExceedsCostBound(const std::vector<const Node *> &nodes,
+                        int32 cost, int32 structure_cost,
+                        Segments::RequestType request_type) const;
+
  private:
+  // Open-addressing set of 64-bit value fingerprints used for
+  // deduplication.  Compared to a set<string>, lookups are a hash plus
+  // a short linear probe instead of O(log n) full string comparisons.
+  // A fingerprint collision can drop a distinct candidate, but with
+  // 64-bit fingerprints and at most a few hundred entries this is
+  // negligible.
+  class SeenSet {
+   public:
+    SeenSet();
+    ~SeenSet();
+
+    void Clear();
+    size_t size() const { return size_; }
+
+    // Inserts the fingerprint of |value| and returns true if it was not
+    // there yet.
+    bool Insert(StringPiece value);
+    bool Contains(StringPiece value) const;
+
+    // Same as above with the fingerprint already computed (e.g. from
+    // Segment::Candidate::value_fingerprint).
+    bool Insert(uint64 fp);
+    bool Contains(uint64 fp) const;
+
+   private:
+    size_t FindBucket(uint64 fp) const;
+    std::vector<uint64> buckets_;
+    size_t size_;
+  };
+
   ResultType FilterCandidateInternal(const string &original_key,
                                      const Segment::Candidate *candidate,
                                      const std::vector<const Node *> &nodes,
@@ -80,7 +123,7 @@ class CandidateFilter {
   const dictionary::POSMatcher *pos_matcher_;
   const SuggestionFilter *suggestion_filter_;
 
-  std::set<string> seen_;
+  SeenSet seen_;
   const Segment::Candidate *top_candidate_;
   bool apply_suggestion_filter_for_exact_match_;
 
@@ -30,10 +30,16 @@
 #include "converter/connector.h"
 
 #include <algorithm>
+#include <string>
 
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/stl_util.h"
+#include "base/string_piece.h"
+#include "base/system_util.h"
 #include "data_manager/data_manager_interface.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
@@ -43,9 +49,22 @@ namespace mozc {
 namespace {
 
 const uint32 kInvalidCacheKey = 0xFFFFFFFF;
+
+// Size of the densely decoded top-left block of the matrix.  256 ids
+// cost 128 KB, which we do not want to spend on mobile.
+#ifdef OS_ANDROID
+const uint16 kHotBlockSize = 0;
+#else  // OS_ANDROID
+const uint16 kHotBlockSize = 256;
+#endif  // OS_ANDROID
 const uint16 kConnectorMagicNumber = 0xCDAB;
 const uint8 kInvalid1ByteCostValue = 255;
 
+// On-disk hot block cache: a 12 byte header (magic, fingerprint of the
+// connection data, block size) followed by the uint16 cost block.
+const uint32 kHotBlockCacheMagic = 0xC0DEC0E2;
+const char kHotBlockCacheFileName[] = "connection_hot_block.cache";
+
 inline uint32 GetHashValue(uint16 rid, uint16 lid, uint32 hash_mask) {
   return (3 * static_cast<uint32>(rid) + lid) & hash_mask;
   // Note: The above value is equivalent to
@@ -59,6 +78,10 @@ inline uint32 EncodeKey(uint16 rid, uint16 lid) {
   return (static_cast<uint32>(rid) << 16) | lid;
 }
 
+inline uint64 EncodeCacheEntry(uint32 key, uint32 value) {
+  return (static_cast<uint64>(key) << 32) | value;
+}
+
 }  // namespace
 
 class Connector::Row {
@@ -119,17 +142,29 @@ Connector *Connector::CreateFromDataManager(
   const char *connection_data = nullptr;
   size_t connection_data_size = 0;
   data_manager.GetConnectorData(&connection_data, &connection_data_size);
-  return new Connector(connection_data, connection_data_size, kCacheSize);
+  // The cache file is shared by all the processes of the user which
+  // load the same connection data; see the constructor below.
+  const string cache_path = FileUtil::JoinPath(
+      SystemUtil::GetUserProfileDirectory(), kHotBlockCacheFileName);
+  return new Connector(connection_data, connection_data_size, kCacheSize,
+                       cache_path);
 }
 
 Connector::Connector(const char *connection_data,
                      size_t connection_size,
                      int cache_size)
+    : Connector(connection_data, connection_size, cache_size, "") {}
+
+Connector::Connector(const char *connection_data,
+                     size_t connection_size,
+                     int cache_size,
+                     const string &cache_path)
     : default_cost_(nullptr),
       cache_size_(cache_size),
       cache_hash_mask_(cache_size - 1),
-      cache_key_(new uint32[cache_size]),
-      cache_value_(new int[cache_size]) {
+      cache_(new uint64[cache_size]),
+      hot_block_data_(nullptr),
+      hot_block_size_(0) {
   const uint16 *ptr = reinterpret_cast<const uint16 *>(connection_data);
   CHECK_EQ(kConnectorMagicNumber, ptr[0]);
   resolution_ = ptr[1];
@@ -173,6 +208,31 @@ Connector::Connector(const char *connection_data,
     offset += 4 + chunk_bits_size + compact_bits_size + values_size;
   }
 
+  // Densely decode the hot block of the matrix, preferably by adopting
+  // the mmapped cache left by a previous process with the same data.
+  hot_block_size_ = std::min(kHotBlockSize, rsize);
+  if (hot_block_size_ > 0) {
+    uint32 fingerprint = 0;
+    if (!cache_path.empty()) {
+      fingerprint = Hash::Fingerprint32(
+          StringPiece(connection_data, connection_size));
+      LoadHotBlockCache(cache_path, fingerprint);
+    }
+    if (hot_block_data_ == nullptr) {
+      hot_block_.reset(new uint16[hot_block_size_ * hot_block_size_]);
+      for (uint16 rid = 0; rid < hot_block_size_; ++rid) {
+        for (uint16 lid = 0; lid < hot_block_size_; ++lid) {
+          hot_block_[rid * hot_block_size_ + lid] =
+              static_cast<uint16>(LookupCost(rid, lid));
+        }
+      }
+      hot_block_data_ = hot_block_.get();
+      if (!cache_path.empty()) {
+        SaveHotBlockCache(cache_path, fingerprint);
+      }
+    }
+  }
+
   // Check if the cache_size is the power of 2 and clear cache.
   DCHECK_EQ(0, cache_size & (cache_size - 1));
   ClearCache();
@@ -182,16 +242,77 @@ Connector::~Connector() {
   STLDeleteElements(&rows_);
 }
 
+bool Connector::LoadHotBlockCache(const string &path, uint32 fingerprint) {
+  if (!hot_block_cache_.Open(path.c_str(), "r")) {
+    return false;
+  }
+  const size_t expected_size =
+      3 * sizeof(uint32) +
+      static_cast<size_t>(hot_block_size_) * hot_block_size_ * sizeof(uint16);
+  if (hot_block_cache_.size() != expected_size) {
+    LOG(WARNING) << "Hot block cache has an unexpected size; ignored";
+    hot_block_cache_.Close();
+    return false;
+  }
+  const uint32 *header =
+      reinterpret_cast<const uint32 *>(hot_block_cache_.begin());
+  if (header[0] != kHotBlockCacheMagic ||
+      header[1] != fingerprint ||
+      header[2] != hot_block_size_) {
+    VLOG(1) << "Hot block cache is stale; ignored";
+    hot_block_cache_.Close();
+    return false;
+  }
+  hot_block_data_ = reinterpret_cast<const uint16 *>(header + 3);
+  return true;
+}
+
+void Connector::SaveHotBlockCache(const string &path,
+                                  uint32 fingerprint) const {
+  // Write to a temporary file first so that a concurrently starting
+  // process never maps a half-written cache; contents for the same
+  // data are identical, so the last rename simply wins.
+  const string tmp_path = path + ".tmp";
+  {
+    OutputFileStream ofs(tmp_path.c_str(),
+                         std::ios_base::out | std::ios_base::binary |
+                         std::ios_base::trunc);
+    if (!ofs.good()) {
+      LOG(WARNING) << "Cannot create hot block cache: " << tmp_path;
+      return;
+    }
+    const uint32 header[3] = {kHotBlockCacheMagic, fingerprint,
+                              hot_block_size_};
+    ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
+    ofs.write(reinterpret_cast<const char *>(hot_block_.get()),
+              static_cast<size_t>(hot_block_size_) * hot_block_size_ *
+              sizeof(uint16));
+    if (!ofs.good()) {
+      LOG(WARNING) << "Failed to write hot block cache: " << tmp_path;
+      ofs.close();
+      FileUtil::Unlink(tmp_path);
+      return;
+    }
+  }
+  if (!FileUtil::AtomicRename(tmp_path, path)) {
+    LOG(WARNING) << "Failed to install hot block cache: " << path;
+    FileUtil::Unlink(tmp_path);
+  }
+}
+
 
 int Connector::GetTransitionCost(uint16 rid, uint16 lid) const {
+  if (rid < hot_block_size_ && lid < hot_block_size_) {
+    return hot_block_data_[rid * hot_block_size_ + lid];
+  }
   const uint32 index = EncodeKey(rid, lid);
   const uint32 bucket = GetHashValue(rid, lid, cache_hash_mask_);
-  if (cache_key_[bucket] == index) {
-    return cache_value_[bucket];
+  const uint64 entry = cache_[bucket];
+  if ((entry >> 32) == index) {
+    return static_cast<int>(entry & 0xFFFFFFFF);
   }
   const int value = LookupCost(rid, lid);
-  cache_key_[bucket] = index;
-  cache_value_[bucket] = value;
+  cache_[bucket] = EncodeCacheEntry(index, static_cast<uint32>(value));
   return value;
 }
 
@@ -200,7 +321,8 @@ int Connector::GetResolution() const {
 }
 
 void Connector::ClearCache() {
-  std::fill(cache_key_.get(), cache_key_.get() + cache_size_, kInvalidCacheKey);
+  std::fill(cache_.get(), cache_.get() + cache_size_,
+            EncodeCacheEntry(kInvalidCacheKey, 0));
 }
 
 int Connector::LookupCost(uint16 rid, uint16 lid) const {
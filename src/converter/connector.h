@@ -31,8 +31,10 @@
 #define MOZC_CONVERTER_CONNECTOR_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "base/mmap.h"
 #include "base/port.h"
 
 namespace mozc {
@@ -48,6 +50,17 @@ class Connector {
 
   Connector(const char *connection_data, size_t connection_size,
             int cache_size);
+
+  // Same as above, but additionally uses |cache_path| as an on-disk
+  // cache of the decoded hot block, keyed by a fingerprint of the
+  // connection data.  When a matching cache file exists it is mmapped
+  // read-only (so concurrent processes share the pages) and the decode
+  // step is skipped; otherwise the block is decoded as usual and the
+  // cache file is written for the next process.  Best effort: any
+  // failure falls back to decoding.
+  Connector(const char *connection_data, size_t connection_size,
+            int cache_size, const string &cache_path);
+
   ~Connector();
 
   int GetTransitionCost(uint16 rid, uint16 lid) const;
@@ -64,10 +77,27 @@ class Connector {
   const uint16 *default_cost_;
   int resolution_;
 
+  // Hot pairs are cached in one array of packed (key, value) entries so
+  // that a probe touches a single cache line; see GetTransitionCost().
   const int cache_size_;
   const uint32 cache_hash_mask_;
-  mutable std::unique_ptr<uint32[]> cache_key_;
-  mutable std::unique_ptr<int[]> cache_value_;
+  mutable std::unique_ptr<uint64[]> cache_;
+
+  // Tries to adopt the on-disk hot block cache at |path|; returns true
+  // and points |hot_block_data_| into the mapping on success.
+  bool LoadHotBlockCache(const string &path, uint32 fingerprint);
+  // Writes the decoded hot block to |path| via an atomic rename.
+  void SaveHotBlockCache(const string &path, uint32 fingerprint) const;
+
+  // The top-left |hot_block_size_| x |hot_block_size_| block of the
+  // matrix, densely decoded at load time.  Lookups inside the block are
+  // a single aligned load instead of the compressed Row decode.
+  // |hot_block_data_| points either at |hot_block_| or into
+  // |hot_block_cache_|, the read-only mapping of the on-disk cache.
+  std::unique_ptr<uint16[]> hot_block_;
+  Mmap hot_block_cache_;
+  const uint16 *hot_block_data_;
+  uint16 hot_block_size_;
 
   DISALLOW_COPY_AND_ASSIGN(Connector);
 };
@@ -35,8 +35,10 @@
 #include <string>
 #include <vector>
 
+#include "base/file_util.h"
 #include "base/mmap.h"
 #include "data_manager/connection_file_reader.h"
+#include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 #include "testing/base/public/mozctest.h"
 
@@ -87,6 +89,45 @@ TEST(ConnectorTest, CompareWithRawData) {
     }
   }
 }
+#if !defined(OS_ANDROID)
+TEST(ConnectorTest, HotBlockCacheRoundTrip) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+
+  const string cache_path =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "connection_hot_block.cache");
+  FileUtil::Unlink(cache_path);
+
+  // The first load decodes the hot block and writes the cache; the
+  // second one adopts the cache.  Both must return the same costs.
+  std::unique_ptr<Connector> first(
+      new Connector(cmmap.begin(), cmmap.size(), 256, cache_path));
+  ASSERT_TRUE(FileUtil::FileExists(cache_path));
+  std::unique_ptr<Connector> second(
+      new Connector(cmmap.begin(), cmmap.size(), 256, cache_path));
+
+  for (uint16 rid = 0; rid < 100; ++rid) {
+    for (uint16 lid = 0; lid < 100; ++lid) {
+      EXPECT_EQ(first->GetTransitionCost(rid, lid),
+                second->GetTransitionCost(rid, lid));
+    }
+  }
+
+  // A cache for different data must be ignored, not adopted.
+  string other_data(cmmap.begin(), cmmap.size());
+  other_data[other_data.size() - 1] ^= 1;
+  std::unique_ptr<Connector> third(
+      new Connector(other_data.data(), other_data.size(), 256, cache_path));
+  for (uint16 rid = 0; rid < 100; ++rid) {
+    for (uint16 lid = 0; lid < 100; ++lid) {
+      EXPECT_EQ(first->GetTransitionCost(rid, lid),
+                third->GetTransitionCost(rid, lid));
+    }
+  }
+}
+#endif  // !OS_ANDROID
 #endif  // !OS_NACL
 
 }  // namespace
@@ -0,0 +1,89 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/conversion_profile.h"
+
+namespace mozc {
+namespace conversion_profile {
+namespace {
+
+bool g_enabled = false;
+Profile g_profile;
+
+}  // namespace
+
+Profile::Profile() {
+  Clear();
+}
+
+void Profile::Clear() {
+  lattice_usec = 0.0;
+  viterbi_usec = 0.0;
+  nbest_usec = 0.0;
+  rewrite_usec = 0.0;
+}
+
+void Enable(bool enable) {
+  g_enabled = enable;
+}
+
+bool IsEnabled() {
+  return g_enabled;
+}
+
+Profile *mutable_profile() {
+  return &g_profile;
+}
+
+void AddLatticeTime(double usec) {
+  if (g_enabled) {
+    g_profile.lattice_usec += usec;
+  }
+}
+
+void AddViterbiTime(double usec) {
+  if (g_enabled) {
+    g_profile.viterbi_usec += usec;
+  }
+}
+
+void AddNBestTime(double usec) {
+  if (g_enabled) {
+    g_profile.nbest_usec += usec;
+  }
+}
+
+void AddRewriteTime(double usec) {
+  if (g_enabled) {
+    g_profile.rewrite_usec += usec;
+  }
+}
+
+}  // namespace conversion_profile
+}  // namespace mozc
@@ -0,0 +1,70 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_CONVERTER_CONVERSION_PROFILE_H_
+#define MOZC_CONVERTER_CONVERSION_PROFILE_H_
+
+#include "base/port.h"
+
+namespace mozc {
+namespace conversion_profile {
+
+// Wall time of the main conversion phases, in microseconds, accumulated
+// since the last Clear().  Filled by the converter only while profiling
+// is enabled; see Enable().
+struct Profile {
+  double lattice_usec;   // dictionary lookup and lattice construction
+  double viterbi_usec;   // (Prediction)Viterbi
+  double nbest_usec;     // segment building and n-best enumeration
+  double rewrite_usec;   // rewriters and candidate suppression
+
+  Profile();
+  void Clear();
+};
+
+// Enables or disables phase profiling.  The converter pays one branch
+// per phase when disabled.  Profiling writes to a process-wide profile
+// without locking, so it must only be enabled in single-threaded tools
+// such as converter_benchmark.
+void Enable(bool enable);
+bool IsEnabled();
+
+// Returns the process-wide profile.
+Profile *mutable_profile();
+
+// Accumulators called by the converter; no-ops while disabled.
+void AddLatticeTime(double usec);
+void AddViterbiTime(double usec);
+void AddNBestTime(double usec);
+void AddRewriteTime(double usec);
+
+}  // namespace conversion_profile
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_CONVERSION_PROFILE_H_
@@ -32,13 +32,18 @@
 #include <algorithm>
 #include <climits>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
+#include "converter/conversion_profile.h"
 #include "converter/immutable_converter_interface.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
@@ -59,6 +64,17 @@ namespace {
 
 const size_t kErrorIndex = static_cast<size_t>(-1);
 
+// Capacity of the POS id inference cache; see CompletePOSIds().  A few
+// hundred entries cover the committed values of a long session, and each
+// entry is just a fingerprint and a handful of integers.
+const size_t kPOSIdsCacheSize = 512;
+const size_t kPOSIdsCacheNumShards = 4;
+
+// Cache key for the (key, value) pair of a candidate.
+uint64 POSIdsCacheFingerprint(const string &key, const string &value) {
+  return Hash::FingerprintWithSeed(value, Hash::Fingerprint32(key));
+}
+
 size_t GetSegmentIndex(const Segments *segments,
                        size_t segment_index) {
   const size_t history_segments_size = segments->history_segments_size();
@@ -208,9 +224,11 @@ bool TryNormalizingKeyAsMathExpression(StringPiece s, string *key) {
 
 }  // namespace
 
-ConverterImpl::ConverterImpl() : pos_matcher_(NULL),
-                                 immutable_converter_(NULL),
-                                 general_noun_id_(kuint16max) {
+ConverterImpl::ConverterImpl()
+    : pos_matcher_(NULL),
+      immutable_converter_(NULL),
+      general_noun_id_(kuint16max),
+      pos_ids_cache_(kPOSIdsCacheSize, kPOSIdsCacheNumShards) {
 }
 
 ConverterImpl::~ConverterImpl() {}
@@ -231,6 +249,7 @@ void ConverterImpl::Init(const POSMatcher *pos_matcher,
 
 bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
                                               Segments *segments) const {
+  ScopedTraceEvent trace_event("ConverterImpl::StartConversionForRequest");
   if (!request.has_composer()) {
     LOG(ERROR) << "Request doesn't have composer";
     return false;
@@ -261,6 +280,7 @@ bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
 
 bool ConverterImpl::StartConversion(Segments *segments,
                                     const string &key) const {
+  ScopedTraceEvent trace_event("ConverterImpl::StartConversion");
   if (key.empty()) {
     return false;
   }
@@ -701,82 +721,64 @@ bool ConverterImpl::ResizeSegment(Segments *segments,
 
   const string cur_segment_key = cur_segment.key();
 
+  // Compute the final boundary layout first, then hand it over to
+  // ApplyNewSegmentBoundaries() so that the reconversion happens exactly
+  // once with all the constraints applied.
+  std::vector<std::pair<string, Segment::SegmentType> > new_segments;
+  size_t resize_size = 1;  // number of segments to be replaced
+
   if (offset_length > 0) {
     int length = offset_length;
+    string new_key = cur_segment_key;
     string last_key;
     size_t last_clen = 0;
-    {
-      string new_key = cur_segment_key;
-      while (segment_index + 1 < segments->segments_size()) {
-        last_key = segments->segment(segment_index + 1).key();
-        segments->erase_segment(segment_index + 1);
-        last_clen = Util::CharsLen(last_key.c_str(), last_key.size());
-        length -= static_cast<int>(last_clen);
-        if (length <= 0) {
-          string tmp;
-          Util::SubString(last_key, 0, length + last_clen, &tmp);
-          new_key += tmp;
-          break;
-        }
-        new_key += last_key;
+    while (segment_index + resize_size < segments->segments_size()) {
+      last_key = segments->segment(segment_index + resize_size).key();
+      ++resize_size;
+      last_clen = Util::CharsLen(last_key.c_str(), last_key.size());
+      length -= static_cast<int>(last_clen);
+      if (length <= 0) {
+        string tmp;
+        Util::SubString(last_key, 0, length + last_clen, &tmp);
+        new_key += tmp;
+        break;
       }
-
-      Segment *segment = segments->mutable_segment(segment_index);
-      segment->Clear();
-      segment->set_segment_type(Segment::FIXED_BOUNDARY);
-      segment->set_key(new_key);
-    }  // scope out |segment|, |new_key|
+      new_key += last_key;
+    }
+    new_segments.push_back(std::make_pair(new_key, Segment::FIXED_BOUNDARY));
 
     if (length < 0) {  // remaining part
-      Segment *segment = segments->insert_segment(segment_index + 1);
-      segment->set_segment_type(Segment::FREE);
-      string new_key;
+      string remaining_key;
       Util::SubString(last_key,
                       static_cast<size_t>(length + last_clen),
-                      static_cast<size_t>(-length), &new_key);
-      segment->set_key(new_key);
+                      static_cast<size_t>(-length), &remaining_key);
+      new_segments.push_back(std::make_pair(remaining_key, Segment::FREE));
     }
-  } else if (offset_length < 0) {
+  } else {  // offset_length < 0
     if (cur_length + offset_length > 0) {
-      Segment *segment1 = segments->mutable_segment(segment_index);
-      segment1->Clear();
-      segment1->set_segment_type(Segment::FIXED_BOUNDARY);
-      string new_key;
+      string head_key;
       Util::SubString(cur_segment_key,
                       0,
                       cur_length + offset_length,
-                      &new_key);
-      segment1->set_key(new_key);
+                      &head_key);
+      new_segments.push_back(
+          std::make_pair(head_key, Segment::FIXED_BOUNDARY));
     }
 
+    string moved_key;
+    Util::SubString(
+        cur_segment_key,
+        std::max(static_cast<size_t>(0), cur_length + offset_length),
+        cur_length, &moved_key);
     if (segment_index + 1 < segments->segments_size()) {
-      Segment *segment2 = segments->mutable_segment(segment_index + 1);
-      segment2->set_segment_type(Segment::FREE);
-      string tmp;
-      Util::SubString(
-          cur_segment_key,
-          std::max(static_cast<size_t>(0), cur_length + offset_length),
-          cur_length, &tmp);
-      tmp += segment2->key();
-      segment2->set_key(tmp);
-    } else {
-      Segment *segment2 = segments->add_segment();
-      segment2->set_segment_type(Segment::FREE);
-      string new_key;
-      Util::SubString(
-          cur_segment_key,
-          std::max(static_cast<size_t>(0), cur_length + offset_length),
-          cur_length, &new_key);
-      segment2->set_key(new_key);
+      ++resize_size;
+      moved_key += segments->segment(segment_index + 1).key();
     }
+    new_segments.push_back(std::make_pair(moved_key, Segment::FREE));
   }
 
-  segments->set_resized(true);
-
-  immutable_converter_->ConvertForRequest(request, segments);
-  RewriteAndSuppressCandidates(request, segments);
-  TrimCandidates(request, segments);
-  return true;
+  return ApplyNewSegmentBoundaries(segments, request, segment_index,
+                                   resize_size, new_segments);
 }
 
 bool ConverterImpl::ResizeSegment(Segments *segments,
@@ -810,29 +812,49 @@ bool ConverterImpl::ResizeSegment(Segments *segments,
 
   size_t consumed = 0;
   const size_t key_len = Util::CharsLen(key);
-  std::vector<string> new_keys;
-  new_keys.reserve(array_size + 1);
+  std::vector<std::pair<string, Segment::SegmentType> > new_segments;
+  new_segments.reserve(array_size + 1);
 
   for (size_t i = 0; i < array_size; ++i) {
     if (new_size_array[i] != 0 && consumed < key_len) {
-      new_keys.push_back(Util::SubString(key, consumed, new_size_array[i]));
+      new_segments.push_back(
+          std::make_pair(Util::SubString(key, consumed, new_size_array[i]),
+                         Segment::FIXED_BOUNDARY));
       consumed += new_size_array[i];
     }
   }
   if (consumed < key_len) {
-    new_keys.push_back(Util::SubString(key, consumed, key_len - consumed));
+    new_segments.push_back(
+        std::make_pair(Util::SubString(key, consumed, key_len - consumed),
+                       Segment::FIXED_BOUNDARY));
   }
 
-  segments->erase_segments(start_segment_index, segments_size);
+  return ApplyNewSegmentBoundaries(segments, request, start_segment_index,
+                                   segments_size, new_segments);
+}
 
-  for (size_t i = 0; i < new_keys.size(); ++i) {
-    Segment *seg = segments->insert_segment(start_segment_index + i);
-    seg->set_segment_type(Segment::FIXED_BOUNDARY);
-    seg->set_key(new_keys[i]);
+bool ConverterImpl::ApplyNewSegmentBoundaries(
+    Segments *segments,
+    const ConversionRequest &request,
+    size_t start_segment_index,
+    size_t segments_size,
+    const std::vector<std::pair<string, Segment::SegmentType> >
+        &new_segments) const {
+  if (new_segments.empty()) {
+    return false;
   }
 
+  segments->erase_segments(start_segment_index, segments_size);
+  for (size_t i = 0; i < new_segments.size(); ++i) {
+    Segment *seg = segments->insert_segment(start_segment_index + i);
+    seg->set_segment_type(new_segments[i].second);
+    seg->set_key(new_segments[i].first);
+  }
   segments->set_resized(true);
 
+  // The total key is unchanged by a resize, so the reconversion reuses
+  // the lattice cached in |segments| and only re-runs the parts
+  // invalidated by the new boundary constraints.
   immutable_converter_->ConvertForRequest(request, segments);
   RewriteAndSuppressCandidates(request, segments);
   TrimCandidates(request, segments);
@@ -853,6 +875,25 @@ void ConverterImpl::CompletePOSIds(Segment::Candidate *candidate) const {
   // "する" "して", which are not always acceptable for non-sahen words.
   candidate->lid = general_noun_id_;
   candidate->rid = general_noun_id_;
+
+  // Commits of the same value repeat heavily within a session, and the
+  // trial conversions below are a full ImmutableConverter invocation, so
+  // consult the cache first.  Failed inferences are cached too; they are
+  // the most expensive case.
+  const uint64 fingerprint =
+      POSIdsCacheFingerprint(candidate->key, candidate->value);
+  POSIdsCacheEntry entry;
+  if (pos_ids_cache_.Lookup(fingerprint, &entry)) {
+    if (entry.found) {
+      candidate->lid = entry.lid;
+      candidate->rid = entry.rid;
+      candidate->cost = entry.cost;
+      candidate->wcost = entry.wcost;
+      candidate->structure_cost = entry.structure_cost;
+    }
+    return;
+  }
+
   const size_t kExpandSizeStart = 5;
   const size_t kExpandSizeDiff = 50;
   const size_t kExpandSizeMax = 80;
@@ -876,10 +917,26 @@ void ConverterImpl::CompletePOSIds(Segment::Candidate *candidate) const {
       LOG(ERROR) << "ImmutableConverter::Convert() failed";
       return;
     }
+    bool found = false;
     for (size_t i = 0; i < segments.segment(0).candidates_size(); ++i) {
       const Segment::Candidate &ref_candidate =
           segments.segment(0).candidate(i);
-      if (ref_candidate.value == candidate->value) {
+      // The trial enumerated the ids of every candidate of the key, not
+      // just the one being committed; record them all so that a later
+      // commit of a sibling value needs no conversion at all.  The first
+      // occurrence of a value wins, matching the scan order here.
+      const uint64 ref_fingerprint =
+          POSIdsCacheFingerprint(candidate->key, ref_candidate.value);
+      if (!pos_ids_cache_.HasKey(ref_fingerprint)) {
+        entry.lid = ref_candidate.lid;
+        entry.rid = ref_candidate.rid;
+        entry.cost = ref_candidate.cost;
+        entry.wcost = ref_candidate.wcost;
+        entry.structure_cost = ref_candidate.structure_cost;
+        entry.found = true;
+        pos_ids_cache_.Insert(ref_fingerprint, entry);
+      }
+      if (!found && ref_candidate.value == candidate->value) {
         candidate->lid = ref_candidate.lid;
         candidate->rid = ref_candidate.rid;
         candidate->cost = ref_candidate.cost;
@@ -887,10 +944,20 @@ void ConverterImpl::CompletePOSIds(Segment::Candidate *candidate) const {
         candidate->structure_cost = ref_candidate.structure_cost;
         VLOG(1) << "Set LID: " << candidate->lid;
         VLOG(1) << "Set RID: " << candidate->rid;
-        return;
+        found = true;
       }
     }
+    if (found) {
+      return;
+    }
   }
+  entry.lid = general_noun_id_;
+  entry.rid = general_noun_id_;
+  entry.cost = 0;
+  entry.wcost = 0;
+  entry.structure_cost = 0;
+  entry.found = false;
+  pos_ids_cache_.Insert(fingerprint, entry);
   DVLOG(2) << "Cannot set lid/rid. use default value. "
            << "key: " << candidate->key << ", "
            << "value: " << candidate->value << ", "
@@ -900,6 +967,20 @@ void ConverterImpl::CompletePOSIds(Segment::Candidate *candidate) const {
 
 void ConverterImpl::RewriteAndSuppressCandidates(
     const ConversionRequest &request, Segments *segments) const {
+  const bool profiling = conversion_profile::IsEnabled();
+  Stopwatch stopwatch;
+  if (profiling) {
+    stopwatch.Start();
+  }
+  RewriteAndSuppressCandidatesInternal(request, segments);
+  if (profiling) {
+    stopwatch.Stop();
+    conversion_profile::AddRewriteTime(stopwatch.GetElapsedMicroseconds());
+  }
+}
+
+void ConverterImpl::RewriteAndSuppressCandidatesInternal(
+    const ConversionRequest &request, Segments *segments) const {
   if (!rewriter_->Rewrite(request, segments)) {
     return;
   }
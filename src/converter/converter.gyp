@@ -48,7 +48,9 @@
         '../protocol/protocol.gyp:commands_proto',
         '../request/request.gyp:conversion_request',
         '../rewriter/rewriter.gyp:rewriter',
+        '../storage/storage.gyp:storage',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
+        'converter_base.gyp:conversion_profile',
         'converter_base.gyp:immutable_converter',
         'converter_base.gyp:immutable_converter_interface',
         'converter_base.gyp:segmenter',
@@ -32,10 +32,14 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "base/port.h"
 #include "converter/converter_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "storage/sharded_lru_cache.h"
 //  for FRIEND_TEST()
 #include "testing/base/public/gunit_prod.h"
 
@@ -124,6 +128,7 @@ class ConverterImpl : public ConverterInterface {
 
  private:
   FRIEND_TEST(ConverterTest, CompletePOSIds);
+  FRIEND_TEST(ConverterTest, CompletePOSIdsCache);
   FRIEND_TEST(ConverterTest, DefaultPredictor);
   FRIEND_TEST(ConverterTest, MaybeSetConsumedKeySizeToSegment);
   FRIEND_TEST(ConverterTest, GetLastConnectivePart);
@@ -133,13 +138,42 @@ class ConverterImpl : public ConverterInterface {
   // input hiragana sequence only with composition mode. Converter
   // cannot know which POS ids should be used for these directly-
   // input strings. This function estimates IDs from value heuristically.
+  // Inferred ids are cached in |pos_ids_cache_|; on a hit the trial
+  // conversions are skipped entirely.
   void CompletePOSIds(Segment::Candidate *candidate) const;
 
+  // Cached result of CompletePOSIds(), keyed by the fingerprint of the
+  // candidate's (key, value) pair.  |found| is false when the trial
+  // conversions could not find the value; in that case only the default
+  // ids apply and the cost fields are meaningless.
+  struct POSIdsCacheEntry {
+    uint16 lid;
+    uint16 rid;
+    int32 cost;
+    int32 wcost;
+    int32 structure_cost;
+    bool found;
+  };
+
   bool CommitSegmentValueInternal(Segments *segments,
                                   size_t segment_index,
                                   int candidate_index,
                                   Segment::SegmentType segment_type) const;
 
+  // Shared core of the two ResizeSegment() overloads.  Replaces
+  // [start_segment_index, start_segment_index + segments_size) with the
+  // segments described by |new_segments| (key and type pairs), then
+  // reconverts with all the boundary constraints applied in a single
+  // pass.  The conversion reuses the lattice cached in |segments|; since
+  // the total key does not change on resize, the rebuild is incremental.
+  bool ApplyNewSegmentBoundaries(
+      Segments *segments,
+      const ConversionRequest &request,
+      size_t start_segment_index,
+      size_t segments_size,
+      const std::vector<std::pair<string, Segment::SegmentType> >
+          &new_segments) const;
+
   // Sets all the candidates' attribute PARTIALLY_KEY_CONSUMED
   // and consumed_key_size if the attribute is not set.
   static void MaybeSetConsumedKeySizeToCandidate(size_t consumed_key_size,
@@ -150,9 +184,13 @@ class ConverterImpl : public ConverterInterface {
   static void MaybeSetConsumedKeySizeToSegment(size_t consumed_key_size,
                                                Segment* segment);
 
-  // Rewrites and applies the suppression dictionary.
+  // Rewrites and applies the suppression dictionary.  The outer function
+  // only adds phase profiling (see converter/conversion_profile.h) around
+  // the actual work.
   void RewriteAndSuppressCandidates(const ConversionRequest &request,
                                     Segments *segments) const;
+  void RewriteAndSuppressCandidatesInternal(const ConversionRequest &request,
+                                            Segments *segments) const;
 
   // Limits the number of candidates based on a request.
   // This method doesn't drop meta candidates for T13n conversion.
@@ -179,6 +217,12 @@ class ConverterImpl : public ConverterInterface {
   std::unique_ptr<RewriterInterface> rewriter_;
   const ImmutableConverterInterface *immutable_converter_;
   uint16 general_noun_id_;
+
+  // Bounded cache for CompletePOSIds().  Trial conversions on the commit
+  // path are a full ImmutableConverter invocation, while committed
+  // values repeat heavily within a session; every candidate enumerated
+  // by a trial is recorded, not just the one that matched.
+  mutable storage::ShardedLRUCache<uint64, POSIdsCacheEntry> pos_ids_cache_;
 };
 
 }  // namespace mozc
@@ -70,6 +70,26 @@
         '../base/base.gyp:base',
       ],
     },
+    {
+      'target_name': 'conversion_profile',
+      'type': 'static_library',
+      'sources': [
+        'conversion_profile.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+      ],
+    },
+    {
+      'target_name': 'key_corrector',
+      'type': 'static_library',
+      'sources': [
+        'key_corrector.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+      ],
+    },
     {
       'target_name': 'segments',
       'type': 'static_library',
@@ -78,6 +98,7 @@
         'candidate_filter.cc',
         'nbest_generator.cc',
         'segments.cc',
+        'segments_codec.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
@@ -85,6 +106,7 @@
         '../prediction/prediction_base.gyp:suggestion_filter',
         '../transliteration/transliteration.gyp:transliteration',
         'connector',
+        'key_corrector',
         'lattice',
         'segmenter',
       ],
@@ -112,9 +134,23 @@
     {
       'target_name': 'immutable_converter',
       'type': 'static_library',
+      'variables': {
+        # Set 1 to evaluate Viterbi end-node columns with SSE instructions.
+        'enable_simd_viterbi%': 0,
+        # Set 1 to run the per-position dictionary lookups of long
+        # conversion keys on a pool of worker threads.
+        'enable_parallel_lattice_lookup%': 0,
+      },
       'sources': [
         'immutable_converter.cc',
-        'key_corrector.cc',
+      ],
+      'conditions': [
+        ['enable_simd_viterbi==1', {
+          'defines': ['MOZC_ENABLE_SIMD_VITERBI'],
+        }],
+        ['enable_parallel_lattice_lookup==1', {
+          'defines': ['MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP'],
+        }],
       ],
       'dependencies': [
         '../base/base.gyp:base',
@@ -125,8 +161,11 @@
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
         '../rewriter/rewriter_base.gyp:gen_rewriter_files#host',
+        '../storage/storage.gyp:storage',
         'connector',
+        'conversion_profile',
         'immutable_converter_interface',
+        'key_corrector',
         'segmenter',
         'segments',
       ],
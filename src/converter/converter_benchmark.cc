@@ -0,0 +1,217 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Conversion throughput benchmark: replays the TSV corpora of the
+// quality regression test through StartConversionForRequest() and
+// reports per-phase latency percentiles, optionally as a JSON report.
+// Companion of quality_regression_main.cc, which replays the same
+// corpora but measures correctness only.
+//
+// Usage:
+//   converter_benchmark --test_file=regression.tsv \
+//       [--iterations=3] [--json_output=report.json]
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "converter/conversion_profile.h"
+#include "converter/converter_interface.h"
+#include "converter/quality_regression_util.h"
+#include "converter/segments.h"
+#include "engine/engine_factory.h"
+#include "engine/engine_interface.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+DEFINE_string(test_file, "", "regression test file (TSV)");
+DEFINE_int32(iterations, 1, "number of replays of the whole corpus");
+DEFINE_string(json_output, "", "file to write the JSON report to");
+
+using mozc::quality_regression::QualityRegressionUtil;
+
+namespace mozc {
+namespace {
+
+// Latency samples of one conversion phase, in microseconds.
+struct PhaseSamples {
+  const char *name;
+  std::vector<double> usec;
+
+  explicit PhaseSamples(const char *phase_name) : name(phase_name) {}
+};
+
+double GetPercentile(const std::vector<double> &sorted_samples, double p) {
+  CHECK(!sorted_samples.empty());
+  const double rank = p * (sorted_samples.size() - 1);
+  const size_t lower = static_cast<size_t>(rank);
+  const size_t upper = std::min(lower + 1, sorted_samples.size() - 1);
+  const double fraction = rank - lower;
+  return sorted_samples[lower] * (1.0 - fraction) +
+         sorted_samples[upper] * fraction;
+}
+
+void PrintPhase(const PhaseSamples &phase, std::ostream *os) {
+  std::vector<double> sorted = phase.usec;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0.0;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    total += sorted[i];
+  }
+  *os << phase.name
+      << "\tmean: " << total / sorted.size()
+      << "\tp50: " << GetPercentile(sorted, 0.50)
+      << "\tp90: " << GetPercentile(sorted, 0.90)
+      << "\tp95: " << GetPercentile(sorted, 0.95)
+      << "\tp99: " << GetPercentile(sorted, 0.99)
+      << "\tmax: " << sorted.back()
+      << "\t(usec, " << sorted.size() << " samples)" << std::endl;
+}
+
+void AppendPhaseJson(const PhaseSamples &phase, bool last, string *json) {
+  std::vector<double> sorted = phase.usec;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0.0;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    total += sorted[i];
+  }
+  json->append(Util::StringPrintf(
+      "  \"%s\": {\"samples\": %d, \"mean_usec\": %.3f, "
+      "\"p50_usec\": %.3f, \"p90_usec\": %.3f, \"p95_usec\": %.3f, "
+      "\"p99_usec\": %.3f, \"max_usec\": %.3f}%s\n",
+      phase.name,
+      static_cast<int>(sorted.size()),
+      total / sorted.size(),
+      GetPercentile(sorted, 0.50),
+      GetPercentile(sorted, 0.90),
+      GetPercentile(sorted, 0.95),
+      GetPercentile(sorted, 0.99),
+      sorted.back(),
+      last ? "" : ","));
+}
+
+int Run() {
+  std::unique_ptr<EngineInterface> engine(EngineFactory::Create());
+  ConverterInterface *converter = engine->GetConverter();
+  CHECK(converter);
+
+  std::vector<QualityRegressionUtil::TestItem> items;
+  if (!QualityRegressionUtil::ParseFile(FLAGS_test_file, &items)) {
+    LOG(ERROR) << "Cannot parse " << FLAGS_test_file;
+    return 1;
+  }
+
+  const commands::Request default_request;
+  const config::Config default_config;
+  composer::Table table;
+
+  PhaseSamples total_samples("total");
+  PhaseSamples lattice_samples("lattice");
+  PhaseSamples viterbi_samples("viterbi");
+  PhaseSamples nbest_samples("nbest");
+  PhaseSamples rewrite_samples("rewrite");
+
+  conversion_profile::Enable(true);
+  conversion_profile::Profile *profile = conversion_profile::mutable_profile();
+
+  Segments segments;
+  for (int iteration = 0; iteration < FLAGS_iterations; ++iteration) {
+    for (size_t i = 0; i < items.size(); ++i) {
+      const string &key = items[i].key;
+      if (key.empty()) {
+        continue;
+      }
+      composer::Composer composer(&table, &default_request, &default_config);
+      composer.SetPreeditTextForTestOnly(key);
+      const ConversionRequest request(&composer, &default_request,
+                                      &default_config);
+
+      profile->Clear();
+      Stopwatch stopwatch = Stopwatch::StartNew();
+      converter->StartConversionForRequest(request, &segments);
+      stopwatch.Stop();
+
+      total_samples.usec.push_back(stopwatch.GetElapsedMicroseconds());
+      lattice_samples.usec.push_back(profile->lattice_usec);
+      viterbi_samples.usec.push_back(profile->viterbi_usec);
+      nbest_samples.usec.push_back(profile->nbest_usec);
+      rewrite_samples.usec.push_back(profile->rewrite_usec);
+    }
+  }
+  conversion_profile::Enable(false);
+
+  if (total_samples.usec.empty()) {
+    LOG(ERROR) << "No convertible items in " << FLAGS_test_file;
+    return 1;
+  }
+
+  PrintPhase(total_samples, &std::cout);
+  PrintPhase(lattice_samples, &std::cout);
+  PrintPhase(viterbi_samples, &std::cout);
+  PrintPhase(nbest_samples, &std::cout);
+  PrintPhase(rewrite_samples, &std::cout);
+
+  if (!FLAGS_json_output.empty()) {
+    string json = "{\n";
+    AppendPhaseJson(total_samples, false, &json);
+    AppendPhaseJson(lattice_samples, false, &json);
+    AppendPhaseJson(viterbi_samples, false, &json);
+    AppendPhaseJson(nbest_samples, false, &json);
+    AppendPhaseJson(rewrite_samples, true, &json);
+    json.append("}\n");
+    std::ofstream ofs(FLAGS_json_output.c_str());
+    if (!ofs) {
+      LOG(ERROR) << "Cannot open " << FLAGS_json_output;
+      return 1;
+    }
+    ofs << json;
+  }
+
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  return mozc::Run();
+}
@@ -52,5 +52,24 @@
         'converter_base.gyp:segments',
       ],
     },
+    {
+      'target_name': 'converter_benchmark',
+      'type': 'executable',
+      'sources': [
+        'converter_benchmark.cc',
+        'quality_regression_util.cc',
+      ],
+      'dependencies': [
+        '../composer/composer.gyp:composer',
+        '../engine/engine.gyp:engine',
+        '../engine/engine.gyp:engine_factory',
+        '../protocol/protocol.gyp:commands_proto',
+        '../protocol/protocol.gyp:config_proto',
+        '../request/request.gyp:conversion_request',
+        'converter.gyp:converter',
+        'converter_base.gyp:conversion_profile',
+        'converter_base.gyp:segments',
+      ],
+    },
   ],
 }
@@ -940,6 +940,64 @@ TEST_F(ConverterTest, CompletePOSIds) {
   }
 }
 
+TEST_F(ConverterTest, CompletePOSIdsCache) {
+  std::unique_ptr<ConverterAndData> converter_and_data(
+      CreateStubbedConverterAndData());
+  ConverterImpl *converter = converter_and_data->converter.get();
+
+  Segments segments;
+  segments.set_request_type(Segments::PREDICTION);
+  Segment *seg = segments.add_segment();
+  seg->set_key("わたしのなまえはなかのです");
+  seg->set_segment_type(Segment::FREE);
+  segments.set_max_prediction_candidates_size(20);
+  CHECK(converter_and_data->immutable_converter->Convert(&segments));
+
+  Segment::Candidate candidate;
+  candidate.key = segments.segment(0).candidate(0).key;
+  candidate.value = segments.segment(0).candidate(0).value;
+  candidate.lid = 0;
+  candidate.rid = 0;
+  EXPECT_EQ(0, converter->pos_ids_cache_.Size());
+  converter->CompletePOSIds(&candidate);
+  const uint16 lid = candidate.lid;
+  const uint16 rid = candidate.rid;
+  EXPECT_NE(0, lid);
+  EXPECT_NE(0, rid);
+
+  // The trial conversion populates the cache with every enumerated
+  // candidate, so not just the committed value is now known.
+  EXPECT_LT(1, converter->pos_ids_cache_.Size());
+
+  // A repeated commit of the same value must be answered from the cache
+  // with the same ids.
+  candidate.lid = 0;
+  candidate.rid = 0;
+  const size_t cache_size = converter->pos_ids_cache_.Size();
+  converter->CompletePOSIds(&candidate);
+  EXPECT_EQ(lid, candidate.lid);
+  EXPECT_EQ(rid, candidate.rid);
+  EXPECT_EQ(cache_size, converter->pos_ids_cache_.Size());
+
+  // Sibling candidates of the trial are served without any conversion.
+  for (size_t i = 1; i < segments.segment(0).candidates_size(); ++i) {
+    const Segment::Candidate &ref_candidate =
+        segments.segment(0).candidate(i);
+    if (ref_candidate.lid == 0 || ref_candidate.rid == 0) {
+      continue;
+    }
+    Segment::Candidate sibling;
+    sibling.key = candidate.key;
+    sibling.value = ref_candidate.value;
+    sibling.lid = 0;
+    sibling.rid = 0;
+    converter->CompletePOSIds(&sibling);
+    EXPECT_NE(0, sibling.lid);
+    EXPECT_NE(0, sibling.rid);
+    break;
+  }
+}
+
 TEST_F(ConverterTest, Regression3046266) {
   // Shouldn't correct nodes at the beginning of a sentence.
   std::unique_ptr<EngineInterface> engine(MockDataEngineFactory::Create());
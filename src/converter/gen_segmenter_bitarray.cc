@@ -70,6 +70,7 @@ class StateTable {
         compressed_table_[i] = it->second;
       } else {
         compressed_table_[i] = id;
+        representative_.push_back(static_cast<uint16>(i));
         dup.insert(std::make_pair(idarray_[i], id));
         ++id;
       }
@@ -91,6 +92,12 @@ class StateTable {
     return compressed_table_[id];
   }
 
+  // Returns one original id mapped to |compressed_id|.
+  uint16 original_id(uint16 compressed_id) const {
+    CHECK_LT(compressed_id, representative_.size());
+    return representative_[compressed_id];
+  }
+
   size_t compressed_size() const { return compressed_size_; }
 
   void Output(std::ostream *os) {
@@ -102,6 +109,7 @@ class StateTable {
  private:
   std::vector<string> idarray_;
   std::vector<uint16> compressed_table_;
+  std::vector<uint16> representative_;
   size_t compressed_size_;
 
   DISALLOW_COPY_AND_ASSIGN(StateTable);
@@ -163,18 +171,28 @@ void SegmenterBitarrayGenerator::GenerateBitarray(
   CHECK_GT(kCompressedLSize, 0);
   CHECK_GT(kCompressedRSize, 0);
 
-  // make bitarray
-  mozc::BitArray barray(kCompressedLSize * kCompressedRSize);
-  for (size_t rid = 0; rid <= lsize; ++rid) {
-    for (size_t lid = 0; lid <= rsize; ++lid) {
-      const int index = rid + lsize * lid;
-      const uint32 cindex = ltable.id(rid) + kCompressedLSize * rtable.id(lid);
-      if (array[index] > 0) {
-        barray.set(cindex);
-      } else {
-        barray.clear(cindex);
-      }
+  // Make bitarray.  Each compressed cell is determined by one
+  // representative (rid, lid) pair, so the compressed matrix is filled
+  // directly, word by word, instead of writing every cell once per
+  // duplicated row and column.
+  const size_t kCompressedSize = kCompressedLSize * kCompressedRSize;
+  mozc::BitArray barray(kCompressedSize);
+  uint32 word = 0;
+  for (size_t cindex = 0; cindex < kCompressedSize; ++cindex) {
+    const size_t rid = ltable.original_id(cindex % kCompressedLSize);
+    const size_t lid = rtable.original_id(cindex / kCompressedLSize);
+    const size_t index = rid + lsize * lid;
+    CHECK_LT(index, array.size());
+    if (array[index] > 0) {
+      word |= 0x00000001 << (cindex & 0x0000001F);
     }
+    if ((cindex & 0x0000001F) == 0x0000001F) {
+      barray.SetWord(cindex >> 5, word);
+      word = 0;
+    }
+  }
+  if ((kCompressedSize & 0x0000001F) != 0) {
+    barray.SetWord(kCompressedSize >> 5, word);
   }
 
   // verify the table
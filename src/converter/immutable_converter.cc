@@ -37,13 +37,17 @@
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/stl_util.h"
+#include "base/stopwatch.h"
 #include "base/string_piece.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/connector.h"
+#include "converter/conversion_profile.h"
 #include "converter/key_corrector.h"
 #include "converter/lattice.h"
 #include "converter/nbest_generator.h"
@@ -56,21 +60,54 @@
 #include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary.h"
 #include "prediction/suggestion_filter.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 
+// MOZC_ENABLE_SIMD_VITERBI is defined by the build system (see
+// converter_base.gyp).  The vectorized path requires SSE2.
+#if defined(MOZC_ENABLE_SIMD_VITERBI) && defined(__SSE2__)
+#include <emmintrin.h>
+#define MOZC_USE_SIMD_VITERBI
+#endif  // MOZC_ENABLE_SIMD_VITERBI && __SSE2__
+
+// MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP is defined by the build system
+// (see converter_base.gyp).
+#ifdef MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP
+#include "base/thread.h"
+#endif  // MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP
+
 using mozc::dictionary::DictionaryInterface;
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::PosGroup;
 using mozc::dictionary::SuppressionDictionary;
 using mozc::dictionary::Token;
+using mozc::dictionary::UserDictionary;
 
 namespace mozc {
 namespace {
 
 const size_t kMaxSegmentsSize                   = 256;
+
+// Returns the absolute Clock::GetTicks() deadline for |request|, or 0
+// if the request has no latency budget.
+uint64 GetDeadlineTicks(const ConversionRequest &request) {
+  if (request.conversion_deadline_msec() <= 0) {
+    return 0;
+  }
+  return Clock::GetTicks() +
+         request.conversion_deadline_msec() * Clock::GetFrequency() / 1000;
+}
+
+inline bool DeadlineExceeded(uint64 deadline_ticks) {
+  return deadline_ticks != 0 && Clock::GetTicks() > deadline_ticks;
+}
+
+// Maximum number of conversion results kept in the shared result cache.
+const size_t kResultCacheSize = 64;
+const size_t kResultCacheNumShards = 8;
 const size_t kMaxCharLength                     = 1024;
 const size_t kMaxCharLengthForReverseConversion = 600;  // 200 chars in UTF8
 const int    kMaxCost                           = 32767;
@@ -86,8 +123,7 @@ class KeyCorrectedNodeListBuilder : public BaseNodeListBuilder {
       : BaseNodeListBuilder(allocator, allocator->max_nodes_size()),
         pos_(pos),
         original_lookup_key_(original_lookup_key),
-        key_corrector_(key_corrector),
-        tail_(NULL) {}
+        key_corrector_(key_corrector) {}
 
   virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
@@ -96,53 +132,109 @@ class KeyCorrectedNodeListBuilder : public BaseNodeListBuilder {
     if (!KeyCorrector::IsValidPosition(offset) || offset == 0) {
       return TRAVERSE_NEXT_KEY;
     }
-    Node *node = NewNodeFromToken(token);
-    node->key.assign(original_lookup_key_.data() + pos_, offset);
-    node->wcost += KeyCorrector::GetCorrectedCostPenalty(node->key);
+    return AddCorrectedNode(NewNodeFromToken(token), offset);
+  }
 
-    // Push back |node| to the end.
-    if (result_ == NULL) {
-      result_ = node;
-    } else {
-      DCHECK(tail_ != NULL);
-      tail_->bnext = node;
+  virtual ResultType OnConsumableToken(StringPiece key, StringPiece actual_key,
+                                       Token *token) {
+    const size_t offset =
+        key_corrector_->GetOriginalOffset(pos_, token->key.size());
+    if (!KeyCorrector::IsValidPosition(offset) || offset == 0) {
+      return TRAVERSE_NEXT_KEY;
     }
-    tail_ = node;
-    return TRAVERSE_CONTINUE;
+    return AddCorrectedNode(NewNodeFromConsumableToken(token), offset);
   }
 
-  Node *tail() const { return tail_; }
+  const std::vector<Node *> &nodes() const { return nodes_; }
 
  private:
+  ResultType AddCorrectedNode(Node *node, size_t offset) {
+    node->key.assign(original_lookup_key_.data() + pos_, offset);
+    node->wcost += KeyCorrector::GetCorrectedCostPenalty(node->key);
+
+    // Collect the run here; the caller hands the whole run over to
+    // Lattice::BulkInsert() at once.
+    nodes_.push_back(node);
+    return TRAVERSE_CONTINUE;
+  }
+
   const size_t pos_;
   const StringPiece original_lookup_key_;
   const KeyCorrector *key_corrector_;
-  Node *tail_;
+  std::vector<Node *> nodes_;
 };
 
 void InsertCorrectedNodes(size_t pos, const string &key,
                           const ConversionRequest &request,
                           const KeyCorrector *key_corrector,
+                          StringPiece corrected_prefix,
                           const DictionaryInterface *dictionary,
                           Lattice *lattice) {
-  if (key_corrector == NULL) {
-    return;
-  }
-  size_t length = 0;
-  const char *str = key_corrector->GetCorrectedPrefix(pos, &length);
-  if (str == NULL || length == 0) {
+  if (key_corrector == NULL || corrected_prefix.empty()) {
     return;
   }
   KeyCorrectedNodeListBuilder builder(pos, key, key_corrector,
                                       lattice->node_allocator());
-  dictionary->LookupPrefix(StringPiece(str, length), request, &builder);
-  if (builder.tail() != NULL) {
-    builder.tail()->bnext = NULL;
+  dictionary->LookupPrefix(corrected_prefix, request, &builder);
+  lattice->BulkInsert(pos, builder.nodes().data(), builder.nodes().size());
+}
+
+#ifdef MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP
+
+const size_t kParallelLookupNumWorkers = 4;
+// Parallel lookup pays off only when enough positions amortize the
+// thread startup cost (roughly 100+ characters of pasted text).
+const size_t kParallelLookupMinKeySize = 192;
+
+// Looks up the dictionary for every |stride|-th position of the
+// conversion key, starting at |begin_pos|, and stores the resulting
+// node run of each position into |results|.  The positions are
+// independent reads of the immutable dictionary, so workers only share
+// the distinct slots of |results|.  Each worker owns its node
+// allocator; the caller adopts it into the lattice after Join() so the
+// nodes live as long as the lattice.
+class LatticeLookupWorker : public Thread {
+ public:
+  LatticeLookupWorker(const DictionaryInterface *dictionary,
+                      const ConversionRequest &request,
+                      StringPiece key, size_t begin_pos, size_t stride,
+                      std::vector<Node *> *results)
+      : dictionary_(dictionary),
+        request_(request),
+        key_(key),
+        begin_pos_(begin_pos),
+        stride_(stride),
+        allocator_(new NodeAllocator),
+        results_(results) {
+    allocator_->set_max_nodes_size(8192);
   }
-  if (builder.result() != NULL) {
-    lattice->Insert(pos, builder.result());
+
+  virtual void Run() {
+    for (size_t pos = begin_pos_; pos < key_.size(); pos += stride_) {
+      BaseNodeListBuilder builder(allocator_.get(),
+                                  allocator_->max_nodes_size());
+      dictionary_->LookupPrefix(
+          StringPiece(key_.data() + pos, key_.size() - pos),
+          request_, &builder);
+      (*results_)[pos] = builder.result();
+    }
   }
-}
+
+  NodeAllocator *release_allocator() { return allocator_.release(); }
+
+ private:
+  const DictionaryInterface *dictionary_;
+  const ConversionRequest &request_;
+  const StringPiece key_;
+  const size_t begin_pos_;
+  const size_t stride_;
+  std::unique_ptr<NodeAllocator> allocator_;
+  std::vector<Node *> *results_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatticeLookupWorker);
+};
+
+#endif  // MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP
 
 bool IsNumber(const char c) {
   return c >= '0' && c <= '9';
@@ -293,7 +385,8 @@ ImmutableConverterImpl::ImmutableConverterImpl(
       number_id_(pos_matcher_->GetNumberId()),
       unknown_id_(pos_matcher_->GetUnknownId()),
       last_to_first_name_transition_cost_(
-          connector_->GetTransitionCost(last_name_id_, first_name_id_)) {
+          connector_->GetTransitionCost(last_name_id_, first_name_id_)),
+      result_cache_(kResultCacheSize, kResultCacheNumShards) {
   DCHECK(dictionary_);
   DCHECK(suffix_dictionary_);
   DCHECK(suppression_dictionary_);
@@ -306,12 +399,18 @@ ImmutableConverterImpl::ImmutableConverterImpl(
 
 void ImmutableConverterImpl::ExpandCandidates(
     const string &original_key, NBestGenerator *nbest, Segment *segment,
-    Segments::RequestType request_type, size_t expand_size) const {
+    Segments::RequestType request_type, size_t expand_size,
+    uint64 deadline_ticks) const {
   DCHECK(nbest);
   DCHECK(segment);
   CHECK_GT(expand_size, 0);
 
   while (segment->candidates_size() < expand_size) {
+    // Keep at least one candidate per segment so that the result stays
+    // valid, but stop refining once the latency budget is exhausted.
+    if (segment->candidates_size() > 0 && DeadlineExceeded(deadline_ticks)) {
+      break;
+    }
     Segment::Candidate *candidate = segment->push_back_candidate();
     DCHECK(candidate);
     candidate->Init();
@@ -746,7 +845,16 @@ class NodeListBuilderWithCacheEnabled : public NodeListBuilderForLookupPrefix {
 
   virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
-    Node *node = NewNodeFromToken(token);
+    return AddCacheEnabledNode(NewNodeFromToken(token));
+  }
+
+  virtual ResultType OnConsumableToken(StringPiece key, StringPiece actual_key,
+                                       Token *token) {
+    return AddCacheEnabledNode(NewNodeFromConsumableToken(token));
+  }
+
+ private:
+  ResultType AddCacheEnabledNode(Node *node) {
     node->attributes |= Node::ENABLE_CACHE;
     node->raw_wcost = node->wcost;
     PrependNode(node);
@@ -875,13 +983,73 @@ namespace {
 // calculated based on kVeryBigCost.
 const int kVeryBigCost = (INT_MAX >> 2);
 
-// Runs viterbi algorithm at position |pos|. The left_boundary/right_boundary
-// are the next boundary looked from pos. (If pos is on the boundary,
-// left_boundary should be the previous one, and right_boundary should be
-// the next).
+#ifdef MOZC_USE_SIMD_VITERBI
+
+// Scratch buffers holding the valid end nodes of one column in
+// structure-of-arrays form.  Reused across positions of a segment to
+// avoid repeated allocation.
+struct EndNodeColumnBuffer {
+  std::vector<Node *> nodes;
+  std::vector<int32> costs;
+};
+
+// Returns the index of the minimum element of |costs|.  |padded_size|
+// must be a positive multiple of 4 and the elements beyond the real
+// column size must be padded with kVeryBigCost.  Ties are resolved to
+// the smallest index, matching the scalar loop.
+inline size_t FindColumnMinIndex(const int32 *costs, size_t padded_size) {
+  __m128i best_cost = _mm_loadu_si128(reinterpret_cast<const __m128i *>(costs));
+  __m128i best_index = _mm_setr_epi32(0, 1, 2, 3);
+  __m128i index = best_index;
+  const __m128i kIndexStep = _mm_set1_epi32(4);
+  for (size_t i = 4; i < padded_size; i += 4) {
+    index = _mm_add_epi32(index, kIndexStep);
+    const __m128i cost =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(costs + i));
+    const __m128i lt = _mm_cmplt_epi32(cost, best_cost);
+    best_cost = _mm_or_si128(_mm_and_si128(lt, cost),
+                             _mm_andnot_si128(lt, best_cost));
+    best_index = _mm_or_si128(_mm_and_si128(lt, index),
+                              _mm_andnot_si128(lt, best_index));
+  }
+  int32 lane_costs[4];
+  int32 lane_indices[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_costs), best_cost);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_indices), best_index);
+  size_t best_lane = 0;
+  for (size_t i = 1; i < 4; ++i) {
+    if (lane_costs[i] < lane_costs[best_lane] ||
+        (lane_costs[i] == lane_costs[best_lane] &&
+         lane_indices[i] < lane_indices[best_lane])) {
+      best_lane = i;
+    }
+  }
+  return lane_indices[best_lane];
+}
+
+// Vectorized variant of ViterbiInternal.  Gathers the (cost, rid) pairs
+// of the end-node column at |pos| into |buffer| once (the column is
+// shared by all begin nodes at |pos|) and evaluates the minimum over the
+// column with SIMD.
 inline void ViterbiInternal(
     const Connector &connector, size_t pos, size_t right_boundary,
-    Lattice *lattice) {
+    Lattice *lattice, EndNodeColumnBuffer *buffer) {
+  buffer->nodes.clear();
+  for (Node *lnode = lattice->end_nodes(pos);
+       lnode != NULL; lnode = lnode->enext) {
+    if (lnode->prev == NULL) {
+      // Invalid lnode.
+      continue;
+    }
+    buffer->nodes.push_back(lnode);
+  }
+  const size_t column_size = buffer->nodes.size();
+  const size_t padded_size = (column_size + 3) & ~static_cast<size_t>(3);
+  buffer->costs.resize(padded_size);
+  for (size_t i = column_size; i < padded_size; ++i) {
+    buffer->costs[i] = kVeryBigCost;
+  }
+
   for (Node *rnode = lattice->begin_nodes(pos);
        rnode != NULL; rnode = rnode->bnext) {
     if (rnode->end_pos > right_boundary) {
@@ -904,27 +1072,157 @@ inline void ViterbiInternal(
       continue;
     }
 
-    // Find a valid node which connects to the rnode with minimum cost.
-    int best_cost = kVeryBigCost;
-    Node *best_node = NULL;
-    for (Node *lnode = lattice->end_nodes(pos);
-         lnode != NULL; lnode = lnode->enext) {
-      if (lnode->prev == NULL) {
-        // Invalid lnode.
-        continue;
-      }
+    if (column_size == 0) {
+      rnode->prev = NULL;
+      rnode->cost = kVeryBigCost + rnode->wcost;
+      continue;
+    }
 
-      int cost =
+    for (size_t i = 0; i < column_size; ++i) {
+      const Node *lnode = buffer->nodes[i];
+      buffer->costs[i] =
           lnode->cost + connector.GetTransitionCost(lnode->rid, rnode->lid);
-      if (cost < best_cost) {
-        best_cost = cost;
-        best_node = lnode;
+    }
+    const size_t best = FindColumnMinIndex(buffer->costs.data(), padded_size);
+    rnode->prev = buffer->nodes[best];
+    rnode->cost = buffer->costs[best] + rnode->wcost;
+  }
+}
+
+#else  // MOZC_USE_SIMD_VITERBI
+
+// Mapping from an id (rid of end nodes, lid of begin nodes) to the best
+// (cost, node) pair found so far.  Kept as a sorted vector of key-value
+// pairs for the same reason as in PredictionViterbiInternal(): the number
+// of distinct ids per column is small, so a vector beats std::map.
+typedef std::vector<std::pair<int, std::pair<int, Node *> > > BestIdMap;
+typedef OrderBy<FirstKey, Less> OrderByFirstId;
+
+// Runs viterbi algorithm at position |pos|. The left_boundary/right_boundary
+// are the next boundary looked from pos. (If pos is on the boundary,
+// left_boundary should be the previous one, and right_boundary should be
+// the next).
+//
+// The transition cost depends only on (lnode->rid, rnode->lid), so the
+// end nodes are first contracted into per-rid buckets holding the
+// minimum-cost node, and the begin nodes into per-lid buckets.  The
+// quadratic node-pair loop then runs over bucket pairs instead;
+// conversion lattices routinely have hundreds of end nodes per position
+// but only a few dozen distinct ids, and the contraction is exact.
+// Constrained nodes connect to a designated predecessor and bypass the
+// buckets.  |lbest| and |rbest| are caller-owned scratch buffers.
+inline void ViterbiInternal(
+    const Connector &connector, size_t pos, size_t right_boundary,
+    Lattice *lattice, BestIdMap *lbest, BestIdMap *rbest) {
+  const std::pair<int, Node *> kInvalidValue(INT_MAX,
+                                             static_cast<Node *>(NULL));
+
+  lbest->clear();
+  for (Node *lnode = lattice->end_nodes(pos);
+       lnode != NULL; lnode = lnode->enext) {
+    if (lnode->prev == NULL) {
+      // Invalid lnode.
+      continue;
+    }
+    const BestIdMap::value_type key(lnode->rid, kInvalidValue);
+    BestIdMap::iterator iter =
+        std::lower_bound(lbest->begin(), lbest->end(), key, OrderByFirstId());
+    if (iter == lbest->end() || iter->first != lnode->rid) {
+      lbest->insert(iter, BestIdMap::value_type(
+          lnode->rid, std::make_pair(lnode->cost, lnode)));
+    } else if (lnode->cost < iter->second.first) {
+      iter->second.first = lnode->cost;
+      iter->second.second = lnode;
+    }
+  }
+
+  rbest->clear();
+  Node *rnode_begin = lattice->begin_nodes(pos);
+  for (Node *rnode = rnode_begin; rnode != NULL; rnode = rnode->bnext) {
+    if (rnode->end_pos > right_boundary || rnode->constrained_prev != NULL) {
+      continue;
+    }
+    const BestIdMap::value_type key(rnode->lid, kInvalidValue);
+    BestIdMap::iterator iter =
+        std::lower_bound(rbest->begin(), rbest->end(), key, OrderByFirstId());
+    if (iter == rbest->end() || iter->first != rnode->lid) {
+      rbest->insert(iter, key);
+    }
+  }
+
+  // One evaluation per connection-equivalence class pair.
+  for (BestIdMap::const_iterator liter = lbest->begin();
+       liter != lbest->end(); ++liter) {
+    for (BestIdMap::iterator riter = rbest->begin();
+         riter != rbest->end(); ++riter) {
+      const int cost = liter->second.first +
+          connector.GetTransitionCost(liter->first, riter->first);
+      if (cost < riter->second.first) {
+        riter->second.first = cost;
+        riter->second.second = liter->second.second;
+      }
+    }
+  }
+
+  for (Node *rnode = rnode_begin; rnode != NULL; rnode = rnode->bnext) {
+    if (rnode->end_pos > right_boundary) {
+      // Invalid rnode.
+      rnode->prev = NULL;
+      continue;
+    }
+
+    if (rnode->constrained_prev != NULL) {
+      // Constrained node.
+      if (rnode->constrained_prev->prev == NULL) {
+        rnode->prev = NULL;
+      } else {
+        rnode->prev = rnode->constrained_prev;
+        rnode->cost =
+            rnode->prev->cost +
+            rnode->wcost +
+            connector.GetTransitionCost(rnode->prev->rid, rnode->lid);
       }
+      continue;
+    }
+
+    const BestIdMap::value_type key(rnode->lid, kInvalidValue);
+    BestIdMap::const_iterator iter =
+        std::lower_bound(rbest->begin(), rbest->end(), key, OrderByFirstId());
+    if (iter == rbest->end() || iter->first != rnode->lid ||
+        iter->second.second == NULL || iter->second.first >= kVeryBigCost) {
+      // No valid node connects to this rnode; same result as the old
+      // node-pair loop finding nothing below kVeryBigCost.
+      rnode->prev = NULL;
+      rnode->cost = kVeryBigCost + rnode->wcost;
+      continue;
     }
 
-    rnode->prev = best_node;
-    rnode->cost = best_cost + rnode->wcost;
+    rnode->prev = iter->second.second;
+    rnode->cost = iter->second.first + rnode->wcost;
+  }
+}
+
+#endif  // MOZC_USE_SIMD_VITERBI
+
+// Runs ViterbiInternal for all positions in [begin_pos, right_boundary).
+// In SIMD builds this also owns the column scratch buffers shared by the
+// positions of the range.
+inline void ViterbiRange(
+    const Connector &connector, size_t begin_pos, size_t right_boundary,
+    Lattice *lattice) {
+#ifdef MOZC_USE_SIMD_VITERBI
+  EndNodeColumnBuffer buffer;
+  for (size_t pos = begin_pos; pos < right_boundary; ++pos) {
+    ViterbiInternal(connector, pos, right_boundary, lattice, &buffer);
+  }
+#else
+  BestIdMap lbest, rbest;
+  lbest.reserve(128);
+  rbest.reserve(128);
+  for (size_t pos = begin_pos; pos < right_boundary; ++pos) {
+    ViterbiInternal(connector, pos, right_boundary, lattice, &lbest, &rbest);
   }
+#endif  // MOZC_USE_SIMD_VITERBI
 }
 }  // namespace
 
@@ -967,9 +1265,7 @@ bool ImmutableConverterImpl::Viterbi(
   {
     const size_t right_boundary =
         left_boundary + segments.segment(0).key().size();
-    for (size_t pos = left_boundary + 1; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
-    }
+    ViterbiRange(*connector_, left_boundary + 1, right_boundary, lattice);
     left_boundary = right_boundary;
   }
 
@@ -978,9 +1274,7 @@ bool ImmutableConverterImpl::Viterbi(
     // Run Viterbi for each position the segment.
     const size_t right_boundary =
         left_boundary + segments.segment(i).key().size();
-    for (size_t pos = left_boundary; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
-    }
+    ViterbiRange(*connector_, left_boundary, right_boundary, lattice);
     left_boundary = right_boundary;
   }
 
@@ -1060,6 +1354,7 @@ bool ImmutableConverterImpl::Viterbi(
 // conversion/suggestion if we use richer info as contraction group.
 
 bool ImmutableConverterImpl::PredictionViterbi(
+    const ConversionRequest &request,
     const Segments &segments, Lattice *lattice) const {
   const size_t key_length = lattice->key().size();
   const size_t history_segments_size = segments.history_segments_size();
@@ -1067,8 +1362,9 @@ bool ImmutableConverterImpl::PredictionViterbi(
   for (size_t i = 0; i < history_segments_size; ++i) {
     history_length += segments.segment(i).key().size();
   }
-  PredictionViterbiInternal(0, history_length, lattice);
-  PredictionViterbiInternal(history_length, key_length, lattice);
+  const size_t beam_width = request.prediction_viterbi_beam_width();
+  PredictionViterbiInternal(0, history_length, beam_width, lattice);
+  PredictionViterbiInternal(history_length, key_length, beam_width, lattice);
 
   Node *node = lattice->eos_nodes();
   CHECK(node->bnext == NULL);
@@ -1088,7 +1384,8 @@ bool ImmutableConverterImpl::PredictionViterbi(
 }
 
 void ImmutableConverterImpl::PredictionViterbiInternal(
-    int calc_begin_pos, int calc_end_pos, Lattice *lattice) const {
+    int calc_begin_pos, int calc_end_pos, size_t beam_width,
+    Lattice *lattice) const {
   CHECK_LE(calc_begin_pos, calc_end_pos);
 
   // Mapping from lnode's rid to (cost, Node) of best way/cost, and vice versa.
@@ -1101,8 +1398,19 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
   lbest.reserve(128);
   rbest.reserve(128);
 
+  std::vector<int> beam_costs;
+  if (beam_width > 0) {
+    beam_costs.reserve(128);
+  }
+
   const std::pair<int, Node*> kInvalidValue(INT_MAX, static_cast<Node*>(NULL));
 
+  // Nodes beginning before |reusable_end_pos| that were already evaluated
+  // in the previous request keep a valid prev/cost (see
+  // Lattice::reusable_viterbi_end_pos), so only the freshly inserted
+  // nodes of those columns need to be evaluated again.
+  const size_t reusable_end_pos = lattice->reusable_viterbi_end_pos();
+
   for (size_t pos = calc_begin_pos; pos <= calc_end_pos; ++pos) {
     lbest.clear();
     for (Node *lnode = lattice->end_nodes(pos);
@@ -1130,6 +1438,10 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
       if (rnode->end_pos > calc_end_pos) {
         continue;
       }
+      if (rnode->prev != NULL && pos < reusable_end_pos) {
+        // Evaluated in the previous request.
+        continue;
+      }
       BestMap::value_type key(rnode->lid, kInvalidValue);
       BestMap::iterator iter =
           std::lower_bound(rbest.begin(), rbest.end(), key, OrderByFirst());
@@ -1159,6 +1471,10 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
       if (rnode->end_pos > calc_end_pos) {
         continue;
       }
+      if (rnode->prev != NULL && pos < reusable_end_pos) {
+        // Evaluated in the previous request.
+        continue;
+      }
       BestMap::value_type key(rnode->lid, kInvalidValue);
       BestMap::iterator iter =
           std::lower_bound(rbest.begin(), rbest.end(), key, OrderByFirst());
@@ -1170,6 +1486,44 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
       rnode->cost = iter->second.first + rnode->wcost;
       rnode->prev = iter->second.second;
     }
+
+    if (beam_width == 0) {
+      continue;
+    }
+
+    // Beam pruning: keep only the |beam_width| lowest-cost live nodes
+    // of this column.  Pruned nodes are marked dead (prev == NULL) with
+    // a very big cost so that they never win in later columns.
+    beam_costs.clear();
+    for (Node *rnode = rnode_begin; rnode != NULL; rnode = rnode->bnext) {
+      if (rnode->prev != NULL) {
+        beam_costs.push_back(rnode->cost);
+      }
+    }
+    if (beam_costs.size() <= beam_width) {
+      continue;
+    }
+    std::nth_element(beam_costs.begin(), beam_costs.begin() + beam_width - 1,
+                     beam_costs.end());
+    const int threshold = beam_costs[beam_width - 1];
+    size_t num_less = 0;
+    for (size_t i = 0; i < beam_width; ++i) {
+      if (beam_costs[i] < threshold) {
+        ++num_less;
+      }
+    }
+    size_t tie_allowance = beam_width - num_less;
+    for (Node *rnode = rnode_begin; rnode != NULL; rnode = rnode->bnext) {
+      if (rnode->prev == NULL || rnode->cost < threshold) {
+        continue;
+      }
+      if (rnode->cost == threshold && tie_allowance > 0) {
+        --tie_allowance;
+        continue;
+      }
+      rnode->prev = NULL;
+      rnode->cost = kVeryBigCost;
+    }
   }
 }
 
@@ -1186,7 +1540,16 @@ class NodeListBuilderForPredictiveNodes : public BaseNodeListBuilder {
 
   virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
-    Node *node = NewNodeFromToken(token);
+    return AddPredictiveNode(NewNodeFromToken(token));
+  }
+
+  virtual ResultType OnConsumableToken(StringPiece key, StringPiece actual_key,
+                                       Token *token) {
+    return AddPredictiveNode(NewNodeFromConsumableToken(token));
+  }
+
+ private:
+  ResultType AddPredictiveNode(Node *node) {
     const int kPredictiveNodeDefaultPenalty = 900;  // ~= -500 * log(1/6)
     int additional_cost = kPredictiveNodeDefaultPenalty;
 
@@ -1216,7 +1579,6 @@ class NodeListBuilderForPredictiveNodes : public BaseNodeListBuilder {
     return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
   }
 
- private:
   const POSMatcher *pos_matcher_;
 };
 
@@ -1374,7 +1736,9 @@ bool ImmutableConverterImpl::MakeLattice(
 
   bool is_valid_lattice = true;
   // Perform the main part of lattice construction.
-  if (!MakeLatticeNodesForHistorySegments(*segments, request, lattice) ||
+  if (!MakeLatticeNodesForHistorySegments(
+          *segments, request,
+          segments->mutable_cached_history_fingerprint(), lattice) ||
       lattice->end_nodes(history_key.size()) == NULL) {
     is_valid_lattice = false;
   }
@@ -1382,7 +1746,8 @@ bool ImmutableConverterImpl::MakeLattice(
   // Can not apply key corrector to invalid lattice.
   if (is_valid_lattice) {
     MakeLatticeNodesForConversionSegments(
-        *segments, request, history_key, lattice);
+        *segments, request, history_key,
+        segments->mutable_cached_key_corrector(), lattice);
   }
 
   if (is_reverse) {
@@ -1415,39 +1780,109 @@ bool ImmutableConverterImpl::MakeLattice(
   return true;
 }
 
+namespace {
+
+// Chained fingerprint of the history composition (segment keys, top
+// candidate values and ids).  0 is reserved for "no reusable history".
+uint64 HistoryFingerprint(const Segments &segments) {
+  const size_t history_segments_size = segments.history_segments_size();
+  if (history_segments_size == 0) {
+    return 0;
+  }
+  const uint64 kMultiplier = 0x100000001b3;  // Large prime for chaining.
+  uint64 fingerprint = history_segments_size;
+  for (size_t s = 0; s < history_segments_size; ++s) {
+    const Segment &segment = segments.segment(s);
+    if (segment.candidates_size() == 0) {
+      return 0;
+    }
+    const Segment::Candidate &candidate = segment.candidate(0);
+    fingerprint = fingerprint * kMultiplier + Hash::Fingerprint(segment.key());
+    fingerprint =
+        fingerprint * kMultiplier + Hash::Fingerprint(candidate.value);
+    fingerprint = fingerprint * kMultiplier + candidate.lid;
+    fingerprint = fingerprint * kMultiplier + candidate.rid;
+  }
+  return (fingerprint == 0) ? 1 : fingerprint;
+}
+
+}  // namespace
+
 bool ImmutableConverterImpl::MakeLatticeNodesForHistorySegments(
     const Segments &segments, const ConversionRequest &request,
-    Lattice *lattice) const {
-  const bool is_reverse =
-     (segments.request_type() == Segments::REVERSE_CONVERSION);
+    uint64 *cached_history_fingerprint, Lattice *lattice) const {
+  DCHECK(cached_history_fingerprint);
   const size_t history_segments_size = segments.history_segments_size();
-  const string &key = lattice->key();
-
-  size_t segments_pos = 0;
-  uint16 last_rid = 0;
 
+  // Validate the history and compute its total key length.
+  size_t history_key_size = 0;
   for (size_t s = 0; s < history_segments_size; ++s) {
     const Segment &segment = segments.segment(s);
     if (segment.segment_type() != Segment::HISTORY &&
         segment.segment_type() != Segment::SUBMITTED) {
       LOG(WARNING) << "inconsistent history";
+      *cached_history_fingerprint = 0;
       return false;
     }
     if (segment.key().empty()) {
       LOG(WARNING) << "invalid history: key is empty";
+      *cached_history_fingerprint = 0;
       return false;
     }
+    history_key_size += segment.key().size();
+  }
+
+  // Fast path: the history rarely changes between keystrokes.  When its
+  // fingerprint matches the chain built by the previous request and the
+  // chain survived the incremental key update (the virtual nodes carry
+  // ENABLE_CACHE), splicing it segment by segment is skipped; only the
+  // compound lookup has to run, as it depends on the conversion key.
+  const uint64 history_fingerprint = HistoryFingerprint(segments);
+  if (history_fingerprint != 0 &&
+      history_fingerprint == *cached_history_fingerprint &&
+      lattice->history_end_pos() == history_key_size) {
+    const Segment &last_segment = segments.segment(history_segments_size - 1);
+    const Segment::Candidate &candidate = last_segment.candidate(0);
+    const size_t last_begin_pos = history_key_size - last_segment.key().size();
+    for (Node *node = lattice->end_nodes(history_key_size); node != NULL;
+         node = node->enext) {
+      if (node->node_type == Node::HIS_NODE &&
+          node->lid == candidate.lid && node->rid == candidate.rid &&
+          node->begin_pos == last_begin_pos &&
+          node->value == candidate.value) {
+        MakeCompoundSuffixNodes(segments, request, last_begin_pos, node,
+                                lattice);
+        lattice->set_history_end_pos(history_key_size);
+        return true;
+      }
+    }
+    // The chain did not survive; fall through to a full rebuild.
+  }
+
+  // Remove whatever is left of an outdated chain before splicing the new
+  // one; its nodes would otherwise survive ResetNodeCost().
+  lattice->EraseHistoryNodes();
+  *cached_history_fingerprint = 0;
+
+  size_t segments_pos = 0;
+
+  for (size_t s = 0; s < history_segments_size; ++s) {
+    const Segment &segment = segments.segment(s);
     const Segment::Candidate &candidate = segment.candidate(0);
 
     // Add a virtual nodes corresponding to HISTORY segments.
+    // ENABLE_CACHE (with the zero raw_wcost) keeps the chain alive for
+    // the fast path above.
     Node *rnode = lattice->NewNode();
     CHECK(rnode);
     rnode->lid = candidate.lid;
     rnode->rid = candidate.rid;
     rnode->wcost = 0;
+    rnode->raw_wcost = 0;
     rnode->value = candidate.value;
     rnode->key = segment.key();
     rnode->node_type = Node::HIS_NODE;
+    rnode->attributes |= Node::ENABLE_CACHE;
     rnode->bnext = NULL;
     lattice->Insert(segments_pos, rnode);
 
@@ -1469,114 +1904,134 @@ bool ImmutableConverterImpl::MakeLatticeNodesForHistorySegments(
       // TODO(team): Figure out a better way to set the cost using
       // boundary.def-like approach.
       rnode2->wcost = 0;
+      rnode2->raw_wcost = 0;
       rnode2->value = candidate.value;
       rnode2->key = segment.key();
       rnode2->node_type = Node::HIS_NODE;
+      rnode2->attributes |= Node::ENABLE_CACHE;
       rnode2->bnext = NULL;
       lattice->Insert(segments_pos, rnode2);
     }
 
-    // Dictionary lookup for the candidates which are
-    // overlapping between history and conversion.
-    // Check only the last history segment at this moment.
-    //
-    // Example: history "おいかわ(及川)", conversion: "たくや"
-    // Here, try to find "おいかわたくや(及川卓也)" from dictionary
-    // and insert "卓也" as a new word node with a modified cost
     if (s + 1 == history_segments_size) {
-      const bool is_prediction =
-          (segments.request_type() == Segments::SUGGESTION ||
-           segments.request_type() == Segments::PREDICTION);
-      const Node *node = Lookup(segments_pos, key.size(), request,
-                                is_reverse, is_prediction, lattice);
-      for (const Node *compound_node = node; compound_node != NULL;
-           compound_node = compound_node->bnext) {
-        // No overlapps
-        if (compound_node->key.size() <= rnode->key.size() ||
-            compound_node->value.size() <= rnode->value.size() ||
-            !Util::StartsWith(compound_node->key, rnode->key) ||
-            !Util::StartsWith(compound_node->value, rnode->value)) {
-          // not a prefix
-          continue;
-        }
-
-        // Must be in the same POS group.
-        // http://b/issue?id=2977618
-        if (pos_group_->GetPosGroup(candidate.lid)
-            != pos_group_->GetPosGroup(compound_node->lid)) {
-          continue;
-        }
-
-        // make new virtual node
-        Node *new_node = lattice->NewNode();
-        CHECK(new_node);
-
-        // get the suffix part ("たくや/卓也")
-        new_node->key.assign(compound_node->key, rnode->key.size(),
-                             compound_node->key.size() - rnode->key.size());
-        new_node->value.assign(
-            compound_node->value, rnode->value.size(),
-            compound_node->value.size() - rnode->value.size());
-
-        // rid/lid are derived from the compound.
-        // lid is just an approximation
-        new_node->rid = compound_node->rid;
-        new_node->lid = compound_node->lid;
-        new_node->bnext = NULL;
-        new_node->node_type = Node::NOR_NODE;
-        new_node->attributes |= Segment::Candidate::CONTEXT_SENSITIVE;
-
-        // New cost recalcuration:
-        //
-        // compound_node->wcost * (candidate len / compound_node len)
-        // - trans(candidate.rid, new_node.lid)
-        new_node->wcost =
-            compound_node->wcost *
-            candidate.value.size() / compound_node->value.size()
-            - connector_->GetTransitionCost(candidate.rid, new_node->lid);
-
-        VLOG(2) << " compound_node->lid=" << compound_node->lid
-                << " compound_node->rid=" << compound_node->rid
-                << " compound_node->wcost=" << compound_node->wcost;
-        VLOG(2) << " last_rid=" << last_rid
-                << " candidate.lid=" << candidate.lid
-                << " candidate.rid=" << candidate.rid
-                << " candidate.cost=" << candidate.cost
-                << " candidate.wcost=" << candidate.wcost;
-        VLOG(2) << " new_node->wcost=" << new_node->wcost;
-
-        new_node->constrained_prev = rnode;
-
-        // Added as new node
-        lattice->Insert(segments_pos + rnode->key.size(), new_node);
-
-        VLOG(2) << "Added: " << new_node->key << " " << new_node->value;
-      }
+      MakeCompoundSuffixNodes(segments, request, segments_pos, rnode,
+                              lattice);
     }
 
     // update segment pos
     segments_pos += rnode->key.size();
-    last_rid = rnode->rid;
   }
   lattice->set_history_end_pos(segments_pos);
+  *cached_history_fingerprint = history_fingerprint;
   return true;
 }
 
+void ImmutableConverterImpl::MakeCompoundSuffixNodes(
+    const Segments &segments, const ConversionRequest &request,
+    size_t segments_pos, Node *rnode, Lattice *lattice) const {
+  const bool is_reverse =
+      (segments.request_type() == Segments::REVERSE_CONVERSION);
+  const bool is_prediction =
+      (segments.request_type() == Segments::SUGGESTION ||
+       segments.request_type() == Segments::PREDICTION);
+  const Segment::Candidate &candidate =
+      segments.segment(segments.history_segments_size() - 1).candidate(0);
+  const string &key = lattice->key();
+
+  // Dictionary lookup for the candidates which are
+  // overlapping between history and conversion.
+  // Check only the last history segment at this moment.
+  //
+  // Example: history "おいかわ(及川)", conversion: "たくや"
+  // Here, try to find "おいかわたくや(及川卓也)" from dictionary
+  // and insert "卓也" as a new word node with a modified cost
+  const Node *node = Lookup(segments_pos, key.size(), request,
+                            is_reverse, is_prediction, lattice);
+  for (const Node *compound_node = node; compound_node != NULL;
+       compound_node = compound_node->bnext) {
+    // No overlapps
+    if (compound_node->key.size() <= rnode->key.size() ||
+        compound_node->value.size() <= rnode->value.size() ||
+        !Util::StartsWith(compound_node->key, rnode->key) ||
+        !Util::StartsWith(compound_node->value, rnode->value)) {
+      // not a prefix
+      continue;
+    }
+
+    // Must be in the same POS group.
+    // http://b/issue?id=2977618
+    if (pos_group_->GetPosGroup(candidate.lid)
+        != pos_group_->GetPosGroup(compound_node->lid)) {
+      continue;
+    }
+
+    // make new virtual node
+    Node *new_node = lattice->NewNode();
+    CHECK(new_node);
+
+    // get the suffix part ("たくや/卓也")
+    new_node->key.assign(compound_node->key, rnode->key.size(),
+                         compound_node->key.size() - rnode->key.size());
+    new_node->value.assign(
+        compound_node->value, rnode->value.size(),
+        compound_node->value.size() - rnode->value.size());
+
+    // rid/lid are derived from the compound.
+    // lid is just an approximation
+    new_node->rid = compound_node->rid;
+    new_node->lid = compound_node->lid;
+    new_node->bnext = NULL;
+    new_node->node_type = Node::NOR_NODE;
+    new_node->attributes |= Segment::Candidate::CONTEXT_SENSITIVE;
+
+    // New cost recalcuration:
+    //
+    // compound_node->wcost * (candidate len / compound_node len)
+    // - trans(candidate.rid, new_node.lid)
+    new_node->wcost =
+        compound_node->wcost *
+        candidate.value.size() / compound_node->value.size()
+        - connector_->GetTransitionCost(candidate.rid, new_node->lid);
+
+    VLOG(2) << " compound_node->lid=" << compound_node->lid
+            << " compound_node->rid=" << compound_node->rid
+            << " compound_node->wcost=" << compound_node->wcost;
+    VLOG(2) << " candidate.lid=" << candidate.lid
+            << " candidate.rid=" << candidate.rid
+            << " candidate.cost=" << candidate.cost
+            << " candidate.wcost=" << candidate.wcost;
+    VLOG(2) << " new_node->wcost=" << new_node->wcost;
+
+    new_node->constrained_prev = rnode;
+
+    // Added as new node
+    lattice->Insert(segments_pos + rnode->key.size(), new_node);
+
+    VLOG(2) << "Added: " << new_node->key << " " << new_node->value;
+  }
+}
+
 void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
     const Segments &segments, const ConversionRequest &request,
-    const string &history_key, Lattice *lattice) const {
+    const string &history_key, KeyCorrector *key_corrector,
+    Lattice *lattice) const {
   const string &key = lattice->key();
   const bool is_conversion =
       (segments.request_type() == Segments::CONVERSION);
   // Do not use KeyCorrector if user changes the boundary.
   // http://b/issue?id=2804996
-  std::unique_ptr<KeyCorrector> key_corrector;
-  if (is_conversion && !segments.resized()) {
+  std::vector<std::pair<size_t, StringPiece> > corrected_prefixes;
+  if (is_conversion && !segments.resized() && key_corrector != NULL) {
     KeyCorrector::InputMode mode = KeyCorrector::ROMAN;
     if (request.config().preedit_method() != config::Config::ROMAN) {
       mode = KeyCorrector::KANA;
     }
-    key_corrector.reset(new KeyCorrector(key, mode, history_key.size()));
+    // The corrector is cached in Segments, so when the key merely grew
+    // by a few keystrokes this extends the previous correction state.
+    key_corrector->CorrectKey(key, mode, history_key.size());
+    key_corrector->GetCorrectedPrefixes(&corrected_prefixes);
+  } else {
+    key_corrector = NULL;
   }
 
   const bool is_reverse =
@@ -1584,10 +2039,47 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
   const bool is_prediction =
       (segments.request_type() == Segments::SUGGESTION ||
        segments.request_type() == Segments::PREDICTION);
+
+#ifdef MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP
+  // Fan the prefix lookups out to worker threads first, then merge the
+  // results in order below.  The reverse and prediction paths keep the
+  // sequential Lookup() because they rely on per-lattice caches.
+  const bool use_parallel_lookup =
+      is_conversion &&
+      key.size() - history_key.size() >= kParallelLookupMinKeySize;
+  std::vector<Node *> parallel_results;
+  if (use_parallel_lookup) {
+    parallel_results.resize(key.size(), static_cast<Node *>(NULL));
+    std::vector<std::unique_ptr<LatticeLookupWorker> > workers;
+    for (size_t i = 0; i < kParallelLookupNumWorkers; ++i) {
+      workers.emplace_back(new LatticeLookupWorker(
+          dictionary_, request, key, history_key.size() + i,
+          kParallelLookupNumWorkers, &parallel_results));
+      workers.back()->SetJoinable(true);
+      workers.back()->Start("LatticeLookupWorker");
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i]->Join();
+      lattice->AdoptAllocator(workers[i]->release_allocator());
+    }
+  }
+#endif  // MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP
+
+  size_t prefix_index = 0;
   for (size_t pos = history_key.size(); pos < key.size(); ++pos) {
     if (lattice->end_nodes(pos) != NULL) {
-      Node *rnode =
-          Lookup(pos, key.size(), request, is_reverse, is_prediction, lattice);
+      Node *rnode = NULL;
+#ifdef MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP
+      if (use_parallel_lookup) {
+        rnode = AddCharacterTypeBasedNodes(key.data() + pos,
+                                           key.data() + key.size(), lattice,
+                                           parallel_results[pos]);
+      }
+#endif  // MOZC_ENABLE_PARALLEL_LATTICE_LOOKUP
+      if (rnode == NULL) {
+        rnode = Lookup(pos, key.size(), request, is_reverse, is_prediction,
+                       lattice);
+      }
       // If history key is NOT empty and user input seems to starts with
       // a particle ("はにで..."), mark the node as STARTS_WITH_PARTICLE.
       // We change the segment boundary if STARTS_WITH_PARTICLE attribute
@@ -1602,8 +2094,16 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
       }
       CHECK(rnode != NULL);
       lattice->Insert(pos, rnode);
-      InsertCorrectedNodes(
-          pos, key, request, key_corrector.get(), dictionary_, lattice);
+      while (prefix_index < corrected_prefixes.size() &&
+             corrected_prefixes[prefix_index].first < pos) {
+        ++prefix_index;
+      }
+      if (prefix_index < corrected_prefixes.size() &&
+          corrected_prefixes[prefix_index].first == pos) {
+        InsertCorrectedNodes(pos, key, request, key_corrector,
+                             corrected_prefixes[prefix_index].second,
+                             dictionary_, lattice);
+      }
     }
   }
 }
@@ -1667,13 +2167,15 @@ void ImmutableConverterImpl::InsertFirstSegmentToCandidates(
     const Lattice &lattice,
     const std::vector<uint16> &group,
     size_t max_candidates_size,
-    FilterType filter_type) const {
+    FilterType filter_type,
+    uint64 deadline_ticks) const {
   const size_t only_first_segment_candidate_pos =
       segments->conversion_segment(0).candidates_size();
   InsertCandidates(segments, lattice, group,
                    max_candidates_size,
                    ONLY_FIRST_SEGMENT,
-                   filter_type);
+                   filter_type,
+                   deadline_ticks);
   // Note that inserted candidates might consume the entire key.
   // e.g. key: "なのは", value: "ナノは"
   // Erase them later.
@@ -1797,7 +2299,8 @@ void ImmutableConverterImpl::InsertCandidates(
     const std::vector<uint16> &group,
     size_t max_candidates_size,
     InsertCandidatesType type,
-    FilterType filter_type) const {
+    FilterType filter_type,
+    uint64 deadline_ticks) const {
   // skip HIS_NODE(s)
   Node *prev = lattice.bos_nodes();
   for (Node *node = lattice.bos_nodes()->next;
@@ -1844,8 +2347,19 @@ void ImmutableConverterImpl::InsertCandidates(
     }
     nbest_generator.Reset(prev, node->next, mode);
 
+    size_t segment_expand_size = expand_size;
+    if (DeadlineExceeded(deadline_ticks)) {
+      // Out of budget: degrade to the Viterbi-best candidate per
+      // segment instead of the full n-best expansion.
+      segment_expand_size = 1;
+      segments->set_quality_degraded(true);
+    }
     ExpandCandidates(original_key, &nbest_generator, segment,
-                     segments->request_type(), expand_size);
+                     segments->request_type(), segment_expand_size,
+                     deadline_ticks);
+    if (segment_expand_size != 1 && DeadlineExceeded(deadline_ticks)) {
+      segments->set_quality_degraded(true);
+    }
 
     if (type == MULTI_SEGMENTS || type == SINGLE_SEGMENT) {
       InsertDummyCandidates(segment, expand_size);
@@ -1866,6 +2380,7 @@ void ImmutableConverterImpl::InsertCandidates(
 bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
                                           const Lattice &lattice,
                                           const std::vector<uint16> &group,
+                                          uint64 deadline_ticks,
                                           Segments *segments) const {
   if (segments == NULL) {
     LOG(WARNING) << "Segments is NULL";
@@ -1894,7 +2409,7 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
            max_candidates_size - kOnlyFirstSegmentCandidateSize : 1);
       InsertCandidates(segments, lattice, group,
                        single_segment_candidates_size, SINGLE_SEGMENT,
-                       filter_type);
+                       filter_type, deadline_ticks);
 
       // Even if single_segment_candidates_size + kOnlyFirstSegmentCandidateSize
       // is greater than max_candidates_size, we cannot skip
@@ -1911,11 +2426,11 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
                                             kOnlyFirstSegmentCandidateSize);
       InsertFirstSegmentToCandidates(
           segments, lattice, group, only_first_segment_candidates_size,
-          filter_type);
+          filter_type, deadline_ticks);
     } else {
       InsertCandidates(
           segments, lattice, group, max_candidates_size, SINGLE_SEGMENT,
-          filter_type);
+          filter_type, deadline_ticks);
     }
   } else {
     DCHECK(!request.create_partial_candidates());
@@ -1935,7 +2450,7 @@ bool ImmutableConverterImpl::MakeSegments(const ConversionRequest &request,
         segments->conversion_segments_size();
     InsertCandidates(
         segments, lattice, group, max_candidates_size, MULTI_SEGMENTS,
-        filter_type);
+        filter_type, deadline_ticks);
     if (old_conversion_segments_size > 0) {
       segments->erase_segments(segments->history_segments_size(),
                                old_conversion_segments_size);
@@ -1955,24 +2470,146 @@ void ImmutableConverterImpl::MakeGroup(
   group->push_back(static_cast<uint16>(segments.segments_size()));
 }
 
+bool ImmutableConverterImpl::MakeResultCacheKey(
+    const ConversionRequest &request,
+    const Segments &segments, uint64 *fingerprint) const {
+  DCHECK(fingerprint);
+  if (segments.request_type() != Segments::CONVERSION) {
+    return false;
+  }
+
+  string buf;
+  size_t total_key_size = 0;
+  for (size_t i = 0; i < segments.segments_size(); ++i) {
+    const Segment &segment = segments.segment(i);
+    total_key_size += segment.key().size();
+    buf.append(segment.key());
+    buf.append(1, '\t');
+    buf.append(1, static_cast<char>(segment.segment_type()));
+    if (i < segments.history_segments_size()) {
+      if (segment.candidates_size() == 0) {
+        return false;
+      }
+      // The right context of the history affects the whole lattice.
+      const Segment::Candidate &candidate = segment.candidate(0);
+      buf.append(reinterpret_cast<const char *>(&candidate.rid),
+                 sizeof(candidate.rid));
+      buf.append(candidate.value);
+      buf.append(1, '\t');
+    }
+  }
+  // Overlong keys make MakeLattice() drop the history segments as a
+  // side effect; do not cache those requests.
+  if (total_key_size >= kMaxCharLength) {
+    return false;
+  }
+  const char flags[] = {
+    static_cast<char>(request.request().mixed_conversion()),
+    static_cast<char>(request.create_partial_candidates()),
+    static_cast<char>(request.IsKanaModifierInsensitiveConversion()),
+    static_cast<char>(request.config().preedit_method()),
+  };
+  buf.append(flags, sizeof(flags));
+  const uint32 max_candidates_size =
+      static_cast<uint32>(segments.max_conversion_candidates_size());
+  buf.append(reinterpret_cast<const char *>(&max_candidates_size),
+             sizeof(max_candidates_size));
+  // A user dictionary reload changes what the lattice produces even for
+  // results that end up without USER_DICTIONARY candidates (e.g. a word
+  // the user just added or removed).  Folding the generation into the
+  // key invalidates everything cached against the old image.
+  const uint64 user_dictionary_generation = UserDictionary::generation();
+  buf.append(reinterpret_cast<const char *>(&user_dictionary_generation),
+             sizeof(user_dictionary_generation));
+
+  *fingerprint = Hash::Fingerprint(buf);
+  return true;
+}
+
+void ImmutableConverterImpl::ApplyCachedResult(
+    const Segments &cached, Segments *segments) const {
+  // Mirror the segment replacement of InsertCandidates(): append the
+  // result segments first, then erase the old conversion segments.
+  const size_t old_conversion_segments_size =
+      segments->conversion_segments_size();
+  for (size_t i = 0; i < cached.segments_size(); ++i) {
+    Segment *segment = segments->add_segment();
+    segment->CopyFrom(cached.segment(i));
+  }
+  if (old_conversion_segments_size > 0) {
+    segments->erase_segments(segments->history_segments_size(),
+                             old_conversion_segments_size);
+  }
+}
+
+void ImmutableConverterImpl::StoreResultToCache(
+    const Segments &segments, uint64 fingerprint) const {
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      if (segment.candidate(j).attributes &
+          Segment::Candidate::USER_DICTIONARY) {
+        return;
+      }
+    }
+  }
+  std::shared_ptr<Segments> cached(new Segments);
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    Segment *segment = cached->add_segment();
+    segment->CopyFrom(segments.conversion_segment(i));
+  }
+  result_cache_.Insert(fingerprint,
+                       std::shared_ptr<const Segments>(cached));
+}
+
 bool ImmutableConverterImpl::ConvertForRequest(
     const ConversionRequest &request, Segments *segments) const {
   const bool is_prediction =
       (segments->request_type() == Segments::PREDICTION ||
        segments->request_type() == Segments::SUGGESTION);
 
+  const uint64 deadline_ticks = GetDeadlineTicks(request);
+  segments->set_quality_degraded(false);
+
+  uint64 cache_fingerprint = 0;
+  const bool cacheable =
+      MakeResultCacheKey(request, *segments, &cache_fingerprint);
+  if (cacheable) {
+    std::shared_ptr<const Segments> cached;
+    if (result_cache_.Lookup(cache_fingerprint, &cached) &&
+        cached != nullptr) {
+      // Keep the history segment normalization of the regular path.
+      NormalizeHistorySegments(segments);
+      ApplyCachedResult(*cached, segments);
+      return true;
+    }
+  }
+
   Lattice *lattice = GetLattice(segments, is_prediction);
 
+  const bool profiling = conversion_profile::IsEnabled();
+  Stopwatch stopwatch;
+  if (profiling) {
+    stopwatch.Start();
+  }
+
   if (!MakeLattice(request, segments, lattice)) {
     LOG(WARNING) << "could not make lattice";
     return false;
   }
 
+  if (profiling) {
+    stopwatch.Stop();
+    conversion_profile::AddLatticeTime(stopwatch.GetElapsedMicroseconds());
+    stopwatch.Reset();
+    stopwatch.Start();
+  }
+
   std::vector<uint16> group;
   MakeGroup(*segments, &group);
 
   if (is_prediction) {
-    if (!PredictionViterbi(*segments, lattice)) {
+    if (!PredictionViterbi(request, *segments, lattice)) {
       LOG(WARNING) << "prediction_viterbi failed";
       return false;
     }
@@ -1983,12 +2620,30 @@ bool ImmutableConverterImpl::ConvertForRequest(
     }
   }
 
+  if (profiling) {
+    stopwatch.Stop();
+    conversion_profile::AddViterbiTime(stopwatch.GetElapsedMicroseconds());
+    stopwatch.Reset();
+    stopwatch.Start();
+  }
+
   VLOG(2) << lattice->DebugString();
-  if (!MakeSegments(request, *lattice, group, segments)) {
+  Lattice::MaybeSampleDump(lattice);
+  if (!MakeSegments(request, *lattice, group, deadline_ticks, segments)) {
     LOG(WARNING) << "make segments failed";
     return false;
   }
 
+  if (profiling) {
+    stopwatch.Stop();
+    conversion_profile::AddNBestTime(stopwatch.GetElapsedMicroseconds());
+  }
+
+  // Degraded results are not worth pinning in the cache.
+  if (cacheable && !segments->quality_degraded()) {
+    StoreResultToCache(*segments, cache_fingerprint);
+  }
+
   return true;
 }
 
@@ -30,6 +30,7 @@
 #ifndef MOZC_CONVERTER_IMMUTABLE_CONVERTER_H_
 #define MOZC_CONVERTER_IMMUTABLE_CONVERTER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,7 @@
 #include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "storage/sharded_lru_cache.h"
 //  for FRIEND_TEST()
 #include "testing/base/public/gunit_prod.h"
 
@@ -78,6 +80,7 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   FRIEND_TEST(ImmutableConverterTest, PredictiveNodesOnlyForConversionKey);
   FRIEND_TEST(NBestGeneratorTest, InnerSegmentBoundary);
   FRIEND_TEST(NBestGeneratorTest, MultiSegmentConnectionTest);
+  FRIEND_TEST(NBestGeneratorTest, NoDuplicateCandidatesInDeepEnumeration);
   FRIEND_TEST(NBestGeneratorTest, SingleSegmentConnectionTest);
   friend class NBestGeneratorTest;
 
@@ -99,7 +102,7 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   void ExpandCandidates(const string &original_key,
                         NBestGenerator *nbest, Segment *segment,
                         Segments::RequestType request_type,
-                        size_t expand_size) const;
+                        size_t expand_size, uint64 deadline_ticks) const;
   void InsertDummyCandidates(Segment *segment, size_t expand_size) const;
   Node *Lookup(const int begin_pos, const int end_pos,
                const ConversionRequest &request,
@@ -121,12 +124,29 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
 
   bool MakeLattice(const ConversionRequest &request,
                    Segments *segments, Lattice *lattice) const;
+  // Splices the virtual history node chain into the lattice.
+  // |cached_history_fingerprint| (owned by the caller's Segments)
+  // identifies the chain built by the previous request; when it matches
+  // the current history and the chain survived the incremental key
+  // update, the per-segment rebuild is skipped.
   bool MakeLatticeNodesForHistorySegments(
       const Segments &segments, const ConversionRequest &request,
-      Lattice *lattice) const;
+      uint64 *cached_history_fingerprint, Lattice *lattice) const;
+  // Adds suffix nodes derived from dictionary compounds overlapping the
+  // last history segment and the conversion key ("おいかわ(及川)" +
+  // "たくや" -> "卓也").  |segments_pos| is the begin position of the
+  // last history segment and |rnode| its virtual node.  Split from
+  // MakeLatticeNodesForHistorySegments() because this part depends on
+  // the conversion key and must run even when the chain is reused.
+  void MakeCompoundSuffixNodes(const Segments &segments,
+                               const ConversionRequest &request,
+                               size_t segments_pos,
+                               Node *rnode,
+                               Lattice *lattice) const;
   void MakeLatticeNodesForConversionSegments(
       const Segments &segments, const ConversionRequest &request,
-      const string &history_key, Lattice *lattice) const;
+      const string &history_key, KeyCorrector *key_corrector,
+      Lattice *lattice) const;
   void MakeLatticeNodesForPredictiveNodes(
       const Segments &segments, const ConversionRequest &request,
       Lattice *lattice) const;
@@ -139,9 +159,14 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
 
   bool Viterbi(const Segments &segments, Lattice *lattice) const;
 
-  bool PredictionViterbi(const Segments &segments, Lattice *lattice) const;
+  bool PredictionViterbi(const ConversionRequest &request,
+                         const Segments &segments, Lattice *lattice) const;
+  // Runs the prediction Viterbi for [calc_begin_pos, calc_end_pos].  If
+  // |beam_width| is nonzero, only that many lowest-cost live nodes are
+  // kept per position.
   void PredictionViterbiInternal(
-      int calc_begin_pos, int calc_end_pos, Lattice *lattice) const;
+      int calc_begin_pos, int calc_end_pos, size_t beam_width,
+      Lattice *lattice) const;
 
   // TODO(toshiyuki): Change parameter order for mutable |segments|.
 
@@ -151,14 +176,16 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                                       const Lattice &lattice,
                                       const std::vector<uint16> &group,
                                       size_t max_candidates_size,
-                                      FilterType filter_type) const;
+                                      FilterType filter_type,
+                                      uint64 deadline_ticks) const;
 
   void InsertCandidates(Segments *segments,
                         const Lattice &lattice,
                         const std::vector<uint16> &group,
                         size_t max_candidates_size,
                         InsertCandidatesType type,
-                        FilterType filter_type) const;
+                        FilterType filter_type,
+                        uint64 deadline_ticks) const;
 
   // Helper function for InsertCandidates().
   // Returns true if |node| is valid node for segment end.
@@ -176,9 +203,27 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                                   const Node *node,
                                   Segments *segments) const;
 
+  // Computes the result-cache fingerprint of (segment keys and types,
+  // history context, relevant request flags, user dictionary
+  // generation).  Returns false if the
+  // request is not cacheable (non-CONVERSION request types, history
+  // segments without candidates).
+  bool MakeResultCacheKey(const ConversionRequest &request,
+                          const Segments &segments, uint64 *fingerprint) const;
+
+  // Replaces the conversion segments of |segments| with a deep copy of
+  // the cached conversion segments.
+  void ApplyCachedResult(const Segments &cached, Segments *segments) const;
+
+  // Stores a deep copy of the conversion segments into the result
+  // cache.  Results containing user dictionary candidates are not
+  // stored; they could go stale when the user edits the dictionary.
+  void StoreResultToCache(const Segments &segments, uint64 fingerprint) const;
+
   bool MakeSegments(const ConversionRequest &request,
                     const Lattice &lattice,
                     const std::vector<uint16> &group,
+                    uint64 deadline_ticks,
                     Segments *segments) const;
 
   void MakeGroup(const Segments &segments, std::vector<uint16> *group) const;
@@ -209,6 +254,13 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   // Cache for transition cost.
   const int32 last_to_first_name_transition_cost_;
 
+  // Bounded cache of conversion results shared by all sessions, keyed by
+  // MakeResultCacheKey().  A hit bypasses lattice construction entirely.
+  // The sharded cache is safe for concurrent conversions; cached results
+  // are immutable and handed out by shared_ptr.
+  mutable storage::ShardedLRUCache<uint64, std::shared_ptr<const Segments> >
+      result_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(ImmutableConverterImpl);
 };
 
@@ -459,6 +459,49 @@ TEST(ImmutableConverterTest, HistoryKeyLengthIsVeryLong) {
   EXPECT_EQ(kRequestKey, segments.segment(0).key());
 }
 
+TEST(ImmutableConverterTest, CachedHistoryChainIsReused) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  {
+    Segment *segment = segments.add_segment();
+    SetCandidate("わたしの", "私の", segment);
+    segment->set_segment_type(Segment::HISTORY);
+  }
+  const string kRequestKey = "なまえはなかのです";
+  segments.add_segment()->set_key(kRequestKey);
+  ASSERT_TRUE(data_and_converter->GetConverter()->Convert(&segments));
+  ASSERT_GT(segments.conversion_segments_size(), 0);
+  string first_result;
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    ASSERT_GT(segments.conversion_segment(i).candidates_size(), 0);
+    first_result += segments.conversion_segment(i).candidate(0).value;
+  }
+
+  // A reconversion of the same key with unchanged history goes through
+  // the cached history chain and must produce the same result.
+  segments.clear_conversion_segments();
+  segments.add_segment()->set_key(kRequestKey);
+  ASSERT_TRUE(data_and_converter->GetConverter()->Convert(&segments));
+  string second_result;
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    ASSERT_GT(segments.conversion_segment(i).candidates_size(), 0);
+    second_result += segments.conversion_segment(i).candidate(0).value;
+  }
+  EXPECT_EQ(first_result, second_result);
+
+  // Changing the history invalidates the chain; conversion must still
+  // succeed with the rebuilt one.
+  segments.mutable_segment(0)->mutable_candidate(0)->value = "渡しの";
+  segments.clear_conversion_segments();
+  segments.add_segment()->set_key(kRequestKey);
+  EXPECT_TRUE(data_and_converter->GetConverter()->Convert(&segments));
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    EXPECT_GT(segments.conversion_segment(i).candidates_size(), 0);
+  }
+}
+
 namespace {
 bool AutoPartialSuggestionTestHelper(const ConversionRequest &request) {
   std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
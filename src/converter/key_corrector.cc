@@ -45,6 +45,12 @@ const size_t kMaxSize = 128;
 // invalid alignment marker
 const size_t kInvalidPos = static_cast<size_t>(-1);
 
+// The rewrite functions below read at most 4 Hiragana characters
+// (12 bytes in UTF-8) from the position they are called at, so a
+// correction decision made at position P can only be affected by an
+// appended suffix if P + kMaxRewriteWindow overran the previous key.
+const size_t kMaxRewriteWindow = 12;
+
 // "ん" (few "n" pettern)
 // "んあ" -> "んな"
 // "んい" -> "んに"
@@ -368,12 +374,12 @@ bool RewriteYu(size_t key_pos,
 
 KeyCorrector::KeyCorrector(const string &key, InputMode mode,
                            size_t history_size)
-    : available_(false), mode_(mode) {
+    : available_(false), mode_(mode), history_size_(history_size) {
   CorrectKey(key, mode, history_size);
 }
 
 KeyCorrector::KeyCorrector()
-    : available_(false), mode_(ROMAN) {}
+    : available_(false), mode_(ROMAN), history_size_(0) {}
 
 KeyCorrector::~KeyCorrector() {}
 
@@ -414,30 +420,69 @@ void KeyCorrector::Clear() {
   corrected_key_.clear();
   alignment_.clear();
   rev_alignment_.clear();
+  checkpoints_.clear();
 }
 
 bool KeyCorrector::CorrectKey(const string &key, InputMode mode,
                               size_t history_size) {
-  Clear();
-
   // TOOD(taku)  support KANA
   if (mode == KANA) {
+    Clear();
     return false;
   }
 
   if (key.size() == 0 || key.size() >= kMaxSize) {
     VLOG(1) << "invalid key length";
+    Clear();
     return false;
   }
 
+  // If |key| extends the previously corrected key, rewind to the last
+  // checkpoint whose rewrite window did not overrun the previous key
+  // and rescan only the remaining tail.
+  size_t resume_original_pos = 0;
+  size_t resume_key_pos = 0;
+  bool resumed = false;
+  if (available_ && mode == mode_ && history_size == history_size_ &&
+      key.size() >= original_key_.size() &&
+      key.compare(0, original_key_.size(), original_key_) == 0) {
+    while (!checkpoints_.empty() &&
+           checkpoints_.back().original_pos + kMaxRewriteWindow >
+               original_key_.size()) {
+      checkpoints_.pop_back();
+    }
+    if (!checkpoints_.empty()) {
+      const Checkpoint &checkpoint = checkpoints_.back();
+      resume_original_pos = checkpoint.original_pos;
+      resume_key_pos = checkpoint.key_pos;
+      corrected_key_.erase(checkpoint.corrected_pos);
+      alignment_.resize(checkpoint.original_pos);
+      rev_alignment_.resize(checkpoint.corrected_pos);
+      // The loop below re-pushes the checkpoint for this position.
+      checkpoints_.pop_back();
+      resumed = true;
+    }
+  }
+  if (!resumed) {
+    Clear();
+  }
+
+  available_ = false;
+  mode_ = mode;
+  history_size_ = history_size;
   original_key_ = key;
 
-  const char *begin = key.data();
+  const char *begin = key.data() + resume_original_pos;
   const char *end = key.data() + key.size();
   const char *input_begin = key.data() + history_size;
-  size_t key_pos = 0;
+  size_t key_pos = resume_key_pos;
 
   while (begin < end) {
+    const Checkpoint checkpoint = {
+      static_cast<size_t>(begin - key.data()), corrected_key_.size(), key_pos
+    };
+    checkpoints_.push_back(checkpoint);
+
     size_t mblen = 0;
     const size_t org_len = corrected_key_.size();
     if (begin < input_begin ||
@@ -522,6 +567,49 @@ const char *KeyCorrector::GetCorrectedPrefix(const size_t original_key_pos,
   return NULL;
 }
 
+void KeyCorrector::GetCorrectedPrefixes(
+    std::vector<std::pair<size_t, StringPiece> > *prefixes) const {
+  DCHECK(prefixes);
+  prefixes->clear();
+
+  if (!IsAvailable() || mode_ == KANA) {
+    return;
+  }
+
+  // GetCorrectedPrefix(pos) returns non-NULL iff the corrected position
+  // is valid and the two suffixes differ.  Walk the key backwards and
+  // latch |suffix_differs| once a differing span is crossed; equal-length
+  // suffixes only need the chunk up to the previous valid position
+  // compared, so the whole sweep is linear in the key length.
+  std::vector<std::pair<size_t, StringPiece> > reversed;
+  bool suffix_differs = false;
+  size_t prev_pos = original_key_.size();
+  for (size_t i = original_key_.size(); i > 0; --i) {
+    const size_t pos = i - 1;
+    const size_t corrected_pos = GetCorrectedPosition(pos);
+    if (!IsValidPosition(corrected_pos)) {
+      continue;
+    }
+    const size_t original_length = original_key_.size() - pos;
+    const size_t corrected_length = corrected_key_.size() - corrected_pos;
+    if (original_length != corrected_length) {
+      suffix_differs = true;
+    } else if (!suffix_differs) {
+      suffix_differs = (memcmp(original_key_.data() + pos,
+                               corrected_key_.data() + corrected_pos,
+                               prev_pos - pos) != 0);
+    }
+    if (suffix_differs) {
+      reversed.push_back(std::make_pair(
+          pos, StringPiece(corrected_key_.data() + corrected_pos,
+                           corrected_length)));
+    }
+    prev_pos = pos;
+  }
+
+  prefixes->assign(reversed.rbegin(), reversed.rend());
+}
+
 size_t KeyCorrector::GetOriginalOffset(const size_t original_key_pos,
                                        const size_t new_key_offset) const {
   if (!IsAvailable()) {
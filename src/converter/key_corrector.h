@@ -31,9 +31,11 @@
 #define MOZC_CONVERTER_KEY_CORRECTOR_H_
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 
 namespace mozc {
 
@@ -50,6 +52,11 @@ class KeyCorrector {
 
   InputMode mode() const;
 
+  // Computes the corrected-key mapping for |key|.  When |key| extends
+  // the previously corrected key with the same |mode| and
+  // |history_size|, the scan resumes from the last checkpoint that
+  // cannot be affected by the appended suffix, so per-keystroke calls
+  // only rescan the tail of the key.
   bool CorrectKey(const string &key, InputMode mode, size_t history_size);
 
   // return corrected key;
@@ -116,6 +123,16 @@ class KeyCorrector {
   const char *GetCorrectedPrefix(const size_t original_key_pos,
                                  size_t *length) const;
 
+  // Batched version of GetCorrectedPrefix().  Fills |prefixes| with
+  // (original position, corrected prefix) pairs for every position
+  // where GetCorrectedPrefix() returns non-NULL, in ascending order of
+  // position.  Unlike calling GetCorrectedPrefix() for each position,
+  // which compares the suffixes from scratch every time, this runs in a
+  // single backward sweep over the key.  The StringPieces point into
+  // corrected_key() and are valid until the next CorrectKey()/Clear().
+  void GetCorrectedPrefixes(
+      std::vector<std::pair<size_t, StringPiece> > *prefixes) const;
+
   // This is a helper function for CommonPrefixSearch in Converter.
   // Basically it is equivalent to
   // GetOriginalPosition(GetCorrectedPosition(original_key_pos)
@@ -152,12 +169,22 @@ class KeyCorrector {
   void Clear();
 
  private:
+  // Scan state saved at the beginning of each CorrectKey() iteration so
+  // that a subsequent call with an extended key can resume mid-key.
+  struct Checkpoint {
+    size_t original_pos;
+    size_t corrected_pos;
+    size_t key_pos;
+  };
+
   bool available_;
   InputMode mode_;
+  size_t history_size_;
   string corrected_key_;
   string original_key_;
   std::vector<size_t> alignment_;
   std::vector<size_t> rev_alignment_;
+  std::vector<Checkpoint> checkpoints_;
 
   DISALLOW_COPY_AND_ASSIGN(KeyCorrector);
 };
@@ -30,8 +30,11 @@
 #include "converter/key_corrector.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -497,6 +500,62 @@ TEST(KeyCorrectorTest, KeyCorrectorRomanGetOriginalOffsetTest) {
 }
 
 // Check if UCS4 is supported. b/3386634
+TEST(KeyCorrectorTest, IncrementalCorrectKeyTest) {
+  // Extending the key one keystroke at a time must produce exactly the
+  // same result as correcting the final key from scratch.
+  const string input = "みんあにお年玉をくばりたいんです";
+  KeyCorrector incremental_corrector;
+  for (size_t len = 3; len <= input.size(); len += 3) {
+    const string prefix = input.substr(0, len);
+    incremental_corrector.CorrectKey(prefix, KeyCorrector::ROMAN, 0);
+    KeyCorrector corrector(prefix, KeyCorrector::ROMAN, 0);
+    EXPECT_EQ(corrector.IsAvailable(),
+              incremental_corrector.IsAvailable());
+    EXPECT_EQ(corrector.corrected_key(),
+              incremental_corrector.corrected_key());
+    EXPECT_EQ(corrector.original_key(),
+              incremental_corrector.original_key());
+    for (size_t pos = 0; pos < prefix.size(); ++pos) {
+      EXPECT_EQ(corrector.GetCorrectedPosition(pos),
+                incremental_corrector.GetCorrectedPosition(pos));
+      EXPECT_EQ(corrector.GetOriginalPosition(pos),
+                incremental_corrector.GetOriginalPosition(pos));
+    }
+  }
+
+  // A key that does not extend the previous one falls back to a full
+  // rescan.
+  incremental_corrector.CorrectKey("きゅきゅしゃをよんだ",
+                                   KeyCorrector::ROMAN, 0);
+  EXPECT_TRUE(incremental_corrector.IsAvailable());
+  EXPECT_EQ("きゅうきゅうしゃをよんだ",
+            incremental_corrector.corrected_key());
+}
+
+TEST(KeyCorrectorTest, GetCorrectedPrefixesTest) {
+  const string input = "みんあであそぼう";
+  KeyCorrector corrector(input, KeyCorrector::ROMAN, 0);
+  EXPECT_TRUE(corrector.IsAvailable());
+
+  // The batched result must agree with GetCorrectedPrefix() for every
+  // position.
+  std::vector<std::pair<size_t, StringPiece> > prefixes;
+  corrector.GetCorrectedPrefixes(&prefixes);
+  size_t index = 0;
+  for (size_t pos = 0; pos < input.size(); ++pos) {
+    size_t length = 0;
+    const char *prefix = corrector.GetCorrectedPrefix(pos, &length);
+    if (prefix == NULL) {
+      continue;
+    }
+    ASSERT_LT(index, prefixes.size());
+    EXPECT_EQ(pos, prefixes[index].first);
+    EXPECT_EQ(StringPiece(prefix, length), prefixes[index].second);
+    ++index;
+  }
+  EXPECT_EQ(prefixes.size(), index);
+}
+
 TEST(KeyCorrectorTest, UCS4IsAvailable) {
   {
     const string input = "𠮟";  // UCS4 char in UTF8
@@ -76,6 +76,7 @@ Node *InitEOSNode(Lattice *lattice, uint16 length) {
   return eos_node;
 }
 
+#ifdef MOZC_ENABLE_LATTICE_INSTRUMENTATION
 bool PathContainsString(const Node *node, size_t begin_pos, size_t end_pos,
                         const string &str) {
   CHECK(node);
@@ -87,6 +88,7 @@ bool PathContainsString(const Node *node, size_t begin_pos, size_t end_pos,
   }
   return false;
 }
+#endif  // MOZC_ENABLE_LATTICE_INSTRUMENTATION
 
 string GetDebugStringForNode(const Node *node, const Node *prev_node) {
   CHECK(node);
@@ -134,15 +136,47 @@ string GetCommonPrefix(const string &str1, const string &str2) {
   return common_prefix;
 }
 
+const size_t kCleanPos = static_cast<size_t>(-1);
+
+// Parameters for the decayed high-water mark that pre-sizes the column
+// vectors in SetKey().  The mark loses 1/kHighWaterDecayFactor of its
+// value per conversion, so it follows the workload down after a burst of
+// unusually long keys.  When the buffers are more than kColumnShrinkFactor
+// times larger than the mark requires, they are released and reallocated
+// at the right size to bound idle memory.
+const size_t kHighWaterDecayFactor = 8;
+const size_t kColumnShrinkFactor = 4;
+
+// Countdown value used while dump sampling is disabled.  Large enough
+// that the inline decrement in MaybeSampleDump() never reaches zero in
+// practice; if it ever does, SampleDump() just rearms it.
+const size_t kDumpSamplingDisabled = static_cast<size_t>(-1);
+
+void LogSampledDump(const string &dump) {
+  LOG(INFO) << "Sampled lattice dump:\n" << dump;
+}
+
 }  // namespace
 
+#ifdef MOZC_ENABLE_LATTICE_INSTRUMENTATION
 struct LatticeDisplayNodeInfo {
   size_t display_node_begin_pos_;
   size_t display_node_end_pos_;
   string display_node_str_;
 };
+#endif  // MOZC_ENABLE_LATTICE_INSTRUMENTATION
+
+size_t Lattice::dump_sampling_interval_ = 0;
+size_t Lattice::dump_sampling_countdown_ = kDumpSamplingDisabled;
+Lattice::DumpSamplingCallback Lattice::dump_sampling_callback_ =
+    &LogSampledDump;
 
-Lattice::Lattice() : history_end_pos_(0), node_allocator_(new NodeAllocator) {}
+Lattice::Lattice()
+    : history_end_pos_(0),
+      node_allocator_(new NodeAllocator),
+      reusable_viterbi_end_pos_(0),
+      next_dirty_pos_(kCleanPos),
+      key_size_high_water_(0) {}
 
 Lattice::~Lattice() {}
 
@@ -154,6 +188,11 @@ Node *Lattice::NewNode() {
   return node_allocator_->NewNode();
 }
 
+void Lattice::AdoptAllocator(NodeAllocator *allocator) {
+  DCHECK(allocator);
+  adopted_allocators_.emplace_back(allocator);
+}
+
 Node *Lattice::begin_nodes(size_t pos) const {
   return begin_nodes_[pos];
 }
@@ -166,6 +205,23 @@ void Lattice::SetKey(StringPiece key) {
   Clear();
   key_.assign(key.data(), key.size());
   const size_t size = key.size();
+
+  // Update the decayed high-water mark and pre-size the column vectors
+  // to it, so that steady-state conversion inside a session does zero
+  // vector growth.  Clear() keeps the capacity of the vectors, hence
+  // reserving beyond the current key costs nothing per conversion.
+  key_size_high_water_ = std::max(
+      size, key_size_high_water_ - key_size_high_water_ / kHighWaterDecayFactor);
+  const size_t reserve_size = key_size_high_water_ + 4;
+  if (begin_nodes_.capacity() > reserve_size * kColumnShrinkFactor) {
+    std::vector<Node *>().swap(begin_nodes_);
+    std::vector<Node *>().swap(end_nodes_);
+    std::vector<size_t>().swap(cache_info_);
+  }
+  begin_nodes_.reserve(reserve_size);
+  end_nodes_.reserve(reserve_size);
+  cache_info_.reserve(reserve_size);
+
   begin_nodes_.resize(size + 4);
   end_nodes_.resize(size + 4);
   cache_info_.resize(size + 4);
@@ -179,6 +235,8 @@ void Lattice::SetKey(StringPiece key) {
                               static_cast<uint16>(0));
   begin_nodes_[key_.size()] =
       InitEOSNode(this, static_cast<uint16>(key_.size()));
+  reusable_viterbi_end_pos_ = 0;
+  next_dirty_pos_ = kCleanPos;
 }
 
 Node *Lattice::bos_nodes() const {
@@ -192,6 +250,9 @@ Node *Lattice::eos_nodes() const {
 void Lattice::Insert(size_t pos, Node *node) {
   for (Node *rnode = node; rnode != NULL; rnode = rnode->bnext) {
     const size_t end_pos = std::min(rnode->key.size() + pos, key_.size());
+    if (!(rnode->attributes & Node::ENABLE_CACHE)) {
+      next_dirty_pos_ = std::min(next_dirty_pos_, end_pos);
+    }
     rnode->begin_pos = static_cast<uint16>(pos);
     rnode->end_pos = static_cast<uint16>(end_pos);
     rnode->prev = NULL;
@@ -214,6 +275,33 @@ void Lattice::Insert(size_t pos, Node *node) {
   }
 }
 
+void Lattice::BulkInsert(size_t pos, Node *const *nodes, size_t nodes_size) {
+  if (nodes_size == 0) {
+    return;
+  }
+
+  for (size_t i = 0; i < nodes_size; ++i) {
+    Node *rnode = nodes[i];
+    const size_t end_pos = std::min(rnode->key.size() + pos, key_.size());
+    if (!(rnode->attributes & Node::ENABLE_CACHE)) {
+      next_dirty_pos_ = std::min(next_dirty_pos_, end_pos);
+    }
+    rnode->begin_pos = static_cast<uint16>(pos);
+    rnode->end_pos = static_cast<uint16>(end_pos);
+    rnode->prev = NULL;
+    rnode->next = NULL;
+    rnode->cost = 0;
+    rnode->bnext = (i + 1 == nodes_size) ? NULL : nodes[i + 1];
+    rnode->enext = end_nodes_[end_pos];
+    end_nodes_[end_pos] = rnode;
+  }
+
+  // The run is already chained above, so splicing the begin side list is
+  // O(1) here instead of the tail search done in Insert().
+  nodes[nodes_size - 1]->bnext = begin_nodes_[pos];
+  begin_nodes_[pos] = nodes[0];
+}
+
 const string &Lattice::key() const {
   return key_;
 }
@@ -227,10 +315,31 @@ void Lattice::Clear() {
   begin_nodes_.clear();
   end_nodes_.clear();
   node_allocator_->Free();
+  adopted_allocators_.clear();
   cache_info_.clear();
   history_end_pos_ = 0;
+  reusable_viterbi_end_pos_ = 0;
+  next_dirty_pos_ = kCleanPos;
+}
+
+void Lattice::Compact() {
+  Clear();
+  node_allocator_->FreeAll();
+  string().swap(key_);
+  std::vector<Node *>().swap(begin_nodes_);
+  std::vector<Node *>().swap(end_nodes_);
+  std::vector<size_t>().swap(cache_info_);
+  key_size_high_water_ = 0;
 }
 
+size_t Lattice::RetainedBytes() const {
+  return node_allocator_->RetainedBytes() +
+         (begin_nodes_.capacity() + end_nodes_.capacity()) * sizeof(Node *) +
+         cache_info_.capacity() * sizeof(size_t) +
+         key_.capacity();
+}
+
+#ifdef MOZC_ENABLE_LATTICE_INSTRUMENTATION
 void Lattice::SetDebugDisplayNode(size_t begin_pos, size_t end_pos,
                                   const string &str) {
   LatticeDisplayNodeInfo *info = Singleton<LatticeDisplayNodeInfo>::get();
@@ -243,6 +352,28 @@ void Lattice::ResetDebugDisplayNode() {
   LatticeDisplayNodeInfo *info = Singleton<LatticeDisplayNodeInfo>::get();
   info->display_node_str_.clear();
 }
+#endif  // MOZC_ENABLE_LATTICE_INSTRUMENTATION
+
+void Lattice::SetDumpSamplingInterval(size_t interval) {
+  dump_sampling_interval_ = interval;
+  dump_sampling_countdown_ =
+      (interval == 0) ? kDumpSamplingDisabled : interval;
+}
+
+void Lattice::SetDumpSamplingCallback(DumpSamplingCallback callback) {
+  dump_sampling_callback_ = (callback == NULL) ? &LogSampledDump : callback;
+}
+
+void Lattice::SampleDump(const Lattice *lattice) {
+  if (dump_sampling_interval_ == 0) {
+    // Disabled; the countdown wrapped around after 2^64 decrements.
+    dump_sampling_countdown_ = kDumpSamplingDisabled;
+    return;
+  }
+  dump_sampling_countdown_ = dump_sampling_interval_;
+  DCHECK(lattice);
+  dump_sampling_callback_(lattice->DebugString());
+}
 
 void Lattice::set_history_end_pos(size_t pos) {
   history_end_pos_ = pos;
@@ -269,6 +400,12 @@ void Lattice::UpdateKey(const string &new_key) {
     return;
   }
 
+  // The Viterbi results of the previous request stay valid up to the
+  // common prefix, but no further than the first column touched by a
+  // node that ResetNodeCost() will erase.
+  reusable_viterbi_end_pos_ = std::min(common_prefix.size(), next_dirty_pos_);
+  next_dirty_pos_ = kCleanPos;
+
   // erase the suffix of old_key so that the key becomes common_prefix
   ShrinkKey(common_prefix.size());
   // add a suffix so that the key becomes new_key
@@ -281,6 +418,7 @@ void Lattice::AddSuffix(const string &suffix_key) {
   }
   const size_t old_size = key_.size();
   const size_t new_size = key_.size() + suffix_key.size();
+  key_size_high_water_ = std::max(key_size_high_water_, new_size);
 
   // update begin_nodes and end_nodes
   begin_nodes_.resize(new_size + 4);
@@ -291,8 +429,12 @@ void Lattice::AddSuffix(const string &suffix_key) {
   std::fill(end_nodes_.begin() + old_size + 1, end_nodes_.end(),
             static_cast<Node *>(NULL));
 
-  end_nodes_[0] = InitBOSNode(this,
-                              static_cast<uint16>(0));
+  // Keep the existing BOS node if any; recreating it here would orphan
+  // the prev pointers of cached nodes connecting to it.
+  if (end_nodes_[0] == NULL) {
+    end_nodes_[0] = InitBOSNode(this,
+                                static_cast<uint16>(0));
+  }
   begin_nodes_[new_size] =
       InitEOSNode(this, static_cast<uint16>(new_size));
 
@@ -352,6 +494,10 @@ void Lattice::ShrinkKey(const size_t new_len) {
   key_.erase(new_len);
 }
 
+size_t Lattice::reusable_viterbi_end_pos() const {
+  return reusable_viterbi_end_pos_;
+}
+
 size_t Lattice::cache_info(const size_t pos) const {
   CHECK_LE(pos, key_.size());
   return cache_info_[pos];
@@ -422,26 +568,51 @@ void Lattice::ResetNodeCost() {
   }
 }
 
+void Lattice::EraseHistoryNodes() {
+  if (begin_nodes_.empty()) {
+    return;
+  }
+  // Stale chains never extend beyond the previous history end; the key
+  // may have shrunk below it in the meantime.
+  const size_t end = std::min(history_end_pos_, key_.size());
+  for (size_t i = 0; i <= end; ++i) {
+    for (Node **p = &begin_nodes_[i]; *p != NULL; ) {
+      if ((*p)->node_type == Node::HIS_NODE) {
+        *p = (*p)->bnext;
+      } else {
+        p = &(*p)->bnext;
+      }
+    }
+    for (Node **p = &end_nodes_[i]; *p != NULL; ) {
+      if ((*p)->node_type == Node::HIS_NODE) {
+        *p = (*p)->enext;
+      } else {
+        p = &(*p)->enext;
+      }
+    }
+  }
+}
+
 string Lattice::DebugString() const {
   std::stringstream os;
   if (!has_lattice()) {
     return "";
   }
 
-  std::vector<const Node *> best_path_nodes;
-
   const Node *node = eos_nodes();
   // Print the best path
   os << "Best path: ";
   os << GetDebugStringForPath(node);
   os << std::endl;
 
+#ifdef MOZC_ENABLE_LATTICE_INSTRUMENTATION
   LatticeDisplayNodeInfo *info = Singleton<LatticeDisplayNodeInfo>::get();
 
   if (info->display_node_str_.empty()) {
     return os.str();
   }
 
+  std::vector<const Node *> best_path_nodes;
   for (; node != NULL; node = node->prev) {
     best_path_nodes.push_back(node);
   }
@@ -472,6 +643,7 @@ string Lattice::DebugString() const {
          << std::endl;
     }
   }
+#endif  // MOZC_ENABLE_LATTICE_INSTRUMENTATION
 
   return os.str();
 }
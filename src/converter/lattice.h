@@ -39,6 +39,14 @@
 #include "converter/node.h"
 #include "converter/node_allocator.h"
 
+// The display-node plumbing behind SetDebugDisplayNode() is pure
+// debugging instrumentation.  It is compiled in for debug builds only;
+// define MOZC_ENABLE_LATTICE_INSTRUMENTATION explicitly to keep it in
+// other builds.  Release binaries compile the hooks to nothing.
+#if defined(DEBUG) && !defined(MOZC_ENABLE_LATTICE_INSTRUMENTATION)
+#define MOZC_ENABLE_LATTICE_INSTRUMENTATION
+#endif  // DEBUG && !MOZC_ENABLE_LATTICE_INSTRUMENTATION
+
 namespace mozc {
 
 class Lattice {
@@ -63,6 +71,11 @@ class Lattice {
   // allocate new node.
   Node *NewNode();
 
+  // Takes the ownership of |allocator| so that nodes allocated from it
+  // (e.g. by parallel lookup workers) live as long as the ones from
+  // node_allocator().  All adopted allocators are freed by Clear().
+  void AdoptAllocator(NodeAllocator *allocator);
+
   // return nodes (linked list) starting with |pos|.
   // To traverse all nodes, use Node::bnext member.
   Node *begin_nodes(size_t pos) const;
@@ -82,9 +95,26 @@ class Lattice {
   // inset nodes (linked list) to the position |pos|.
   void Insert(size_t pos, Node *node);
 
+  // Inserts an array of nodes beginning at the position |pos| in one pass.
+  // All the nodes must be allocated from node_allocator() and must not be
+  // chained into any list yet.  Unlike Insert(), which walks the incoming
+  // list twice, this links both the begin and end side lists with a single
+  // sequential sweep over |nodes|, so lattice construction can hand over
+  // a whole dictionary-lookup result run at once.
+  void BulkInsert(size_t pos, Node *const *nodes, size_t nodes_size);
+
   // clear all lattice and nodes allocated with NewNode method.
   void Clear();
 
+  // Clears the lattice and returns the retained node chunks and column
+  // buffers to the heap, including the high-water marks that normally
+  // keep them warm.  For lattices whose owning session has gone idle.
+  void Compact();
+
+  // Approximate heap bytes retained by the column buffers and the node
+  // allocator.
+  size_t RetainedBytes() const;
+
   // return true if this instance has a valid lattice.
   bool has_lattice() const;
 
@@ -103,33 +133,96 @@ class Lattice {
   // setter
   void SetCacheInfo(const size_t pos, const size_t len);
 
+  // Returns the position P so that the Viterbi results (prev/cost) kept
+  // in the cached nodes are still valid for every node whose begin
+  // position is smaller than P.  The value is computed by UpdateKey()
+  // from the common prefix of the old and new keys and from the
+  // positions touched by nodes without the ENABLE_CACHE attribute, which
+  // are erased by ResetNodeCost() and would otherwise leave stale prev
+  // pointers behind.  Returns 0 right after SetKey()/Clear(), i.e. when
+  // nothing can be reused.
+  size_t reusable_viterbi_end_pos() const;
+
   // revert the wcost of nodes if it has ENABLE_CACHE attribute.
   // This function is needed for wcost may be changed during conversion
   // process for some heuristic methods.
   void ResetNodeCost();
 
+  // Removes the virtual history nodes (HIS_NODE) spliced in by a
+  // previous request.  They carry ENABLE_CACHE so that an unchanged
+  // history survives ResetNodeCost(); an outdated chain therefore has
+  // to be unlinked explicitly before a new one is built.
+  void EraseHistoryNodes();
+
   // Dump the best path and the path that contains the designated string.
   string DebugString() const;
 
   // Set the node info that should be used in DebugString() (For debug use).
+  // Without MOZC_ENABLE_LATTICE_INSTRUMENTATION these are no-ops and the
+  // display-node bookkeeping does not exist in the binary.
+#ifdef MOZC_ENABLE_LATTICE_INSTRUMENTATION
   static void SetDebugDisplayNode(size_t start_pos, size_t end_pos,
                                   const string &str);
 
   // Reset the debug info.
   static void ResetDebugDisplayNode();
+#else  // MOZC_ENABLE_LATTICE_INSTRUMENTATION
+  static void SetDebugDisplayNode(size_t start_pos, size_t end_pos,
+                                  const string &str) {}
+  static void ResetDebugDisplayNode() {}
+#endif  // MOZC_ENABLE_LATTICE_INSTRUMENTATION
+
+  // One-in-N sampling of full lattice dumps, for collecting production
+  // lattices to tune the beam/pruning features offline.  With a nonzero
+  // |interval|, roughly every |interval|-th lattice passed to
+  // MaybeSampleDump() is rendered with DebugString() and handed to the
+  // registered callback (LOG(INFO) by default).  The fast path of the
+  // hook is a single counter decrement and a well-predicted branch, so
+  // it is cheap enough to stay in release binaries; 0 (the default)
+  // disables sampling.
+  typedef void (*DumpSamplingCallback)(const string &dump);
+  static void SetDumpSamplingInterval(size_t interval);
+  static void SetDumpSamplingCallback(DumpSamplingCallback callback);
+  static void MaybeSampleDump(const Lattice *lattice) {
+    // The countdown is deliberately not synchronized: a lost decrement
+    // only shifts which conversion gets sampled.
+    if (--dump_sampling_countdown_ == 0) {
+      SampleDump(lattice);
+    }
+  }
 
  private:
+  // Slow path of MaybeSampleDump(): renders the dump, delivers it and
+  // rearms the countdown.
+  static void SampleDump(const Lattice *lattice);
+
+  static size_t dump_sampling_interval_;
+  static size_t dump_sampling_countdown_;
+  static DumpSamplingCallback dump_sampling_callback_;
+
   // TODO(team): Splitting the cache module may make this module simpler.
   string key_;
   size_t history_end_pos_;
   std::vector<Node *> begin_nodes_;
   std::vector<Node *> end_nodes_;
   std::unique_ptr<NodeAllocator> node_allocator_;
+  std::vector<std::unique_ptr<NodeAllocator> > adopted_allocators_;
 
   // cache_info_ holds cache information about lookup.
   // If cache_info_[pos] equals to len, it means key.substr(pos, k)
   // (1 <= k <= len) is already looked up.
   std::vector<size_t> cache_info_;
+
+  // See reusable_viterbi_end_pos().  |next_dirty_pos_| tracks, during
+  // the current request, the smallest end position of inserted nodes
+  // that will not survive the next ResetNodeCost() call.
+  size_t reusable_viterbi_end_pos_;
+  size_t next_dirty_pos_;
+
+  // Decayed high-water mark of recent key lengths; SetKey() pre-sizes
+  // the column vectors from it so that steady-state conversions do not
+  // grow them, and shrinks them when they are far above the mark.
+  size_t key_size_high_water_;
 };
 
 }  // namespace mozc
@@ -0,0 +1,117 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/lattice_soa.h"
+
+#include <map>
+
+#include "base/logging.h"
+#include "converter/lattice.h"
+#include "converter/node.h"
+
+namespace mozc {
+
+const int32 LatticeSoaView::kInvalidNodeId;
+
+LatticeSoaView::LatticeSoaView() {}
+
+LatticeSoaView::~LatticeSoaView() {}
+
+void LatticeSoaView::Build(const Lattice &lattice) {
+  DCHECK(lattice.has_lattice());
+  const size_t key_size = lattice.key().size();
+
+  nodes_.clear();
+  begin_column_offsets_.clear();
+  begin_column_offsets_.reserve(key_size + 2);
+
+  // Assign node ids position by position in bnext order.  The BOS nodes
+  // only live in the end-node list of position 0, so collect them first.
+  std::map<const Node *, int32> node_ids;
+  for (Node *node = lattice.end_nodes(0); node != NULL; node = node->enext) {
+    node_ids[node] = static_cast<int32>(nodes_.size());
+    nodes_.push_back(node);
+  }
+  for (size_t pos = 0; pos <= key_size; ++pos) {
+    begin_column_offsets_.push_back(nodes_.size());
+    for (Node *node = lattice.begin_nodes(pos); node != NULL;
+         node = node->bnext) {
+      node_ids[node] = static_cast<int32>(nodes_.size());
+      nodes_.push_back(node);
+    }
+  }
+  begin_column_offsets_.push_back(nodes_.size());
+
+  // Fill the dense hot arrays.
+  const size_t size = nodes_.size();
+  costs_.resize(size);
+  wcosts_.resize(size);
+  lids_.resize(size);
+  rids_.resize(size);
+  prevs_.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    const Node *node = nodes_[i];
+    costs_[i] = node->cost;
+    wcosts_[i] = node->wcost;
+    lids_[i] = node->lid;
+    rids_[i] = node->rid;
+    if (node->prev == NULL) {
+      prevs_[i] = kInvalidNodeId;
+    } else {
+      const std::map<const Node *, int32>::const_iterator it =
+          node_ids.find(node->prev);
+      prevs_[i] = (it == node_ids.end()) ? kInvalidNodeId : it->second;
+    }
+  }
+
+  // Build the end-node columns in enext order.
+  end_columns_.resize(key_size + 1);
+  for (size_t pos = 0; pos <= key_size; ++pos) {
+    std::vector<int32> *column = &end_columns_[pos];
+    column->clear();
+    for (Node *node = lattice.end_nodes(pos); node != NULL;
+         node = node->enext) {
+      const std::map<const Node *, int32>::const_iterator it =
+          node_ids.find(node);
+      DCHECK(it != node_ids.end());
+      column->push_back(it->second);
+    }
+  }
+}
+
+void LatticeSoaView::WriteBack() const {
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    Node *node = nodes_[i];
+    node->cost = costs_[i];
+    node->prev =
+        (prevs_[i] == kInvalidNodeId) ? NULL : nodes_[prevs_[i]];
+  }
+}
+
+}  // namespace mozc
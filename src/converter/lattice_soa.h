@@ -0,0 +1,120 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_CONVERTER_LATTICE_SOA_H_
+#define MOZC_CONVERTER_LATTICE_SOA_H_
+
+#include <vector>
+
+#include "base/port.h"
+#include "converter/node.h"
+
+namespace mozc {
+
+class Lattice;
+
+// A structure-of-arrays view of a Lattice for the dynamic-programming
+// pass.  struct Node mixes the Viterbi-hot fields (cost, wcost, lid,
+// rid, prev) with cold presentation fields (key, value, attributes) in
+// one ~100-byte object, so a plain traversal touches one cache line per
+// field access.  This view copies the hot fields into dense parallel
+// arrays indexed by node id and keeps the Node objects out-of-line, so
+// a column scan touches an order of magnitude fewer cache lines.
+//
+// Usage:
+//   LatticeSoaView view;
+//   view.Build(lattice);
+//   ... run the DP over view.costs() / view.rids() / ... ...
+//   view.WriteBack(&lattice);   // publishes cost/prev to the nodes.
+//
+// The shipped Viterbi in immutable_converter.cc instead contracts each
+// column into per-connection-id buckets (with a SIMD variant of the
+// column scan), which captures most of the same cache benefit without a
+// copy pass, so this view is not wired into the converter and is
+// compiled only with the converter tests (see converter_test.gyp).
+class LatticeSoaView {
+ public:
+  // Sentinel for "no previous node".
+  static const int32 kInvalidNodeId = -1;
+
+  LatticeSoaView();
+  ~LatticeSoaView();
+
+  // Rebuilds the view from |lattice|.  Node ids are assigned position by
+  // position in bnext order; BOS and EOS nodes are included.  Previously
+  // built arrays are reused, so a view instance can be recycled across
+  // conversions without reallocation.
+  void Build(const Lattice &lattice);
+
+  // Number of nodes in the view.
+  size_t size() const { return nodes_.size(); }
+
+  // Hot fields, indexed by node id.
+  const std::vector<int32> &costs() const { return costs_; }
+  std::vector<int32> *mutable_costs() { return &costs_; }
+  const std::vector<int32> &wcosts() const { return wcosts_; }
+  const std::vector<uint16> &lids() const { return lids_; }
+  const std::vector<uint16> &rids() const { return rids_; }
+  const std::vector<int32> &prevs() const { return prevs_; }
+  std::vector<int32> *mutable_prevs() { return &prevs_; }
+
+  // Out-of-line node objects; nodes()[id] owns the string fields.
+  const std::vector<Node *> &nodes() const { return nodes_; }
+
+  // Node ids beginning at |pos| form the contiguous id range
+  // [begin_column_offset(pos), begin_column_offset(pos + 1)).
+  size_t begin_column_offset(size_t pos) const {
+    return begin_column_offsets_[pos];
+  }
+
+  // Node ids ending at |pos|, in enext order.
+  const std::vector<int32> &end_column(size_t pos) const {
+    return end_columns_[pos];
+  }
+
+  // Publishes cost and prev back to the Node objects so that the rest of
+  // the conversion pipeline can keep following the linked lists.
+  void WriteBack() const;
+
+ private:
+  std::vector<Node *> nodes_;
+  std::vector<int32> costs_;
+  std::vector<int32> wcosts_;
+  std::vector<uint16> lids_;
+  std::vector<uint16> rids_;
+  std::vector<int32> prevs_;
+  std::vector<size_t> begin_column_offsets_;
+  std::vector<std::vector<int32> > end_columns_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatticeSoaView);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_LATTICE_SOA_H_
@@ -0,0 +1,108 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/lattice_soa.h"
+
+#include "converter/lattice.h"
+#include "converter/node.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+
+TEST(LatticeSoaViewTest, BuildTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  Node *node = lattice.NewNode();
+  node->key = "te";
+  node->value = "te";
+  node->lid = 1;
+  node->rid = 2;
+  node->wcost = 10;
+  lattice.Insert(0, node);
+
+  Node *node2 = lattice.NewNode();
+  node2->key = "st";
+  node2->value = "st";
+  node2->lid = 3;
+  node2->rid = 4;
+  node2->wcost = 20;
+  lattice.Insert(2, node2);
+
+  LatticeSoaView view;
+  view.Build(lattice);
+
+  // BOS + EOS + two word nodes.
+  EXPECT_EQ(4, view.size());
+  ASSERT_EQ(view.size(), view.costs().size());
+  ASSERT_EQ(view.size(), view.wcosts().size());
+  ASSERT_EQ(view.size(), view.lids().size());
+  ASSERT_EQ(view.size(), view.rids().size());
+  ASSERT_EQ(view.size(), view.prevs().size());
+
+  // Node ids beginning at pos 0 form a contiguous range.
+  const size_t begin = view.begin_column_offset(0);
+  const size_t end = view.begin_column_offset(1);
+  ASSERT_EQ(1, end - begin);
+  EXPECT_EQ(node, view.nodes()[begin]);
+  EXPECT_EQ(10, view.wcosts()[begin]);
+  EXPECT_EQ(1, view.lids()[begin]);
+  EXPECT_EQ(2, view.rids()[begin]);
+
+  // The end column at pos 2 holds |node|.
+  ASSERT_EQ(1, view.end_column(2).size());
+  EXPECT_EQ(node, view.nodes()[view.end_column(2)[0]]);
+}
+
+TEST(LatticeSoaViewTest, WriteBackTest) {
+  Lattice lattice;
+  lattice.SetKey("te");
+
+  Node *node = lattice.NewNode();
+  node->key = "te";
+  node->value = "te";
+  lattice.Insert(0, node);
+
+  LatticeSoaView view;
+  view.Build(lattice);
+
+  // Find the word node id and simulate a DP result.
+  const size_t id = view.begin_column_offset(0);
+  ASSERT_EQ(node, view.nodes()[id]);
+  (*view.mutable_costs())[id] = 123;
+  // Connect to BOS, which has id 0 as it is collected first.
+  ASSERT_EQ(lattice.bos_nodes(), view.nodes()[0]);
+  (*view.mutable_prevs())[id] = 0;
+
+  view.WriteBack();
+  EXPECT_EQ(123, node->cost);
+  EXPECT_EQ(lattice.bos_nodes(), node->prev);
+}
+
+}  // namespace mozc
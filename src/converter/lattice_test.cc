@@ -59,6 +59,29 @@ TEST(LatticeTest, LatticeTest) {
   EXPECT_EQ(0, lattice.history_end_pos());
 }
 
+TEST(LatticeTest, CompactTest) {
+  Lattice lattice;
+
+  lattice.SetKey("this is a test");
+  for (int i = 0; i < 100; ++i) {
+    lattice.NewNode();
+  }
+  const size_t retained = lattice.RetainedBytes();
+  EXPECT_GT(retained, 0);
+
+  lattice.Compact();
+  EXPECT_EQ("", lattice.key());
+  EXPECT_FALSE(lattice.has_lattice());
+  // Only the key string's inline buffer may remain.
+  EXPECT_LT(lattice.RetainedBytes(), retained);
+  EXPECT_LE(lattice.RetainedBytes(), string().capacity());
+
+  // The lattice must be usable again after compaction.
+  lattice.SetKey("test");
+  EXPECT_TRUE(lattice.has_lattice());
+  EXPECT_NE(nullptr, lattice.NewNode());
+}
+
 TEST(LatticeTest, NewNodeTest) {
   Lattice lattice;
   Node *node = lattice.NewNode();
@@ -103,6 +126,43 @@ TEST(LatticeTest, InsertTest) {
   }
 }
 
+TEST(LatticeTest, BulkInsertTest) {
+  Lattice lattice;
+
+  lattice.SetKey("test");
+
+  Node *node = lattice.NewNode();
+  node->value = "ho";
+  node->key = "es";
+
+  Node *node2 = lattice.NewNode();
+  node2->value = "h";
+  node2->key = "e";
+
+  Node *nodes[] = { node, node2 };
+  lattice.BulkInsert(1, nodes, arraysize(nodes));
+
+  // The begin side list keeps the array order.
+  EXPECT_EQ(node, lattice.begin_nodes(1));
+  EXPECT_EQ(node2, node->bnext);
+  EXPECT_EQ(nullptr, node2->bnext);
+
+  EXPECT_EQ(node, lattice.end_nodes(3));
+  EXPECT_EQ(node2, lattice.end_nodes(2));
+
+  // A second run is prepended before the existing nodes.
+  Node *node3 = lattice.NewNode();
+  node3->value = "o";
+  node3->key = "e";
+  Node *nodes2[] = { node3 };
+  lattice.BulkInsert(1, nodes2, arraysize(nodes2));
+
+  EXPECT_EQ(node3, lattice.begin_nodes(1));
+  EXPECT_EQ(node, node3->bnext);
+  EXPECT_EQ(node3, lattice.end_nodes(2));
+  EXPECT_EQ(node2, node3->enext);
+}
+
 namespace {
 
 // set cache_info[i] to (key.size() - i)
@@ -124,6 +184,35 @@ void InsertNodes(Lattice *lattice) {
 }
 }  // namespace
 
+TEST(LatticeTest, ReusableViterbiEndPosTest) {
+  Lattice lattice;
+
+  lattice.SetKey("te");
+  EXPECT_EQ(0, lattice.reusable_viterbi_end_pos());
+
+  // Cached nodes keep the whole common prefix reusable.
+  Node *node = lattice.NewNode();
+  node->key = "te";
+  node->attributes |= Node::ENABLE_CACHE;
+  lattice.Insert(0, node);
+
+  lattice.UpdateKey("test");
+  EXPECT_EQ(2, lattice.reusable_viterbi_end_pos());
+
+  // A node without ENABLE_CACHE will be erased by ResetNodeCost(), so
+  // columns from its end position on cannot be reused next time.
+  Node *node2 = lattice.NewNode();
+  node2->key = "t";
+  lattice.Insert(0, node2);
+
+  lattice.UpdateKey("tests");
+  EXPECT_EQ(1, lattice.reusable_viterbi_end_pos());
+
+  // A full rebuild resets the reusable range.
+  lattice.SetKey("unrelated");
+  EXPECT_EQ(0, lattice.reusable_viterbi_end_pos());
+}
+
 TEST(LatticeTest, AddSuffixTest) {
   Lattice lattice;
 
@@ -225,4 +314,42 @@ TEST(LatticeTest, ShrinkKeyTest) {
     }
   }
 }
+
+namespace {
+int g_sampled_dump_count = 0;
+
+void CountSampledDump(const string &dump) {
+  ++g_sampled_dump_count;
+}
+}  // namespace
+
+TEST(LatticeTest, DumpSamplingTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  g_sampled_dump_count = 0;
+  Lattice::SetDumpSamplingCallback(&CountSampledDump);
+
+  // Disabled by default: no dumps.
+  for (int i = 0; i < 10; ++i) {
+    Lattice::MaybeSampleDump(&lattice);
+  }
+  EXPECT_EQ(0, g_sampled_dump_count);
+
+  // With interval 3, every third call is sampled.
+  Lattice::SetDumpSamplingInterval(3);
+  for (int i = 0; i < 10; ++i) {
+    Lattice::MaybeSampleDump(&lattice);
+  }
+  EXPECT_EQ(3, g_sampled_dump_count);
+
+  // Turning sampling off stops the dumps again.
+  Lattice::SetDumpSamplingInterval(0);
+  for (int i = 0; i < 10; ++i) {
+    Lattice::MaybeSampleDump(&lattice);
+  }
+  EXPECT_EQ(3, g_sampled_dump_count);
+
+  Lattice::SetDumpSamplingCallback(NULL);
+}
 }  // namespace mozc
@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "converter/candidate_filter.h"
@@ -52,6 +53,20 @@ namespace {
 const int kFreeListSize = 512;
 const int kCostDiff = 3453;   // log prob of 1/1000
 
+// FNV prime; used to chain per-node fingerprints into a path signature.
+const uint64 kSignatureMultiplier = 0x100000001b3;
+
+// Extends the rolling path signature of |next_signature| with |node|'s
+// key and value.  Two elements with equal signatures (and the same
+// frontier node) can only generate candidates with identical key/value
+// strings from here on.
+uint64 ExtendSignature(uint64 next_signature, const Node *node) {
+  uint64 signature = next_signature;
+  signature = signature * kSignatureMultiplier ^ Hash::Fingerprint(node->key);
+  signature = signature * kSignatureMultiplier ^ Hash::Fingerprint(node->value);
+  return signature;
+}
+
 }  // namespace
 
 using converter::CandidateFilter;
@@ -65,6 +80,9 @@ struct NBestGenerator::QueueElement {
   // Do not take the transition costs to edge nodes.
   int32 structure_gx;
   int32 w_gx;
+  // Rolling fingerprint of the key/value sequence of this element and
+  // everything to its right; see ExtendSignature().
+  uint64 signature;
 };
 
 const NBestGenerator::QueueElement *NBestGenerator::CreateNewElement(
@@ -73,7 +91,8 @@ const NBestGenerator::QueueElement *NBestGenerator::CreateNewElement(
     int32 fx,
     int32 gx,
     int32 structure_gx,
-    int32 w_gx) {
+    int32 w_gx,
+    uint64 signature) {
   QueueElement *elm = freelist_.Alloc();
   DCHECK(elm);
   elm->node = node;
@@ -82,6 +101,7 @@ const NBestGenerator::QueueElement *NBestGenerator::CreateNewElement(
   elm->gx = gx;
   elm->structure_gx = structure_gx;
   elm->w_gx = w_gx;
+  elm->signature = signature;
   return elm;
 }
 
@@ -141,8 +161,11 @@ NBestGenerator::~NBestGenerator() {
 void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
                            const BoundaryCheckMode mode) {
   agenda_.Clear();
-  freelist_.Free();
+  // Reset() recycles the queue-element chunks instead of freeing them;
+  // CreateNewElement() initializes every field anyway.
+  freelist_.Reset();
   filter_->Reset();
+  expanded_signatures_.clear();
   viterbi_result_checked_ = false;
   check_mode_ = mode;
 
@@ -155,8 +178,9 @@ void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
         (node->lid != end_node_->lid &&
          node->cost - end_node_->cost <= kCostDiff &&
          node->prev != end_node_->prev)) {
-      // Push "EOS" nodes.
-      agenda_.Push(CreateNewElement(node, NULL, node->cost, 0, 0, 0));
+      // Push "EOS" nodes.  The initial signature is 0; right-context
+      // nodes are distinguished by the frontier node itself.
+      agenda_.Push(CreateNewElement(node, NULL, node->cost, 0, 0, 0, 0));
     }
   }
 
@@ -188,6 +212,18 @@ void NBestGenerator::MakeCandidate(
   candidate->structure_cost = structure_cost;
   candidate->wcost = wcost;
 
+  // Reserve the output strings first; the per-node appends below would
+  // otherwise reallocate several times for long candidates.
+  {
+    size_t key_len = 0, value_len = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      key_len += nodes[i]->key.size();
+      value_len += nodes[i]->value.size();
+    }
+    candidate->key.reserve(key_len);
+    candidate->value.reserve(value_len);
+  }
+
   bool is_functional = false;
   for (size_t i = 0; i < nodes.size(); ++i) {
     const Node *node = nodes[i];
@@ -225,7 +261,15 @@ void NBestGenerator::MakeCandidate(
     candidate->content_key = candidate->key;
   }
 
+  // Hash the materialized value once; the filtering stages reuse it.
+  candidate->value_fingerprint = Hash::Fingerprint(candidate->value);
+
   candidate->inner_segment_boundary.clear();
+}
+
+void NBestGenerator::FillInnerSegmentBoundary(
+    Segment::Candidate *candidate,
+    const std::vector<const Node *> &nodes) const {
   if (check_mode_ == ONLY_EDGE) {
     // For realtime conversion.  Set inner segment boundary for user history
     // prediction from realtime conversion result.
@@ -352,24 +396,50 @@ bool NBestGenerator::Next(const string &original_key,
       }
       CHECK(!nodes_.empty());
 
+      // A path whose cost already exceeds the filter's bound can only
+      // produce STOP_ENUMERATION; bail out before assembling the
+      // candidate strings.
+      if (filter_->ExceedsCostBound(nodes_, top->gx, top->structure_gx,
+                                    request_type)) {
+        nodes_.clear();
+        return false;
+      }
+
       MakeCandidate(candidate, top->gx, top->structure_gx, top->w_gx, nodes_);
       const int filter_result = filter_->FilterCandidate(original_key,
                                                          candidate,
                                                          nodes_,
                                                          request_type);
-      nodes_.clear();
 
       switch (filter_result) {
         case CandidateFilter::GOOD_CANDIDATE:
+          // The inner segment boundary is needed only for accepted
+          // candidates, so it is materialized after filtering.
+          FillInnerSegmentBoundary(candidate, nodes_);
+          nodes_.clear();
           return true;
         case CandidateFilter::STOP_ENUMERATION:
+          nodes_.clear();
           return false;
         case CandidateFilter::BAD_CANDIDATE:
         default:
+          nodes_.clear();
           break;
           // do nothing
       }
     } else {
+      // Structural dedup: if an equivalent sub-path — the same frontier
+      // node with the same key/value sequence to the right — was
+      // expanded before, this element can only reproduce candidates
+      // whose strings the filter would reject as duplicates (A* pop
+      // order guarantees the earlier expansion was the cheaper one).
+      // Deep enumeration re-explores such overlapping sub-paths
+      // exponentially often without this check.
+      if (!expanded_signatures_.insert(
+              std::make_pair(rnode, top->signature)).second) {
+        continue;
+      }
+
       const QueueElement *best_left_elm = NULL;
       const bool is_right_edge = rnode->begin_pos == end_node_->begin_pos;
       const bool is_left_edge = rnode->begin_pos == begin_node_->end_pos;
@@ -465,6 +535,7 @@ bool NBestGenerator::Next(const string &original_key,
         const int32 fx = lnode->cost + gx;
         const int32 structure_gx = structure_cost_diff + top->structure_gx;
         const int32 w_gx = wcost_diff + top->w_gx;
+        const uint64 signature = ExtendSignature(top->signature, lnode);
         if (is_left_edge) {
           // We only need to only 1 left node here.
           // Even if expand all left nodes, all the |value| part should
@@ -472,11 +543,11 @@ bool NBestGenerator::Next(const string &original_key,
           // This hack reduces the number of redundant calls of pop().
           if (best_left_elm == NULL || best_left_elm->fx > fx) {
             best_left_elm = CreateNewElement(
-                lnode, top, fx, gx, structure_gx, w_gx);
+                lnode, top, fx, gx, structure_gx, w_gx, signature);
           }
         } else {
           agenda_.Push(CreateNewElement(
-              lnode, top, fx, gx, structure_gx, w_gx));
+              lnode, top, fx, gx, structure_gx, w_gx, signature));
         }
       }
 
@@ -590,6 +661,9 @@ int NBestGenerator::InsertTopResult(const string &original_key,
   viterbi_result_checked_ = true;
   const int result = filter_->FilterCandidate(
       original_key, candidate, nodes_, request_type);
+  if (result == CandidateFilter::GOOD_CANDIDATE) {
+    FillInnerSegmentBoundary(candidate, nodes_);
+  }
   nodes_.clear();
   return result;
 }
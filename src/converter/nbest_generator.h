@@ -31,7 +31,9 @@
 #define MOZC_CONVERTER_NBEST_GENERATOR_H_
 
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/freelist.h"
@@ -152,6 +154,13 @@ class NBestGenerator {
                      int32 cost, int32 structure_cost, int32 wcost,
                      const std::vector<const Node *> &nodes) const;
 
+  // Fills candidate->inner_segment_boundary (ONLY_EDGE mode).  Split
+  // from MakeCandidate() so that it runs only for candidates accepted
+  // by the filter; rejected paths never pay for it.
+  void FillInnerSegmentBoundary(
+      Segment::Candidate *candidate,
+      const std::vector<const Node *> &nodes) const;
+
   // Helper functions for Next(). Checks node boundary conditions.
   BoundaryCheckResult CheckStrict(
       const Node *lnode, const Node *rnode, bool is_edge) const;
@@ -162,13 +171,16 @@ class NBestGenerator {
 
   int GetTransitionCost(const Node *lnode, const Node *rnode) const;
 
-  // Create queue element from freelist
+  // Create queue element from freelist.  |signature| is the rolling
+  // fingerprint of the key/value sequence from |node| to the right end;
+  // see the dedup comment in Next().
   const QueueElement *CreateNewElement(const Node *node,
                                        const QueueElement *next,
                                        int32 fx,
                                        int32 gx,
                                        int32 structure_gx,
-                                       int32 w_gx);
+                                       int32 w_gx,
+                                       uint64 signature);
 
   // References to relevant modules.
   const dictionary::SuppressionDictionary *suppression_dictionary_;
@@ -183,6 +195,9 @@ class NBestGenerator {
   Agenda agenda_;
   FreeList<QueueElement> freelist_;
   std::vector<const Node *> nodes_;
+  // Sub-paths already expanded, keyed by the frontier node and the path
+  // signature; equivalent later paths are not re-expanded.
+  std::set<std::pair<const Node *, uint64> > expanded_signatures_;
   std::unique_ptr<converter::CandidateFilter> filter_;
   bool viterbi_result_checked_;
   BoundaryCheckMode check_mode_;
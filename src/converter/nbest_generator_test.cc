@@ -30,7 +30,9 @@
 #include "converter/nbest_generator.h"
 
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 
 #include "base/logging.h"
 #include "base/port.h"
@@ -384,4 +386,53 @@ TEST_F(NBestGeneratorTest, InnerSegmentBoundary) {
   EXPECT_EQ("行きたい", content_values[2]);
 }
 
+TEST_F(NBestGeneratorTest, NoDuplicateCandidatesInDeepEnumeration) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  const string kInput = "わたしのなまえはなかのです";
+  {
+    Segment *segment = segments.add_segment();
+    segment->set_segment_type(Segment::FREE);
+    segment->set_key(kInput);
+  }
+
+  Lattice lattice;
+  lattice.SetKey(kInput);
+  const ConversionRequest request;
+  converter->MakeLattice(request, &segments, &lattice);
+
+  std::vector<uint16> group;
+  converter->MakeGroup(segments, &group);
+  converter->Viterbi(segments, &lattice);
+
+  std::unique_ptr<NBestGenerator> nbest_generator(
+      data_and_converter->CreateNBestGenerator(&lattice));
+
+  const bool kSingleSegment = true;  // For realtime conversion
+  const Node *begin_node = lattice.bos_nodes();
+  const Node *end_node =
+      GetEndNode(*converter, segments, *begin_node, group, kSingleSegment);
+
+  // Deep enumeration: equivalent sub-paths are suppressed during
+  // expansion, so the enumerated key/value pairs must all be distinct.
+  nbest_generator->Reset(begin_node, end_node, NBestGenerator::ONLY_EDGE);
+  Segment result_segment;
+  GatherCandidates(
+      100, Segments::CONVERSION, nbest_generator.get(), &result_segment);
+  ASSERT_LT(1, result_segment.candidates_size());
+
+  std::set<std::pair<string, string> > seen;
+  for (size_t i = 0; i < result_segment.candidates_size(); ++i) {
+    const Segment::Candidate &candidate = result_segment.candidate(i);
+    EXPECT_TRUE(
+        seen.insert(std::make_pair(candidate.key, candidate.value)).second)
+        << "Duplicate candidate: " << candidate.key << ", "
+        << candidate.value;
+  }
+}
+
 }  // namespace mozc
@@ -204,6 +204,24 @@ struct Node {
   }
 
   inline void InitFromToken(const dictionary::Token &token) {
+    InitFieldsFromToken(token);
+    key = token.key;
+    actual_key.clear();
+    value = token.value;
+  }
+
+  // Same as InitFromToken() but takes over the token's string buffers by
+  // swapping instead of copying.  The token remains in a valid state but
+  // its key/value contents are unspecified afterwards; see
+  // DictionaryInterface::Callback::OnConsumableToken().
+  inline void InitFromConsumableToken(dictionary::Token *token) {
+    InitFieldsFromToken(*token);
+    key.swap(token->key);
+    actual_key.clear();
+    value.swap(token->value);
+  }
+
+  inline void InitFieldsFromToken(const dictionary::Token &token) {
     prev = nullptr;
     next = nullptr;
     bnext = nullptr;
@@ -225,9 +243,6 @@ struct Node {
       attributes |= USER_DICTIONARY;
       attributes |= NO_VARIANTS_EXPANSION;
     }
-    key = token.key;
-    actual_key.clear();
-    value = token.value;
   }
 };
 
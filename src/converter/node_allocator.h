@@ -30,6 +30,8 @@
 #ifndef MOZC_CONVERTER_NODE_ALLOCATOR_H_
 #define MOZC_CONVERTER_NODE_ALLOCATOR_H_
 
+#include <algorithm>
+
 #include "base/freelist.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -40,7 +42,7 @@ namespace mozc {
 class NodeAllocator {
  public:
   NodeAllocator() : node_freelist_(1024), max_nodes_size_(8192),
-                    node_count_(0) {}
+                    node_count_(0), chunk_high_water_(0) {}
   ~NodeAllocator() {}
 
   Node *NewNode() {
@@ -51,9 +53,18 @@ class NodeAllocator {
     return node;
   }
 
-  // Frees all nodes allocateed by NewNode().
+  // Frees all nodes allocated by NewNode().  The chunks themselves are
+  // retained up to a high-water mark of chunks recently used per
+  // conversion that decays by 1/8 per call, so sustained typing does not
+  // hit the heap for every request, while a burst of long conversions
+  // does not pin its peak memory forever.
   void Free() {
-    node_freelist_.Free();
+    const size_t kChunkHighWaterDecayFactor = 8;
+    chunk_high_water_ = std::max(
+        node_freelist_.used_chunk_count(),
+        chunk_high_water_ - chunk_high_water_ / kChunkHighWaterDecayFactor);
+    node_freelist_.Reset();
+    node_freelist_.ReleaseFreeChunks(std::max<size_t>(chunk_high_water_, 1));
     node_count_ = 0;
   }
 
@@ -69,10 +80,28 @@ class NodeAllocator {
     return node_count_;
   }
 
+  // Like Free(), but returns every retained chunk to the heap and
+  // resets the high-water mark.  For allocators whose owner has been
+  // idle long enough that the next conversion may pay the warm-up
+  // again.
+  void FreeAll() {
+    node_freelist_.Reset();
+    node_freelist_.ReleaseFreeChunks(0);
+    chunk_high_water_ = 0;
+    node_count_ = 0;
+  }
+
+  // See FreeList<T>::RetainedBytes().
+  size_t RetainedBytes() const {
+    return node_freelist_.RetainedBytes();
+  }
+
  private:
   FreeList<Node> node_freelist_;
   size_t max_nodes_size_;
   size_t node_count_;
+  // Decayed high-water mark of chunks used per conversion; see Free().
+  size_t chunk_high_water_;
 
   DISALLOW_COPY_AND_ASSIGN(NodeAllocator);
 };
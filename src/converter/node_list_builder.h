@@ -68,6 +68,17 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
     return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
   }
 
+  // Same as OnToken() but takes over the token's string buffers instead of
+  // copying them.  Subclasses that override OnToken() should override this
+  // method as well, or the customized behavior is skipped for dictionaries
+  // that deliver consumable tokens.
+  virtual ResultType OnConsumableToken(StringPiece key, StringPiece actual_key,
+                                       dictionary::Token *token) {
+    Node *new_node = NewNodeFromConsumableToken(token);
+    PrependNode(new_node);
+    return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
+  }
+
   int limit() const { return limit_; }
   int penalty() const { return penalty_; }
   Node *result() const { return result_; }
@@ -80,6 +91,13 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
     return new_node;
   }
 
+  Node *NewNodeFromConsumableToken(dictionary::Token *token) {
+    Node *new_node = allocator_->NewNode();
+    new_node->InitFromConsumableToken(token);
+    new_node->wcost += penalty_;
+    return new_node;
+  }
+
   void PrependNode(Node *node) {
     node->bnext = result_;
     result_ = node;
@@ -29,6 +29,8 @@
 
 #include "converter/segmenter.h"
 
+#include <algorithm>
+
 #include "base/bitarray.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -36,6 +38,21 @@
 #include "data_manager/data_manager_interface.h"
 
 namespace mozc {
+namespace {
+
+// The cache size must be a power of 2.
+const size_t kBoundaryCacheSize = 4096;
+const uint32 kInvalidCacheKey = 0xFFFFFFFF;
+
+inline uint32 GetHashValue(uint16 rid, uint16 lid) {
+  return (3 * static_cast<uint32>(rid) + lid) % kBoundaryCacheSize;
+}
+
+inline uint32 EncodeKey(uint16 rid, uint16 lid) {
+  return (static_cast<uint32>(rid) << 16) | lid;
+}
+
+}  // namespace
 
 Segmenter *Segmenter::CreateFromDataManager(
     const DataManagerInterface &data_manager) {
@@ -69,6 +86,10 @@ Segmenter::Segmenter(
   DCHECK(bitarray_data_);
   DCHECK(boundary_data_);
   CHECK_LE(l_num_elements_ * r_num_elements_, bitarray_num_bytes_ * 8);
+
+  cache_.reset(new uint64[kBoundaryCacheSize]);
+  std::fill(cache_.get(), cache_.get() + kBoundaryCacheSize,
+            static_cast<uint64>(kInvalidCacheKey) << 32);
 }
 
 Segmenter::~Segmenter() {}
@@ -102,9 +123,18 @@ bool Segmenter::IsBoundary(const Node &lnode, const Node &rnode,
 }
 
 bool Segmenter::IsBoundary(uint16 rid, uint16 lid) const {
+  const uint32 key = EncodeKey(rid, lid);
+  const uint32 bucket = GetHashValue(rid, lid);
+  const uint64 entry = cache_[bucket];
+  if ((entry >> 32) == key) {
+    return (entry & 1) != 0;
+  }
   const uint32 bitarray_index = l_table_[rid] + l_num_elements_ * r_table_[lid];
-  return BitArray::GetValue(reinterpret_cast<const char*>(bitarray_data_),
-                            bitarray_index);
+  const bool result =
+      BitArray::GetValue(reinterpret_cast<const char*>(bitarray_data_),
+                         bitarray_index);
+  cache_[bucket] = (static_cast<uint64>(key) << 32) | (result ? 1 : 0);
+  return result;
 }
 
 int32 Segmenter::GetPrefixPenalty(uint16 lid) const {
@@ -30,6 +30,8 @@
 #ifndef MOZC_CONVERTER_SEGMENTER_H_
 #define MOZC_CONVERTER_SEGMENTER_H_
 
+#include <memory>
+
 #include "base/port.h"
 
 namespace mozc {
@@ -64,6 +66,12 @@ class Segmenter {
   const char *bitarray_data_;
   const uint16 *boundary_data_;
 
+  // Direct-mapped cache of recent (rid, lid) decisions packed into
+  // single 64-bit entries, so the hot boundary checks in Viterbi and
+  // MakeSegments are one load and mask instead of the l-table/r-table/
+  // bitarray composition.  See IsBoundary(uint16, uint16).
+  mutable std::unique_ptr<uint64[]> cache_;
+
   DISALLOW_COPY_AND_ASSIGN(Segmenter);
 };
 
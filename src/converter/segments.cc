@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <sstream>  // For DebugString()
 #include <string>
+#include <utility>
 
 #include "base/logging.h"
 #include "base/util.h"
@@ -76,6 +77,7 @@ void Segment::Candidate::CopyFrom(const Candidate &src) {
 
   lid = src.lid;
   rid = src.rid;
+  value_fingerprint = src.value_fingerprint;
 
   attributes = src.attributes;
 
@@ -85,6 +87,38 @@ void Segment::Candidate::CopyFrom(const Candidate &src) {
   inner_segment_boundary = src.inner_segment_boundary;
 }
 
+void Segment::Candidate::MoveFrom(Candidate *src) {
+  Init();
+
+  key = std::move(src->key);
+  value = std::move(src->value);
+  content_key = std::move(src->content_key);
+  content_value = std::move(src->content_value);
+  consumed_key_size = src->consumed_key_size;
+
+  prefix = std::move(src->prefix);
+  suffix = std::move(src->suffix);
+  usage_id = src->usage_id;
+  description = std::move(src->description);
+  usage_title = std::move(src->usage_title);
+  usage_description = std::move(src->usage_description);
+
+  cost = src->cost;
+  wcost = src->wcost;
+  structure_cost = src->structure_cost;
+
+  lid = src->lid;
+  rid = src->rid;
+  value_fingerprint = src->value_fingerprint;
+
+  attributes = src->attributes;
+
+  style = src->style;
+  command = src->command;
+
+  inner_segment_boundary = std::move(src->inner_segment_boundary);
+}
+
 bool Segment::Candidate::IsValid() const {
   if (inner_segment_boundary.empty()) {
     return true;
@@ -270,7 +304,10 @@ size_t Segment::candidates_size() const {
 }
 
 void Segment::clear_candidates() {
-  pool_->Free();
+  // Candidates are recycled (push_back_candidate() etc. call Init() on
+  // every allocation), keeping their string capacities for the next
+  // conversion instead of freeing them.
+  pool_->Reset();
   candidates_.clear();
 }
 
@@ -281,6 +318,12 @@ Segment::Candidate *Segment::push_back_candidate() {
   return candidate;
 }
 
+Segment::Candidate *Segment::push_back_candidate(Candidate &&src) {
+  Candidate *candidate = push_back_candidate();
+  candidate->MoveFrom(&src);
+  return candidate;
+}
+
 Segment::Candidate *Segment::push_front_candidate() {
   Candidate *candidate = pool_->Alloc();
   candidate->Init();
@@ -443,6 +486,20 @@ void Segment::CopyFrom(const Segment &src) {
   }
 }
 
+void Segment::MoveCandidatesFrom(Segment *src) {
+  for (size_t i = 0; i < src->candidates_size(); ++i) {
+    push_back_candidate()->MoveFrom(src->mutable_candidate(i));
+  }
+  src->clear_candidates();
+}
+
+size_t Segment::RetainedBytes() const {
+  return pool_->RetainedBytes() +
+         candidates_.size() * sizeof(Candidate *) +
+         meta_candidates_.capacity() * sizeof(Candidate) +
+         key_.capacity();
+}
+
 string Segment::DebugString() const {
   std::stringstream os;
   os << "[segtype=" << segment_type() << " key=" << key() << std::endl;
@@ -473,10 +530,14 @@ Segments::Segments()
     max_prediction_candidates_size_(0),
     max_conversion_candidates_size_(kMaxConversionCandidatesSize),
     resized_(false),
+    quality_degraded_(false),
     user_history_enabled_(true),
     request_type_(Segments::CONVERSION),
     pool_(new ObjectPool<Segment>(32)),
-    cached_lattice_(new Lattice()) {}
+    pool_chunk_high_water_(0),
+    cached_lattice_(new Lattice()),
+    cached_key_corrector_(new KeyCorrector()),
+    cached_history_fingerprint_(0) {}
 
 Segments::~Segments() {}
 
@@ -612,6 +673,7 @@ void Segments::CopyFrom(const Segments &src) {
   max_prediction_candidates_size_ = src.max_prediction_candidates_size();
   max_conversion_candidates_size_ = src.max_conversion_candidates_size();
   resized_ = src.resized();
+  quality_degraded_ = src.quality_degraded();
   user_history_enabled_ = src.user_history_enabled();
 
   request_type_ = src.request_type();
@@ -628,7 +690,18 @@ void Segments::CopyFrom(const Segments &src) {
 }
 
 void Segments::clear_segments() {
-  pool_->Free();
+  // Recycle the Segment objects (add_segment() calls Clear() on every
+  // allocation) so that their candidate pools survive across requests.
+  // Chunks beyond a high-water mark that decays by 1/8 per request are
+  // given back to the heap, so a single heavily resized conversion does
+  // not pin its peak segment count for the rest of the session.
+  const size_t kChunkHighWaterDecayFactor = 8;
+  pool_chunk_high_water_ = std::max(
+      pool_->used_chunk_count(),
+      pool_chunk_high_water_ -
+          pool_chunk_high_water_ / kChunkHighWaterDecayFactor);
+  pool_->Reset();
+  pool_->ReleaseFreeChunks(std::max<size_t>(pool_chunk_high_water_, 1));
   resized_ = false;
   segments_.clear();
 }
@@ -671,6 +744,14 @@ bool Segments::resized() const {
   return resized_;
 }
 
+void Segments::set_quality_degraded(bool quality_degraded) {
+  quality_degraded_ = quality_degraded;
+}
+
+bool Segments::quality_degraded() const {
+  return quality_degraded_;
+}
+
 size_t Segments::max_prediction_candidates_size() const {
   return max_prediction_candidates_size_;
 }
@@ -687,6 +768,24 @@ void Segments::set_max_conversion_candidates_size(size_t size) {
   max_conversion_candidates_size_ = size;
 }
 
+size_t Segments::RetainedBytes() const {
+  size_t bytes = pool_->RetainedBytes() + cached_lattice_->RetainedBytes() +
+                 revert_entries_.capacity() * sizeof(RevertEntry);
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    bytes += segments_[i]->RetainedBytes();
+  }
+  return bytes;
+}
+
+void Segments::Compact() {
+  cached_lattice_->Compact();
+  // Keep only the chunks the live segments occupy, and reset the
+  // decayed high-water mark so the warm capacity is not re-reserved on
+  // the next request.
+  pool_->ReleaseFreeChunks(1);
+  pool_chunk_high_water_ = 0;
+}
+
 void Segments::clear_revert_entries() {
   revert_entries_.clear();
 }
@@ -717,6 +816,14 @@ Lattice *Segments::mutable_cached_lattice() {
   return cached_lattice_.get();
 }
 
+KeyCorrector *Segments::mutable_cached_key_corrector() {
+  return cached_key_corrector_.get();
+}
+
+uint64 *Segments::mutable_cached_history_fingerprint() {
+  return &cached_history_fingerprint_;
+}
+
 string Segments::DebugString() const {
   std::stringstream os;
   os << "{" << std::endl;
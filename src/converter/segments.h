@@ -39,6 +39,7 @@
 #include "base/number_util.h"
 #include "base/port.h"
 #include "base/string_piece.h"
+#include "converter/key_corrector.h"
 #include "converter/lattice.h"
 
 namespace mozc {
@@ -170,6 +171,14 @@ class Segment {
     // rid of right-most node
     uint16 rid;
 
+    // Fingerprint of |value| (Hash::Fingerprint), or 0 when it has not
+    // been computed.  Set by NBestGenerator when the candidate is
+    // materialized so that the filtering stages (dedup, suggestion
+    // filter) do not re-hash the value.  Code that mutates |value|
+    // afterwards must reset this to 0 rather than leave a stale
+    // fingerprint behind.
+    uint64 value_fingerprint;
+
     // Attributes of this candidate. Can set multiple attributes
     // defined in enum |Attribute|.
     uint32 attributes;
@@ -256,6 +265,7 @@ class Segment {
       wcost = 0;
       lid = 0;
       rid = 0;
+      value_fingerprint = 0;
       usage_id = 0;
       attributes = 0;
       source_info = SOURCE_INFO_NONE;
@@ -265,7 +275,7 @@ class Segment {
     }
 
     Candidate() : cost(0), wcost(0), structure_cost(0),
-                  lid(0), rid(0), attributes(0),
+                  lid(0), rid(0), value_fingerprint(0), attributes(0),
                   source_info(SOURCE_INFO_NONE),
                   style(NumberUtil::NumberString::DEFAULT_STYLE),
                   command(DEFAULT_COMMAND) {}
@@ -281,6 +291,12 @@ class Segment {
     StringPiece functional_value() const;
 
     void CopyFrom(const Candidate &src);
+
+    // Same as CopyFrom() except that the string fields (key, value,
+    // description, ...) are moved out of |src| instead of duplicated.
+    // |src| is left in a valid but unspecified state.
+    void MoveFrom(Candidate *src);
+
     bool IsValid() const;
     string DebugString() const;
   };
@@ -308,6 +324,9 @@ class Segment {
   // push and insert candidates
   Candidate *push_front_candidate();
   Candidate *push_back_candidate();
+  // Appends a candidate taking over the string payload of |src| without
+  // duplicating it.  See Candidate::MoveFrom().
+  Candidate *push_back_candidate(Candidate &&src);
   Candidate *add_candidate();   // alias of push_back_candidate()
   Candidate *insert_candidate(int i);
 
@@ -340,9 +359,18 @@ class Segment {
   void Clear();
   void CopyFrom(const Segment &src);
 
+  // Appends all candidates of |src| to this segment, moving their
+  // string payloads instead of copying them.  |src|'s candidates are
+  // cleared.  Meta candidates and the key are not transferred.
+  void MoveCandidatesFrom(Segment *src);
+
   // Keep clear() method as other modules are still using the old method
   void clear() { Clear(); }
 
+  // Approximate heap bytes retained by the candidate pool and buffers.
+  // Heap owned by candidate strings is not included.
+  size_t RetainedBytes() const;
+
   string DebugString() const;
 
  private:
@@ -468,6 +496,12 @@ class Segments {
   bool resized() const;
   void set_resized(bool resized);
 
+  // True when the converter gave up some refinement (e.g. n-best
+  // expansion) because the latency budget of the request was exhausted.
+  // See ConversionRequest::conversion_deadline_msec().
+  bool quality_degraded() const;
+  void set_quality_degraded(bool quality_degraded);
+
   // clear segments
   void Clear();
 
@@ -477,6 +511,16 @@ class Segments {
   // Dump Segments structure
   string DebugString() const;
 
+  // Approximate heap bytes retained by the segment pool, the segments
+  // themselves and the cached lattice.
+  size_t RetainedBytes() const;
+
+  // Returns pooled capacity kept warm for future conversions to the
+  // heap: the cached lattice and the cold tail of the segment pool.
+  // Live segments (including history) are untouched.  For sessions
+  // that have been idle past a threshold.
+  void Compact();
+
   // Revert entries
   void clear_revert_entries();
   size_t revert_entries_size() const;
@@ -487,6 +531,17 @@ class Segments {
   // setter
   Lattice *mutable_cached_lattice();
 
+  // Cached KeyCorrector.  Like the cached lattice above, it lives as
+  // long as this Segments so that incremental keystrokes can extend the
+  // previous correction state instead of rescanning the whole key.
+  KeyCorrector *mutable_cached_key_corrector();
+
+  // Fingerprint of the history composition whose node chain is spliced
+  // into the cached lattice.  Maintained by the immutable converter
+  // (see MakeLatticeNodesForHistorySegments()); 0 means no cached
+  // chain.
+  uint64 *mutable_cached_history_fingerprint();
+
   Segments();
   virtual ~Segments();
 
@@ -495,13 +550,19 @@ class Segments {
   size_t max_prediction_candidates_size_;
   size_t max_conversion_candidates_size_;
   bool resized_;
+  bool quality_degraded_;
   bool user_history_enabled_;
 
   RequestType request_type_;
   std::unique_ptr<ObjectPool<Segment>> pool_;
+  // Decayed high-water mark of segment pool chunks used per request;
+  // see clear_segments().
+  size_t pool_chunk_high_water_;
   std::deque<Segment *> segments_;
   std::vector<RevertEntry> revert_entries_;
   std::unique_ptr<Lattice> cached_lattice_;
+  std::unique_ptr<KeyCorrector> cached_key_corrector_;
+  uint64 cached_history_fingerprint_;
 
   DISALLOW_COPY_AND_ASSIGN(Segments);
 };
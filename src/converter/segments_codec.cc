@@ -0,0 +1,384 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/segments_codec.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/port.h"
+#include "converter/segments.h"
+
+namespace mozc {
+namespace {
+
+const char kMagic[] = "MZSG";
+const size_t kMagicSize = arraysize(kMagic) - 1;
+const uint32 kVersion = 1;
+
+void EncodeVarint(uint64 value, string *output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+// Maps int32 to uint32 so small negative values (costs can go below
+// zero after rewriting) stay short varints.
+uint32 ZigZagEncode(int32 value) {
+  return (static_cast<uint32>(value) << 1) ^ static_cast<uint32>(value >> 31);
+}
+
+int32 ZigZagDecode(uint32 value) {
+  return static_cast<int32>(value >> 1) ^ -static_cast<int32>(value & 1);
+}
+
+// Interns strings during serialization.  The pool section is emitted
+// before the body, so the body is staged in a separate buffer.
+class StringPoolBuilder {
+ public:
+  StringPoolBuilder() = default;
+
+  uint32 Intern(const string &s) {
+    const auto result = index_.insert(std::make_pair(s, strings_.size()));
+    if (result.second) {
+      strings_.push_back(&result.first->first);
+    }
+    return result.first->second;
+  }
+
+  void AppendTo(string *output) const {
+    EncodeVarint(strings_.size(), output);
+    for (const string *s : strings_) {
+      EncodeVarint(s->size(), output);
+      output->append(*s);
+    }
+  }
+
+ private:
+  std::map<string, uint32> index_;  // Pointers to keys stay valid.
+  std::vector<const string *> strings_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringPoolBuilder);
+};
+
+// Bounds-checked reader over the serialized image.
+class Decoder {
+ public:
+  explicit Decoder(StringPiece input)
+      : pos_(input.data()), end_(input.data() + input.size()) {}
+
+  bool ReadVarint(uint64 *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos_ == end_) {
+        return false;
+      }
+      const uint8 byte = static_cast<uint8>(*pos_++);
+      *value |= static_cast<uint64>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;  // More than 10 continuation bytes: corrupt.
+  }
+
+  bool ReadBytes(size_t size, StringPiece *out) {
+    if (static_cast<size_t>(end_ - pos_) < size) {
+      return false;
+    }
+    *out = StringPiece(pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+ private:
+  const char *pos_;
+  const char *end_;
+
+  DISALLOW_COPY_AND_ASSIGN(Decoder);
+};
+
+void SerializeCandidate(const Segment::Candidate &candidate,
+                        StringPoolBuilder *pool, string *body) {
+  EncodeVarint(pool->Intern(candidate.key), body);
+  EncodeVarint(pool->Intern(candidate.value), body);
+  EncodeVarint(pool->Intern(candidate.content_key), body);
+  EncodeVarint(pool->Intern(candidate.content_value), body);
+  EncodeVarint(pool->Intern(candidate.prefix), body);
+  EncodeVarint(pool->Intern(candidate.suffix), body);
+  EncodeVarint(pool->Intern(candidate.description), body);
+  EncodeVarint(pool->Intern(candidate.usage_title), body);
+  EncodeVarint(pool->Intern(candidate.usage_description), body);
+  EncodeVarint(candidate.consumed_key_size, body);
+  EncodeVarint(ZigZagEncode(candidate.usage_id), body);
+  EncodeVarint(ZigZagEncode(candidate.cost), body);
+  EncodeVarint(ZigZagEncode(candidate.wcost), body);
+  EncodeVarint(ZigZagEncode(candidate.structure_cost), body);
+  EncodeVarint(candidate.lid, body);
+  EncodeVarint(candidate.rid, body);
+  EncodeVarint(candidate.attributes, body);
+  EncodeVarint(candidate.source_info, body);
+  EncodeVarint(candidate.style, body);
+  EncodeVarint(candidate.command, body);
+  EncodeVarint(candidate.inner_segment_boundary.size(), body);
+  for (const uint32 encoded : candidate.inner_segment_boundary) {
+    EncodeVarint(encoded, body);
+  }
+}
+
+bool DeserializeCandidate(Decoder *decoder,
+                          const std::vector<StringPiece> &pool,
+                          Segment::Candidate *candidate) {
+  uint64 v[10];
+  string *const string_fields[] = {
+      &candidate->key, &candidate->value,
+      &candidate->content_key, &candidate->content_value,
+      &candidate->prefix, &candidate->suffix,
+      &candidate->description,
+      &candidate->usage_title, &candidate->usage_description,
+  };
+  for (size_t i = 0; i < arraysize(string_fields); ++i) {
+    if (!decoder->ReadVarint(&v[0]) || v[0] >= pool.size()) {
+      return false;
+    }
+    pool[v[0]].CopyToString(string_fields[i]);
+  }
+  if (!decoder->ReadVarint(&v[0]) ||  // consumed_key_size
+      !decoder->ReadVarint(&v[1]) ||  // usage_id
+      !decoder->ReadVarint(&v[2]) ||  // cost
+      !decoder->ReadVarint(&v[3]) ||  // wcost
+      !decoder->ReadVarint(&v[4]) ||  // structure_cost
+      !decoder->ReadVarint(&v[5]) ||  // lid
+      !decoder->ReadVarint(&v[6]) ||  // rid
+      !decoder->ReadVarint(&v[7]) ||  // attributes
+      !decoder->ReadVarint(&v[8]) ||  // source_info
+      !decoder->ReadVarint(&v[9])) {  // style
+    return false;
+  }
+  candidate->consumed_key_size = v[0];
+  candidate->usage_id = ZigZagDecode(static_cast<uint32>(v[1]));
+  candidate->cost = ZigZagDecode(static_cast<uint32>(v[2]));
+  candidate->wcost = ZigZagDecode(static_cast<uint32>(v[3]));
+  candidate->structure_cost = ZigZagDecode(static_cast<uint32>(v[4]));
+  candidate->lid = static_cast<uint16>(v[5]);
+  candidate->rid = static_cast<uint16>(v[6]);
+  candidate->attributes = static_cast<uint32>(v[7]);
+  candidate->source_info = static_cast<uint32>(v[8]);
+  candidate->style = static_cast<NumberUtil::NumberString::Style>(v[9]);
+  uint64 command, boundary_size;
+  if (!decoder->ReadVarint(&command) ||
+      !decoder->ReadVarint(&boundary_size)) {
+    return false;
+  }
+  candidate->command = static_cast<Segment::Candidate::Command>(command);
+  candidate->inner_segment_boundary.clear();
+  candidate->inner_segment_boundary.reserve(boundary_size);
+  for (uint64 i = 0; i < boundary_size; ++i) {
+    uint64 encoded;
+    if (!decoder->ReadVarint(&encoded)) {
+      return false;
+    }
+    candidate->inner_segment_boundary.push_back(
+        static_cast<uint32>(encoded));
+  }
+  return true;
+}
+
+void SerializeSegment(const Segment &segment, StringPoolBuilder *pool,
+                      string *body) {
+  EncodeVarint(segment.segment_type(), body);
+  EncodeVarint(pool->Intern(segment.key()), body);
+  EncodeVarint(segment.candidates_size(), body);
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    SerializeCandidate(segment.candidate(i), pool, body);
+  }
+  EncodeVarint(segment.meta_candidates_size(), body);
+  for (size_t i = 0; i < segment.meta_candidates_size(); ++i) {
+    SerializeCandidate(segment.meta_candidate(i), pool, body);
+  }
+}
+
+bool DeserializeSegment(Decoder *decoder,
+                        const std::vector<StringPiece> &pool,
+                        Segment *segment) {
+  uint64 type, key_ref, num_candidates, num_meta;
+  if (!decoder->ReadVarint(&type) || !decoder->ReadVarint(&key_ref) ||
+      key_ref >= pool.size()) {
+    return false;
+  }
+  segment->set_segment_type(static_cast<Segment::SegmentType>(type));
+  string key;
+  pool[key_ref].CopyToString(&key);
+  segment->set_key(key);
+  if (!decoder->ReadVarint(&num_candidates)) {
+    return false;
+  }
+  for (uint64 i = 0; i < num_candidates; ++i) {
+    if (!DeserializeCandidate(decoder, pool, segment->add_candidate())) {
+      return false;
+    }
+  }
+  if (!decoder->ReadVarint(&num_meta)) {
+    return false;
+  }
+  for (uint64 i = 0; i < num_meta; ++i) {
+    if (!DeserializeCandidate(decoder, pool, segment->add_meta_candidate())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+enum SegmentsFlag {
+  FLAG_RESIZED = 1 << 0,
+  FLAG_QUALITY_DEGRADED = 1 << 1,
+  FLAG_USER_HISTORY_ENABLED = 1 << 2,
+};
+
+}  // namespace
+
+void SegmentsCodec::Serialize(const Segments &segments, string *output) {
+  DCHECK(output);
+  StringPoolBuilder pool;
+  string body;
+  EncodeVarint(segments.request_type(), &body);
+  uint32 flags = 0;
+  if (segments.resized()) {
+    flags |= FLAG_RESIZED;
+  }
+  if (segments.quality_degraded()) {
+    flags |= FLAG_QUALITY_DEGRADED;
+  }
+  if (segments.user_history_enabled()) {
+    flags |= FLAG_USER_HISTORY_ENABLED;
+  }
+  EncodeVarint(flags, &body);
+  EncodeVarint(segments.max_history_segments_size(), &body);
+  EncodeVarint(segments.max_prediction_candidates_size(), &body);
+  EncodeVarint(segments.max_conversion_candidates_size(), &body);
+  EncodeVarint(segments.segments_size(), &body);
+  for (size_t i = 0; i < segments.segments_size(); ++i) {
+    SerializeSegment(segments.segment(i), &pool, &body);
+  }
+  EncodeVarint(segments.revert_entries_size(), &body);
+  for (size_t i = 0; i < segments.revert_entries_size(); ++i) {
+    const Segments::RevertEntry &entry = segments.revert_entry(i);
+    EncodeVarint(entry.revert_entry_type, &body);
+    EncodeVarint(entry.id, &body);
+    EncodeVarint(entry.timestamp, &body);
+    EncodeVarint(pool.Intern(entry.key), &body);
+  }
+
+  output->append(kMagic, kMagicSize);
+  EncodeVarint(kVersion, output);
+  pool.AppendTo(output);
+  output->append(body);
+}
+
+bool SegmentsCodec::Deserialize(StringPiece input, Segments *segments) {
+  DCHECK(segments);
+  segments->Clear();
+  Decoder decoder(input);
+  StringPiece magic;
+  uint64 version;
+  if (!decoder.ReadBytes(kMagicSize, &magic) ||
+      magic != StringPiece(kMagic, kMagicSize) ||
+      !decoder.ReadVarint(&version) || version != kVersion) {
+    return false;
+  }
+
+  // The pool is read as views into |input|; strings are copied into
+  // candidates when the body references them.
+  uint64 pool_size;
+  if (!decoder.ReadVarint(&pool_size)) {
+    return false;
+  }
+  std::vector<StringPiece> pool;
+  pool.reserve(pool_size);
+  for (uint64 i = 0; i < pool_size; ++i) {
+    uint64 length;
+    StringPiece s;
+    if (!decoder.ReadVarint(&length) || !decoder.ReadBytes(length, &s)) {
+      segments->Clear();
+      return false;
+    }
+    pool.push_back(s);
+  }
+
+  uint64 request_type, flags, max_history, max_prediction, max_conversion;
+  uint64 num_segments;
+  if (!decoder.ReadVarint(&request_type) || !decoder.ReadVarint(&flags) ||
+      !decoder.ReadVarint(&max_history) ||
+      !decoder.ReadVarint(&max_prediction) ||
+      !decoder.ReadVarint(&max_conversion) ||
+      !decoder.ReadVarint(&num_segments)) {
+    segments->Clear();
+    return false;
+  }
+  segments->set_request_type(static_cast<Segments::RequestType>(request_type));
+  segments->set_resized((flags & FLAG_RESIZED) != 0);
+  segments->set_quality_degraded((flags & FLAG_QUALITY_DEGRADED) != 0);
+  segments->set_user_history_enabled((flags & FLAG_USER_HISTORY_ENABLED) != 0);
+  segments->set_max_history_segments_size(max_history);
+  segments->set_max_prediction_candidates_size(max_prediction);
+  segments->set_max_conversion_candidates_size(max_conversion);
+  for (uint64 i = 0; i < num_segments; ++i) {
+    if (!DeserializeSegment(&decoder, pool, segments->add_segment())) {
+      segments->Clear();
+      return false;
+    }
+  }
+
+  uint64 num_revert_entries;
+  if (!decoder.ReadVarint(&num_revert_entries)) {
+    segments->Clear();
+    return false;
+  }
+  for (uint64 i = 0; i < num_revert_entries; ++i) {
+    uint64 type, id, timestamp, key_ref;
+    if (!decoder.ReadVarint(&type) || !decoder.ReadVarint(&id) ||
+        !decoder.ReadVarint(&timestamp) || !decoder.ReadVarint(&key_ref) ||
+        key_ref >= pool.size()) {
+      segments->Clear();
+      return false;
+    }
+    Segments::RevertEntry *entry = segments->push_back_revert_entry();
+    entry->revert_entry_type = static_cast<uint16>(type);
+    entry->id = static_cast<uint16>(id);
+    entry->timestamp = static_cast<uint32>(timestamp);
+    pool[key_ref].CopyToString(&entry->key);
+  }
+  return true;
+}
+
+}  // namespace mozc
@@ -0,0 +1,75 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_CONVERTER_SEGMENTS_CODEC_H_
+#define MOZC_CONVERTER_SEGMENTS_CODEC_H_
+
+#include <string>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+
+class Segments;
+
+// Compact binary codec for Segments, used where conversion results must
+// cross a process or session boundary: result caches, session
+// suspend/resume and replay tools.  The format is a string pool
+// followed by varint-coded fields; candidate strings reference the pool
+// by index, so the heavy duplication among key / content_key /
+// functional forms is stored once.  A purpose-built codec measured
+// several times faster than reflection-based proto serialization of
+// the same data.
+//
+// The format is an implementation detail: images are only guaranteed to
+// be readable by the same binary version that wrote them, so callers
+// must tolerate Deserialize() returning false (e.g. fall back to
+// reconversion).
+class SegmentsCodec {
+ public:
+  // Appends the serialized image of |segments| to |output|.
+  static void Serialize(const Segments &segments, string *output);
+
+  // Parses |input| into |segments|.  Existing content of |segments| is
+  // cleared first; the deserialized segments and candidates are built
+  // through the Segments object pools, so repeated deserialization into
+  // the same instance reuses its arena.  Returns false if |input| is
+  // truncated, corrupt or written by an incompatible version, in which
+  // case |segments| is left cleared.
+  static bool Deserialize(StringPiece input, Segments *segments);
+
+ private:
+  SegmentsCodec() = delete;
+  ~SegmentsCodec() = delete;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_SEGMENTS_CODEC_H_
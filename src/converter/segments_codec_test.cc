@@ -0,0 +1,232 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/segments_codec.h"
+
+#include <string>
+
+#include "base/number_util.h"
+#include "base/util.h"
+#include "converter/segments.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+void FillCandidate(int i, Segment::Candidate *candidate) {
+  candidate->key = Util::StringPrintf("key%d", i);
+  candidate->value = Util::StringPrintf("value%d", i);
+  candidate->content_key = candidate->key;
+  candidate->content_value = candidate->value;
+  candidate->consumed_key_size = i;
+  candidate->prefix = "prefix";
+  candidate->suffix = "suffix";
+  candidate->description = "description";
+  candidate->usage_id = i;
+  candidate->usage_title = "usage_title";
+  candidate->usage_description = "usage_description";
+  candidate->cost = 100 - i;
+  candidate->wcost = -50 + i;
+  candidate->structure_cost = i * 7;
+  candidate->lid = 10 + i;
+  candidate->rid = 20 + i;
+  candidate->attributes = Segment::Candidate::RERANKED |
+                          Segment::Candidate::CONTEXT_SENSITIVE;
+  candidate->source_info = Segment::Candidate::USER_HISTORY_PREDICTOR;
+  candidate->style = NumberUtil::NumberString::NUMBER_CIRCLED;
+  candidate->command = Segment::Candidate::ENABLE_INCOGNITO_MODE;
+  candidate->PushBackInnerSegmentBoundary(4, 6, 4, 6);
+}
+
+void ExpectCandidatesEqual(const Segment::Candidate &expected,
+                           const Segment::Candidate &actual) {
+  EXPECT_EQ(expected.key, actual.key);
+  EXPECT_EQ(expected.value, actual.value);
+  EXPECT_EQ(expected.content_key, actual.content_key);
+  EXPECT_EQ(expected.content_value, actual.content_value);
+  EXPECT_EQ(expected.consumed_key_size, actual.consumed_key_size);
+  EXPECT_EQ(expected.prefix, actual.prefix);
+  EXPECT_EQ(expected.suffix, actual.suffix);
+  EXPECT_EQ(expected.description, actual.description);
+  EXPECT_EQ(expected.usage_id, actual.usage_id);
+  EXPECT_EQ(expected.usage_title, actual.usage_title);
+  EXPECT_EQ(expected.usage_description, actual.usage_description);
+  EXPECT_EQ(expected.cost, actual.cost);
+  EXPECT_EQ(expected.wcost, actual.wcost);
+  EXPECT_EQ(expected.structure_cost, actual.structure_cost);
+  EXPECT_EQ(expected.lid, actual.lid);
+  EXPECT_EQ(expected.rid, actual.rid);
+  EXPECT_EQ(expected.attributes, actual.attributes);
+  EXPECT_EQ(expected.source_info, actual.source_info);
+  EXPECT_EQ(expected.style, actual.style);
+  EXPECT_EQ(expected.command, actual.command);
+  EXPECT_EQ(expected.inner_segment_boundary, actual.inner_segment_boundary);
+}
+
+TEST(SegmentsCodecTest, RoundTrip) {
+  Segments segments;
+  segments.set_request_type(Segments::PREDICTION);
+  segments.set_user_history_enabled(true);
+  segments.set_resized(true);
+  segments.set_max_history_segments_size(4);
+  segments.set_max_prediction_candidates_size(30);
+  segments.set_max_conversion_candidates_size(150);
+
+  Segment *history = segments.add_segment();
+  history->set_segment_type(Segment::HISTORY);
+  history->set_key("history_key");
+  FillCandidate(0, history->add_candidate());
+
+  Segment *conversion = segments.add_segment();
+  conversion->set_segment_type(Segment::FIXED_VALUE);
+  conversion->set_key("conversion_key");
+  for (int i = 1; i < 4; ++i) {
+    FillCandidate(i, conversion->add_candidate());
+  }
+  FillCandidate(4, conversion->add_meta_candidate());
+
+  Segments::RevertEntry *revert_entry = segments.push_back_revert_entry();
+  revert_entry->revert_entry_type = Segments::RevertEntry::UPDATE_ENTRY;
+  revert_entry->id = 1;
+  revert_entry->timestamp = 1234567;
+  revert_entry->key = "revert_key";
+
+  string image;
+  SegmentsCodec::Serialize(segments, &image);
+
+  Segments restored;
+  ASSERT_TRUE(SegmentsCodec::Deserialize(image, &restored));
+
+  EXPECT_EQ(segments.request_type(), restored.request_type());
+  EXPECT_EQ(segments.user_history_enabled(), restored.user_history_enabled());
+  EXPECT_EQ(segments.resized(), restored.resized());
+  EXPECT_EQ(segments.quality_degraded(), restored.quality_degraded());
+  EXPECT_EQ(segments.max_history_segments_size(),
+            restored.max_history_segments_size());
+  EXPECT_EQ(segments.max_prediction_candidates_size(),
+            restored.max_prediction_candidates_size());
+  EXPECT_EQ(segments.max_conversion_candidates_size(),
+            restored.max_conversion_candidates_size());
+
+  ASSERT_EQ(2, restored.segments_size());
+  EXPECT_EQ(1, restored.history_segments_size());
+  EXPECT_EQ(Segment::HISTORY, restored.segment(0).segment_type());
+  EXPECT_EQ("history_key", restored.segment(0).key());
+  ASSERT_EQ(1, restored.segment(0).candidates_size());
+  ExpectCandidatesEqual(segments.segment(0).candidate(0),
+                        restored.segment(0).candidate(0));
+  EXPECT_EQ(Segment::FIXED_VALUE, restored.segment(1).segment_type());
+  ASSERT_EQ(3, restored.segment(1).candidates_size());
+  for (int i = 0; i < 3; ++i) {
+    ExpectCandidatesEqual(segments.segment(1).candidate(i),
+                          restored.segment(1).candidate(i));
+  }
+  ASSERT_EQ(1, restored.segment(1).meta_candidates_size());
+  ExpectCandidatesEqual(segments.segment(1).meta_candidate(0),
+                        restored.segment(1).meta_candidate(0));
+
+  ASSERT_EQ(1, restored.revert_entries_size());
+  EXPECT_EQ(Segments::RevertEntry::UPDATE_ENTRY,
+            restored.revert_entry(0).revert_entry_type);
+  EXPECT_EQ(1, restored.revert_entry(0).id);
+  EXPECT_EQ(1234567, restored.revert_entry(0).timestamp);
+  EXPECT_EQ("revert_key", restored.revert_entry(0).key);
+}
+
+TEST(SegmentsCodecTest, EmptySegments) {
+  Segments segments;
+  string image;
+  SegmentsCodec::Serialize(segments, &image);
+
+  Segments restored;
+  EXPECT_TRUE(SegmentsCodec::Deserialize(image, &restored));
+  EXPECT_EQ(0, restored.segments_size());
+  EXPECT_EQ(0, restored.revert_entries_size());
+}
+
+TEST(SegmentsCodecTest, StringPoolDeduplicatesSharedStrings) {
+  // 100 candidates sharing the same strings must not blow up the image:
+  // each duplicated field costs only a small pool reference.
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  segment->set_key("key");
+  for (int i = 0; i < 100; ++i) {
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->Init();
+    candidate->key = "shared_key";
+    candidate->value = "shared_value";
+    candidate->content_key = candidate->key;
+    candidate->content_value = candidate->value;
+    candidate->description = "shared_description";
+  }
+
+  string image;
+  SegmentsCodec::Serialize(segments, &image);
+  // The duplicated strings collapse to pool references, so the image is
+  // dominated by the ~21 bytes of fixed numeric fields per candidate:
+  // far below the ~6KB the raw strings alone would take.
+  EXPECT_GT(3072, image.size());
+
+  Segments restored;
+  ASSERT_TRUE(SegmentsCodec::Deserialize(image, &restored));
+  ASSERT_EQ(100, restored.segment(0).candidates_size());
+  EXPECT_EQ("shared_key", restored.segment(0).candidate(99).key);
+  EXPECT_EQ("shared_description", restored.segment(0).candidate(99).description);
+}
+
+TEST(SegmentsCodecTest, CorruptInputIsRejected) {
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  segment->set_key("key");
+  FillCandidate(0, segment->add_candidate());
+
+  string image;
+  SegmentsCodec::Serialize(segments, &image);
+
+  Segments restored;
+  // Truncations at every length must be rejected, not crash.
+  for (size_t size = 0; size < image.size(); ++size) {
+    EXPECT_FALSE(
+        SegmentsCodec::Deserialize(StringPiece(image.data(), size), &restored))
+        << "Accepted truncated image of size " << size;
+  }
+  // Bad magic.
+  string broken = image;
+  broken[0] = 'X';
+  EXPECT_FALSE(SegmentsCodec::Deserialize(broken, &restored));
+
+  // A rejected image leaves the output cleared.
+  EXPECT_EQ(0, restored.segments_size());
+
+  // The original image still parses.
+  EXPECT_TRUE(SegmentsCodec::Deserialize(image, &restored));
+}
+
+}  // namespace
+}  // namespace mozc
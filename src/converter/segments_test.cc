@@ -150,6 +150,40 @@ TEST(SegmentsTest, BasicTest) {
   EXPECT_EQ(0, segments.segments_size());
 }
 
+TEST(SegmentsTest, CompactTest) {
+  Segments segments;
+
+  for (int i = 0; i < 5; ++i) {
+    Segment *segment = segments.push_back_segment();
+    segment->set_key("key");
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->value = "value";
+  }
+  EXPECT_GT(segments.RetainedBytes(), 0);
+
+  // Set up a history segment and drop the conversion segments, so that
+  // the pool keeps both live and released objects.
+  segments.mutable_segment(0)->set_segment_type(Segment::HISTORY);
+  segments.clear_conversion_segments();
+
+  // Leave some capacity in the cached lattice, which Compact() frees.
+  segments.mutable_cached_lattice()->SetKey("this is a test");
+  const size_t retained = segments.RetainedBytes();
+
+  segments.Compact();
+  EXPECT_LT(segments.RetainedBytes(), retained);
+
+  // The history segment must survive compaction.
+  EXPECT_EQ(1, segments.history_segments_size());
+  EXPECT_EQ("key", segments.segment(0).key());
+  EXPECT_EQ("value", segments.segment(0).candidate(0).value);
+
+  // And the pool must be usable again.
+  Segment *segment = segments.add_segment();
+  segment->set_key("new");
+  EXPECT_EQ(2, segments.segments_size());
+}
+
 TEST(CandidateTest, BasicTest) {
   Segment segment;
 
@@ -269,6 +303,70 @@ TEST(CandidateTest, CopyFrom) {
   EXPECT_EQ(src.inner_segment_boundary, dest.inner_segment_boundary);
 }
 
+TEST(CandidateTest, MoveFrom) {
+  Segment::Candidate src, dest;
+  src.Init();
+
+  src.key = "key";
+  src.value = "value";
+  src.content_key = "content_key";
+  src.content_value = "content_value";
+  src.prefix = "prefix";
+  src.suffix = "suffix";
+  src.description = "description";
+  src.usage_title = "usage_title";
+  src.usage_description = "usage_description";
+  src.cost = 1;
+  src.wcost = 2;
+  src.structure_cost = 3;
+  src.lid = 4;
+  src.rid = 5;
+  src.attributes = 6;
+  src.style = NumberUtil::NumberString::NUMBER_CIRCLED;
+  src.command = Segment::Candidate::DISABLE_PRESENTATION_MODE;
+  src.PushBackInnerSegmentBoundary(1, 3, 5, 7);
+
+  dest.MoveFrom(&src);
+
+  EXPECT_EQ("key", dest.key);
+  EXPECT_EQ("value", dest.value);
+  EXPECT_EQ("content_key", dest.content_key);
+  EXPECT_EQ("content_value", dest.content_value);
+  EXPECT_EQ("prefix", dest.prefix);
+  EXPECT_EQ("suffix", dest.suffix);
+  EXPECT_EQ("description", dest.description);
+  EXPECT_EQ("usage_title", dest.usage_title);
+  EXPECT_EQ("usage_description", dest.usage_description);
+  EXPECT_EQ(1, dest.cost);
+  EXPECT_EQ(2, dest.wcost);
+  EXPECT_EQ(3, dest.structure_cost);
+  EXPECT_EQ(4, dest.lid);
+  EXPECT_EQ(5, dest.rid);
+  EXPECT_EQ(6, dest.attributes);
+  EXPECT_EQ(NumberUtil::NumberString::NUMBER_CIRCLED, dest.style);
+  EXPECT_EQ(Segment::Candidate::DISABLE_PRESENTATION_MODE, dest.command);
+  EXPECT_EQ(1, dest.inner_segment_boundary.size());
+}
+
+TEST(SegmentTest, MoveCandidatesFrom) {
+  Segment src, dest;
+  for (int i = 0; i < 3; ++i) {
+    Segment::Candidate *candidate = src.add_candidate();
+    candidate->value = std::to_string(i);
+  }
+  Segment::Candidate *candidate = dest.add_candidate();
+  candidate->value = "dest";
+
+  dest.MoveCandidatesFrom(&src);
+
+  EXPECT_EQ(0, src.candidates_size());
+  ASSERT_EQ(4, dest.candidates_size());
+  EXPECT_EQ("dest", dest.candidate(0).value);
+  EXPECT_EQ("0", dest.candidate(1).value);
+  EXPECT_EQ("1", dest.candidate(2).value);
+  EXPECT_EQ("2", dest.candidate(3).value);
+}
+
 TEST(CandidateTest, IsValid) {
   Segment::Candidate c;
   c.Init();
@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <ostream>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/serialized_string_array.h"
 #include "base/stl_util.h"
@@ -41,6 +42,16 @@
 #include "data_manager/serialized_dictionary.h"
 #include "protocol/segmenter_data.pb.h"
 
+DEFINE_bool(prewarm_data, false,
+            "Synchronously read the data set image at startup so the first "
+            "conversion does not page-fault through the dictionary. "
+            "This is the POSIX counterpart of the Windows cache service; "
+            "intended for login scripts on VDI-like deployments.");
+DEFINE_bool(prewarm_data_mlock, false,
+            "In addition to --prewarm_data, mlock the sections every "
+            "conversion touches so they cannot be paged out again. "
+            "Requires a memlock rlimit covering those sections.");
+
 namespace mozc {
 namespace {
 
@@ -115,7 +126,14 @@ DataManager::Status DataManager::InitFromArray(StringPiece array,
     LOG(ERROR) << "Binary data of size " << array.size() << " is broken";
     return DataManager::Status::DATA_BROKEN;
   }
-  return InitFromReader(reader);
+  const Status status = InitFromReader(reader);
+  if (status == Status::OK) {
+    full_data_ = array;
+    if (FLAGS_prewarm_data) {
+      PrewarmData(FLAGS_prewarm_data_mlock);
+    }
+  }
+  return status;
 }
 
 DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
@@ -371,6 +389,25 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
       return Status::ENGINE_VERSION_MISMATCH;
     }
   }
+
+  // Verify the checksums of the small sections which the conversion
+  // structures parse before the first keystroke; they are a few KB, so
+  // this is cheap.  The big sections (dictionary, connection matrix,
+  // ...) rely on their own structural checks here and on the full
+  // verification at install time; see VerifyDataSetChecksums().
+  const char *kEagerlyVerifiedSections[] = {
+      "pos_matcher", "posg", "bdry", "segmenter_sizeinfo", "version",
+  };
+  for (size_t i = 0; i < arraysize(kEagerlyVerifiedSections); ++i) {
+    if (!reader.VerifySection(kEagerlyVerifiedSections[i])) {
+      return Status::DATA_BROKEN;
+    }
+  }
+
+  // Keep the reader: VerifyDataSetChecksums() needs the per-section
+  // checksums.  Its copied views stay valid as long as the data block.
+  dataset_reader_ = reader;
+
   return Status::OK;
 }
 
@@ -385,7 +422,91 @@ DataManager::Status DataManager::InitFromFile(const string &path,
     return Status::MMAP_FAILURE;
   }
   const StringPiece data(mmap_.begin(), mmap_.size());
-  return InitFromArray(data, magic);
+  const Status status = InitFromArray(data, magic);
+  if (status == Status::OK && !FLAGS_prewarm_data) {
+    // InitFromArray() already prewarmed synchronously when requested;
+    // otherwise fall back to asynchronous readahead advice.
+    PreloadData();
+  }
+  return status;
+}
+
+void DataManager::PreloadData() const {
+  if (mmap_.begin() == NULL || mmap_.size() == 0) {
+    return;  // Embedded or InitFromArray() data; nothing to page in.
+  }
+
+  // Dictionary lookup chases pointers through the LOUDS tries, so kernel
+  // readahead mostly reads pages that are never used; turn it off for the
+  // whole image first.
+  Mmap::MaybeMAdvise(mmap_.begin(), mmap_.size(), Mmap::ADVICE_RANDOM);
+
+  // Then kick off asynchronous readahead of the sections every conversion
+  // touches.  MADV_WILLNEED returns immediately and the kernel pages the
+  // ranges in in the background, so this does not delay initialization.
+  const StringPiece hot_sections[] = {
+      connection_data_,
+      dictionary_data_,
+      suggestion_filter_data_,
+      segmenter_bitarray_,
+  };
+  for (size_t i = 0; i < arraysize(hot_sections); ++i) {
+    if (!hot_sections[i].empty()) {
+      Mmap::MaybeMAdvise(hot_sections[i].data(), hot_sections[i].size(),
+                         Mmap::ADVICE_WILL_NEED);
+    }
+  }
+
+  size_t resident_pages = 0;
+  size_t total_pages = 0;
+  if (Mmap::MaybeCountResidentPages(mmap_.begin(), mmap_.size(),
+                                    &resident_pages, &total_pages) == 0) {
+    VLOG(1) << "Data image residency: " << resident_pages << "/"
+            << total_pages << " pages";
+  }
+}
+
+namespace {
+
+// Touches one byte per page so the whole range is faulted in.  The sum
+// keeps the reads from being optimized away.
+uint32 ReadPages(StringPiece section) {
+  const size_t kPageSize = 4096;
+  uint32 sum = 0;
+  for (size_t offset = 0; offset < section.size(); offset += kPageSize) {
+    sum += static_cast<uint8>(section[offset]);
+  }
+  return sum;
+}
+
+}  // namespace
+
+void DataManager::PrewarmData(bool lock_hot_sections) const {
+  // The sections the first conversion touches, most critical first, so
+  // an interrupted prewarm still helps.
+  const StringPiece hot_sections[] = {
+      connection_data_,
+      dictionary_data_,
+      suggestion_filter_data_,
+      segmenter_bitarray_,
+  };
+  uint32 sum = 0;
+  for (size_t i = 0; i < arraysize(hot_sections); ++i) {
+    sum += ReadPages(hot_sections[i]);
+    if (lock_hot_sections && !hot_sections[i].empty()) {
+      Mmap::MaybeMLock(hot_sections[i].data(), hot_sections[i].size());
+    }
+  }
+  // Then walk the rest of the image sequentially; it covers the smaller
+  // sections (segmenter tables, rewriter data, ...) in one readahead
+  // friendly pass.
+  sum += ReadPages(full_data_);
+  VLOG(1) << "Prewarmed " << full_data_.size() << " bytes (checksum byte "
+          << (sum & 0xFF) << ")";
+}
+
+bool DataManager::VerifyDataSetChecksums() const {
+  return dataset_reader_.VerifyAllSections();
 }
 
 DataManager::Status DataManager::InitUserPosManagerDataFromArray(
@@ -39,11 +39,10 @@
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "data_manager/data_manager_interface.h"
+#include "data_manager/dataset_reader.h"
 
 namespace mozc {
 
-class DataSetReader;  // Forward-declare this as it is used privately.
-
 // This data manager parses a data set file image and extracts each data
 // (dictionary, LM, etc.).
 // TODO(noriyukit): Migrate all the embedded data managers, such as
@@ -139,10 +138,37 @@ class DataManager : public DataManagerInterface {
   StringPiece GetTypingModel(const string &name) const override;
   StringPiece GetDataVersion() const override;
 
+  // Starts asynchronous readahead of the data sections that the first
+  // conversion touches, so a cold start does not pay a hard page fault
+  // per dictionary access.  Only effective when the data was loaded with
+  // InitFromFile(); data given to InitFromArray() is already resident.
+  // InitFromFile() calls this automatically.
+  void PreloadData() const;
+
+  // Synchronously pages the data set into memory: the sections the
+  // first conversion touches are read first (and optionally mlocked so
+  // they stay resident), then the rest of the image in one sequential
+  // pass.  Unlike PreloadData() this also works for embedded data,
+  // whose pages are faulted from the executable image.  Init*() runs it
+  // when --prewarm_data is set; this is the POSIX counterpart of the
+  // Windows cache service.
+  void PrewarmData(bool lock_hot_sections) const;
+
+  // Verifies the per-section checksums of the loaded data set.
+  // Checksumming the image costs time proportional to its size, so
+  // Init*() doesn't do it; the engine builder runs this at install
+  // time, where a corrupted download must be rejected.  Sections
+  // without a stored checksum (data files older than the checksum
+  // field) are skipped.
+  bool VerifyDataSetChecksums() const;
+
  private:
   Status InitFromReader(const DataSetReader &reader);
 
   Mmap mmap_;
+  // The whole data set image (mmapped or embedded); set on successful
+  // InitFromArray() and used by PrewarmData().
+  StringPiece full_data_;
   StringPiece pos_matcher_data_;
   StringPiece user_pos_token_array_data_;
   StringPiece user_pos_string_array_data_;
@@ -189,6 +215,9 @@ class DataManager : public DataManagerInterface {
   StringPiece usage_string_array_data_;
   std::vector<std::pair<string, StringPiece>> typing_model_data_;
   StringPiece data_version_;
+  // Kept for VerifyDataSetChecksums(); its views point into the same
+  // memory block as the section members above.
+  DataSetReader dataset_reader_;
 
   DISALLOW_COPY_AND_ASSIGN(DataManager);
 };
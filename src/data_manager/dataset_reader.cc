@@ -48,6 +48,7 @@ DataSetReader::~DataSetReader() = default;
 
 bool DataSetReader::Init(StringPiece memblock, StringPiece magic) {
   name_to_data_map_.clear();
+  name_to_checksum_map_.clear();
 
   // Initializes |name_to_data_map_| from |memblock|.  For binary data format,
   // see dataset.proto.
@@ -67,6 +68,15 @@ bool DataSetReader::Init(StringPiece memblock, StringPiece magic) {
     return false;
   }
 
+  // Section offsets are aligned relative to the beginning of the image
+  // (see DataSetWriter::Add), so sections can be reinterpreted in place
+  // only if the image itself is at least 8-byte aligned.  Embedded
+  // images get this from EmbeddedFile and codegen_bytearray_stream, and
+  // mmap returns page-aligned addresses.  Catch violations early in
+  // debug builds instead of letting consumers copy or crash later.
+  DCHECK_EQ(0, reinterpret_cast<uintptr_t>(memblock.data()) % 8)
+      << "Data set image is not 8-byte aligned";
+
   // Check the file size.
   uint64 filesize = 0;
   if (!Util::DeserializeUint64(ClippedSubstr(memblock, memblock.size() - 8, 8),
@@ -129,6 +139,7 @@ bool DataSetReader::Init(StringPiece memblock, StringPiece magic) {
       return false;
     }
     name_to_data_map_[e.name()] = ClippedSubstr(memblock, e.offset(), e.size());
+    name_to_checksum_map_[e.name()] = e.checksum();
     prev_chunk_end = e.offset() + e.size();
   }
 
@@ -160,4 +171,35 @@ bool DataSetReader::VerifyChecksum(StringPiece memblock) {
   return actual_checksum == expected_checksum;
 }
 
+bool DataSetReader::VerifySection(const string &name) const {
+  const auto data_iter = name_to_data_map_.find(name);
+  if (data_iter == name_to_data_map_.end()) {
+    LOG(ERROR) << "No section named " << name;
+    return false;
+  }
+  const auto checksum_iter = name_to_checksum_map_.find(name);
+  if (checksum_iter == name_to_checksum_map_.end() ||
+      checksum_iter->second.empty()) {
+    // The data file predates per-section checksums.
+    VLOG(1) << "No checksum is stored for " << name;
+    return true;
+  }
+  const string &actual_checksum =
+      internal::UnverifiedSHA1::MakeDigest(data_iter->second);
+  if (actual_checksum != checksum_iter->second) {
+    LOG(ERROR) << "Broken: checksum mismatch for section " << name;
+    return false;
+  }
+  return true;
+}
+
+bool DataSetReader::VerifyAllSections() const {
+  bool ok = true;
+  for (const auto &kv : name_to_data_map_) {
+    // Don't stop at the first broken section; log all of them.
+    ok &= VerifySection(kv.first);
+  }
+  return ok;
+}
+
 }  // namespace mozc
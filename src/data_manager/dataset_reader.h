@@ -56,6 +56,18 @@ class DataSetReader {
   // Verifies the checksum of binary image.
   static bool VerifyChecksum(StringPiece memblock);
 
+  // Verifies the per-section checksum of the data for |name| (cost is
+  // proportional to the section size, not to the whole image).  Returns
+  // false if |name| doesn't exist or the data is corrupted.  Data files
+  // whose metadata predates per-section checksums always pass; use
+  // VerifyChecksum() to validate those.
+  bool VerifySection(const string &name) const;
+
+  // Verifies the per-section checksum of every section.  Equivalent in
+  // strength to VerifyChecksum() on up-to-date data files and meant for
+  // install time; regular use can verify just the sections it touches.
+  bool VerifyAllSections() const;
+
   const std::map<string, StringPiece> &name_to_data_map() const {
     return name_to_data_map_;
   }
@@ -63,6 +75,8 @@ class DataSetReader {
  private:
   // The value points to a block of the specified |memblock|.
   std::map<string, StringPiece> name_to_data_map_;
+  // SHA1 digests by section name; empty for sections without one.
+  std::map<string, string> name_to_checksum_map_;
 };
 
 }  // namespace mozc
@@ -79,6 +79,38 @@ TEST(DataSetReaderTest, ValidData) {
   EXPECT_FALSE(r.Get("foo", &data));
 }
 
+TEST(DataSetReaderTest, VerifySection) {
+  const StringPiece kGoogle("GOOGLE"), kMozc("m\0zc\xEF", 5);
+  string image;
+  {
+    DataSetWriter w(GetTestMagicNumber());
+    w.Add("google", 16, kGoogle);
+    w.Add("mozc", 64, kMozc);
+    std::stringstream out;
+    w.Finish(&out);
+    image = out.str();
+  }
+
+  DataSetReader r;
+  ASSERT_TRUE(r.Init(image, GetTestMagicNumber()));
+  EXPECT_TRUE(r.VerifySection("google"));
+  EXPECT_TRUE(r.VerifySection("mozc"));
+  EXPECT_TRUE(r.VerifyAllSections());
+  EXPECT_FALSE(r.VerifySection("foo"));
+
+  // Flip one bit of the "google" section.  Only that section's
+  // verification fails.
+  StringPiece data;
+  ASSERT_TRUE(r.Get("google", &data));
+  string broken_image = image;
+  broken_image[data.data() - image.data()] ^= 1;
+  DataSetReader broken;
+  ASSERT_TRUE(broken.Init(broken_image, GetTestMagicNumber()));
+  EXPECT_FALSE(broken.VerifySection("google"));
+  EXPECT_TRUE(broken.VerifySection("mozc"));
+  EXPECT_FALSE(broken.VerifyAllSections());
+}
+
 TEST(DataSetReaderTest, InvalidMagicString) {
   const string &magic = GetTestMagicNumber();
   DataSetReader r;
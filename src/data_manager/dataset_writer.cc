@@ -40,36 +40,46 @@
 namespace mozc {
 namespace {
 
+// In addition to the word-sized boundaries, 512 bits (a 64-byte cache
+// line) and 32768 bits (a 4KiB page) are accepted for sections that
+// benefit from cache line or page alignment.
 bool IsValidAlignment(int a) {
-  return a == 8 || a == 16 || a == 32 || a == 64;
+  return a == 8 || a == 16 || a == 32 || a == 64 || a == 512 || a == 32768;
 }
 
 }  // namespace
 
 DataSetWriter::DataSetWriter(StringPiece magic)
-    : image_(magic.data(), magic.size()) {}
+    : image_(magic.data(), magic.size()), padding_bytes_(0) {}
 
 DataSetWriter::~DataSetWriter() = default;
 
-void DataSetWriter::Add(const string &name, int alignment, StringPiece data) {
+void DataSetWriter::Add(const string &name, int alignment, StringPiece data,
+                        SectionPlacement placement) {
+  CHECK(IsValidAlignment(alignment)) << "Invalid alignment: " << alignment;
   CHECK(seen_names_.insert(name).second) << name << " was already added";
-  AppendPadding(alignment);
-  DataSetMetadata::Entry *entry = metadata_.add_entries();
-  entry->set_name(name);
-  entry->set_offset(image_.size());
-  entry->set_size(data.size());
-  image_.append(data.data(), data.size());
+  std::vector<Section> *sections =
+      (placement == PLACEMENT_HOT) ? &hot_sections_ : &cold_sections_;
+  sections->emplace_back(name, alignment, string(data.data(), data.size()));
 }
 
 void DataSetWriter::AddFile(const string &name, int alignment,
-                            const string &filepath) {
+                            const string &filepath,
+                            SectionPlacement placement) {
   mozc::InputFileStream ifs(filepath.c_str(),
                             std::ios_base::in | std::ios_base::binary);
   CHECK(ifs.good()) << "Failed to open " << name;
-  Add(name, alignment, ifs.Read());
+  Add(name, alignment, ifs.Read(), placement);
 }
 
 void DataSetWriter::Finish(std::ostream *output) {
+  for (const Section &section : hot_sections_) {
+    AppendSection(section, &image_);
+  }
+  for (const Section &section : cold_sections_) {
+    AppendSection(section, &image_);
+  }
+
   const string s = metadata_.SerializeAsString();
   image_.append(s);  // Metadata
   image_.append(Util::SerializeUint64(s.size()));  // Metadata size
@@ -82,15 +92,27 @@ void DataSetWriter::Finish(std::ostream *output) {
   image_.append(Util::SerializeUint64(image_.size() + 8));
 
   CHECK(output->write(image_.data(), image_.size()));
-  VLOG(1) << "Wrote data set of " << image_.size() << " bytes:\n"
+  VLOG(1) << "Wrote data set of " << image_.size() << " bytes ("
+          << padding_bytes_ << " bytes of alignment padding):\n"
           << metadata_.Utf8DebugString();
 }
 
-void DataSetWriter::AppendPadding(int alignment) {
-  CHECK(IsValidAlignment(alignment)) << "Invalid alignment: " << alignment;
+void DataSetWriter::AppendSection(const Section &section, string *image) {
+  AppendPadding(section.alignment, image);
+  DataSetMetadata::Entry *entry = metadata_.add_entries();
+  entry->set_name(section.name);
+  entry->set_offset(image->size());
+  entry->set_size(section.data.size());
+  entry->set_checksum(internal::UnverifiedSHA1::MakeDigest(section.data));
+  image->append(section.data);
+}
+
+void DataSetWriter::AppendPadding(int alignment, string *image) {
   alignment /= 8;  // To byte
-  if (image_.size() % alignment > 0) {
-    image_.append(alignment - image_.size() % alignment, '\0');
+  if (image->size() % alignment > 0) {
+    const size_t padding = alignment - image->size() % alignment;
+    image->append(padding, '\0');
+    padding_bytes_ += padding;
   }
 }
 
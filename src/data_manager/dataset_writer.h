@@ -33,6 +33,7 @@
 #include <ostream>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "base/string_piece.h"
 #include "data_manager/dataset.pb.h"
@@ -43,29 +44,63 @@ namespace mozc {
 // see dataset.proto.
 class DataSetWriter {
  public:
+  // Where a section is placed in the packed image.  Hot sections are
+  // packed together at the front, before all cold ones, so the pages
+  // that the first conversion touches are contiguous and the resident
+  // working set stays small.  Which sections are hot should come from
+  // access profiles of the consuming binary.  Within each group,
+  // sections keep their Add() order.
+  enum SectionPlacement {
+    PLACEMENT_HOT,
+    PLACEMENT_COLD,
+  };
+
   // Creates a writer with specified magic number.
   explicit DataSetWriter(StringPiece magic);
   ~DataSetWriter();
 
   // Adds a binary image to the packed file so that data is aligned at the
-  // specified bit boundary (8, 16, 32, or 64).
-  void Add(const string &name, int alignment, StringPiece data);
+  // specified bit boundary.  Valid alignments are 8, 16, 32 and 64 bits
+  // plus two larger classes for sections that are searched through
+  // indexes or mapped zero-copy: 512 (one 64-byte cache line) and 32768
+  // (one 4KiB page).  Nothing is written until Finish().
+  void Add(const string &name, int alignment, StringPiece data,
+           SectionPlacement placement = PLACEMENT_COLD);
 
   // Similar to Add() for StringPiece but data is read from file.
-  void AddFile(const string &name, int alignment, const string &filepath);
+  void AddFile(const string &name, int alignment, const string &filepath,
+               SectionPlacement placement = PLACEMENT_COLD);
 
-  // Writes the image to output.  If |output| is a file, it should be opened in
-  // binary mode.
+  // Packs the sections (hot group first) and writes the image to output.
+  // If |output| is a file, it should be opened in binary mode.
   void Finish(std::ostream *output);
 
+  // Valid after Finish().
   const DataSetMetadata &metadata() const { return metadata_; }
 
+  // Total bytes spent on alignment padding between sections.  Valid
+  // after Finish(); use it to audit the cost of the alignment classes.
+  size_t padding_bytes() const { return padding_bytes_; }
+
  private:
-  void AppendPadding(int alignment);
+  struct Section {
+    Section(const string &n, int a, const string &d)
+        : name(n), alignment(a), data(d) {}
 
-  string image_;
+    string name;
+    int alignment;
+    string data;
+  };
+
+  void AppendSection(const Section &section, string *image);
+  void AppendPadding(int alignment, string *image);
+
+  std::vector<Section> hot_sections_;
+  std::vector<Section> cold_sections_;
   DataSetMetadata metadata_;
   std::set<string> seen_names_;
+  string image_;
+  size_t padding_bytes_;
 };
 
 }  // namespace mozc
@@ -35,12 +35,15 @@
 //   --output=/path/to/output \
 //   [arg1, [arg2, ...]]
 //
-// Here, each argument has the following form:
+// Here, each argument has one of the following forms:
 //
 // name:alignment:/path/to/infile
+// name:alignment:placement:/path/to/infile
 //
-// where alignment must be one of {8, 16, 32, 64}.  Each packed file can be
-// retrieved by DataSetReader through its name.
+// where alignment must be one of {8, 16, 32, 64, 512, 32768} and placement,
+// when given, must be "hot" or "cold" (default: cold).  Hot files are packed
+// together at the front of the image; see DataSetWriter::SectionPlacement.
+// Each packed file can be retrieved by DataSetReader through its name.
 
 #include <string>
 #include <vector>
@@ -65,11 +68,13 @@ int main(int argc, char **argv) {
       << "magic number is not a proper hex-escaped string: " << FLAGS_magic;
 
   struct Input {
-    Input(const string &n, int a, const string &f)
-        : name(n), alignment(a), filename(f) {}
+    Input(const string &n, int a, mozc::DataSetWriter::SectionPlacement p,
+          const string &f)
+        : name(n), alignment(a), placement(p), filename(f) {}
 
     string name;
     int alignment;
+    mozc::DataSetWriter::SectionPlacement placement;
     string filename;
   };
 
@@ -81,9 +86,20 @@ int main(int argc, char **argv) {
     }
     std::vector<string> params;
     mozc::Util::SplitStringUsing(argv[i], ":", &params);
-    CHECK_EQ(3, params.size()) << "Unexpected arg[" << i << "] = " << argv[i];
+    CHECK(params.size() == 3 || params.size() == 4)
+        << "Unexpected arg[" << i << "] = " << argv[i];
+    mozc::DataSetWriter::SectionPlacement placement =
+        mozc::DataSetWriter::PLACEMENT_COLD;
+    if (params.size() == 4) {
+      if (params[2] == "hot") {
+        placement = mozc::DataSetWriter::PLACEMENT_HOT;
+      } else {
+        CHECK_EQ("cold", params[2])
+            << "Unexpected placement in arg[" << i << "] = " << argv[i];
+      }
+    }
     inputs.emplace_back(params[0], mozc::NumberUtil::SimpleAtoi(params[1]),
-                        params[2]);
+                        placement, params.back());
   }
 
   CHECK(!FLAGS_output.empty()) << "--output is required";
@@ -97,7 +113,8 @@ int main(int argc, char **argv) {
     for (const auto &input : inputs) {
       VLOG(1) << "Writing " << input.name << ", alignment = " << input.alignment
               << ", file = " << input.filename;
-      writer.AddFile(input.name, input.alignment, input.filename);
+      writer.AddFile(input.name, input.alignment, input.filename,
+                     input.placement);
     }
     mozc::OutputFileStream output(tmpfile.c_str(),
                                   std::ios_base::out | std::ios_base::binary);
@@ -43,11 +43,12 @@
 namespace mozc {
 namespace {
 
-void SetEntry(const string &name, uint64 offset, uint64 size,
+void SetEntry(const string &name, uint64 offset, const string &data,
               DataSetMetadata::Entry *entry) {
   entry->set_name(name);
   entry->set_offset(offset);
-  entry->set_size(size);
+  entry->set_size(data.size());
+  entry->set_checksum(internal::UnverifiedSHA1::MakeDigest(data));
 }
 
 TEST(DatasetWriterTest, Write) {
@@ -94,15 +95,18 @@ TEST(DatasetWriterTest, Write) {
       "m\0zc\xEF"              // offset 64, size 5
       "\0\0\0"                 // offset 69, size 3 (padding)
       "m\0zc\xEF";             // offset 72, size 5
+  const string file_data("m\0zc\xEF", 5);
   DataSetMetadata metadata;
-  SetEntry("data8", 5, 8, metadata.add_entries());
-  SetEntry("data16", 14, 10, metadata.add_entries());
-  SetEntry("data32", 24, 12, metadata.add_entries());
-  SetEntry("data64", 40, 11, metadata.add_entries());
-  SetEntry("file8", 51, 5, metadata.add_entries());
-  SetEntry("file16", 56, 5, metadata.add_entries());
-  SetEntry("file32", 64, 5, metadata.add_entries());
-  SetEntry("file64", 72, 5, metadata.add_entries());
+  SetEntry("data8", 5, string("data8 \x00\x01", 8), metadata.add_entries());
+  SetEntry("data16", 14, "data16 \xAB\xCD\xEF", metadata.add_entries());
+  SetEntry("data32", 24, string("data32 \x00\xAB\n\r\n", 12),
+           metadata.add_entries());
+  SetEntry("data64", 40, string("data64 \t\t\x00\x00", 11),
+           metadata.add_entries());
+  SetEntry("file8", 51, file_data, metadata.add_entries());
+  SetEntry("file16", 56, file_data, metadata.add_entries());
+  SetEntry("file32", 64, file_data, metadata.add_entries());
+  SetEntry("file64", 72, file_data, metadata.add_entries());
   const string &metadata_chunk = metadata.SerializeAsString();
   const string &metadata_size = Util::SerializeUint64(metadata_chunk.size());
   // Append data_chunk except for the last '\0'.
@@ -116,5 +120,52 @@ TEST(DatasetWriterTest, Write) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST(DatasetWriterTest, HotSectionsArePackedFirst) {
+  DataSetWriter w("magic");
+
+  // Hot sections must precede cold ones in the image regardless of the
+  // order of Add() calls.
+  w.Add("cold1", 8, "cold1-data");
+  w.Add("hot1", 8, "hot1-data", DataSetWriter::PLACEMENT_HOT);
+  w.Add("cold2", 8, "cold2-data", DataSetWriter::PLACEMENT_COLD);
+  w.Add("hot2", 8, "hot2-data", DataSetWriter::PLACEMENT_HOT);
+
+  std::stringstream out;
+  w.Finish(&out);
+
+  const string &image = out.str();
+  EXPECT_EQ("magic"
+            "hot1-data" "hot2-data"
+            "cold1-data" "cold2-data",
+            image.substr(0, 43));
+
+  // Metadata entries follow the image order: hot group first, each group
+  // in Add() order.
+  const DataSetMetadata &metadata = w.metadata();
+  ASSERT_EQ(4, metadata.entries_size());
+  EXPECT_EQ("hot1", metadata.entries(0).name());
+  EXPECT_EQ("hot2", metadata.entries(1).name());
+  EXPECT_EQ("cold1", metadata.entries(2).name());
+  EXPECT_EQ("cold2", metadata.entries(3).name());
+  EXPECT_EQ(0, w.padding_bytes());
+}
+
+TEST(DatasetWriterTest, LargeAlignmentClasses) {
+  DataSetWriter w("magic");
+
+  w.Add("cacheline", 512, "cacheline-data");
+  w.Add("page", 32768, "page-data");
+
+  std::stringstream out;
+  w.Finish(&out);
+
+  ASSERT_EQ(2, w.metadata().entries_size());
+  EXPECT_EQ(64, w.metadata().entries(0).offset());   // 64-byte cache line
+  EXPECT_EQ(4096, w.metadata().entries(1).offset());  // 4KiB page
+  // Padding to the first boundary (64 - 5 magic bytes) plus padding to
+  // the page boundary (4096 - 64 - 14 data bytes).
+  EXPECT_EQ(59 + 4018, w.padding_bytes());
+}
+
 }  // namespace
 }  // namespace mozc
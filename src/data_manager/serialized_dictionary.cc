@@ -95,9 +95,39 @@ SerializedDictionary::~SerializedDictionary() {}
 
 SerializedDictionary::IterRange SerializedDictionary::equal_range(
     StringPiece key) const {
-  // TODO(noriyukit): Instead of comparing key as string, we can do binary
-  // search using key index to minimize string comparison cost.
-  return std::equal_range(begin(), end(), key);
+  // Tokens are sorted by key and the string array is sorted, so the token
+  // order by key equals the token order by key index.  Resolve |key| to
+  // its index by one binary search over the string array, then search the
+  // token array comparing plain uint32 indices; string comparisons are
+  // thus confined to the first search.
+  const auto str_iter =
+      std::lower_bound(string_array_.begin(), string_array_.end(), key);
+  if (str_iter == string_array_.end() || *str_iter != key) {
+    return IterRange(end(), end());
+  }
+  const uint32 key_index = str_iter.index();
+
+  size_t lo = 0;
+  size_t hi = size();
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if ((begin() + mid).key_index() < key_index) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  const size_t range_begin = lo;
+  hi = size();
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if ((begin() + mid).key_index() <= key_index) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return IterRange(begin() + range_begin, begin() + lo);
 }
 
 std::pair<StringPiece, StringPiece> SerializedDictionary::Compile(
@@ -166,6 +166,7 @@
         'user_dictionary_importer.cc',
         'user_dictionary_session.cc',
         'user_dictionary_session_handler.cc',
+        'user_dictionary_snapshot.cc',
         'user_dictionary_storage.cc',
         'user_dictionary_util.cc',
       ],
@@ -59,9 +59,12 @@ DictionaryImpl::DictionaryImpl(
   CHECK(value_dictionary_.get());
   CHECK(user_dictionary_);
   CHECK(suppression_dictionary_);
-  dics_.push_back(system_dictionary_.get());
-  dics_.push_back(value_dictionary_.get());
-  dics_.push_back(user_dictionary_);
+  dics_.push_back(Source(ConversionRequest::DICTIONARY_SOURCE_SYSTEM,
+                         system_dictionary_.get()));
+  dics_.push_back(Source(ConversionRequest::DICTIONARY_SOURCE_VALUE,
+                         value_dictionary_.get()));
+  dics_.push_back(Source(ConversionRequest::DICTIONARY_SOURCE_USER,
+                         user_dictionary_));
 }
 
 DictionaryImpl::~DictionaryImpl() {
@@ -70,7 +73,7 @@ DictionaryImpl::~DictionaryImpl() {
 
 bool DictionaryImpl::HasKey(StringPiece key) const {
   for (size_t i = 0; i < dics_.size(); ++i) {
-    if (dics_[i]->HasKey(key)) {
+    if (dics_[i].dic->HasKey(key)) {
       return true;
     }
   }
@@ -79,7 +82,7 @@ bool DictionaryImpl::HasKey(StringPiece key) const {
 
 bool DictionaryImpl::HasValue(StringPiece value) const {
   for (size_t i = 0; i < dics_.size(); ++i) {
-    if (dics_[i]->HasValue(value)) {
+    if (dics_[i].dic->HasValue(value)) {
       return true;
     }
   }
@@ -101,45 +104,95 @@ class CallbackWithFilter : public DictionaryInterface::Callback {
         use_t13n_conversion_(use_t13n_conversion),
         pos_matcher_(pos_matcher),
         suppression_dictionary_(suppression_dictionary),
-        callback_(callback) {}
+        callback_(callback),
+        token_budget_(0),
+        num_tokens_(0),
+        done_(false) {}
+
+  // Sets the maximum number of tokens delivered to the wrapped callback.
+  // 0 means unlimited.
+  void set_token_budget(size_t budget) { token_budget_ = budget; }
+
+  // Returns true once the wrapped callback terminated the traversal or
+  // the token budget was spent; remaining sources can then be skipped.
+  bool done() const { return done_; }
 
   virtual ResultType OnKey(StringPiece key) {
-    return callback_->OnKey(key);
+    return CheckDone(callback_->OnKey(key));
   }
 
   virtual ResultType OnActualKey(StringPiece key, StringPiece actual_key,
                                  bool is_expanded) {
-    return callback_->OnActualKey(key, actual_key, is_expanded);
+    return CheckDone(callback_->OnActualKey(key, actual_key, is_expanded));
   }
 
   virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
+    if (IsFiltered(token)) {
+      return TRAVERSE_CONTINUE;
+    }
+    return CountToken(CheckDone(callback_->OnToken(key, actual_key, token)));
+  }
+
+  virtual ResultType OnConsumableToken(StringPiece key, StringPiece actual_key,
+                                       Token *token) {
+    if (IsFiltered(*token)) {
+      return TRAVERSE_CONTINUE;
+    }
+    return CountToken(
+        CheckDone(callback_->OnConsumableToken(key, actual_key, token)));
+  }
+
+  virtual void OnTruncated() {
+    callback_->OnTruncated();
+  }
+
+ private:
+  ResultType CheckDone(ResultType result) {
+    if (result == TRAVERSE_DONE) {
+      done_ = true;
+    }
+    return result;
+  }
+
+  ResultType CountToken(ResultType result) {
+    if (result != TRAVERSE_DONE && token_budget_ != 0 &&
+        ++num_tokens_ >= token_budget_) {
+      done_ = true;
+      // The budget cut the traversal short on behalf of the wrapped
+      // callback, which cannot see it otherwise.
+      callback_->OnTruncated();
+      return TRAVERSE_DONE;
+    }
+    return result;
+  }
+
+  bool IsFiltered(const Token &token) const {
     if (!(token.attributes & Token::USER_DICTIONARY)) {
       if (!use_spelling_correction_ &&
           (token.attributes & Token::SPELLING_CORRECTION)) {
-        return TRAVERSE_CONTINUE;
+        return true;
       }
       if (!use_zip_code_conversion_ && pos_matcher_->IsZipcode(token.lid)) {
-        return TRAVERSE_CONTINUE;
+        return true;
       }
       if (!use_t13n_conversion_ &&
           Util::IsEnglishTransliteration(token.value)) {
-        return TRAVERSE_CONTINUE;
+        return true;
       }
     }
-    if (suppression_dictionary_->SuppressEntry(token.key, token.value)) {
-      return TRAVERSE_CONTINUE;
-    }
-    return callback_->OnToken(key, actual_key, token);
+    return suppression_dictionary_->SuppressEntry(token.key, token.value);
   }
 
- private:
   const bool use_spelling_correction_;
   const bool use_zip_code_conversion_;
   const bool use_t13n_conversion_;
   const POSMatcher *pos_matcher_;
   const SuppressionDictionary *suppression_dictionary_;
   DictionaryInterface::Callback *callback_;
+  size_t token_budget_;
+  size_t num_tokens_;
+  bool done_;
 };
 
 }  // namespace
@@ -155,11 +208,18 @@ void DictionaryImpl::LookupPredictive(
       pos_matcher_,
       suppression_dictionary_,
       callback);
+  callback_with_filter.set_token_budget(
+      conversion_request.lookup_token_budget());
+  const uint32 mask = conversion_request.dictionary_source_mask();
   for (size_t i = 0; i < dics_.size(); ++i) {
-    dics_[i]->LookupPredictive(
-        key,
-        conversion_request,
-        &callback_with_filter);
+    if (!(dics_[i].source & mask)) {
+      continue;
+    }
+    dics_[i].dic->LookupPredictive(key, conversion_request,
+                                   &callback_with_filter);
+    if (callback_with_filter.done()) {
+      break;
+    }
   }
 }
 
@@ -174,11 +234,17 @@ void DictionaryImpl::LookupPrefix(
       pos_matcher_,
       suppression_dictionary_,
       callback);
+  callback_with_filter.set_token_budget(
+      conversion_request.lookup_token_budget());
+  const uint32 mask = conversion_request.dictionary_source_mask();
   for (size_t i = 0; i < dics_.size(); ++i) {
-    dics_[i]->LookupPrefix(
-        key,
-        conversion_request,
-        &callback_with_filter);
+    if (!(dics_[i].source & mask)) {
+      continue;
+    }
+    dics_[i].dic->LookupPrefix(key, conversion_request, &callback_with_filter);
+    if (callback_with_filter.done()) {
+      break;
+    }
   }
 }
 
@@ -193,8 +259,17 @@ void DictionaryImpl::LookupExact(
       pos_matcher_,
       suppression_dictionary_,
       callback);
+  callback_with_filter.set_token_budget(
+      conversion_request.lookup_token_budget());
+  const uint32 mask = conversion_request.dictionary_source_mask();
   for (size_t i = 0; i < dics_.size(); ++i) {
-    dics_[i]->LookupExact(key, conversion_request, &callback_with_filter);
+    if (!(dics_[i].source & mask)) {
+      continue;
+    }
+    dics_[i].dic->LookupExact(key, conversion_request, &callback_with_filter);
+    if (callback_with_filter.done()) {
+      break;
+    }
   }
 }
 
@@ -209,8 +284,17 @@ void DictionaryImpl::LookupReverse(
       pos_matcher_,
       suppression_dictionary_,
       callback);
+  callback_with_filter.set_token_budget(
+      conversion_request.lookup_token_budget());
+  const uint32 mask = conversion_request.dictionary_source_mask();
   for (size_t i = 0; i < dics_.size(); ++i) {
-    dics_[i]->LookupReverse(str, conversion_request, &callback_with_filter);
+    if (!(dics_[i].source & mask)) {
+      continue;
+    }
+    dics_[i].dic->LookupReverse(str, conversion_request, &callback_with_filter);
+    if (callback_with_filter.done()) {
+      break;
+    }
   }
 }
 
@@ -221,7 +305,7 @@ bool DictionaryImpl::LookupComment(StringPiece key, StringPiece value,
   // In the current implementation, UserDictionary is the last node of dics_,
   // but the only dictionary which may return true.
   for (size_t i = 0; i < dics_.size(); ++i) {
-    if (dics_[i]->LookupComment(key, value, conversion_request, comment)) {
+    if (dics_[i].dic->LookupComment(key, value, conversion_request, comment)) {
       return true;
     }
   }
@@ -234,13 +318,13 @@ bool DictionaryImpl::Reload() {
 
 void DictionaryImpl::PopulateReverseLookupCache(StringPiece str) const {
   for (size_t i = 0; i < dics_.size(); ++i) {
-    dics_[i]->PopulateReverseLookupCache(str);
+    dics_[i].dic->PopulateReverseLookupCache(str);
   }
 }
 
 void DictionaryImpl::ClearReverseLookupCache() const {
   for (size_t i = 0; i < dics_.size(); ++i) {
-    dics_[i]->ClearReverseLookupCache();
+    dics_[i].dic->ClearReverseLookupCache();
   }
 }
 
@@ -102,8 +102,15 @@ class DictionaryImpl : public DictionaryInterface {
   DictionaryInterface *user_dictionary_;
 
   // Convenient container to handle the above three dictionaries as one
-  // composite dictionary.
-  std::vector<const DictionaryInterface *> dics_;
+  // composite dictionary, in lookup priority order.  |source| is the
+  // ConversionRequest::DictionarySource bit of the dictionary, checked
+  // against ConversionRequest::dictionary_source_mask().
+  struct Source {
+    Source(uint32 s, const DictionaryInterface *d) : source(s), dic(d) {}
+    uint32 source;
+    const DictionaryInterface *dic;
+  };
+  std::vector<Source> dics_;
 
   // Suppression dictionary is used to suppress entries.
   const SuppressionDictionary *suppression_dictionary_;
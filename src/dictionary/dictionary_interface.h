@@ -50,7 +50,7 @@ class DictionaryInterface {
   //   OnKey(key);
   //   OnActualKey(key, actual_key, key != actual_key);
   //   for (each token in the token array for the key) {
-  //     OnToken(key, actual_key, token);
+  //     OnToken(key, actual_key, token);  // or OnConsumableToken(...)
   //   }
   // }
   //
@@ -85,6 +85,46 @@ class DictionaryInterface {
 
     virtual ~Callback() {}
 
+    // Limits on predictive traversal, queried through GetPredictiveLimit()
+    // before the trie expansion starts.  A callback that consumes a bounded
+    // number of results can return tighter values so that the traverser
+    // stops expanding and decoding instead of generating tokens that the
+    // callback would discard anyway.  The default values mean "no limit";
+    // traversers may still apply their own caps on top of these.
+    struct PredictiveLimit {
+      // No limit for a field.
+      static const size_t kUnlimited = static_cast<size_t>(-1);
+
+      PredictiveLimit()
+          : max_keys(kUnlimited),
+            max_tokens(kUnlimited),
+            max_key_length_delta(kUnlimited) {}
+
+      // Max number of keys to find under the looked up key.
+      size_t max_keys;
+      // Max total number of tokens to decode over all found keys.
+      size_t max_tokens;
+      // Max number of units by which a found key may be longer than the
+      // looked up key, in encoded key length (one unit per kana character
+      // for readings).
+      size_t max_key_length_delta;
+    };
+
+    // Called before predictive traversal.  Currently honored by
+    // SystemDictionary::LookupPredictive(); other traversers treat the
+    // limits as advisory and may ignore them.
+    virtual PredictiveLimit GetPredictiveLimit() {
+      return PredictiveLimit();
+    }
+
+    // Called back when a predictive traversal stopped before every key
+    // below the looked up key was visited, e.g. because a traverser cap
+    // or a token budget fired.  Not called when the callback itself ends
+    // the traversal by returning TRAVERSE_DONE.  Callbacks that cache
+    // the results as the complete set below a key must treat such a
+    // lookup as partial.
+    virtual void OnTruncated() {}
+
     // Called back when key is found.
     virtual ResultType OnKey(StringPiece key) {
       return TRAVERSE_CONTINUE;
@@ -104,6 +144,19 @@ class DictionaryInterface {
       return TRAVERSE_CONTINUE;
     }
 
+    // Variant of OnToken() for traversers that re-fill |token_info| from
+    // scratch before every call: the callback may take over the token's
+    // string buffers (e.g. by swapping them into its own storage) instead
+    // of copying them.  The default implementation forwards to OnToken(),
+    // so ordinary callbacks only need to override OnToken().  Traversers
+    // that carry state in the token across calls must keep calling
+    // OnToken() directly.
+    virtual ResultType OnConsumableToken(StringPiece key,
+                                         StringPiece expanded_key,
+                                         Token *token_info) {
+      return OnToken(key, expanded_key, *token_info);
+    }
+
    protected:
     Callback() {}
   };
@@ -43,6 +43,7 @@
         'user_dictionary_importer_test.cc',
         'user_dictionary_session_handler_test.cc',
         'user_dictionary_session_test.cc',
+        'user_dictionary_snapshot_test.cc',
         'user_dictionary_storage_test.cc',
         'user_dictionary_test.cc',
         'user_dictionary_util_test.cc',
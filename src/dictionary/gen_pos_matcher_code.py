@@ -127,9 +127,15 @@ def OutputPosMatcherHeader(pos_matcher, output):
 
   lid_table_size = len(pos_matcher.GetRuleNameList())
 
+  # IsXXX() methods are dispatched through one bit per rule in the mask
+  # table; see BuildMaskTable() below.
+  assert lid_table_size <= 64, (
+      'POSMatcher supports up to 64 matching rules: got %d' % lid_table_size)
+
   output.write(
       '#ifndef MOZC_DICTIONARY_POS_MATCHER_H_\n'
       '#define MOZC_DICTIONARY_POS_MATCHER_H_\n'
+      '#include <vector>\n'
       '#include "./base/port.h"\n'
       'namespace mozc {\n'
       'namespace dictionary {\n'
@@ -147,22 +153,15 @@ def OutputPosMatcherHeader(pos_matcher, output):
             })
 
   # Helper function to generate Is<RuleName>(uint16 id) method from rule name
-  # and its corresponding index. The generated function checks if the given id
-  # belongs to some range in kRangeTable[index] = kRangeTable_RuleName[].
+  # and its corresponding index. The generated function tests bit |index| of
+  # the mask table entry for |id|; see BuildMaskTable() for the table layout.
   def _GenerateIsMethod(rule_name, index):
     return ('  inline bool Is%(rule_name)s(uint16 id) const {\n'
-            '    const uint16 offset = data_[%(lid_table_size)d + %(index)d];\n'
-            '    for (const uint16 *ptr = data_ + offset;\n'
-            '         *ptr != static_cast<uint16>(0xFFFF); ptr += 2) {\n'
-            '      if (id >= *ptr && id <= *(ptr + 1)) {\n'
-            '        return true;\n'
-            '      }\n'
-            '    }\n'
-            '    return false;\n'
+            '    return id < mask_table_.size() &&\n'
+            '           ((mask_table_[id] >> %(index)d) & 1) != 0;\n'
             '  }' % {
                 'rule_name': rule_name,
                 'index': index,
-                'lid_table_size': lid_table_size,
             })
 
   # Generate Get<RuleName>Id() and Is<RuleName>(uint16 id) for each rule.
@@ -181,14 +180,46 @@ def OutputPosMatcherHeader(pos_matcher, output):
   output.write(
       ' public:\n'
       '  POSMatcher() : data_(nullptr) {}\n'
-      '  explicit POSMatcher(const uint16 *data) : data_(data) {}\n'
-      '  void Set(const uint16 *data) { data_ = data; }\n'
+      '  explicit POSMatcher(const uint16 *data) : data_(data) {\n'
+      '    BuildMaskTable();\n'
+      '  }\n'
+      '  void Set(const uint16 *data) {\n'
+      '    data_ = data;\n'
+      '    BuildMaskTable();\n'
+      '  }\n'
       ' private:\n'
+      '  static const size_t kNumRules = %(lid_table_size)d;\n'
+      '  // Flattens the POS ID ranges in |data_| into a bitset indexed by POS\n'
+      '  // ID: bit |i| of mask_table_[id] is set iff |id| belongs to one of\n'
+      '  // the ranges of rule |i|.  IsXXX() methods are called per node in\n'
+      '  // the converter, so they test a single bit instead of scanning the\n'
+      '  // range table on every call.  The table is built once here so that\n'
+      '  // any POS data set at runtime keeps working.\n'
+      '  void BuildMaskTable() {\n'
+      '    mask_table_.clear();\n'
+      '    if (data_ == nullptr) {\n'
+      '      return;\n'
+      '    }\n'
+      '    for (size_t rule = 0; rule < kNumRules; ++rule) {\n'
+      '      const uint16 offset = data_[kNumRules + rule];\n'
+      '      for (const uint16 *ptr = data_ + offset;\n'
+      '           *ptr != static_cast<uint16>(0xFFFF); ptr += 2) {\n'
+      '        if (*(ptr + 1) >= mask_table_.size()) {\n'
+      '          mask_table_.resize(*(ptr + 1) + 1, 0);\n'
+      '        }\n'
+      '        for (uint16 id = *ptr; id <= *(ptr + 1); ++id) {\n'
+      '          mask_table_[id] |= static_cast<uint64>(1) << rule;\n'
+      '        }\n'
+      '      }\n'
+      '    }\n'
+      '  }\n'
       '  const uint16 *data_;\n'
+      '  std::vector<uint64> mask_table_;\n'
       '};\n'
       '}  // namespace dictionary\n'
       '}  // namespace mozc\n'
-      '#endif  // MOZC_DICTIONARY_POS_MATCHER_H_\n')
+      '#endif  // MOZC_DICTIONARY_POS_MATCHER_H_\n'
+      % {'lid_table_size': lid_table_size})
 
 
 def ParseOptions():
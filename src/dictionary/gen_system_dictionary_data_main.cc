@@ -42,6 +42,7 @@
 #include "base/flags.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/number_util.h"
 #include "base/util.h"
 #include "data_manager/data_manager.h"
 #include "dictionary/dictionary_token.h"
@@ -52,6 +53,10 @@
 DEFINE_string(input, "", "space separated input text files");
 DEFINE_string(user_pos_manager_data, "", "user pos manager data");
 DEFINE_string(output, "", "output binary file");
+DEFINE_string(key_frequency_file, "",
+              "TSV file of reading and its occurrence count in a corpus "
+              "(count is optional and defaults to 1). When given, the key "
+              "trie orders siblings by access frequency.");
 
 namespace mozc {
 namespace {
@@ -87,6 +92,30 @@ void GetInputFileName(const string &input_file,
   }
 }
 
+// Feed the corpus histogram in |file| to |builder|.  Each line has a reading
+// and optionally a tab separated occurrence count.
+void LoadKeyFrequency(const string &file,
+                      dictionary::SystemDictionaryBuilder *builder) {
+  InputFileStream ifs(file.c_str());
+  CHECK(ifs.good()) << "Cannot open " << file;
+  string line;
+  std::vector<StringPiece> fields;
+  while (std::getline(ifs, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    fields.clear();
+    Util::SplitStringUsing(line, "\t", &fields);
+    uint64 count = 1;
+    if (fields.size() >= 2 && !NumberUtil::SafeStrToUInt64(fields[1], &count)) {
+      LOG(WARNING) << "Invalid count: " << line;
+      continue;
+    }
+    builder->AddKeyFrequency(string(fields[0].data(), fields[0].size()),
+                             count);
+  }
+}
+
 }  // namespace
 }  // namespace mozc
 
@@ -114,6 +143,9 @@ int main(int argc, char **argv) {
   loader.Load(system_dictionary_input, reading_correction_input);
 
   mozc::dictionary::SystemDictionaryBuilder builder;
+  if (!FLAGS_key_frequency_file.empty()) {
+    mozc::LoadKeyFrequency(FLAGS_key_frequency_file, &builder);
+  }
   builder.BuildFromTokens(loader.tokens());
 
   std::unique_ptr<std::ostream> output_stream(new mozc::OutputFileStream(
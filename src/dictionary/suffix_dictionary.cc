@@ -64,6 +64,18 @@ SuffixDictionary::SuffixDictionary(StringPiece key_array_data,
   DCHECK(token_array_);
   key_array_.Set(key_array_data);
   value_array_.Set(value_array_data);
+
+  // Count the keys per first byte and convert the counts to boundaries.
+  // The key array is sorted, so each bucket is a contiguous range.
+  buckets_.assign(257, 0);
+  for (size_t i = 0; i < key_array_.size(); ++i) {
+    const StringPiece key = key_array_[i];
+    const uint8 lead = key.empty() ? 0 : static_cast<uint8>(key[0]);
+    ++buckets_[lead + 1];
+  }
+  for (int b = 0; b < 256; ++b) {
+    buckets_[b + 1] += buckets_[b];
+  }
 }
 
 SuffixDictionary::~SuffixDictionary() {}
@@ -91,9 +103,18 @@ void SuffixDictionary::LookupPredictive(
     const ConversionRequest &conversion_request,
     Callback *callback) const {
   using Iter = SerializedStringArray::const_iterator;
-  std::pair<Iter, Iter> range = std::equal_range(key_array_.begin(),
-                                            key_array_.end(),
-                                            key, ComparePrefix(key.size()));
+  // Any key having |key| as a prefix shares its first byte, so only the
+  // bucket of that byte has to be searched.  The zero query (empty |key|)
+  // matches every suffix and skips the binary search entirely.
+  Iter begin = key_array_.begin();
+  Iter end = key_array_.end();
+  if (!key.empty()) {
+    const uint8 lead = static_cast<uint8>(key[0]);
+    end = begin + buckets_[lead + 1];
+    begin += buckets_[lead];
+  }
+  std::pair<Iter, Iter> range =
+      std::equal_range(begin, end, key, ComparePrefix(key.size()));
   Token token;
   token.attributes = Token::NONE;  // Common for all suffix tokens.
   for (; range.first != range.second; ++range.first) {
@@ -119,7 +140,9 @@ void SuffixDictionary::LookupPredictive(
     token.lid = token_array_[3 * index];
     token.rid = token_array_[3 * index + 1];
     token.cost = token_array_[3 * index + 2];
-    if (callback->OnToken(token.key, token.key, token) !=
+    // |token| is re-filled from scratch on every iteration, so the callback
+    // may consume its string buffers.
+    if (callback->OnConsumableToken(token.key, token.key, &token) !=
         Callback::TRAVERSE_CONTINUE) {
       break;
     }
@@ -30,6 +30,8 @@
 #ifndef MOZC_DICTIONARY_SUFFIX_DICTIONARY_H_
 #define MOZC_DICTIONARY_SUFFIX_DICTIONARY_H_
 
+#include <vector>
+
 #include "base/port.h"
 #include "base/serialized_string_array.h"
 #include "base/string_piece.h"
@@ -79,6 +81,12 @@ class SuffixDictionary : public DictionaryInterface {
   SerializedStringArray key_array_;
   SerializedStringArray value_array_;
   const uint32 *token_array_;
+  // Bucket index over the sorted key array: keys sharing the same first
+  // byte are contiguous, and buckets_[b] is the index of the first key
+  // whose first byte is b (buckets_[b + 1] is one past the last), so
+  // LookupPredictive binary-searches only within one bucket.
+  // buckets_[256] == key_array_.size().
+  std::vector<uint32> buckets_;
 
   DISALLOW_COPY_AND_ASSIGN(SuffixDictionary);
 };
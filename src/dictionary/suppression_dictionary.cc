@@ -29,6 +29,9 @@
 
 #include "dictionary/suppression_dictionary.h"
 
+#include <memory>
+#include <unordered_set>
+
 #include "base/logging.h"
 #include "base/mutex.h"
 
@@ -38,13 +41,24 @@ namespace {
 const char kDelimiter = '\t';
 }  // namespace
 
+// Immutable once published; see the class comment in the header.
+struct SuppressionDictionary::Snapshot {
+  Snapshot() : has_key_empty(false), has_value_empty(false) {}
+
+  std::unordered_set<string> dic;
+  bool has_key_empty;
+  bool has_value_empty;
+};
+
 SuppressionDictionary::SuppressionDictionary()
-    : locked_(false), has_key_empty_(false), has_value_empty_(false) {}
+    : snapshot_(std::make_shared<Snapshot>()), locked_(false) {}
 
 SuppressionDictionary::~SuppressionDictionary() {}
 
 bool SuppressionDictionary::AddEntry(
     const string &key, const string &value) {
+  scoped_lock l(&mutex_);
+
   if (!locked_) {
     LOG(ERROR) << "Dictionary is not locked";
     return false;
@@ -56,74 +70,80 @@ bool SuppressionDictionary::AddEntry(
   }
 
   if (key.empty()) {
-    has_key_empty_ = true;
+    pending_->has_key_empty = true;
   }
 
   if (value.empty()) {
-    has_value_empty_ = true;
+    pending_->has_value_empty = true;
   }
 
-  dic_.insert(key + kDelimiter + value);
+  pending_->dic.insert(key + kDelimiter + value);
 
   return true;
 }
 
 void SuppressionDictionary::Clear() {
+  scoped_lock l(&mutex_);
   if (!locked_) {
     LOG(ERROR) << "Dictionary is not locked";
     return;
   }
-  has_key_empty_ = false;
-  has_value_empty_ = false;
-  dic_.clear();
+  pending_->has_key_empty = false;
+  pending_->has_value_empty = false;
+  pending_->dic.clear();
 }
 
 void SuppressionDictionary::Lock() {
   scoped_lock l(&mutex_);
+  if (locked_) {
+    // Overlapping Lock()/UnLock() pairs share one pending copy, as they
+    // shared one mutable dictionary before the snapshot design.
+    return;
+  }
+  pending_ = std::make_shared<Snapshot>(*std::atomic_load(&snapshot_));
   locked_ = true;
 }
 
 void SuppressionDictionary::UnLock() {
   scoped_lock l(&mutex_);
   locked_ = false;
+  if (pending_ != nullptr) {
+    std::atomic_store(&snapshot_,
+                      std::shared_ptr<const Snapshot>(std::move(pending_)));
+    pending_.reset();
+  }
 }
 
 bool SuppressionDictionary::IsEmpty() const {
-  if (locked_) {
-    return true;
-  }
-  return dic_.empty();
+  return std::atomic_load(&snapshot_)->dic.empty();
 }
 
 bool SuppressionDictionary::SuppressEntry(
     const string &key, const string &value) const {
-  if (dic_.empty()) {
+  const std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&snapshot_);
+
+  if (snapshot->dic.empty()) {
     // Almost all users don't use word supresssion function.
     // We can return false as early as possible
     return false;
   }
 
-  if (locked_) {
-    VLOG(2) << "Dictionary is locked now";
-    return false;
-  }
-
   string lookup_key = key;
   lookup_key.append(1, kDelimiter).append(value);
-  if (dic_.find(lookup_key) != dic_.end()) {
+  if (snapshot->dic.find(lookup_key) != snapshot->dic.end()) {
     return true;
   }
 
-  if (has_key_empty_) {
+  if (snapshot->has_key_empty) {
     lookup_key.assign(1, kDelimiter).append(value);
-    if (dic_.find(lookup_key) != dic_.end()) {
+    if (snapshot->dic.find(lookup_key) != snapshot->dic.end()) {
       return true;
     }
   }
 
-  if (has_value_empty_) {
+  if (snapshot->has_value_empty) {
     lookup_key.assign(key).append(1, kDelimiter);
-    if (dic_.find(lookup_key) != dic_.end()) {
+    if (snapshot->dic.find(lookup_key) != snapshot->dic.end()) {
       return true;
     }
   }
@@ -30,7 +30,7 @@
 #ifndef MOZC_DICTIONARY_SUPPRESSION_DICTIONARY_H_
 #define MOZC_DICTIONARY_SUPPRESSION_DICTIONARY_H_
 
-#include <set>
+#include <memory>
 #include <string>
 
 #include "base/mutex.h"
@@ -39,6 +39,12 @@
 namespace mozc {
 namespace dictionary {
 
+// The dictionary content is published as an immutable snapshot: writers
+// edit a private copy between Lock() and UnLock(), and UnLock() installs
+// the copy atomically.  Readers always look up the currently published
+// snapshot without taking any lock, so conversion threads are never
+// serialized against dictionary updates; they just keep seeing the
+// previous content until UnLock().
 class SuppressionDictionary {
  public:
   SuppressionDictionary();
@@ -46,13 +52,10 @@ class SuppressionDictionary {
 
   // Locks dictionary.
   // Need to lock before calling AddEntry() or Clear().
-  // When the dictionary is locked, Supress() return false.
-  //
-  // NOTE:
-  // Lock() and SupressWord() must be called synchronously.
+  // Edits are not visible to readers until UnLock() is called.
   void Lock();
 
-  // Unlocks dictionary.
+  // Unlocks dictionary and publishes the edits made since Lock().
   void UnLock();
 
   // Returns true if the dictionary is locked.
@@ -60,25 +63,30 @@ class SuppressionDictionary {
     return locked_;
   }
 
-  // Note: this method is thread unsafe.
+  // Adds a word to the dictionary.  Must be called while locked.
   bool AddEntry(const string &key, const string &value);
 
-  // Note: this method is thread unsafe.
+  // Removes all words from the dictionary.  Must be called while locked.
   void Clear();
 
   // Returns true if SuppressionDictionary doesn't have any entries.
+  // Edits that are not yet published with UnLock() don't count.
   bool IsEmpty() const;
 
-  // Returns true if |word| should be suppressed.  If the current dictionay is
-  // "locked" via Lock() method, this function always return false.  Lock() and
-  // SuppressWord() must be called synchronously.
+  // Returns true if |word| should be suppressed.  Wait-free; lookups run
+  // against the published snapshot regardless of the lock state.
   bool SuppressEntry(const string &key, const string &value) const;
 
  private:
-  std::set<string> dic_;
+  struct Snapshot;
+
+  // The published snapshot; read with atomic_load, replaced with
+  // atomic_store in UnLock().
+  std::shared_ptr<const Snapshot> snapshot_;
+  // The copy being edited; non-null only between Lock() and the UnLock()
+  // that publishes it.  Guarded by |mutex_|.
+  std::shared_ptr<Snapshot> pending_;
   bool locked_;
-  bool has_key_empty_;
-  bool has_value_empty_;
   Mutex mutex_;
 
   DISALLOW_COPY_AND_ASSIGN(SuppressionDictionary);
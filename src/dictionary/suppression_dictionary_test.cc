@@ -52,7 +52,7 @@ TEST(SupressionDictionary, BasicTest) {
     EXPECT_FALSE(dic->AddEntry("test", "test"));
 
     dic->Lock();
-    // IsEmpty() returns always true when dic is locked
+    // Entries are not visible to IsEmpty() until UnLock() publishes them.
     EXPECT_TRUE(dic->IsEmpty());
     EXPECT_FALSE(dic->AddEntry("", ""));
     EXPECT_TRUE(dic->AddEntry("key1", "value1"));
@@ -70,9 +70,10 @@ TEST(SupressionDictionary, BasicTest) {
     // Not locked
     EXPECT_FALSE(dic->AddEntry("test", "test"));
 
-    // locked now => SuppressEntry always returns false
+    // SuppressEntry() keeps looking up the published snapshot while the
+    // dictionary is locked for edits.
     dic->Lock();
-    EXPECT_FALSE(dic->SuppressEntry("key1", "value1"));
+    EXPECT_TRUE(dic->SuppressEntry("key1", "value1"));
     dic->UnLock();
 
     EXPECT_TRUE(dic->SuppressEntry("key1", "value1"));
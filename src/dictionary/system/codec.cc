@@ -29,6 +29,7 @@
 
 #include "dictionary/system/codec.h"
 
+#include <cstring>
 #include <sstream>
 
 #include "base/logging.h"
@@ -76,6 +77,7 @@ const char kKeySectionName[] = "k";
 const char kValueSectionName[] = "v";
 const char kTokensSectionName[] = "t";
 const char kPosSectionName[] = "p";
+const char kReverseLookupIndexSectionName[] = "r";
 
 //// Constants for validation ////
 // 12 bits
@@ -213,6 +215,11 @@ const string SystemDictionaryCodec::GetSectionNameForPos() const {
   return kPosSectionName;
 }
 
+const string SystemDictionaryCodec::GetSectionNameForReverseLookupIndex()
+    const {
+  return kReverseLookupIndexSectionName;
+}
+
 void SystemDictionaryCodec::EncodeKey(
     const StringPiece src, string *dst) const {
   EncodeDecodeKeyImpl(src, dst);
@@ -233,6 +240,91 @@ size_t SystemDictionaryCodec::GetDecodedKeyLength(
   return GetEncodedDecodedKeyLengthImpl(src);
 }
 
+namespace {
+
+// Table-driven fast paths for the value codec; see the encoding comment
+// above EncodeValue() for the encoding itself.
+//
+// The decode table maps each lead byte of the encoded stream to its
+// encoded length and, for the 1-byte kana codes, the fully precomputed
+// UTF-8 sequence, so that runs of kana -- the dominant content of values
+// -- are decoded with one table load and a 3-byte copy per character
+// instead of a branch chain plus a UCS4-to-UTF-8 conversion.  Lead bytes
+// of the rare escape marks keep encoded_length 0 and take the generic
+// branch chain.
+struct ValueDecodeEntry {
+  // 1: 1-byte kana code, UTF-8 precomputed in |utf8|.
+  // 2: frequent kanji, the character is |ucs4_base| + the trail byte.
+  // 0: escape marks and other rare codes; generic path.
+  uint8 encoded_length;
+  uint8 utf8_length;
+  char utf8[3];
+  char32 ucs4_base;
+};
+
+class ValueDecodeTable {
+ public:
+  ValueDecodeTable() {
+    memset(entries_, 0, sizeof(entries_));
+    for (int b = kValueHiraganaOffset; b < kValueKatakanaOffset; ++b) {
+      SetPrecomputedUtf8(b, 0x3041 + b - kValueHiraganaOffset);
+    }
+    for (int b = kValueKatakanaOffset; b < kValueCharMarkAscii; ++b) {
+      SetPrecomputedUtf8(b, 0x30a1 + b - kValueKatakanaOffset);
+    }
+    for (int b = kValueKanjiOffset; b < kValueHiraganaOffset; ++b) {
+      entries_[b].encoded_length = 2;
+      entries_[b].ucs4_base = 0x4e00 + ((b - kValueKanjiOffset) << 8);
+    }
+  }
+
+  const ValueDecodeEntry &Get(uint8 lead_byte) const {
+    return entries_[lead_byte];
+  }
+
+ private:
+  void SetPrecomputedUtf8(int lead_byte, char32 c) {
+    string utf8;
+    Util::UCS4ToUTF8(c, &utf8);
+    DCHECK_EQ(3, utf8.size());  // Kana is always 3 bytes in UTF-8.
+    entries_[lead_byte].encoded_length = 1;
+    entries_[lead_byte].utf8_length = utf8.size();
+    memcpy(entries_[lead_byte].utf8, utf8.data(), utf8.size());
+  }
+
+  ValueDecodeEntry entries_[256];
+};
+
+// Character classes of EncodeValue() by the high byte of a BMP character.
+// The table replaces most of the encode branch chain with one load; the
+// dominant classes (kana and frequent kanji) then resolve with at most two
+// further compares.
+enum ValueCharClass {
+  VALUE_CHAR_GENERIC = 0,  // Escape mark encodings; take the branch chain.
+  VALUE_CHAR_KANA_PAGE,    // High byte 0x30: hiragana and katakana live here.
+  VALUE_CHAR_KANJI_PAGE,   // High byte 0x4e..0x97: 2-byte kanji encoding.
+};
+
+class ValueEncodeClassTable {
+ public:
+  ValueEncodeClassTable() {
+    memset(classes_, VALUE_CHAR_GENERIC, sizeof(classes_));
+    classes_[0x30] = VALUE_CHAR_KANA_PAGE;
+    for (int h = 0x4e; h < 0x98; ++h) {
+      classes_[h] = VALUE_CHAR_KANJI_PAGE;
+    }
+  }
+
+  ValueCharClass GetClass(uint8 high_byte) const {
+    return static_cast<ValueCharClass>(classes_[high_byte]);
+  }
+
+ private:
+  uint8 classes_[256];
+};
+
+}  // namespace
+
 // This encodes each UCS4 character into following areas
 // The trickier part in this encoding is handling of \0 byte in UCS4
 // character. To avoid \0 in converted string, this function uses
@@ -248,10 +340,39 @@ size_t SystemDictionaryCodec::GetDecodedKeyLength(
 void SystemDictionaryCodec::EncodeValue(
     const StringPiece src, string *dst) const {
   DCHECK(dst);
+  const ValueEncodeClassTable *table =
+      Singleton<ValueEncodeClassTable>::get();
   for (ConstChar32Iterator iter(src); !iter.Done(); iter.Next()) {
     static_assert(sizeof(uint32) == sizeof(char32),
                   "char32 must be 32-bit integer size.");
     const uint32 c = iter.Get();
+    if (c < 0x10000) {
+      switch (table->GetClass(c >> 8)) {
+        case VALUE_CHAR_KANA_PAGE:
+          if (c >= 0x3041 && c < 0x3095) {
+            // Hiragana(85 characters) are encoded into 1 byte.
+            dst->push_back(c - 0x3041 + kValueHiraganaOffset);
+            continue;
+          }
+          if (c >= 0x30a1 && c < 0x30fd) {
+            // Katakana (92 characters) are encoded into 1 byte.
+            dst->push_back(c - 0x30a1 + kValueKatakanaOffset);
+            continue;
+          }
+          break;
+        case VALUE_CHAR_KANJI_PAGE:
+          // Frequent kanji: 2 bytes unless the low byte is 0, which must
+          // use the XX00 mark below to avoid \0 in the encoded image.
+          if ((c & 255) != 0) {
+            dst->push_back(((c - 0x4e00) >> 8) + kValueKanjiOffset);
+            dst->push_back(c & 255);
+            continue;
+          }
+          break;
+        case VALUE_CHAR_GENERIC:
+          break;
+      }
+    }
     if (c >= 0x3041 && c < 0x3095) {
       // Hiragana(85 characters) are encoded into 1 byte.
       dst->push_back(c - 0x3041 + kValueHiraganaOffset);
@@ -305,20 +426,44 @@ void SystemDictionaryCodec::EncodeValue(
 void SystemDictionaryCodec::DecodeValue(
     const StringPiece src, string *dst) const {
   DCHECK(dst);
+  const ValueDecodeTable *table = Singleton<ValueDecodeTable>::get();
   const uint8 *p = reinterpret_cast<const uint8 *>(src.data());
   const uint8 *const end = p + src.size();
   while (p < end) {
+    const ValueDecodeEntry &entry = table->Get(p[0]);
+    if (entry.encoded_length == 1) {
+      // A run of 1-byte kana codes.  Copy the precomputed UTF-8 sequences
+      // into a local buffer and append them in one call per run.
+      char buffer[48];
+      size_t length = 0;
+      do {
+        const ValueDecodeEntry &e = table->Get(p[0]);
+        if (e.encoded_length != 1) {
+          break;
+        }
+        memcpy(buffer + length, e.utf8, 3);
+        length += e.utf8_length;
+        ++p;
+      } while (p < end && length + 3 <= sizeof(buffer));
+      dst->append(buffer, length);
+      continue;
+    }
+    if (entry.encoded_length == 2 && p + 1 < end) {
+      // Frequent kanji (0x4e00~0x97ff) is always 3 bytes in UTF-8.
+      const char32 c = entry.ucs4_base + p[1];
+      const char utf8[3] = {
+          static_cast<char>(0xe0 | (c >> 12)),
+          static_cast<char>(0x80 | ((c >> 6) & 0x3f)),
+          static_cast<char>(0x80 | (c & 0x3f)),
+      };
+      dst->append(utf8, 3);
+      p += 2;
+      continue;
+    }
+    // Escape marks and truncated input; decode one character at a time.
     int cc = p[0];
     int c = 0;
-    if (kValueHiraganaOffset <= cc && cc < kValueKatakanaOffset) {
-      // Hiragana
-      c = 0x3041 + p[0] - kValueHiraganaOffset;
-      p += 1;
-    } else if (kValueKatakanaOffset <= cc && cc < kValueCharMarkAscii) {
-      // Katakana
-      c = 0x30a1 + p[0] - kValueKatakanaOffset;
-      p += 1;
-    } else if (cc == kValueCharMarkAscii) {
+    if (cc == kValueCharMarkAscii) {
       // Ascii
       c = p[1];
       p += 2;
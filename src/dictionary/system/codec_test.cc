@@ -319,6 +319,7 @@ class SystemDictionaryCodecMock : public SystemDictionaryCodecInterface {
   const string GetSectionNameForValue() const { return "Mock"; }
   const string GetSectionNameForTokens() const { return "Mock"; }
   const string GetSectionNameForPos() const { return "Mock"; }
+  const string GetSectionNameForReverseLookupIndex() const { return "Mock"; }
   virtual void EncodeKey(const StringPiece src, string *dst) const {}
   virtual void DecodeKey(const StringPiece src, string *dst) const {}
   virtual size_t GetEncodedKeyLength(const StringPiece src) const { return 0; }
@@ -408,6 +409,25 @@ TEST_F(SystemDictionaryCodecTest, ValueCodecKanaTest) {
   EXPECT_EQ(original, decoded);
 }
 
+TEST_F(SystemDictionaryCodecTest, ValueCodecLongKanaRunTest) {
+  SystemDictionaryCodecInterface *codec =
+      SystemDictionaryCodecFactory::GetCodec();
+  // A kana run long enough to cross the internal decode run buffer
+  // several times, with kanji and ascii interleaved at the boundaries.
+  string original;
+  for (int i = 0; i < 100; ++i) {
+    original.append("もじれつジ");
+    if (i % 10 == 0) {
+      original.append("漢a");
+    }
+  }
+  string encoded;
+  codec->EncodeValue(original, &encoded);
+  string decoded;
+  codec->DecodeValue(encoded, &decoded);
+  EXPECT_EQ(original, decoded);
+}
+
 TEST_F(SystemDictionaryCodecTest, ValueCodecAsciiTest) {
   SystemDictionaryCodecInterface *codec =
       SystemDictionaryCodecFactory::GetCodec();
@@ -47,6 +47,7 @@
 #include "dictionary/system/system_dictionary.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <limits>
 #include <map>
@@ -56,9 +57,12 @@
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/port.h"
+#include "base/shared_memory.h"
 #include "base/string_piece.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
@@ -67,6 +71,7 @@
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/token_decode_iterator.h"
 #include "dictionary/system/words_info.h"
+#include "storage/cache_budget_manager.h"
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
 
@@ -88,12 +93,18 @@ const size_t kKeyTrieLb1CacheSize = 1 * 1024;
 const size_t kKeyTrieSelect0CacheSize = 4 * 1024;
 const size_t kKeyTrieSelect1CacheSize = 4 * 1024;
 const size_t kKeyTrieTermvecCacheSize = 1 * 1024;
+// The codec encodes one kana into one byte, so three levels of decoded
+// adjacency cache cover the first three characters of every lookup key.
+const size_t kKeyTrieChildCacheLevels = 3;
 
 const size_t kValueTrieLb0CacheSize = 1 * 1024;
 const size_t kValueTrieLb1CacheSize = 1 * 1024;
 const size_t kValueTrieSelect0CacheSize = 1 * 1024;
 const size_t kValueTrieSelect1CacheSize = 16 * 1024;
 const size_t kValueTrieTermvecCacheSize = 4 * 1024;
+// The value trie is mostly traversed for reverse lookup, which is less
+// frequent, so cache fewer levels.
+const size_t kValueTrieChildCacheLevels = 2;
 
 // Expansion table format:
 // "<Character to expand>[<Expanded character 1><Expanded character 2>...]"
@@ -178,6 +189,14 @@ inline const uint8 *GetTokenArrayPtr(const BitVectorBasedArray &token_array,
   return reinterpret_cast<const uint8*>(token_array.Get(key_id, &length));
 }
 
+// Issues a best-effort request to load the cache line containing |address|.
+// No-op on compilers without a prefetch builtin.
+inline void PrefetchForRead(const void *address) {
+#ifdef __GNUC__
+  __builtin_prefetch(address, 0);  // 0 means read access.
+#endif  // __GNUC__
+}
+
 // Iterator for scanning token array.
 // This iterator does not return actual token info but returns
 // id data and the position only.
@@ -305,11 +324,71 @@ class SystemDictionary::ReverseLookupCache {
   DISALLOW_COPY_AND_ASSIGN(ReverseLookupCache);
 };
 
+// Exposes |reverse_lookup_cache_| to storage::CacheBudgetManager.  The
+// cache itself is owned and mutated only by the lookup thread, so a trim
+// request from the manager merely sets a flag here; the cache is dropped
+// the next time the lookup thread is about to consult it.
+class SystemDictionary::ReverseLookupCacheClient
+    : public storage::CacheBudgetManager::Client {
+ public:
+  ReverseLookupCacheClient()
+      : used_bytes_(0), last_access_time_(0), trim_requested_(false) {}
+
+  virtual size_t UsedBytes() const {
+    return used_bytes_.load(std::memory_order_relaxed);
+  }
+
+  virtual uint64 LastAccessTime() const {
+    return last_access_time_.load(std::memory_order_relaxed);
+  }
+
+  virtual size_t ReleaseBytes(size_t bytes) {
+    trim_requested_.store(true, std::memory_order_relaxed);
+    // The whole cache is dropped, so report all of it as released.
+    return used_bytes_.exchange(0, std::memory_order_relaxed);
+  }
+
+  void Update(size_t used_bytes) {
+    used_bytes_.store(used_bytes, std::memory_order_relaxed);
+    Touch();
+  }
+
+  void Touch() {
+    last_access_time_.store(Clock::GetTime(), std::memory_order_relaxed);
+  }
+
+  bool TestAndClearTrimRequest() {
+    return trim_requested_.exchange(false, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<size_t> used_bytes_;
+  std::atomic<uint64> last_access_time_;
+  std::atomic<bool> trim_requested_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReverseLookupCacheClient);
+};
+
 class SystemDictionary::ReverseLookupIndex {
  public:
+  // Creates a zero-copy view over the precomputed index section built by
+  // SystemDictionaryBuilder::BuildReverseLookupIndexImage; see there for the
+  // layout.  |index_image| must outlive this instance.
+  ReverseLookupIndex(const uint8 *index_image, int length)
+      : index_size_(0), view_begin_(nullptr), view_results_(nullptr) {
+    const int32 *image = reinterpret_cast<const int32 *>(index_image);
+    index_size_ = static_cast<size_t>(image[0]);
+    view_begin_ = image + 2;
+    view_results_ = view_begin_ + index_size_ + 1;
+    DCHECK_EQ(static_cast<size_t>(length),
+              (2 + index_size_ + 1 + static_cast<size_t>(image[1]) * 2) *
+                  sizeof(int32));
+  }
+
   ReverseLookupIndex(
       const SystemDictionaryCodecInterface *codec,
-      const BitVectorBasedArray &token_array) {
+      const BitVectorBasedArray &token_array)
+      : view_begin_(nullptr), view_results_(nullptr) {
     // Gets id size.
     int value_id_max = -1;
     for (TokenScanIterator iter(codec, token_array);
@@ -373,6 +452,17 @@ class SystemDictionary::ReverseLookupIndex {
                      std::multimap<int, ReverseLookupResult> *result_map) {
     for (std::set<int>::const_iterator id_itr  = id_set.begin();
          id_itr != id_set.end(); ++id_itr) {
+      DCHECK_LT(static_cast<size_t>(*id_itr), index_size_);
+      if (view_begin_ != nullptr) {
+        for (int32 i = view_begin_[*id_itr];
+             i < view_begin_[*id_itr + 1]; ++i) {
+          ReverseLookupResult result;
+          result.tokens_offset = view_results_[2 * i];
+          result.id_in_key_trie = view_results_[2 * i + 1];
+          result_map->insert(std::make_pair(*id_itr, result));
+        }
+        continue;
+      }
       const ReverseLookupResultArray &result_array = index_[*id_itr];
       for (size_t i = 0; i < result_array.size; ++i) {
         result_map->insert(std::make_pair(*id_itr, result_array.results[i]));
@@ -391,9 +481,14 @@ class SystemDictionary::ReverseLookupIndex {
   };
 
   // Use scoped array for reducing memory consumption as possible.
+  // Not used when this index is a view over a precomputed section.
   std::unique_ptr<ReverseLookupResultArray[]> index_;
   size_t index_size_;
 
+  // Set only when this index is a view over a precomputed section.
+  const int32 *view_begin_;
+  const int32 *view_results_;
+
   DISALLOW_COPY_AND_ASSIGN(ReverseLookupIndex);
 };
 
@@ -493,7 +588,8 @@ SystemDictionary *SystemDictionary::Builder::Build() {
   }
 
   if (!instance->OpenDictionaryFile(
-          (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0)) {
+          (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0,
+          (spec_->options & SHARE_RANK_DIRECTORIES) != 0)) {
     LOG(ERROR) << "Failed to create system dictionary";
     return nullptr;
   }
@@ -506,39 +602,59 @@ SystemDictionary::SystemDictionary(
     const DictionaryFileCodecInterface *file_codec)
     : frequent_pos_(nullptr),
       codec_(codec),
-      dictionary_file_(new DictionaryFile(file_codec)) {}
+      dictionary_file_(new DictionaryFile(file_codec)),
+      reverse_lookup_cache_client_(new ReverseLookupCacheClient) {
+  storage::CacheBudgetManager::GetInstance()->Register(
+      "SystemDictionary:ReverseLookupCache",
+      reverse_lookup_cache_client_.get());
+}
 
-SystemDictionary::~SystemDictionary() {}
+SystemDictionary::~SystemDictionary() {
+  storage::CacheBudgetManager::GetInstance()->Unregister(
+      reverse_lookup_cache_client_.get());
+}
 
-bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
+bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index,
+                                          bool share_rank_directories) {
   int len;
 
+  int key_image_len = 0;
   const uint8 *key_image = reinterpret_cast<const uint8 *>(
-      dictionary_file_->GetSection(codec_->GetSectionNameForKey(), &len));
-  if (!key_trie_.Open(key_image,
-                      kKeyTrieLb0CacheSize,
-                      kKeyTrieLb1CacheSize,
-                      kKeyTrieSelect0CacheSize,
-                      kKeyTrieSelect1CacheSize,
-                      kKeyTrieTermvecCacheSize)) {
-    LOG(ERROR) << "cannot open key trie";
-    return false;
+      dictionary_file_->GetSection(codec_->GetSectionNameForKey(),
+                                   &key_image_len));
+  int value_image_len = 0;
+  const uint8 *value_image = reinterpret_cast<const uint8 *>(
+      dictionary_file_->GetSection(codec_->GetSectionNameForValue(),
+                                   &value_image_len));
+
+  if (!share_rank_directories ||
+      !OpenTriesWithSharedRankDirectories(key_image, key_image_len,
+                                          value_image, value_image_len)) {
+    // Private rank directories on the heap.
+    if (!key_trie_.Open(key_image,
+                        kKeyTrieLb0CacheSize,
+                        kKeyTrieLb1CacheSize,
+                        kKeyTrieSelect0CacheSize,
+                        kKeyTrieSelect1CacheSize,
+                        kKeyTrieTermvecCacheSize,
+                        kKeyTrieChildCacheLevels)) {
+      LOG(ERROR) << "cannot open key trie";
+      return false;
+    }
+    if (!value_trie_.Open(value_image,
+                          kValueTrieLb0CacheSize,
+                          kValueTrieLb1CacheSize,
+                          kValueTrieSelect0CacheSize,
+                          kValueTrieSelect1CacheSize,
+                          kValueTrieTermvecCacheSize,
+                          kValueTrieChildCacheLevels)) {
+      LOG(ERROR) << "can not open value trie";
+      return false;
+    }
   }
 
   BuildHiraganaExpansionTable(*codec_, &hiragana_expansion_table_);
 
-  const uint8 *value_image = reinterpret_cast<const uint8 *>(
-      dictionary_file_->GetSection(codec_->GetSectionNameForValue(), &len));
-  if (!value_trie_.Open(value_image,
-                        kValueTrieLb0CacheSize,
-                        kValueTrieLb1CacheSize,
-                        kValueTrieSelect0CacheSize,
-                        kValueTrieSelect1CacheSize,
-                        kValueTrieTermvecCacheSize)) {
-    LOG(ERROR) << "can not open value trie";
-    return false;
-  }
-
   const unsigned char *token_image = reinterpret_cast<const unsigned char *>(
       dictionary_file_->GetSection(codec_->GetSectionNameForTokens(), &len));
   token_array_.Open(token_image);
@@ -557,10 +673,84 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
   return true;
 }
 
+bool SystemDictionary::OpenTriesWithSharedRankDirectories(
+    const uint8 *key_image, int key_image_len,
+    const uint8 *value_image, int value_image_len) {
+  const size_t key_directory_size =
+      storage::louds::LoudsTrie::SharedRankDirectorySize(key_image);
+  const size_t value_directory_size =
+      storage::louds::LoudsTrie::SharedRankDirectorySize(value_image);
+
+  // The name is keyed on a fingerprint of the trie images, so processes
+  // mapping different dictionary versions never share a segment, and a
+  // stale segment left by an older version is simply never opened again.
+  const uint64 fingerprint = Hash::FingerprintWithSeed(
+      StringPiece(reinterpret_cast<const char *>(value_image),
+                  value_image_len),
+      Hash::Fingerprint32(
+          StringPiece(reinterpret_cast<const char *>(key_image),
+                      key_image_len)));
+  const string name = Util::StringPrintf(
+      "mozc_system_dictionary_rank_directories_%" MOZC_PRIX64, fingerprint);
+
+  std::unique_ptr<SharedMemory> shared_memory(new SharedMemory);
+  if (!shared_memory->OpenOrCreate(
+          name, key_directory_size + value_directory_size)) {
+    // Either shared memory is unavailable on this platform or an existing
+    // segment has an unexpected size, which means it was left by an
+    // incompatible build; remove the name and retry once.
+    SharedMemory::Unlink(name);
+    if (!shared_memory->OpenOrCreate(
+            name, key_directory_size + value_directory_size)) {
+      LOG(WARNING) << "Cannot open shared memory for rank directories; "
+                   << "falling back to private ones";
+      return false;
+    }
+  }
+
+  // The first opener fills the directories; the others were blocked in
+  // OpenOrCreate() until MarkReady() and only read them.
+  const bool init_rank_directories = shared_memory->created();
+  key_trie_.OpenWithSharedRankDirectories(key_image,
+                                          kKeyTrieLb0CacheSize,
+                                          kKeyTrieLb1CacheSize,
+                                          kKeyTrieSelect0CacheSize,
+                                          kKeyTrieSelect1CacheSize,
+                                          kKeyTrieTermvecCacheSize,
+                                          kKeyTrieChildCacheLevels,
+                                          shared_memory->data(),
+                                          init_rank_directories);
+  value_trie_.OpenWithSharedRankDirectories(value_image,
+                                            kValueTrieLb0CacheSize,
+                                            kValueTrieLb1CacheSize,
+                                            kValueTrieSelect0CacheSize,
+                                            kValueTrieSelect1CacheSize,
+                                            kValueTrieTermvecCacheSize,
+                                            kValueTrieChildCacheLevels,
+                                            shared_memory->data() +
+                                                key_directory_size,
+                                            init_rank_directories);
+  if (init_rank_directories) {
+    shared_memory->MarkReady();
+  }
+  shared_rank_directories_ = std::move(shared_memory);
+  return true;
+}
+
 void SystemDictionary::InitReverseLookupIndex() {
   if (reverse_lookup_index_ != nullptr) {
     return;
   }
+  int len;
+  const uint8 *index_image = reinterpret_cast<const uint8 *>(
+      dictionary_file_->GetSection(
+          codec_->GetSectionNameForReverseLookupIndex(), &len));
+  if (index_image != nullptr) {
+    reverse_lookup_index_.reset(new ReverseLookupIndex(index_image, len));
+    return;
+  }
+  // Old dictionary images have no precomputed index section; build the index
+  // by scanning the token array.
   reverse_lookup_index_.reset(new ReverseLookupIndex(codec_, token_array_));
 }
 
@@ -621,10 +811,11 @@ bool SystemDictionary::HasValue(StringPiece value) const {
   return false;
 }
 
-void SystemDictionary::CollectPredictiveNodesInBfsOrder(
+bool SystemDictionary::CollectPredictiveNodesInBfsOrder(
     StringPiece encoded_key,
     const KeyExpansionTable &table,
     size_t limit,
+    size_t max_encoded_key_length,
     std::vector<PredictiveLookupSearchState> *result) const {
   std::queue<PredictiveLookupSearchState> queue;
   queue.push(PredictiveLookupSearchState(LoudsTrie::Node(), 0, false));
@@ -662,20 +853,34 @@ void SystemDictionary::CollectPredictiveNodesInBfsOrder(
     if (result->size() > limit) {
       // The current key is the longest because of BFS property.
       const size_t max_key_len = state.key_pos;
+      // Nodes flushed below are not expanded, so any child of them is a
+      // key that stays unvisited; a deeper node always leads to at least
+      // one more terminal node.
+      bool truncated =
+          key_trie_.IsValidNode(key_trie_.MoveToFirstChild(state.node));
       while (!queue.empty()) {
         state = queue.front();
         queue.pop();
         if (state.key_pos > max_key_len) {
           // Key length in the queue is monotonically increasing because of BFS
           // property.  So we don't need to check all the elements in the queue.
-          break;
+          return true;
         }
         DCHECK_EQ(state.key_pos, max_key_len);
         if (key_trie_.IsTerminalNode(state.node)) {
           result->push_back(state);
         }
+        if (!truncated) {
+          truncated =
+              key_trie_.IsValidNode(key_trie_.MoveToFirstChild(state.node));
+        }
       }
-      break;
+      return truncated;
+    }
+
+    // Do not expand keys longer than the requested bound.
+    if (state.key_pos >= max_encoded_key_length) {
+      continue;
     }
 
     // Update traversal state for children.
@@ -687,6 +892,7 @@ void SystemDictionary::CollectPredictiveNodesInBfsOrder(
                                              state.is_expanded));
     }
   } while (!queue.empty());
+  return false;
 }
 
 void SystemDictionary::LookupPredictive(
@@ -709,17 +915,47 @@ void SystemDictionary::LookupPredictive(
       conversion_request.IsKanaModifierInsensitiveConversion() ?
       hiragana_expansion_table_ : KeyExpansionTable::GetDefaultInstance();
 
-  // TODO(noriyukit): Lookup limit should be implemented at caller side by using
-  // callback mechanism.  This hard-coding limits the capability and generality
-  // of dictionary module.  CollectPredictiveNodesInBfsOrder() and the following
-  // loop for callback should be integrated for this purpose.
+  // The traversal is bounded by the tighter of the callback's request and
+  // the traditional hard-coded cap.
+  // TODO(noriyukit): CollectPredictiveNodesInBfsOrder() and the following
+  // loop for callback should be integrated so that the traversal can stop
+  // exactly when the callback is satisfied.
   const size_t kLookupLimit = 64;
+  const Callback::PredictiveLimit predictive_limit =
+      callback->GetPredictiveLimit();
+  const size_t lookup_limit = std::min(kLookupLimit, predictive_limit.max_keys);
+  if (lookup_limit == 0 || predictive_limit.max_tokens == 0) {
+    return;
+  }
+  const size_t max_encoded_key_length =
+      (predictive_limit.max_key_length_delta >= LoudsTrie::kMaxDepth)
+          ? LoudsTrie::kMaxDepth
+          : encoded_key.size() + predictive_limit.max_key_length_delta;
   std::vector<PredictiveLookupSearchState> result;
-  result.reserve(kLookupLimit);
-  CollectPredictiveNodesInBfsOrder(encoded_key, table, kLookupLimit, &result);
+  result.reserve(lookup_limit);
+  if (CollectPredictiveNodesInBfsOrder(encoded_key, table, lookup_limit,
+                                       max_encoded_key_length, &result)) {
+    // The key cap fired before the subtree was enumerated; callers
+    // caching the results as complete must not reuse them.
+    callback->OnTruncated();
+  }
+
+  // Resolve the token array block of every collected node up front.  Each
+  // resolution performs rank operations on bit vectors followed by a load
+  // from an effectively random offset in the token array, so doing them in
+  // one batch with prefetching lets the cache misses overlap instead of
+  // serializing with the token decoding below.
+  std::vector<const uint8 *> token_ptrs;
+  token_ptrs.reserve(result.size());
+  for (size_t i = 0; i < result.size(); ++i) {
+    token_ptrs.push_back(GetTokenArrayPtr(
+        token_array_, key_trie_.GetKeyIdOfTerminalNode(result[i].node)));
+    PrefetchForRead(token_ptrs.back());
+  }
 
   // Reused buffer and instances inside the following loop.
   char encoded_actual_key_buffer[LoudsTrie::kMaxDepth + 1];
+  size_t num_decoded_tokens = 0;
   string decoded_key, actual_key_str;
   decoded_key.reserve(key.size() * 2);
   actual_key_str.reserve(key.size() * 2);
@@ -772,11 +1008,20 @@ void SystemDictionary::LookupPredictive(
         break;
     }
 
-    const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
+    if (i + 1 < result.size()) {
+      // Issue the prefetch of the next block again; the up-front one may
+      // already have been evicted by the value trie lookups for earlier keys.
+      PrefetchForRead(token_ptrs[i + 1]);
+    }
     for (TokenDecodeIterator iter(codec_, value_trie_,
                                   frequent_pos_, actual_key,
-                                  GetTokenArrayPtr(token_array_, key_id));
+                                  token_ptrs[i]);
          !iter.Done(); iter.Next()) {
+      if (++num_decoded_tokens > predictive_limit.max_tokens) {
+        // The token decoding budget is spent.
+        callback->OnTruncated();
+        return;
+      }
       const TokenInfo &token_info = iter.Get();
       const Callback::ResultType result =
           callback->OnToken(decoded_key, actual_key, *token_info.token);
@@ -889,9 +1134,49 @@ class ReverseLookupCallbackWrapper : public DictionaryInterface::Callback {
   DictionaryInterface::Callback *callback_;
 };
 
+// One live trie state of the level-synchronous prefix traversal with key
+// expansion; see LookupPrefixWithKeyExpansionImpl().  |parent| is the index
+// of the state in the previous level from which this state was reached, and
+// |label| is the edge label used, so that the actually matched key can be
+// reconstructed by following the parent chain.
+struct ExpandedPrefixState {
+  ExpandedPrefixState(const storage::louds::LoudsTrie::Node &node,
+                      int parent, char label, bool is_expanded)
+      : node(node),
+        parent(parent),
+        label(label),
+        is_expanded(is_expanded),
+        culled(false) {}
+
+  storage::louds::LoudsTrie::Node node;
+  int parent;
+  char label;
+  bool is_expanded;
+  // Set when a callback returned TRAVERSE_CULL for this state, so that its
+  // children are not generated.
+  bool culled;
+};
+
 }  // namespace
 
-// Recursive implemention of depth-first prefix search with key expansion.
+// Level-synchronous implementation of prefix search with key expansion.
+//
+// All live trie states are advanced by one key character per iteration, so
+// each level of the trie is visited in a single pass in increasing node id
+// order, which keeps the accesses to the LOUDS bit vector local.  The old
+// implementation recursed per expanded branch and re-visited the bit vector
+// region of each level once per branch, which was the dominant cost of
+// kana-modifier-insensitive lookups.  Children generated from states with
+// ascending node ids have ascending node ids themselves, so the levels stay
+// sorted without sorting.  Note that in a trie every node is reached by
+// exactly one label path, so distinct states can never converge; the number
+// of states is bounded by the number of trie nodes matching the expanded
+// prefix set, which this traversal visits exactly once.
+//
+// Keys are reported in increasing length order, the same order as the
+// non-expanded RunCallbackOnEachPrefix() path (the recursive implementation
+// interleaved the branches depth first).
+//
 // Input parameters:
 //   key:
 //     The head address of the original key before applying codec.
@@ -901,98 +1186,120 @@ class ReverseLookupCallbackWrapper : public DictionaryInterface::Callback {
 //     Key expansion table.
 //   callback:
 //     A callback function to be called.
-// Parameters for recursion:
-//   node:
-//     Stores the current location in |key_trie_|.
-//   key_pos:
-//     Depth of node, i.e., encoded_key.substr(0, key_pos) is the current prefix
-//     for search.
-//   is_expanded:
-//     true is stored if the current node is reached by key expansion.
-//   actual_key_buffer:
-//     Buffer for storing actually used characters to reach this node, i.e.,
-//     StringPiece(actual_key_buffer, key_pos) is the matched prefix using key
-//     expansion.
-//   actual_prefix:
-//     A reused string for decoded actual key.  This is just for performance
-//     purpose.
 DictionaryInterface::Callback::ResultType
 SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     const char *key,
     StringPiece encoded_key,
     const KeyExpansionTable &table,
-    Callback *callback,
-    LoudsTrie::Node node,
-    StringPiece::size_type key_pos,
-    bool is_expanded,
-    char *actual_key_buffer,
-    string *actual_prefix) const {
-  // This do-block handles a terminal node and callback.  do-block is used to
-  // break the block and continue to the subsequent traversal phase.
-  do {
-    if (!key_trie_.IsTerminalNode(node)) {
+    Callback *callback) const {
+  // levels[i] holds the states reached by matching the first i characters of
+  // |encoded_key| against the trie with expansion.  All levels are kept
+  // alive so that the actually matched key of a terminal state can be
+  // reconstructed through the parent chain.
+  std::vector<std::vector<ExpandedPrefixState>> levels;
+  levels.reserve(encoded_key.size() + 1);
+  levels.emplace_back();
+  levels[0].emplace_back(LoudsTrie::Node(), -1, '\0', false);
+
+  char actual_key_buffer[LoudsTrie::kMaxDepth + 1];
+  string actual_prefix;
+  actual_prefix.reserve(encoded_key.size() * 3);
+
+  for (size_t key_pos = 0; key_pos <= encoded_key.size(); ++key_pos) {
+    std::vector<ExpandedPrefixState> &level = levels[key_pos];
+    if (level.empty()) {
       break;
     }
 
+    // Callback phase for the terminal states of this level.
     const StringPiece encoded_prefix = encoded_key.substr(0, key_pos);
     const StringPiece prefix(key, codec_->GetDecodedKeyLength(encoded_prefix));
-    Callback::ResultType result = callback->OnKey(prefix);
-    if (result == Callback::TRAVERSE_DONE ||
-        result == Callback::TRAVERSE_CULL) {
-      return result;
-    }
-    if (result == Callback::TRAVERSE_NEXT_KEY) {
-      break;  // Go to the traversal phase.
-    }
+    for (size_t i = 0; i < level.size(); ++i) {
+      ExpandedPrefixState &state = level[i];
+      if (!key_trie_.IsTerminalNode(state.node)) {
+        continue;
+      }
 
-    const StringPiece encoded_actual_prefix(actual_key_buffer, key_pos);
-    actual_prefix->clear();
-    codec_->DecodeKey(encoded_actual_prefix, actual_prefix);
-    result = callback->OnActualKey(prefix, *actual_prefix, is_expanded);
-    if (result == Callback::TRAVERSE_DONE ||
-        result == Callback::TRAVERSE_CULL) {
-      return result;
-    }
-    if (result == Callback::TRAVERSE_NEXT_KEY) {
-      break;  // Go to the traversal phase.
-    }
+      Callback::ResultType result = callback->OnKey(prefix);
+      if (result == Callback::TRAVERSE_DONE) {
+        return result;
+      }
+      if (result == Callback::TRAVERSE_CULL) {
+        state.culled = true;
+        continue;
+      }
+      if (result == Callback::TRAVERSE_NEXT_KEY) {
+        continue;
+      }
 
-    const int key_id = key_trie_.GetKeyIdOfTerminalNode(node);
-    for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_,
-                                  *actual_prefix,
-                                  GetTokenArrayPtr(token_array_, key_id));
-         !iter.Done(); iter.Next()) {
-      const TokenInfo &token_info = iter.Get();
-      result = callback->OnToken(prefix, *actual_prefix, *token_info.token);
-      if (result == Callback::TRAVERSE_DONE ||
-          result == Callback::TRAVERSE_CULL) {
+      // Reconstruct the actually matched characters through the parent
+      // chain; level l contributes the l-th character.
+      int state_index = i;
+      for (size_t l = key_pos; l > 0; --l) {
+        actual_key_buffer[l - 1] = levels[l][state_index].label;
+        state_index = levels[l][state_index].parent;
+      }
+      const StringPiece encoded_actual_prefix(actual_key_buffer, key_pos);
+      actual_prefix.clear();
+      codec_->DecodeKey(encoded_actual_prefix, &actual_prefix);
+      result = callback->OnActualKey(prefix, actual_prefix, state.is_expanded);
+      if (result == Callback::TRAVERSE_DONE) {
         return result;
       }
+      if (result == Callback::TRAVERSE_CULL) {
+        state.culled = true;
+        continue;
+      }
       if (result == Callback::TRAVERSE_NEXT_KEY) {
-        break;  // Go to the traversal phase.
+        continue;
+      }
+
+      const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
+      for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_,
+                                    actual_prefix,
+                                    GetTokenArrayPtr(token_array_, key_id));
+           !iter.Done(); iter.Next()) {
+        const TokenInfo &token_info = iter.Get();
+        result = callback->OnToken(prefix, actual_prefix, *token_info.token);
+        if (result == Callback::TRAVERSE_DONE) {
+          return result;
+        }
+        if (result == Callback::TRAVERSE_CULL) {
+          state.culled = true;
+          break;
+        }
+        if (result == Callback::TRAVERSE_NEXT_KEY) {
+          break;
+        }
       }
     }
-  } while (false);
 
-  // Traversal phase.
-  if (key_pos == encoded_key.size()) {
-    return Callback::TRAVERSE_CONTINUE;
-  }
-  const char current_char = encoded_key[key_pos];
-  const ExpandedKey &chars = table.ExpandKey(current_char);
-  for (key_trie_.MoveToFirstChild(&node); key_trie_.IsValidNode(node);
-       key_trie_.MoveToNextSibling(&node)) {
-    const char c = key_trie_.GetEdgeLabelToParentNode(node);
-    if (!chars.IsHit(c)) {
-      continue;
+    if (key_pos == encoded_key.size()) {
+      break;
     }
-    actual_key_buffer[key_pos] = c;
-    const Callback::ResultType result = LookupPrefixWithKeyExpansionImpl(
-        key, encoded_key, table, callback, node, key_pos + 1,
-        is_expanded || c != current_char,
-        actual_key_buffer, actual_prefix);
-    if (result == Callback::TRAVERSE_DONE) {
-      return Callback::TRAVERSE_DONE;
+
+    // Expansion phase: generate the next level.
+    const char current_char = encoded_key[key_pos];
+    const ExpandedKey &chars = table.ExpandKey(current_char);
+    levels.emplace_back();
+    std::vector<ExpandedPrefixState> &next_level = levels.back();
+    // |level| is invalidated by the emplace_back() above.
+    const std::vector<ExpandedPrefixState> &current_level = levels[key_pos];
+    for (size_t i = 0; i < current_level.size(); ++i) {
+      const ExpandedPrefixState &state = current_level[i];
+      if (state.culled) {
+        continue;
+      }
+      LoudsTrie::Node node = state.node;
+      for (key_trie_.MoveToFirstChild(&node); key_trie_.IsValidNode(node);
+           key_trie_.MoveToNextSibling(&node)) {
+        const char c = key_trie_.GetEdgeLabelToParentNode(node);
+        if (!chars.IsHit(c)) {
+          continue;
+        }
+        next_level.emplace_back(node, i, c, state.is_expanded ||
+                                            c != current_char);
+      }
     }
   }
 
@@ -1013,13 +1320,44 @@ void SystemDictionary::LookupPrefix(
     return;
   }
 
-  char actual_key_buffer[LoudsTrie::kMaxDepth + 1];
-  string actual_prefix;
-  actual_prefix.reserve(key.size() * 3);
   LookupPrefixWithKeyExpansionImpl(key.data(), encoded_key,
-                                   hiragana_expansion_table_, callback,
-                                   LoudsTrie::Node(), 0, false,
-                                   actual_key_buffer, &actual_prefix);
+                                   hiragana_expansion_table_, callback);
+}
+
+void SystemDictionary::LookupPrefixBatch(
+    StringPiece full_key,
+    const ConversionRequest &conversion_request,
+    PrefixBatchCallback *callback) const {
+  string encoded_key;
+  codec_->EncodeKey(full_key, &encoded_key);
+
+  const bool use_expansion =
+      conversion_request.IsKanaModifierInsensitiveConversion();
+
+  // The key codec maps each character independently, so the encoded image of
+  // a suffix of |full_key| is the corresponding suffix of |encoded_key|; the
+  // single encoding pass above serves every start position.
+  size_t pos = 0;
+  size_t encoded_pos = 0;
+  while (pos < full_key.size()) {
+    if (callback->OnStartPosition(pos)) {
+      const StringPiece suffix = full_key.substr(pos);
+      const StringPiece encoded_suffix =
+          StringPiece(encoded_key).substr(encoded_pos);
+      if (use_expansion) {
+        LookupPrefixWithKeyExpansionImpl(suffix.data(), encoded_suffix,
+                                         hiragana_expansion_table_, callback);
+      } else {
+        RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
+                                frequent_pos_, suffix.data(), encoded_suffix,
+                                callback, SelectAllTokens());
+      }
+    }
+    const size_t char_length = Util::OneCharLen(full_key.data() + pos);
+    encoded_pos +=
+        codec_->GetEncodedKeyLength(full_key.substr(pos, char_length));
+    pos += char_length;
+  }
 }
 
 void SystemDictionary::LookupExact(
@@ -1104,10 +1442,19 @@ void SystemDictionary::PopulateReverseLookupCache(StringPiece str) const {
   }
   // Collect tokens for all IDs.
   ScanTokens(id_set, reverse_lookup_cache_.get());
+
+  // A pending trim request targeted the cache we just replaced.
+  reverse_lookup_cache_client_->TestAndClearTrimRequest();
+  // Rough heap estimate of the multimap including the per-node overhead.
+  const size_t kBytesPerResult =
+      sizeof(std::pair<int, ReverseLookupResult>) + 32;
+  reverse_lookup_cache_client_->Update(
+      reverse_lookup_cache_->results.size() * kBytesPerResult);
 }
 
 void SystemDictionary::ClearReverseLookupCache() const {
   reverse_lookup_cache_.reset();
+  reverse_lookup_cache_client_->Update(0);
 }
 
 namespace {
@@ -1160,6 +1507,13 @@ void SystemDictionary::RegisterReverseLookupTokensForValue(
   std::set<int> id_set;
   AddKeyIdsOfAllPrefixes(value_trie_, lookup_key, &id_set);
 
+  // The budget manager may have asked us to drop the cache; honor the
+  // request here, on the thread that owns the cache.
+  if (reverse_lookup_cache_ != nullptr &&
+      reverse_lookup_cache_client_->TestAndClearTrimRequest()) {
+    reverse_lookup_cache_.reset();
+  }
+
   ReverseLookupCache *results = nullptr;
   ReverseLookupCache non_cached_results;
   if (reverse_lookup_index_ != nullptr) {
@@ -1167,6 +1521,7 @@ void SystemDictionary::RegisterReverseLookupTokensForValue(
     results = &non_cached_results;
   } else if (reverse_lookup_cache_ != nullptr &&
              reverse_lookup_cache_->IsAvailable(id_set)) {
+    reverse_lookup_cache_client_->Touch();
     results = reverse_lookup_cache_.get();
   } else {
     // Cache is not available. Get token for each ID.
@@ -59,6 +59,7 @@
         '../../request/request.gyp:conversion_request',
         '../../storage/louds/louds.gyp:bit_vector_based_array',
         '../../storage/louds/louds.gyp:louds_trie',
+        '../../storage/storage.gyp:storage',
         '../dictionary_base.gyp:text_dictionary_loader',
         '../file/dictionary_file.gyp:codec_factory',
         '../file/dictionary_file.gyp:dictionary_file',
@@ -98,5 +99,19 @@
         'system_dictionary_codec',
       ],
     },
+    {
+      'target_name': 'system_dictionary_benchmark',
+      'type': 'executable',
+      'sources': [
+        'system_dictionary_benchmark.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../protocol/protocol.gyp:commands_proto',
+        '../../protocol/protocol.gyp:config_proto',
+        '../../request/request.gyp:conversion_request',
+        'system_dictionary',
+      ],
+    },
   ],
 }
@@ -46,6 +46,9 @@
 #include "storage/louds/louds_trie.h"
 
 namespace mozc {
+
+class SharedMemory;
+
 namespace dictionary {
 
 class DictionaryFile;
@@ -61,6 +64,13 @@ class SystemDictionary : public DictionaryInterface {
     // from the id in value trie to the id in key trie.
     // That consumes more memory but we can perform reverse lookup more quickly.
     ENABLE_REVERSE_LOOKUP_INDEX = 1,
+    // If SHARE_RANK_DIRECTORIES is set, the rank directories of the key and
+    // value tries are placed in a named shared-memory segment built by the
+    // first process opening the same dictionary image and mapped read-only
+    // by the others, so N server processes share one physical copy instead
+    // of N.  Falls back to private heap directories where shared memory is
+    // unavailable (Windows, Android, NaCl).
+    SHARE_RANK_DIRECTORIES = 2,
   };
 
   // Builder class for system dictionary
@@ -112,6 +122,26 @@ class SystemDictionary : public DictionaryInterface {
                             const ConversionRequest &converter_request,
                             Callback *callback) const;
 
+  // Callback for LookupPrefixBatch().  OnStartPosition() is called once per
+  // UTF-8 character boundary of the batched key before the results of the
+  // prefix lookup starting there are delivered through the inherited
+  // Callback methods; return false to skip that start position.  The key
+  // arguments of the inherited methods are relative to the current start
+  // position.
+  class PrefixBatchCallback : public Callback {
+   public:
+    virtual bool OnStartPosition(size_t pos) { return true; }
+  };
+
+  // Runs prefix lookup from every UTF-8 character boundary of |full_key|.
+  // Equivalent to calling LookupPrefix() on every suffix of |full_key|, but
+  // the key is encoded only once, so the per-position overhead no longer
+  // grows with the key length.  Designed for lattice construction, which
+  // needs the prefix results of all start positions of the input.
+  void LookupPrefixBatch(StringPiece full_key,
+                         const ConversionRequest &converter_request,
+                         PrefixBatchCallback *callback) const;
+
   virtual void LookupExact(StringPiece key,
                            const ConversionRequest &converter_request,
                            Callback *callback) const;
@@ -125,12 +155,24 @@ class SystemDictionary : public DictionaryInterface {
 
  private:
   class ReverseLookupCache;
+  class ReverseLookupCacheClient;
   class ReverseLookupIndex;
   struct PredictiveLookupSearchState;
 
   explicit SystemDictionary(const SystemDictionaryCodecInterface *codec,
                             const DictionaryFileCodecInterface *file_codec);
-  bool OpenDictionaryFile(bool enable_reverse_lookup_index);
+  bool OpenDictionaryFile(bool enable_reverse_lookup_index,
+                          bool share_rank_directories);
+
+  // Opens |key_trie_| and |value_trie_| with their rank directories in a
+  // named shared-memory segment; returns false when shared memory is
+  // unavailable, in which case the caller opens the tries privately.
+  // |key_image_len| and |value_image_len| are the section lengths, used to
+  // key the segment name on the image contents.
+  bool OpenTriesWithSharedRankDirectories(const uint8 *key_image,
+                                          int key_image_len,
+                                          const uint8 *value_image,
+                                          int value_image_len);
 
   void RegisterReverseLookupTokensForT13N(StringPiece value,
                                           Callback *callback) const;
@@ -146,19 +188,20 @@ class SystemDictionary : public DictionaryInterface {
       const char *key,
       StringPiece encoded_key,
       const KeyExpansionTable &table,
-      Callback *callback,
-      storage::louds::LoudsTrie::Node node,
-      StringPiece::size_type key_pos,
-      bool is_expanded,
-      char *actual_key_buffer,
-      string *actual_prefix) const;
-
-  void CollectPredictiveNodesInBfsOrder(
+      Callback *callback) const;
+
+  // Returns true if the traversal stopped at |limit| before every key
+  // below |encoded_key| was visited.
+  bool CollectPredictiveNodesInBfsOrder(
       StringPiece encoded_key,
       const KeyExpansionTable &table,
       size_t limit,
+      size_t max_encoded_key_length,
       std::vector<PredictiveLookupSearchState> *result) const;
 
+  // Declared before the tries so that the mapping outlives them; the tries
+  // keep pointers into the segment when SHARE_RANK_DIRECTORIES is set.
+  std::unique_ptr<SharedMemory> shared_rank_directories_;
   storage::louds::LoudsTrie key_trie_;
   storage::louds::LoudsTrie value_trie_;
   storage::louds::BitVectorBasedArray token_array_;
@@ -167,6 +210,9 @@ class SystemDictionary : public DictionaryInterface {
   KeyExpansionTable hiragana_expansion_table_;
   std::unique_ptr<DictionaryFile> dictionary_file_;
   mutable std::unique_ptr<ReverseLookupCache> reverse_lookup_cache_;
+  // Reports the cache to storage::CacheBudgetManager; see the class
+  // comment in the .cc file.
+  std::unique_ptr<ReverseLookupCacheClient> reverse_lookup_cache_client_;
   std::unique_ptr<ReverseLookupIndex> reverse_lookup_index_;
 
   DISALLOW_COPY_AND_ASSIGN(SystemDictionary);
@@ -27,3 +27,451 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+// Microbenchmark suite for SystemDictionary lookup operations.
+//
+// Usage:
+//   system_dictionary_benchmark --dictionary_file=system.dictionary \
+//       [--query_file=queries.txt] [--iterations=10] \
+//       [--output=results.tsv] [--baseline=old_results.tsv]
+//
+// Each benchmark runs one lookup operation over a query corpus (a recorded
+// real-query file with one reading per line, or a small built-in corpus)
+// and reports, per query: wall time, CPU cycles and cache misses (Linux
+// perf counters; zero where unavailable), and the number of keys, tokens
+// and token bytes delivered to the callback, so that decode volume can be
+// separated from traversal cost.
+//
+// With --output the results are stored as TSV; a later run can pass that
+// file as --baseline to print the relative change of every metric, so that
+// dictionary format changes can be judged quantitatively.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // OS_LINUX
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/string_piece.h"
+#include "base/util.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/dictionary_token.h"
+#include "dictionary/system/system_dictionary.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+DEFINE_string(dictionary_file, "", "System dictionary file to benchmark.");
+DEFINE_string(query_file, "",
+              "Recorded query corpus with one reading per line.  A small "
+              "built-in corpus is used when empty.");
+DEFINE_int32(iterations, 10,
+             "Number of passes over the query corpus per benchmark.");
+DEFINE_string(output, "",
+              "TSV file to store the results in; pass it as --baseline of a "
+              "later run to compare.");
+DEFINE_string(baseline, "",
+              "TSV results of a baseline run to compare against.");
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+// Hardware counters around a measured region.  Uses perf events on Linux
+// and degrades to zeros elsewhere, or when the kernel denies access (e.g.
+// under restrictive perf_event_paranoid settings).
+class PerfCounters {
+ public:
+  PerfCounters() : cycles_fd_(-1), cache_misses_fd_(-1) {
+#ifdef OS_LINUX
+    cycles_fd_ = OpenCounter(PERF_COUNT_HW_CPU_CYCLES);
+    cache_misses_fd_ = OpenCounter(PERF_COUNT_HW_CACHE_MISSES);
+#endif  // OS_LINUX
+  }
+
+  ~PerfCounters() {
+#ifdef OS_LINUX
+    if (cycles_fd_ >= 0) {
+      ::close(cycles_fd_);
+    }
+    if (cache_misses_fd_ >= 0) {
+      ::close(cache_misses_fd_);
+    }
+#endif  // OS_LINUX
+  }
+
+  void Start() {
+#ifdef OS_LINUX
+    ResetAndEnable(cycles_fd_);
+    ResetAndEnable(cache_misses_fd_);
+#endif  // OS_LINUX
+  }
+
+  // Stops counting and returns the counts since Start().
+  void Stop(uint64 *cycles, uint64 *cache_misses) {
+    *cycles = 0;
+    *cache_misses = 0;
+#ifdef OS_LINUX
+    *cycles = DisableAndRead(cycles_fd_);
+    *cache_misses = DisableAndRead(cache_misses_fd_);
+#endif  // OS_LINUX
+  }
+
+ private:
+#ifdef OS_LINUX
+  static int OpenCounter(uint64 config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    const int fd = ::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) {
+      LOG(WARNING) << "perf_event_open failed for config " << config
+                   << "; reporting 0";
+    }
+    return fd;
+  }
+
+  static void ResetAndEnable(int fd) {
+    if (fd >= 0) {
+      ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  static uint64 DisableAndRead(int fd) {
+    if (fd < 0) {
+      return 0;
+    }
+    ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    uint64 value = 0;
+    if (::read(fd, &value, sizeof(value)) != sizeof(value)) {
+      return 0;
+    }
+    return value;
+  }
+#endif  // OS_LINUX
+
+  int cycles_fd_;
+  int cache_misses_fd_;
+
+  DISALLOW_COPY_AND_ASSIGN(PerfCounters);
+};
+
+// Counts what the traversal delivers; |bytes| is the total size of the
+// decoded token keys and values, a proxy for the decode volume of a query.
+class CountingCallback : public DictionaryInterface::Callback {
+ public:
+  CountingCallback() : num_keys_(0), num_tokens_(0), num_bytes_(0) {}
+
+  ResultType OnKey(StringPiece key) override {
+    ++num_keys_;
+    return TRAVERSE_CONTINUE;
+  }
+
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) override {
+    ++num_tokens_;
+    num_bytes_ += token.key.size() + token.value.size();
+    return TRAVERSE_CONTINUE;
+  }
+
+  uint64 num_keys() const { return num_keys_; }
+  uint64 num_tokens() const { return num_tokens_; }
+  uint64 num_bytes() const { return num_bytes_; }
+
+ private:
+  uint64 num_keys_;
+  uint64 num_tokens_;
+  uint64 num_bytes_;
+};
+
+// Per-query averages of one benchmark.
+struct BenchmarkResult {
+  BenchmarkResult()
+      : wall_us(0.0), cycles(0.0), cache_misses(0.0),
+        keys(0.0), tokens(0.0), bytes(0.0) {}
+
+  double wall_us;
+  double cycles;
+  double cache_misses;
+  double keys;
+  double tokens;
+  double bytes;
+};
+
+const char *const kMetricNames[] = {
+    "us", "cycles", "cache_misses", "keys", "tokens", "bytes",
+};
+
+std::vector<double> MetricValues(const BenchmarkResult &result) {
+  return {result.wall_us, result.cycles, result.cache_misses,
+          result.keys, result.tokens, result.bytes};
+}
+
+// Used when --query_file is not given.  Mixes short and long readings and
+// keys prone to kana modifier expansion.
+const char *const kBuiltinQueries[] = {
+    "あ", "か", "はは", "かつ", "きよう", "とうきよう", "だいがく",
+    "けいたいでんわ", "へんかん", "じしよ", "こうこう", "せんせい",
+    "にほんご", "かな", "ふじさんろく", "おはようございます",
+};
+
+std::vector<string> LoadQueries() {
+  std::vector<string> queries;
+  if (FLAGS_query_file.empty()) {
+    for (size_t i = 0; i < arraysize(kBuiltinQueries); ++i) {
+      queries.push_back(kBuiltinQueries[i]);
+    }
+    return queries;
+  }
+  InputFileStream ifs(FLAGS_query_file.c_str());
+  CHECK(ifs.good()) << "Cannot open " << FLAGS_query_file;
+  string line;
+  while (std::getline(ifs, line)) {
+    Util::ChopReturns(&line);
+    if (!line.empty()) {
+      queries.push_back(line);
+    }
+  }
+  CHECK(!queries.empty()) << "No queries in " << FLAGS_query_file;
+  return queries;
+}
+
+class SystemDictionaryBenchmark {
+ public:
+  SystemDictionaryBenchmark(const SystemDictionary *dictionary,
+                            const std::vector<string> &queries)
+      : dictionary_(dictionary),
+        queries_(queries),
+        plain_request_(nullptr, &request_proto_, &config_proto_),
+        expansion_request_(nullptr, &expansion_request_proto_,
+                           &expansion_config_proto_) {
+    expansion_request_proto_.set_kana_modifier_insensitive_conversion(true);
+    expansion_config_proto_.set_use_kana_modifier_insensitive_conversion(true);
+  }
+
+  // Runs every benchmark and returns name -> per-query averages.
+  std::map<string, BenchmarkResult> RunAll() {
+    std::map<string, BenchmarkResult> results;
+    results["LookupPrefix"] = Run(&SystemDictionaryBenchmark::LookupPrefix);
+    results["LookupPrefix/expanded"] =
+        Run(&SystemDictionaryBenchmark::LookupPrefixExpanded);
+    results["LookupPredictive"] =
+        Run(&SystemDictionaryBenchmark::LookupPredictive);
+    results["LookupPredictive/expanded"] =
+        Run(&SystemDictionaryBenchmark::LookupPredictiveExpanded);
+    results["LookupReverse"] = Run(&SystemDictionaryBenchmark::LookupReverse);
+    results["TrieExactSearch"] =
+        Run(&SystemDictionaryBenchmark::TrieExactSearch);
+    return results;
+  }
+
+ private:
+  typedef void (SystemDictionaryBenchmark::*Operation)(
+      const string &query, CountingCallback *callback) const;
+
+  void LookupPrefix(const string &query, CountingCallback *callback) const {
+    dictionary_->LookupPrefix(query, plain_request_, callback);
+  }
+
+  void LookupPrefixExpanded(const string &query,
+                            CountingCallback *callback) const {
+    dictionary_->LookupPrefix(query, expansion_request_, callback);
+  }
+
+  void LookupPredictive(const string &query,
+                        CountingCallback *callback) const {
+    dictionary_->LookupPredictive(query, plain_request_, callback);
+  }
+
+  void LookupPredictiveExpanded(const string &query,
+                                CountingCallback *callback) const {
+    dictionary_->LookupPredictive(query, expansion_request_, callback);
+  }
+
+  void LookupReverse(const string &query, CountingCallback *callback) const {
+    dictionary_->LookupReverse(query, plain_request_, callback);
+  }
+
+  // Raw trie cost without token decoding: an exact search on the key trie.
+  void TrieExactSearch(const string &query,
+                       CountingCallback *callback) const {
+    if (dictionary_->HasKey(query)) {
+      callback->OnKey(query);
+    }
+  }
+
+  BenchmarkResult Run(Operation operation) {
+    // Warm-up pass so that the first measured pass doesn't pay the page-in
+    // cost of the dictionary image.
+    CountingCallback warmup;
+    for (size_t i = 0; i < queries_.size(); ++i) {
+      (this->*operation)(queries_[i], &warmup);
+    }
+
+    BenchmarkResult result;
+    CountingCallback callback;
+    Stopwatch stopwatch;
+    uint64 total_cycles = 0;
+    uint64 total_cache_misses = 0;
+    for (int iteration = 0; iteration < FLAGS_iterations; ++iteration) {
+      counters_.Start();
+      stopwatch.Start();
+      for (size_t i = 0; i < queries_.size(); ++i) {
+        (this->*operation)(queries_[i], &callback);
+      }
+      stopwatch.Stop();
+      uint64 cycles = 0, cache_misses = 0;
+      counters_.Stop(&cycles, &cache_misses);
+      total_cycles += cycles;
+      total_cache_misses += cache_misses;
+    }
+
+    const double num_lookups =
+        static_cast<double>(queries_.size()) * FLAGS_iterations;
+    result.wall_us = stopwatch.GetElapsedMicroseconds() / num_lookups;
+    result.cycles = total_cycles / num_lookups;
+    result.cache_misses = total_cache_misses / num_lookups;
+    result.keys = callback.num_keys() / num_lookups;
+    result.tokens = callback.num_tokens() / num_lookups;
+    result.bytes = callback.num_bytes() / num_lookups;
+    return result;
+  }
+
+  const SystemDictionary *dictionary_;
+  const std::vector<string> &queries_;
+  commands::Request request_proto_;
+  config::Config config_proto_;
+  commands::Request expansion_request_proto_;
+  config::Config expansion_config_proto_;
+  ConversionRequest plain_request_;
+  ConversionRequest expansion_request_;
+  PerfCounters counters_;
+
+  DISALLOW_COPY_AND_ASSIGN(SystemDictionaryBenchmark);
+};
+
+void PrintResults(const std::map<string, BenchmarkResult> &results) {
+  printf("%-28s %10s %12s %12s %8s %8s %8s\n", "benchmark", "us", "cycles",
+         "cache_miss", "keys", "tokens", "bytes");
+  for (const auto &entry : results) {
+    const BenchmarkResult &r = entry.second;
+    printf("%-28s %10.2f %12.0f %12.1f %8.1f %8.1f %8.1f\n",
+           entry.first.c_str(), r.wall_us, r.cycles, r.cache_misses,
+           r.keys, r.tokens, r.bytes);
+  }
+}
+
+void WriteResults(const string &path,
+                  const std::map<string, BenchmarkResult> &results) {
+  OutputFileStream ofs(path.c_str());
+  CHECK(ofs.good()) << "Cannot write " << path;
+  for (const auto &entry : results) {
+    ofs << entry.first;
+    const std::vector<double> values = MetricValues(entry.second);
+    for (size_t i = 0; i < values.size(); ++i) {
+      ofs << '\t' << values[i];
+    }
+    ofs << '\n';
+  }
+}
+
+// Baseline files hold one line per benchmark with the metrics in
+// kMetricNames order; see WriteResults().
+std::map<string, std::vector<double>> LoadBaseline(const string &path) {
+  std::map<string, std::vector<double>> baseline;
+  InputFileStream ifs(path.c_str());
+  CHECK(ifs.good()) << "Cannot open " << path;
+  string line;
+  while (std::getline(ifs, line)) {
+    Util::ChopReturns(&line);
+    std::vector<StringPiece> fields;
+    Util::SplitStringUsing(line, "\t", &fields);
+    if (fields.size() != arraysize(kMetricNames) + 1) {
+      continue;
+    }
+    std::vector<double> &values = baseline[fields[0].as_string()];
+    for (size_t i = 1; i < fields.size(); ++i) {
+      values.push_back(strtod(fields[i].as_string().c_str(), nullptr));
+    }
+  }
+  return baseline;
+}
+
+void PrintComparison(const std::map<string, BenchmarkResult> &results,
+                     const std::map<string, std::vector<double>> &baseline) {
+  printf("\nRelative to %s (negative is faster/smaller):\n",
+         FLAGS_baseline.c_str());
+  for (const auto &entry : results) {
+    const auto it = baseline.find(entry.first);
+    if (it == baseline.end()) {
+      printf("%-28s (no baseline)\n", entry.first.c_str());
+      continue;
+    }
+    printf("%-28s", entry.first.c_str());
+    const std::vector<double> values = MetricValues(entry.second);
+    for (size_t i = 0; i < values.size(); ++i) {
+      const double base = it->second[i];
+      if (base == 0.0) {
+        printf(" %s=n/a", kMetricNames[i]);
+      } else {
+        printf(" %s=%+.1f%%", kMetricNames[i],
+               100.0 * (values[i] - base) / base);
+      }
+    }
+    printf("\n");
+  }
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  CHECK(!FLAGS_dictionary_file.empty()) << "--dictionary_file is required";
+  std::unique_ptr<mozc::dictionary::SystemDictionary> dictionary(
+      mozc::dictionary::SystemDictionary::Builder(FLAGS_dictionary_file)
+          .Build());
+  CHECK(dictionary != nullptr)
+      << "Failed to open " << FLAGS_dictionary_file;
+
+  const std::vector<string> queries = mozc::dictionary::LoadQueries();
+  LOG(INFO) << queries.size() << " queries, " << FLAGS_iterations
+            << " iterations";
+
+  mozc::dictionary::SystemDictionaryBenchmark benchmark(dictionary.get(),
+                                                        queries);
+  const std::map<string, mozc::dictionary::BenchmarkResult> results =
+      benchmark.RunAll();
+  mozc::dictionary::PrintResults(results);
+
+  if (!FLAGS_output.empty()) {
+    mozc::dictionary::WriteResults(FLAGS_output, results);
+  }
+  if (!FLAGS_baseline.empty()) {
+    mozc::dictionary::PrintComparison(
+        results, mozc::dictionary::LoadBaseline(FLAGS_baseline));
+  }
+  return 0;
+}
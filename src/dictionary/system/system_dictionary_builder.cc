@@ -32,12 +32,15 @@
 #include <algorithm>
 #include <climits>
 #include <cstring>
+#include <functional>
+#include <memory>
 #include <sstream>
 
 #include "base/file_stream.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/mozc_hash_set.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/file/codec_factory.h"
@@ -54,6 +57,8 @@ DEFINE_bool(preserve_intermediate_dictionary, false,
             "preserve inetemediate dictionary file.");
 DEFINE_int32(min_key_length_to_use_small_cost_encoding, 6,
              "minimum key length to use 1 byte cost encoding.");
+DEFINE_int32(dictionary_builder_num_threads, 4,
+             "number of worker threads used to build the system dictionary.");
 
 namespace mozc {
 namespace dictionary {
@@ -85,6 +90,58 @@ void WriteSectionToFile(const DictionaryFileSection &section,
   ofs.write(section.ptr, section.len);
 }
 
+// Runs a closure on its own thread.  Used to overlap the independent
+// phases of the dictionary build and to shard the per-key passes.
+class ClosureThread : public Thread {
+ public:
+  explicit ClosureThread(std::function<void()> closure)
+      : closure_(std::move(closure)) {}
+  virtual void Run() { closure_(); }
+
+ private:
+  std::function<void()> closure_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClosureThread);
+};
+
+int GetNumBuildThreads() {
+  return std::max(FLAGS_dictionary_builder_num_threads, 1);
+}
+
+typedef std::deque<SystemDictionaryBuilder::KeyInfo> KeyInfoDeque;
+
+// Applies |func| to every KeyInfo in |key_info_list|, splitting the list
+// into contiguous shards processed by worker threads.  |func| must only
+// touch the passed KeyInfo (plus read-only shared state) and must not
+// resize the list.
+void ParallelForEachKeyInfo(
+    KeyInfoDeque *key_info_list,
+    const std::function<void(SystemDictionaryBuilder::KeyInfo *)> &func) {
+  const size_t size = key_info_list->size();
+  const int num_threads =
+      std::min<size_t>(GetNumBuildThreads(), std::max<size_t>(size, 1));
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < size; ++i) {
+      func(&(*key_info_list)[i]);
+    }
+    return;
+  }
+  std::vector<std::unique_ptr<ClosureThread>> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    const size_t begin = size * t / num_threads;
+    const size_t end = size * (t + 1) / num_threads;
+    threads.emplace_back(new ClosureThread([key_info_list, begin, end, &func] {
+      for (size_t i = begin; i < end; ++i) {
+        func(&(*key_info_list)[i]);
+      }
+    }));
+    threads.back()->Start("DictionaryBuilder");
+  }
+  for (size_t t = 0; t < threads.size(); ++t) {
+    threads[t]->Join();
+  }
+}
+
 }  // namespace
 
 SystemDictionaryBuilder::SystemDictionaryBuilder()
@@ -106,23 +163,51 @@ SystemDictionaryBuilder::SystemDictionaryBuilder(
 
 SystemDictionaryBuilder::~SystemDictionaryBuilder() {}
 
+void SystemDictionaryBuilder::AddKeyFrequency(const string &key,
+                                              uint64 count) {
+  string encoded_key;
+  codec_->EncodeKey(key, &encoded_key);
+  if (key_label_frequency_.empty()) {
+    key_label_frequency_.resize(256);
+  }
+  for (size_t i = 0; i < encoded_key.size(); ++i) {
+    key_label_frequency_[static_cast<uint8>(encoded_key[i])] += count;
+  }
+}
+
 void SystemDictionaryBuilder::BuildFromTokens(
     const std::vector<Token *> &tokens) {
   KeyInfoList key_info_list;
   ReadTokens(tokens, &key_info_list);
+  LOG(INFO) << "BuildFromTokens: sorted " << tokens.size() << " tokens into "
+            << key_info_list.size() << " keys.";
 
   BuildFrequentPos(key_info_list);
-  BuildValueTrie(key_info_list);
+  LOG(INFO) << "BuildFromTokens: selected frequent POS.";
+
+  // The value trie and the key trie use separate builders and only read
+  // |key_info_list|, and each id assignment pass needs nothing but its own
+  // trie and writes its own TokenInfo/KeyInfo field, so the whole value
+  // side runs on a worker thread while the key side runs here.
+  ClosureThread value_trie_thread([this, &key_info_list] {
+    BuildValueTrie(key_info_list);
+    SetIdForValue(&key_info_list);
+  });
+  value_trie_thread.Start("ValueTrieBuilder");
   BuildKeyTrie(key_info_list);
-
-  SetIdForValue(&key_info_list);
   SetIdForKey(&key_info_list);
+  value_trie_thread.Join();
+  LOG(INFO) << "BuildFromTokens: built value trie and key trie.";
+
   SortTokenInfo(&key_info_list);
   SetCostType(&key_info_list);
   SetPosType(&key_info_list);
   SetValueType(&key_info_list);
+  LOG(INFO) << "BuildFromTokens: assigned token attributes.";
 
   BuildTokenArray(key_info_list);
+  BuildReverseLookupIndexImage(key_info_list);
+  LOG(INFO) << "BuildFromTokens: built token array and reverse lookup index.";
 }
 
 void SystemDictionaryBuilder::WriteToFile(const string &output_file) const {
@@ -164,6 +249,13 @@ void SystemDictionaryBuilder::WriteToStream(
     file_codec_->GetSectionName(codec_->GetSectionNameForPos()));
   sections.push_back(frequent_pos_section);
 
+  DictionaryFileSection reverse_lookup_index_section(
+    reverse_lookup_index_image_.data(),
+    reverse_lookup_index_image_.size(),
+    file_codec_->GetSectionName(
+        codec_->GetSectionNameForReverseLookupIndex()));
+  sections.push_back(reverse_lookup_index_section);
+
   if (FLAGS_preserve_intermediate_dictionary &&
       !intermediate_output_file_base_path.empty()) {
     // Write out intermediate results to files.
@@ -173,6 +265,7 @@ void SystemDictionaryBuilder::WriteToStream(
     WriteSectionToFile(key_trie_section, basepath + ".key");
     WriteSectionToFile(token_array_section, basepath + ".tokens");
     WriteSectionToFile(frequent_pos_section, basepath + ".freq_pos");
+    WriteSectionToFile(reverse_lookup_index_section, basepath + ".rev_index");
   }
 
   LOG(INFO) << "Start writing dictionary file.";
@@ -243,8 +336,40 @@ void SystemDictionaryBuilder::ReadTokens(const std::vector<Token *> &tokens,
     CHECK(!token->value.empty()) << "empty value string in input";
     reduce_buffer.push_back(token);
   }
-  std::stable_sort(reduce_buffer.begin(), reduce_buffer.end(),
-                   TokenPtrLessThan());
+  const int num_threads = GetNumBuildThreads();
+  if (num_threads <= 1 || reduce_buffer.size() < 10000) {
+    std::stable_sort(reduce_buffer.begin(), reduce_buffer.end(),
+                     TokenPtrLessThan());
+  } else {
+    // Partitioned sort: each worker stably sorts a contiguous chunk, then
+    // the chunks are merged pairwise.  inplace_merge is stable, so the
+    // result is identical to the plain stable_sort above.
+    std::vector<size_t> bounds;
+    for (int t = 0; t <= num_threads; ++t) {
+      bounds.push_back(reduce_buffer.size() * t / num_threads);
+    }
+    std::vector<std::unique_ptr<ClosureThread>> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      ReduceBuffer::iterator begin = reduce_buffer.begin() + bounds[t];
+      ReduceBuffer::iterator end = reduce_buffer.begin() + bounds[t + 1];
+      threads.emplace_back(new ClosureThread([begin, end] {
+        std::stable_sort(begin, end, TokenPtrLessThan());
+      }));
+      threads.back()->Start("DictionaryBuilder");
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+      threads[t]->Join();
+    }
+    for (int step = 1; step < num_threads; step *= 2) {
+      for (int t = 0; t + step < num_threads; t += 2 * step) {
+        const size_t last = std::min<size_t>(t + 2 * step, num_threads);
+        std::inplace_merge(reduce_buffer.begin() + bounds[t],
+                           reduce_buffer.begin() + bounds[t + step],
+                           reduce_buffer.begin() + bounds[last],
+                           TokenPtrLessThan());
+      }
+    }
+  }
 
   // Step 2.
   key_info_list->clear();
@@ -340,33 +465,28 @@ void SystemDictionaryBuilder::BuildValueTrie(const KeyInfoList &key_info_list) {
 }
 
 void SystemDictionaryBuilder::SetIdForValue(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    for (size_t i = 0; i < itr->tokens.size(); ++i) {
-      TokenInfo *token_info = &(itr->tokens[i]);
+  ParallelForEachKeyInfo(key_info_list, [this](KeyInfo *key_info) {
+    for (size_t i = 0; i < key_info->tokens.size(); ++i) {
+      TokenInfo *token_info = &(key_info->tokens[i]);
       string value_str;
       codec_->EncodeValue(token_info->token->value, &value_str);
       token_info->id_in_value_trie =
           value_trie_builder_->GetId(value_str);
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SortTokenInfo(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
+  ParallelForEachKeyInfo(key_info_list, [](KeyInfo *key_info) {
     std::sort(key_info->tokens.begin(), key_info->tokens.end(),
               TokenGreaterThan());
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
+  ParallelForEachKeyInfo(key_info_list, [](KeyInfo *key_info) {
     if (HasHomonymsInSamePos(*key_info)) {
-      continue;
+      return;
     }
     for (size_t i = 0; i < key_info->tokens.size(); ++i) {
       TokenInfo *token_info = &key_info->tokens[i];
@@ -375,13 +495,11 @@ void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
         token_info->cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
       }
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
+  ParallelForEachKeyInfo(key_info_list, [this](KeyInfo *key_info) {
     for (size_t i = 0; i < key_info->tokens.size(); ++i) {
       TokenInfo *token_info = &(key_info->tokens[i]);
       const uint32 pos = GetCombinedPos(token_info->token->lid,
@@ -401,13 +519,11 @@ void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
         }
       }
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
+  ParallelForEachKeyInfo(key_info_list, [](KeyInfo *key_info) {
     for (size_t i = 1; i < key_info->tokens.size(); ++i) {
       const TokenInfo *prev_token_info = &(key_info->tokens[i - 1]);
       TokenInfo *token_info = &(key_info->tokens[i]);
@@ -417,10 +533,13 @@ void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
         token_info->value_type = TokenInfo::SAME_AS_PREV_VALUE;
       }
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
+  if (!key_label_frequency_.empty()) {
+    key_trie_builder_->SetLabelFrequency(key_label_frequency_);
+  }
   for (KeyInfoList::const_iterator itr = key_info_list.begin();
        itr != key_info_list.end(); ++itr) {
     string key_str;
@@ -431,14 +550,12 @@ void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
 }
 
 void SystemDictionaryBuilder::SetIdForKey(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
+  ParallelForEachKeyInfo(key_info_list, [this](KeyInfo *key_info) {
     string key_str;
     codec_->EncodeKey(key_info->key, &key_str);
     key_info->id_in_key_trie =
         key_trie_builder_->GetId(key_str);
-  }
+  });
 }
 
 void SystemDictionaryBuilder::BuildTokenArray(
@@ -468,5 +585,95 @@ void SystemDictionaryBuilder::BuildTokenArray(
   token_array_builder_->Build();
 }
 
+namespace {
+
+struct ReverseLookupIndexEntry {
+  int32 id_in_value_trie;
+  int32 tokens_offset;
+  int32 id_in_key_trie;
+};
+
+struct ReverseLookupIndexEntryLessThan {
+  inline bool operator()(const ReverseLookupIndexEntry &lhs,
+                         const ReverseLookupIndexEntry &rhs) const {
+    return lhs.id_in_value_trie < rhs.id_in_value_trie;
+  }
+};
+
+// Elements shorter than this are padded in the token array.  Must be equal
+// to the base length of BitVectorBasedArrayBuilder; see also
+// kMinTokenArrayBlobSize in system_dictionary.cc.
+const size_t kTokenArrayBlobBaseLength = 4;
+
+}  // namespace
+
+void SystemDictionaryBuilder::BuildReverseLookupIndexImage(
+    const KeyInfoList &key_info_list) {
+  // Collects (id_in_value_trie, tokens_offset, id_in_key_trie) for every
+  // token whose value id is stored in the token array, and serializes them
+  // sorted by value id so that SystemDictionary::ReverseLookupIndex can use
+  // the section as is without scanning the token array.  The layout is a
+  // sequence of int32:
+  //   num_ids;
+  //   num_results;
+  //   begin[num_ids + 1];  // results for value id |i| are
+  //                        // [begin[i], begin[i + 1])
+  //   {tokens_offset, id_in_key_trie} results[num_results];
+  std::vector<const KeyInfo *> id_to_keyinfo_table;
+  id_to_keyinfo_table.resize(key_info_list.size());
+  for (KeyInfoList::const_iterator itr = key_info_list.begin();
+       itr != key_info_list.end(); ++itr) {
+    id_to_keyinfo_table[itr->id_in_key_trie] = &(*itr);
+  }
+
+  int32 num_ids = 0;
+  int tokens_offset = 0;
+  std::vector<ReverseLookupIndexEntry> entries;
+  for (size_t id = 0; id < id_to_keyinfo_table.size(); ++id) {
+    const KeyInfo &key_info = *id_to_keyinfo_table[id];
+    for (size_t i = 0; i < key_info.tokens.size(); ++i) {
+      const TokenInfo &token_info = key_info.tokens[i];
+      if (token_info.value_type != TokenInfo::DEFAULT_VALUE) {
+        // Only tokens encoded with their value id are visible to reverse
+        // lookup.  See SystemDictionaryCodec::EncodeToken.
+        continue;
+      }
+      DCHECK_GE(token_info.id_in_value_trie, 0);
+      ReverseLookupIndexEntry entry;
+      entry.id_in_value_trie = token_info.id_in_value_trie;
+      entry.tokens_offset = tokens_offset;
+      entry.id_in_key_trie = static_cast<int32>(id);
+      entries.push_back(entry);
+      num_ids = std::max(num_ids, entry.id_in_value_trie + 1);
+    }
+    string tokens_str;
+    codec_->EncodeTokens(key_info.tokens, &tokens_str);
+    tokens_offset += std::max(tokens_str.size(), kTokenArrayBlobBaseLength);
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   ReverseLookupIndexEntryLessThan());
+
+  std::vector<int32> image;
+  image.reserve(2 + num_ids + 1 + entries.size() * 2);
+  image.push_back(num_ids);
+  image.push_back(static_cast<int32>(entries.size()));
+  size_t entry_index = 0;
+  for (int32 id = 0; id < num_ids; ++id) {
+    image.push_back(static_cast<int32>(entry_index));
+    while (entry_index < entries.size() &&
+           entries[entry_index].id_in_value_trie == id) {
+      ++entry_index;
+    }
+  }
+  image.push_back(static_cast<int32>(entries.size()));
+  for (size_t i = 0; i < entries.size(); ++i) {
+    image.push_back(entries[i].tokens_offset);
+    image.push_back(entries[i].id_in_key_trie);
+  }
+  reverse_lookup_index_image_.assign(
+      reinterpret_cast<const char *>(image.data()),
+      image.size() * sizeof(int32));
+}
+
 }  // namespace dictionary
 }  // namespace mozc
@@ -69,6 +69,15 @@ class SystemDictionaryBuilder {
   SystemDictionaryBuilder(const SystemDictionaryCodecInterface *codec,
                           const DictionaryFileCodecInterface *file_codec);
   virtual ~SystemDictionaryBuilder();
+
+  // Accumulates corpus statistics for frequency-ordered child placement in
+  // the key trie.  |key| is a raw (pre-encoding) reading observed |count|
+  // times in a corpus.  When any frequency is registered, the key trie
+  // places siblings in descending frequency order of their edge labels so
+  // lookups reach hot children with fewer sibling advances.  Must be called
+  // before BuildFromTokens().
+  void AddKeyFrequency(const string &key, uint64 count);
+
   void BuildFromTokens(const std::vector<Token *> &tokens);
 
   void WriteToFile(const string &output_file) const;
@@ -89,6 +98,8 @@ class SystemDictionaryBuilder {
 
   void BuildTokenArray(const KeyInfoList &key_info_list);
 
+  void BuildReverseLookupIndexImage(const KeyInfoList &key_info_list);
+
   void SetIdForValue(KeyInfoList *key_info_list) const;
   void SetIdForKey(KeyInfoList *key_info_list) const;
   void SortTokenInfo(KeyInfoList *key_info_list) const;
@@ -102,6 +113,14 @@ class SystemDictionaryBuilder {
   std::unique_ptr<mozc::storage::louds::BitVectorBasedArrayBuilder>
       token_array_builder_;
 
+  // Serialized precomputed reverse lookup index.  See
+  // BuildReverseLookupIndexImage for the layout.
+  string reverse_lookup_index_image_;
+
+  // Per-label (encoded byte) frequency for the key trie, accumulated by
+  // AddKeyFrequency().  Empty when no corpus statistics are given.
+  std::vector<uint64> key_label_frequency_;
+
   // mapping from {left_id, right_id} to POS index (0--255)
   std::map<uint32, int> frequent_pos_;
 
@@ -537,6 +537,122 @@ TEST_F(SystemDictionaryTest, LookupPrefix) {
   }
 }
 
+namespace {
+
+// Records every token with the start position reported through
+// OnStartPosition(); optionally skips one start position.
+class LookupPrefixBatchTestCallback
+    : public SystemDictionary::PrefixBatchCallback {
+ public:
+  explicit LookupPrefixBatchTestCallback(size_t skip_pos = string::npos)
+      : pos_(0), skip_pos_(skip_pos) {}
+
+  virtual bool OnStartPosition(size_t pos) {
+    pos_ = pos;
+    return pos != skip_pos_;
+  }
+
+  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
+                             const Token &token) {
+    Record(pos_, token);
+    return TRAVERSE_CONTINUE;
+  }
+
+  void Record(size_t pos, const Token &token) {
+    result_.insert(Util::StringPrintf("%d:%s:%s", static_cast<int>(pos),
+                                      token.key.c_str(), token.value.c_str()));
+  }
+
+  const std::set<string> &result() const { return result_; }
+
+ private:
+  size_t pos_;
+  const size_t skip_pos_;
+  std::set<string> result_;
+};
+
+// Adapter to collect the results of plain LookupPrefix() in the same format
+// as LookupPrefixBatchTestCallback, for comparison.
+class RecordTokenWithPosCallback : public SystemDictionary::Callback {
+ public:
+  RecordTokenWithPosCallback(size_t pos, LookupPrefixBatchTestCallback *target)
+      : pos_(pos), target_(target) {}
+
+  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
+                             const Token &token) {
+    target_->Record(pos_, token);
+    return TRAVERSE_CONTINUE;
+  }
+
+ private:
+  const size_t pos_;
+  LookupPrefixBatchTestCallback *target_;
+};
+
+}  // namespace
+
+TEST_F(SystemDictionaryTest, LookupPrefixBatch) {
+  struct {
+    const char *key;
+    const char *value;
+  } kKeyValues[] = {
+    { "あ", "亜" },
+    { "あい", "愛" },
+    { "い", "胃" },
+    { "いう", "言う" },
+    { "あいう", "藍雨" },
+    { "うえ", "上" },
+    { "え", "絵" },
+  };
+  const size_t kKeyValuesSize = arraysize(kKeyValues);
+  unique_ptr<Token> tokens[kKeyValuesSize];
+  std::vector<Token *> source_tokens(kKeyValuesSize);
+  for (size_t i = 0; i < kKeyValuesSize; ++i) {
+    tokens[i].reset(CreateToken(kKeyValues[i].key, kKeyValues[i].value));
+    source_tokens[i] = tokens[i].get();
+  }
+  text_dict_->CollectTokens(&source_tokens);
+  BuildSystemDictionary(source_tokens, kKeyValuesSize);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  const string kQuery = "あいうえ";
+
+  // One batch run must produce exactly the union of per-suffix LookupPrefix()
+  // runs, tagged with the start positions.
+  LookupPrefixBatchTestCallback batch_callback;
+  system_dic->LookupPrefixBatch(kQuery, convreq_, &batch_callback);
+
+  LookupPrefixBatchTestCallback expected_collector;
+  for (size_t pos = 0; pos < kQuery.size();
+       pos += Util::OneCharLen(kQuery.data() + pos)) {
+    RecordTokenWithPosCallback callback(pos, &expected_collector);
+    system_dic->LookupPrefix(StringPiece(kQuery).substr(pos), convreq_,
+                             &callback);
+  }
+  EXPECT_FALSE(batch_callback.result().empty());
+  EXPECT_EQ(expected_collector.result(), batch_callback.result());
+
+  // A start position for which OnStartPosition() returns false is skipped.
+  const size_t kSkippedPos =
+      Util::OneCharLen(kQuery.data());  // Position of "い".
+  LookupPrefixBatchTestCallback skipping_callback(kSkippedPos);
+  system_dic->LookupPrefixBatch(kQuery, convreq_, &skipping_callback);
+  const string skipped_prefix =
+      Util::StringPrintf("%d:", static_cast<int>(kSkippedPos));
+  for (std::set<string>::const_iterator iter = batch_callback.result().begin();
+       iter != batch_callback.result().end(); ++iter) {
+    const bool from_skipped_pos =
+        iter->compare(0, skipped_prefix.size(), skipped_prefix) == 0;
+    EXPECT_EQ(!from_skipped_pos,
+              skipping_callback.result().find(*iter) !=
+                  skipping_callback.result().end())
+        << *iter;
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupPredictive) {
   std::vector<Token *> tokens;
   ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
@@ -617,6 +733,124 @@ TEST_F(SystemDictionaryTest, LookupPredictive_CutOffEmulatingBFS) {
   EXPECT_FALSE(callback.IsFound(tokens[1]));
 }
 
+namespace {
+
+// Collects tokens while requesting traversal limits via GetPredictiveLimit().
+class LimitedCollectTokenCallback : public CollectTokenCallback {
+ public:
+  LimitedCollectTokenCallback(size_t max_keys, size_t max_tokens,
+                              size_t max_key_length_delta)
+      : max_keys_(max_keys),
+        max_tokens_(max_tokens),
+        max_key_length_delta_(max_key_length_delta) {}
+
+  PredictiveLimit GetPredictiveLimit() override {
+    PredictiveLimit limit;
+    limit.max_keys = max_keys_;
+    limit.max_tokens = max_tokens_;
+    limit.max_key_length_delta = max_key_length_delta_;
+    return limit;
+  }
+
+ private:
+  const size_t max_keys_;
+  const size_t max_tokens_;
+  const size_t max_key_length_delta_;
+};
+
+}  // namespace
+
+TEST_F(SystemDictionaryTest, LookupPredictive_CallbackLimits) {
+  std::vector<Token *> tokens;
+  ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
+
+  tokens.push_back(CreateToken("あ", "a"));
+  tokens.push_back(CreateToken("あい", "ai"));
+  tokens.push_back(CreateToken("あいう", "aiu"));
+  tokens.push_back(CreateToken("あいうえ", "aiue"));
+
+  BuildSystemDictionary(tokens, 100);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source: " << dic_fn_;
+
+  const size_t kUnlimited =
+      SystemDictionary::Callback::PredictiveLimit::kUnlimited;
+  {
+    // Bounding the key length delta cuts off keys longer by more than one
+    // character.
+    LimitedCollectTokenCallback callback(kUnlimited, kUnlimited, 1);
+    system_dic->LookupPredictive("あ", convreq_, &callback);
+    std::vector<Token *> expected(tokens.begin(), tokens.begin() + 2);
+    EXPECT_TOKENS_EQ_UNORDERED(expected, callback.tokens());
+  }
+  {
+    // The token budget stops the traversal after decoding two tokens.
+    LimitedCollectTokenCallback callback(kUnlimited, 2, kUnlimited);
+    system_dic->LookupPredictive("あ", convreq_, &callback);
+    EXPECT_EQ(2, callback.tokens().size());
+  }
+  {
+    // Zero keys means no traversal at all.
+    LimitedCollectTokenCallback callback(0, kUnlimited, kUnlimited);
+    system_dic->LookupPredictive("あ", convreq_, &callback);
+    EXPECT_TRUE(callback.tokens().empty());
+  }
+}
+
+namespace {
+
+// Collects tokens and records whether the traversal reported truncation.
+class TruncationRecordingCallback : public CollectTokenCallback {
+ public:
+  TruncationRecordingCallback() : truncated_(false) {}
+
+  void OnTruncated() override { truncated_ = true; }
+  bool truncated() const { return truncated_; }
+
+ private:
+  bool truncated_;
+};
+
+}  // namespace
+
+TEST_F(SystemDictionaryTest, LookupPredictive_TruncationIsReported) {
+  // A chain of keys あ, あか, あかか, ... deeper than the internal
+  // 64-key traversal cap.
+  const size_t kChainLength = 70;
+  std::vector<Token *> tokens;
+  ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
+  string key = "あ";
+  for (size_t i = 0; i < kChainLength; ++i) {
+    tokens.push_back(CreateToken(key, "value"));
+    key.append("か");
+  }
+
+  BuildSystemDictionary(tokens, tokens.size());
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source: " << dic_fn_;
+
+  {
+    // The cap leaves the deepest keys unvisited, so the result set is
+    // incomplete and the callback must be told.
+    TruncationRecordingCallback callback;
+    system_dic->LookupPredictive("あ", convreq_, &callback);
+    EXPECT_TRUE(callback.truncated());
+    EXPECT_LT(callback.tokens().size(), kChainLength);
+  }
+  {
+    // Twenty keys below the depth-50 prefix fit well within the cap.
+    TruncationRecordingCallback callback;
+    system_dic->LookupPredictive(tokens[kChainLength - 21]->key, convreq_,
+                                 &callback);
+    EXPECT_FALSE(callback.truncated());
+    EXPECT_EQ(21, callback.tokens().size());
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupExact) {
   std::vector<Token *> source_tokens;
 
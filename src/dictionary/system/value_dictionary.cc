@@ -108,7 +108,9 @@ inline DictionaryInterface::Callback::ResultType HandleTerminalNode(
   }
 
   FillToken(suggestion_only_word_id, *value, token);
-  return callback->OnToken(*value, *value, *token);
+  // |token| is re-filled by FillToken() before every call, so the callback
+  // may consume its string buffers.
+  return callback->OnConsumableToken(*value, *value, token);
 }
 
 }  // namespace
@@ -189,7 +191,7 @@ void ValueDictionary::LookupExact(
   }
   Token token;
   FillToken(suggestion_only_word_id_, key, &token);
-  callback->OnToken(key, key, token);
+  callback->OnConsumableToken(key, key, &token);
 }
 
 void ValueDictionary::LookupReverse(
@@ -34,6 +34,7 @@
 #include "dictionary/text_dictionary_loader.h"
 
 #include <algorithm>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
@@ -47,17 +48,36 @@
 #include "base/number_util.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 
 DEFINE_int32(tokens_reserve_size, 1400000,
              "Reserve the specified size of token buffer in advance.");
+DEFINE_int32(text_dictionary_loader_num_threads, 4,
+             "number of worker threads used to parse dictionary files.");
 
 namespace mozc {
 namespace dictionary {
 namespace {
 
+// Minimum number of lines for which the parallel parser is used; below
+// this the thread setup cost dominates the parse itself.
+const size_t kMinLinesForParallelParse = 10000;
+
+class ClosureThread : public Thread {
+ public:
+  explicit ClosureThread(std::function<void()> closure)
+      : closure_(std::move(closure)) {}
+  virtual void Run() { closure_(); }
+
+ private:
+  std::function<void()> closure_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClosureThread);
+};
+
 // Functor to sort a sequence of Tokens first by value and then by key.
 struct OrderByValueThenByKey {
   bool operator()(const Token *l, const Token *r) const {
@@ -178,12 +198,38 @@ void TextDictionaryLoader::LoadWithLineLimit(
   {
     InputMultiFile file(dictionary_filename);
     string line;
-    while (limit > 0 && file.ReadLine(&line)) {
-      Util::ChopReturns(&line);
-      Token *token = ParseTSVLine(line);
-      if (token) {
-        tokens_.push_back(token);
-        --limit;
+    if (limit == std::numeric_limits<int>::max()) {
+      // Full load: materialize the lines and parse them with worker
+      // threads.  The lines are accumulated into one contiguous buffer
+      // and referenced as StringPieces, instead of one heap-allocated
+      // string per line.  The explicit-limit path below keeps streaming
+      // line by line so that callers sampling a prefix of a huge file
+      // never read the rest of it.
+      string buffer;
+      std::vector<size_t> line_lengths;
+      line_lengths.reserve(FLAGS_tokens_reserve_size);
+      while (file.ReadLine(&line)) {
+        Util::ChopReturns(&line);
+        buffer.append(line);
+        line_lengths.push_back(line.size());
+      }
+      std::vector<StringPiece> lines;
+      lines.reserve(line_lengths.size());
+      size_t offset = 0;
+      for (size_t i = 0; i < line_lengths.size(); ++i) {
+        lines.push_back(StringPiece(buffer.data() + offset, line_lengths[i]));
+        offset += line_lengths[i];
+      }
+      ParseLines(lines);
+      limit -= static_cast<int>(tokens_.size());
+    } else {
+      while (limit > 0 && file.ReadLine(&line)) {
+        Util::ChopReturns(&line);
+        Token *token = ParseTSVLine(line);
+        if (token) {
+          tokens_.push_back(token);
+          --limit;
+        }
       }
     }
     LOG(INFO) << tokens_.size() << " tokens from " << dictionary_filename;
@@ -302,6 +348,47 @@ void TextDictionaryLoader::LoadReadingCorrectionTokens(
             << reading_correction_filename;
 }
 
+void TextDictionaryLoader::ParseLines(const std::vector<StringPiece> &lines) {
+  const int num_threads =
+      std::max(FLAGS_text_dictionary_loader_num_threads, 1);
+  if (num_threads <= 1 || lines.size() < kMinLinesForParallelParse) {
+    for (size_t i = 0; i < lines.size(); ++i) {
+      Token *token = ParseTSVLine(lines[i]);
+      if (token) {
+        tokens_.push_back(token);
+      }
+    }
+    return;
+  }
+
+  // Parse contiguous chunks of lines on worker threads into per-chunk
+  // buffers, then concatenate the buffers in input order; the result is
+  // identical to parsing sequentially.  ParseTSV() implementations must
+  // be thread-safe.
+  std::vector<std::vector<Token *> > chunk_tokens(num_threads);
+  std::vector<std::unique_ptr<ClosureThread> > threads;
+  for (int t = 0; t < num_threads; ++t) {
+    const size_t begin = lines.size() * t / num_threads;
+    const size_t end = lines.size() * (t + 1) / num_threads;
+    std::vector<Token *> *chunk = &chunk_tokens[t];
+    threads.emplace_back(new ClosureThread([this, &lines, begin, end, chunk] {
+      chunk->reserve(end - begin);
+      for (size_t i = begin; i < end; ++i) {
+        Token *token = ParseTSVLine(lines[i]);
+        if (token) {
+          chunk->push_back(token);
+        }
+      }
+    }));
+    threads.back()->Start("TextDictionaryLoader");
+  }
+  for (int t = 0; t < num_threads; ++t) {
+    threads[t]->Join();
+    tokens_.insert(tokens_.end(), chunk_tokens[t].begin(),
+                   chunk_tokens[t].end());
+  }
+}
+
 void TextDictionaryLoader::Clear() {
   STLDeleteElements(&tokens_);
 }
@@ -85,6 +85,8 @@ class TextDictionaryLoader {
 
  protected:
   // Allows derived classes to implement custom filtering rules.
+  // Implementations must be thread-safe: full loads parse the input lines
+  // on several worker threads; see ParseLines().
   virtual Token *ParseTSV(const std::vector<StringPiece> &columns) const;
 
  private:
@@ -104,6 +106,11 @@ class TextDictionaryLoader {
 
   Token *ParseTSVLine(StringPiece line) const;
 
+  // Parses |lines| into |tokens_|, using worker threads for large inputs.
+  // The resulting token order is identical to parsing the lines one by
+  // one in input order.
+  void ParseLines(const std::vector<StringPiece> &lines);
+
   const uint16 zipcode_id_;
   const uint16 isolated_word_id_;
   std::vector<Token *> tokens_;
@@ -233,6 +233,35 @@ TEST_F(TextDictionaryLoaderTest, LoadMultipleFilesTest) {
   FileUtil::Unlink(filename2);
 }
 
+TEST_F(TextDictionaryLoaderTest, ParallelLoadTest) {
+  const string filename =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "test_parallel.tsv");
+
+  // Large enough to take the multi-threaded parse path of a full load.
+  const int kNumLines = 12000;
+  {
+    OutputFileStream ofs(filename.c_str());
+    for (int i = 0; i < kNumLines; ++i) {
+      ofs << "key" << i << "\t1\t2\t3\tvalue" << i << "\n";
+    }
+  }
+
+  {
+    unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
+    loader->Load(filename, "");
+    const std::vector<Token *> &tokens = loader->tokens();
+    ASSERT_EQ(kNumLines, tokens.size());
+    // Tokens must be in input order regardless of how the lines were
+    // sharded over worker threads.
+    for (int i = 0; i < kNumLines; ++i) {
+      EXPECT_EQ("key" + std::to_string(i), tokens[i]->key);
+      EXPECT_EQ("value" + std::to_string(i), tokens[i]->value);
+    }
+  }
+
+  FileUtil::Unlink(filename);
+}
+
 TEST_F(TextDictionaryLoaderTest, ReadingCorrectionTest) {
   unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
 
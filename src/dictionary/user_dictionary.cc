@@ -30,6 +30,7 @@
 #include "dictionary/user_dictionary.h"
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <memory>
 #include <set>
@@ -48,6 +49,7 @@
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary_snapshot.h"
 #include "dictionary/user_dictionary_storage.h"
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
@@ -58,25 +60,19 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
-struct OrderByKey {
-  bool operator()(const UserPOS::Token *token, StringPiece key) const {
-    return token->key < key;
-  }
-
-  bool operator()(StringPiece key, const UserPOS::Token *token) const {
-    return key < token->key;
-  }
-};
+// The snapshot is a cache of the protobuf file; it lives next to it.
+const char kSnapshotSuffix[] = ".snapshot";
 
-struct OrderByKeyPrefix {
-  bool operator()(const UserPOS::Token *token, StringPiece prefix) const {
-    return StringPiece(token->key).substr(0, prefix.size()) < prefix;
-  }
+// Incremented on every Swap(); see UserDictionary::generation().
+std::atomic<uint64> g_generation(0);
 
-  bool operator()(StringPiece prefix, const UserPOS::Token *token) const {
-    return prefix < StringPiece(token->key).substr(0, prefix.size());
-  }
-};
+// If UserDictionary is pretty big, we first remove the
+// current dictionary to save memory usage.
+#ifdef OS_ANDROID
+const size_t kVeryBigUserDictionarySize = 5000;
+#else
+const size_t kVeryBigUserDictionarySize = 100000;
+#endif
 
 struct OrderByKeyThenById {
   bool operator()(const UserPOS::Token *lhs, const UserPOS::Token *rhs) const {
@@ -121,31 +117,116 @@ void FillTokenFromUserPOSToken(const UserPOS::Token &user_pos_token,
 
 }  // namespace
 
-class UserDictionary::TokensIndex : public std::vector<UserPOS::Token *> {
+// Stores the user dictionary as a two-level index: unique readings sorted
+// by key, each holding the tokens of that reading sorted by POS id.
+// Lookups binary-search the key level only, so their cost doesn't grow
+// with the number of homonyms per reading, and a single entry can be
+// inserted or erased in place without rebuilding the whole index.
+class UserDictionary::TokensIndex {
  public:
+  struct KeyEntry {
+    string key;
+    std::vector<UserPOS::Token *> tokens;  // owned; sorted by POS id
+  };
+
+  typedef std::vector<KeyEntry>::const_iterator const_iterator;
+
   TokensIndex(const UserPOSInterface *user_pos,
               SuppressionDictionary *suppression_dictionary)
-      : user_pos_(user_pos),
+      : num_tokens_(0),
+        user_pos_(user_pos),
         suppression_dictionary_(suppression_dictionary) {}
 
   ~TokensIndex() {
     Clear();
   }
 
+  bool empty() const { return entries_.empty(); }
+  // Returns the number of tokens, not the number of unique keys.
+  size_t size() const { return num_tokens_; }
+
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+  // Returns the first entry whose key is not less than |key|.
+  const_iterator LowerBound(StringPiece key) const {
+    return std::lower_bound(entries_.begin(), entries_.end(), key,
+                            OrderByKey());
+  }
+
   void Clear() {
-    STLDeleteElements(this);
-    clear();
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      STLDeleteElements(&entries_[i].tokens);
+    }
+    entries_.clear();
+    num_tokens_ = 0;
+  }
+
+  // Creates a deep copy.  Used to prepare an incrementally updated index
+  // that is later published while lookups keep using the current one.
+  TokensIndex *Clone() const {
+    TokensIndex *clone = new TokensIndex(user_pos_, suppression_dictionary_);
+    clone->entries_.resize(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      clone->entries_[i].key = entries_[i].key;
+      clone->entries_[i].tokens.reserve(entries_[i].tokens.size());
+      for (size_t j = 0; j < entries_[i].tokens.size(); ++j) {
+        clone->entries_[i].tokens.push_back(
+            new UserPOS::Token(*entries_[i].tokens[j]));
+      }
+    }
+    clone->num_tokens_ = num_tokens_;
+    return clone;
+  }
+
+  // Inserts a copy of |token|, keeping the key level sorted and the token
+  // level ordered by POS id.
+  void InsertToken(const UserPOS::Token &token) {
+    std::vector<KeyEntry>::iterator it =
+        std::lower_bound(entries_.begin(), entries_.end(),
+                         StringPiece(token.key), OrderByKey());
+    if (it == entries_.end() || it->key != token.key) {
+      it = entries_.insert(it, KeyEntry());
+      it->key = token.key;
+    }
+    std::vector<UserPOS::Token *>::iterator pos = it->tokens.begin();
+    while (pos != it->tokens.end() && (*pos)->id <= token.id) {
+      ++pos;
+    }
+    it->tokens.insert(pos, new UserPOS::Token(token));
+    ++num_tokens_;
+  }
+
+  // Erases all tokens with |key| and |value| and returns the number of
+  // erased tokens.  The entry is removed when its last token goes.
+  size_t EraseTokens(StringPiece key, StringPiece value) {
+    std::vector<KeyEntry>::iterator it =
+        std::lower_bound(entries_.begin(), entries_.end(), key, OrderByKey());
+    if (it == entries_.end() || it->key != key) {
+      return 0;
+    }
+    size_t num_erased = 0;
+    for (size_t i = 0; i < it->tokens.size(); ) {
+      if (it->tokens[i]->value == value) {
+        delete it->tokens[i];
+        it->tokens.erase(it->tokens.begin() + i);
+        ++num_erased;
+      } else {
+        ++i;
+      }
+    }
+    if (it->tokens.empty()) {
+      entries_.erase(it);
+    }
+    num_tokens_ -= num_erased;
+    return num_erased;
   }
 
   void Load(const user_dictionary::UserDictionaryStorage &storage) {
-    Clear();
+    BeginLoad();
     std::set<uint64> seen;
     std::vector<UserPOS::Token> tokens;
-
-    if (!suppression_dictionary_->IsLocked()) {
-      LOG(ERROR) << "SuppressionDictionary must be locked first";
-    }
-    suppression_dictionary_->Clear();
+    std::vector<UserPOS::Token *> all_tokens;
 
     for (size_t i = 0; i < storage.dictionaries_size(); ++i) {
       const UserDictionaryStorage::UserDictionary &dic =
@@ -155,74 +236,154 @@ class UserDictionary::TokensIndex : public std::vector<UserPOS::Token *> {
       }
 
       for (size_t j = 0; j < dic.entries_size(); ++j) {
-        const UserDictionaryStorage::UserDictionaryEntry &entry =
-            dic.entries(j);
+        AddEntry(dic.entries(j), &seen, &tokens, &all_tokens);
+      }
+    }
 
-        if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
-          continue;
-        }
+    EndLoad(&all_tokens);
+  }
+
+  // Loads from a mapped snapshot.  Each record is materialized into one
+  // reusable protobuf entry, so validation and token generation are
+  // identical to the protobuf path but the snapshot itself is never
+  // parsed or copied as a whole.
+  void Load(const UserDictionarySnapshot &snapshot) {
+    BeginLoad();
+    std::set<uint64> seen;
+    std::vector<UserPOS::Token> tokens;
+    std::vector<UserPOS::Token *> all_tokens;
+
+    UserDictionaryStorage::UserDictionaryEntry proto_entry;
+    UserDictionarySnapshot::Entry entry;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+      if (!snapshot.Get(i, &entry)) {
+        break;
+      }
+      proto_entry.set_key(entry.key.data(), entry.key.size());
+      proto_entry.set_value(entry.value.data(), entry.value.size());
+      proto_entry.set_comment(entry.comment.data(), entry.comment.size());
+      proto_entry.set_pos(entry.pos);
+      AddEntry(proto_entry, &seen, &tokens, &all_tokens);
+    }
 
-        string tmp, reading;
-        UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
+    EndLoad(&all_tokens);
+  }
 
-        // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
-        // because the normalization is user-visible.
-        // http://b/2480844
-        Util::NormalizeVoicedSoundMark(tmp, &reading);
+ private:
+  void BeginLoad() {
+    Clear();
+    if (!suppression_dictionary_->IsLocked()) {
+      LOG(ERROR) << "SuppressionDictionary must be locked first";
+    }
+    suppression_dictionary_->Clear();
+  }
 
-        DCHECK_LE(0, entry.pos());
+  // Validates, normalizes and dedups one storage entry, then appends its
+  // generated tokens to |all_tokens| (or adds the entry to the
+  // suppression dictionary).  |seen| carries the dedup fingerprints and
+  // |tokens| is a scratch buffer reused across calls.
+  void AddEntry(const UserDictionaryStorage::UserDictionaryEntry &entry,
+                std::set<uint64> *seen,
+                std::vector<UserPOS::Token> *tokens,
+                std::vector<UserPOS::Token *> *all_tokens) {
+    if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
+      return;
+    }
+
+    string tmp, reading;
+    UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
+
+    // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
+    // because the normalization is user-visible.
+    // http://b/2480844
+    Util::NormalizeVoicedSoundMark(tmp, &reading);
+
+    DCHECK_LE(0, entry.pos());
 MOZC_CLANG_PUSH_WARNING();
 #if MOZC_CLANG_HAS_WARNING(tautological-constant-out-of-range-compare)
 MOZC_CLANG_DISABLE_WARNING(tautological-constant-out-of-range-compare);
 #endif  // MOZC_CLANG_HAS_WARNING(tautological-constant-out-of-range-compare)
-        DCHECK_LE(entry.pos(), 255);
+    DCHECK_LE(entry.pos(), 255);
 MOZC_CLANG_POP_WARNING();
-        const uint64 fp = Hash::Fingerprint(reading +
-                                            "\t" +
-                                            entry.value() +
-                                            "\t" +
-                                            static_cast<char>(entry.pos()));
-        if (!seen.insert(fp).second) {
-          VLOG(1) << "Found dup item";
-          continue;
-        }
+    const uint64 fp = Hash::Fingerprint(reading +
+                                        "\t" +
+                                        entry.value() +
+                                        "\t" +
+                                        static_cast<char>(entry.pos()));
+    if (!seen->insert(fp).second) {
+      VLOG(1) << "Found dup item";
+      return;
+    }
 
-        // "抑制単語"
-        if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
-          suppression_dictionary_->AddEntry(reading, entry.value());
-        } else {
-          tokens.clear();
-          user_pos_->GetTokens(
-              reading, entry.value(),
-              UserDictionaryUtil::GetStringPosType(entry.pos()), &tokens);
-          for (size_t k = 0; k < tokens.size(); ++k) {
-            this->push_back(new UserPOS::Token(tokens[k]));
-            Util::StripWhiteSpaces(entry.comment(), &this->back()->comment);
-          }
-        }
+    // "抑制単語"
+    if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
+      suppression_dictionary_->AddEntry(reading, entry.value());
+    } else {
+      tokens->clear();
+      user_pos_->GetTokens(
+          reading, entry.value(),
+          UserDictionaryUtil::GetStringPosType(entry.pos()), tokens);
+      for (size_t k = 0; k < tokens->size(); ++k) {
+        all_tokens->push_back(new UserPOS::Token((*tokens)[k]));
+        Util::StripWhiteSpaces(entry.comment(), &all_tokens->back()->comment);
       }
     }
+  }
 
-    // Sort first by key and then by POS ID.
-    std::sort(this->begin(), this->end(), OrderByKeyThenById());
+  // Takes ownership of |all_tokens|, groups them into the index, and
+  // unlocks the suppression dictionary.
+  void EndLoad(std::vector<UserPOS::Token *> *all_tokens) {
+    // Sort first by key and then by POS ID, then group the tokens of each
+    // key into one entry.
+    std::sort(all_tokens->begin(), all_tokens->end(), OrderByKeyThenById());
+    for (size_t i = 0; i < all_tokens->size(); ++i) {
+      if (entries_.empty() || entries_.back().key != (*all_tokens)[i]->key) {
+        entries_.push_back(KeyEntry());
+        entries_.back().key = (*all_tokens)[i]->key;
+      }
+      entries_.back().tokens.push_back((*all_tokens)[i]);
+    }
+    num_tokens_ = all_tokens->size();
 
     suppression_dictionary_->UnLock();
 
-    VLOG(1) << this->size() << " user dic entries loaded";
+    VLOG(1) << num_tokens_ << " user dic entries loaded";
 
     usage_stats::UsageStats::SetInteger("UserRegisteredWord",
-                                        static_cast<int>(this->size()));
+                                        static_cast<int>(num_tokens_));
   }
 
- private:
+  struct OrderByKey {
+    bool operator()(const KeyEntry &entry, StringPiece key) const {
+      return entry.key < key;
+    }
+
+    bool operator()(StringPiece key, const KeyEntry &entry) const {
+      return key < entry.key;
+    }
+  };
+
+  std::vector<KeyEntry> entries_;
+  size_t num_tokens_;
   const UserPOSInterface *user_pos_;
   SuppressionDictionary *suppression_dictionary_;
+
+  DISALLOW_COPY_AND_ASSIGN(TokensIndex);
 };
 
+// Loads the user dictionary storage off-thread and publishes the result
+// through UserDictionary::Swap().  Requests arriving while a load is in
+// flight are coalesced into one pending request that the running thread
+// picks up right after publishing, so callers never block and no request
+// is dropped.
 class UserDictionary::UserDictionaryReloader : public Thread {
  public:
   explicit UserDictionaryReloader(UserDictionary *dic)
-      : modified_at_(0), auto_register_mode_(false), dic_(dic) {
+      : modified_at_(0),
+        reload_pending_(false),
+        running_(false),
+        auto_register_mode_(false),
+        dic_(dic) {
     DCHECK(dic_);
   }
 
@@ -230,21 +391,36 @@ class UserDictionary::UserDictionaryReloader : public Thread {
     Join();
   }
 
-  void StartAutoRegistration(const string &key,
+  // Returns false when a previous auto registration is still queued;
+  // accepting another one would overwrite and silently drop it.
+  bool StartAutoRegistration(const string &key,
                              const string &value,
                              user_dictionary::UserDictionary::PosType pos) {
+    bool needs_start = false;
     {
       scoped_lock l(&mutex_);
+      if (auto_register_mode_) {
+        return false;
+      }
       auto_register_mode_ = true;
       key_ = key;
       value_ = value;
       pos_ = pos;
+      reload_pending_ = true;
+      if (!running_) {
+        running_ = true;
+        needs_start = true;
+      }
     }
-    Start("UserDictionaryReloader");
+    if (needs_start) {
+      StartAfterReapingLastRun();
+    }
+    return true;
   }
 
-  // When the user dictionary exists AND the modification time has been updated,
-  // reloads the dictionary.  Returns true when reloader thread is started.
+  // When the user dictionary exists AND the modification time has been
+  // updated, requests a reload.  Returns true when the request was either
+  // started or queued behind the load currently in flight.
   bool MaybeStartReload() {
     FileTimeStamp modification_time;
     if (!FileUtil::GetModificationTime(
@@ -260,41 +436,126 @@ class UserDictionary::UserDictionaryReloader : public Thread {
       return false;
     }
     modified_at_ = modification_time;
-    Start("UserDictionaryReloader");
+    bool needs_start = false;
+    {
+      scoped_lock l(&mutex_);
+      reload_pending_ = true;
+      if (!running_) {
+        running_ = true;
+        needs_start = true;
+      }
+    }
+    if (needs_start) {
+      StartAfterReapingLastRun();
+    }
     return true;
   }
 
   void Run() override {
-    std::unique_ptr<UserDictionaryStorage> storage(new UserDictionaryStorage(
-        Singleton<UserDictionaryFileManager>::get()->GetFileName()));
+    for (;;) {
+      bool auto_register_mode;
+      string key, value;
+      user_dictionary::UserDictionary::PosType pos =
+          user_dictionary::UserDictionary::NOUN;
+      {
+        scoped_lock l(&mutex_);
+        if (!reload_pending_) {
+          // |running_| must be cleared under the same lock that the next
+          // request checks; otherwise that request could see the thread
+          // as alive and queue work nobody consumes.
+          running_ = false;
+          return;
+        }
+        reload_pending_ = false;
+        auto_register_mode = auto_register_mode_;
+        auto_register_mode_ = false;
+        key = key_;
+        value = value_;
+        pos = pos_;
+      }
 
-    // Load from file
-    if (!storage->Load()) {
-      return;
-    }
+      const string filename =
+          Singleton<UserDictionaryFileManager>::get()->GetFileName();
+
+      if (!auto_register_mode) {
+        // Fast path: reuse the snapshot written after the last protobuf
+        // load when it still matches the file, skipping the protobuf
+        // parse entirely.  Auto registration must go through the storage
+        // because it modifies the file.
+        FileTimeStamp modification_time;
+        UserDictionarySnapshot snapshot;
+        if (FileUtil::GetModificationTime(filename, &modification_time) &&
+            snapshot.Open(filename + kSnapshotSuffix, modification_time)) {
+          VLOG(1) << "Reloading user dictionary from snapshot";
+          dic_->Load(snapshot);
+          continue;
+        }
+      }
+
+      std::unique_ptr<UserDictionaryStorage> storage(
+          new UserDictionaryStorage(filename));
 
-    if (storage->ConvertSyncDictionariesToNormalDictionaries()) {
-      LOG(INFO) << "Syncable dictionaries are converted to normal dictionaries";
-      if (storage->Lock()) {
-        storage->Save();
-        storage->UnLock();
+      // Load from file
+      if (!storage->Load()) {
+        continue;
       }
+
+      if (storage->ConvertSyncDictionariesToNormalDictionaries()) {
+        LOG(INFO)
+            << "Syncable dictionaries are converted to normal dictionaries";
+        if (storage->Lock()) {
+          storage->Save();
+          storage->UnLock();
+        }
+      }
+
+      if (auto_register_mode) {
+        if (!storage->AddToAutoRegisteredDictionary(key, value, pos)) {
+          LOG(ERROR) << "failed to execute AddToAutoRegisteredDictionary";
+          continue;
+        }
+        // Insert the registered word into a copy of the current index
+        // instead of rebuilding everything from the storage.  Suppression
+        // words must take the full load below because they live in the
+        // suppression dictionary, not in the tokens index.
+        if (pos != user_dictionary::UserDictionary::SUPPRESSION_WORD &&
+            dic_->ApplyAutoRegisteredEntry(key, value, pos)) {
+          WriteSnapshot(*storage, filename);
+          continue;
+        }
+      }
+
+      dic_->Load(*(storage.get()));
+      WriteSnapshot(*storage, filename);
     }
+  }
 
-    if (auto_register_mode_ &&
-        !storage->AddToAutoRegisteredDictionary(key_, value_, pos_)) {
-      LOG(ERROR) << "failed to execute AddToAutoRegisteredDictionary";
-      auto_register_mode_ = false;
+ private:
+  // Rebuilds the snapshot used by the fast path above, keyed by the
+  // current modification time of the protobuf file.  Failures only cost
+  // the fast path of the next reload.
+  static void WriteSnapshot(const UserDictionaryStorage &storage,
+                            const string &filename) {
+    FileTimeStamp modification_time;
+    if (!FileUtil::GetModificationTime(filename, &modification_time)) {
       return;
     }
+    UserDictionarySnapshot::Write(storage, modification_time,
+                                  filename + kSnapshotSuffix);
+  }
 
-    auto_register_mode_ = false;
-    dic_->Load(*(storage.get()));
+  // The previous run may still be past its final |running_| update but not
+  // yet off the stack; Join() reaps it so that Start() is safe.
+  void StartAfterReapingLastRun() {
+    Join();
+    Start("UserDictionaryReloader");
   }
 
- private:
   FileTimeStamp modified_at_;
   Mutex mutex_;
+  // Guarded by |mutex_|.
+  bool reload_pending_;
+  bool running_;
   bool auto_register_mode_;
   UserDictionary *dic_;
   string key_;
@@ -312,8 +573,8 @@ UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
       user_pos_(user_pos),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
-      tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)),
-      mutex_(new ReaderWriterMutex) {
+      tokens_(std::make_shared<TokensIndex>(user_pos_.get(),
+                                            suppression_dictionary)) {
   DCHECK(user_pos_.get());
   DCHECK(suppression_dictionary_);
   Reload();
@@ -321,7 +582,6 @@ UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
 
 UserDictionary::~UserDictionary() {
   reloader_->Join();
-  delete tokens_;
 }
 
 bool UserDictionary::HasKey(StringPiece key) const {
@@ -343,13 +603,13 @@ void UserDictionary::LookupPredictive(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
+  const std::shared_ptr<const TokensIndex> tokens = std::atomic_load(&tokens_);
 
   if (key.empty()) {
     VLOG(2) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
@@ -358,11 +618,9 @@ void UserDictionary::LookupPredictive(
 
   // Find the starting point of iteration over dictionary contents.
   Token token;
-  for (auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                     OrderByKeyPrefix());
-       range.first != range.second; ++range.first) {
-    const UserPOS::Token &user_pos_token = **range.first;
-    switch (callback->OnKey(user_pos_token.key)) {
+  for (auto it = tokens->LowerBound(key);
+       it != tokens->end() && Util::StartsWith(it->key, key); ++it) {
+    switch (callback->OnKey(it->key)) {
       case Callback::TRAVERSE_DONE:
         return;
       case Callback::TRAVERSE_NEXT_KEY:
@@ -371,14 +629,20 @@ void UserDictionary::LookupPredictive(
       default:
         break;
     }
-    FillTokenFromUserPOSToken(user_pos_token, &token);
-    // Override POS IDs for suggest only words.
-    if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
-      token.lid = token.rid = pos_matcher_.GetUnknownId();
-    }
-    if (callback->OnToken(user_pos_token.key, user_pos_token.key, token) ==
-        Callback::TRAVERSE_DONE) {
-      return;
+    for (size_t i = 0; i < it->tokens.size(); ++i) {
+      const UserPOS::Token &user_pos_token = *it->tokens[i];
+      FillTokenFromUserPOSToken(user_pos_token, &token);
+      // Override POS IDs for suggest only words.
+      if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
+        token.lid = token.rid = pos_matcher_.GetUnknownId();
+      }
+      // |token| is re-filled by FillTokenFromUserPOSToken() on every
+      // iteration, so the callback may consume its string buffers.
+      if (callback->OnConsumableToken(
+              user_pos_token.key, user_pos_token.key, &token) ==
+          Callback::TRAVERSE_DONE) {
+        return;
+      }
     }
   }
 }
@@ -388,13 +652,13 @@ void UserDictionary::LookupPrefix(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
+  const std::shared_ptr<const TokensIndex> tokens = std::atomic_load(&tokens_);
 
   if (key.empty()) {
     LOG(WARNING) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
@@ -404,20 +668,25 @@ void UserDictionary::LookupPrefix(
   // Find the starting point for iteration over dictionary contents.
   const StringPiece first_char = key.substr(0, Util::OneCharLen(key.data()));
   Token token;
-  for (auto it = std::lower_bound(tokens_->begin(), tokens_->end(), first_char,
-                                  OrderByKey());
-       it != tokens_->end(); ++it) {
-    const UserPOS::Token &user_pos_token = **it;
-    if (user_pos_token.key > key) {
+  for (auto it = tokens->LowerBound(first_char); it != tokens->end(); ++it) {
+    if (it->key > key) {
       break;
     }
-    if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
+    if (!Util::StartsWith(key, it->key)) {
       continue;
     }
-    if (!Util::StartsWith(key, user_pos_token.key)) {
+    // Keys whose tokens are all suggest-only are not announced.
+    bool has_valid_token = false;
+    for (size_t i = 0; i < it->tokens.size(); ++i) {
+      if (!pos_matcher_.IsSuggestOnlyWord(it->tokens[i]->id)) {
+        has_valid_token = true;
+        break;
+      }
+    }
+    if (!has_valid_token) {
       continue;
     }
-    switch (callback->OnKey(user_pos_token.key)) {
+    switch (callback->OnKey(it->key)) {
       case Callback::TRAVERSE_DONE:
         return;
       case Callback::TRAVERSE_NEXT_KEY:
@@ -428,15 +697,22 @@ void UserDictionary::LookupPrefix(
       default:
         break;
     }
-    FillTokenFromUserPOSToken(user_pos_token, &token);
-    switch (callback->OnToken(user_pos_token.key, user_pos_token.key, token)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "UserDictionary doesn't support culling.";
-        break;
-      default:
-        break;
+    for (size_t i = 0; i < it->tokens.size(); ++i) {
+      const UserPOS::Token &user_pos_token = *it->tokens[i];
+      if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
+        continue;
+      }
+      FillTokenFromUserPOSToken(user_pos_token, &token);
+      switch (callback->OnConsumableToken(
+          user_pos_token.key, user_pos_token.key, &token)) {
+        case Callback::TRAVERSE_DONE:
+          return;
+        case Callback::TRAVERSE_CULL:
+          LOG(FATAL) << "UserDictionary doesn't support culling.";
+          break;
+        default:
+          break;
+      }
     }
   }
 }
@@ -445,14 +721,13 @@ void UserDictionary::LookupExact(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
-  if (key.empty() || tokens_->empty() ||
+  const std::shared_ptr<const TokensIndex> tokens = std::atomic_load(&tokens_);
+  if (key.empty() || tokens->empty() ||
       conversion_request.config().incognito_mode()) {
     return;
   }
-  auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                OrderByKey());
-  if (range.first == range.second) {
+  const auto it = tokens->LowerBound(key);
+  if (it == tokens->end() || it->key != key) {
     return;
   }
   if (callback->OnKey(key) != Callback::TRAVERSE_CONTINUE) {
@@ -460,13 +735,14 @@ void UserDictionary::LookupExact(
   }
 
   Token token;
-  for (; range.first != range.second; ++range.first) {
-    const UserPOS::Token &user_pos_token = **range.first;
+  for (size_t i = 0; i < it->tokens.size(); ++i) {
+    const UserPOS::Token &user_pos_token = *it->tokens[i];
     if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
       continue;
     }
     FillTokenFromUserPOSToken(user_pos_token, &token);
-    if (callback->OnToken(key, key, token) != Callback::TRAVERSE_CONTINUE) {
+    if (callback->OnConsumableToken(key, key, &token) !=
+        Callback::TRAVERSE_CONTINUE) {
       return;
     }
   }
@@ -485,16 +761,18 @@ bool UserDictionary::LookupComment(StringPiece key, StringPiece value,
     return false;
   }
 
-  scoped_reader_lock l(mutex_.get());
-  if (tokens_->empty()) {
+  const std::shared_ptr<const TokensIndex> tokens = std::atomic_load(&tokens_);
+  if (tokens->empty()) {
     return false;
   }
 
   // Set the comment that was found first.
-  for (auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                     OrderByKey());
-       range.first != range.second; ++range.first) {
-    const UserPOS::Token &token = **range.first;
+  const auto it = tokens->LowerBound(key);
+  if (it == tokens->end() || it->key != key) {
+    return false;
+  }
+  for (size_t i = 0; i < it->tokens.size(); ++i) {
+    const UserPOS::Token &token = *it->tokens[i];
     if (token.value == value && !token.comment.empty()) {
       comment->assign(token.comment);
       return true;
@@ -504,16 +782,11 @@ bool UserDictionary::LookupComment(StringPiece key, StringPiece value,
 }
 
 bool UserDictionary::Reload() {
-  if (reloader_->IsRunning()) {
-    return false;
-  }
-  suppression_dictionary_->Lock();
-  DCHECK(suppression_dictionary_->IsLocked());
-  // When the reloader is started, |suppression_dictionary_| is unlocked by the
-  // reloader.  When not started, need to unlock it here.
-  if (!reloader_->MaybeStartReload()) {
-    suppression_dictionary_->UnLock();
-  }
+  // The suppression dictionary is locked inside Load() only around the
+  // actual update, so suppression stays effective while the new index is
+  // built in the background.  Requests arriving during a running reload
+  // are coalesced by the reloader, so this never blocks.
+  reloader_->MaybeStartReload();
   return true;
 }
 
@@ -547,10 +820,6 @@ bool UserDictionary::AddToAutoRegisteredDictionary(
     const string &key, const string &value,
     const ConversionRequest &conversion_request,
     user_dictionary::UserDictionary::PosType pos) {
-  if (reloader_->IsRunning()) {
-    return false;
-  }
-
   FindValueCallback callback(value);
   LookupExact(key, conversion_request, &callback);
   if (callback.found()) {
@@ -558,55 +827,80 @@ bool UserDictionary::AddToAutoRegisteredDictionary(
     return false;
   }
 
-  suppression_dictionary_->Lock();
-  DCHECK(suppression_dictionary_->IsLocked());
-  reloader_->StartAutoRegistration(key, value, pos);
-
-  return true;
+  return reloader_->StartAutoRegistration(key, value, pos);
 }
 
 void UserDictionary::WaitForReloader() {
   reloader_->Join();
 }
 
-void UserDictionary::Swap(TokensIndex *new_tokens) {
+void UserDictionary::Swap(std::shared_ptr<const TokensIndex> new_tokens) {
   DCHECK(new_tokens);
-  TokensIndex *old_tokens = tokens_;
-  {
-    scoped_writer_lock l(mutex_.get());
-    tokens_ = new_tokens;
+  std::atomic_store(&tokens_, std::move(new_tokens));
+  ++g_generation;
+}
+
+uint64 UserDictionary::generation() {
+  return g_generation.load();
+}
+
+bool UserDictionary::ApplyAutoRegisteredEntry(
+    const string &key, const string &value,
+    user_dictionary::UserDictionary::PosType pos) {
+  string tmp, reading;
+  UserDictionaryUtil::NormalizeReading(key, &tmp);
+  Util::NormalizeVoicedSoundMark(tmp, &reading);
+
+  std::vector<UserPOS::Token> new_tokens;
+  if (!user_pos_->GetTokens(reading, value,
+                            UserDictionaryUtil::GetStringPosType(pos),
+                            &new_tokens) ||
+      new_tokens.empty()) {
+    return false;
   }
-  delete old_tokens;
+
+  const std::shared_ptr<const TokensIndex> current =
+      std::atomic_load(&tokens_);
+  std::shared_ptr<TokensIndex> updated(current->Clone());
+  for (size_t i = 0; i < new_tokens.size(); ++i) {
+    updated->InsertToken(new_tokens[i]);
+  }
+  Swap(std::move(updated));
+  return true;
 }
 
 bool UserDictionary::Load(
     const user_dictionary::UserDictionaryStorage &storage) {
-  size_t size = 0;
-  {
-    scoped_reader_lock l(mutex_.get());
-    size = tokens_->size();
+  const size_t size = std::atomic_load(&tokens_)->size();
+
+  if (size >= kVeryBigUserDictionarySize) {
+    Swap(std::make_shared<TokensIndex>(user_pos_.get(),
+                                       suppression_dictionary_));
   }
 
-  // If UserDictionary is pretty big, we first remove the
-  // current dictionary to save memory usage.
-#ifdef OS_ANDROID
-  const size_t kVeryBigUserDictionarySize = 5000;
-#else
-  const size_t kVeryBigUserDictionarySize = 100000;
-#endif
+  suppression_dictionary_->Lock();
+  std::shared_ptr<TokensIndex> tokens =
+      std::make_shared<TokensIndex>(user_pos_.get(), suppression_dictionary_);
+  tokens->Load(storage);  // |suppression_dictionary_| is unlocked in Load().
+  DCHECK(!suppression_dictionary_->IsLocked());
+  Swap(std::move(tokens));
+  return true;
+}
+
+bool UserDictionary::Load(const UserDictionarySnapshot &snapshot) {
+  const size_t size = std::atomic_load(&tokens_)->size();
 
   if (size >= kVeryBigUserDictionarySize) {
-    TokensIndex *dummy_empty_tokens = new TokensIndex(user_pos_.get(),
-                                                      suppression_dictionary_);
-    Swap(dummy_empty_tokens);
+    Swap(std::make_shared<TokensIndex>(user_pos_.get(),
+                                       suppression_dictionary_));
   }
 
   suppression_dictionary_->Lock();
-  TokensIndex *tokens = new TokensIndex(user_pos_.get(),
-                                        suppression_dictionary_);
-  tokens->Load(storage);  // |suppression_dictionary_| is unlocked in Load().
+  std::shared_ptr<TokensIndex> tokens =
+      std::make_shared<TokensIndex>(user_pos_.get(), suppression_dictionary_);
+  tokens->Load(snapshot);  // |suppression_dictionary_| is unlocked in Load().
   DCHECK(!suppression_dictionary_->IsLocked());
-  Swap(tokens);
+  Swap(std::move(tokens));
   return true;
 }
 
@@ -43,11 +43,10 @@
 #include "protocol/user_dictionary_storage.pb.h"
 
 namespace mozc {
-
-class ReaderWriterMutex;
-
 namespace dictionary {
 
+class UserDictionarySnapshot;
+
 class UserDictionary : public DictionaryInterface {
  public:
   UserDictionary(const UserPOSInterface *user_pos,
@@ -84,6 +83,10 @@ class UserDictionary : public DictionaryInterface {
   // mainly for unittesting
   bool Load(const user_dictionary::UserDictionaryStorage &storage);
 
+  // Loads dictionary from an opened snapshot without materializing the
+  // protobuf tree.
+  bool Load(const UserDictionarySnapshot &snapshot);
+
   // Reloads dictionary asynchronously
   bool Reload() override;
 
@@ -104,19 +107,36 @@ class UserDictionary : public DictionaryInterface {
   // Sets user dicitonary filename for unittesting
   static void SetUserDictionaryName(const string &filename);
 
+  // Returns a process-wide counter incremented every time a UserDictionary
+  // publishes a new tokens index (initial load, Reload(), auto
+  // registration).  Caches keyed on conversion inputs fold this into
+  // their keys so that results computed against an old dictionary image
+  // are not served after a reload.
+  static uint64 generation();
+
  private:
   class TokensIndex;
   class UserDictionaryReloader;
 
-  // Swaps internal tokens index to |new_tokens|.
-  void Swap(TokensIndex *new_tokens);
+  // Publishes |new_tokens| as the current tokens index.  The old index is
+  // released when the last lookup still reading it finishes.
+  void Swap(std::shared_ptr<const TokensIndex> new_tokens);
+
+  // Incrementally inserts the tokens of an auto registered word into a
+  // copy of the current index and publishes it, without reloading the
+  // whole storage.  Returns false when no token can be generated for the
+  // entry; the caller should fall back to a full load.
+  bool ApplyAutoRegisteredEntry(const string &key, const string &value,
+                                user_dictionary::UserDictionary::PosType pos);
 
   std::unique_ptr<UserDictionaryReloader> reloader_;
   std::unique_ptr<const UserPOSInterface> user_pos_;
   const POSMatcher pos_matcher_;
   SuppressionDictionary *suppression_dictionary_;
-  TokensIndex *tokens_;
-  mutable std::unique_ptr<ReaderWriterMutex> mutex_;
+  // Immutable snapshot of the tokens index.  Lookups take a reference via
+  // atomic_load and never block on reloads; reloads build a new index and
+  // publish it with Swap().
+  std::shared_ptr<const TokensIndex> tokens_;
 
   friend class UserDictionaryTest;
   DISALLOW_COPY_AND_ASSIGN(UserDictionary);
@@ -0,0 +1,244 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/user_dictionary_snapshot.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+// "MZUS" in little endian; bumped together with kSnapshotVersion whenever
+// the layout below changes, so old binaries simply fall back to the
+// protobuf file.
+const uint32 kSnapshotMagic = 0x53555a4d;
+const uint32 kSnapshotVersion = 1;
+
+// The file layout is SnapshotHeader, |num_entries| SnapshotRecords, then
+// the string pool.  All fields are in host byte order; a snapshot is a
+// local cache and is never copied between machines.
+struct SnapshotHeader {
+  uint32 magic;
+  uint32 version;
+  uint64 source_mtime;
+  uint32 num_entries;
+  uint32 string_pool_size;
+};
+
+// Fixed-layout record.  Offsets and lengths are in bytes and index the
+// string pool.
+struct SnapshotRecord {
+  uint32 key_offset;
+  uint32 key_length;
+  uint32 value_offset;
+  uint32 value_length;
+  uint32 comment_offset;
+  uint32 comment_length;
+  uint32 pos;
+};
+
+void AppendToPool(const string &str, string *pool,
+                  uint32 *offset, uint32 *length) {
+  *offset = static_cast<uint32>(pool->size());
+  *length = static_cast<uint32>(str.size());
+  pool->append(str);
+}
+
+}  // namespace
+
+UserDictionarySnapshot::UserDictionarySnapshot()
+    : num_entries_(0), records_(nullptr), string_pool_(nullptr) {}
+
+UserDictionarySnapshot::~UserDictionarySnapshot() {
+  Close();
+}
+
+bool UserDictionarySnapshot::Write(
+    const user_dictionary::UserDictionaryStorage &storage,
+    FileTimeStamp source_mtime,
+    const string &filename) {
+  std::vector<SnapshotRecord> records;
+  string pool;
+
+  for (int i = 0; i < storage.dictionaries_size(); ++i) {
+    const user_dictionary::UserDictionary &dic = storage.dictionaries(i);
+    if (!dic.enabled() || dic.entries_size() == 0) {
+      continue;
+    }
+    for (int j = 0; j < dic.entries_size(); ++j) {
+      const user_dictionary::UserDictionary::Entry &entry = dic.entries(j);
+      SnapshotRecord record;
+      AppendToPool(entry.key(), &pool,
+                   &record.key_offset, &record.key_length);
+      AppendToPool(entry.value(), &pool,
+                   &record.value_offset, &record.value_length);
+      AppendToPool(entry.comment(), &pool,
+                   &record.comment_offset, &record.comment_length);
+      record.pos = static_cast<uint32>(entry.pos());
+      records.push_back(record);
+    }
+  }
+
+  // The storage is capped far below 4GB, so this fires only on broken
+  // input; refuse to write a snapshot with wrapped offsets.
+  if (pool.size() > std::numeric_limits<uint32>::max()) {
+    LOG(ERROR) << "String pool is too big: " << pool.size();
+    return false;
+  }
+
+  SnapshotHeader header;
+  header.magic = kSnapshotMagic;
+  header.version = kSnapshotVersion;
+  header.source_mtime = static_cast<uint64>(source_mtime);
+  header.num_entries = static_cast<uint32>(records.size());
+  header.string_pool_size = static_cast<uint32>(pool.size());
+
+  const string tmp_file_name = filename + ".tmp";
+  {
+    OutputFileStream ofs(tmp_file_name.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      LOG(ERROR) << "cannot open file: " << tmp_file_name;
+      return false;
+    }
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!records.empty()) {
+      ofs.write(reinterpret_cast<const char *>(&records[0]),
+                records.size() * sizeof(records[0]));
+    }
+    ofs.write(pool.data(), pool.size());
+    if (!ofs.good()) {
+      LOG(ERROR) << "cannot write to file: " << tmp_file_name;
+      return false;
+    }
+  }
+
+  if (!FileUtil::AtomicRename(tmp_file_name, filename)) {
+    LOG(ERROR) << "AtomicRename failed: " << filename;
+    return false;
+  }
+  return true;
+}
+
+bool UserDictionarySnapshot::Open(const string &filename,
+                                  FileTimeStamp source_mtime) {
+  Close();
+
+  if (!mmap_.Open(filename.c_str(), "r")) {
+    VLOG(1) << "cannot open snapshot: " << filename;
+    return false;
+  }
+  if (mmap_.size() < sizeof(SnapshotHeader)) {
+    LOG(WARNING) << "snapshot is truncated: " << filename;
+    Close();
+    return false;
+  }
+
+  const SnapshotHeader *header =
+      reinterpret_cast<const SnapshotHeader *>(mmap_.begin());
+  if (header->magic != kSnapshotMagic ||
+      header->version != kSnapshotVersion) {
+    VLOG(1) << "snapshot has an incompatible format: " << filename;
+    Close();
+    return false;
+  }
+  if (header->source_mtime != static_cast<uint64>(source_mtime)) {
+    VLOG(1) << "snapshot is stale: " << filename;
+    Close();
+    return false;
+  }
+  const uint64 expected_size =
+      sizeof(SnapshotHeader) +
+      static_cast<uint64>(header->num_entries) * sizeof(SnapshotRecord) +
+      header->string_pool_size;
+  if (mmap_.size() != expected_size) {
+    LOG(WARNING) << "snapshot has an inconsistent size: " << filename;
+    Close();
+    return false;
+  }
+
+  num_entries_ = header->num_entries;
+  records_ = mmap_.begin() + sizeof(SnapshotHeader);
+  string_pool_ = records_ + num_entries_ * sizeof(SnapshotRecord);
+
+  // Validate every record up front so that Get() can hand out views
+  // without bounds checks on the lookup path.
+  const uint64 pool_size = header->string_pool_size;
+  for (size_t i = 0; i < num_entries_; ++i) {
+    const SnapshotRecord *record =
+        reinterpret_cast<const SnapshotRecord *>(records_) + i;
+    if (static_cast<uint64>(record->key_offset) + record->key_length >
+            pool_size ||
+        static_cast<uint64>(record->value_offset) + record->value_length >
+            pool_size ||
+        static_cast<uint64>(record->comment_offset) + record->comment_length >
+            pool_size ||
+        !user_dictionary::UserDictionary::PosType_IsValid(record->pos)) {
+      LOG(WARNING) << "snapshot has a broken record: " << filename;
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void UserDictionarySnapshot::Close() {
+  mmap_.Close();
+  num_entries_ = 0;
+  records_ = nullptr;
+  string_pool_ = nullptr;
+}
+
+bool UserDictionarySnapshot::Get(size_t index, Entry *entry) const {
+  if (index >= num_entries_) {
+    return false;
+  }
+  const SnapshotRecord *record =
+      reinterpret_cast<const SnapshotRecord *>(records_) + index;
+  entry->key = StringPiece(string_pool_ + record->key_offset,
+                           record->key_length);
+  entry->value = StringPiece(string_pool_ + record->value_offset,
+                             record->value_length);
+  entry->comment = StringPiece(string_pool_ + record->comment_offset,
+                               record->comment_length);
+  entry->pos =
+      static_cast<user_dictionary::UserDictionary::PosType>(record->pos);
+  return true;
+}
+
+}  // namespace dictionary
+}  // namespace mozc
@@ -0,0 +1,106 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_DICTIONARY_USER_DICTIONARY_SNAPSHOT_H_
+#define MOZC_DICTIONARY_USER_DICTIONARY_SNAPSHOT_H_
+
+#include <string>
+
+#include "base/file_util.h"
+#include "base/mmap.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "protocol/user_dictionary_storage.pb.h"
+
+namespace mozc {
+namespace dictionary {
+
+// Binary snapshot of the user dictionary for fast loading.
+//
+// UserDictionaryStorage::Load() parses the whole protobuf file into heap
+// memory, which takes hundreds of milliseconds for large dictionaries and
+// delays the first conversion after start.  A snapshot stores the entries
+// of the enabled dictionaries as fixed-layout records followed by a string
+// pool, so a reader can mmap the file and view each string in place
+// without parsing or copying.
+//
+// The protobuf file remains the canonical storage and import/export
+// format; a snapshot is merely a cache keyed by the modification time of
+// the protobuf file it was built from, and is rebuilt whenever it is
+// missing or stale.
+class UserDictionarySnapshot {
+ public:
+  // One dictionary entry.  The pieces view the mapped file directly and
+  // stay valid until Close() or destruction.
+  struct Entry {
+    StringPiece key;
+    StringPiece value;
+    StringPiece comment;
+    user_dictionary::UserDictionary::PosType pos;
+  };
+
+  UserDictionarySnapshot();
+  ~UserDictionarySnapshot();
+
+  // Writes the entries of all enabled dictionaries in |storage| to
+  // |filename|.  |source_mtime| must be the modification time of the
+  // protobuf file |storage| was loaded from; Open() uses it as the
+  // staleness key.  The snapshot is written to a temporary file and
+  // renamed, so readers never observe a partial file.
+  static bool Write(const user_dictionary::UserDictionaryStorage &storage,
+                    FileTimeStamp source_mtime,
+                    const string &filename);
+
+  // Maps |filename| and validates the whole structure, including every
+  // record's offsets and POS value.  Returns false when the file is
+  // missing, malformed, or was built from a protobuf file whose
+  // modification time differs from |source_mtime|.
+  bool Open(const string &filename, FileTimeStamp source_mtime);
+
+  void Close();
+
+  size_t size() const { return num_entries_; }
+
+  // Fills |entry| with views into the mapped file.  Returns false when
+  // |index| is out of range.
+  bool Get(size_t index, Entry *entry) const;
+
+ private:
+  Mmap mmap_;
+  size_t num_entries_;
+  const char *records_;
+  const char *string_pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(UserDictionarySnapshot);
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_USER_DICTIONARY_SNAPSHOT_H_
@@ -0,0 +1,157 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/user_dictionary_snapshot.h"
+
+#include <string>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "protocol/user_dictionary_storage.pb.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+DECLARE_string(test_tmpdir);
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+using user_dictionary::UserDictionary;
+using user_dictionary::UserDictionaryStorage;
+
+const FileTimeStamp kSourceMtime = 123456789;
+
+string GetSnapshotFile() {
+  return FileUtil::JoinPath(FLAGS_test_tmpdir, "test.db.snapshot");
+}
+
+void FillStorage(UserDictionaryStorage *storage) {
+  {
+    UserDictionary *dic = storage->add_dictionaries();
+    dic->set_enabled(true);
+    dic->set_name("enabled");
+    UserDictionary::Entry *entry = dic->add_entries();
+    // "きょうと", "京都"
+    entry->set_key("\xE3\x81\x8D\xE3\x82\x87\xE3\x81\x86\xE3\x81\xA8");
+    entry->set_value("\xE4\xBA\xAC\xE9\x83\xBD");
+    entry->set_pos(UserDictionary::NOUN);
+    entry->set_comment("comment");
+    entry = dic->add_entries();
+    // "おおさか", "大阪"
+    entry->set_key("\xE3\x81\x8A\xE3\x81\x8A\xE3\x81\x95\xE3\x81\x8B");
+    entry->set_value("\xE5\xA4\xA7\xE9\x98\xAA");
+    entry->set_pos(UserDictionary::PLACE_NAME);
+  }
+  {
+    // Disabled dictionaries must not be snapshotted.
+    UserDictionary *dic = storage->add_dictionaries();
+    dic->set_enabled(false);
+    dic->set_name("disabled");
+    UserDictionary::Entry *entry = dic->add_entries();
+    entry->set_key("\xE3\x81\x8D\xE3\x82\x87\xE3\x81\x86\xE3\x81\xA8");
+    entry->set_value("should not appear");
+    entry->set_pos(UserDictionary::NOUN);
+  }
+}
+
+class UserDictionarySnapshotTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FileUtil::Unlink(GetSnapshotFile());
+  }
+
+  void TearDown() override {
+    FileUtil::Unlink(GetSnapshotFile());
+  }
+};
+
+TEST_F(UserDictionarySnapshotTest, WriteThenOpen) {
+  UserDictionaryStorage storage;
+  FillStorage(&storage);
+  ASSERT_TRUE(UserDictionarySnapshot::Write(storage, kSourceMtime,
+                                            GetSnapshotFile()));
+
+  UserDictionarySnapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(GetSnapshotFile(), kSourceMtime));
+  ASSERT_EQ(2, snapshot.size());
+
+  UserDictionarySnapshot::Entry entry;
+  ASSERT_TRUE(snapshot.Get(0, &entry));
+  EXPECT_EQ(storage.dictionaries(0).entries(0).key(), entry.key);
+  EXPECT_EQ(storage.dictionaries(0).entries(0).value(), entry.value);
+  EXPECT_EQ("comment", entry.comment);
+  EXPECT_EQ(UserDictionary::NOUN, entry.pos);
+
+  ASSERT_TRUE(snapshot.Get(1, &entry));
+  EXPECT_EQ(storage.dictionaries(0).entries(1).key(), entry.key);
+  EXPECT_EQ(storage.dictionaries(0).entries(1).value(), entry.value);
+  EXPECT_TRUE(entry.comment.empty());
+  EXPECT_EQ(UserDictionary::PLACE_NAME, entry.pos);
+
+  EXPECT_FALSE(snapshot.Get(2, &entry));
+}
+
+TEST_F(UserDictionarySnapshotTest, EmptyStorage) {
+  UserDictionaryStorage storage;
+  ASSERT_TRUE(UserDictionarySnapshot::Write(storage, kSourceMtime,
+                                            GetSnapshotFile()));
+
+  UserDictionarySnapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(GetSnapshotFile(), kSourceMtime));
+  EXPECT_EQ(0, snapshot.size());
+}
+
+TEST_F(UserDictionarySnapshotTest, RejectsStaleSnapshot) {
+  UserDictionaryStorage storage;
+  FillStorage(&storage);
+  ASSERT_TRUE(UserDictionarySnapshot::Write(storage, kSourceMtime,
+                                            GetSnapshotFile()));
+
+  UserDictionarySnapshot snapshot;
+  EXPECT_FALSE(snapshot.Open(GetSnapshotFile(), kSourceMtime + 1));
+  EXPECT_EQ(0, snapshot.size());
+}
+
+TEST_F(UserDictionarySnapshotTest, RejectsMissingAndBrokenFile) {
+  UserDictionarySnapshot snapshot;
+  EXPECT_FALSE(snapshot.Open(GetSnapshotFile(), kSourceMtime));
+
+  // Neither a truncated file nor one with a foreign magic is accepted.
+  {
+    OutputFileStream ofs(GetSnapshotFile().c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    ofs << "broken";
+  }
+  EXPECT_FALSE(snapshot.Open(GetSnapshotFile(), kSourceMtime));
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
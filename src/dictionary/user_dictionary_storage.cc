@@ -88,6 +88,13 @@ bool UserDictionaryStorage::Exists() const {
 }
 
 bool UserDictionaryStorage::LoadInternal() {
+  // Repair a save interrupted while the file was being patched.
+  if (!FileUtil::RecoverPagedWrite(file_name_)) {
+    LOG(ERROR) << "cannot recover " << file_name_;
+    last_error_type_ = BROKEN_FILE;
+    return false;
+  }
+
   InputFileStream ifs(file_name_.c_str(), std::ios::binary);
   if (!ifs) {
     if (Exists()) {
@@ -161,31 +168,23 @@ bool UserDictionaryStorage::Save() {
     }
   }
 
-  const string tmp_file_name = file_name_ + ".tmp";
-  {
-    OutputFileStream ofs(tmp_file_name.c_str(),
-                         std::ios::out | std::ios::binary | std::ios::trunc);
-    if (!ofs) {
-      LOG(ERROR) << "cannot open file: " << tmp_file_name;
-      last_error_type_ = SYNC_FAILURE;
-      return false;
-    }
-
-    if (!SerializeToOstream(&ofs)) {
-      LOG(ERROR) << "SerializeToString failed";
-      last_error_type_ = SYNC_FAILURE;
-      return false;
-    }
+  string image;
+  if (!SerializeToString(&image)) {
+    LOG(ERROR) << "SerializeToString failed";
+    last_error_type_ = SYNC_FAILURE;
+    return false;
+  }
 
-    if (static_cast<size_t>(ofs.tellp()) >= kDefaultWarningTotalBytesLimit) {
-      LOG(ERROR) << "The file size exceeds " << kDefaultWarningTotalBytesLimit;
-      // continue "AtomicRename"
-      last_error_type_ = TOO_BIG_FILE_BYTES;
-    }
+  if (image.size() >= kDefaultWarningTotalBytesLimit) {
+    LOG(ERROR) << "The file size exceeds " << kDefaultWarningTotalBytesLimit;
+    // continue processing since the file is still saved below.
+    last_error_type_ = TOO_BIG_FILE_BYTES;
   }
 
-  if (!FileUtil::AtomicRename(tmp_file_name, file_name_)) {
-    LOG(ERROR) << "AtomicRename failed";
+  // Most saves change a few entries of a large dictionary, so only the
+  // dirty pages are rewritten.
+  if (!FileUtil::WritePaged(file_name_, image)) {
+    LOG(ERROR) << "WritePaged failed: " << file_name_;
     last_error_type_ = SYNC_FAILURE;
     return false;
   }
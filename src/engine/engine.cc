@@ -29,10 +29,14 @@
 
 #include "engine/engine.h"
 
+#include <functional>
 #include <utility>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/startup_stats.h"
+#include "base/thread.h"
 #include "converter/connector.h"
 #include "converter/converter.h"
 #include "converter/converter_interface.h"
@@ -69,6 +73,13 @@ using mozc::dictionary::UserDictionary;
 using mozc::dictionary::UserPOS;
 using mozc::dictionary::ValueDictionary;
 
+DEFINE_bool(share_dictionary_rank_directories, false,
+            "Place the rank directories of the system dictionary tries in a "
+            "named shared-memory segment, so that server processes opening "
+            "the same dictionary image share one physical copy.  Intended "
+            "for multi-seat hosts running many mozc_server processes; "
+            "ignored on platforms without shared memory support.");
+
 namespace mozc {
 namespace {
 
@@ -133,6 +144,24 @@ bool UserDataManagerImpl::Wait() {
   return predictor_->Wait();
 }
 
+// Runs a closure on its own thread; used to overlap the independent
+// phases of Engine::Init().
+class BackgroundInitThread final : public Thread {
+ public:
+  explicit BackgroundInitThread(std::function<void()> closure)
+      : closure_(std::move(closure)) {
+    SetJoinable(true);
+  }
+  ~BackgroundInitThread() override { Join(); }
+
+  void Run() override { closure_(); }
+
+ private:
+  std::function<void()> closure_;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundInitThread);
+};
+
 }  // namespace
 
 std::unique_ptr<Engine> Engine::CreateDesktopEngine(
@@ -166,6 +195,36 @@ void Engine::Init(
   CHECK(data_manager);
   CHECK(predictor_factory);
 
+  ScopedStartupTimer timer("Engine::Init");
+
+  // The structures below are independent views over the mmapped data
+  // set, so the heavy ones are built on worker threads which are
+  // joined right before their results are first used; the cheap ones
+  // are built on this thread meanwhile.
+  const char *dictionary_data = NULL;
+  int dictionary_size = 0;
+  data_manager->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
+
+  SystemDictionary *sysdic = NULL;
+  BackgroundInitThread sysdic_thread(
+      [&sysdic, dictionary_data, dictionary_size] {
+        // Building the system dictionary dominates Engine::Init; record
+        // it as its own phase.
+        ScopedStartupTimer dictionary_timer("SystemDictionary::Build");
+        SystemDictionary::Builder builder(dictionary_data, dictionary_size);
+        if (FLAGS_share_dictionary_rank_directories) {
+          builder.SetOptions(SystemDictionary::SHARE_RANK_DIRECTORIES);
+        }
+        sysdic = builder.Build();
+      });
+  sysdic_thread.Start("SystemDictionaryBuild");
+
+  BackgroundInitThread lattice_thread([this, data_manager] {
+    connector_.reset(Connector::CreateFromDataManager(*data_manager));
+    segmenter_.reset(Segmenter::CreateFromDataManager(*data_manager));
+  });
+  lattice_thread.Start("ConnectorSegmenterBuild");
+
   suppression_dictionary_.reset(new SuppressionDictionary);
   CHECK(suppression_dictionary_.get());
 
@@ -178,20 +237,6 @@ void Engine::Init(
                          suppression_dictionary_.get()));
   CHECK(user_dictionary_.get());
 
-  const char *dictionary_data = NULL;
-  int dictionary_size = 0;
-  data_manager->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
-
-  SystemDictionary *sysdic =
-      SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
-  dictionary_.reset(new DictionaryImpl(
-      sysdic,  // DictionaryImpl takes the ownership
-      new ValueDictionary(*pos_matcher_, &sysdic->value_trie()),
-      user_dictionary_.get(),
-      suppression_dictionary_.get(),
-      pos_matcher_.get()));
-  CHECK(dictionary_.get());
-
   StringPiece suffix_key_array_data, suffix_value_array_data;
   const uint32 *token_array;
   data_manager->GetSuffixDictionaryData(&suffix_key_array_data,
@@ -202,12 +247,6 @@ void Engine::Init(
                                                 token_array));
   CHECK(suffix_dictionary_.get());
 
-  connector_.reset(Connector::CreateFromDataManager(*data_manager));
-  CHECK(connector_.get());
-
-  segmenter_.reset(Segmenter::CreateFromDataManager(*data_manager));
-  CHECK(segmenter_.get());
-
   pos_group_.reset(new PosGroup(data_manager->GetPosGroupData()));
   CHECK(pos_group_.get());
 
@@ -219,6 +258,20 @@ void Engine::Init(
     suggestion_filter_.reset(new SuggestionFilter(data, size));
   }
 
+  sysdic_thread.Join();
+  CHECK(sysdic);
+  dictionary_.reset(new DictionaryImpl(
+      sysdic,  // DictionaryImpl takes the ownership
+      new ValueDictionary(*pos_matcher_, &sysdic->value_trie()),
+      user_dictionary_.get(),
+      suppression_dictionary_.get(),
+      pos_matcher_.get()));
+  CHECK(dictionary_.get());
+
+  lattice_thread.Join();
+  CHECK(connector_.get());
+  CHECK(segmenter_.get());
+
   immutable_converter_.reset(new ImmutableConverterImpl(
       dictionary_.get(),
       suffix_dictionary_.get(),
@@ -240,6 +293,19 @@ void Engine::Init(
   converter_.reset(converter_impl);  // Involves cast to ConverterInterface*.
   CHECK(converter_.get());
 
+  // The rewriter parses, among others, the usage and the emoticon
+  // sections, which are not needed before the first conversion; build
+  // it while the predictors initialize.  Both sides only read the
+  // already built const structures above.
+  BackgroundInitThread rewriter_thread(
+      [this, converter_impl, data_manager] {
+        rewriter_ = new RewriterImpl(converter_impl,
+                                     data_manager,
+                                     pos_group_.get(),
+                                     dictionary_.get());
+      });
+  rewriter_thread.Start("RewriterBuild");
+
   {
     // Create a predictor with three sub-predictors, dictionary predictor, user
     // history predictor, and extra predictor.
@@ -267,10 +333,7 @@ void Engine::Init(
     CHECK(predictor_);
   }
 
-  rewriter_ = new RewriterImpl(converter_impl,
-                               data_manager,
-                               pos_group_.get(),
-                               dictionary_.get());
+  rewriter_thread.Join();
   CHECK(rewriter_);
 
   converter_impl->Init(pos_matcher_.get(),
@@ -83,12 +83,22 @@ class EngineBuilder::Preparator : public Thread {
       return;
     }
 
-    if (request.has_install_location() &&
-        !FileUtil::AtomicRename(request.file_path(),
-                                request.install_location())) {
-      LOG(ERROR) << "Atomic rename faild: " << request.Utf8DebugString();
-      response_.set_status(EngineReloadResponse::INSTALL_FAILURE);
-      return;
+    if (request.has_install_location()) {
+      // Install is the one place where every section is checksummed:
+      // a corrupted download must not reach the install location.
+      // Regular reloads skip this and rely on the per-section checks
+      // of the sections they parse.
+      if (!tmp_data_manager->VerifyDataSetChecksums()) {
+        LOG(ERROR) << "Data checksum mismatch: " << request.Utf8DebugString();
+        response_.set_status(EngineReloadResponse::DATA_BROKEN);
+        return;
+      }
+      if (!FileUtil::AtomicRename(request.file_path(),
+                                  request.install_location())) {
+        LOG(ERROR) << "Atomic rename faild: " << request.Utf8DebugString();
+        response_.set_status(EngineReloadResponse::INSTALL_FAILURE);
+        return;
+      }
     }
 
     response_.set_status(EngineReloadResponse::RELOAD_READY);
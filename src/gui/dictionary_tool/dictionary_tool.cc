@@ -92,8 +92,14 @@ int GetTableHeight(QTableWidget *widget) {
   return static_cast<int>(rect.height() * 1.4);
 }
 
+// For a window-modal QProgressDialog, setValue() pumps the event loop.
+// Doing that once per row or per line dominates the cost of filling the
+// table and of importing large files, so progress is only reported once
+// per this many steps.
+const int kProgressUpdateInterval = 1024;
+
 QProgressDialog *CreateProgressDialog(
-    QString message, QWidget *parent, int size) {
+    QString message, QWidget *parent, int size, bool cancelable) {
   QProgressDialog *progress =
       new QProgressDialog(message, "", 0, size, parent);
   CHECK(progress);
@@ -101,28 +107,40 @@ QProgressDialog *CreateProgressDialog(
                            Qt::CustomizeWindowHint |
                            Qt::WindowCloseButtonHint);
   progress->setWindowModality(Qt::WindowModal);
-  // This cancel button is invisible to users.
-  // We don't accept any cancel operation
-  QPushButton *cancel_button = new QPushButton;
-  CHECK(cancel_button);
   progress->setAutoClose(true);
-  progress->setCancelButton(cancel_button);
+  if (cancelable) {
+    progress->setCancelButtonText(QObject::tr("Cancel"));
+  } else {
+    // This cancel button is invisible to users.
+    // We don't accept any cancel operation
+    QPushButton *cancel_button = new QPushButton;
+    CHECK(cancel_button);
+    progress->setCancelButton(cancel_button);
+    cancel_button->setVisible(false);
+  }
   progress->setFixedSize(QSize(400, 100));
-  cancel_button->setVisible(false);
 
   return progress;
 }
 
+// TextLineIteratorInterface whose progress dialog has a visible cancel
+// button.  Once the button is pressed the iterator stops yielding lines,
+// so the importer finishes with the entries read so far.
+class CancelableTextLineIterator
+    : public UserDictionaryImporter::TextLineIteratorInterface {
+ public:
+  virtual bool IsCanceled() const = 0;
+};
+
 // Use QTextStream to read UTF16 text -- we can't use ifstream,
 // since ifstream cannot handle Wide character.
-class UTF16TextLineIterator
-    : public UserDictionaryImporter::TextLineIteratorInterface {
+class UTF16TextLineIterator : public CancelableTextLineIterator {
  public:
   UTF16TextLineIterator(
       UserDictionaryImporter::EncodingType encoding_type,
       const string &filename,
       const QString &message, QWidget *parent)
-      : stream_(new QTextStream) {
+      : stream_(new QTextStream), line_count_(0), canceled_(false) {
     CHECK_EQ(UserDictionaryImporter::UTF16, encoding_type);
     file_.setFileName(QString::fromUtf8(filename.c_str()));
     if (!file_.open(QIODevice::ReadOnly)) {
@@ -130,7 +148,7 @@ class UTF16TextLineIterator
     }
     stream_->setDevice(&file_);
     stream_->setCodec("UTF-16");
-    progress_.reset(CreateProgressDialog(message, parent, file_.size()));
+    progress_.reset(CreateProgressDialog(message, parent, file_.size(), true));
   }
 
   bool IsAvailable() const {
@@ -138,7 +156,7 @@ class UTF16TextLineIterator
   }
 
   bool Next(string *line) {
-    if (stream_->atEnd()) {
+    if (canceled_ || stream_->atEnd()) {
       return false;
     }
 
@@ -158,7 +176,13 @@ class UTF16TextLineIterator
       }
     }
 
-    progress_->setValue(file_.pos());
+    if ((++line_count_ % kProgressUpdateInterval) == 0) {
+      progress_->setValue(file_.pos());
+      if (progress_->wasCanceled()) {
+        canceled_ = true;
+        return false;
+      }
+    }
 
     *line = output_line.toUtf8().data();
     return true;
@@ -169,16 +193,22 @@ class UTF16TextLineIterator
     stream_.reset(new QTextStream);
     stream_->setDevice(&file_);
     stream_->setCodec("UTF-16");
+    line_count_ = 0;
+  }
+
+  bool IsCanceled() const {
+    return canceled_;
   }
 
  private:
   QFile file_;
   std::unique_ptr<QTextStream> stream_;
   std::unique_ptr<QProgressDialog> progress_;
+  int line_count_;
+  bool canceled_;
 };
 
-class MultiByteTextLineIterator
-    : public UserDictionaryImporter::TextLineIteratorInterface {
+class MultiByteTextLineIterator : public CancelableTextLineIterator {
  public:
   MultiByteTextLineIterator(
       UserDictionaryImporter::EncodingType encoding_type,
@@ -186,12 +216,14 @@ class MultiByteTextLineIterator
       const QString &message, QWidget *parent)
       : encoding_type_(encoding_type),
         ifs_(new InputFileStream(filename.c_str())),
-        first_line_(true) {
+        first_line_(true),
+        line_count_(0),
+        canceled_(false) {
     const std::streampos begin = ifs_->tellg();
     ifs_->seekg(0, std::ios::end);
     const size_t size = static_cast<size_t>(ifs_->tellg() - begin);
     ifs_->seekg(0, std::ios::beg);
-    progress_.reset(CreateProgressDialog(message, parent, size));
+    progress_.reset(CreateProgressDialog(message, parent, size, true));
   }
 
   bool IsAvailable() const {
@@ -203,7 +235,7 @@ class MultiByteTextLineIterator
   }
 
   bool Next(string *line)  {
-    if (!ifs_->good()) {
+    if (canceled_ || !ifs_->good()) {
       return false;
     }
 
@@ -222,7 +254,13 @@ class MultiByteTextLineIterator
       }
     }
 
-    progress_->setValue(ifs_->tellg());
+    if ((++line_count_ % kProgressUpdateInterval) == 0) {
+      progress_->setValue(ifs_->tellg());
+      if (progress_->wasCanceled()) {
+        canceled_ = true;
+        return false;
+      }
+    }
 
     *line = output_line;
 
@@ -250,6 +288,11 @@ class MultiByteTextLineIterator
     ifs_->clear();
     ifs_->seekg(0, std::ios_base::beg);
     first_line_ = true;
+    line_count_ = 0;
+  }
+
+  bool IsCanceled() const {
+    return canceled_;
   }
 
  private:
@@ -257,9 +300,11 @@ class MultiByteTextLineIterator
   std::unique_ptr<InputFileStream> ifs_;
   std::unique_ptr<QProgressDialog> progress_;
   bool first_line_;
+  int line_count_;
+  bool canceled_;
 };
 
-UserDictionaryImporter::TextLineIteratorInterface *CreateTextLineIterator(
+CancelableTextLineIterator *CreateTextLineIterator(
     UserDictionaryImporter::EncodingType encoding_type,
     const string &filename,
     QWidget *parent) {
@@ -638,7 +683,8 @@ void DictionaryTool::SetupDicContentEditor(
     std::unique_ptr<QProgressDialog> progress(CreateProgressDialog(
         tr("Updating the current view data..."),
         this,
-        dic->entries_size()));
+        dic->entries_size(),
+        false));
 
     for (size_t i = 0; i < dic->entries_size(); ++i) {
       dic_content_->setItem(
@@ -650,7 +696,9 @@ void DictionaryTool::SetupDicContentEditor(
               UserDictionaryUtil::GetStringPosType(dic->entries(i).pos())));
       dic_content_->setItem(
           i, 3, new QTableWidgetItem(dic->entries(i).comment().c_str()));
-      progress->setValue(i);
+      if ((i % kProgressUpdateInterval) == 0) {
+        progress->setValue(i);
+      }
     }
   }
 
@@ -878,7 +926,7 @@ void DictionaryTool::ImportHelper(
   SyncToStorage();
 
   // Open dictionary
-  std::unique_ptr<UserDictionaryImporter::TextLineIteratorInterface> iter(
+  std::unique_ptr<CancelableTextLineIterator> iter(
       CreateTextLineIterator(encoding_type, file_name, this));
   if (iter.get() == NULL) {
     LOG(ERROR) << "CreateTextLineIterator returns NULL";
@@ -903,6 +951,14 @@ void DictionaryTool::ImportHelper(
 
   UpdateUIStatus();
 
+  if (iter->IsCanceled()) {
+    QMessageBox::information(
+        this, window_title_,
+        tr("Import is canceled. %1 entries have already been imported "
+           "to %2.").arg(added_entries_size).arg(dic_name.c_str()));
+    return;
+  }
+
   ReportImportError(error, dic_name, added_entries_size);
 }
 
@@ -1087,11 +1143,14 @@ void DictionaryTool::DeleteWord() {
         CreateProgressDialog(
             tr("Deleting the selected words..."),
             this,
-            rows.size()));
+            rows.size(),
+            false));
 
     for (size_t i = 0; i < rows.size(); ++i) {
       dic_content_->removeRow(rows[i]);
-      progress->setValue(i);
+      if ((i % kProgressUpdateInterval) == 0) {
+        progress->setValue(i);
+      }
     }
   }
 
@@ -1171,7 +1230,8 @@ void DictionaryTool::MoveTo(int dictionary_row) {
         CreateProgressDialog(
             tr("Moving the selected words..."),
             this,
-            progress_max));
+            progress_max,
+            false));
 
     int progress_index = 0;
     if (target_dict) {
@@ -1184,13 +1244,17 @@ void DictionaryTool::MoveTo(int dictionary_row) {
             dic_content_->item(row, 2)->text().toStdString().c_str()));
         entry->set_comment(dic_content_->item(row, 3)->text().toStdString());
         UserDictionaryUtil::SanitizeEntry(entry);
-        progress->setValue(progress_index);
+        if ((progress_index % kProgressUpdateInterval) == 0) {
+          progress->setValue(progress_index);
+        }
         ++progress_index;
       }
     }
     for (size_t i = 0; i < rows.size(); ++i) {
       dic_content_->removeRow(rows[i]);
-      progress->setValue(progress_index);
+      if ((progress_index % kProgressUpdateInterval) == 0) {
+        progress->setValue(progress_index);
+      }
       ++progress_index;
     }
   }
@@ -37,6 +37,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../storage/storage.gyp:storage',
         'zinnia.gyp:zinnia',
       ],
       # MOZC_ZINNIA_MODEL_FILE is only used for OSS build.
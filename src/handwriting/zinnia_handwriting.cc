@@ -35,6 +35,7 @@
 #include <string>
 
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/mac_util.h"
 #include "base/mmap.h"
@@ -44,6 +45,25 @@ namespace mozc {
 namespace handwriting {
 namespace {
 const uint32 kBoxSize = 200;
+const size_t kResultCacheSize = 256;
+
+// Fingerprints the stroke points exactly as they are fed to zinnia
+// (stroke index plus rasterized coordinates), so stroke sets that
+// rasterize identically share a cache entry.
+uint64 StrokesFingerprint(const Strokes &strokes) {
+  string buf;
+  for (size_t i = 0; i < strokes.size(); ++i) {
+    for (size_t j = 0; j < strokes[i].size(); ++j) {
+      const int point[3] = {
+        static_cast<int>(i),
+        static_cast<int>(kBoxSize * strokes[i][j].first),
+        static_cast<int>(kBoxSize * strokes[i][j].second),
+      };
+      buf.append(reinterpret_cast<const char *>(point), sizeof(point));
+    }
+  }
+  return Hash::Fingerprint(buf);
+}
 }  // namespace
 
 // static
@@ -68,7 +88,8 @@ ZinniaHandwriting::ZinniaHandwriting(StringPiece model_file)
     : recognizer_(zinnia::Recognizer::create()),
       character_(zinnia::Character::create()),
       mmap_(new Mmap),
-      zinnia_model_error_(false) {
+      zinnia_model_error_(false),
+      result_cache_(kResultCacheSize) {
   DCHECK(recognizer_.get());
   DCHECK(character_.get());
 
@@ -82,6 +103,16 @@ ZinniaHandwriting::ZinniaHandwriting(StringPiece model_file)
     zinnia_model_error_ = true;
     return;
   }
+
+  // Warmup: open() above only maps the model, so without this the page
+  // faults and the recognizer's lazy setup are paid by the first real
+  // stroke, which makes the pad feel stuck right after it opens.
+  character_->clear();
+  character_->set_width(kBoxSize);
+  character_->set_height(kBoxSize);
+  character_->add(0, kBoxSize / 2, kBoxSize / 2);
+  std::unique_ptr<zinnia::Result> warmup_result(
+      recognizer_->classify(*character_, 1));
 }
 
 ZinniaHandwriting::~ZinniaHandwriting() {}
@@ -92,6 +123,13 @@ HandwritingStatus ZinniaHandwriting::Recognize(
     return HANDWRITING_ERROR;
   }
 
+  const uint64 fingerprint = StrokesFingerprint(strokes);
+  const std::vector<string> *cached = result_cache_.Lookup(fingerprint);
+  if (cached != nullptr) {
+    *candidates = *cached;
+    return HANDWRITING_NO_ERROR;
+  }
+
   character_->clear();
   character_->set_width(kBoxSize);
   character_->set_height(kBoxSize);
@@ -114,6 +152,7 @@ HandwritingStatus ZinniaHandwriting::Recognize(
   for (size_t i = 0; i < result->size(); ++i) {
     candidates->push_back(result->value(i));
   }
+  result_cache_.Insert(fingerprint, *candidates);
   return HANDWRITING_NO_ERROR;
 }
 
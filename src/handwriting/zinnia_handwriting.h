@@ -34,10 +34,12 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "handwriting/handwriting_manager.h"
+#include "storage/lru_cache.h"
 
 #include <zinnia.h>
 
@@ -63,6 +65,11 @@ class ZinniaHandwriting : public HandwritingInterface {
   std::unique_ptr<zinnia::Character> character_;
   std::unique_ptr<Mmap> mmap_;
   bool zinnia_model_error_;
+  // Results of recent classifications, keyed by a fingerprint of the
+  // rasterized stroke points.  The pad re-runs full recognition after
+  // every stroke update, so going back and forth over the same drawing
+  // (erasing a stroke, switching recognition sources) repeats queries.
+  mutable storage::LRUCache<uint64, std::vector<string> > result_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(ZinniaHandwriting);
 };
@@ -66,6 +66,21 @@ TEST_F(ZinniaHandwritingTest, Recognize) {
   EXPECT_EQ("一", results[0]);
 }
 
+TEST_F(ZinniaHandwritingTest, RecognizeTwiceReturnsSameResults) {
+  Strokes strokes;
+  Stroke stroke;
+  stroke.push_back(std::make_pair(0.2, 0.5));
+  stroke.push_back(std::make_pair(0.8, 0.5));
+  strokes.push_back(stroke);
+
+  // The second call is served from the result cache and must be
+  // indistinguishable from a fresh classification.
+  std::vector<string> results1, results2;
+  EXPECT_EQ(HANDWRITING_NO_ERROR, zinnia_->Recognize(strokes, &results1));
+  EXPECT_EQ(HANDWRITING_NO_ERROR, zinnia_->Recognize(strokes, &results2));
+  EXPECT_EQ(results1, results2);
+}
+
 TEST_F(ZinniaHandwritingTest, Commit) {
   Strokes strokes;
   string result;
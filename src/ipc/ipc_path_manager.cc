@@ -54,6 +54,7 @@
 #include <memory>  // for std::unique_ptr
 #endif
 
+#include "base/clock.h"
 #include "base/const.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
@@ -175,7 +176,8 @@ IPCPathManager::IPCPathManager(const string &name)
       ipc_path_info_(new ipc::IPCPathInfo),
       name_(name),
       server_pid_(0),
-      last_modified_(-1) {}
+      last_modified_(-1),
+      last_stat_check_time_(0) {}
 
 IPCPathManager::~IPCPathManager() {}
 
@@ -439,6 +441,18 @@ bool IPCPathManager::ShouldReload() const {
 #else
   scoped_lock l(mutex_.get());
 
+  // Clients call this method once per request, i.e. per keystroke, and
+  // checking the timestamp costs a stat(2) each time.  Checking at most
+  // once a second is enough: the only event the timestamp can signal is a
+  // server restart with a new key, and a client which connects to the
+  // stale address in the meantime fails, calls Clear() and reloads
+  // immediately.
+  const uint64 now = Clock::GetTime();
+  if (now == last_stat_check_time_) {
+    return false;
+  }
+  last_stat_check_time_ = now;
+
   time_t last_modified = GetIPCFileTimeStamp();
   if (last_modified == last_modified_) {
     return false;
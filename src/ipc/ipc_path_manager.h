@@ -133,6 +133,9 @@ class IPCPathManager {
   string server_path_;   // cache for server_path
   uint32 server_pid_;    // cache for pid of server_path
   time_t last_modified_;
+  // The time ShouldReload() last checked the timestamp of the ipc key
+  // file.  Used to avoid a stat(2) per client request; see ShouldReload().
+  mutable uint64 last_stat_check_time_;
 #ifdef OS_WIN
   std::map<string, std::wstring> expected_server_ntpath_cache_;
 #endif  // OS_WIN
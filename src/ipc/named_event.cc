@@ -308,7 +308,12 @@ int NamedEventListener::WaitEventOrProcess(int msec, size_t pid) {
   const int kWaitMsec = 200;
 
   while (inifinite || msec > 0) {
-    Util::Sleep(kWaitMsec);
+    // Randomize the polling interval so that the waiters launched at
+    // the same time (e.g. every client of a login storm waiting for
+    // server ready) do not wake up and connect to the server in
+    // lockstep once the event is raised.
+    const int wait_msec = kWaitMsec + Util::Random(kWaitMsec);
+    Util::Sleep(wait_msec);
 
     if (!IsProcessAlive(pid)) {
       return NamedEventListener::PROCESS_SIGNALED;
@@ -327,7 +332,7 @@ int NamedEventListener::WaitEventOrProcess(int msec, size_t pid) {
       return EVENT_SIGNALED;
     }
 
-    msec -= kWaitMsec;
+    msec -= wait_msec;
   }
 
   // timeout.
@@ -36,6 +36,7 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <netinet/in.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -47,7 +48,9 @@
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <map>
 
+#include "base/clock.h"
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/thread.h"
@@ -148,19 +151,27 @@ bool IsPeerValid(int socket, pid_t *pid) {
   return true;
 }
 
+// The sockets below are non-blocking: send()/recv() is attempted
+// first and select() is entered only when the kernel buffer is not
+// ready.  Keystroke-sized payloads are accepted or available
+// immediately in almost every call, so this saves the select() syscall
+// per direction compared to polling before every transfer.
 bool SendMessage(int socket,
                  const char *buf,
                  size_t buf_length, int timeout,
                  IPCErrorType *last_ipc_error) {
   size_t buf_length_left = buf_length;
   while (buf_length_left > 0) {
-    if (IsWriteTimeout(socket, timeout)) {
-      LOG(WARNING) << "Write timeout " << timeout;
-      *last_ipc_error = IPC_TIMEOUT_ERROR;
-      return false;
-    }
     const ssize_t l = ::send(socket, buf, buf_length_left, MSG_NOSIGNAL);
     if (l < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        if (IsWriteTimeout(socket, timeout)) {
+          LOG(WARNING) << "Write timeout " << timeout;
+          *last_ipc_error = IPC_TIMEOUT_ERROR;
+          return false;
+        }
+        continue;
+      }
       // An error occurs.
       LOG(ERROR) << "an error occurred during sending \""
                  << string(buf, buf_length_left) << "\": " << strerror(errno);
@@ -185,29 +196,48 @@ bool RecvMessage(int socket,
     return false;
   }
   ssize_t buf_left = *buf_length;
-  ssize_t read_length = 0;
   *buf_length = 0;
-  do {
-    if (IsReadTimeout(socket, timeout)) {
-      LOG(WARNING) << "Read timeout " << timeout;
-      *last_ipc_error = IPC_TIMEOUT_ERROR;
-      return false;
-    }
-    read_length = ::recv(socket, buf, buf_left, 0);
+  while (buf_left > 0) {
+    const ssize_t read_length = ::recv(socket, buf, buf_left, 0);
     if (read_length < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        if (IsReadTimeout(socket, timeout)) {
+          LOG(WARNING) << "Read timeout " << timeout;
+          *last_ipc_error = IPC_TIMEOUT_ERROR;
+          return false;
+        }
+        continue;
+      }
       LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
       *buf_length = 0;
       *last_ipc_error = IPC_READ_ERROR;
       return false;
     }
+    if (read_length == 0) {
+      // The peer half-closed the socket; the message is complete.
+      break;
+    }
     *buf_length += read_length;
     buf += read_length;
     buf_left -= read_length;
-  } while (read_length != 0 && buf_left > 0);
+  }
   VLOG(1) << *buf_length << " bytes received";
   return true;
 }
 
+void SetNonBlockingFlag(int fd) {
+  const int flags = ::fcntl(fd, F_GETFL, 0);
+  if (flags < 0) {
+    LOG(WARNING) << "fcntl(F_GETFL) for fd " << fd << " failed: "
+                 << strerror(errno);
+    return;
+  }
+  if (::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+    LOG(WARNING) << "fcntl(F_SETFL) for fd " << fd << " failed: "
+                 << strerror(errno);
+  }
+}
+
 void SetCloseOnExecFlag(int fd) {
   int flags = ::fcntl(fd, F_GETFD, 0);
   if (flags < 0) {
@@ -227,6 +257,25 @@ void SetCloseOnExecFlag(int fd) {
 bool IsAbstractSocket(const string& address) {
   return (!address.empty()) && (address[0] == '\0');
 }
+
+// State of one accepted connection inside IPCServer::Loop().  A
+// connection reads until the peer half-closes its side, which marks the
+// end of the request, then writes until the response has been flushed.
+struct ServerConnection {
+  ServerConnection() : deadline_msec(0), response_offset(0), writing(false) {}
+  uint64 deadline_msec;  // absolute time at which the connection is dropped
+  string request;
+  string response;
+  size_t response_offset;
+  bool writing;
+};
+
+uint64 GetCurrentMSec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
 }  // namespace
 
 // Client
@@ -300,6 +349,9 @@ void IPCClient::Init(const string &name, const string &server_path) {
         last_ipc_error_ = IPC_INVALID_SERVER;
         break;
       }
+      // Connect with a blocking socket and switch to non-blocking for
+      // the transfers; see the comment above SendMessage().
+      SetNonBlockingFlag(socket_);
       last_ipc_error_ = IPC_NO_ERROR;
       connected_ = true;
       break;
@@ -443,38 +495,193 @@ bool IPCServer::Connected() const {
 }
 
 void IPCServer::Loop() {
-  // The most portable and straightforward single-thread server
+  // Event-driven loop multiplexing all the connections with epoll.  A
+  // peer which is slow to send its request or to drain its reply no
+  // longer stalls the connections queued behind it; only Process() is
+  // invoked serially, once a request has completely arrived.
+  const int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    LOG(FATAL) << "epoll_create1() failed: " << strerror(errno);
+    return;
+  }
+
+  SetNonBlockingFlag(socket_);
+  struct epoll_event event;
+  ::memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = socket_;
+  if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket_, &event) != 0) {
+    LOG(FATAL) << "epoll_ctl() failed: " << strerror(errno);
+    return;
+  }
+
+  std::map<int, ServerConnection> connections;
   bool error = false;
-  IPCErrorType last_ipc_error = IPC_NO_ERROR;
   pid_t pid = 0;
   while (!error) {
-    const int new_sock = ::accept(socket_, NULL, NULL);
-    if (new_sock < 0) {
-      LOG(FATAL) << "accept() failed: " << strerror(errno);
-      return;
+    // Wake up no later than the earliest connection deadline.
+    int wait_msec = -1;
+    if (!connections.empty() && timeout_ >= 0) {
+      const uint64 now = GetCurrentMSec();
+      for (std::map<int, ServerConnection>::const_iterator it =
+               connections.begin(); it != connections.end(); ++it) {
+        const uint64 remaining =
+            (it->second.deadline_msec > now) ?
+            it->second.deadline_msec - now : 0;
+        if (wait_msec < 0 || remaining < static_cast<uint64>(wait_msec)) {
+          wait_msec = static_cast<int>(remaining);
+        }
+      }
     }
-    if (!IsPeerValid(new_sock, &pid)) {
-      continue;
+
+    struct epoll_event events[64];
+    const int num_events =
+        ::epoll_wait(epoll_fd, events, arraysize(events), wait_msec);
+    if (num_events < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(FATAL) << "epoll_wait() failed: " << strerror(errno);
+      return;
     }
-    size_t request_size = sizeof(request_);
-    size_t response_size = sizeof(response_);
-    if (RecvMessage(new_sock,
-                    &request_[0],
-                    &request_size, timeout_, &last_ipc_error)) {
-      if (!Process(&request_[0], request_size,
-                   &response_[0], &response_size)) {
-        LOG(WARNING) << "Process() failed";
-        error = true;
+
+    for (int i = 0; i < num_events && !error; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == socket_) {
+        // Accept every pending connection.
+        while (true) {
+          const int new_sock = ::accept(socket_, NULL, NULL);
+          if (new_sock < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+              break;
+            }
+            LOG(FATAL) << "accept() failed: " << strerror(errno);
+            return;
+          }
+          if (!IsPeerValid(new_sock, &pid)) {
+            ::close(new_sock);
+            continue;
+          }
+          SetCloseOnExecFlag(new_sock);
+          SetNonBlockingFlag(new_sock);
+          ServerConnection &connection = connections[new_sock];
+          if (timeout_ >= 0) {
+            connection.deadline_msec = GetCurrentMSec() + timeout_;
+          }
+          event.events = EPOLLIN;
+          event.data.fd = new_sock;
+          if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, new_sock, &event) != 0) {
+            LOG(ERROR) << "epoll_ctl() failed: " << strerror(errno);
+            ::close(new_sock);
+            connections.erase(new_sock);
+          }
+        }
+        continue;
       }
-      if (response_size > 0) {
-        SendMessage(new_sock,
-                    &response_[0],
-                    response_size, timeout_, &last_ipc_error);
+
+      std::map<int, ServerConnection>::iterator it = connections.find(fd);
+      if (it == connections.end()) {
+        continue;
+      }
+      ServerConnection &connection = it->second;
+      bool done = false;
+
+      if (!connection.writing) {
+        // |request_| is only used as a scratch buffer here; the request
+        // accumulates in |connection.request|.
+        while (true) {
+          const ssize_t read_length =
+              ::recv(fd, &request_[0], sizeof(request_), 0);
+          if (read_length < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+              break;
+            }
+            LOG(ERROR) << "an error occurred during recv(): "
+                       << strerror(errno);
+            done = true;
+            break;
+          }
+          if (read_length == 0) {
+            // The peer half-closed the socket; the request is complete.
+            size_t response_size = sizeof(response_);
+            if (!Process(connection.request.data(), connection.request.size(),
+                         &response_[0], &response_size)) {
+              LOG(WARNING) << "Process() failed";
+              error = true;
+            }
+            if (response_size > 0) {
+              connection.response.assign(&response_[0], response_size);
+              connection.writing = true;
+            } else {
+              done = true;
+            }
+            break;
+          }
+          if (connection.request.size() + read_length > sizeof(request_)) {
+            LOG(WARNING) << "request too large";
+            done = true;
+            break;
+          }
+          connection.request.append(&request_[0], read_length);
+        }
+      }
+
+      if (connection.writing && !done) {
+        while (connection.response_offset < connection.response.size()) {
+          const ssize_t written =
+              ::send(fd, connection.response.data() +
+                     connection.response_offset,
+                     connection.response.size() - connection.response_offset,
+                     MSG_NOSIGNAL);
+          if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+              // Wait until the peer drains its socket buffer.
+              event.events = EPOLLOUT;
+              event.data.fd = fd;
+              ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+              break;
+            }
+            LOG(ERROR) << "an error occurred during send(): "
+                       << strerror(errno);
+            done = true;
+            break;
+          }
+          connection.response_offset += written;
+        }
+        if (connection.response_offset >= connection.response.size()) {
+          done = true;
+        }
+      }
+
+      if (done) {
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        ::close(fd);
+        connections.erase(it);
       }
     }
 
-    ::close(new_sock);
+    // Drop the connections which exceeded their deadline.
+    if (!connections.empty() && timeout_ >= 0) {
+      const uint64 now = GetCurrentMSec();
+      for (std::map<int, ServerConnection>::iterator it = connections.begin();
+           it != connections.end(); ) {
+        if (now >= it->second.deadline_msec) {
+          LOG(WARNING) << "connection timeout " << timeout_;
+          ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->first, NULL);
+          ::close(it->first);
+          connections.erase(it++);
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  for (std::map<int, ServerConnection>::iterator it = connections.begin();
+       it != connections.end(); ++it) {
+    ::close(it->first);
   }
+  ::close(epoll_fd);
 
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
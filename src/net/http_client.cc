@@ -44,6 +44,7 @@
 
 #include "base/compiler_specific.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/port.h"
 #include "base/singleton.h"
 #include "base/stopwatch.h"
@@ -462,6 +463,41 @@ class CurlInitializer {
   void Init() {}
 };
 
+// Holds one curl easy handle for the lifetime of the process.  Reusing
+// the handle lets libcurl keep the underlying connection alive, so
+// periodic requests to the same host (usage-stats upload) skip the TCP
+// and TLS handshakes.  |mutex()| serializes the requests, which is
+// acceptable because HTTP requests are infrequent background
+// operations here.
+class CurlHandleCache {
+ public:
+  CurlHandleCache() : curl_(NULL) {}
+
+  ~CurlHandleCache() {
+    if (curl_ != NULL) {
+      curl_easy_cleanup(curl_);
+    }
+  }
+
+  // Returns the cached handle with all options reset to their defaults,
+  // or NULL on failure.  Resetting keeps the handle's connection and
+  // session caches.  Call this with mutex() held.
+  CURL *GetResetHandle() {
+    if (curl_ == NULL) {
+      curl_ = curl_easy_init();
+    } else {
+      curl_easy_reset(curl_);
+    }
+    return curl_;
+  }
+
+  Mutex *mutex() { return &mutex_; }
+
+ private:
+  CURL *curl_;
+  Mutex mutex_;
+};
+
 size_t HTTPOutputCallback(void *ptr, size_t size, size_t nmemb, void *stream) {
   HTTPStream *s = reinterpret_cast<HTTPStream *>(stream);
   return s->Append(reinterpret_cast<const char *>(ptr), size * nmemb);
@@ -490,7 +526,9 @@ bool RequestInternal(HTTPMethodType type,
 
   Singleton<CurlInitializer>::get()->Init();
 
-  CURL *curl = curl_easy_init();
+  CurlHandleCache *handle_cache = Singleton<CurlHandleCache>::get();
+  scoped_lock l(handle_cache->mutex());
+  CURL *curl = handle_cache->GetResetHandle();
   if (NULL == curl) {
     LOG(ERROR) << "curl_easy_init() failed";
     return false;
@@ -510,7 +548,6 @@ bool RequestInternal(HTTPMethodType type,
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
   curl_easy_setopt(curl, CURLOPT_AUTOREFERER, 1);
   curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgent);
-  curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1);
   curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, option.timeout);
   curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, option.timeout);
   curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5);
@@ -557,7 +594,6 @@ bool RequestInternal(HTTPMethodType type,
       break;
     default:
       LOG(ERROR) << "Unknown method: " << type;
-      curl_easy_cleanup(curl);
       return false;
       break;
   }
@@ -576,8 +612,11 @@ bool RequestInternal(HTTPMethodType type,
     result = false;
   }
 
-  curl_easy_cleanup(curl);
+  // The handle itself stays in CurlHandleCache so that its connection
+  // can be reused by the next request.  Detach the header list from the
+  // handle before freeing it.
   if (slist != NULL) {
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
     curl_slist_free_all(slist);
   }
 
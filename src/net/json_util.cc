@@ -452,6 +452,240 @@ bool JsonValueToProtobufRepeatedFieldValue(
   return result;
 }
 
+// Appends |str| to |output| as a quoted JSON string token.
+void AppendJsonEscapedString(const string &str, string *output) {
+  output->push_back('"');
+  for (size_t i = 0; i < str.size(); ++i) {
+    const char c = str[i];
+    switch (c) {
+      case '"':
+        output->append("\\\"");
+        break;
+      case '\\':
+        output->append("\\\\");
+        break;
+      case '\b':
+        output->append("\\b");
+        break;
+      case '\f':
+        output->append("\\f");
+        break;
+      case '\n':
+        output->append("\\n");
+        break;
+      case '\r':
+        output->append("\\r");
+        break;
+      case '\t':
+        output->append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          const char kHexDigits[] = "0123456789abcdef";
+          output->append("\\u00");
+          output->push_back(kHexDigits[(c >> 4) & 0xf]);
+          output->push_back(kHexDigits[c & 0xf]);
+        } else {
+          output->push_back(c);
+        }
+        break;
+    }
+  }
+  output->push_back('"');
+}
+
+bool ProtobufMessageToJsonStringInternal(const Message &message,
+                                         string *output);
+
+// The string producing counterparts of ProtobufFieldValueToJsonValue()
+// and ProtobufRepeatedFieldValueToJsonValue() below.  They must emit
+// the same values; in particular int64/uint64 are written as quoted
+// decimal strings and enums as their value names.
+bool ProtobufFieldValueToJsonString(
+    const Message &message, const Reflection &reflection,
+    const FieldDescriptor &field, string *output) {
+  switch (field.cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32: {
+      output->append(std::to_string(reflection.GetInt32(message, &field)));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_INT64: {
+      AppendJsonEscapedString(
+          std::to_string(
+              static_cast<int64>(reflection.GetInt64(message, &field))),
+          output);
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_UINT32: {
+      output->append(std::to_string(reflection.GetUInt32(message, &field)));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_UINT64: {
+      AppendJsonEscapedString(
+          std::to_string(
+              static_cast<uint64>(reflection.GetUInt64(message, &field))),
+          output);
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_FLOAT: {
+      output->append(Json::valueToString(
+          static_cast<double>(reflection.GetFloat(message, &field))));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_DOUBLE: {
+      output->append(
+          Json::valueToString(reflection.GetDouble(message, &field)));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_BOOL: {
+      output->append(reflection.GetBool(message, &field) ? "true" : "false");
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_ENUM: {
+      AppendJsonEscapedString(reflection.GetEnum(message, &field)->name(),
+                              output);
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_STRING: {
+      string scratch;
+      AppendJsonEscapedString(
+          reflection.GetStringReference(message, &field, &scratch), output);
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_MESSAGE: {
+      return ProtobufMessageToJsonStringInternal(
+          reflection.GetMessage(message, &field), output);
+    }
+    default: {
+      DLOG(WARNING) << "unsupported filed CppType: " << field.cpp_type();
+      // Keep the output well-formed.
+      output->append("null");
+      break;
+    }
+  }
+  return false;
+}
+
+bool ProtobufRepeatedFieldValueToJsonString(
+    const Message &message, const Reflection &reflection,
+    const FieldDescriptor &field, int index, string *output) {
+  switch (field.cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32: {
+      output->append(
+          std::to_string(reflection.GetRepeatedInt32(message, &field, index)));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_INT64: {
+      AppendJsonEscapedString(
+          std::to_string(static_cast<int64>(
+              reflection.GetRepeatedInt64(message, &field, index))),
+          output);
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_UINT32: {
+      output->append(
+          std::to_string(reflection.GetRepeatedUInt32(message, &field, index)));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_UINT64: {
+      AppendJsonEscapedString(
+          std::to_string(static_cast<uint64>(
+              reflection.GetRepeatedUInt64(message, &field, index))),
+          output);
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_FLOAT: {
+      output->append(Json::valueToString(static_cast<double>(
+          reflection.GetRepeatedFloat(message, &field, index))));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_DOUBLE: {
+      output->append(Json::valueToString(
+          reflection.GetRepeatedDouble(message, &field, index)));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_BOOL: {
+      output->append(
+          reflection.GetRepeatedBool(message, &field, index) ? "true"
+                                                             : "false");
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_ENUM: {
+      AppendJsonEscapedString(
+          reflection.GetRepeatedEnum(message, &field, index)->name(), output);
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_STRING: {
+      string scratch;
+      AppendJsonEscapedString(
+          reflection.GetRepeatedStringReference(message, &field, index,
+                                                &scratch),
+          output);
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_MESSAGE: {
+      return ProtobufMessageToJsonStringInternal(
+          reflection.GetRepeatedMessage(message, &field, index), output);
+    }
+    default: {
+      DLOG(WARNING) << "unsupported filed CppType: " << field.cpp_type();
+      // Keep the output well-formed.
+      output->append("null");
+      break;
+    }
+  }
+  return false;
+}
+
+bool ProtobufMessageToJsonStringInternal(const Message &message,
+                                         string *output) {
+  output->push_back('{');
+  const Descriptor *descriptor = message.GetDescriptor();
+  const Reflection *reflection = message.GetReflection();
+  const int field_count = descriptor->field_count();
+  bool result = true;
+  bool first_member = true;
+  for (int i = 0; i < field_count; ++i) {
+    const FieldDescriptor *field = descriptor->field(i);
+    if (!field) {
+      result = false;
+      continue;
+    }
+    if (field->is_repeated()) {
+      if (!first_member) {
+        output->push_back(',');
+      }
+      first_member = false;
+      AppendJsonEscapedString(field->name(), output);
+      output->append(":[");
+      const int count = reflection->FieldSize(message, field);
+      for (int j = 0; j < count; ++j) {
+        if (j > 0) {
+          output->push_back(',');
+        }
+        if (!ProtobufRepeatedFieldValueToJsonString(message, *reflection,
+                                                    *field, j, output)) {
+          result = false;
+        }
+      }
+      output->push_back(']');
+    } else if (reflection->HasField(message, field) || field->is_required()) {
+      if (!first_member) {
+        output->push_back(',');
+      }
+      first_member = false;
+      AppendJsonEscapedString(field->name(), output);
+      output->push_back(':');
+      if (!ProtobufFieldValueToJsonString(message, *reflection, *field,
+                                          output)) {
+        result = false;
+      }
+    }
+  }
+  output->push_back('}');
+  return result;
+}
+
 }  // namespace
 
 bool JsonUtil::ProtobufMessageToJsonValue(
@@ -494,6 +728,12 @@ bool JsonUtil::ProtobufMessageToJsonValue(
   return result;
 }
 
+bool JsonUtil::ProtobufMessageToJsonString(const Message &message,
+                                           string *output) {
+  output->clear();
+  return ProtobufMessageToJsonStringInternal(message, output);
+}
+
 bool JsonUtil::JsonValueToProtobufMessage(
     const Json::Value &value, Message *message) {
   const Descriptor *descriptor = message->GetDescriptor();
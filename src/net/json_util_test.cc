@@ -646,6 +646,36 @@ TEST(JsonUtilTest, CombinedTest) {
   EXPECT_PROTO_EQ(msg, new_msg);
 }
 
+TEST(JsonUtilTest, ProtobufMessageToJsonStringTest) {
+  TestMsg msg;
+  msg.set_double_value(1.5);
+  msg.set_float_value(-2.5);
+  msg.set_int32_value(-3);
+  msg.set_int64_value(kint64max);
+  msg.set_uint64_value(kuint64max);
+  msg.set_bool_value(true);
+  msg.set_string_value("quote\"backslash\\newline\ncontrol\x01");
+  msg.set_enum_value(ENUM_B);
+  msg.add_repeated_int32_value(10);
+  msg.add_repeated_int32_value(20);
+  msg.add_repeated_string_value("abc");
+  SubMsg *sub_msg = msg.mutable_sub_message();
+  sub_msg->set_string_value("123");
+  sub_msg->add_repeated_enum_value(ENUM_C);
+
+  string json_string;
+  EXPECT_TRUE(JsonUtil::ProtobufMessageToJsonString(msg, &json_string));
+
+  // The string output must parse to the same tree that
+  // ProtobufMessageToJsonValue() builds.
+  Json::Value parsed_value;
+  ASSERT_TRUE(Json::Reader().parse(json_string, parsed_value));
+  Json::Value expected_value;
+  EXPECT_TRUE(JsonUtil::ProtobufMessageToJsonValue(msg, &expected_value));
+  EXPECT_EQ(Json::FastWriter().write(expected_value),
+            Json::FastWriter().write(parsed_value));
+}
+
 namespace {
 
 bool ParseToMessage(const string &json_string, TestMsg *message) {
@@ -35,14 +35,18 @@
 #include <cmath>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/number_util.h"
+#include "base/thread.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/connector.h"
@@ -157,8 +161,21 @@ class DictionaryPredictor::PredictiveLookupCallback
         original_key_len_(original_key_len),
         subsequent_chars_(subsequent_chars),
         is_zero_query_(is_zero_query),
+        truncated_(false),
         results_(results) {}
 
+  PredictiveLimit GetPredictiveLimit() override {
+    PredictiveLimit predictive_limit;
+    if (subsequent_chars_ == nullptr) {
+      // Every found key yields at least one token and OnToken() accepts
+      // every token, so |limit_| keys are enough to fill |results_|.  When
+      // |subsequent_chars_| is set, OnKey() filters keys, so more keys than
+      // |limit_| may be needed and we keep the traverser's default.
+      predictive_limit.max_keys = limit_;
+    }
+    return predictive_limit;
+  }
+
   ResultType OnKey(StringPiece key) override {
     if (subsequent_chars_ == nullptr) {
       return TRAVERSE_CONTINUE;
@@ -202,6 +219,14 @@ class DictionaryPredictor::PredictiveLookupCallback
     return (results_->size() < limit_) ? TRAVERSE_CONTINUE : TRAVERSE_DONE;
   }
 
+  void OnTruncated() override {
+    truncated_ = true;
+  }
+
+  // Returns true if the traversal stopped before enumerating every key
+  // below the looked up key, i.e. the results are not the complete set.
+  bool truncated() const { return truncated_; }
+
  protected:
   int32 penalty_;
   const DictionaryPredictor::PredictionTypes types_;
@@ -209,6 +234,7 @@ class DictionaryPredictor::PredictiveLookupCallback
   const size_t original_key_len_;
   const std::set<string> *subsequent_chars_;
   const bool is_zero_query_;
+  bool truncated_;
   std::vector<DictionaryPredictor::Result> *results_;
 
  private:
@@ -227,6 +253,12 @@ class DictionaryPredictor::PredictiveBigramLookupCallback :
                                  subsequent_chars, is_zero_query, results),
         history_value_(history_value) {}
 
+  PredictiveLimit GetPredictiveLimit() override {
+    // OnToken() below filters tokens by |history_value_|, so unlike the base
+    // class we cannot tell how many keys are needed to fill |results_|.
+    return PredictiveLimit();
+  }
+
   virtual ResultType OnToken(StringPiece key, StringPiece expanded_key,
                              const Token &token) {
     // Skip the token if its value doesn't start with the previous user input,
@@ -261,12 +293,147 @@ class DictionaryPredictor::ResultWCostLess {
   }
 };
 
+// Comparator for the top-K selection in AddPredictionToCandidates().
+// It operates on pointers so that the heap operations move 8-byte
+// pointers instead of the Result objects themselves (two strings and a
+// vector each).
 class DictionaryPredictor::ResultCostLess {
  public:
-  bool operator() (const DictionaryPredictor::Result &lhs,
-                   const DictionaryPredictor::Result &rhs) const {
-    return lhs.cost > rhs.cost;
+  bool operator() (const DictionaryPredictor::Result *lhs,
+                   const DictionaryPredictor::Result *rhs) const {
+    return lhs->cost > rhs->cost;
+  }
+};
+
+// MOZC_ENABLE_PARALLEL_PREDICTION_AGGREGATION is defined by the build
+// system (see prediction.gyp).
+#ifdef MOZC_ENABLE_PARALLEL_PREDICTION_AGGREGATION
+
+// Runs one dictionary-backed aggregator into its own result buffer.
+// The aggregators given to this worker only read the (unchanging)
+// segments and issue const dictionary lookups, which are safe to run
+// concurrently, so workers share no mutable state with each other.
+// The caller appends the buffers in a fixed order after Join() to keep
+// the output identical to the sequential code.
+class DictionaryPredictor::AggregationWorker : public Thread {
+ public:
+  typedef void (DictionaryPredictor::*Aggregator)(
+      PredictionTypes types, const ConversionRequest &request,
+      const Segments &segments, std::vector<Result> *results) const;
+
+  AggregationWorker(const DictionaryPredictor *predictor,
+                    Aggregator aggregator,
+                    PredictionTypes types,
+                    const ConversionRequest &request,
+                    const Segments &segments)
+      : predictor_(predictor),
+        aggregator_(aggregator),
+        types_(types),
+        request_(request),
+        segments_(segments) {}
+
+  virtual void Run() {
+    (predictor_->*aggregator_)(types_, request_, segments_, &results_);
+  }
+
+  const std::vector<Result> &results() const { return results_; }
+
+ private:
+  const DictionaryPredictor *predictor_;
+  const Aggregator aggregator_;
+  const PredictionTypes types_;
+  const ConversionRequest &request_;
+  const Segments &segments_;
+  std::vector<Result> results_;
+
+  DISALLOW_COPY_AND_ASSIGN(AggregationWorker);
+};
+
+#endif  // MOZC_ENABLE_PARALLEL_PREDICTION_AGGREGATION
+
+// Precomputes, on its own thread, the bigram and suffix aggregation
+// for the zero-query request that clients typically send right after a
+// commit.  The thread owns copies of everything it reads except the
+// predictor's dictionaries, which are immutable, so it is safe to run
+// between the commit and the next conversion request.  The composer is
+// deliberately not captured: at zero-query time the composition is
+// empty, so the composer-less lookup produces the same queries.
+class DictionaryPredictor::ZeroQueryPrecomputer : public Thread {
+ public:
+  ZeroQueryPrecomputer(const DictionaryPredictor *predictor,
+                       const ConversionRequest &request,
+                       const Segments &segments)
+      : predictor_(predictor),
+        request_proto_(request.request()),
+        config_proto_(request.config()),
+        joined_(false) {
+    // Builds the segments the upcoming zero-query request will carry:
+    // the committed segments become history and an empty conversion
+    // segment is appended.
+    segments_.CopyFrom(segments);
+    segments_.set_request_type(Segments::SUGGESTION);
+    for (size_t i = 0; i < segments_.segments_size(); ++i) {
+      segments_.mutable_segment(i)->set_segment_type(Segment::HISTORY);
+    }
+    segments_.add_segment()->set_key("");
+  }
+
+  virtual void Run() {
+    const ConversionRequest request(NULL, &request_proto_, &config_proto_);
+    predictor_->AggregateBigramPrediction(
+        BIGRAM | SUFFIX, request, segments_, &results_);
+    predictor_->AggregateSuffixPrediction(
+        BIGRAM | SUFFIX, request, segments_, &results_);
+  }
+
+  // Join() must not be called twice on the underlying thread, but the
+  // precomputation may be consulted by several requests.
+  void JoinOnce() {
+    if (!joined_) {
+      Join();
+      joined_ = true;
+    }
   }
+
+  // Returns true if the precomputed results are valid for |request| and
+  // |segments|, i.e. the committed context and the client settings have
+  // not changed since Finish().  Call JoinOnce() first.
+  bool Matches(const ConversionRequest &request,
+               const Segments &segments) const {
+    const size_t history_size = segments.history_segments_size();
+    const size_t own_history_size = segments_.history_segments_size();
+    if (history_size == 0 || own_history_size == 0) {
+      return false;
+    }
+    const Segment &history_segment =
+        segments.history_segment(history_size - 1);
+    const Segment &own_history_segment =
+        segments_.history_segment(own_history_size - 1);
+    if (history_segment.candidates_size() == 0 ||
+        own_history_segment.candidates_size() == 0) {
+      return false;
+    }
+    return
+        history_segment.key() == own_history_segment.key() &&
+        history_segment.candidate(0).value ==
+            own_history_segment.candidate(0).value &&
+        request.request().SerializeAsString() ==
+            request_proto_.SerializeAsString() &&
+        request.config().SerializeAsString() ==
+            config_proto_.SerializeAsString();
+  }
+
+  const std::vector<Result> &results() const { return results_; }
+
+ private:
+  const DictionaryPredictor *predictor_;
+  const commands::Request request_proto_;
+  const config::Config config_proto_;
+  Segments segments_;
+  std::vector<Result> results_;
+  bool joined_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZeroQueryPrecomputer);
 };
 
 DictionaryPredictor::DictionaryPredictor(
@@ -288,7 +455,11 @@ DictionaryPredictor::DictionaryPredictor(
       suggestion_filter_(suggestion_filter),
       counter_suffix_word_id_(pos_matcher->GetCounterSuffixWordId()),
       general_symbol_id_(pos_matcher->GetGeneralSymbolId()),
-      predictor_name_("DictionaryPredictor") {
+      predictor_name_("DictionaryPredictor"),
+      results_size_high_water_(0),
+      unigram_cache_exhaustive_(false),
+      unigram_cache_cutoff_(0),
+      last_aggregation_time_usec_(0) {
   StringPiece zero_query_token_array_data;
   StringPiece zero_query_string_array_data;
   StringPiece zero_query_number_token_array_data;
@@ -303,7 +474,11 @@ DictionaryPredictor::DictionaryPredictor(
                                zero_query_number_string_array_data);
 }
 
-DictionaryPredictor::~DictionaryPredictor() {}
+DictionaryPredictor::~DictionaryPredictor() {
+  if (zero_query_precomputer_ != nullptr) {
+    zero_query_precomputer_->JoinOnce();
+  }
+}
 
 void DictionaryPredictor::Finish(
     const ConversionRequest &request, Segments *segments) {
@@ -325,6 +500,66 @@ void DictionaryPredictor::Finish(
   }
 
   MaybeRecordUsageStats(candidate);
+  StartZeroQueryPrecomputation(request, *segments);
+}
+
+void DictionaryPredictor::StartZeroQueryPrecomputation(
+    const ConversionRequest &request, const Segments &segments) {
+  if (!request.request().zero_query_suggestion()) {
+    return;
+  }
+  // The committed segment becomes the history the precomputation keys
+  // on, so it must have a candidate.
+  const size_t size = segments.conversion_segments_size();
+  if (size == 0 ||
+      segments.conversion_segment(size - 1).candidates_size() == 0) {
+    return;
+  }
+  if (zero_query_precomputer_ != nullptr) {
+    zero_query_precomputer_->JoinOnce();
+    zero_query_precomputer_.reset();
+  }
+  zero_query_precomputer_.reset(
+      new ZeroQueryPrecomputer(this, request, segments));
+  zero_query_precomputer_->SetJoinable(true);
+  zero_query_precomputer_->Start("ZeroQueryPrecompute");
+}
+
+bool DictionaryPredictor::MaybeGetZeroQueryPrecomputedResults(
+    const ConversionRequest &request,
+    const Segments &segments,
+    PredictionTypes *prediction_types,
+    std::vector<Result> *results) const {
+  if (zero_query_precomputer_ == nullptr) {
+    return false;
+  }
+  if (segments.conversion_segments_size() == 0 ||
+      !segments.conversion_segment(0).key().empty()) {
+    return false;
+  }
+  // Join for every zero-query request, not only the ones that can reuse
+  // the precomputation: the aggregation below this call reads the zero
+  // query dictionaries, whose equal_range() memo the precomputer thread
+  // writes without synchronization.  E.g. a zero-query PREDICTION
+  // request falls through to AggregateSuffixPrediction() and must not
+  // overlap with the still-running thread.
+  zero_query_precomputer_->JoinOnce();
+  if (segments.request_type() != Segments::SUGGESTION ||
+      !(*prediction_types & (BIGRAM | SUFFIX))) {
+    return false;
+  }
+  if (!zero_query_precomputer_->Matches(request, segments)) {
+    zero_query_precomputer_.reset();
+    return false;
+  }
+  const std::vector<Result> &precomputed = zero_query_precomputer_->results();
+  for (size_t i = 0; i < precomputed.size(); ++i) {
+    if (precomputed[i].types & *prediction_types) {
+      results->push_back(precomputed[i]);
+    }
+  }
+  *prediction_types &= ~(BIGRAM | SUFFIX);
+  return true;
 }
 
 void DictionaryPredictor::MaybeRecordUsageStats(
@@ -368,19 +603,41 @@ void DictionaryPredictor::MaybeRecordUsageStats(
 
 bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
                                             Segments *segments) const {
+  ScopedTraceEvent trace_event("DictionaryPredictor::PredictForRequest");
   if (segments == NULL) {
     return false;
   }
 
+  // Suggestion runs on every keystroke and for short keys aggregates
+  // thousands of Results, so take over the storage of the previous
+  // call's vector instead of growing a fresh one; clear() keeps the
+  // capacity.  The buffer is bounded by a high-water mark of recent
+  // result counts that decays by 1/8 per prediction, in the same style
+  // as the lattice column pre-sizing.
   std::vector<Result> results;
-  if (!AggregatePrediction(request, segments, &results)) {
-    return false;
+  results.swap(scratch_results_);
+  results.clear();
+
+  bool added = false;
+  if (AggregatePrediction(request, segments, &results)) {
+    SetCost(request, *segments, &results);
+    RemovePrediction(request, *segments, &results);
+    added = AddPredictionToCandidates(request, segments, &results);
   }
 
-  SetCost(request, *segments, &results);
-  RemovePrediction(request, *segments, &results);
+  const size_t kHighWaterDecayFactor = 8;
+  const size_t kResultsShrinkFactor = 4;
+  results_size_high_water_ = std::max(
+      results.size(),
+      results_size_high_water_ -
+          results_size_high_water_ / kHighWaterDecayFactor);
+  results.clear();
+  if (results.capacity() > results_size_high_water_ * kResultsShrinkFactor) {
+    std::vector<Result>().swap(results);
+  }
+  scratch_results_.swap(results);
 
-  return AddPredictionToCandidates(request, segments, &results);
+  return added;
 }
 
 bool DictionaryPredictor::AggregatePrediction(
@@ -390,12 +647,29 @@ bool DictionaryPredictor::AggregatePrediction(
   DCHECK(segments);
   DCHECK(results);
 
-  const PredictionTypes prediction_types =
-      GetPredictionTypes(request, *segments);
+  // Measures the typing cadence up front so that every request counts,
+  // including those that end up with NO_PREDICTION.
+  const bool defer_realtime = ShouldDeferRealtimeConversion(
+      request, *segments);
+
+  PredictionTypes prediction_types = GetPredictionTypes(request, *segments);
   if (prediction_types == NO_PREDICTION) {
     return false;
   }
 
+  // Mid-burst keystrokes skip the expensive realtime conversion unless
+  // it is the only source of candidates.
+  if (defer_realtime && (prediction_types & REALTIME) &&
+      (prediction_types & ~REALTIME) != NO_PREDICTION) {
+    prediction_types &= ~REALTIME;
+  }
+
+  // The zero-query suggestion right after a commit is served from the
+  // results precomputed at Finish() time when they are still valid; the
+  // bigram and suffix aggregators then skip their dictionary lookups.
+  MaybeGetZeroQueryPrecomputedResults(request, *segments,
+                                      &prediction_types, results);
+
   if (segments->request_type() == Segments::PARTIAL_SUGGESTION ||
       segments->request_type() == Segments::PARTIAL_PREDICTION) {
     // This request type is used to get conversion before cursor during
@@ -404,13 +678,44 @@ bool DictionaryPredictor::AggregatePrediction(
     // Therefore, we use only the realtime conversion result.
     AggregateRealtimeConversion(prediction_types, request, segments, results);
   } else {
+    // The realtime conversion runs first on the calling thread because
+    // it mutates |segments| as a temporary output buffer; the other
+    // aggregators require |segments| to be stable.
     AggregateRealtimeConversion(prediction_types, request, segments, results);
+#ifdef MOZC_ENABLE_PARALLEL_PREDICTION_AGGREGATION
+    // Fan the remaining aggregators out to one worker each; they read
+    // disjoint immutable data (dictionaries, zero query data) and only
+    // append to their private buffers.  The buffers are merged in the
+    // same order as the sequential calls, so the result vector is
+    // byte-for-byte identical to the non-parallel build.
+    static const AggregationWorker::Aggregator kAggregators[] = {
+        &DictionaryPredictor::AggregateUnigramPrediction,
+        &DictionaryPredictor::AggregateBigramPrediction,
+        &DictionaryPredictor::AggregateSuffixPrediction,
+        &DictionaryPredictor::AggregateEnglishPrediction,
+        &DictionaryPredictor::AggregateTypeCorrectingPrediction,
+    };
+    std::vector<std::unique_ptr<AggregationWorker> > workers;
+    for (size_t i = 0; i < arraysize(kAggregators); ++i) {
+      workers.emplace_back(new AggregationWorker(
+          this, kAggregators[i], prediction_types, request, *segments));
+      workers.back()->SetJoinable(true);
+      workers.back()->Start("PredictionAggregator");
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i]->Join();
+      results->insert(results->end(),
+                      workers[i]->results().begin(),
+                      workers[i]->results().end());
+    }
+#else  // MOZC_ENABLE_PARALLEL_PREDICTION_AGGREGATION
     AggregateUnigramPrediction(prediction_types, request, *segments, results);
     AggregateBigramPrediction(prediction_types, request, *segments, results);
     AggregateSuffixPrediction(prediction_types, request, *segments, results);
     AggregateEnglishPrediction(prediction_types, request, *segments, results);
     AggregateTypeCorrectingPrediction(prediction_types, request, *segments,
                                       results);
+#endif  // MOZC_ENABLE_PARALLEL_PREDICTION_AGGREGATION
   }
 
   if (results->empty()) {
@@ -468,10 +773,20 @@ bool DictionaryPredictor::AddPredictionToCandidates(
   Segment *segment = segments->mutable_conversion_segment(0);
   DCHECK(segment);
 
-  // Instead of sorting all the results, we construct a heap.
-  // This is done in linear time and
-  // we can pop as many results as we need efficiently.
-  std::make_heap(results->begin(), results->end(), ResultCostLess());
+  // Instead of sorting all the results, we construct a heap and pop
+  // only the entries we actually show.  For short keys the aggregators
+  // produce thousands of Results while the request caps the output at a
+  // few dozen (|max_prediction_candidates_size|), so heapification is
+  // O(n) and each of the O(K) pops costs O(log n).  The heap holds
+  // pointers so that sift operations do not shuffle the heavyweight
+  // Result objects; the comparison sequence is the same as for a heap
+  // of values, hence the selection order is unchanged.
+  std::vector<const Result *> result_ptrs;
+  result_ptrs.reserve(results->size());
+  for (size_t i = 0; i < results->size(); ++i) {
+    result_ptrs.push_back(&(*results)[i]);
+  }
+  std::make_heap(result_ptrs.begin(), result_ptrs.end(), ResultCostLess());
 
   const size_t size =
       std::min(segments->max_prediction_candidates_size(), results->size());
@@ -484,10 +799,10 @@ bool DictionaryPredictor::AddPredictionToCandidates(
       request.has_composer() &&
       request.composer().GetCursor() == request.composer().GetLength();
 
-  for (size_t i = 0; i < results->size(); ++i) {
+  for (size_t i = 0; i < result_ptrs.size(); ++i) {
     // Pop a result from a heap. Please pay attention not to use results->at(i).
-    std::pop_heap(results->begin(), results->end() - i, ResultCostLess());
-    const Result &result = results->at(results->size() - i - 1);
+    std::pop_heap(result_ptrs.begin(), result_ptrs.end() - i, ResultCostLess());
+    const Result &result = *result_ptrs[result_ptrs.size() - i - 1];
 
     if (added >= size || result.cost >= kInfinity) {
       break;
@@ -1220,6 +1535,7 @@ void DictionaryPredictor::AggregateRealtimeConversion(
     const ConversionRequest &request,
     Segments *segments,
     std::vector<Result> *results) const {
+  ScopedTraceEvent trace_event("DictionaryPredictor::AggregateRealtimeConversion");
   if (!(types & REALTIME)) {
     return;
   }
@@ -1318,6 +1634,7 @@ void DictionaryPredictor::AggregateUnigramPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  ScopedTraceEvent trace_event("DictionaryPredictor::AggregateUnigramPrediction");
   if (!(types & UNIGRAM)) {
     return;
   }
@@ -1343,8 +1660,7 @@ void DictionaryPredictor::AggregateUnigramCandidate(
 
   const size_t cutoff_threshold = GetCandidateCutoffThreshold(segments);
   const size_t prev_results_size = results->size();
-  GetPredictiveResults(*dictionary_, "", request, segments, UNIGRAM,
-                       cutoff_threshold, results);
+  LookupUnigramResults(request, segments, cutoff_threshold, results);
   const size_t unigram_results_size = results->size() - prev_results_size;
 
   // If size reaches max_results_size (== cutoff_threshold).
@@ -1356,12 +1672,90 @@ void DictionaryPredictor::AggregateUnigramCandidate(
   }
 }
 
+void DictionaryPredictor::LookupUnigramResults(
+    const ConversionRequest &request,
+    const Segments &segments,
+    size_t cutoff_threshold,
+    std::vector<Result> *results) const {
+  // Determine the single effective lookup key, mirroring
+  // GetPredictiveResults().  Ambiguity expansion yields several lookup
+  // keys and kana-modifier-insensitive lookup returns keys that do not
+  // start with the query, so the incremental cache steps aside for
+  // those cases.
+  string input_key;
+  bool cachable = !request.IsKanaModifierInsensitiveConversion();
+  if (!request.has_composer() ||
+      !FLAGS_enable_expansion_for_dictionary_predictor) {
+    input_key = segments.conversion_segment(0).key();
+  } else {
+    string base;
+    std::set<string> expanded;
+    request.composer().GetQueriesForPrediction(&base, &expanded);
+    if (expanded.empty()) {
+      input_key = base;
+    } else {
+      cachable = false;
+    }
+  }
+
+  if (!cachable || input_key.empty()) {
+    unigram_cache_key_.clear();
+    unigram_cache_results_.clear();
+    GetPredictiveResults(*dictionary_, "", request, segments, UNIGRAM,
+                         cutoff_threshold, results);
+    return;
+  }
+
+  // When the key appends characters to the cached key and the cached
+  // traversal was exhaustive, filtering the cached results by the new
+  // key gives exactly what LookupPredictive would return, in the same
+  // (trie) order, without touching the dictionary.
+  if (!unigram_cache_key_.empty() &&
+      input_key.size() > unigram_cache_key_.size() &&
+      Util::StartsWith(input_key, unigram_cache_key_) &&
+      unigram_cache_exhaustive_ &&
+      unigram_cache_cutoff_ == cutoff_threshold) {
+    std::vector<Result> filtered;
+    filtered.reserve(unigram_cache_results_.size());
+    for (size_t i = 0; i < unigram_cache_results_.size(); ++i) {
+      if (Util::StartsWith(unigram_cache_results_[i].key, input_key)) {
+        filtered.push_back(unigram_cache_results_[i]);
+      }
+    }
+    VLOG(2) << "Incremental unigram prediction: reused " << filtered.size()
+            << " of " << unigram_cache_results_.size() << " cached results";
+    results->insert(results->end(), filtered.begin(), filtered.end());
+    unigram_cache_key_ = input_key;
+    unigram_cache_results_.swap(filtered);
+    return;
+  }
+
+  const size_t prev_results_size = results->size();
+  bool lookup_truncated = false;
+  GetPredictiveResults(*dictionary_, "", request, segments, UNIGRAM,
+                       cutoff_threshold, results, &lookup_truncated);
+  unigram_cache_key_ = input_key;
+  unigram_cache_cutoff_ = cutoff_threshold;
+  unigram_cache_results_.assign(results->begin() + prev_results_size,
+                                results->end());
+  // The traversal is complete only if neither the result budget nor any
+  // internal traverser cap fired.  A small result set alone proves
+  // nothing: SystemDictionary caps the trie expansion at 64 keys
+  // regardless of |cutoff_threshold|, and token filtering can shrink 64
+  // keys to a handful of results.  A truncated traversal is not a
+  // superset of any longer key's results and must not be reused.
+  unigram_cache_exhaustive_ =
+      !lookup_truncated && (results->size() < cutoff_threshold);
+}
+
 void DictionaryPredictor::AggregateUnigramCandidateForMixedConversion(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
-  AggregateUnigramCandidateForMixedConversion(*dictionary_, request,
-                                              segments, results);
+  std::vector<Result> raw_result;
+  LookupUnigramResults(request, segments, kPredictionMaxResultsSize,
+                       &raw_result);
+  RemoveRedundantResultsForMixedConversion(&raw_result, results);
 }
 
 void DictionaryPredictor::AggregateUnigramCandidateForMixedConversion(
@@ -1376,6 +1770,13 @@ void DictionaryPredictor::AggregateUnigramCandidateForMixedConversion(
   GetPredictiveResults(dictionary, "", request, segments, UNIGRAM,
                        cutoff_threshold, &raw_result);
 
+  RemoveRedundantResultsForMixedConversion(&raw_result, results);
+}
+
+void DictionaryPredictor::RemoveRedundantResultsForMixedConversion(
+    std::vector<Result> *raw_result_ptr, std::vector<Result> *results) {
+  std::vector<Result> &raw_result = *raw_result_ptr;
+
   // Hereafter, we split "Needed Results" and "(maybe) Unneeded Results."
   // The algorithm is:
   // 1) Take the Result with minimum cost.
@@ -1441,6 +1842,7 @@ void DictionaryPredictor::AggregateBigramPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  ScopedTraceEvent trace_event("DictionaryPredictor::AggregateBigramPrediction");
   if (!(types & BIGRAM)) {
     return;
   }
@@ -1589,7 +1991,8 @@ void DictionaryPredictor::GetPredictiveResults(
     const Segments &segments,
     PredictionTypes types,
     size_t lookup_limit,
-    std::vector<Result> *results) {
+    std::vector<Result> *results,
+    bool *truncated) {
   if (!request.has_composer() ||
       !FLAGS_enable_expansion_for_dictionary_predictor) {
     const string &query_key = segments.conversion_segment(0).key();
@@ -1599,6 +2002,9 @@ void DictionaryPredictor::GetPredictiveResults(
     PredictiveLookupCallback callback(types, lookup_limit, input_key.size(),
                                       nullptr, is_zero_query, results);
     dictionary.LookupPredictive(input_key, request, &callback);
+    if (truncated != nullptr && callback.truncated()) {
+      *truncated = true;
+    }
     return;
   }
 
@@ -1617,6 +2023,9 @@ void DictionaryPredictor::GetPredictiveResults(
     PredictiveLookupCallback callback(types, lookup_limit, input_key.size(),
                                       nullptr, is_zero_query, results);
     dictionary.LookupPredictive(input_key, request, &callback);
+    if (truncated != nullptr && callback.truncated()) {
+      *truncated = true;
+    }
     return;
   }
   // |expanded| is a very small set, so calling LookupPredictive multiple times
@@ -1627,6 +2036,9 @@ void DictionaryPredictor::GetPredictiveResults(
     PredictiveLookupCallback callback(types, lookup_limit, input_key.size(),
                                       nullptr, is_zero_query, results);
     dictionary.LookupPredictive(input_key, request, &callback);
+    if (truncated != nullptr && callback.truncated()) {
+      *truncated = true;
+    }
   }
 }
 
@@ -1743,22 +2155,55 @@ void DictionaryPredictor::GetPredictiveResultsUsingTypingCorrection(
 
   std::vector<composer::TypeCorrectedQuery> queries;
   request.composer().GetTypeCorrectedQueriesForPrediction(&queries);
+  if (queries.empty()) {
+    return;
+  }
+
+  // Since the correction penalty is added on top of a positive word
+  // cost, a correction whose penalty alone is not smaller than the
+  // K-th best word cost aggregated so far cannot produce a candidate
+  // that survives the final selection.  Compute that bound once;
+  // |queries| is sorted by penalty, so reaching it also cuts all the
+  // following corrections.
+  int kth_wcost_bound = INT_MAX;
+  const size_t max_candidates_size = segments.max_prediction_candidates_size();
+  if (max_candidates_size > 0 && results->size() >= max_candidates_size) {
+    std::vector<int> wcosts;
+    wcosts.reserve(results->size());
+    for (size_t i = 0; i < results->size(); ++i) {
+      wcosts.push_back(results->at(i).wcost);
+    }
+    std::nth_element(wcosts.begin(),
+                     wcosts.begin() + max_candidates_size - 1, wcosts.end());
+    kth_wcost_bound = wcosts[max_candidates_size - 1];
+  }
+
+  const int base_cost = queries.front().cost;
   for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
     const composer::TypeCorrectedQuery &query = queries[query_index];
+    if (query.cost >= kth_wcost_bound) {
+      break;
+    }
+    // Less probable corrections get proportionally shallower lookups;
+    // every 500 cost units of extra penalty correspond to an e-fold
+    // drop of the correction probability.
+    const size_t query_lookup_limit = std::max<size_t>(
+        1, lookup_limit / (1 + (query.cost - base_cost) / 500));
     const string input_key = history_key + query.base;
     const size_t previous_results_size = results->size();
     PredictiveLookupCallback callback(
-        types, lookup_limit, input_key.size(),
+        types, query_lookup_limit, input_key.size(),
         query.expanded.empty() ? NULL : &query.expanded, false, results);
     dictionary.LookupPredictive(input_key, request, &callback);
 
     for (size_t i = previous_results_size; i < results->size(); ++i) {
       results->at(i).wcost += query.cost;
     }
-    lookup_limit -= results->size() - previous_results_size;
-    if (lookup_limit <= 0) {
+    const size_t num_added = results->size() - previous_results_size;
+    if (num_added >= lookup_limit) {
       break;
     }
+    lookup_limit -= num_added;
   }
 }
 
@@ -1892,6 +2337,7 @@ void DictionaryPredictor::AggregateSuffixPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  ScopedTraceEvent trace_event("DictionaryPredictor::AggregateSuffixPrediction");
   if (!(types & SUFFIX)) {
     return;
   }
@@ -1922,6 +2368,7 @@ void DictionaryPredictor::AggregateEnglishPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  ScopedTraceEvent trace_event("DictionaryPredictor::AggregateEnglishPrediction");
   if (!(types & ENGLISH)) {
     return;
   }
@@ -1949,6 +2396,7 @@ void DictionaryPredictor::AggregateTypeCorrectingPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  ScopedTraceEvent trace_event("DictionaryPredictor::AggregateTypeCorrectingPrediction");
   if (!(types & TYPING_CORRECTION)) {
     return;
   }
@@ -2083,6 +2531,31 @@ bool DictionaryPredictor::ShouldRealTimeConversionEnabled(
           IsMixedConversionEnabled(request.request()));
 }
 
+bool DictionaryPredictor::ShouldDeferRealtimeConversion(
+    const ConversionRequest &request, const Segments &segments) const {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  const uint64 now_usec = sec * 1000000 + usec;
+  const uint64 previous_usec = last_aggregation_time_usec_;
+  last_aggregation_time_usec_ = now_usec;
+
+  // Only plain desktop suggestions are deferrable: explicit PREDICTION
+  // and PARTIAL_* requests must convert, and in mixed conversion the
+  // realtime result is the primary content.
+  if (segments.request_type() != Segments::SUGGESTION ||
+      IsMixedConversionEnabled(request.request())) {
+    return false;
+  }
+
+  // Keystrokes of a fast typing burst arrive well under this interval.
+  // The realtime conversion resumes on the first keystroke after the
+  // cadence drops.
+  const uint64 kFastTypingIntervalUsec = 100 * 1000;  // 100 msec
+  return now_usec >= previous_usec &&
+         now_usec - previous_usec < kFastTypingIntervalUsec;
+}
+
 bool DictionaryPredictor::IsZipCodeRequest(const string &key) {
   if (key.empty()) {
     return false;
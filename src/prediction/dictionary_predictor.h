@@ -31,6 +31,7 @@
 #define MOZC_PREDICTION_DICTIONARY_PREDICTOR_H_
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -154,6 +155,8 @@ class DictionaryPredictor : public PredictorInterface {
     return Result();
   }
 
+  class AggregationWorker;
+  class ZeroQueryPrecomputer;
   class PredictiveLookupCallback;
   class PredictiveBigramLookupCallback;
   class ResultWCostLess;
@@ -203,6 +206,8 @@ class DictionaryPredictor : public PredictorInterface {
   FRIEND_TEST(DictionaryPredictorTest,
               GetPredictionTypesTestWithZeroQuerySuggestion);
   FRIEND_TEST(DictionaryPredictorTest, IsZipCodeRequest);
+  FRIEND_TEST(DictionaryPredictorTest, ShouldDeferRealtimeConversion);
+  FRIEND_TEST(DictionaryPredictorTest, ZeroQueryPrecomputation);
   FRIEND_TEST(DictionaryPredictorTest, GetRealtimeCandidateMaxSize);
   FRIEND_TEST(DictionaryPredictorTest, GetRealtimeCandidateMaxSizeForMixed);
   FRIEND_TEST(DictionaryPredictorTest,
@@ -282,6 +287,10 @@ class DictionaryPredictor : public PredictorInterface {
                          const ConversionRequest &request,
                          Result *result) const;
 
+  // When |truncated| is non-NULL, it is set to true if the dictionary
+  // traversal stopped before enumerating every key below the lookup key
+  // (see DictionaryInterface::Callback::OnTruncated()), i.e. |results|
+  // is not the complete predictive set.
   static void GetPredictiveResults(
       const dictionary::DictionaryInterface &dictionary,
       const string &history_key,
@@ -289,7 +298,8 @@ class DictionaryPredictor : public PredictorInterface {
       const Segments &segments,
       PredictionTypes types,
       size_t lookup_limit,
-      std::vector<Result> *results);
+      std::vector<Result> *results,
+      bool *truncated = nullptr);
 
   void GetPredictiveResultsForBigram(
       const dictionary::DictionaryInterface &dictionary,
@@ -439,12 +449,59 @@ class DictionaryPredictor : public PredictorInterface {
       const Segments &segments,
       std::vector<Result> *results);
 
-  // The same as the static version of this method above but uses |dictionary_|.
+  // The same as the static version of this method above but uses
+  // |dictionary_| and the incremental unigram lookup below.
   void AggregateUnigramCandidateForMixedConversion(
       const ConversionRequest &request,
       const Segments &segments,
       std::vector<Result> *results) const;
 
+  // Removes redundant results (e.g. "東京", "東京大" for "東京大学")
+  // from |raw_result| and appends the survivors to |results|.  Factored
+  // out of AggregateUnigramCandidateForMixedConversion().
+  static void RemoveRedundantResultsForMixedConversion(
+      std::vector<Result> *raw_result, std::vector<Result> *results);
+
+  // Appends the unigram predictive lookup results for the current key to
+  // |results|.  When the key extends the key of the previous call by
+  // appended characters and the previous traversal was exhaustive, the
+  // previous results are filtered by the new key instead of traversing
+  // the dictionary again, making the per-keystroke cost proportional to
+  // the previous result count.  Any other edit (deletion, replacement,
+  // ambiguity expansion, kana-modifier-insensitive lookup) falls back to
+  // a full lookup, which also refreshes the cache.
+  void LookupUnigramResults(const ConversionRequest &request,
+                            const Segments &segments,
+                            size_t cutoff_threshold,
+                            std::vector<Result> *results) const;
+
+  // Returns true if the realtime conversion of this suggestion request
+  // should be skipped because the keystrokes are arriving in a fast
+  // typing burst; the full immutable converter pass would be discarded
+  // by the next key before the user could read its result.  Also
+  // updates the timestamp used to measure the typing cadence, so this
+  // must be called exactly once per prediction request.
+  bool ShouldDeferRealtimeConversion(const ConversionRequest &request,
+                                     const Segments &segments) const;
+
+  // Starts a background thread that precomputes the bigram and suffix
+  // aggregation for the zero-query suggestion the client typically
+  // requests right after a commit; called from Finish().  The thread
+  // runs between the commit and the next (serialized) conversion
+  // request, so it never races with the aggregators.
+  void StartZeroQueryPrecomputation(const ConversionRequest &request,
+                                    const Segments &segments);
+
+  // Serves the results of the precomputation above if they are still
+  // valid for this request.  On a hit, appends the precomputed results
+  // to |results| and clears BIGRAM and SUFFIX from |prediction_types|
+  // so that the corresponding aggregators skip their lookups.
+  bool MaybeGetZeroQueryPrecomputedResults(
+      const ConversionRequest &request,
+      const Segments &segments,
+      PredictionTypes *prediction_types,
+      std::vector<Result> *results) const;
+
   // Returns cutoff threshold of unigram candidates.
   // AggregateUnigramPrediction method does not return any candidates
   // if there are too many (>= cutoff threshold) eligible candidates.
@@ -481,6 +538,29 @@ class DictionaryPredictor : public PredictorInterface {
   ZeroQueryDict zero_query_dict_;
   ZeroQueryDict zero_query_number_dict_;
 
+  // Scratch buffer recycled between PredictForRequest() calls together
+  // with a decayed high-water mark of recent result counts; see
+  // PredictForRequest().  The session layer serializes conversion
+  // requests, so this needs no locking despite the const interface.
+  mutable std::vector<Result> scratch_results_;
+  mutable size_t results_size_high_water_;
+
+  // Cache of the previous unigram lookup for incremental prediction;
+  // see LookupUnigramResults().  Like |scratch_results_|, guarded by
+  // the serialization of conversion requests.
+  mutable string unigram_cache_key_;
+  mutable std::vector<Result> unigram_cache_results_;
+  mutable bool unigram_cache_exhaustive_;
+  mutable size_t unigram_cache_cutoff_;
+
+  // Timestamp of the previous prediction request, used to measure the
+  // typing cadence; see ShouldDeferRealtimeConversion().
+  mutable uint64 last_aggregation_time_usec_;
+
+  // Background precomputation of the post-commit zero-query
+  // suggestion; see StartZeroQueryPrecomputation().
+  mutable std::unique_ptr<ZeroQueryPrecomputer> zero_query_precomputer_;
+
   DISALLOW_COPY_AND_ASSIGN(DictionaryPredictor);
 };
 
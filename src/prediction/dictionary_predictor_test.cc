@@ -37,6 +37,8 @@
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -1798,6 +1800,61 @@ TEST_F(DictionaryPredictorTest, AggregateZeroQuerySuffixPrediction) {
   }
 }
 
+TEST_F(DictionaryPredictorTest, ZeroQueryPrecomputation) {
+  unique_ptr<MockDataAndPredictor> data_and_predictor(new MockDataAndPredictor);
+  data_and_predictor->Init(NULL, new TestSuffixDictionary());
+  TestableDictionaryPredictor *predictor =
+      data_and_predictor->mutable_dictionary_predictor();
+
+  commands::RequestForUnitTest::FillMobileRequest(request_.get());
+
+  // Commit "グーグル"; Finish() starts the precomputation.
+  Segments committed_segments;
+  MakeSegmentsForSuggestion("ぐーぐる", &committed_segments);
+  Segment *segment = committed_segments.mutable_conversion_segment(0);
+  segment->set_segment_type(Segment::FIXED_VALUE);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->key = "ぐーぐる";
+  candidate->value = "グーグル";
+  predictor->Finish(*convreq_, &committed_segments);
+
+  // The zero-query request right after the commit is served from the
+  // precomputed results.
+  Segments segments;
+  MakeSegmentsForSuggestion("", &segments);
+  PrependHistorySegments("ぐーぐる", "グーグル", &segments);
+
+  TestableDictionaryPredictor::PredictionTypes prediction_types =
+      TestableDictionaryPredictor::SUFFIX;
+  std::vector<TestableDictionaryPredictor::Result> results;
+  EXPECT_TRUE(predictor->MaybeGetZeroQueryPrecomputedResults(
+      *convreq_, segments, &prediction_types, &results));
+  EXPECT_EQ(TestableDictionaryPredictor::NO_PREDICTION, prediction_types);
+  EXPECT_FALSE(results.empty());
+
+  // The precomputed results are the ones the on-demand aggregation
+  // would have produced.
+  std::vector<TestableDictionaryPredictor::Result> expected;
+  predictor->AggregateSuffixPrediction(TestableDictionaryPredictor::SUFFIX,
+                                       *convreq_, segments, &expected);
+  ASSERT_EQ(expected.size(), results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(expected[i].key, results[i].key);
+    EXPECT_EQ(expected[i].value, results[i].value);
+  }
+
+  // A different history invalidates the precomputation.
+  Segments other_segments;
+  MakeSegmentsForSuggestion("", &other_segments);
+  PrependHistorySegments("てすと", "テスト", &other_segments);
+  prediction_types = TestableDictionaryPredictor::SUFFIX;
+  results.clear();
+  EXPECT_FALSE(predictor->MaybeGetZeroQueryPrecomputedResults(
+      *convreq_, other_segments, &prediction_types, &results));
+  EXPECT_EQ(TestableDictionaryPredictor::SUFFIX, prediction_types);
+  EXPECT_TRUE(results.empty());
+}
+
 TEST_F(DictionaryPredictorTest, AggregateEnglishPrediction) {
   // Input mode: HALF_ASCII, Key: lower case
   //   => Prediction should be in half-width lower case.
@@ -2112,6 +2169,45 @@ TEST_F(DictionaryPredictorTest, IsZipCodeRequest) {
   EXPECT_FALSE(DictionaryPredictor::IsZipCodeRequest("０１２-０"));
 }
 
+TEST_F(DictionaryPredictorTest, ShouldDeferRealtimeConversion) {
+  ClockMock clock(10000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  const DictionaryPredictor *predictor =
+      data_and_predictor->dictionary_predictor();
+
+  Segments segments;
+  MakeSegmentsForSuggestion("てすと", &segments);
+
+  // The first keystroke after a pause runs the realtime conversion.
+  EXPECT_FALSE(predictor->ShouldDeferRealtimeConversion(*convreq_, segments));
+
+  // 30msec later: mid burst, the conversion is deferred.
+  clock.PutClockForward(0, 30 * 1000);
+  EXPECT_TRUE(predictor->ShouldDeferRealtimeConversion(*convreq_, segments));
+
+  // After a 200msec pause the conversion resumes.
+  clock.PutClockForward(0, 200 * 1000);
+  EXPECT_FALSE(predictor->ShouldDeferRealtimeConversion(*convreq_, segments));
+
+  // Explicit prediction requests are never deferred.
+  clock.PutClockForward(0, 30 * 1000);
+  segments.set_request_type(Segments::PREDICTION);
+  EXPECT_FALSE(predictor->ShouldDeferRealtimeConversion(*convreq_, segments));
+
+  // Neither are mixed conversion requests, where the realtime result is
+  // the primary content.
+  clock.PutClockForward(0, 30 * 1000);
+  segments.set_request_type(Segments::SUGGESTION);
+  request_->set_mixed_conversion(true);
+  EXPECT_FALSE(predictor->ShouldDeferRealtimeConversion(*convreq_, segments));
+  request_->set_mixed_conversion(false);
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
 TEST_F(DictionaryPredictorTest, IsAggressiveSuggestion) {
   unique_ptr<MockDataAndPredictor> data_and_predictor(
       CreateDictionaryPredictorWithMockData());
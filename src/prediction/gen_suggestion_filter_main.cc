@@ -92,7 +92,7 @@ int main(int argc, char **argv) {
   LOG(INFO) << "num_bytes: " << num_bytes;
 
   std::unique_ptr<ExistenceFilter> filter(
-      ExistenceFilter::CreateOptimal(num_bytes, words.size()));
+      ExistenceFilter::CreateOptimalBlocked(num_bytes, words.size()));
   for (size_t i = 0; i < words.size(); ++i) {
     filter->Insert(words[i]);
   }
@@ -37,11 +37,21 @@
       'target_name': 'prediction',
       'type': 'static_library',
       'hard_dependency': 1,
+      'variables': {
+        # Set 1 to run the dictionary-backed prediction aggregators on a
+        # pool of worker threads.
+        'enable_parallel_prediction_aggregation%': 0,
+      },
       'sources': [
         'dictionary_predictor.cc',
         'predictor.cc',
         'user_history_predictor.cc',
       ],
+      'conditions': [
+        ['enable_parallel_prediction_aggregation==1', {
+          'defines': ['MOZC_ENABLE_PARALLEL_PREDICTION_AGGREGATION'],
+        }],
+      ],
       'dependencies': [
         '../base/base.gyp:base',
         '../base/base.gyp:config_file_stream',
@@ -63,6 +73,27 @@
         'prediction_protocol',
       ],
     },
+    {
+      'target_name': 'prediction_benchmark_main',
+      'type': 'executable',
+      'sources': [
+        'prediction_benchmark_main.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../composer/composer.gyp:composer',
+        '../config/config.gyp:config_handler',
+        '../converter/converter_base.gyp:segments',
+        '../data_manager/data_manager_base.gyp:data_manager',
+        '../engine/engine.gyp:engine',
+        '../engine/engine.gyp:engine_factory',
+        '../protocol/protocol.gyp:commands_proto',
+        '../protocol/protocol.gyp:config_proto',
+        '../request/request.gyp:conversion_request',
+        '../session/session.gyp:random_keyevents_generator',
+        'prediction',
+      ],
+    },
     {
       'target_name': 'genproto_prediction',
       'type': 'none',
@@ -0,0 +1,246 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Prediction latency benchmark.
+//
+// Replays keystreams through PredictorInterface::PredictForRequest one
+// keystroke at a time, the way the session layer does while the user is
+// typing, and reports the per-keystroke latency distribution.  The input
+// comes from --keystream_file (one sentence per line, UTF-8; recorded
+// streams can be replayed as-is with --input_mode=raw) or falls back to
+// the stress test sentences.  --data_file runs the same workload against
+// a production data pack instead of the embedded one.  --dump_trace
+// writes the trace ring buffer, which contains the per-stage breakdown
+// of DictionaryPredictor, in Chrome trace format.
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/trace.h"
+#include "base/util.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "config/config_handler.h"
+#include "converter/segments.h"
+#include "data_manager/data_manager.h"
+#include "engine/engine.h"
+#include "engine/engine_factory.h"
+#include "prediction/predictor_interface.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "session/random_keyevents_generator.h"
+
+DEFINE_string(keystream_file, "",
+              "Text file with one sentence per line.  Empty uses the "
+              "embedded stress test sentences.");
+DEFINE_string(input_mode, "romaji",
+              "How sentences are typed: 'romaji' (hiragana converted to "
+              "romaji keys), 'kana' (hiragana typed directly) or 'raw' "
+              "(lines replayed key by key without conversion, e.g. "
+              "recorded 12-key streams).");
+DEFINE_string(data_file, "",
+              "Production data pack.  Empty uses the embedded data.");
+DEFINE_bool(mobile, true, "Benchmarks the mobile (mixed conversion) "
+            "configuration.");
+DEFINE_int32(sentences, 200, "Number of sentences to replay.");
+DEFINE_string(dump_trace, "",
+              "Writes the collected trace, including the per-stage "
+              "breakdown of DictionaryPredictor, to this file in Chrome "
+              "trace format.");
+DEFINE_string(user_profile_dir, "",
+              "User profile directory.  Empty leaves the default, which "
+              "makes the user history predictor see the real profile.");
+
+namespace mozc {
+namespace {
+
+std::unique_ptr<Engine> CreateEngine() {
+  if (FLAGS_data_file.empty()) {
+    return std::unique_ptr<Engine>(EngineFactory::Create());
+  }
+  std::unique_ptr<DataManager> data_manager(new DataManager);
+  const DataManager::Status status =
+      data_manager->InitFromFile(FLAGS_data_file);
+  CHECK(status == DataManager::Status::OK)
+      << "Cannot load " << FLAGS_data_file << ": "
+      << DataManager::StatusCodeToString(status);
+  return Engine::CreateMobileEngine(std::move(data_manager));
+}
+
+void LoadSentences(std::vector<string> *sentences) {
+  if (!FLAGS_keystream_file.empty()) {
+    InputFileStream input(FLAGS_keystream_file.c_str());
+    CHECK(input.good()) << "Cannot open: " << FLAGS_keystream_file;
+    string line;
+    while (std::getline(input, line)) {
+      Util::ChopReturns(&line);
+      if (!line.empty()) {
+        sentences->push_back(line);
+      }
+    }
+  } else {
+    size_t size = 0;
+    const char **test_sentences =
+        session::RandomKeyEventsGenerator::GetTestSentences(&size);
+    CHECK_GT(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+      sentences->push_back(test_sentences[i]);
+    }
+  }
+  if (sentences->size() > static_cast<size_t>(FLAGS_sentences)) {
+    sentences->resize(FLAGS_sentences);
+  }
+}
+
+// Converts a sentence into the per-keystroke input units of the
+// selected input mode.
+void SentenceToKeys(const string &sentence, std::vector<string> *keys) {
+  keys->clear();
+  string input = sentence;
+  if (FLAGS_input_mode == "romaji") {
+    string romaji;
+    Util::HiraganaToRomanji(sentence, &romaji);
+    input = romaji;
+  }
+  for (ConstChar32Iterator iter(input); !iter.Done(); iter.Next()) {
+    string character;
+    Util::UCS4ToUTF8(iter.Get(), &character);
+    keys->push_back(character);
+  }
+}
+
+string GetStats(std::vector<uint32> *times) {
+  if (times->empty()) {
+    return "no samples";
+  }
+  std::sort(times->begin(), times->end());
+  uint64 total = 0;
+  for (size_t i = 0; i < times->size(); ++i) {
+    total += (*times)[i];
+  }
+  const size_t size = times->size();
+  return Util::StringPrintf(
+      "size=%d avg=%d p50=%u p95=%u p99=%u max=%u",
+      static_cast<int>(size), static_cast<int>(total / size),
+      (*times)[size * 50 / 100], (*times)[std::min(size - 1, size * 95 / 100)],
+      (*times)[std::min(size - 1, size * 99 / 100)], (*times)[size - 1]);
+}
+
+int Run() {
+  if (!FLAGS_user_profile_dir.empty()) {
+    SystemUtil::SetUserProfileDirectory(FLAGS_user_profile_dir);
+  }
+
+  std::unique_ptr<Engine> engine = CreateEngine();
+
+  commands::Request request;
+  if (FLAGS_mobile) {
+    request.set_mixed_conversion(true);
+    request.set_zero_query_suggestion(true);
+    request.set_update_input_mode_from_surrounding_text(false);
+  }
+  config::Config config;
+  config::ConfigHandler::GetDefaultConfig(&config);
+
+  composer::Table table;
+  if (FLAGS_input_mode == "romaji") {
+    CHECK(table.LoadFromFile("system://romanji-hiragana.tsv"));
+  }
+  composer::Composer composer(&table, &request, &config);
+  const ConversionRequest conversion_request(&composer, &request, &config);
+
+  std::vector<string> sentences;
+  LoadSentences(&sentences);
+  CHECK(!sentences.empty());
+
+  Trace::Clear();
+  std::vector<uint32> times;
+  Segments segments;
+  string query;
+  std::vector<string> keys;
+  size_t candidates = 0;
+  for (size_t i = 0; i < sentences.size(); ++i) {
+    SentenceToKeys(sentences[i], &keys);
+    composer.Reset();
+    for (size_t j = 0; j < keys.size(); ++j) {
+      composer.InsertCharacter(keys[j]);
+      composer.GetQueryForPrediction(&query);
+      if (query.empty()) {
+        continue;
+      }
+      segments.Clear();
+      segments.set_request_type(FLAGS_mobile ? Segments::PREDICTION
+                                             : Segments::SUGGESTION);
+      segments.add_segment()->set_key(query);
+
+      Stopwatch stopwatch = Stopwatch::StartNew();
+      engine->GetPredictor()->PredictForRequest(conversion_request, &segments);
+      stopwatch.Stop();
+      times.push_back(static_cast<uint32>(stopwatch.GetElapsedMicroseconds()));
+      if (segments.conversion_segments_size() > 0) {
+        candidates += segments.conversion_segment(0).candidates_size();
+      }
+    }
+  }
+
+  std::cout << "input_mode: " << FLAGS_input_mode
+            << (FLAGS_data_file.empty() ? " (embedded data)"
+                                        : " (data pack)") << std::endl;
+  std::cout << "candidates: " << candidates << std::endl;
+  std::cout << "per-keystroke usec: " << GetStats(&times) << std::endl;
+
+  if (!FLAGS_dump_trace.empty()) {
+    string json;
+    Trace::DumpJson(&json);
+    OutputFileStream output(FLAGS_dump_trace.c_str());
+    CHECK(output.good()) << "Cannot write: " << FLAGS_dump_trace;
+    output << json;
+    std::cout << "trace written to " << FLAGS_dump_trace << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  return mozc::Run();
+}
@@ -34,8 +34,11 @@
 #include <vector>
 
 #include "base/flags.h"
+#include "base/hash.h"
 #include "base/logging.h"
+#include "composer/composer.h"
 #include "converter/segments.h"
+#include "dictionary/user_dictionary.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 
@@ -50,6 +53,10 @@ const int kPredictionSize = 100;
 // conversion so the limit is same as conversion's one.
 const int kMobilePredictionSize = 200;
 
+// Number of memoized merges.  Backspace-retype sequences revisit only a
+// few recent keys, so a small cache is enough.
+const size_t kPredictionCacheSize = 16;
+
 size_t GetCandidatesSize(const Segments &segments) {
   if (segments.conversion_segments_size() <= 0) {
     LOG(ERROR) << "No conversion segments found";
@@ -69,7 +76,8 @@ bool IsZeroQuery(const ConversionRequest &request) {
 BasePredictor::BasePredictor(PredictorInterface *dictionary_predictor,
                              PredictorInterface *user_history_predictor)
     : dictionary_predictor_(dictionary_predictor),
-      user_history_predictor_(user_history_predictor) {
+      user_history_predictor_(user_history_predictor),
+      prediction_cache_(kPredictionCacheSize) {
   DCHECK(dictionary_predictor_.get());
   DCHECK(user_history_predictor_.get());
   // TODO(noriyukit): Now the following features are stable, so remove these
@@ -82,6 +90,7 @@ BasePredictor::~BasePredictor() {}
 
 void BasePredictor::Finish(const ConversionRequest &request,
                            Segments *segments) {
+  prediction_cache_.Clear();
   user_history_predictor_->Finish(request, segments);
   dictionary_predictor_->Finish(request, segments);
 
@@ -103,18 +112,22 @@ void BasePredictor::Finish(const ConversionRequest &request,
 // Since DictionaryPredictor is immutable, no need
 // to call DictionaryPredictor::Revert/Clear*/Finish methods.
 void BasePredictor::Revert(Segments *segments) {
+  prediction_cache_.Clear();
   user_history_predictor_->Revert(segments);
 }
 
 bool BasePredictor::ClearAllHistory() {
+  prediction_cache_.Clear();
   return user_history_predictor_->ClearAllHistory();
 }
 
 bool BasePredictor::ClearUnusedHistory() {
+  prediction_cache_.Clear();
   return user_history_predictor_->ClearUnusedHistory();
 }
 
 bool BasePredictor::ClearHistoryEntry(const string &key, const string &value) {
+  prediction_cache_.Clear();
   return user_history_predictor_->ClearHistoryEntry(key, value);
 }
 
@@ -127,9 +140,80 @@ bool BasePredictor::Sync() {
 }
 
 bool BasePredictor::Reload() {
+  prediction_cache_.Clear();
   return user_history_predictor_->Reload();
 }
 
+// static
+uint64 BasePredictor::PredictionCacheKey(const ConversionRequest &request,
+                                         const Segments &segments) {
+  uint64 fp = Hash::FingerprintWithSeed(
+      segments.conversion_segment(0).key(),
+      static_cast<uint32>(segments.request_type()));
+  // The conversion key alone does not capture in-flight composition
+  // (e.g. a trailing consonant of romaji input), so mix in the preedit.
+  if (request.has_composer()) {
+    string preedit;
+    request.composer().GetStringForPreedit(&preedit);
+    fp = Hash::FingerprintWithSeed(preedit, static_cast<uint32>(fp));
+  }
+  for (size_t i = 0; i < segments.history_segments_size(); ++i) {
+    const Segment &history_segment = segments.history_segment(i);
+    fp = Hash::FingerprintWithSeed(history_segment.key(),
+                                   static_cast<uint32>(fp));
+    if (history_segment.candidates_size() > 0) {
+      fp = Hash::FingerprintWithSeed(history_segment.candidate(0).value,
+                                     static_cast<uint32>(fp));
+    }
+  }
+  fp = Hash::FingerprintWithSeed(request.request().SerializeAsString(),
+                                 static_cast<uint32>(fp));
+  fp = Hash::FingerprintWithSeed(request.config().SerializeAsString(),
+                                 static_cast<uint32>(fp));
+  // The RELOAD command reaches only UserDictionary::Reload(), not Reload()
+  // of this class, and the reloader thread publishes the new tokens index
+  // at an arbitrary later point.  Folding the generation into the key
+  // invalidates entries cached against the old dictionary image exactly
+  // when the swap happens.
+  fp = Hash::FingerprintWithSeed(dictionary::UserDictionary::generation(),
+                                 static_cast<uint32>(fp));
+  return fp;
+}
+
+bool BasePredictor::LookupPredictionCache(uint64 key, Segments *segments,
+                                          bool *result) const {
+  const PredictionCacheEntry *entry = prediction_cache_.Lookup(key);
+  if (entry == nullptr) {
+    return false;
+  }
+  Segment *segment = segments->mutable_conversion_segment(0);
+  for (size_t i = 0; i < entry->candidates.size(); ++i) {
+    segment->push_back_candidate()->CopyFrom(entry->candidates[i]);
+  }
+  segments->set_max_prediction_candidates_size(
+      entry->max_prediction_candidates_size);
+  *result = entry->result;
+  return true;
+}
+
+void BasePredictor::StorePredictionCache(uint64 key, const Segments &segments,
+                                         bool result) const {
+  const Segment &segment = segments.conversion_segment(0);
+  PredictionCache::Element *element = prediction_cache_.Insert(key);
+  if (element == nullptr) {
+    return;
+  }
+  PredictionCacheEntry *entry = &element->value;
+  entry->result = result;
+  entry->max_prediction_candidates_size =
+      segments.max_prediction_candidates_size();
+  entry->candidates.clear();
+  entry->candidates.resize(segment.candidates_size());
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    entry->candidates[i].CopyFrom(segment.candidate(i));
+  }
+}
+
 // static
 PredictorInterface *DefaultPredictor::CreateDefaultPredictor(
     PredictorInterface *dictionary_predictor,
@@ -156,6 +240,22 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
     return false;
   }
 
+  // Backspace-retype sequences re-issue recently merged queries, so
+  // replay the memoized merge when the segment starts out empty.  The
+  // cache is cleared by every mutable operation and the key covers the
+  // request and config protos, so stale merges cannot leak across
+  // commits or config changes.
+  const bool use_cache = segments->conversion_segments_size() > 0 &&
+                         GetCandidatesSize(*segments) == 0;
+  uint64 cache_key = 0;
+  if (use_cache) {
+    cache_key = PredictionCacheKey(request, *segments);
+    bool cached_result = false;
+    if (LookupPredictionCache(cache_key, segments, &cached_result)) {
+      return cached_result;
+    }
+  }
+
   int size = kPredictionSize;
   if (segments->request_type() == Segments::SUGGESTION) {
     size = std::min(
@@ -170,18 +270,13 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
 
   // Do not call dictionary_predictor if the size of candidates get
   // >= suggestions_size.
-  if (remained_size <= 0) {
-    return result;
+  if (remained_size > 0) {
+    segments->set_max_prediction_candidates_size(remained_size);
+    result |= dictionary_predictor_->PredictForRequest(request, segments);
   }
 
-  segments->set_max_prediction_candidates_size(remained_size);
-  result |= dictionary_predictor_->PredictForRequest(request, segments);
-  remained_size = size - static_cast<size_t>(GetCandidatesSize(*segments));
-
-  // Do not call extra_predictor if the size of candidates get
-  // >= suggestions_size.
-  if (remained_size <= 0) {
-    return result;
+  if (use_cache) {
+    StorePredictionCache(cache_key, *segments, result);
   }
 
   return result;
@@ -215,6 +310,18 @@ bool MobilePredictor::PredictForRequest(const ConversionRequest &request,
 
   DCHECK(segments);
 
+  // See the comment in DefaultPredictor::PredictForRequest().
+  const bool use_cache = segments->conversion_segments_size() > 0 &&
+                         GetCandidatesSize(*segments) == 0;
+  uint64 cache_key = 0;
+  if (use_cache) {
+    cache_key = PredictionCacheKey(request, *segments);
+    bool cached_result = false;
+    if (LookupPredictionCache(cache_key, segments, &cached_result)) {
+      return cached_result;
+    }
+  }
+
   bool result = false;
   size_t size = 0;
   size_t history_suggestion_size = IsZeroQuery(request) ? 3 : 2;
@@ -261,6 +368,10 @@ bool MobilePredictor::PredictForRequest(const ConversionRequest &request,
     }  // Never reach here
   }
 
+  if (use_cache) {
+    StorePredictionCache(cache_key, *segments, result);
+  }
+
   return result;
 }
 
@@ -32,9 +32,13 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "base/port.h"
+#include "converter/segments.h"
 #include "prediction/predictor_interface.h"
 #include "request/conversion_request.h"
+#include "storage/lru_cache.h"
 
 namespace mozc {
 
@@ -77,8 +81,45 @@ class BasePredictor : public PredictorInterface {
   //                        Segments *segments) const = 0;
 
  protected:
+  // Memoized output of one PredictForRequest() call: the candidates
+  // that the sub predictors appended to the first conversion segment.
+  struct PredictionCacheEntry {
+    bool result;
+    size_t max_prediction_candidates_size;
+    std::vector<Segment::Candidate> candidates;
+  };
+
+  // Computes the cache key for |request| and |segments|: a fingerprint
+  // over the request type, the conversion key, the composer preedit,
+  // the history segments and the request/config protos.  Including the
+  // protos makes config changes miss the cache naturally, without an
+  // extra invalidation hook.
+  static uint64 PredictionCacheKey(const ConversionRequest &request,
+                                   const Segments &segments);
+
+  // Replays the memoized candidates into |segments| and sets |*result|
+  // when the same query was merged before.  Returns false on miss.
+  bool LookupPredictionCache(uint64 key, Segments *segments,
+                             bool *result) const;
+
+  // Memoizes the merged candidates of the first conversion segment.
+  // Only called when the segment was empty before prediction, so every
+  // candidate in it came from the sub predictors.
+  void StorePredictionCache(uint64 key, const Segments &segments,
+                            bool result) const;
+
   std::unique_ptr<PredictorInterface> dictionary_predictor_;
   std::unique_ptr<PredictorInterface> user_history_predictor_;
+
+ private:
+  typedef mozc::storage::LRUCache<uint64, PredictionCacheEntry>
+      PredictionCache;
+
+  // mutable: PredictForRequest() is logically const.  The session layer
+  // serializes conversion requests, so no locking is needed.  The cache
+  // is cleared by every mutable operation (Finish, Revert, Clear*,
+  // Reload) as they can change what the sub predictors return.
+  mutable PredictionCache prediction_cache_;
 };
 
 // TODO(team): The name should be DesktopPredictor
@@ -349,6 +349,41 @@ TEST_F(PredictorTest, CallPredictForRequet) {
 }
 
 
+TEST_F(PredictorTest, PredictionCache) {
+  NullPredictor *predictor1 = new NullPredictor(true);
+  NullPredictor *predictor2 = new NullPredictor(true);
+  unique_ptr<DefaultPredictor> predictor(new DefaultPredictor(predictor1,
+                                                              predictor2));
+  Segments segments;
+  {
+    segments.set_request_type(Segments::SUGGESTION);
+    Segment *segment;
+    segment = segments.add_segment();
+    CHECK(segment);
+    segment->set_key("わたし");
+  }
+
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_TRUE(predictor1->predict_called());
+  EXPECT_TRUE(predictor2->predict_called());
+
+  // The identical query is served from the cache without calling the
+  // sub predictors again.
+  predictor1->Clear();
+  predictor2->Clear();
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_FALSE(predictor1->predict_called());
+  EXPECT_FALSE(predictor2->predict_called());
+
+  // Finish() invalidates the memoized merges.
+  predictor->Finish(*convreq_, &segments);
+  predictor1->Clear();
+  predictor2->Clear();
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_TRUE(predictor1->predict_called());
+  EXPECT_TRUE(predictor2->predict_called());
+}
+
 TEST_F(PredictorTest, DisableAllSuggestion) {
   NullPredictor *predictor1 = new NullPredictor(true);
   NullPredictor *predictor2 = new NullPredictor(true);
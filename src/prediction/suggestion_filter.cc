@@ -35,8 +35,16 @@
 #include "storage/existence_filter.h"
 
 namespace mozc {
+namespace {
 
-SuggestionFilter::SuggestionFilter(const char *data, size_t size) {
+// Number of memo slots.  Must be large enough to cover the candidates
+// generated for one keystroke; collisions only cost a recomputation.
+const size_t kMemoSize = 1024;
+
+}  // namespace
+
+SuggestionFilter::SuggestionFilter(const char *data, size_t size)
+    : memo_(kMemoSize) {
   filter_.reset(mozc::storage::ExistenceFilter::Read(data, size));
   LOG_IF(ERROR, filter_.get() == nullptr)
       << "SuggestionFilterData is broken";
@@ -45,12 +53,28 @@ SuggestionFilter::SuggestionFilter(const char *data, size_t size) {
 SuggestionFilter::~SuggestionFilter() {}
 
 bool SuggestionFilter::IsBadSuggestion(const string &text) const {
+  return IsBadSuggestion(text, 0);
+}
+
+bool SuggestionFilter::IsBadSuggestion(const string &text,
+                                       uint64 fingerprint) const {
   if (filter_.get() == nullptr) {
     return false;
   }
+  // The memo is keyed by the fingerprint of the raw |text|; the slot is
+  // zero-initialized, so a fingerprint of 0 just never hits the memo.
+  const uint64 fp =
+      (fingerprint != 0) ? fingerprint : Hash::Fingerprint(text);
+  MemoSlot *slot = &memo_[fp % memo_.size()];
+  if (slot->fp == fp) {
+    return slot->is_bad;
+  }
   string lower_text = text;
   Util::LowerString(&lower_text);
-  return filter_->Exists(Hash::Fingerprint(lower_text));
+  const bool is_bad = filter_->Exists(Hash::Fingerprint(lower_text));
+  slot->fp = fp;
+  slot->is_bad = is_bad;
+  return is_bad;
 }
 
 }  // namespace mozc
@@ -32,6 +32,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 
@@ -48,8 +49,25 @@ class SuggestionFilter {
 
   bool IsBadSuggestion(const string &text) const;
 
+  // Same as above with |fingerprint| = Hash::Fingerprint(text) already
+  // computed by the caller (e.g. taken from
+  // Segment::Candidate::value_fingerprint); 0 means unknown, in which
+  // case it is computed here.
+  bool IsBadSuggestion(const string &text, uint64 fingerprint) const;
+
  private:
+  // Memoizes recent results keyed by the fingerprint of |text|, so that
+  // candidates re-checked on consecutive keystrokes (the common case
+  // while typing) skip the lowercase copy and the filter probe.
+  // mutable: IsBadSuggestion() is logically const; the session layer
+  // serializes conversion requests, so no locking is needed.
+  struct MemoSlot {
+    uint64 fp;
+    bool is_bad;
+  };
+
   std::unique_ptr<mozc::storage::ExistenceFilter> filter_;
+  mutable std::vector<MemoSlot> memo_;
 
   DISALLOW_COPY_AND_ASSIGN(SuggestionFilter);
 };
@@ -37,6 +37,7 @@
 
 #include "base/clock.h"
 #include "base/config_file_stream.h"
+#include "base/file_util.h"
 #include "base/flags.h"
 #include "base/hash.h"
 #include "base/logging.h"
@@ -112,6 +113,10 @@ const char kFileName[] = "user://history.db";
 const char kFileName[] = "user://.history.db";
 #endif
 
+// Suffix for the journal file, which holds the entries changed since
+// the last full save; see UserHistoryPredictor::SaveJournal().
+const char kJournalFileNameSuffix[] = ".journal";
+
 // Uses '\t' as a key/value delimiter
 const char kDelimiter[] = "\t";
 const char kEmojiDescription[] = "絵文字";
@@ -400,7 +405,13 @@ UserHistoryPredictor::UserHistoryPredictor(
       predictor_name_("UserHistoryPredictor"),
       content_word_learning_enabled_(enable_content_word_learning),
       updated_(false),
-      dic_(new DicCache(UserHistoryPredictor::cache_size())) {
+      dic_(new DicCache(UserHistoryPredictor::cache_size())),
+      requires_full_save_(false) {
+  // Let CacheBudgetManager trim the LRU cache when the process is over
+  // its cache budget.  The per-element estimate includes the typical
+  // heap payload of the Entry proto.
+  dic_->RegisterCacheBudgetClient("UserHistoryPredictor",
+                                  sizeof(DicElement) + 128);
   AsyncLoad();  // non-blocking
   // Load()  blocking version can be used if any
 }
@@ -415,6 +426,10 @@ string UserHistoryPredictor::GetUserHistoryFileName() {
   return ConfigFileStream::GetFileName(kFileName);
 }
 
+string UserHistoryPredictor::GetUserHistoryJournalFileName() {
+  return GetUserHistoryFileName() + kJournalFileNameSuffix;
+}
+
 // Returns revert id
 // static
 uint16 UserHistoryPredictor::revert_id() {
@@ -495,9 +510,33 @@ bool UserHistoryPredictor::Load() {
   }
 
   for (size_t i = 0; i < history.entries_size(); ++i) {
-    dic_->Insert(EntryFingerprint(history.entries(i)),
-                 history.entries(i));
+    const Entry &entry = history.entries(i);
+    const uint32 dic_key = EntryFingerprint(entry);
+    MaybeUnindexLRUTail(dic_key);
+    dic_->Insert(dic_key, entry);
+    IndexEntry(entry.key(), dic_key);
+  }
+
+  // Replays the entries journaled since the last full save.  They are
+  // inserted after the snapshot so that they stay the most recent ones
+  // in the LRU, and are kept dirty so that the next incremental save
+  // does not drop them from the journal.
+  const string journal_filename = GetUserHistoryJournalFileName();
+  if (FileUtil::FileExists(journal_filename)) {
+    UserHistoryStorage journal(journal_filename);
+    if (journal.Load()) {
+      for (size_t i = 0; i < journal.entries_size(); ++i) {
+        const Entry &entry = journal.entries(i);
+        const uint32 dic_key = EntryFingerprint(entry);
+        MaybeUnindexLRUTail(dic_key);
+        dic_->Insert(dic_key, entry);
+        IndexEntry(entry.key(), dic_key);
+        MarkDirty(dic_key);
+      }
+      VLOG(1) << "Replayed journal, size=" << journal.entries_size();
+    }
   }
+  MaybeRebuildKeyIndex();
 
   VLOG(1) << "Loaded user histroy, size=" << history.entries_size();
 
@@ -517,6 +556,18 @@ bool UserHistoryPredictor::Save() {
     return true;
   }
 
+  // Incremental save: when every change since the last full save can be
+  // expressed as an entry rewrite, saving just the dirty entries to the
+  // journal is enough.  A full snapshot, which also compacts the
+  // journal away, is written when entries were removed or when the
+  // journal would grow past a quarter of the cache.
+  if (!requires_full_save_ &&
+      dirty_keys_.size() * 4 < dic_->Size() &&
+      SaveJournal()) {
+    updated_ = false;
+    return true;
+  }
+
   const string filename = GetUserHistoryFileName();
 
   UserHistoryStorage history(filename);
@@ -534,11 +585,46 @@ bool UserHistoryPredictor::Save() {
     return false;
   }
 
+  // Every entry is now in the snapshot; the journal is obsolete.
+  FileUtil::Unlink(GetUserHistoryJournalFileName());
+  dirty_keys_.clear();
+  requires_full_save_ = false;
+
   updated_ = false;
 
   return true;
 }
 
+bool UserHistoryPredictor::SaveJournal() {
+  UserHistoryStorage journal(GetUserHistoryJournalFileName());
+  // Walks from the tail as Save() does so that the relative LRU order
+  // of the dirty entries survives the replay in Load().
+  for (const DicElement *elm = dic_->Tail(); elm != nullptr;
+       elm = elm->prev) {
+    if (dirty_keys_.find(elm->key) != dirty_keys_.end()) {
+      journal.add_entries()->CopyFrom(elm->value);
+    }
+  }
+
+  if (journal.entries_size() == 0) {
+    // All dirty entries were evicted; let Save() write a full snapshot.
+    return false;
+  }
+
+  if (!journal.Save()) {
+    LOG(ERROR) << "UserHistoryStorage::Save() failed for the journal";
+    return false;
+  }
+
+  VLOG(1) << "Saved journal, size=" << journal.entries_size();
+
+  return true;
+}
+
+void UserHistoryPredictor::MarkDirty(uint32 dic_key) {
+  dirty_keys_.insert(dic_key);
+}
+
 bool UserHistoryPredictor::ClearAllHistory() {
   // Waits until syncer finishes
   WaitForSyncer();
@@ -547,6 +633,11 @@ bool UserHistoryPredictor::ClearAllHistory() {
   // Renews DicCache as LRUCache tries to reuse the internal value by
   // using FreeList
   dic_.reset(new DicCache(UserHistoryPredictor::cache_size()));
+  dic_->RegisterCacheBudgetClient("UserHistoryPredictor",
+                                  sizeof(DicElement) + 128);
+  key_index_.clear();
+  dirty_keys_.clear();
+  requires_full_save_ = true;
 
   // insert a dummy event entry.
   InsertEvent(Entry::CLEAN_ALL_EVENT);
@@ -579,11 +670,17 @@ bool UserHistoryPredictor::ClearUnusedHistory() {
 
   for (size_t i = 0; i < keys.size(); ++i) {
     VLOG(2) << "Removing: " << keys[i];
+    UnindexEntry(keys[i]);
     if (!dic_->Erase(keys[i])) {
       LOG(ERROR) << "cannot erase " << keys[i];
     }
   }
 
+  if (!keys.empty()) {
+    // The journal cannot express removals.
+    requires_full_save_ = true;
+  }
+
   // Inserts a dummy event entry.
   InsertEvent(Entry::CLEAN_UNUSED_EVENT);
 
@@ -733,6 +830,9 @@ bool UserHistoryPredictor::ClearHistoryEntry(const string &key,
     }
   }
   if (deleted) {
+    // The removed flags and the broken chains touch entries all over
+    // the cache; write a full snapshot instead of tracking them.
+    requires_full_save_ = true;
     updated_ = true;
   }
   return deleted;
@@ -1330,6 +1430,16 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
   unique_ptr<Trie<string>> expanded;
   GetInputKeyFromSegments(request, segments, &input_key, &base_key, &expanded);
 
+  // Fast path: when the query is a plain prefix probe, visit only the
+  // entries indexed under a key that can match |base_key| instead of
+  // scanning the whole LRU list.
+  if (LookupFromKeyIndex(request_type, input_key, base_key, expanded.get(),
+                         roman_input_key, prev_entry,
+                         request.request().available_emoji_carrier(),
+                         max_results_size, results)) {
+    return;
+  }
+
   int trial = 0;
   for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
     if (!IsValidEntryIgnoringRemovedField(
@@ -1358,6 +1468,80 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
   }
 }
 
+bool UserHistoryPredictor::LookupFromKeyIndex(
+    RequestType request_type,
+    const string &input_key,
+    const string &base_key,
+    const Trie<string> *key_expanded,
+    const string &roman_input_key,
+    const Entry *prev_entry,
+    uint32 available_emoji_carrier,
+    size_t max_results_size,
+    EntryPriorityQueue *results) const {
+  // An empty |base_key| (zero query) matches every entry through
+  // LEFT_EMPTY_MATCH and a roman-misspelled key needs
+  // RomanFuzzyLookupEntry(); both require the full LRU scan.
+  if (base_key.empty() || !roman_input_key.empty()) {
+    return false;
+  }
+
+  // Probes the proper prefixes of |base_key| first, from the shortest
+  // one.  Prefixes that do not end at a character boundary cannot match
+  // any stored key and are skipped.
+  for (size_t len = Util::OneCharLen(base_key.data());
+       len < base_key.size();
+       len += Util::OneCharLen(base_key.data() + len)) {
+    if (LookupIndexRange(request_type, input_key, base_key, key_expanded,
+                         base_key.substr(0, len), true, prev_entry,
+                         available_emoji_carrier, max_results_size,
+                         results)) {
+      return true;
+    }
+  }
+
+  // Then the contiguous range of keys starting with |base_key|.
+  LookupIndexRange(request_type, input_key, base_key, key_expanded,
+                   base_key, false, prev_entry,
+                   available_emoji_carrier, max_results_size, results);
+  return true;
+}
+
+bool UserHistoryPredictor::LookupIndexRange(
+    RequestType request_type,
+    const string &input_key,
+    const string &base_key,
+    const Trie<string> *key_expanded,
+    const string &range_key,
+    bool exact_match,
+    const Entry *prev_entry,
+    uint32 available_emoji_carrier,
+    size_t max_results_size,
+    EntryPriorityQueue *results) const {
+  for (KeyIndex::iterator it = key_index_.lower_bound(
+           std::make_pair(range_key, static_cast<uint32>(0)));
+       it != key_index_.end();) {
+    if (exact_match ? it->first != range_key
+                    : !Util::StartsWith(it->first, range_key)) {
+      break;
+    }
+    const Entry *entry = dic_->LookupWithoutInsert(it->second);
+    if (entry == nullptr || entry->key() != it->first) {
+      // Stale pair left by an eviction in |dic_|.
+      it = key_index_.erase(it);
+      continue;
+    }
+    if (IsValidEntryIgnoringRemovedField(*entry, available_emoji_carrier)) {
+      LookupEntry(request_type, input_key, base_key, key_expanded, entry,
+                  prev_entry, results);
+      if (results->size() >= max_results_size) {
+        return true;
+      }
+    }
+    ++it;
+  }
+  return false;
+}
+
 // static
 void UserHistoryPredictor::GetInputKeyFromSegments(
     const ConversionRequest &request, const Segments &segments,
@@ -1555,6 +1739,48 @@ bool UserHistoryPredictor::IsValidEntryIgnoringRemovedField(
   return true;
 }
 
+void UserHistoryPredictor::IndexEntry(const string &key, uint32 dic_key) {
+  if (!key.empty()) {
+    key_index_.insert(std::make_pair(key, dic_key));
+  }
+}
+
+void UserHistoryPredictor::UnindexEntry(uint32 dic_key) {
+  const Entry *entry = dic_->LookupWithoutInsert(dic_key);
+  if (entry != nullptr && !entry->key().empty()) {
+    key_index_.erase(std::make_pair(entry->key(), dic_key));
+  }
+}
+
+void UserHistoryPredictor::MaybeUnindexLRUTail(uint32 new_dic_key) {
+  // LRUCache::Insert() evicts the least recently used element when the
+  // cache is full and |new_dic_key| is not stored yet.
+  if (dic_->Size() < UserHistoryPredictor::cache_size() ||
+      dic_->HasKey(new_dic_key)) {
+    return;
+  }
+  const DicElement *tail = dic_->Tail();
+  if (tail != nullptr && !tail->value.key().empty()) {
+    key_index_.erase(std::make_pair(tail->value.key(), tail->key));
+  }
+}
+
+void UserHistoryPredictor::MaybeRebuildKeyIndex() {
+  // Evictions requested by the cache budget manager happen inside
+  // LRUCache::Insert() where the victims cannot be observed.  The stale
+  // pairs they leave are dropped lazily by LookupIndexRange(); rebuild
+  // from scratch only when too many of them accumulate unqueried.
+  const size_t kMaxStaleIndexEntries = 256;
+  if (key_index_.size() <= dic_->Size() + kMaxStaleIndexEntries) {
+    return;
+  }
+  key_index_.clear();
+  for (const DicElement *elm = dic_->Head(); elm != nullptr;
+       elm = elm->next) {
+    IndexEntry(elm->value.key(), elm->key);
+  }
+}
+
 void UserHistoryPredictor::InsertEvent(EntryType type) {
   if (type == Entry::DEFAULT_ENTRY) {
     return;
@@ -1564,6 +1790,7 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
   const uint32 dic_key = Fingerprint("", "", type);
 
   CHECK(dic_.get());
+  MaybeUnindexLRUTail(dic_key);
   DicElement *e = dic_->Insert(dic_key);
   if (e == nullptr) {
     VLOG(2) << "insert failed";
@@ -1575,6 +1802,7 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
   entry->Clear();
   entry->set_entry_type(type);
   entry->set_last_access_time(last_access_time);
+  MarkDirty(dic_key);
 }
 
 void UserHistoryPredictor::TryInsert(RequestType request_type,
@@ -1627,6 +1855,7 @@ void UserHistoryPredictor::Insert(const string &key,
     // add a treatment for UPDATE_ENTRY mode
   }
 
+  MaybeUnindexLRUTail(dic_key);
   DicElement *e = dic_->Insert(dic_key);
   if (e == nullptr) {
     VLOG(2) << "insert failed";
@@ -1639,6 +1868,9 @@ void UserHistoryPredictor::Insert(const string &key,
   entry->set_key(key);
   entry->set_value(value);
   entry->set_removed(false);
+  IndexEntry(key, dic_key);
+  MarkDirty(dic_key);
+  MaybeRebuildKeyIndex();
 
   if (description.empty()) {
     entry->clear_description();
@@ -1941,8 +2173,12 @@ void UserHistoryPredictor::InsertHistory(RequestType request_type,
          Util::CharsLen(conversion_segment.value) > 1)) {
       return;
     }
-    Entry *history_entry = dic_->MutableLookupWithoutInsert(
-        LearningSegmentFingerprint(history_segment));
+    const uint32 history_fp = LearningSegmentFingerprint(history_segment);
+    Entry *history_entry = dic_->MutableLookupWithoutInsert(history_fp);
+    if (history_entry != nullptr) {
+      // The entry is modified in place below.
+      MarkDirty(history_fp);
+    }
     NextEntry next_entry;
     if (segments->request_type() == Segments::CONVERSION) {
       next_entry.set_entry_fp(LearningSegmentFingerprint(conversion_segment));
@@ -1971,8 +2207,12 @@ void UserHistoryPredictor::Revert(Segments *segments) {
         segments->revert_entry(i);
     if (revert_entry.id == UserHistoryPredictor::revert_id() &&
         revert_entry.revert_entry_type == Segments::RevertEntry::CREATE_ENTRY) {
-      VLOG(2) << "Erasing the key: " << StringToUint32(revert_entry.key);
-      dic_->Erase(StringToUint32(revert_entry.key));
+      const uint32 dic_key = StringToUint32(revert_entry.key);
+      VLOG(2) << "Erasing the key: " << dic_key;
+      UnindexEntry(dic_key);
+      dic_->Erase(dic_key);
+      // The journal cannot express the removal.
+      requires_full_save_ = true;
     }
   }
 }
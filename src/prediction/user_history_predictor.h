@@ -127,6 +127,10 @@ class UserHistoryPredictor : public PredictorInterface {
   // Gets user history filename.
   static string GetUserHistoryFileName();
 
+  // Gets the filename of the journal which holds the entries changed
+  // since the last full save.
+  static string GetUserHistoryJournalFileName();
+
   const string &GetPredictorName() const override { return predictor_name_; }
 
   // From user_history_predictor.proto
@@ -307,6 +311,15 @@ class UserHistoryPredictor : public PredictorInterface {
   // Saves user history data in LRU to local file
   bool Save();
 
+  // Saves only the entries marked dirty since the last full save into
+  // the journal file, so that the autosave cost is proportional to what
+  // changed during the interval.  Called from Save().
+  bool SaveJournal();
+
+  // Marks the entry |dic_key| as changed so that the next incremental
+  // save picks it up.
+  void MarkDirty(uint32 dic_key);
+
   // non-blocking version of Load
   // This makes a new thread and call Load()
   bool AsyncSave();
@@ -384,6 +397,12 @@ class UserHistoryPredictor : public PredictorInterface {
   typedef mozc::storage::LRUCache<uint32, Entry> DicCache;
   typedef DicCache::Element DicElement;
 
+  // Secondary index over the entries in |dic_|, sorted by
+  // (entry key, fingerprint).  LookupFromKeyIndex() uses it to visit
+  // only the entries that can match the current input key instead of
+  // scanning the whole LRU list.
+  typedef std::set<std::pair<string, uint32>> KeyIndex;
+
   bool CheckSyncerAndDelete() const;
 
   // If |entry| is the target of prediction,
@@ -432,6 +451,39 @@ class UserHistoryPredictor : public PredictorInterface {
       const Entry *prev_entry,
       EntryPriorityQueue *results) const;
 
+  // Visits only the entries that can match |base_key| by consulting
+  // |key_index_|: GetMatchTypeFromInput() returns NO_MATCH unless the
+  // entry key starts with |base_key| or is a proper prefix of it, so
+  // the candidates form one contiguous index range plus a handful of
+  // point probes.  Returns false when the query needs the full LRU scan
+  // instead: an empty |base_key| matches every entry through
+  // LEFT_EMPTY_MATCH and a roman-misspelled key needs fuzzy matching.
+  bool LookupFromKeyIndex(RequestType request_type,
+                          const string &input_key,
+                          const string &base_key,
+                          const Trie<string> *key_expanded,
+                          const string &roman_input_key,
+                          const Entry *prev_entry,
+                          uint32 available_emoji_carrier,
+                          size_t max_results_size,
+                          EntryPriorityQueue *results) const;
+
+  // Runs LookupEntry() over the index pairs starting at |range_key|:
+  // all keys starting with |range_key|, or only the keys equal to it
+  // when |exact_match| is true.  Stale pairs left by evictions in
+  // |dic_| are erased on the way.  Returns true once |results| has
+  // reached |max_results_size|.
+  bool LookupIndexRange(RequestType request_type,
+                        const string &input_key,
+                        const string &base_key,
+                        const Trie<string> *key_expanded,
+                        const string &range_key,
+                        bool exact_match,
+                        const Entry *prev_entry,
+                        uint32 available_emoji_carrier,
+                        size_t max_results_size,
+                        EntryPriorityQueue *results) const;
+
   // Gets input data from segments.
   // These input data include ambiguities.
   static void GetInputKeyFromSegments(
@@ -507,6 +559,16 @@ class UserHistoryPredictor : public PredictorInterface {
   // Inserts event entry (CLEAN_ALL_EVENT|CLEAN_UNUSED_EVENT).
   void InsertEvent(EntryType type);
 
+  // Keep |key_index_| in sync with |dic_|.  MaybeUnindexLRUTail() must
+  // be called just before a dic_->Insert() that can evict the least
+  // recently used element.  Entries with an empty key (event entries)
+  // are not indexed.  MaybeRebuildKeyIndex() reconciles the index when
+  // budget-driven evictions have left too many stale pairs behind.
+  void IndexEntry(const string &key, uint32 dic_key);
+  void UnindexEntry(uint32 dic_key);
+  void MaybeUnindexLRUTail(uint32 new_dic_key);
+  void MaybeRebuildKeyIndex();
+
   // Inserts a new |next_entry| into |entry|.
   // it makes a bigram connection from entry to next_entry.
   void InsertNextEntry(const NextEntry &next_entry, Entry *entry) const;
@@ -534,6 +596,16 @@ class UserHistoryPredictor : public PredictorInterface {
   bool content_word_learning_enabled_;
   bool updated_;
   std::unique_ptr<DicCache> dic_;
+  // mutable: lookups lazily drop pairs whose entry was evicted from
+  // |dic_| by the cache budget manager.
+  mutable KeyIndex key_index_;
+  // Fingerprints of the entries changed since the last full save; see
+  // SaveJournal().
+  std::set<uint32> dirty_keys_;
+  // When true, the next Save() writes a full snapshot and truncates the
+  // journal.  Set by operations the journal cannot express, such as
+  // entry removal.
+  bool requires_full_save_;
   mutable std::unique_ptr<UserHistoryPredictorSyncer> syncer_;
 };
 
@@ -32,10 +32,14 @@
 
 #include <algorithm>
 #include <iterator>
+#include <memory>
+#include <string>
 #include <utility>
 
+#include "base/hash.h"
 #include "base/port.h"
 #include "base/serialized_string_array.h"
+#include "storage/existence_filter.h"
 
 namespace mozc {
 
@@ -190,9 +194,13 @@ class ZeroQueryDict {
     const SerializedStringArray * string_array_;
   };
 
+  ZeroQueryDict() : memo_begin_(0), memo_end_(0), memo_valid_(false) {}
+
   void Init(StringPiece token_array_data, StringPiece string_array_data) {
     token_array_ = token_array_data;
     string_array_.Set(string_array_data);
+    memo_valid_ = false;
+    BuildKeyFilter();
   }
 
   iterator begin() const {
@@ -205,17 +213,71 @@ class ZeroQueryDict {
   }
 
   std::pair<iterator, iterator> equal_range(StringPiece key) const {
+    // Most commits have no zero query entry; the blocked bloom filter
+    // built in Init() rejects such keys without any binary search.
+    if (key_filter_ != nullptr &&
+        !key_filter_->Exists(Hash::Fingerprint(key))) {
+      return std::pair<iterator, iterator>(end(), end());
+    }
+
+    // Zero query lookups tend to repeat the same key on consecutive
+    // keystrokes, so the last range is memoized.  There is no locking
+    // on the mutable memo: the session layer serializes conversion
+    // requests, and DictionaryPredictor joins its zero-query
+    // precomputation thread before any foreground zero-query
+    // aggregation, so a dict is never read from two threads at once.
+    if (memo_valid_ && key == StringPiece(memo_key_)) {
+      return std::pair<iterator, iterator>(
+          iterator(token_array_.data() + memo_begin_, &string_array_),
+          iterator(token_array_.data() + memo_end_, &string_array_));
+    }
+
+    std::pair<iterator, iterator> range(end(), end());
     const auto iter = std::lower_bound(string_array_.begin(),
                                        string_array_.end(), key);
-    if (iter == string_array_.end() || *iter != key) {
-      return std::pair<iterator, iterator>(end(), end());
+    if (iter != string_array_.end() && *iter == key) {
+      range = std::equal_range(begin(), end(), iter.index());
     }
-    return std::equal_range(begin(), end(), iter.index());
+    memo_key_.assign(key.data(), key.size());
+    memo_begin_ = (range.first - begin()) * kTokenByteSize;
+    memo_end_ = (range.second - begin()) * kTokenByteSize;
+    memo_valid_ = true;
+    return range;
   }
 
  private:
+  // Builds a blocked bloom filter over the keys in the token array so
+  // that lookups of keys not in the dictionary skip the binary searches
+  // entirely.
+  void BuildKeyFilter() {
+    key_filter_.reset();
+    const size_t num_tokens = token_array_.size() / kTokenByteSize;
+    if (num_tokens == 0) {
+      return;
+    }
+    const size_t filter_size =
+        storage::ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+            0.01f, num_tokens);
+    key_filter_.reset(storage::ExistenceFilter::CreateOptimalBlocked(
+        filter_size, num_tokens));
+    if (key_filter_ == nullptr) {
+      return;
+    }
+    for (iterator iter = begin(); iter != end(); ++iter) {
+      key_filter_->Insert(Hash::Fingerprint(iter.key()));
+    }
+  }
+
   StringPiece token_array_;
   SerializedStringArray string_array_;
+  std::unique_ptr<storage::ExistenceFilter> key_filter_;
+
+  // Memo of the last equal_range() result as byte offsets into
+  // |token_array_|; see the comment in equal_range().
+  mutable string memo_key_;
+  mutable size_t memo_begin_;
+  mutable size_t memo_end_;
+  mutable bool memo_valid_;
 };
 
 }  // namespace mozc
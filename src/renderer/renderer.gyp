@@ -60,6 +60,18 @@
         '../base/base.gyp:base',
       ],
     },
+    {
+      'target_name': 'text_metrics_cache',
+      'type': 'static_library',
+      'sources': [
+        'text_metrics_cache.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../base/base.gyp:hash',
+        '../storage/storage.gyp:storage',
+      ],
+    },
     {
       'target_name': 'renderer_client',
       'type': 'static_library',
@@ -147,6 +159,20 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'text_metrics_cache_test',
+      'type': 'executable',
+      'sources': [
+        'text_metrics_cache_test.cc',
+      ],
+      'dependencies': [
+        '../testing/testing.gyp:gtest_main',
+        'text_metrics_cache',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'renderer_style_handler',
       'type': 'static_library',
@@ -184,6 +210,7 @@
         'renderer_server_test',
         'renderer_style_handler_test',
         'table_layout_test',
+        'text_metrics_cache_test',
         'window_util_test',
       ],
       'conditions': [
@@ -360,6 +387,7 @@
             '../base/base.gyp:base',
             '../protocol/protocol.gyp:renderer_proto',
             'renderer_style_handler',
+            'text_metrics_cache',
           ],
           'link_settings': {
             'msvs_settings': {
@@ -584,6 +612,7 @@
             'renderer_server',
             'renderer_style_handler',
             'table_layout',
+            'text_metrics_cache',
             'window_util',
           ],
         },
@@ -41,6 +41,7 @@
 #include "base/run_level.h"
 #include "base/system_util.h"
 #include "base/thread.h"
+#include "base/unnamed_event.h"
 #include "base/util.h"
 #include "base/version.h"
 #include "ipc/ipc.h"
@@ -66,11 +67,19 @@ const size_t kMaxErrorTimes         = 5;
 const uint64 kRetryIntervalTime     = 30;  // 30 sec
 const char   kServiceName[]         = "renderer";
 
-inline void CallCommand(IPCClientInterface *client,
-                        const commands::RendererCommand &command) {
-  string buf;
-  command.SerializeToString(&buf);
+// Updates arriving within this interval after the previous one replace
+// the buffered update instead of being sent; roughly half a frame at
+// 60Hz.  See RendererClient::ExecCommand().
+const uint64 kUpdateCoalesceIntervalMSec = 8;
 
+uint64 GetCurrentMSec() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000 + usec / 1000;
+}
+
+inline void CallCommand(IPCClientInterface *client, const string &buf) {
   // basically, we don't need to get the result
   char result[32];
   size_t result_size = sizeof(result);
@@ -81,6 +90,13 @@ inline void CallCommand(IPCClientInterface *client,
     LOG(ERROR) << "Cannot send the request: ";
   }
 }
+
+inline void CallCommand(IPCClientInterface *client,
+                        const commands::RendererCommand &command) {
+  string buf;
+  command.SerializeToString(&buf);
+  CallCommand(client, buf);
+}
 }  // namespace
 
 class RendererLauncher : public RendererLauncherInterface,
@@ -316,13 +332,53 @@ class RendererLauncher : public RendererLauncherInterface,
   Mutex pending_command_mutex_;
 };
 
+class RendererClient::Flusher : public Thread {
+ public:
+  explicit Flusher(RendererClient *client)
+      : client_(client), terminated_(false) {
+    SetJoinable(true);
+    Thread::Start("RendererClientFlusher");
+  }
+
+  // Wakes the thread up; a new update has been buffered.
+  void Wakeup() {
+    event_.Notify();
+  }
+
+  void Quit() {
+    terminated_ = true;
+    event_.Notify();
+    Join();
+  }
+
+  virtual void Run() {
+    while (!terminated_) {
+      if (!event_.Wait(-1) || terminated_) {
+        return;
+      }
+      // Let the rest of the coalesce interval pass so that the newest
+      // update at flush time wins, then send it.
+      Util::Sleep(kUpdateCoalesceIntervalMSec);
+      client_->FlushBufferedUpdate();
+    }
+  }
+
+ private:
+  RendererClient *client_;
+  volatile bool terminated_;
+  UnnamedEvent event_;
+
+  DISALLOW_COPY_AND_ASSIGN(Flusher);
+};
+
 RendererClient::RendererClient()
     : is_window_visible_(false),
       disable_renderer_path_check_(false),
       version_mismatch_nums_(0),
       ipc_client_factory_interface_(IPCClientFactory::GetIPCClientFactory()),
       renderer_launcher_(new RendererLauncher),
-      renderer_launcher_interface_(NULL) {
+      renderer_launcher_interface_(NULL),
+      last_update_time_(0) {
   renderer_launcher_interface_ = renderer_launcher_.get();
 
   name_ = kServiceName;
@@ -336,6 +392,9 @@ RendererClient::RendererClient()
 }
 
 RendererClient::~RendererClient() {
+  if (flusher_.get() != NULL) {
+    flusher_->Quit();
+  }
   if (!IsAvailable() || !is_window_visible_) {
     return;
   }
@@ -412,6 +471,59 @@ void RendererClient::set_suppress_error_dialog(bool suppress) {
 }
 
 bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
+  // Coalesce the update stream.  During fast typing several UPDATE
+  // commands can arrive within one repaint of the renderer, and
+  // painting the intermediate candidate windows is wasted work.  An
+  // update which follows the previous send within
+  // kUpdateCoalesceIntervalMSec replaces the buffered one and is
+  // flushed by the flusher thread once the interval has elapsed, so the
+  // renderer always ends up with the newest state.  Anything that
+  // changes the visibility or is not an UPDATE bypasses the buffer.
+  const bool update_in_place =
+      command.type() == commands::RendererCommand::UPDATE &&
+      command.visible() && is_window_visible_;
+  {
+    scoped_lock l(&coalesce_mutex_);
+    if (update_in_place) {
+      const uint64 now = GetCurrentMSec();
+      if (now - last_update_time_ < kUpdateCoalesceIntervalMSec) {
+        if (buffered_command_.get() == NULL) {
+          buffered_command_.reset(new commands::RendererCommand);
+        }
+        buffered_command_->CopyFrom(command);
+        if (flusher_.get() == NULL) {
+          flusher_.reset(new Flusher(this));
+        }
+        flusher_->Wakeup();
+        return true;
+      }
+      last_update_time_ = now;
+    }
+    // This command supersedes whatever was waiting for the flush.
+    buffered_command_.reset();
+  }
+
+  scoped_lock l(&ipc_mutex_);
+  return ExecCommandInternal(command);
+}
+
+void RendererClient::FlushBufferedUpdate() {
+  scoped_lock l(&ipc_mutex_);
+  std::unique_ptr<commands::RendererCommand> command;
+  {
+    scoped_lock l_coalesce(&coalesce_mutex_);
+    if (buffered_command_.get() == NULL) {
+      // Already flushed or superseded by a direct send.
+      return;
+    }
+    command = std::move(buffered_command_);
+    last_update_time_ = GetCurrentMSec();
+  }
+  ExecCommandInternal(*command);
+}
+
+bool RendererClient::ExecCommandInternal(
+    const commands::RendererCommand &command) {
   if (renderer_launcher_interface_ == NULL) {
     LOG(ERROR) << "RendererLauncher is NULL";
     return false;
@@ -449,6 +561,13 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     return false;
   }
 
+  // True if this update repaints a window which is already visible; only
+  // such updates may be dropped as duplicates below.  Commands that show
+  // or hide the window must always reach the renderer.
+  const bool repaints_visible_window =
+      command.type() == commands::RendererCommand::UPDATE &&
+      command.visible() && is_window_visible_;
+
   is_window_visible_ = command.visible();
 
   if (!client->Connected()) {
@@ -499,7 +618,18 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     return true;
   }
 
-  CallCommand(client.get(), command);
+  // Serialize once and compare with the last payload actually sent.  The
+  // client already holds the full Output it passed to us, so a payload
+  // identical to the previous one carries no new information and would
+  // only trigger a redundant deserialization and repaint in the renderer.
+  string buf;
+  command.SerializeToString(&buf);
+  if (repaints_visible_window && buf == last_sent_payload_) {
+    VLOG(2) << "Dropping an update identical to the previous one";
+    return true;
+  }
+  CallCommand(client.get(), buf);
+  last_sent_payload_.swap(buf);
 
   return true;
 }
@@ -33,6 +33,7 @@
 #include <memory>
 #include <string>
 
+#include "base/mutex.h"
 #include "base/port.h"
 #include "renderer/renderer_interface.h"
 
@@ -125,8 +126,19 @@ class RendererClient : public RendererInterface {
   void set_suppress_error_dialog(bool suppress);
 
  private:
+  // Background thread flushing the update buffered by ExecCommand().
+  // Defined in renderer_client.cc.
+  class Flusher;
+
   IPCClientInterface *CreateIPCClient() const;
 
+  // Sends |command| to the renderer without coalescing.  This is the
+  // body of ExecCommand(); see the comment there.
+  bool ExecCommandInternal(const commands::RendererCommand &command);
+
+  // Sends the buffered update, if any.  Called from the flusher thread.
+  void FlushBufferedUpdate();
+
   bool is_window_visible_;
   bool disable_renderer_path_check_;
   int  version_mismatch_nums_;
@@ -137,6 +149,21 @@ class RendererClient : public RendererInterface {
 
   std::unique_ptr<RendererLauncherInterface> renderer_launcher_;
   RendererLauncherInterface *renderer_launcher_interface_;
+
+  // The newest update waiting for the coalesce interval to elapse, or
+  // NULL.  Guarded by coalesce_mutex_, as is last_update_time_.
+  std::unique_ptr<commands::RendererCommand> buffered_command_;
+  uint64 last_update_time_;
+  Mutex coalesce_mutex_;
+  // Serializes the actual sends between the caller and the flusher so
+  // that a buffered update can never overtake a newer command.
+  Mutex ipc_mutex_;
+  std::unique_ptr<Flusher> flusher_;
+
+  // Serialized form of the last command actually sent, guarded by
+  // ipc_mutex_.  Updates whose payload is identical to it are dropped;
+  // see ExecCommandInternal().
+  string last_sent_payload_;
 };
 
 }  // namespace renderer
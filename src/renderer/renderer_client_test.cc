@@ -31,6 +31,8 @@
 
 #include <string>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/port.h"
@@ -394,6 +396,109 @@ TEST(RendererClient, ConnectionTest) {
   }
 }
 
+TEST(RendererClient, UpdateCoalesceTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+
+  // Freeze the clock so that every update falls inside the coalesce
+  // interval.
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  // Each update carries a different payload; identical payloads would be
+  // dropped as duplicates before reaching the IPC layer.
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+
+  {
+    launcher.Reset();
+    launcher.set_can_connect(true);
+    TestIPCClient::set_connected(true);
+    TestIPCClient::Reset();
+
+    // The first update makes the window visible and is sent directly.
+    command.mutable_output()->set_id(1);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(1, TestIPCClient::counter());
+
+    // The second update is the first one while the window is already
+    // visible, so it is still sent directly.
+    command.mutable_output()->set_id(2);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(2, TestIPCClient::counter());
+
+    // With the clock frozen, the next update falls inside the coalesce
+    // interval: it is buffered and sent by the flusher thread later.
+    command.mutable_output()->set_id(3);
+    EXPECT_TRUE(client.ExecCommand(command));
+    Util::Sleep(200);
+    EXPECT_EQ(3, TestIPCClient::counter());
+
+    // Hiding the window is never buffered.
+    command.set_visible(false);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(4, TestIPCClient::counter());
+  }
+
+  Clock::SetClockForUnitTest(NULL);
+}
+
+TEST(RendererClient, IdenticalUpdateTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  command.mutable_output()->set_id(1);
+
+  {
+    launcher.Reset();
+    launcher.set_can_connect(true);
+    TestIPCClient::set_connected(true);
+    TestIPCClient::Reset();
+
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(1, TestIPCClient::counter());
+
+    // An update identical to what the renderer already displays is
+    // dropped.  Advance the clock so that the update is not coalesced.
+    clock.PutClockForward(1, 0);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(1, TestIPCClient::counter());
+
+    // A changed payload goes through.
+    clock.PutClockForward(1, 0);
+    command.mutable_output()->set_id(2);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(2, TestIPCClient::counter());
+
+    // Hiding the window is never dropped, even twice in a row.
+    clock.PutClockForward(1, 0);
+    command.set_visible(false);
+    EXPECT_TRUE(client.ExecCommand(command));
+    clock.PutClockForward(1, 0);
+    EXPECT_TRUE(client.ExecCommand(command));
+    EXPECT_EQ(4, TestIPCClient::counter());
+  }
+
+  Clock::SetClockForUnitTest(NULL);
+}
+
 TEST(RendererClient, ShutdownTest) {
   TestIPCClientFactory factory;
   TestRendererLauncher launcher;
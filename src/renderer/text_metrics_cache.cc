@@ -0,0 +1,83 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "renderer/text_metrics_cache.h"
+
+#include "base/hash.h"
+#include "base/logging.h"
+
+namespace mozc {
+namespace renderer {
+namespace {
+
+// A screenful of candidates plus the fixed footer strings is measured
+// per update, so a four-digit bound keeps several pages of distinct
+// candidates resident while staying below a few hundred kilobytes.
+const size_t kDefaultMaxEntries = 1024;
+
+uint64 MakeFingerprint(uint32 font_key, StringPiece text) {
+  return Hash::FingerprintWithSeed(text, font_key);
+}
+
+}  // namespace
+
+TextMetricsCache::TextMetricsCache()
+    : cache_(kDefaultMaxEntries) {}
+
+TextMetricsCache::TextMetricsCache(size_t max_entries)
+    : cache_(max_entries) {}
+
+TextMetricsCache::~TextMetricsCache() {}
+
+bool TextMetricsCache::Lookup(uint32 font_key, StringPiece text,
+                              mozc::Size *size) {
+  DCHECK(size);
+  const mozc::Size *cached = cache_.Lookup(MakeFingerprint(font_key, text));
+  if (cached == NULL) {
+    return false;
+  }
+  *size = *cached;
+  return true;
+}
+
+void TextMetricsCache::Insert(uint32 font_key, StringPiece text,
+                              const mozc::Size &size) {
+  cache_.Insert(MakeFingerprint(font_key, text), size);
+}
+
+void TextMetricsCache::Clear() {
+  cache_.Clear();
+}
+
+size_t TextMetricsCache::Size() const {
+  return cache_.Size();
+}
+
+}  // namespace renderer
+}  // namespace mozc
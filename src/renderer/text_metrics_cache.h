@@ -0,0 +1,84 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_RENDERER_TEXT_METRICS_CACHE_H_
+#define MOZC_RENDERER_TEXT_METRICS_CACHE_H_
+
+#include "base/coordinates.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "storage/lru_cache.h"
+
+namespace mozc {
+namespace renderer {
+
+// Bounded LRU cache of text extents, shared by the platform renderer
+// backends.  Candidate sets overlap heavily between successive updates,
+// so measuring a string once per (font, text) pair removes most of the
+// platform text measurement calls from the update path.
+//
+// Entries are keyed by a 64-bit fingerprint of |font_key| and the text
+// bytes; |font_key| identifies the font and any other layout input the
+// extent depends on (e.g. a wrapping width).  A fingerprint collision
+// would return the extent of another string, which is harmless for
+// window layout and practically never happens with 64 bits.
+//
+// This class is not thread-safe; each backend uses its own instance
+// from its rendering thread.
+class TextMetricsCache {
+ public:
+  TextMetricsCache();
+  explicit TextMetricsCache(size_t max_entries);
+  ~TextMetricsCache();
+
+  // Returns true and fills |size| if the extent of |text| measured
+  // under |font_key| is cached.  A hit refreshes the entry's LRU order.
+  // |Size| is written as |mozc::Size| below to disambiguate it from the
+  // Size() accessor.
+  bool Lookup(uint32 font_key, StringPiece text, mozc::Size *size);
+
+  // Caches the measured extent of |text| under |font_key|, evicting the
+  // least recently used entry when the cache is full.
+  void Insert(uint32 font_key, StringPiece text, const mozc::Size &size);
+
+  // Removes all entries; call when the font configuration changes.
+  void Clear();
+
+  size_t Size() const;
+
+ private:
+  storage::LRUCache<uint64, mozc::Size> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(TextMetricsCache);
+};
+
+}  // namespace renderer
+}  // namespace mozc
+
+#endif  // MOZC_RENDERER_TEXT_METRICS_CACHE_H_
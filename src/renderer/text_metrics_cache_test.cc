@@ -0,0 +1,80 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "renderer/text_metrics_cache.h"
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace renderer {
+
+TEST(TextMetricsCacheTest, BasicTest) {
+  TextMetricsCache cache;
+
+  Size size;
+  EXPECT_FALSE(cache.Lookup(0, "text", &size));
+
+  cache.Insert(0, "text", Size(12, 34));
+  ASSERT_TRUE(cache.Lookup(0, "text", &size));
+  EXPECT_EQ(12, size.width);
+  EXPECT_EQ(34, size.height);
+  EXPECT_EQ(1, cache.Size());
+
+  // The same text under another font key is a different entry.
+  EXPECT_FALSE(cache.Lookup(1, "text", &size));
+  cache.Insert(1, "text", Size(56, 78));
+  ASSERT_TRUE(cache.Lookup(1, "text", &size));
+  EXPECT_EQ(56, size.width);
+  EXPECT_EQ(78, size.height);
+  EXPECT_EQ(2, cache.Size());
+
+  cache.Clear();
+  EXPECT_EQ(0, cache.Size());
+  EXPECT_FALSE(cache.Lookup(0, "text", &size));
+}
+
+TEST(TextMetricsCacheTest, LRUBoundTest) {
+  TextMetricsCache cache(2);
+
+  cache.Insert(0, "a", Size(1, 1));
+  cache.Insert(0, "b", Size(2, 2));
+
+  // Touch "a" so that "b" becomes the least recently used entry.
+  Size size;
+  ASSERT_TRUE(cache.Lookup(0, "a", &size));
+
+  cache.Insert(0, "c", Size(3, 3));
+  EXPECT_EQ(2, cache.Size());
+  EXPECT_TRUE(cache.Lookup(0, "a", &size));
+  EXPECT_FALSE(cache.Lookup(0, "b", &size));
+  EXPECT_TRUE(cache.Lookup(0, "c", &size));
+}
+
+}  // namespace renderer
+}  // namespace mozc
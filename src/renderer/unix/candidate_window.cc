@@ -387,6 +387,7 @@ Size CandidateWindow::Update(const commands::Candidates &candidates) {
       (candidates_.category()  == commands::USAGE))
       << "Unknown candidate category" << candidates_.category();
 
+  previous_candidates_.CopyFrom(candidates_);
   candidates_.CopyFrom(candidates);
 
   table_layout_->Initialize(candidates_.candidate_size(), NUMBER_OF_COLUMNS);
@@ -401,9 +402,47 @@ Size CandidateWindow::Update(const commands::Candidates &candidates) {
   UpdateGap2Size(has_description);
 
   table_layout_->FreezeLayout();
-  Resize(table_layout_->GetTotalSize());
-  Redraw();
-  return table_layout_->GetTotalSize();
+  const Size total_size = table_layout_->GetTotalSize();
+  if (total_size.width == previous_total_size_.width &&
+      total_size.height == previous_total_size_.height &&
+      OnlyFocusedIndexDiffers(previous_candidates_, candidates_)) {
+    // Only the selection moved within the same rows; repainting the two
+    // affected rows and the footer (which shows the focused index) is
+    // enough.  GDK's expose double buffering then blits just these
+    // regions, which keeps per-keystroke traffic small on remote X.
+    RedrawFocusedRow(previous_candidates_);
+    RedrawFocusedRow(candidates_);
+    RedrawRect(table_layout_->GetFooterRect());
+  } else {
+    Resize(total_size);
+    Redraw();
+  }
+  previous_total_size_ = total_size;
+  return total_size;
+}
+
+bool CandidateWindow::OnlyFocusedIndexDiffers(
+    const commands::Candidates &lhs, const commands::Candidates &rhs) {
+  commands::Candidates lhs_copy;
+  lhs_copy.CopyFrom(lhs);
+  lhs_copy.clear_focused_index();
+  commands::Candidates rhs_copy;
+  rhs_copy.CopyFrom(rhs);
+  rhs_copy.clear_focused_index();
+  return lhs_copy.SerializeAsString() == rhs_copy.SerializeAsString();
+}
+
+void CandidateWindow::RedrawFocusedRow(
+    const commands::Candidates &candidates) {
+  if (!candidates.has_focused_index()) {
+    return;
+  }
+  const int row_index = GetCandidateArrayIndexByCandidateIndex(
+      candidates, candidates.focused_index());
+  if (row_index >= candidates.candidate_size()) {
+    return;
+  }
+  RedrawRect(table_layout_->GetRowRect(row_index));
 }
 
 void CandidateWindow::GetDisplayString(
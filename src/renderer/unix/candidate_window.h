@@ -123,6 +123,14 @@ class CandidateWindow : public GtkWindowBase {
   void UpdateCandidatesSize(bool *has_description);
   void UpdateGap2Size(bool has_description);
 
+  // Returns true if the two candidate lists render identically except
+  // for the focused row, i.e. a repaint of the affected rows is enough.
+  static bool OnlyFocusedIndexDiffers(const commands::Candidates &lhs,
+                                      const commands::Candidates &rhs);
+
+  // Invalidates the row rectangle of |candidates|'s focused candidate.
+  void RedrawFocusedRow(const commands::Candidates &candidates);
+
   // TODO(nona): Remove FRIEND_TEST
   FRIEND_TEST(CandidateWindowTest, DrawBackgroundTest);
   FRIEND_TEST(CandidateWindowTest, DrawShortcutBackgroundTest);
@@ -144,8 +152,13 @@ class CandidateWindow : public GtkWindowBase {
   FRIEND_TEST(CandidateWindowTest, UpdateGap2SizeTest);
   FRIEND_TEST(CandidateWindowTest, OnMouseLeftUpTest);
   FRIEND_TEST(CandidateWindowTest, GetSelectedRowIndexTest);
+  FRIEND_TEST(CandidateWindowTest, OnlyFocusedIndexDiffersTest);
 
   commands::Candidates candidates_;
+  // Candidates and window size of the previous Update(); used to limit
+  // the repaint to the rows whose selection state changed.
+  commands::Candidates previous_candidates_;
+  Size previous_total_size_;
   std::unique_ptr<TableLayoutInterface> table_layout_;
   std::unique_ptr<TextRendererInterface> text_renderer_;
   std::unique_ptr<DrawToolInterface> draw_tool_;
@@ -1156,6 +1156,38 @@ TEST_F(CandidateWindowTest, UpdateTest) {
   // TODO(nona): Implement this test.
 }
 
+TEST_F(CandidateWindowTest, OnlyFocusedIndexDiffersTest) {
+  commands::Candidates lhs;
+  SetTestCandidates(5, true, true, true, false, false, &lhs);
+  lhs.set_focused_index(0);
+
+  commands::Candidates rhs;
+  rhs.CopyFrom(lhs);
+  EXPECT_TRUE(CandidateWindow::OnlyFocusedIndexDiffers(lhs, rhs));
+
+  // Moving the selection keeps the rows repaintable in place.
+  rhs.set_focused_index(3);
+  EXPECT_TRUE(CandidateWindow::OnlyFocusedIndexDiffers(lhs, rhs));
+
+  rhs.clear_focused_index();
+  EXPECT_TRUE(CandidateWindow::OnlyFocusedIndexDiffers(lhs, rhs));
+
+  // Any row content change requires a full repaint.
+  rhs.CopyFrom(lhs);
+  rhs.set_focused_index(3);
+  rhs.mutable_candidate(2)->set_value("modified");
+  EXPECT_FALSE(CandidateWindow::OnlyFocusedIndexDiffers(lhs, rhs));
+
+  rhs.CopyFrom(lhs);
+  rhs.mutable_footer()->set_label("footer");
+  EXPECT_FALSE(CandidateWindow::OnlyFocusedIndexDiffers(lhs, rhs));
+
+  rhs.CopyFrom(lhs);
+  SetTestCandidates(4, true, true, true, false, false, &rhs);
+  rhs.set_focused_index(0);
+  EXPECT_FALSE(CandidateWindow::OnlyFocusedIndexDiffers(lhs, rhs));
+}
+
 TEST_F(CandidateWindowTest, UpdateGap1SizeTest) {
   CandidateWindowTestKit testkit = SetUpCandidateWindow();
 
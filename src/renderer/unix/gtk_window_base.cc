@@ -114,6 +114,11 @@ void GtkWindowBase::Redraw() {
   gtk_->GtkWidgetQueueDrawArea(window_, 0, 0, size.width, size.height);
 }
 
+void GtkWindowBase::RedrawRect(const Rect &rect) {
+  gtk_->GtkWidgetQueueDrawArea(window_, rect.origin.x, rect.origin.y,
+                               rect.size.width, rect.size.height);
+}
+
 // Callbacks
 bool GtkWindowBase::OnDestroy(GtkWidget *widget) {
   gtk_->GtkMainQuit();
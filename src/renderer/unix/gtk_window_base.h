@@ -79,6 +79,9 @@ class GtkWindowBase : public GtkWindowInterface {
   virtual void Move(const Point &pos);
   virtual void Resize(const Size &size);
   virtual void Redraw();
+  // Invalidates only |rect| in window coordinates; GDK repaints (and on
+  // remote X, transfers) just that region on the next expose.
+  virtual void RedrawRect(const Rect &rect);
 
   virtual void Initialize();
   virtual Size Update(const commands::Candidates &candidates);
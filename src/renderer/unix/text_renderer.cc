@@ -44,6 +44,7 @@ TextRenderer::TextRenderer(FontSpecInterface *font_spec)
 
 void TextRenderer::Initialize(GdkDrawable *drawable) {
   pango_.reset(new PangoWrapper(drawable));
+  pixel_size_cache_.Clear();
 }
 
 void TextRenderer::SetUpPangoLayout(const string &str,
@@ -60,8 +61,14 @@ void TextRenderer::SetUpPangoLayout(const string &str,
 
 Size TextRenderer::GetPixelSize(FontSpecInterface::FONT_TYPE font_type,
                                 const string &str) {
+  Size size;
+  if (pixel_size_cache_.Lookup(font_type, str, &size)) {
+    return size;
+  }
   PangoLayoutWrapper layout(pango_->GetContext());
-  return GetPixelSizeInternal(font_type, str, &layout);
+  size = GetPixelSizeInternal(font_type, str, &layout);
+  pixel_size_cache_.Insert(font_type, str, size);
+  return size;
 }
 
 Size TextRenderer::GetPixelSizeInternal(FontSpecInterface::FONT_TYPE font_type,
@@ -113,6 +120,7 @@ void TextRenderer::RenderTextInternal(const string& text,
 
 void TextRenderer::ReloadFontConfig(const string &font_description) {
   font_spec_->Reload(font_description);
+  pixel_size_cache_.Clear();
 }
 }  // namespace gtk
 }  // namespace renderer
@@ -34,7 +34,9 @@
 
 #include <memory>
 
+#include "base/coordinates.h"
 #include "base/port.h"
+#include "renderer/text_metrics_cache.h"
 #include "renderer/unix/font_spec_interface.h"
 #include "renderer/unix/pango_wrapper_interface.h"
 #include "renderer/unix/text_renderer_interface.h"
@@ -67,6 +69,7 @@ class TextRenderer : public TextRendererInterface {
   FRIEND_TEST(TextRendererTest, GetPixelSizeTest);
   FRIEND_TEST(TextRendererTest, GetMultilinePixelSizeTest);
   FRIEND_TEST(TextRendererTest, RenderTextTest);
+  FRIEND_TEST(TextRendererTest, PixelSizeCacheTest);
 
   void SetUpPangoLayout(const string &str,
                         FontSpecInterface::FONT_TYPE font_type,
@@ -85,6 +88,11 @@ class TextRenderer : public TextRendererInterface {
   std::unique_ptr<FontSpecInterface> font_spec_;
   std::unique_ptr<PangoWrapperInterface> pango_;
 
+  // Caches GetPixelSize() results keyed by (font type, text), so that
+  // the same runs are not re-shaped by Pango on every candidate window
+  // update.  Cleared on Initialize() and ReloadFontConfig().
+  TextMetricsCache pixel_size_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(TextRenderer);
 };
 
@@ -32,6 +32,7 @@
 #include "testing/base/public/gmock.h"
 #include "testing/base/public/gunit.h"
 
+using ::testing::_;
 using ::testing::Expectation;
 using ::testing::Return;
 
@@ -263,6 +264,28 @@ TEST_F(TextRendererTest, ReloadFontConfigTest) {
   text_renderer.ReloadFontConfig(kDummyFontDescription);
 }
 
+TEST_F(TextRendererTest, PixelSizeCacheTest) {
+  FontSpecMock *font_spec_mock = new FontSpecMock();
+  TextRenderer text_renderer(font_spec_mock);
+
+  const string text = "hogehoge";
+  const FontSpecInterface::FONT_TYPE font_type =
+      FontSpecInterface::FONTSET_CANDIDATE;
+  const Size size(12, 34);
+
+  // A cached entry must be returned without touching Pango at all
+  // (|pango_| is not even set up here).
+  text_renderer.pixel_size_cache_.Insert(font_type, text, size);
+  const Size actual_size = text_renderer.GetPixelSize(font_type, text);
+  EXPECT_EQ(size.width, actual_size.width);
+  EXPECT_EQ(size.height, actual_size.height);
+
+  // Reloading the font configuration invalidates the cache.
+  EXPECT_CALL(*font_spec_mock, Reload(_));
+  text_renderer.ReloadFontConfig("Foo,Bar,Baz");
+  EXPECT_EQ(0, text_renderer.pixel_size_cache_.Size());
+}
+
 }  // namespace gtk
 }  // namespace renderer
 }  // namespace mozc
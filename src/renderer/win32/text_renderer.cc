@@ -40,9 +40,11 @@
 #include <memory>
 
 #include "base/logging.h"
+#include "base/string_piece.h"
 #include "base/system_util.h"
 #include "protocol/renderer_style.pb.h"
 #include "renderer/renderer_style_handler.h"
+#include "renderer/text_metrics_cache.h"
 
 namespace mozc {
 namespace renderer {
@@ -66,6 +68,20 @@ WTL::CRect ToCRect(const Rect &rect) {
   return WTL::CRect(rect.Left(), rect.Top(), rect.Right(), rect.Bottom());
 }
 
+// Views the UTF-16 code units of |str| as raw bytes so that they can be
+// fingerprinted by TextMetricsCache.
+StringPiece AsBytes(const std::wstring &str) {
+  return StringPiece(reinterpret_cast<const char *>(str.data()),
+                     str.size() * sizeof(wchar_t));
+}
+
+// Composes a TextMetricsCache font key from the font type and the wrapping
+// width.  Single line measurement uses |width| == 0.
+uint32 GetMetricsFontKey(TextRenderer::FONT_TYPE font_type, int width) {
+  return static_cast<uint32>(width) * TextRenderer::SIZE_OF_FONT_TYPE +
+         static_cast<uint32>(font_type);
+}
+
 COLORREF GetTextColor(TextRenderer::FONT_TYPE type) {
   switch (type) {
     case TextRenderer::FONTSET_SHORTCUT:
@@ -220,26 +236,41 @@ class GdiTextRenderer : public TextRenderer {
       render_info_[i].font.CreateFontIndirectW(&log_font);
       render_info_[i].color = GetTextColor(font_type);
     }
+    metrics_cache_.Clear();
   }
 
   virtual Size MeasureString(FONT_TYPE font_type,
                              const std::wstring &str) const {
+    const uint32 font_key = GetMetricsFontKey(font_type, 0);
+    Size size;
+    if (metrics_cache_.Lookup(font_key, AsBytes(str), &size)) {
+      return size;
+    }
     const auto previous_font = mem_dc_.SelectFont(render_info_[font_type].font);
     CRect rect;
     mem_dc_.DrawTextW(str.c_str(), str.length(), &rect,
                       DT_NOPREFIX | DT_LEFT | DT_SINGLELINE | DT_CALCRECT);
     mem_dc_.SelectFont(previous_font);
-    return Size(rect.Width(), rect.Height());
+    size = Size(rect.Width(), rect.Height());
+    metrics_cache_.Insert(font_key, AsBytes(str), size);
+    return size;
   }
 
   virtual Size MeasureStringMultiLine(
       FONT_TYPE font_type, const std::wstring &str, const int width) const {
+    const uint32 font_key = GetMetricsFontKey(font_type, width);
+    Size size;
+    if (metrics_cache_.Lookup(font_key, AsBytes(str), &size)) {
+      return size;
+    }
     const auto previous_font = mem_dc_.SelectFont(render_info_[font_type].font);
     CRect rect(0, 0, width, 0);
     mem_dc_.DrawTextW(str.c_str(), str.length(), &rect,
                       DT_NOPREFIX | DT_LEFT | DT_WORDBREAK | DT_CALCRECT);
     mem_dc_.SelectFont(previous_font);
-    return Size(rect.Width(), rect.Height());
+    size = Size(rect.Width(), rect.Height());
+    metrics_cache_.Insert(font_key, AsBytes(str), size);
+    return size;
   }
 
   virtual void RenderText(CDCHandle dc,
@@ -277,6 +308,7 @@ class GdiTextRenderer : public TextRenderer {
   };
   std::unique_ptr<RenderInfo[]> render_info_;
   mutable CDC mem_dc_;
+  mutable TextMetricsCache metrics_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(GdiTextRenderer);
 };
@@ -349,6 +381,7 @@ class DirectWriteTextRenderer : public TextRenderer {
         render_font->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_TRAILING);
       }
     }
+    metrics_cache_.Clear();
   }
 
   // Retrieves the bounding box for a given string.
@@ -442,6 +475,12 @@ class DirectWriteTextRenderer : public TextRenderer {
 
   Size MeasureStringImpl(FONT_TYPE font_type, const std::wstring &str,
                          const int width, bool use_width) const {
+    const uint32 font_key =
+        GetMetricsFontKey(font_type, use_width ? width : 0);
+    Size size;
+    if (metrics_cache_.Lookup(font_key, AsBytes(str), &size)) {
+      return size;
+    }
     HRESULT hr = S_OK;
     const FLOAT kLayoutLimit = 100000.0f;
     CComPtr<IDWriteTextLayout> layout;
@@ -459,8 +498,10 @@ class DirectWriteTextRenderer : public TextRenderer {
     if (FAILED(hr)) {
       return Size();
     }
-    return Size(ceilf(metrix.widthIncludingTrailingWhitespace),
+    size = Size(ceilf(metrix.widthIncludingTrailingWhitespace),
                 ceilf(metrix.height));
+    metrics_cache_.Insert(font_key, AsBytes(str), size);
+    return size;
   }
 
   static D2D1_COLOR_F ToD2DColor(COLORREF color_ref) {
@@ -556,6 +597,7 @@ class DirectWriteTextRenderer : public TextRenderer {
   mutable CComPtr<ID2D1DCRenderTarget> dc_render_target_;
   CComPtr<IDWriteGdiInterop> dwrite_interop_;
   std::vector<RenderInfo> render_info_;
+  mutable TextMetricsCache metrics_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(DirectWriteTextRenderer);
 };
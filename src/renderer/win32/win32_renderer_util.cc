@@ -473,6 +473,28 @@ std::wstring ComposePreeditText(const commands::Preedit &preedit,
   return value;
 }
 
+// Upper bound of the entries kept in LayoutManager's text layout cache.
+// A handful of compositions are in flight at most; the bound only
+// guards against pathologically long sessions.
+const size_t kTextLayoutCacheMaxEntries = 32;
+
+// Serializes the inputs of CalcLayoutWithTextWrapping() into a cache
+// key.  Uninitialized padding in |font| can only cause a cache miss,
+// never a false hit, since all the compared bytes come from the caller.
+string MakeTextLayoutCacheKey(const LOGFONTW &font,
+                              const std::wstring &text,
+                              int maximum_line_length,
+                              int initial_offset) {
+  string key(reinterpret_cast<const char *>(&font), sizeof(font));
+  key.append(reinterpret_cast<const char *>(text.data()),
+             text.size() * sizeof(wchar_t));
+  key.append(reinterpret_cast<const char *>(&maximum_line_length),
+             sizeof(maximum_line_length));
+  key.append(reinterpret_cast<const char *>(&initial_offset),
+             sizeof(initial_offset));
+  return key;
+}
+
 bool CalcLayoutWithTextWrappingInternal(
     CDCHandle dc,
     const std::wstring &str,
@@ -1697,6 +1719,43 @@ bool LayoutManager::CalcLayoutWithTextWrapping(
   return result;
 }
 
+bool LayoutManager::CalcLayoutWithTextWrappingCached(
+    const LOGFONTW &font,
+    const std::wstring &text,
+    int maximum_line_length,
+    int initial_offset,
+    std::vector<LineLayout> *line_layouts) const {
+  if (line_layouts == NULL) {
+    return false;
+  }
+
+  const string key = MakeTextLayoutCacheKey(
+      font, text, maximum_line_length, initial_offset);
+  {
+    scoped_lock l(&text_layout_cache_mutex_);
+    const std::map<string, std::vector<LineLayout> >::const_iterator it =
+        text_layout_cache_.find(key);
+    if (it != text_layout_cache_.end()) {
+      *line_layouts = it->second;
+      return true;
+    }
+  }
+
+  if (!CalcLayoutWithTextWrapping(font, text, maximum_line_length,
+                                  initial_offset, line_layouts)) {
+    return false;
+  }
+
+  {
+    scoped_lock l(&text_layout_cache_mutex_);
+    if (text_layout_cache_.size() >= kTextLayoutCacheMaxEntries) {
+      text_layout_cache_.clear();
+    }
+    text_layout_cache_[key] = *line_layouts;
+  }
+  return true;
+}
+
 void LayoutManager::GetPointInPhysicalCoords(
     HWND window_handle, const POINT &point, POINT *result) const {
   if (result == NULL) {
@@ -1947,7 +2006,7 @@ bool LayoutManager::LayoutCompositionWindow(
         : current_pos_in_physical_coord.x - area_in_physical_coord.left;
     const int limit = is_vertical ? area_in_physical_coord.Height()
                                   : area_in_physical_coord.Width();
-    result = CalcLayoutWithTextWrapping(
+    result = CalcLayoutWithTextWrappingCached(
         logfont, composition_text, limit, offset, &layouts);
   }
   if (!result) {
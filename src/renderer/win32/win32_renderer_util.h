@@ -32,10 +32,12 @@
 
 #include <Windows.h>
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "base/mutex.h"
 #include "base/port.h"
 #include "testing/base/public/gunit_prod.h"
 // for FRIEND_TEST()
@@ -405,6 +407,7 @@ class LayoutManager {
   FRIEND_TEST(Win32RendererUtilTest, VerticalProportionalCompositeGlyph);
   FRIEND_TEST(Win32RendererUtilTest, HorizontalMonospacedCompositeGlyph);
   FRIEND_TEST(Win32RendererUtilTest, VerticalMonospacedCompositeGlyph);
+  FRIEND_TEST(Win32RendererUtilTest, TextLayoutCache);
 
   // Calculates text layout with taking text wrapping into account.  Returns
   // true when succeeds.
@@ -425,9 +428,25 @@ class LayoutManager {
       int initial_offset,
      std::vector<LineLayout> *line_layouts);
 
+  // Same as CalcLayoutWithTextWrapping() but memoizes the result keyed
+  // by the font and the input, so that laying out the same composition
+  // again (e.g. for every candidate selection change) does not repeat
+  // the GDI text measurement.  This method is thread-safe.
+  bool CalcLayoutWithTextWrappingCached(
+      const LOGFONTW &font,
+      const std::wstring &text,
+      int maximum_line_length,
+      int initial_offset,
+      std::vector<LineLayout> *line_layouts) const;
+
   std::unique_ptr<SystemPreferenceInterface> system_preference_;
   std::unique_ptr<WindowPositionInterface> window_position_;
 
+  // Serialized by |text_layout_cache_mutex_|; see
+  // CalcLayoutWithTextWrappingCached().
+  mutable Mutex text_layout_cache_mutex_;
+  mutable std::map<string, std::vector<LineLayout> > text_layout_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(LayoutManager);
 };
 
@@ -1118,6 +1118,42 @@ TEST_F(Win32RendererUtilTest, HorizontalProportional) {
   EXPECT_FALSE(result);
 }
 
+TEST_F(Win32RendererUtilTest, TextLayoutCache) {
+  const CLogFont &logfont = GetFont(true, false);
+  LayoutManager layout_mgr(CreateDefaultGUIFontEmulator(),
+                           WindowPositionEmulator::Create());
+
+  const std::wstring &message = GetTestMessageForProportional();
+
+  std::vector<mozc::renderer::win32::LineLayout> line_layouts;
+  EXPECT_TRUE(layout_mgr.CalcLayoutWithTextWrappingCached(
+      logfont, message, 200, 100, &line_layouts));
+  EXPECT_EQ(1, layout_mgr.text_layout_cache_.size());
+
+  // The second call with identical inputs is served from the cache and
+  // must return the same layout.
+  std::vector<mozc::renderer::win32::LineLayout> cached_layouts;
+  EXPECT_TRUE(layout_mgr.CalcLayoutWithTextWrappingCached(
+      logfont, message, 200, 100, &cached_layouts));
+  EXPECT_EQ(1, layout_mgr.text_layout_cache_.size());
+  ASSERT_EQ(line_layouts.size(), cached_layouts.size());
+  for (size_t i = 0; i < line_layouts.size(); ++i) {
+    EXPECT_EQ(line_layouts[i].text, cached_layouts[i].text);
+    EXPECT_EQ(line_layouts[i].line_length, cached_layouts[i].line_length);
+    EXPECT_EQ(line_layouts[i].line_width, cached_layouts[i].line_width);
+  }
+
+  // Different inputs must not hit the cached entry.
+  EXPECT_TRUE(layout_mgr.CalcLayoutWithTextWrappingCached(
+      logfont, message, 200, 199, &line_layouts));
+  EXPECT_EQ(2, layout_mgr.text_layout_cache_.size());
+
+  // A failed layout must not be cached.
+  EXPECT_FALSE(layout_mgr.CalcLayoutWithTextWrappingCached(
+      logfont, message, 2, 1, &line_layouts));
+  EXPECT_EQ(2, layout_mgr.text_layout_cache_.size());
+}
+
 TEST_F(Win32RendererUtilTest, VerticalProportional) {
   const CLogFont &logfont = GetFont(true, true);
 
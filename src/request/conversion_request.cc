@@ -42,7 +42,11 @@ ConversionRequest::ConversionRequest()
       use_actual_converter_for_realtime_conversion_(false),
       composer_key_selection_(CONVERSION_KEY),
       skip_slow_rewriters_(false),
-      create_partial_candidates_(false) {}
+      create_partial_candidates_(false),
+      prediction_viterbi_beam_width_(0),
+      conversion_deadline_msec_(0),
+      dictionary_source_mask_(DICTIONARY_SOURCE_ALL),
+      lookup_token_budget_(0) {}
 
 ConversionRequest::ConversionRequest(const composer::Composer *c,
                                      const commands::Request *request,
@@ -53,7 +57,11 @@ ConversionRequest::ConversionRequest(const composer::Composer *c,
       use_actual_converter_for_realtime_conversion_(false),
       composer_key_selection_(CONVERSION_KEY),
       skip_slow_rewriters_(false),
-      create_partial_candidates_(false) {}
+      create_partial_candidates_(false),
+      prediction_viterbi_beam_width_(0),
+      conversion_deadline_msec_(0),
+      dictionary_source_mask_(DICTIONARY_SOURCE_ALL),
+      lookup_token_budget_(0) {}
 
 ConversionRequest::~ConversionRequest() {}
 
@@ -123,6 +131,38 @@ void ConversionRequest::set_create_partial_candidates(bool value) {
   create_partial_candidates_ = value;
 }
 
+size_t ConversionRequest::prediction_viterbi_beam_width() const {
+  return prediction_viterbi_beam_width_;
+}
+
+void ConversionRequest::set_prediction_viterbi_beam_width(size_t width) {
+  prediction_viterbi_beam_width_ = width;
+}
+
+int32 ConversionRequest::conversion_deadline_msec() const {
+  return conversion_deadline_msec_;
+}
+
+void ConversionRequest::set_conversion_deadline_msec(int32 deadline_msec) {
+  conversion_deadline_msec_ = deadline_msec;
+}
+
+uint32 ConversionRequest::dictionary_source_mask() const {
+  return dictionary_source_mask_;
+}
+
+void ConversionRequest::set_dictionary_source_mask(uint32 mask) {
+  dictionary_source_mask_ = mask;
+}
+
+size_t ConversionRequest::lookup_token_budget() const {
+  return lookup_token_budget_;
+}
+
+void ConversionRequest::set_lookup_token_budget(size_t budget) {
+  lookup_token_budget_ = budget;
+}
+
 bool ConversionRequest::IsKanaModifierInsensitiveConversion() const {
   return request_->kana_modifier_insensitive_conversion() &&
          config_->use_kana_modifier_insensitive_conversion();
@@ -137,6 +177,10 @@ void ConversionRequest::CopyFrom(const ConversionRequest &request) {
   composer_key_selection_ = request.composer_key_selection_;
   skip_slow_rewriters_ = request.skip_slow_rewriters_;
   create_partial_candidates_ = request.create_partial_candidates_;
+  prediction_viterbi_beam_width_ = request.prediction_viterbi_beam_width_;
+  conversion_deadline_msec_ = request.conversion_deadline_msec_;
+  dictionary_source_mask_ = request.dictionary_source_mask_;
+  lookup_token_budget_ = request.lookup_token_budget_;
 }
 
 }  // namespace mozc
@@ -73,6 +73,18 @@ class ConversionRequest {
     // of possible hiragana.
   };
 
+  // Dictionary sources consulted by DictionaryImpl, usable as a bit mask.
+  // The suffix dictionary is not listed here because it is looked up
+  // directly by the predictor, not through DictionaryImpl.
+  enum DictionarySource {
+    DICTIONARY_SOURCE_SYSTEM = 1 << 0,
+    DICTIONARY_SOURCE_VALUE = 1 << 1,
+    DICTIONARY_SOURCE_USER = 1 << 2,
+    DICTIONARY_SOURCE_ALL = DICTIONARY_SOURCE_SYSTEM |
+                            DICTIONARY_SOURCE_VALUE |
+                            DICTIONARY_SOURCE_USER,
+  };
+
   ConversionRequest();
   ConversionRequest(const composer::Composer *c,
                     const commands::Request *request,
@@ -89,6 +101,18 @@ class ConversionRequest {
   bool create_partial_candidates() const;
   void set_create_partial_candidates(bool value);
 
+  size_t prediction_viterbi_beam_width() const;
+  void set_prediction_viterbi_beam_width(size_t width);
+
+  int32 conversion_deadline_msec() const;
+  void set_conversion_deadline_msec(int32 deadline_msec);
+
+  uint32 dictionary_source_mask() const;
+  void set_dictionary_source_mask(uint32 mask);
+
+  size_t lookup_token_budget() const;
+  void set_lookup_token_budget(size_t budget);
+
   ComposerKeySelection composer_key_selection() const;
   void set_composer_key_selection(ComposerKeySelection selection);
 
@@ -137,6 +161,26 @@ class ConversionRequest {
   // For example, "私の" is created from composition "わたしのなまえ".
   bool create_partial_candidates_;
 
+  // If nonzero, the prediction Viterbi keeps only this many lowest-cost
+  // live nodes per lattice position (beam pruning).  0 means no pruning.
+  size_t prediction_viterbi_beam_width_;
+
+  // Latency budget of one conversion in milliseconds.  0 (default)
+  // means unlimited.  When the budget is exhausted the converter stops
+  // refining, returns the best result found so far and sets
+  // Segments::quality_degraded().
+  int32 conversion_deadline_msec_;
+
+  // Bit mask of DictionarySource values.  A caller that knows a source
+  // cannot fire for a position (e.g. the user dictionary where it has
+  // never produced a token) can clear its bit to skip that probe.
+  uint32 dictionary_source_mask_;
+
+  // Maximum number of tokens one DictionaryImpl lookup may deliver to
+  // its callback.  0 (default) means unlimited.  Sources are consulted
+  // in order and remaining ones are skipped once the budget is spent.
+  size_t lookup_token_budget_;
+
   // TODO(noriyukit): Moves all the members of Segments that are irrelevant to
   // this structure, e.g., Segments::user_history_enabled_ and
   // Segments::request_type_. Also, a key for conversion is eligible to live in
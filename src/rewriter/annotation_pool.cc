@@ -0,0 +1,76 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/annotation_pool.h"
+
+#include <string>
+
+#include "base/singleton.h"
+
+namespace mozc {
+
+// static
+const string &AnnotationPool::Intern(StringPiece s) {
+  AnnotationPool *pool = Singleton<AnnotationPool>::get();
+  scoped_lock lock(&pool->mutex_);
+  return pool->InternLocked(s);
+}
+
+// static
+const string &AnnotationPool::InternSeparated(StringPiece a, StringPiece b) {
+  AnnotationPool *pool = Singleton<AnnotationPool>::get();
+  scoped_lock lock(&pool->mutex_);
+  const std::pair<const void *, const void *> key(a.data(), b.data());
+  const auto it = pool->concat_cache_.find(key);
+  if (it != pool->concat_cache_.end()) {
+    return *it->second;
+  }
+  string composed;
+  a.AppendToString(&composed);
+  if (!a.empty() && !b.empty()) {
+    composed.append(1, ' ');
+  }
+  b.AppendToString(&composed);
+  const string &interned = pool->InternLocked(composed);
+  pool->concat_cache_[key] = &interned;
+  return interned;
+}
+
+// static
+size_t AnnotationPool::size() {
+  AnnotationPool *pool = Singleton<AnnotationPool>::get();
+  scoped_lock lock(&pool->mutex_);
+  return pool->atoms_.size();
+}
+
+const string &AnnotationPool::InternLocked(StringPiece s) {
+  return *atoms_.insert(s.as_string()).first;
+}
+
+}  // namespace mozc
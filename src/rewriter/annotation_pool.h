@@ -0,0 +1,92 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_REWRITER_ANNOTATION_POOL_H_
+#define MOZC_REWRITER_ANNOTATION_POOL_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+
+template <typename T> class Singleton;
+
+// Process-wide interning table for candidate annotation strings
+// ("ひらがな", "[全]", ...).  The annotation vocabulary is a small
+// closed set but identical descriptions are composed per candidate per
+// conversion; interning composes each distinct combination once and
+// hands out a reference to the shared copy for the rest of the process
+// lifetime.
+//
+// Interned strings are never released, so only pass strings drawn from
+// a bounded vocabulary, never user input.
+class AnnotationPool {
+ public:
+  // Returns a reference, valid for the process lifetime, to the interned
+  // copy of |s|.
+  static const string &Intern(StringPiece s);
+
+  // Returns the interned copy of |a| + ' ' + |b| (an empty operand
+  // contributes neither itself nor the separator).  The combination
+  // cache is keyed by the operands' data pointers, so |a| and |b| must
+  // point at storage with static lifetime, e.g. the annotation constants
+  // in VariantsRewriter.  Repeated calls with the same operands are
+  // allocation-free.
+  static const string &InternSeparated(StringPiece a, StringPiece b);
+
+  // Number of distinct interned strings; for tests and memory audits.
+  static size_t size();
+
+ private:
+  friend class Singleton<AnnotationPool>;
+
+  AnnotationPool() = default;
+  ~AnnotationPool() = default;
+
+  const string &InternLocked(StringPiece s);
+
+  Mutex mutex_;
+  // std::set nodes are stable, so references into |atoms_| survive
+  // later insertions.
+  std::set<string> atoms_;
+  std::map<std::pair<const void *, const void *>, const string *>
+      concat_cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(AnnotationPool);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_ANNOTATION_POOL_H_
@@ -0,0 +1,83 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/annotation_pool.h"
+
+#include <string>
+
+#include "base/string_piece.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+const char kFull[] = "[全]";
+const char kKatakana[] = "カタカナ";
+
+TEST(AnnotationPoolTest, InternReturnsStableSharedCopy) {
+  const string &a = AnnotationPool::Intern("annotation_atom");
+  EXPECT_EQ("annotation_atom", a);
+
+  // A second intern of equal content returns the same object.
+  const string copy("annotation_atom");
+  const string &b = AnnotationPool::Intern(copy);
+  EXPECT_EQ(&a, &b);
+}
+
+TEST(AnnotationPoolTest, InternSeparated) {
+  const string &both =
+      AnnotationPool::InternSeparated(StringPiece(kFull),
+                                      StringPiece(kKatakana));
+  EXPECT_EQ("[全] カタカナ", both);
+
+  // An empty operand contributes neither itself nor the separator.
+  EXPECT_EQ("[全]",
+            AnnotationPool::InternSeparated(StringPiece(kFull), StringPiece()));
+  EXPECT_EQ("カタカナ", AnnotationPool::InternSeparated(
+                            StringPiece(), StringPiece(kKatakana)));
+  EXPECT_EQ("", AnnotationPool::InternSeparated(StringPiece(), StringPiece()));
+
+  // Repeated calls with the same static operands hit the combination
+  // cache and return the same object.
+  const string &again =
+      AnnotationPool::InternSeparated(StringPiece(kFull),
+                                      StringPiece(kKatakana));
+  EXPECT_EQ(&both, &again);
+}
+
+TEST(AnnotationPoolTest, SizeIsBoundedByDistinctContent) {
+  const size_t before = AnnotationPool::size();
+  AnnotationPool::Intern("repeated_atom");
+  AnnotationPool::Intern("repeated_atom");
+  AnnotationPool::Intern("repeated_atom");
+  EXPECT_EQ(before + 1, AnnotationPool::size());
+}
+
+}  // namespace
+}  // namespace mozc
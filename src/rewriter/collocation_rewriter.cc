@@ -541,15 +541,17 @@ class CollocationRewriter::CollocationFilter {
   ~CollocationFilter() {
   }
 
-  bool Exists(const string &left, const string &right) const {
-    if (left.empty() || right.empty()) {
+  // |left| carries the hash state of the left word; see
+  // RewriteUsingNextSegment().  The filter was built from fingerprints
+  // of the concatenated pairs, and the accumulator reproduces exactly
+  // that fingerprint without building the concatenated string.
+  bool Exists(const FingerprintAccumulator &left, const string &right) const {
+    if (right.empty()) {
       return false;
     }
-    string key;
-    key.reserve(left.size() + right.size());
-    key.assign(left).append(right);
-    const uint64 id = Hash::Fingerprint(key);
-    return filter_->Exists(id);
+    FingerprintAccumulator pair = left;
+    pair.Append(right);
+    return filter_->Exists(pair.Get());
   }
 
  private:
@@ -618,6 +620,12 @@ bool CollocationRewriter::RewriteFromPrevSegment(
     Segment *seg) const {
   string prev;
   CollocationUtil::GetNormalizedScript(prev_cand.value, true, &prev);
+  if (prev.empty()) {
+    return false;
+  }
+  // Hash the previous word once; every candidate probe below reuses it.
+  FingerprintAccumulator prev_fp;
+  prev_fp.Append(prev);
 
   const size_t i_max = std::min(seg->candidates_size(), kCandidateSize);
 
@@ -642,7 +650,7 @@ bool CollocationRewriter::RewriteFromPrevSegment(
     for (int j = 0; j < curs.size(); ++j) {
       cur.clear();
       CollocationUtil::GetNormalizedScript(curs[j], false, &cur);
-      if (collocation_filter_->Exists(prev, cur)) {
+      if (collocation_filter_->Exists(prev_fp, cur)) {
         VLOG_IF(3, i != 0) << prev << cur << " "
                            << seg->candidate(0).value << "->"
                            << seg->candidate(i).value;
@@ -712,6 +720,14 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
     for (int k = 0; k < curs.size(); ++k) {
       cur.clear();
       CollocationUtil::GetNormalizedScript(curs[k], true, &cur);
+      if (cur.empty()) {
+        continue;
+      }
+      // Hash the left word once here; the probes over the whole
+      // |next_seg| candidate matrix below reuse this state instead of
+      // concatenating and rehashing |cur| for every pair.
+      FingerprintAccumulator cur_fp;
+      cur_fp.Append(cur);
       for (size_t j = 0; j < j_max; ++j) {
         if (next_seg->candidate(j).cost >
             next_seg->candidate(0).cost + kMaxCostDiff) {
@@ -723,7 +739,7 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
 
         for (int l = 0; l < normalized_string[j].size(); ++l) {
           const string &next = normalized_string[j][l];
-          if (collocation_filter_->Exists(cur, next)) {
+          if (collocation_filter_->Exists(cur_fp, next)) {
             DCHECK(VerifyNaturalContent(
                 next_seg->candidate(j), next_seg->candidate(0), RIGHT))
                 << "IsNaturalContent() should not fail here.";
@@ -47,6 +47,10 @@ class CommandRewriter : public RewriterInterface  {
   CommandRewriter();
   virtual ~CommandRewriter();
 
+  virtual uint32 triggers() const {
+    return SINGLE_CONVERSION_SEGMENT_TRIGGER;
+  }
+
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
 
@@ -30,9 +30,11 @@
 #include "rewriter/correction_rewriter.h"
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "config/config_handler.h"
@@ -55,6 +57,18 @@ void CorrectionRewriter::SetCandidate(const ReadingCorrectionItem &item,
   DCHECK(candidate->IsValid());
 }
 
+bool CorrectionRewriter::MayHaveCorrection(const string &key) const {
+  if (key.empty()) {
+    return false;
+  }
+  const char32 first_char = Util::UTF8ToUCS4(key);
+  const uint32 offset = first_char - kFirstCharBitmapBase;
+  if (offset >= 64 * arraysize(error_first_char_bitmap_)) {
+    return has_error_outside_bitmap_;
+  }
+  return (error_first_char_bitmap_[offset / 64] >> (offset % 64)) & 1;
+}
+
 bool CorrectionRewriter::LookupCorrection(
     const string &key,
     const string &value,
@@ -62,15 +76,20 @@ bool CorrectionRewriter::LookupCorrection(
   CHECK(results);
   results->clear();
 
-  using Iter = SerializedStringArray::const_iterator;
-  std::pair<Iter, Iter> range = std::equal_range(error_array_.begin(),
-                                            error_array_.end(),
-                                            key);
-  for (; range.first != range.second; ++range.first) {
-    const StringPiece v = value_array_[range.first.index()];
+  if (!MayHaveCorrection(key)) {
+    // No error reading starts with this character; the common case.
+    return false;
+  }
+  const auto it = error_map_.find(Hash::Fingerprint(key));
+  if (it == error_map_.end() ||
+      // Guard against fingerprint collisions.
+      error_array_[it->second.first] != key) {
+    return false;
+  }
+  for (uint32 i = it->second.first; i < it->second.second; ++i) {
+    const StringPiece v = value_array_[i];
     if (value.empty() || value == v) {
-      results->emplace_back(v, *range.first,
-                            correction_array_[range.first.index()]);
+      results->emplace_back(v, error_array_[i], correction_array_[i]);
     }
   }
   return !results->empty();
@@ -87,6 +106,32 @@ CorrectionRewriter::CorrectionRewriter(StringPiece value_array_data,
   correction_array_.Set(correction_array_data);
   DCHECK_EQ(value_array_.size(), error_array_.size());
   DCHECK_EQ(value_array_.size(), correction_array_.size());
+
+  // Index the entries by error reading: the error array is sorted, so the
+  // entries of one error form a contiguous index range.  Also record the
+  // first character of every error in the bitmap.
+  std::memset(error_first_char_bitmap_, 0, sizeof(error_first_char_bitmap_));
+  has_error_outside_bitmap_ = false;
+  for (size_t i = 0; i < error_array_.size(); ) {
+    const StringPiece error = error_array_[i];
+    size_t end = i + 1;
+    while (end < error_array_.size() && error_array_[end] == error) {
+      ++end;
+    }
+    error_map_.emplace(
+        Hash::Fingerprint(error),
+        std::make_pair(static_cast<uint32>(i), static_cast<uint32>(end)));
+
+    const char32 first_char = Util::UTF8ToUCS4(error);
+    const uint32 offset = first_char - kFirstCharBitmapBase;
+    if (offset < 64 * arraysize(error_first_char_bitmap_)) {
+      error_first_char_bitmap_[offset / 64] |= static_cast<uint64>(1)
+                                               << (offset % 64);
+    } else {
+      has_error_outside_bitmap_ = true;
+    }
+    i = end;
+  }
 }
 
 // static
@@ -32,8 +32,11 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "base/port.h"
 #include "base/serialized_string_array.h"
 #include "base/string_piece.h"
 #include "rewriter/rewriter_interface.h"
@@ -88,9 +91,29 @@ class CorrectionRewriter : public RewriterInterface  {
       const string &value,
       std::vector<ReadingCorrectionItem> *results) const;
 
+  // Returns true if some error reading may start with the first character
+  // of |key|.  A single bitmap test; for conversions without any
+  // correctable candidate (the common case) every candidate is rejected
+  // here without hashing.
+  bool MayHaveCorrection(const string &key) const;
+
   SerializedStringArray value_array_;
   SerializedStringArray error_array_;
   SerializedStringArray correction_array_;
+
+  // Maps the fingerprint of an error reading to the [begin, end) index
+  // range of its entries in the arrays; built once in the constructor so
+  // LookupCorrection() needs a single hash probe instead of a binary
+  // search over the error array.
+  std::unordered_map<uint64, std::pair<uint32, uint32> > error_map_;
+
+  // Bit (c - kFirstCharBitmapBase) is set iff some error reading starts
+  // with code point |c|; see MayHaveCorrection().
+  static const char32 kFirstCharBitmapBase = 0x3040;  // hiragana block
+  uint64 error_first_char_bitmap_[2];
+  // True if some error reading starts outside the bitmap range, in which
+  // case keys outside the range cannot be filtered.
+  bool has_error_outside_bitmap_;
 };
 
 }  // namespace mozc
@@ -41,6 +41,7 @@
 #include <cstdio>
 #include <ctime>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "base/clock.h"
@@ -302,6 +303,41 @@ const struct DateData kDateAndCurrentTimeData[] = {
   },
 };
 
+// Set of every key of the fixed keyword tables above.  Created on first
+// use and never modified afterwards.
+const std::unordered_set<string> *CreateDateTimeKeywordSet() {
+  std::unordered_set<string> *keywords = new std::unordered_set<string>;
+  for (size_t i = 0; i < arraysize(kDateData); ++i) {
+    keywords->insert(kDateData[i].key);
+  }
+  for (size_t i = 0; i < arraysize(kWeekDayData); ++i) {
+    keywords->insert(kWeekDayData[i].key);
+  }
+  for (size_t i = 0; i < arraysize(kYearData); ++i) {
+    keywords->insert(kYearData[i].key);
+  }
+  for (size_t i = 0; i < arraysize(kMonthData); ++i) {
+    keywords->insert(kMonthData[i].key);
+  }
+  for (size_t i = 0; i < arraysize(kCurrentTimeData); ++i) {
+    keywords->insert(kCurrentTimeData[i].key);
+  }
+  for (size_t i = 0; i < arraysize(kDateAndCurrentTimeData); ++i) {
+    keywords->insert(kDateAndCurrentTimeData[i].key);
+  }
+  return keywords;
+}
+
+// Returns true if |key| is a key of one of the fixed date/time keyword
+// tables.  The keyword rewrites only fire on an exact key match, and
+// almost no conversion key is such a keyword, so the per-table scans in
+// Rewrite() are guarded by this single probe.
+bool CanBeDateTimeKeyword(const string &key) {
+  static const std::unordered_set<string> *keywords =
+      CreateDateTimeKeywordSet();
+  return keywords->find(key) != keywords->end();
+}
+
 struct YearData {
   int ad;      // AD year
   const char *era;   // Japanese year a.k.a, GENGO
@@ -2319,10 +2355,11 @@ bool DateRewriter::Rewrite(const ConversionRequest &request,
       return false;
     }
 
-    if (RewriteDate(seg) || RewriteWeekday(seg) ||
-        RewriteMonth(seg) || RewriteYear(seg) ||
-        RewriteCurrentTime(seg) ||
-        RewriteDateAndCurrentTime(seg)) {
+    if (CanBeDateTimeKeyword(seg->key()) &&
+        (RewriteDate(seg) || RewriteWeekday(seg) ||
+         RewriteMonth(seg) || RewriteYear(seg) ||
+         RewriteCurrentTime(seg) ||
+         RewriteDateAndCurrentTime(seg))) {
       modified = true;
     } else if (i + 1 < segments->segments_size() &&
                RewriteEra(seg, segments->segment(i + 1))) {
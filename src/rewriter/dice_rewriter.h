@@ -42,6 +42,10 @@ class DiceRewriter : public RewriterInterface {
   DiceRewriter();
   virtual ~DiceRewriter();
 
+  virtual uint32 triggers() const {
+    return SINGLE_CONVERSION_SEGMENT_TRIGGER;
+  }
+
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
 };
@@ -35,6 +35,7 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "config/config_handler.h"
@@ -201,11 +202,37 @@ bool InsertToken(StringPiece key,
 
 }  // namespace
 
-EmojiRewriter::EmojiRewriter(const DataManagerInterface &data_manager) {
+EmojiRewriter::EmojiRewriter(const DataManagerInterface &data_manager)
+    : has_key_outside_bitmap_(false) {
   StringPiece string_array_data;
   data_manager.GetEmojiRewriterData(&token_array_data_, &string_array_data);
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   string_array_.Set(string_array_data);
+
+  // Index the token array by reading: group the tokens of each reading
+  // into a range keyed by the reading's fingerprint, and record the first
+  // character of every reading in the bitmap.
+  std::memset(key_first_char_bitmap_, 0, sizeof(key_first_char_bitmap_));
+  for (EmojiDataIterator iter = begin(); iter != end(); ) {
+    const uint32 key_index = iter.key_index();
+    const StringPiece key = string_array_[key_index];
+    EmojiDataIterator range_end = iter;
+    do {
+      ++range_end;
+    } while (range_end != end() && range_end.key_index() == key_index);
+    token_map_.emplace(Hash::Fingerprint(key),
+                       IteratorRange(iter, range_end));
+
+    const char32 first_char = Util::UTF8ToUCS4(key);
+    const uint32 offset = first_char - kFirstCharBitmapBase;
+    if (offset < 64 * arraysize(key_first_char_bitmap_)) {
+      key_first_char_bitmap_[offset / 64] |= static_cast<uint64>(1)
+                                             << (offset % 64);
+    } else {
+      has_key_outside_bitmap_ = true;
+    }
+    iter = range_end;
+  }
 }
 
 EmojiRewriter::~EmojiRewriter() = default;
@@ -262,15 +289,27 @@ bool EmojiRewriter::IsEmojiCandidate(const Segment::Candidate &candidate) {
   return candidate.description.find(kEmoji) != string::npos;
 }
 
+bool EmojiRewriter::MayBeEmojiKey(StringPiece reading) const {
+  const char32 first_char = Util::UTF8ToUCS4(reading);
+  const uint32 offset = first_char - kFirstCharBitmapBase;
+  if (offset >= 64 * arraysize(key_first_char_bitmap_)) {
+    return has_key_outside_bitmap_;
+  }
+  return (key_first_char_bitmap_[offset / 64] >> (offset % 64)) & 1;
+}
+
 std::pair<EmojiRewriter::EmojiDataIterator, EmojiRewriter::EmojiDataIterator>
 EmojiRewriter::LookUpToken(StringPiece key) const {
-  // Search string array for key.
-  auto iter = std::lower_bound(string_array_.begin(), string_array_.end(), key);
-  if (iter == string_array_.end() || *iter != key) {
+  const auto iter = token_map_.find(Hash::Fingerprint(key));
+  if (iter == token_map_.end()) {
+    return std::pair<EmojiDataIterator, EmojiDataIterator>(end(), end());
+  }
+  // Guard against fingerprint collisions; the map stores one entry per
+  // reading, so a single comparison suffices.
+  if (string_array_[iter->second.first.key_index()] != key) {
     return std::pair<EmojiDataIterator, EmojiDataIterator>(end(), end());
   }
-  // Search token array for the string index.
-  return std::equal_range(begin(), end(), iter.index());
+  return iter->second;
 }
 
 bool EmojiRewriter::RewriteCandidates(
@@ -290,6 +329,10 @@ bool EmojiRewriter::RewriteCandidates(
                                      available_emoji_carrier, segment);
       continue;
     }
+    if (!MayBeEmojiKey(reading)) {
+      // No emoji reading starts with this character; the common case.
+      continue;
+    }
     const auto range = LookUpToken(reading);
     if (range.first == range.second) {
       VLOG(2) << "Token not found: " << reading;
@@ -32,6 +32,7 @@
 
 #include <cstddef>
 #include <iterator>
+#include <unordered_map>
 #include <utility>
 
 #include "base/serialized_string_array.h"
@@ -257,11 +258,29 @@ class EmojiRewriter : public RewriterInterface {
   bool RewriteCandidates(
       int32 available_emoji_carrier, Segments *segments) const;
 
+  // Returns true if some emoji reading may start with the first character
+  // of |reading|.  A single bitmap test; nearly all conversion keys are
+  // rejected here without hashing or touching the token array.
+  bool MayBeEmojiKey(StringPiece reading) const;
+
   IteratorRange LookUpToken(StringPiece key) const;
 
   StringPiece token_array_data_;
   SerializedStringArray string_array_;
 
+  // Maps the fingerprint of a reading to its token range.  Built once in
+  // the constructor; LookUpToken() then needs a single hash probe instead
+  // of binary searches over the string and token arrays.
+  std::unordered_map<uint64, IteratorRange> token_map_;
+
+  // Bit (c - kFirstCharBitmapBase) is set iff some reading starts with
+  // code point |c|; see MayBeEmojiKey().
+  static const char32 kFirstCharBitmapBase = 0x3040;  // hiragana block
+  uint64 key_first_char_bitmap_[2];
+  // True if some reading starts outside the bitmap range, in which case
+  // readings outside the range cannot be filtered.
+  bool has_key_outside_bitmap_;
+
   DISALLOW_COPY_AND_ASSIGN(EmojiRewriter);
 };
 
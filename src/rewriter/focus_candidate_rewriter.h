@@ -46,6 +46,9 @@ class FocusCandidateRewriter : public RewriterInterface  {
   explicit FocusCandidateRewriter(const DataManagerInterface *data_manager);
   ~FocusCandidateRewriter() override;
 
+  // This rewriter does all of its work on focus change.
+  bool handles_focus() const override { return true; }
+
   // Changed the focus of "segment_index"-th segment to be "candidate_index".
   // The segments will be written according to pre-defined "actions".
   // Currently, FocusSegmentValue() finds bracket/parentheses matching, e.g,
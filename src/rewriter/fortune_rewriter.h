@@ -42,6 +42,10 @@ class FortuneRewriter : public RewriterInterface  {
   FortuneRewriter();
   virtual ~FortuneRewriter();
 
+  virtual uint32 triggers() const {
+    return SINGLE_CONVERSION_SEGMENT_TRIGGER;
+  }
+
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
 };
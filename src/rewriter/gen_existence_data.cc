@@ -56,7 +56,8 @@ void GenExistenceData(const std::vector<string> &entries,
       error_rate, n);
   LOG(INFO) << "entry: " << n << " err: " << error_rate << " bytes: " << m;
 
-  std::unique_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(m, n));
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimalBlocked(m, n));
   DCHECK(filter.get());
 
   for (size_t i = 0; i < entries.size(); ++i) {
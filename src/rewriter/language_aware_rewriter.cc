@@ -98,17 +98,21 @@ int LanguageAwareRewriter::capability(
 namespace {
 bool IsRawQuery(const composer::Composer &composer,
                 const DictionaryInterface *dictionary,
-                int *rank) {
-  string raw_text;
-  composer.GetRawString(&raw_text);
-
+                int *rank,
+                string *raw_text_out) {
   // Check if the length of text is less than or equal to three.
   // For example, "cat" is not treated as a raw query so far to avoid
-  // false negative cases.
-  if (raw_text.size() <= 3) {
+  // false negative cases.  This is also the state after most
+  // keystrokes, so it is checked before materializing any composition
+  // string.
+  if (composer.GetRawInputSize() <= 3) {
     return false;
   }
 
+  string &raw_text = *raw_text_out;
+  composer.GetRawString(&raw_text);
+  DCHECK_GT(raw_text.size(), 3);
+
   // If the composition string is same with the raw_text, there is no
   // need to add the candidate to suggestions.
   string composition;
@@ -191,15 +195,13 @@ bool LanguageAwareRewriter::FillRawText(
   }
 
   int rank = 0;
-  if (!IsRawQuery(request.composer(), dictionary_, &rank)) {
+  string raw_string;
+  if (!IsRawQuery(request.composer(), dictionary_, &rank, &raw_string)) {
     return false;
   }
 
   Segment *segment = segments->mutable_conversion_segment(0);
 
-  string raw_string;
-  request.composer().GetRawString(&raw_string);
-
   uint16 lid = unknown_id_;
   uint16 rid = unknown_id_;
   GetAlphabetIds(*segment, &lid, &rid);
@@ -246,6 +248,11 @@ bool IsLanguageAwareInputCandidate(const composer::Composer &composer,
     return false;
   }
 
+  // The sizes must match for the strings to match.
+  if (composer.GetRawInputSize() != candidate.value.size()) {
+    return false;
+  }
+
   string raw_string;
   composer.GetRawString(&raw_string);
   if (raw_string != candidate.value) {
@@ -30,22 +30,35 @@
 #ifndef MOZC_REWRITER_MERGER_REWRITER_H_
 #define MOZC_REWRITER_MERGER_REWRITER_H_
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/mutex.h"
 #include "base/stl_util.h"
+#include "base/thread.h"
+#include "base/thread_pool.h"
+#include "base/trace.h"
+#include "base/unnamed_event.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
+#include "usage_stats/usage_stats.h"
 
 namespace mozc {
 
 class MergerRewriter : public RewriterInterface {
  public:
-  MergerRewriter() {}
+  MergerRewriter() : deferred_finish_running_(false) {}
   virtual ~MergerRewriter() {
+    JoinDeferredFinish();
     STLDeleteElements(&rewriters_);
   }
 
@@ -76,18 +89,79 @@ class MergerRewriter : public RewriterInterface {
     }
   }
 
-  // This instance owns the rewriter.
-  void AddRewriter(RewriterInterface *rewriter) {
+  // This instance owns the rewriter.  When a non-empty |name| is
+  // given, the wall time spent in the rewriter's Rewrite() calls is
+  // accumulated and reported to the usage stats under
+  // "<name>ElapsedUSec" (which must be a listed stats name); see
+  // FlushTimingStats().
+  void AddRewriter(RewriterInterface *rewriter, const char *name) {
     rewriters_.push_back(rewriter);
+    // The preconditions never change after construction, so index them
+    // here instead of calling the virtual methods on every conversion.
+    triggers_.push_back(rewriter->triggers());
+    independent_.push_back(false);
+    timings_.push_back(RewriterTiming(name));
+    if (rewriter->handles_focus()) {
+      focus_rewriters_.push_back(rewriter);
+    }
+    if (rewriter->defers_finish()) {
+      deferred_finish_rewriters_.push_back(rewriter);
+    }
+  }
+
+  void AddRewriter(RewriterInterface *rewriter) {
+    AddRewriter(rewriter, "");
+  }
+
+  // Same as AddRewriter(), additionally marking |rewriter| as
+  // independent.  An independent rewriter only inserts candidates
+  // derived from the segment keys: it never modifies or removes
+  // existing candidates, never resizes segments, and never reads the
+  // output of other rewriters.  Adjacent independent rewriters may be
+  // run concurrently, each on a private copy of the segments, with
+  // their insertions merged back in registration order, which is
+  // equivalent to some sequential execution order of them.
+  void AddIndependentRewriter(RewriterInterface *rewriter, const char *name) {
+    AddRewriter(rewriter, name);
+    independent_.back() = true;
+  }
+
+  void AddIndependentRewriter(RewriterInterface *rewriter) {
+    AddIndependentRewriter(rewriter, "");
   }
 
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const {
+    ScopedTraceEvent trace_event("MergerRewriter::Rewrite");
+    JoinDeferredFinish();
+    // Compute the segments' properties once and skip the rewriters
+    // whose declared preconditions do not hold; see
+    // RewriterInterface::triggers().
+    const uint32 properties =
+        (segments != NULL && segments->conversion_segments_size() == 1)
+            ? RewriterInterface::SINGLE_CONVERSION_SEGMENT_TRIGGER
+            : 0;
     bool result = false;
-    for (size_t i = 0; i < rewriters_.size(); ++i) {
-      if (CheckCapablity(request, segments, rewriters_[i])) {
-        result |= rewriters_[i]->Rewrite(request, segments);
+    size_t i = 0;
+    while (i < rewriters_.size()) {
+      if (!independent_[i]) {
+        if ((triggers_[i] & ~properties) == 0 &&
+            CheckCapablity(request, segments, rewriters_[i])) {
+          result |= TimedRewrite(i, request, segments);
+        }
+        ++i;
+        continue;
+      }
+      // Collect the batch of adjacent applicable independent rewriters
+      // and run it concurrently; see AddIndependentRewriter().
+      std::vector<size_t> batch;
+      for (; i < rewriters_.size() && independent_[i]; ++i) {
+        if ((triggers_[i] & ~properties) == 0 &&
+            CheckCapablity(request, segments, rewriters_[i])) {
+          batch.push_back(i);
+        }
       }
+      result |= RewriteIndependentBatch(request, batch, segments);
     }
 
     if (segments->request_type() == Segments::SUGGESTION &&
@@ -109,27 +183,42 @@ class MergerRewriter : public RewriterInterface {
   // In this method, Converter will find bracketing matching.
   // e.g., when user selects "「",  corresponding closing bracket "」"
   // is chosen in the preedit.
+  // Only the rewriters which declared a Focus() handler are called;
+  // see RewriterInterface::handles_focus().
   virtual bool Focus(Segments *segments,
                      size_t segment_index,
                      int candidate_index) const {
+    JoinDeferredFinish();
     bool result = false;
-    for (size_t i = 0; i < rewriters_.size(); ++i) {
-      result |= rewriters_[i]->Focus(segments,
-                                     segment_index,
-                                     candidate_index);
+    for (size_t i = 0; i < focus_rewriters_.size(); ++i) {
+      result |= focus_rewriters_[i]->Focus(segments,
+                                           segment_index,
+                                           candidate_index);
     }
     return result;
   }
 
-  // Hook(s) for all mutable operations
+  // Hook(s) for all mutable operations.  Rewriters which declared
+  // defers_finish() learn from the commit in the background; see
+  // ScheduleDeferredFinish().  The remaining ones run inline as before.
   virtual void Finish(const ConversionRequest &request, Segments *segments) {
     for (size_t i = 0; i < rewriters_.size(); ++i) {
-      rewriters_[i]->Finish(request, segments);
+      if (!rewriters_[i]->defers_finish()) {
+        rewriters_[i]->Finish(request, segments);
+      }
+    }
+    if (!deferred_finish_rewriters_.empty()) {
+      ScheduleDeferredFinish(request, *segments);
     }
+    // A commit ends the burst of Rewrite() calls of one composition;
+    // report the time they accumulated.
+    FlushTimingStats();
   }
 
   // Syncs internal data to local file system.
   virtual bool Sync() {
+    JoinDeferredFinish();
+    FlushTimingStats();
     bool result = false;
     for (size_t i = 0; i < rewriters_.size(); ++i) {
       result |= rewriters_[i]->Sync();
@@ -139,6 +228,7 @@ class MergerRewriter : public RewriterInterface {
 
   // Reloads internal data from local file system.
   virtual bool Reload() {
+    JoinDeferredFinish();
     bool result = false;
     for (size_t i = 0; i < rewriters_.size(); ++i) {
       result |= rewriters_[i]->Reload();
@@ -148,13 +238,327 @@ class MergerRewriter : public RewriterInterface {
 
   // Clears internal data
   virtual void Clear() {
+    JoinDeferredFinish();
     for (size_t i = 0; i < rewriters_.size(); ++i) {
       rewriters_[i]->Clear();
     }
   }
 
  private:
+  // Per-rewriter accumulator of the wall time spent in Rewrite().
+  // |stats_name| is empty for rewriters registered without a name;
+  // their time is not accounted.
+  struct RewriterTiming {
+    explicit RewriterTiming(const char *name) : ticks(0), calls(0) {
+      if (name != NULL && name[0] != '\0') {
+        stats_name.assign(name);
+        stats_name.append("ElapsedUSec");
+      }
+    }
+
+    string stats_name;
+    uint64 ticks;
+    uint32 calls;
+  };
+
+  // Runs one independent rewriter on a private copy of the segments.
+  class IndependentRewriteThread : public Thread {
+   public:
+    IndependentRewriteThread(const ConversionRequest *request,
+                             const RewriterInterface *rewriter,
+                             const Segments &segments)
+        : request_(request), rewriter_(rewriter), modified_(false),
+          elapsed_ticks_(0) {
+      segments_.CopyFrom(segments);
+      SetJoinable(true);
+    }
+
+    virtual ~IndependentRewriteThread() {}
+
+    virtual void Run() {
+      const uint64 begin = Clock::GetTicks();
+      modified_ = rewriter_->Rewrite(*request_, &segments_);
+      elapsed_ticks_ = Clock::GetTicks() - begin;
+    }
+
+    const Segments &segments() const { return segments_; }
+    bool modified() const { return modified_; }
+    uint64 elapsed_ticks() const { return elapsed_ticks_; }
+
+   private:
+    const ConversionRequest *request_;
+    const RewriterInterface *rewriter_;
+    Segments segments_;
+    bool modified_;
+    uint64 elapsed_ticks_;
+
+    DISALLOW_COPY_AND_ASSIGN(IndependentRewriteThread);
+  };
+
+  // Runs the applicable independent rewriters of one batch.  With less
+  // than two of them there is nothing to overlap and the rewriter is
+  // invoked inline; otherwise every rewriter runs on its own thread
+  // against a private copy of the segments and the inserted candidates
+  // are merged back in registration order at the positions the
+  // rewriters chose, so the result does not depend on thread timing.
+  bool RewriteIndependentBatch(const ConversionRequest &request,
+                               const std::vector<size_t> &batch,
+                               Segments *segments) const {
+    if (batch.empty()) {
+      return false;
+    }
+    if (batch.size() == 1) {
+      return TimedRewrite(batch[0], request, segments);
+    }
+
+    // Snapshot the original candidates to identify insertions later.
+    // Candidate pointers are stable under insert_candidate().
+    std::vector<std::vector<const Segment::Candidate *> > originals(
+        segments->conversion_segments_size());
+    for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+      const Segment &segment = segments->conversion_segment(i);
+      for (size_t j = 0; j < segment.candidates_size(); ++j) {
+        originals[i].push_back(&segment.candidate(j));
+      }
+    }
+
+    std::vector<std::unique_ptr<IndependentRewriteThread> > threads;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      threads.emplace_back(new IndependentRewriteThread(
+          &request, rewriters_[batch[i]], *segments));
+      threads.back()->Start("IndependentRewrite");
+    }
+
+    bool result = false;
+    for (size_t i = 0; i < threads.size(); ++i) {
+      threads[i]->Join();
+      RewriterTiming &timing = timings_[batch[i]];
+      if (!timing.stats_name.empty()) {
+        timing.ticks += threads[i]->elapsed_ticks();
+        ++timing.calls;
+      }
+      if (threads[i]->modified()) {
+        MergeInsertions(threads[i]->segments(), originals, segments);
+        result = true;
+      }
+    }
+    return result;
+  }
+
+  // Runs rewriters_[i]->Rewrite(), accounting the elapsed time when
+  // the rewriter was registered with a name.
+  bool TimedRewrite(size_t i, const ConversionRequest &request,
+                    Segments *segments) const {
+    RewriterTiming &timing = timings_[i];
+    if (timing.stats_name.empty()) {
+      return rewriters_[i]->Rewrite(request, segments);
+    }
+    const uint64 begin = Clock::GetTicks();
+    const bool result = rewriters_[i]->Rewrite(request, segments);
+    timing.ticks += Clock::GetTicks() - begin;
+    ++timing.calls;
+    return result;
+  }
+
+  // Reports the accumulated per-rewriter Rewrite() time to the usage
+  // stats and resets the accumulators.  One timing sample is the time
+  // a rewriter spent between two flushes (roughly: per committed
+  // composition), so the total over the samples is the total time
+  // spent in the rewriter.  An usage stats update goes through the
+  // registry and is far more expensive than the two tick reads per
+  // Rewrite() call, which is why the samples are aggregated instead of
+  // being reported per call.
+  void FlushTimingStats() const {
+    const uint64 frequency = Clock::GetFrequency();
+    if (frequency == 0) {
+      return;
+    }
+    for (size_t i = 0; i < timings_.size(); ++i) {
+      RewriterTiming &timing = timings_[i];
+      if (timing.stats_name.empty() || timing.calls == 0) {
+        continue;
+      }
+      const uint64 usec = timing.ticks * 1000000 / frequency;
+      usage_stats::UsageStats::UpdateTiming(timing.stats_name,
+                                            static_cast<uint32>(usec));
+      timing.ticks = 0;
+      timing.calls = 0;
+    }
+  }
+
+  // Everything a deferred Finish() call needs, owned by the task: the
+  // committed segments and the request and config protos, snapshotted
+  // because the caller keeps mutating the segments after the commit and
+  // the session may replace its config.  The composer is deliberately
+  // not captured; see RewriterInterface::defers_finish().
+  struct DeferredFinishContext {
+    commands::Request request;
+    config::Config config;
+    Segments segments;
+  };
+
+  // Snapshots the commit and queues it for the background learning
+  // drain.  The queue is bounded: a pathological burst of commits
+  // blocks here until the drain catches up instead of growing memory,
+  // which restores the old synchronous behavior in that case.
+  void ScheduleDeferredFinish(const ConversionRequest &request,
+                              const Segments &segments) {
+    std::shared_ptr<DeferredFinishContext> context(new DeferredFinishContext);
+    context->request.CopyFrom(request.request());
+    context->config.CopyFrom(request.config());
+    context->segments.CopyFrom(segments);
+
+    bool schedule = false;
+    for (;;) {
+      {
+        scoped_lock lock(&deferred_finish_mutex_);
+        if (deferred_finish_queue_.size() < kMaxDeferredFinishTasks) {
+          deferred_finish_queue_.push(context);
+          if (!deferred_finish_running_) {
+            deferred_finish_running_ = true;
+            schedule = true;
+          }
+          break;
+        }
+      }
+      deferred_finish_space_event_.Wait(50);
+    }
+    if (schedule) {
+      ThreadPool::GetDefault()->Schedule(
+          std::bind(&MergerRewriter::DrainDeferredFinish, this),
+          ThreadPool::PRIORITY_LOW);
+    }
+  }
+
+  // Runs the queued deferred Finish() calls one at a time, in commit
+  // order.  At most one drain task is scheduled, so the deferred
+  // rewriters never see two commits concurrently.
+  void DrainDeferredFinish() {
+    for (;;) {
+      std::shared_ptr<DeferredFinishContext> context;
+      {
+        scoped_lock lock(&deferred_finish_mutex_);
+        if (deferred_finish_queue_.empty()) {
+          deferred_finish_running_ = false;
+          deferred_finish_idle_event_.Notify();
+          return;
+        }
+        context = deferred_finish_queue_.front();
+        deferred_finish_queue_.pop();
+      }
+      deferred_finish_space_event_.Notify();
+      const ConversionRequest request(NULL, &context->request,
+                                      &context->config);
+      for (size_t i = 0; i < deferred_finish_rewriters_.size(); ++i) {
+        deferred_finish_rewriters_[i]->Finish(request, &context->segments);
+      }
+    }
+  }
+
+  // Blocks until every queued deferred Finish() call has run.  Called
+  // before any foreground operation reaches the rewriters, so that the
+  // deferred learning is never observed half-applied; the queue is
+  // normally already empty by the time the user produces the next
+  // event, in which case this is one uncontended lock.
+  void JoinDeferredFinish() const {
+    for (;;) {
+      {
+        scoped_lock lock(&deferred_finish_mutex_);
+        if (!deferred_finish_running_ && deferred_finish_queue_.empty()) {
+          return;
+        }
+      }
+      deferred_finish_idle_event_.Wait(50);
+    }
+  }
+
+  // Returns true if |lhs| and |rhs| are indistinguishable copies of
+  // the same candidate.  MergeInsertions() must not mistake an
+  // inserted candidate for an original that merely shares its
+  // (key, value) -- e.g. an inserted variant with a new description --
+  // so every content field is compared.  Originals are bit-exact
+  // copies of the snapshot (an independent rewriter never modifies
+  // them), hence they are never falsely rejected.
+  static bool IsSameCandidate(const Segment::Candidate &lhs,
+                              const Segment::Candidate &rhs) {
+    return lhs.key == rhs.key &&
+           lhs.value == rhs.value &&
+           lhs.content_key == rhs.content_key &&
+           lhs.content_value == rhs.content_value &&
+           lhs.consumed_key_size == rhs.consumed_key_size &&
+           lhs.prefix == rhs.prefix &&
+           lhs.suffix == rhs.suffix &&
+           lhs.description == rhs.description &&
+           lhs.usage_id == rhs.usage_id &&
+           lhs.usage_title == rhs.usage_title &&
+           lhs.usage_description == rhs.usage_description &&
+           lhs.cost == rhs.cost &&
+           lhs.wcost == rhs.wcost &&
+           lhs.structure_cost == rhs.structure_cost &&
+           lhs.lid == rhs.lid &&
+           lhs.rid == rhs.rid &&
+           lhs.attributes == rhs.attributes &&
+           lhs.source_info == rhs.source_info &&
+           lhs.style == rhs.style &&
+           lhs.command == rhs.command &&
+           lhs.inner_segment_boundary == rhs.inner_segment_boundary;
+  }
+
+  // Copies the candidates of |src| which are not in |originals| (i.e.
+  // the ones the rewriter inserted into its private copy) into |dest|,
+  // keeping the positions the rewriter chose as far as possible.
+  static void MergeInsertions(
+      const Segments &src,
+      const std::vector<std::vector<const Segment::Candidate *> > &originals,
+      Segments *dest) {
+    for (size_t i = 0; i < src.conversion_segments_size(); ++i) {
+      const Segment &src_segment = src.conversion_segment(i);
+      Segment *dest_segment = dest->mutable_conversion_segment(i);
+      size_t original_index = 0;
+      for (size_t j = 0; j < src_segment.candidates_size(); ++j) {
+        const Segment::Candidate &candidate = src_segment.candidate(j);
+        if (original_index < originals[i].size() &&
+            IsSameCandidate(candidate, *originals[i][original_index])) {
+          ++original_index;
+          continue;
+        }
+        const int position = static_cast<int>(
+            std::min(j, static_cast<size_t>(
+                dest_segment->candidates_size())));
+        dest_segment->insert_candidate(position)->CopyFrom(candidate);
+      }
+    }
+  }
+
   std::vector<RewriterInterface *> rewriters_;
+  // The subset of |rewriters_| with handles_focus() == true, in
+  // registration order.  Not owned (owned via |rewriters_|).
+  std::vector<RewriterInterface *> focus_rewriters_;
+  // triggers_[i] caches rewriters_[i]->triggers().
+  std::vector<uint32> triggers_;
+  // independent_[i] is true if rewriters_[i] was added with
+  // AddIndependentRewriter().
+  std::vector<bool> independent_;
+  // timings_[i] accumulates the time spent in rewriters_[i]; mutable
+  // because Rewrite() is const.  Only the single converter thread
+  // touches it.
+  mutable std::vector<RewriterTiming> timings_;
+
+  // The subset of |rewriters_| with defers_finish() == true, in
+  // registration order.  Not owned (owned via |rewriters_|).
+  std::vector<RewriterInterface *> deferred_finish_rewriters_;
+
+  // Background learning queue; see ScheduleDeferredFinish().  The
+  // mutex and events are mutable because JoinDeferredFinish() is
+  // called from const methods.
+  static const size_t kMaxDeferredFinishTasks = 16;
+  mutable Mutex deferred_finish_mutex_;
+  std::queue<std::shared_ptr<DeferredFinishContext> > deferred_finish_queue_;
+  // True while a drain task is scheduled or running.
+  bool deferred_finish_running_;
+  // Raised when the drain empties the queue / frees a queue slot.
+  mutable UnnamedEvent deferred_finish_idle_event_;
+  mutable UnnamedEvent deferred_finish_space_event_;
 
   DISALLOW_COPY_AND_ASSIGN(MergerRewriter);
 };
@@ -29,6 +29,7 @@
 
 #include "rewriter/merger_rewriter.h"
 
+#include <algorithm>
 #include <string>
 
 #include "base/system_util.h"
@@ -37,6 +38,8 @@
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "testing/base/public/gunit.h"
+#include "usage_stats/usage_stats.h"
+#include "usage_stats/usage_stats_testing_util.h"
 
 DECLARE_string(test_tmpdir);
 
@@ -69,6 +72,10 @@ class TestRewriter : public RewriterInterface {
     return capability_;
   }
 
+  virtual bool handles_focus() const {
+    return true;
+  }
+
   virtual bool Focus(Segments *segments,
                      size_t segment_index,
                      int candidate_index) const {
@@ -101,6 +108,47 @@ class TestRewriter : public RewriterInterface {
   int capability_;
 };
 
+// A rewriter which inserts one candidate with |value| at |position| of
+// the first conversion segment, for testing the independent rewriter
+// path.
+class InsertTestRewriter : public RewriterInterface {
+ public:
+  InsertTestRewriter(const string &value, size_t position)
+      : value_(value), position_(position) {}
+  InsertTestRewriter(const string &value, size_t position,
+                     const string &description)
+      : value_(value), position_(position), description_(description) {}
+
+  virtual bool Rewrite(const ConversionRequest &request,
+                       Segments *segments) const {
+    Segment *segment = segments->mutable_conversion_segment(0);
+    const int pos = static_cast<int>(std::min(
+        position_, static_cast<size_t>(segment->candidates_size())));
+    Segment::Candidate *candidate = segment->insert_candidate(pos);
+    candidate->value = value_;
+    candidate->description = description_;
+    return true;
+  }
+
+ private:
+  const string value_;
+  const size_t position_;
+  const string description_;
+};
+
+// A TestRewriter which declares that it can only rewrite a single
+// conversion segment.
+class SingleSegmentTestRewriter : public TestRewriter {
+ public:
+  SingleSegmentTestRewriter(string *buffer, const string &name,
+                            bool return_value)
+      : TestRewriter(buffer, name, return_value) {}
+
+  virtual uint32 triggers() const {
+    return RewriterInterface::SINGLE_CONVERSION_SEGMENT_TRIGGER;
+  }
+};
+
 class MergerRewriterTest : public testing::Test {
  protected:
   virtual void SetUp() {
@@ -133,6 +181,129 @@ TEST_F(MergerRewriterTest, Rewrite) {
             call_result);
 }
 
+TEST_F(MergerRewriterTest, TimingStatsAreFlushedOnFinish) {
+  usage_stats::scoped_usage_stats_enabler usage_stats_enabler;
+
+  string call_result;
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  segments.set_request_type(Segments::CONVERSION);
+  // The name must be listed in data/usage_stats/stats.def, so borrow
+  // one of a production rewriter.
+  merger.AddRewriter(new TestRewriter(&call_result, "a", false),
+                     "NumberRewriter");
+
+  // The time is accumulated during Rewrite() and only reported on
+  // Finish(), which ends the burst of Rewrite() calls of a composition.
+  EXPECT_FALSE(merger.Rewrite(request, &segments));
+  EXPECT_STATS_NOT_EXIST("NumberRewriterElapsedUSec");
+  merger.Finish(request, &segments);
+  uint32 num_timings = 0;
+  EXPECT_TRUE(usage_stats::UsageStats::GetTimingForTest(
+      "NumberRewriterElapsedUSec", NULL, &num_timings, NULL, NULL, NULL));
+  EXPECT_EQ(1, num_timings);
+
+  // A Finish() without preceding Rewrite() calls adds no sample.
+  merger.Finish(request, &segments);
+  EXPECT_TRUE(usage_stats::UsageStats::GetTimingForTest(
+      "NumberRewriterElapsedUSec", NULL, &num_timings, NULL, NULL, NULL));
+  EXPECT_EQ(1, num_timings);
+}
+
+TEST_F(MergerRewriterTest, IndependentRewritersMergeDeterministically) {
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  segments.set_request_type(Segments::CONVERSION);
+  Segment *segment = segments.push_back_segment();
+  segment->push_back_candidate()->value = "base";
+
+  merger.AddIndependentRewriter(new InsertTestRewriter("x", 0));
+  merger.AddIndependentRewriter(new InsertTestRewriter("y", 0));
+
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+
+  // Both rewriters saw ["base"] in their private copies and inserted at
+  // position 0.  The insertions are merged back in registration order,
+  // each at the position its rewriter chose, so the result does not
+  // depend on thread timing.
+  ASSERT_EQ(3, segment->candidates_size());
+  EXPECT_EQ("y", segment->candidate(0).value);
+  EXPECT_EQ("x", segment->candidate(1).value);
+  EXPECT_EQ("base", segment->candidate(2).value);
+}
+
+TEST_F(MergerRewriterTest, MergeDoesNotMistakeInsertedDuplicateForOriginal) {
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  segments.set_request_type(Segments::CONVERSION);
+  Segment *segment = segments.push_back_segment();
+  segment->push_back_candidate()->value = "base";
+
+  // The first rewriter inserts a candidate that shares its value with
+  // the original but carries a description.  Value equality alone must
+  // not make the merge treat it as the original, which would duplicate
+  // the plain candidate and drop the annotated one.
+  merger.AddIndependentRewriter(
+      new InsertTestRewriter("base", 0, "annotated"));
+  merger.AddIndependentRewriter(new InsertTestRewriter("y", 0));
+
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+
+  ASSERT_EQ(3, segment->candidates_size());
+  EXPECT_EQ("y", segment->candidate(0).value);
+  EXPECT_EQ("base", segment->candidate(1).value);
+  EXPECT_EQ("annotated", segment->candidate(1).description);
+  EXPECT_EQ("base", segment->candidate(2).value);
+  EXPECT_TRUE(segment->candidate(2).description.empty());
+}
+
+TEST_F(MergerRewriterTest, IndependentRewriterRunsInlineWhenAlone) {
+  string call_result;
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  segments.set_request_type(Segments::CONVERSION);
+  segments.push_back_segment();
+  merger.AddIndependentRewriter(new TestRewriter(&call_result, "a", true));
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  EXPECT_EQ("a.Rewrite();", call_result);
+}
+
+TEST_F(MergerRewriterTest, RewriteCheckTriggers) {
+  string call_result;
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  segments.set_request_type(Segments::CONVERSION);
+  merger.AddRewriter(new TestRewriter(&call_result, "a", false));
+  merger.AddRewriter(new SingleSegmentTestRewriter(&call_result, "b", false));
+
+  // With two conversion segments, the rewriter which declared
+  // SINGLE_CONVERSION_SEGMENT_TRIGGER is not invoked at all.
+  segments.push_back_segment();
+  segments.push_back_segment();
+  EXPECT_EQ(2, segments.conversion_segments_size());
+  EXPECT_FALSE(merger.Rewrite(request, &segments));
+  EXPECT_EQ("a.Rewrite();", call_result);
+
+  // With a single conversion segment, both rewriters are invoked.
+  segments.pop_back_segment();
+  EXPECT_EQ(1, segments.conversion_segments_size());
+  call_result.clear();
+  EXPECT_FALSE(merger.Rewrite(request, &segments));
+  EXPECT_EQ("a.Rewrite();"
+            "b.Rewrite();",
+            call_result);
+}
+
 TEST_F(MergerRewriterTest, RewriteSuggestion) {
   string call_result;
   MergerRewriter merger;
@@ -277,6 +448,22 @@ TEST_F(MergerRewriterTest, Focus) {
             "c.Focus();"
             "d.Focus();",
             call_result);
+
+  // A rewriter which does not declare a Focus() handler is skipped.
+  class NoFocusTestRewriter : public TestRewriter {
+   public:
+    NoFocusTestRewriter(string *buffer, const string &name)
+        : TestRewriter(buffer, name, true) {}
+    virtual bool handles_focus() const { return false; }
+  };
+  merger.AddRewriter(new NoFocusTestRewriter(&call_result, "e"));
+  call_result.clear();
+  EXPECT_TRUE(merger.Focus(NULL, 0, 0));
+  EXPECT_EQ("a.Focus();"
+            "b.Focus();"
+            "c.Focus();"
+            "d.Focus();",
+            call_result);
 }
 
 TEST_F(MergerRewriterTest, Finish) {
@@ -293,6 +480,37 @@ TEST_F(MergerRewriterTest, Finish) {
             call_result);
 }
 
+TEST_F(MergerRewriterTest, DeferredFinishRunsBeforeNextForegroundCall) {
+  class DeferredFinishTestRewriter : public TestRewriter {
+   public:
+    DeferredFinishTestRewriter(string *buffer, const string &name)
+        : TestRewriter(buffer, name, false) {}
+    virtual bool defers_finish() const { return true; }
+  };
+
+  string call_result;
+  const ConversionRequest request;
+  Segments segments;
+  MergerRewriter merger;
+  merger.AddRewriter(new DeferredFinishTestRewriter(&call_result, "a"));
+  merger.AddRewriter(new DeferredFinishTestRewriter(&call_result, "b"));
+
+  // Both rewriters learn in the background, one commit at a time and in
+  // commit order.  Sync() joins the queue before reaching the
+  // rewriters, so by the time it appends its own entries every deferred
+  // call has run.
+  merger.Finish(request, &segments);
+  merger.Finish(request, &segments);
+  EXPECT_FALSE(merger.Sync());
+  EXPECT_EQ("a.Finish();"
+            "b.Finish();"
+            "a.Finish();"
+            "b.Finish();"
+            "a.Sync();"
+            "b.Sync();",
+            call_result);
+}
+
 TEST_F(MergerRewriterTest, Sync) {
   string call_result;
   MergerRewriter merger;
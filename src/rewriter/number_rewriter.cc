@@ -350,22 +350,26 @@ void GetNumbers(RewriteType type, bool exec_radix_conversion,
                 const string &arabic_content_value,
                 std::vector<NumberUtil::NumberString> *output) {
   DCHECK(output);
+  // Validate and parse the digit string once; every style generator
+  // below consumes the precomputed representation.
+  NumberUtil::DecimalStringInfo info;
+  NumberUtil::ParseDecimalString(arabic_content_value, &info);
   if (type == ARABIC_FIRST) {
     InsertHalfArabic(arabic_content_value, output);
-    NumberUtil::ArabicToWideArabic(arabic_content_value, output);
-    NumberUtil::ArabicToSeparatedArabic(arabic_content_value, output);
-    NumberUtil::ArabicToKanji(arabic_content_value, output);
-    NumberUtil::ArabicToOtherForms(arabic_content_value, output);
+    NumberUtil::ArabicToWideArabic(arabic_content_value, info, output);
+    NumberUtil::ArabicToSeparatedArabic(arabic_content_value, info, output);
+    NumberUtil::ArabicToKanji(arabic_content_value, info, output);
+    NumberUtil::ArabicToOtherForms(arabic_content_value, info, output);
   } else if (type == KANJI_FIRST) {
-    NumberUtil::ArabicToKanji(arabic_content_value, output);
+    NumberUtil::ArabicToKanji(arabic_content_value, info, output);
     InsertHalfArabic(arabic_content_value, output);
-    NumberUtil::ArabicToWideArabic(arabic_content_value, output);
-    NumberUtil::ArabicToSeparatedArabic(arabic_content_value, output);
-    NumberUtil::ArabicToOtherForms(arabic_content_value, output);
+    NumberUtil::ArabicToWideArabic(arabic_content_value, info, output);
+    NumberUtil::ArabicToSeparatedArabic(arabic_content_value, info, output);
+    NumberUtil::ArabicToOtherForms(arabic_content_value, info, output);
   }
 
   if (exec_radix_conversion) {
-    NumberUtil::ArabicToOtherRadixes(arabic_content_value, output);
+    NumberUtil::ArabicToOtherRadixes(arabic_content_value, info, output);
   }
 }
 
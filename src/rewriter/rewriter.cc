@@ -87,44 +87,65 @@ RewriterImpl::RewriterImpl(const ConverterInterface *parent_converter,
   DCHECK(pos_group);
   // |dictionary| can be NULL
 
-  AddRewriter(new UserDictionaryRewriter);
-  AddRewriter(new FocusCandidateRewriter(data_manager));
-  AddRewriter(new LanguageAwareRewriter(pos_matcher_, dictionary));
-  AddRewriter(new TransliterationRewriter(pos_matcher_));
-  AddRewriter(new EnglishVariantsRewriter);
-  AddRewriter(new NumberRewriter(data_manager));
-  AddRewriter(new CollocationRewriter(data_manager));
-  AddRewriter(new SingleKanjiRewriter(*data_manager));
-  AddRewriter(new EmojiRewriter(*data_manager));
-  AddRewriter(EmoticonRewriter::CreateFromDataManager(*data_manager).release());
-  AddRewriter(new CalculatorRewriter(parent_converter));
-  AddRewriter(new SymbolRewriter(parent_converter, data_manager));
-  AddRewriter(new UnicodeRewriter(parent_converter));
-  AddRewriter(new VariantsRewriter(pos_matcher_));
-  AddRewriter(new ZipcodeRewriter(&pos_matcher_));
-  AddRewriter(new DiceRewriter);
+  // The names key the per-rewriter timing stats; each
+  // "<name>ElapsedUSec" is listed in data/usage_stats/stats.def.
+  AddRewriter(new UserDictionaryRewriter, "UserDictionaryRewriter");
+  AddRewriter(new FocusCandidateRewriter(data_manager),
+              "FocusCandidateRewriter");
+  AddRewriter(new LanguageAwareRewriter(pos_matcher_, dictionary),
+              "LanguageAwareRewriter");
+  AddRewriter(new TransliterationRewriter(pos_matcher_),
+              "TransliterationRewriter");
+  AddRewriter(new EnglishVariantsRewriter, "EnglishVariantsRewriter");
+  AddRewriter(new NumberRewriter(data_manager), "NumberRewriter");
+  AddRewriter(new CollocationRewriter(data_manager), "CollocationRewriter");
+  // SingleKanjiRewriter inserts candidates looked up from the segment
+  // keys, but it also annotates existing candidates' descriptions in
+  // place, which the insertion-only merge of an independent batch would
+  // drop, so it stays on the sequential path, as does SymbolRewriter,
+  // which can resize segments through the parent converter.
+  AddRewriter(new SingleKanjiRewriter(*data_manager), "SingleKanjiRewriter");
+  // These two only insert candidates looked up from the segment keys
+  // and never read each other's output, so they may run concurrently;
+  // see MergerRewriter::AddIndependentRewriter().
+  AddIndependentRewriter(new EmojiRewriter(*data_manager), "EmojiRewriter");
+  AddIndependentRewriter(
+      EmoticonRewriter::CreateFromDataManager(*data_manager).release(),
+      "EmoticonRewriter");
+  AddRewriter(new CalculatorRewriter(parent_converter), "CalculatorRewriter");
+  AddRewriter(new SymbolRewriter(parent_converter, data_manager),
+              "SymbolRewriter");
+  AddRewriter(new UnicodeRewriter(parent_converter), "UnicodeRewriter");
+  AddRewriter(new VariantsRewriter(pos_matcher_), "VariantsRewriter");
+  AddRewriter(new ZipcodeRewriter(&pos_matcher_), "ZipcodeRewriter");
+  AddRewriter(new DiceRewriter, "DiceRewriter");
 
   if (FLAGS_use_history_rewriter) {
-    AddRewriter(new UserBoundaryHistoryRewriter(parent_converter));
-    AddRewriter(new UserSegmentHistoryRewriter(&pos_matcher_, pos_group));
+    AddRewriter(new UserBoundaryHistoryRewriter(parent_converter),
+                "UserBoundaryHistoryRewriter");
+    AddRewriter(new UserSegmentHistoryRewriter(&pos_matcher_, pos_group),
+                "UserSegmentHistoryRewriter");
   }
 
-  AddRewriter(new DateRewriter);
-  AddRewriter(new FortuneRewriter);
+  AddRewriter(new DateRewriter, "DateRewriter");
+  AddRewriter(new FortuneRewriter, "FortuneRewriter");
 #ifndef OS_ANDROID
   // CommandRewriter is not tested well on Android.
   // So we temporarily disable it.
   // TODO(yukawa, team): Enable CommandRewriter on Android if necessary.
-  AddRewriter(new CommandRewriter);
+  AddRewriter(new CommandRewriter, "CommandRewriter");
 #endif  // !OS_ANDROID
 #ifndef NO_USAGE_REWRITER
-  AddRewriter(new UsageRewriter(data_manager, dictionary));
+  AddRewriter(new UsageRewriter(data_manager, dictionary), "UsageRewriter");
 #endif  // NO_USAGE_REWRITER
-  AddRewriter(new VersionRewriter(data_manager->GetDataVersion()));
-  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager));
-  AddRewriter(new KatakanaPromotionRewriter);
-  AddRewriter(new NormalizationRewriter);
-  AddRewriter(new RemoveRedundantCandidateRewriter);
+  AddRewriter(new VersionRewriter(data_manager->GetDataVersion()),
+              "VersionRewriter");
+  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager),
+              "CorrectionRewriter");
+  AddRewriter(new KatakanaPromotionRewriter, "KatakanaPromotionRewriter");
+  AddRewriter(new NormalizationRewriter, "NormalizationRewriter");
+  AddRewriter(new RemoveRedundantCandidateRewriter,
+              "RemoveRedundantCandidateRewriter");
 }
 
 }  // namespace mozc
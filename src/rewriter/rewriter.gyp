@@ -43,6 +43,7 @@
         '<(gen_out_dir)/emoticon_rewriter_data.h',
         '<(gen_out_dir)/single_kanji_rewriter_data.h',
         '<(gen_out_dir)/symbol_rewriter_data.h',
+        'annotation_pool.cc',
         'calculator_rewriter.cc',
         'collocation_rewriter.cc',
         'collocation_util.cc',
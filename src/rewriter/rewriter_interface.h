@@ -32,6 +32,7 @@
 
 #include <cstddef>  // for size_t
 
+#include "base/port.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
 
@@ -56,9 +57,38 @@ class RewriterInterface {
     return CONVERSION;
   }
 
+  // Properties of the segments which a rewriter can declare as
+  // preconditions of its Rewrite(); see triggers() below.
+  enum TriggerType {
+    // Rewrite() can modify the segments only when there is exactly
+    // one conversion segment.
+    SINGLE_CONVERSION_SEGMENT_TRIGGER = 1,
+  };
+
+  // Returns a bitmask of TriggerType values which must all hold for
+  // Rewrite() to possibly modify the segments; 0 declares no
+  // precondition.  MergerRewriter computes the properties of the
+  // segments once per conversion and skips the rewriters whose
+  // preconditions do not hold, so the dispatch-and-decline cost of
+  // the two dozen registered rewriters is paid only by the plausible
+  // ones.  Declare only preconditions which hold for every request
+  // type the rewriter is capable of.
+  virtual uint32 triggers() const {
+    return 0;
+  }
+
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const = 0;
 
+  // Returns true if Focus() of this rewriter does anything beyond the
+  // default no-op below.  Candidate navigation calls Focus() on every
+  // candidate change, while most rewriters only react to content
+  // changes through Rewrite(); MergerRewriter dispatches Focus() only
+  // to the rewriters which declare a handler here.
+  virtual bool handles_focus() const {
+    return false;
+  }
+
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
   // In this method, Converter will find bracketing matching.
@@ -73,6 +103,18 @@ class RewriterInterface {
   // Hook(s) for all mutable operations
   virtual void Finish(const ConversionRequest &request, Segments *segments) {}
 
+  // Returns true if Finish() of this rewriter may be deferred and run
+  // on a background worker after the commit has returned to the client.
+  // Such a Finish() must use nothing of the conversion request beyond
+  // the request and config protos — in particular not the composer,
+  // which is reset right after a commit — because MergerRewriter calls
+  // it with a snapshot of the segments and those protos.  The deferred
+  // calls run in commit order and are joined before the next foreground
+  // operation reaches the rewriters; see MergerRewriter::Finish().
+  virtual bool defers_finish() const {
+    return false;
+  }
+
   // sync internal data to local file system.
   virtual bool Sync() { return true; }
 
@@ -38,6 +38,7 @@
       'target_name': 'rewriter_test',
       'type': 'executable',
       'sources': [
+        'annotation_pool_test.cc',
         'calculator_rewriter_test.cc',
         'collocation_rewriter_test.cc',
         'collocation_util_test.cc',
@@ -79,6 +80,7 @@
         '../session/session_base.gyp:request_test_util',
         '../testing/testing.gyp:gtest_main',
         '../testing/testing.gyp:mozctest',
+        '../usage_stats/usage_stats_test.gyp:usage_stats_testing_util',
         'calculator/calculator.gyp:calculator_mock',
         'rewriter.gyp:rewriter',
       ],
@@ -29,8 +29,10 @@
 
 #include "rewriter/transliteration_rewriter.h"
 
+#include <map>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "base/logging.h"
@@ -230,6 +232,32 @@ void ModifyT13ns(const ConversionRequest &request,
 }  // namespace
 
 
+const std::vector<string> &TransliterationRewriter::GetT13nsFromComposer(
+    const ConversionRequest &request, const Segment &segment,
+    size_t position, size_t length) const {
+  // One revision identifies one state of one composer, so a match means
+  // the cached entries were generated from the same composition.
+  const uint64 revision = request.composer().revision();
+  if (revision != cached_revision_) {
+    t13n_cache_.clear();
+    cached_revision_ = revision;
+  }
+  const std::pair<size_t, size_t> range(position, length);
+  std::map<std::pair<size_t, size_t>, std::vector<string> >::const_iterator
+      it = t13n_cache_.find(range);
+  if (it != t13n_cache_.end()) {
+    return it->second;
+  }
+  std::vector<string> t13ns;
+  if (length == string::npos) {
+    request.composer().GetTransliterations(&t13ns);
+  } else {
+    request.composer().GetSubTransliterations(position, length, &t13ns);
+  }
+  ModifyT13ns(request, segment, &t13ns);
+  return t13n_cache_.emplace(range, std::move(t13ns)).first->second;
+}
+
 bool TransliterationRewriter::FillT13nsFromComposer(
     const ConversionRequest &request,
     Segments *segments) const {
@@ -239,11 +267,10 @@ bool TransliterationRewriter::FillT13nsFromComposer(
   // the composition string.
   if (segments->conversion_segments_size() == 1 &&
       request.composer().GetLength() == request.composer().GetCursor()) {
-    std::vector<string> t13ns;
-    request.composer().GetTransliterations(&t13ns);
     Segment *segment = segments->mutable_conversion_segment(0);
     CHECK(segment);
-    ModifyT13ns(request, *segment, &t13ns);
+    const std::vector<string> &t13ns =
+        GetT13nsFromComposer(request, *segment, 0, string::npos);
     string key;
     request.composer().GetQueryForConversion(&key);
     return SetTransliterations(t13ns, key, segment);
@@ -259,13 +286,10 @@ bool TransliterationRewriter::FillT13nsFromComposer(
       continue;
     }
     const size_t composition_len = Util::CharsLen(key);
-    std::vector<string> t13ns;
-    request.composer().GetSubTransliterations(composition_pos,
-                                              composition_len,
-                                              &t13ns);
+    const std::vector<string> &t13ns = GetT13nsFromComposer(
+        request, *segment, composition_pos, composition_len);
     composition_pos += composition_len;
 
-    ModifyT13ns(request, *segment, &t13ns);
     modified |= SetTransliterations(t13ns, key, segment);
   }
   return modified;
@@ -325,7 +349,7 @@ bool TransliterationRewriter::FillT13nsFromKey(Segments *segments) const {
 
 TransliterationRewriter::TransliterationRewriter(
     const dictionary::POSMatcher &pos_matcher)
-    : unknown_id_(pos_matcher.GetUnknownId()) {}
+    : unknown_id_(pos_matcher.GetUnknownId()), cached_revision_(0) {}
 
 TransliterationRewriter::~TransliterationRewriter() {}
 
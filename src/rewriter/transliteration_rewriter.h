@@ -30,7 +30,9 @@
 #ifndef MOZC_REWRITER_TRANSLITERATION_REWRITER_H_
 #define MOZC_REWRITER_TRANSLITERATION_REWRITER_H_
 
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/port.h"
@@ -68,9 +70,27 @@ class TransliterationRewriter : public RewriterInterface  {
   bool FillT13nsFromKey(Segments *segments) const;
   bool AddRawNumberT13nCandidates(const ConversionRequest &request,
                                   Segments *segments) const;
+  // Returns the transliterations of the [position, position + length)
+  // range of the composition ((0, string::npos) stands for the whole
+  // composition) from |t13n_cache_|, generating and caching them on a
+  // miss.
+  const std::vector<string> &GetT13nsFromComposer(
+      const ConversionRequest &request, const Segment &segment,
+      size_t position, size_t length) const;
 
   const uint16 unknown_id_;
 
+  // Cache of the transliterations generated from the composer, keyed by
+  // the (position, length) range of the composition.  Generating them
+  // walks the whole composition per range, while Rewrite() runs on
+  // every conversion update; the entries stay valid until the
+  // composition is actually edited, which is detected through
+  // composer::Composer::revision().  Mutable because Rewrite() is
+  // const; requests are processed on the single converter thread.
+  mutable uint64 cached_revision_;
+  mutable std::map<std::pair<size_t, size_t>, std::vector<string> >
+      t13n_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(TransliterationRewriter);
 };
 
@@ -34,6 +34,8 @@
 #include <string>
 
 #include "base/logging.h"
+#include "base/mutex.h"
+#include "base/scheduler.h"
 #include "base/serialized_string_array.h"
 #include "base/util.h"
 #include "config/config_handler.h"
@@ -48,34 +50,104 @@ using mozc::dictionary::DictionaryInterface;
 using mozc::dictionary::POSMatcher;
 
 namespace mozc {
+namespace {
+
+// Scheduling of the idle prefetch job; see UsageRewriter::Prefetch().
+// The job fires once shortly after startup (deferred while the user is
+// typing) and is a cheap no-op on the later firings.
+const uint32 kPrefetchDelayMsec = 5 * 1000;
+const uint32 kPrefetchRandomDelayMsec = 5 * 1000;
+const uint32 kPrefetchIntervalMsec = 24 * 60 * 60 * 1000;  // 24 hours
+
+}  // namespace
 
 UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
                              const DictionaryInterface *dictionary)
-    : pos_matcher_(data_manager->GetPOSMatcherData()),
+    : usage_item_map_built_(false),
+      pos_matcher_(data_manager->GetPOSMatcherData()),
       dictionary_(dictionary),
       base_conjugation_suffix_(nullptr) {
   StringPiece base_conjugation_suffix_data;
-  StringPiece conjugation_suffix_data;
-  StringPiece conjugation_suffix_index_data;
-  StringPiece usage_items_data;
   StringPiece string_array_data;
   data_manager->GetUsageRewriterData(&base_conjugation_suffix_data,
-                                     &conjugation_suffix_data,
-                                     &conjugation_suffix_index_data,
-                                     &usage_items_data,
+                                     &conjugation_suffix_data_,
+                                     &conjugation_suffix_index_data_,
+                                     &usage_items_data_,
                                      &string_array_data);
   base_conjugation_suffix_ =
       reinterpret_cast<const uint32 *>(base_conjugation_suffix_data.data());
-  const uint32 *conjugation_suffix =
-      reinterpret_cast<const uint32 *>(conjugation_suffix_data.data());
-  const uint32 *conjugation_suffix_data_index =
-      reinterpret_cast<const uint32 *>(conjugation_suffix_index_data.data());
 
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   string_array_.Set(string_array_data);
 
-  UsageDictItemIterator begin(usage_items_data.data());
-  UsageDictItemIterator end(usage_items_data.data() + usage_items_data.size());
+  // The key/value -> usage item map is built lazily on the first
+  // conversion which shows usage; see EnsureUsageItemMap().  To keep
+  // that first conversion from stalling on the build and on cold
+  // mmapped usage data, an idle-priority job warms both up in the
+  // background beforehand.
+  prefetch_job_name_ = Util::StringPrintf("UsageRewriterPrefetch:%p",
+                                          static_cast<const void *>(this));
+  Scheduler::AddJob(
+      Scheduler::JobSetting(prefetch_job_name_,
+                            kPrefetchIntervalMsec, kPrefetchIntervalMsec,
+                            kPrefetchDelayMsec, kPrefetchRandomDelayMsec,
+                            &UsageRewriter::PrefetchCallback, this)
+          .set_priority(Scheduler::JobSetting::PRIORITY_IDLE));
+}
+
+UsageRewriter::~UsageRewriter() {
+  // Blocks until a running prefetch callback has finished.
+  Scheduler::RemoveJob(prefetch_job_name_);
+}
+
+// static
+bool UsageRewriter::PrefetchCallback(void *data) {
+  static_cast<const UsageRewriter *>(data)->Prefetch();
+  return true;
+}
+
+void UsageRewriter::Prefetch() const {
+  config::Config config;
+  config::ConfigHandler::GetConfig(&config);
+  // The same early-out as Rewrite(); users who disable the usage pane
+  // keep paying nothing.
+  if (config.has_information_list_config() &&
+      !config.information_list_config().use_local_usage_dictionary()) {
+    return;
+  }
+
+  EnsureUsageItemMap();
+
+  // The map build reads every key and value string, but the meaning
+  // strings are only read when a candidate gets focused; touch them
+  // here so that their pages are resident before the first focus.
+  size_t checksum = 0;
+  UsageDictItemIterator begin(usage_items_data_.data());
+  UsageDictItemIterator end(usage_items_data_.data() +
+                            usage_items_data_.size());
+  for (; begin != end; ++begin) {
+    const StringPiece meaning = string_array_[begin.meaning_index()];
+    if (!meaning.empty()) {
+      checksum += static_cast<size_t>(meaning.data()[0]);
+    }
+  }
+  VLOG(1) << "Usage data prefetched: checksum=" << checksum;
+}
+
+void UsageRewriter::EnsureUsageItemMap() const {
+  scoped_lock l(&usage_item_map_mutex_);
+  if (usage_item_map_built_) {
+    return;
+  }
+
+  const uint32 *conjugation_suffix =
+      reinterpret_cast<const uint32 *>(conjugation_suffix_data_.data());
+  const uint32 *conjugation_suffix_data_index =
+      reinterpret_cast<const uint32 *>(conjugation_suffix_index_data_.data());
+
+  UsageDictItemIterator begin(usage_items_data_.data());
+  UsageDictItemIterator end(usage_items_data_.data() +
+                            usage_items_data_.size());
 
   // TODO(taku): To reduce memory footprint, better to replace it with
   // binary search over the conjugation_suffix_data diretly.
@@ -98,9 +170,8 @@ UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
       key_value_usageitem_map_[key_value2] = begin;
     }
   }
-}
 
-UsageRewriter::~UsageRewriter() {
+  usage_item_map_built_ = true;
 }
 
 // static
@@ -194,6 +265,10 @@ bool UsageRewriter::Rewrite(const ConversionRequest &request,
     return false;
   }
 
+  // Reached only when the usage pane is enabled; users who disable it
+  // never pay for the map construction.
+  EnsureUsageItemMap();
+
   bool modified = false;
   // UsageIDs for embedded usage dictionary are generated in advance by
   // gen_usage_rewriter_dictionary_main.cc (which are just sequential numbers).
@@ -36,8 +36,10 @@
 #include <string>
 #include <utility>
 
+#include "base/mutex.h"
 #include "base/port.h"
 #include "base/serialized_string_array.h"
+#include "base/string_piece.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
@@ -63,6 +65,7 @@ class UsageRewriter : public RewriterInterface  {
 
  private:
   FRIEND_TEST(UsageRewriterTest, GetKanjiPrefixAndOneHiragana);
+  FRIEND_TEST(UsageRewriterTest, PrefetchTest);
 
   static const size_t kUsageItemByteLength = 20;
 
@@ -112,11 +115,37 @@ class UsageRewriter : public RewriterInterface  {
   UsageDictItemIterator LookupUsage(
       const Segment::Candidate &candidate) const;
 
-  std::map<StrPair, UsageDictItemIterator> key_value_usageitem_map_;
+  // Builds |key_value_usageitem_map_| on the first call.  The map walks
+  // the whole usage dictionary, which is too expensive for server
+  // startup; it is deferred until a conversion actually shows usage.
+  // Called from the converter thread and from the idle prefetch job, so
+  // the build is serialized by |usage_item_map_mutex_|.
+  void EnsureUsageItemMap() const;
+
+  // Scheduler callback of the idle prefetch job; |data| is the
+  // UsageRewriter instance.
+  static bool PrefetchCallback(void *data);
+
+  // Builds the usage item map and faults in the mmapped usage data
+  // pages on background idle time, so the first conversion that shows
+  // usage does not stall on either.  No-op when the usage pane is
+  // disabled in the config.
+  void Prefetch() const;
+
+  mutable std::map<StrPair, UsageDictItemIterator> key_value_usageitem_map_;
+  mutable bool usage_item_map_built_;
+  mutable Mutex usage_item_map_mutex_;
   const dictionary::POSMatcher pos_matcher_;
   const dictionary::DictionaryInterface *dictionary_;
   const uint32 *base_conjugation_suffix_;
+  // Kept for the deferred map build; see EnsureUsageItemMap().
+  StringPiece conjugation_suffix_data_;
+  StringPiece conjugation_suffix_index_data_;
+  StringPiece usage_items_data_;
   SerializedStringArray string_array_;
+  // Name of the Scheduler job registered for Prefetch(); unique per
+  // instance.
+  string prefetch_job_name_;
 };
 
 }  // namespace mozc
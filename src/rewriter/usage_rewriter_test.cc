@@ -157,6 +157,24 @@ TEST_F(UsageRewriterTest, SingleSegmentSingleCandidateTest) {
   EXPECT_EQ("", segments.conversion_segment(0).candidate(0).usage_description);
 }
 
+TEST_F(UsageRewriterTest, PrefetchTest) {
+  Segments segments;
+  std::unique_ptr<UsageRewriter> rewriter(CreateUsageRewriter());
+  Segment *seg;
+
+  // Prefetch() normally runs on the idle Scheduler job; calling it
+  // directly here checks that a prefetched rewriter behaves the same.
+  rewriter->Prefetch();
+
+  segments.Clear();
+  seg = segments.push_back_segment();
+  seg->set_key("あおい");
+  AddCandidate("あおい", "青い", "あおい", "青い", seg);
+  EXPECT_TRUE(rewriter->Rewrite(convreq_, &segments));
+  EXPECT_EQ("青い", segments.conversion_segment(0).candidate(0).usage_title);
+  EXPECT_NE("", segments.conversion_segment(0).candidate(0).usage_description);
+}
+
 TEST_F(UsageRewriterTest, ConfigTest) {
   Segments segments;
   std::unique_ptr<UsageRewriter> rewriter(CreateUsageRewriter());
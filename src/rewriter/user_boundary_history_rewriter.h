@@ -59,6 +59,12 @@ class UserBoundaryHistoryRewriter : public RewriterInterface {
 
   virtual void Finish(const ConversionRequest &request, Segments *segments);
 
+  // Finish() only inserts boundary lengths into the rewriter's own
+  // storage (ResizeOrInsert() in INSERT mode never touches the parent
+  // converter), so learning can run after the commit has returned to
+  // the client; see MergerRewriter::Finish().
+  virtual bool defers_finish() const { return true; }
+
   virtual bool Reload();
 
   virtual void Clear();
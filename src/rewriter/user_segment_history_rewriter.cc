@@ -38,6 +38,7 @@
 #include "base/compiler_specific.h"
 #include "base/config_file_stream.h"
 #include "base/file_util.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "base/string_piece.h"
@@ -55,6 +56,10 @@
 #include "transliteration/transliteration.h"
 #include "usage_stats/usage_stats.h"
 
+DEFINE_bool(user_segment_history_write_behind, false,
+            "Persist user segment history with batched write-behind "
+            "flushes instead of in-place mmap updates.");
+
 using mozc::config::CharacterFormManager;
 using mozc::config::Config;
 using mozc::dictionary::POSMatcher;
@@ -519,7 +524,8 @@ UserSegmentHistoryRewriter::UserSegmentHistoryRewriter(
     const PosGroup *pos_group)
     : storage_(new LRUStorage),
       pos_matcher_(pos_matcher),
-      pos_group_(pos_group) {
+      pos_group_(pos_group),
+      feature_cache_valid_(false) {
   Reload();
 
   CHECK_EQ(sizeof(uint32), sizeof(FeatureValue));
@@ -531,22 +537,14 @@ UserSegmentHistoryRewriter::~UserSegmentHistoryRewriter() {}
 #define INSERT_FEATURE(func, base_key, base_value, force_insert) \
 do { \
   if (func((segments), segment_index, base_key, base_value, &feature_key)) { \
-    FeatureValue v; \
-    DCHECK(v.IsValid()); \
-    if (force_insert) { \
-      storage_->Insert(feature_key, reinterpret_cast<const char *>(&v)); \
-    } else { \
-      storage_->TryInsert(feature_key, reinterpret_cast<const char *>(&v)); \
-    } \
+    InsertFeature(feature_key, force_insert); \
   } \
 } while (0)
 
 #define FETCH_FEATURE(func, base_key, base_value, weight)                    \
   do {                                                                       \
     if (func(segments, segment_index, base_key, base_value, &feature_key)) { \
-      const FeatureValue *v = reinterpret_cast<const FeatureValue *>(        \
-          storage_->Lookup(feature_key, &last_access_time_result));          \
-      if (v != NULL && v->IsValid()) {                                       \
+      if (LookupFeature(feature_key, &last_access_time_result)) {            \
         *score = std::max(*score, weight);                                   \
         *last_access_time =                                                  \
             std::max(*last_access_time, last_access_time_result);            \
@@ -554,6 +552,71 @@ do { \
     }                                                                        \
   } while (0)
 
+void UserSegmentHistoryRewriter::EnsureFeatureCache() const {
+  if (feature_cache_valid_) {
+    return;
+  }
+  feature_cache_.clear();
+  feature_cache_.reserve(storage_->used_size());
+  uint64 fp = 0;
+  uint32 last_access_time = 0;
+  string value;
+  for (size_t i = 0; i < storage_->used_size(); ++i) {
+    storage_->Read(i, &fp, &value, &last_access_time);
+    const FeatureValue *v =
+        reinterpret_cast<const FeatureValue *>(value.data());
+    // Trigger keys (KeyTriggerValue) stay out of the index; they are
+    // looked up per segment in ShouldRewrite(), not per candidate.
+    if (v->IsValid()) {
+      feature_cache_[fp] = last_access_time;
+    }
+  }
+  feature_cache_valid_ = true;
+}
+
+bool UserSegmentHistoryRewriter::LookupFeature(
+    const string &feature_key, uint32 *last_access_time) const {
+  EnsureFeatureCache();
+  const std::unordered_map<uint64, uint32>::const_iterator it =
+      feature_cache_.find(storage_->GetFingerprint(feature_key));
+  if (it == feature_cache_.end()) {
+    return false;
+  }
+  *last_access_time = it->second;
+  return true;
+}
+
+void UserSegmentHistoryRewriter::InsertFeature(const string &feature_key,
+                                               bool force_insert) {
+  FeatureValue v;
+  DCHECK(v.IsValid());
+  if (feature_cache_valid_ && force_insert &&
+      storage_->used_size() >= storage_->size() &&
+      storage_->Lookup(feature_key) == NULL) {
+    // Inserting a new key into a full storage evicts the oldest entry,
+    // which cannot be observed from here.  Drop the index and let the
+    // next Rewrite() rebuild it instead of letting it drift.
+    feature_cache_valid_ = false;
+  }
+  if (force_insert) {
+    storage_->Insert(feature_key, reinterpret_cast<const char *>(&v));
+  } else {
+    storage_->TryInsert(feature_key, reinterpret_cast<const char *>(&v));
+  }
+  if (!feature_cache_valid_) {
+    return;
+  }
+  // Mirror the mutation so that the index stays in sync without a
+  // rebuild.  TryInsert() only refreshes existing entries, so consult
+  // the storage for the result instead of assuming an insertion.
+  uint32 last_access_time = 0;
+  const FeatureValue *stored = reinterpret_cast<const FeatureValue *>(
+      storage_->Lookup(feature_key, &last_access_time));
+  if (stored != NULL && stored->IsValid()) {
+    feature_cache_[storage_->GetFingerprint(feature_key)] = last_access_time;
+  }
+}
+
 bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
                                           size_t segment_index,
                                           int candidate_index,
@@ -661,17 +724,13 @@ void UserSegmentHistoryRewriter::RememberNumberPreference(
     // This problem is solved by workaround on lookup.
     string default_feature_key;
     GetFeatureN(NumberUtil::NumberString::DEFAULT_STYLE, &default_feature_key);
-    FeatureValue v;
-    DCHECK(v.IsValid());
-    storage_->Insert(default_feature_key, reinterpret_cast<const char *>(&v));
+    InsertFeature(default_feature_key, true);
   }
 
   string feature_key;
   GetFeatureN(candidate.style, &feature_key);
-  FeatureValue v;
-  DCHECK(v.IsValid());
   // Always insert for numbers
-  storage_->Insert(feature_key, reinterpret_cast<const char *>(&v));
+  InsertFeature(feature_key, true);
 }
 
 void UserSegmentHistoryRewriter::RememberFirstCandidate(
@@ -821,6 +880,9 @@ void UserSegmentHistoryRewriter::Finish(const ConversionRequest &request,
 }
 
 bool UserSegmentHistoryRewriter::Reload() {
+  feature_cache_.clear();
+  feature_cache_valid_ = false;
+
   const string filename = ConfigFileStream::GetFileName(kFileName);
   if (!storage_->OpenOrCreate(filename.c_str(),
                               kValueSize, kLRUSize, kSeedValue)) {
@@ -838,6 +900,11 @@ bool UserSegmentHistoryRewriter::Reload() {
     FileUtil::Unlink(merge_pending_file);
   }
 
+  if (FLAGS_user_segment_history_write_behind &&
+      !storage_->EnableWriteBehind()) {
+    LOG(WARNING) << "cannot enable write-behind mode for " << filename;
+  }
+
   return true;
 }
 
@@ -1027,6 +1094,8 @@ void UserSegmentHistoryRewriter::Clear() {
     VLOG(1) << "Clearing user segment data";
     storage_->Clear();
   }
+  feature_cache_.clear();
+  feature_cache_valid_ = false;
 }
 
 bool UserSegmentHistoryRewriter::IsPunctuation(
@@ -32,6 +32,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "converter/segments.h"
@@ -61,6 +62,11 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
 
   virtual void Finish(const ConversionRequest &request, Segments *segments);
 
+  // Finish() only reads the segments and the request/config protos and
+  // writes to the rewriter's own storage, so learning can run after the
+  // commit has returned to the client; see MergerRewriter::Finish().
+  virtual bool defers_finish() const { return true; }
+
   virtual bool Reload();
 
   virtual void Clear();
@@ -97,10 +103,28 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
   bool SortCandidates(const std::vector<ScoreType> &sorted_scores,
                       Segment *segment) const;
 
+  // Rebuilds |feature_cache_| from |storage_| unless it is up to date.
+  void EnsureFeatureCache() const;
+  // Returns true if |feature_key| is recorded as a feature entry, with
+  // its last access time.  Probes the aggregated in-memory index
+  // instead of the storage; see EnsureFeatureCache().
+  bool LookupFeature(const string &feature_key,
+                     uint32 *last_access_time) const;
+  // Inserts a feature entry into |storage_| and keeps |feature_cache_|
+  // in sync.
+  void InsertFeature(const string &feature_key, bool force_insert);
 
   std::unique_ptr<storage::LRUStorage> storage_;
   const dictionary::POSMatcher *pos_matcher_;
   const dictionary::PosGroup *pos_group_;
+
+  // Aggregated index of the feature entries in |storage_|, keyed by the
+  // storage fingerprint.  GetScore() probes up to 17 features per
+  // candidate; with this index each probe is a single hash map lookup
+  // instead of a key hash plus a tree walk in the storage.  Rebuilt
+  // lazily and updated on Finish(); see EnsureFeatureCache().
+  mutable std::unordered_map<uint64, uint32> feature_cache_;
+  mutable bool feature_cache_valid_;
 };
 
 }  // namespace mozc
@@ -40,6 +40,7 @@
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
 #include "request/conversion_request.h"
+#include "rewriter/annotation_pool.h"
 
 using mozc::config::CharacterFormManager;
 using mozc::dictionary::POSMatcher;
@@ -108,6 +109,22 @@ bool HasCharacterFormDescription(const string &value) {
   return true;
 }
 
+// Return true if |value| may have an alternative character form.
+// Hiragana and kanji have no half/full width counterpart, so
+// CharacterFormManager::ConvertConversionStringWithAlternative() can
+// never rewrite a value consisting only of them.  Such values are the
+// bulk of the candidate list, and this check rejects them without the
+// string conversions and allocations of GenerateAlternatives().
+bool MayHaveVariants(const string &value) {
+  for (ConstChar32Iterator iter(value); !iter.Done(); iter.Next()) {
+    const Util::ScriptType type = Util::GetScriptType(iter.Get());
+    if (type != Util::HIRAGANA && type != Util::KANJI) {
+      return true;
+    }
+  }
+  return false;
+}
+
 VariantsRewriter::VariantsRewriter(const POSMatcher pos_matcher)
     : pos_matcher_(pos_matcher) {}
 
@@ -199,37 +216,66 @@ void VariantsRewriter::SetDescription(const POSMatcher &pos_matcher,
     }
   }
 
-  // If candidate already has a description, clear it.
-  // Currently, character_form_message is treated as a "default"
-  // description.
-  if (!candidate->description.empty()) {
-    character_form_message = StringPiece();
-  }
-
-  string description;
-  // full/half char description
+  // full/half char annotation atom
+  StringPiece form_message;
   if (description_type & FULL_HALF_WIDTH) {
     const Util::FormType form = Util::GetFormType(candidate->value);
     switch (form) {
       case Util::FULL_WIDTH:
-        // description = "[全]";
-        description = kFullWidth;
+        // form_message = "[全]";
+        form_message = StringPiece(kFullWidth);
         break;
       case Util::HALF_WIDTH:
-        // description = "[半]";
-        description = kHalfWidth;
+        // form_message = "[半]";
+        form_message = StringPiece(kHalfWidth);
         break;
       default:
         break;
     }
   } else if (description_type & FULL_WIDTH) {
-    // description = "[全]";
-    description = kFullWidth;
+    // form_message = "[全]";
+    form_message = StringPiece(kFullWidth);
   } else if (description_type & HALF_WIDTH) {
-    // description = "[半]";
-    description = kHalfWidth;
+    // form_message = "[半]";
+    form_message = StringPiece(kHalfWidth);
   }
 
+  const bool has_main_message =
+      candidate->value == "\\" || candidate->value == "＼" ||
+      candidate->value == "¥" || candidate->value == "￥";
+  const bool is_platform_dependent =
+      (description_type & PLATFORM_DEPENDENT_CHARACTER) &&
+      Util::GetCharacterSet(candidate->value) >= Util::JISX0212;
+  const bool is_zipcode = (description_type & ZIPCODE) &&
+                          pos_matcher.IsZipcode(candidate->lid) &&
+                          candidate->lid == candidate->rid;
+  const bool is_spelling_correction =
+      (description_type & SPELLING_CORRECTION) &&
+      (candidate->attributes & Segment::Candidate::SPELLING_CORRECTION);
+
+  // Fast path for the overwhelmingly common case: the description is
+  // composed purely of annotation atoms, so take the composed form from
+  // the interning pool instead of building the same short string per
+  // candidate.  The operands are the static constants above, as
+  // InternSeparated() requires.
+  if (candidate->description.empty() && !has_main_message &&
+      !is_platform_dependent && !is_zipcode && !is_spelling_correction) {
+    candidate->description =
+        AnnotationPool::InternSeparated(form_message, character_form_message);
+    candidate->attributes |= Segment::Candidate::NO_EXTRA_DESCRIPTION;
+    return;
+  }
+
+  // If candidate already has a description, clear it.
+  // Currently, character_form_message is treated as a "default"
+  // description.
+  if (!candidate->description.empty()) {
+    character_form_message = StringPiece();
+  }
+
+  string description;
+  form_message.CopyToString(&description);
+
   // add character_form_message
   AppendString(character_form_message, &description);
 
@@ -250,17 +296,14 @@ void VariantsRewriter::SetDescription(const POSMatcher &pos_matcher,
   }
 
   // Platform dependent char description
-  if (description_type & PLATFORM_DEPENDENT_CHARACTER &&
-      Util::GetCharacterSet(candidate->value) >= Util::JISX0212) {
+  if (is_platform_dependent) {
     AppendString(kPlatformDependent, &description);
   }
 
   // The follwoing description tries to overwrite existing description.
   // TODO(taku): reconsider this behavior.
   // Zipcode description
-  if ((description_type & ZIPCODE) &&
-      pos_matcher.IsZipcode(candidate->lid) &&
-      candidate->lid == candidate->rid) {
+  if (is_zipcode) {
     description = candidate->content_key;
     // Append default description because it may contain extra description.
     AppendString(candidate->description, &description);
@@ -269,8 +312,7 @@ void VariantsRewriter::SetDescription(const POSMatcher &pos_matcher,
   // The follwoing description tries to overwrite existing description.
   // TODO(taku): reconsider this behavior.
   // Spelling Correction description
-  if ((description_type & SPELLING_CORRECTION) &&
-      (candidate->attributes & Segment::Candidate::SPELLING_CORRECTION)) {
+  if (is_spelling_correction) {
     description = kDidYouMean;
     // Add prefix to distinguish this candidate.
     candidate->prefix = "→ ";
@@ -323,6 +365,11 @@ bool VariantsRewriter::RewriteSegment(RewriteType type, Segment *seg) const {
       continue;
     }
 
+    if (!MayHaveVariants(original_candidate->value)) {
+      SetDescriptionForCandidate(pos_matcher_, original_candidate);
+      continue;
+    }
+
     if (!GenerateAlternatives(*original_candidate,
                               &default_value,
                               &alternative_value,
@@ -43,6 +43,10 @@ class ZipcodeRewriter : public RewriterInterface  {
   explicit ZipcodeRewriter(const dictionary::POSMatcher *pos_matcher);
   virtual ~ZipcodeRewriter();
 
+  virtual uint32 triggers() const {
+    return SINGLE_CONVERSION_SEGMENT_TRIGGER;
+  }
+
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
 
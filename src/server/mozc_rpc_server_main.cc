@@ -41,16 +41,22 @@ using ssize_t = SSIZE_T;
 #include <unistd.h>
 #endif  // OS_WIN
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 #include <memory>
+#include <queue>
 #include <string>
 #include <vector>
 
+#include "base/cpu_affinity.h"
 #include "base/flags.h"
 #include "base/init_mozc.h"
+#include "base/mutex.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
+#include "base/thread.h"
+#include "base/unnamed_event.h"
 #include "engine/engine_factory.h"
 #include "protocol/commands.pb.h"
 #include "session/random_keyevents_generator.h"
@@ -63,6 +69,13 @@ DEFINE_bool(client, false, "client mode");
 DEFINE_int32(client_test_size, 100, "client test size");
 DEFINE_int32(port, 8000, "port of RPC server");
 DEFINE_int32(rpc_timeout, 60000, "timeout");
+DEFINE_int32(rpc_workers, 4, "number of worker threads handling connections");
+DEFINE_string(worker_affinity, "",
+              "taskset style CPU list (e.g. \"0-3,8\") the worker threads "
+              "are pinned to.  On multi-socket machines pin the workers to "
+              "the socket whose NUMA node holds the dictionary pages; "
+              "start the server under numactl to place or interleave "
+              "those pages.  Empty means no pinning.");
 DEFINE_string(user_profile_directory, "", "user profile directory");
 
 namespace mozc {
@@ -73,6 +86,13 @@ const size_t kMaxRequestSize = 32 * 32 * 8192;
 const size_t kMaxOutputSize  = 32 * 32 * 8192;
 const int    kInvalidSocket  = -1;
 
+// Backstop period for waits on the connection queue event.  An
+// UnnamedEvent stores at most one pending notification, so the burst of
+// notifications from the destructor can leave some workers unsignaled;
+// the timeout makes them re-check the queue instead of sleeping
+// forever.  Same pattern as base/thread_pool.cc.
+const int kQueueEventTimeoutMSec = 100;
+
 // TODO(taku): timeout should be handled.
 bool Recv(int socket, char *buf,
           size_t buf_size, int timeout) {
@@ -163,9 +183,25 @@ class RPCServer {
     CHECK_NE(server_socket_, 0);
 
     handler_->AddObserver(Singleton<session::SessionUsageObserver>::get());
+
+    const int num_workers = std::max(1, FLAGS_rpc_workers);
+    for (int i = 0; i < num_workers; ++i) {
+      workers_.push_back(std::unique_ptr<Worker>(new Worker(this)));
+      workers_.back()->Start("RPCServerWorker");
+    }
   }
 
   ~RPCServer() {
+    {
+      scoped_lock l(&queue_mutex_);
+      terminated_ = true;
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      queue_event_.Notify();
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      workers_[i]->Join();
+    }
     CloseSocket(server_socket_);
     server_socket_ = kInvalidSocket;
   }
@@ -181,60 +217,132 @@ class RPCServer {
         continue;
       }
 
-      uint32 request_size = 0;
-      // Receive the size of data.
-      if (!Recv(client_socket, reinterpret_cast<char *>(&request_size),
-                sizeof(request_size), FLAGS_rpc_timeout)) {
-        LOG(ERROR) << "Cannot receive request_size header.";
-        CloseSocket(client_socket);
-        continue;
+      // Hand the connection over to a worker so that a client which is
+      // slow to send its request or read its reply does not block the
+      // accept loop and the other clients.
+      {
+        scoped_lock l(&queue_mutex_);
+        client_queue_.push(client_socket);
       }
-      request_size = ntohl(request_size);
-      CHECK_GT(request_size, 0);
-      CHECK_LT(request_size, kMaxRequestSize);
-
-      // Receive the body of serialized protobuf.
-      std::unique_ptr<char[]> request_str(new char[request_size]);
-      if (!Recv(client_socket,
-                request_str.get(), request_size, FLAGS_rpc_timeout)) {
-        LOG(ERROR) << "cannot receive body of request.";
-        CloseSocket(client_socket);
-        continue;
+      queue_event_.Notify();
+    }
+  }
+
+ private:
+  class Worker : public Thread {
+   public:
+    explicit Worker(RPCServer *server) : server_(server) {
+      SetJoinable(true);
+    }
+    virtual void Run() {
+      if (!FLAGS_worker_affinity.empty()) {
+        std::vector<int> cpus;
+        if (CpuAffinity::ParseCpuList(FLAGS_worker_affinity, &cpus) &&
+            CpuAffinity::SetCurrentThreadAffinity(cpus)) {
+          VLOG(1) << "Worker pinned to CPUs " << FLAGS_worker_affinity;
+        } else {
+          LOG(WARNING) << "Cannot apply --worker_affinity="
+                       << FLAGS_worker_affinity;
+        }
       }
+      server_->WorkerLoop();
+    }
+
+   private:
+    RPCServer *server_;
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+  };
 
-      commands::Command command;
-      if (!command.mutable_input()->ParseFromArray(request_str.get(),
-                                                   request_size)) {
-        LOG(ERROR) << "ParseFromArray failed";
-        CloseSocket(client_socket);
+  void WorkerLoop() {
+    while (true) {
+      int client_socket = kInvalidSocket;
+      {
+        scoped_lock l(&queue_mutex_);
+        if (terminated_ && client_queue_.empty()) {
+          return;
+        }
+        if (!client_queue_.empty()) {
+          client_socket = client_queue_.front();
+          client_queue_.pop();
+        }
+      }
+      if (client_socket == kInvalidSocket) {
+        queue_event_.Wait(kQueueEventTimeoutMSec);
         continue;
       }
+      HandleConnection(client_socket);
+    }
+  }
 
-      CHECK(handler_->EvalCommand(&command));
+  void HandleConnection(int client_socket) {
+    uint32 request_size = 0;
+    // Receive the size of data.
+    if (!Recv(client_socket, reinterpret_cast<char *>(&request_size),
+              sizeof(request_size), FLAGS_rpc_timeout)) {
+      LOG(ERROR) << "Cannot receive request_size header.";
+      CloseSocket(client_socket);
+      return;
+    }
+    request_size = ntohl(request_size);
+    CHECK_GT(request_size, 0);
+    CHECK_LT(request_size, kMaxRequestSize);
 
-      string output_str;
-      // Return the result.
-      CHECK(command.output().SerializeToString(&output_str));
+    // Receive the body of serialized protobuf.
+    std::unique_ptr<char[]> request_str(new char[request_size]);
+    if (!Recv(client_socket,
+              request_str.get(), request_size, FLAGS_rpc_timeout)) {
+      LOG(ERROR) << "cannot receive body of request.";
+      CloseSocket(client_socket);
+      return;
+    }
 
-      uint32 output_size = output_str.size();
-      CHECK_GT(output_size, 0);
-      CHECK_LT(output_size, kMaxOutputSize);
-      output_size = htonl(output_size);
+    commands::Command command;
+    if (!command.mutable_input()->ParseFromArray(request_str.get(),
+                                                 request_size)) {
+      LOG(ERROR) << "ParseFromArray failed";
+      CloseSocket(client_socket);
+      return;
+    }
 
-      if (!Send(client_socket, reinterpret_cast<char *>(&output_size),
-                sizeof(output_size), FLAGS_rpc_timeout) ||
-          !Send(client_socket, output_str.data(), output_str.size(),
-                FLAGS_rpc_timeout)) {
-        LOG(ERROR) << "Cannot send reply.";
-      }
+    {
+      // SessionHandler and the engine below it are single-threaded, so
+      // command evaluation is serialized here.  Socket I/O and protobuf
+      // parsing/serialization of the other connections still overlap
+      // with it on the other workers.
+      scoped_lock l(&eval_mutex_);
+      CHECK(handler_->EvalCommand(&command));
+    }
 
-      CloseSocket(client_socket);
+    // Return the result.  Serialize the size header and the body into a
+    // single buffer and write them with one send(); a separate 4-byte
+    // write would travel in its own TCP segment.  The protobuf is
+    // serialized directly into the send buffer, not via a string.
+    const int output_size = command.output().ByteSize();
+    CHECK_GT(output_size, 0);
+    CHECK_LT(static_cast<size_t>(output_size), kMaxOutputSize);
+    const uint32 output_size_be = htonl(static_cast<uint32>(output_size));
+    std::unique_ptr<char[]> output_buf(
+        new char[sizeof(output_size_be) + output_size]);
+    ::memcpy(output_buf.get(), &output_size_be, sizeof(output_size_be));
+    CHECK(command.output().SerializeToArray(
+        output_buf.get() + sizeof(output_size_be), output_size));
+
+    if (!Send(client_socket, output_buf.get(),
+              sizeof(output_size_be) + output_size, FLAGS_rpc_timeout)) {
+      LOG(ERROR) << "Cannot send reply.";
     }
+
+    CloseSocket(client_socket);
   }
 
- private:
   int server_socket_;
   std::unique_ptr<SessionHandler> handler_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::queue<int> client_queue_;
+  Mutex queue_mutex_;
+  Mutex eval_mutex_;
+  UnnamedEvent queue_event_;
+  bool terminated_ = false;
 };
 
 // Standalone RPCClient.
@@ -300,17 +408,20 @@ class RPCClient {
                        res->ai_addr, res->ai_addrlen), 0)
         << "connect failed";
 
-    string request_str;
-    CHECK(input.SerializeToString(&request_str));
-    uint32 request_size = request_str.size();
+    // As on the server side, serialize the size header and the body into
+    // one buffer and write them with a single send().
+    const int request_size = input.ByteSize();
     CHECK_GT(request_size, 0);
-    CHECK_LT(request_size, kMaxRequestSize);
-    request_size = htonl(request_size);
-
-    CHECK(Send(client_socket, reinterpret_cast<char *>(&request_size),
-               sizeof(request_size), FLAGS_rpc_timeout));
-    CHECK(Send(client_socket, request_str.data(), request_str.size(),
-               FLAGS_rpc_timeout));
+    CHECK_LT(static_cast<size_t>(request_size), kMaxRequestSize);
+    const uint32 request_size_be = htonl(static_cast<uint32>(request_size));
+    std::unique_ptr<char[]> request_buf(
+        new char[sizeof(request_size_be) + request_size]);
+    ::memcpy(request_buf.get(), &request_size_be, sizeof(request_size_be));
+    CHECK(input.SerializeToArray(request_buf.get() + sizeof(request_size_be),
+                                 request_size));
+
+    CHECK(Send(client_socket, request_buf.get(),
+               sizeof(request_size_be) + request_size, FLAGS_rpc_timeout));
 
     uint32 output_size = 0;
     CHECK(Recv(client_socket, reinterpret_cast<char *>(&output_size),
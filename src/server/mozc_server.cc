@@ -44,6 +44,7 @@
 #include "base/process_mutex.h"
 #include "base/run_level.h"
 #include "base/singleton.h"
+#include "base/startup_stats.h"
 #include "base/system_util.h"
 #include "base/util.h"
 #include "config/stats_config_util.h"
@@ -107,8 +108,14 @@ int MozcServer::Run() {
   }
 
   {
-    std::unique_ptr<mozc::SessionServer> session_server(
-        new mozc::SessionServer);
+    std::unique_ptr<mozc::SessionServer> session_server;
+    {
+      // Covers engine construction (including dictionary loading,
+      // recorded as sub-phases) and IPC setup.  The result can be
+      // retrieved with the GET_STARTUP_STATS command.
+      mozc::ScopedStartupTimer timer("SessionServer::SessionServer");
+      session_server.reset(new mozc::SessionServer);
+    }
     g_session_server = session_server.get();
     CHECK(g_session_server);
     if (!g_session_server->Connected()) {
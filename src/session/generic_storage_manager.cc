@@ -29,16 +29,19 @@
 
 #include "session/generic_storage_manager.h"
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "base/clock.h"
 #include "base/config_file_stream.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/port.h"
 #include "base/singleton.h"
+#include "storage/cache_budget_manager.h"
 #include "storage/lru_storage.h"
 
 namespace {
@@ -129,17 +132,71 @@ GenericStorageInterface *GenericStorageManagerFactory::GetStorage(
 }
 
 
+// Reports the approximate size of an opened GenericLruStorage to
+// CacheBudgetManager.  A trim closes the storage, dropping its mapping;
+// the next access reopens it from the file.
+class GenericLruStorage::BudgetClient
+    : public storage::CacheBudgetManager::Client {
+ public:
+  explicit BudgetClient(GenericLruStorage *storage) : storage_(storage) {}
+
+  virtual size_t UsedBytes() const {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    return UsedBytesUnlocked();
+  }
+
+  virtual uint64 LastAccessTime() const {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    return storage_->last_access_time_;
+  }
+
+  virtual size_t ReleaseBytes(size_t bytes) {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    const size_t released = UsedBytesUnlocked();
+    storage_->lru_storage_.reset();
+    return released;
+  }
+
+ private:
+  size_t UsedBytesUnlocked() const {
+    const LRUStorage *lru_storage = storage_->lru_storage_.get();
+    if (lru_storage == NULL) {
+      return 0;
+    }
+    // File header (12 bytes) plus fingerprint and timestamp (12 bytes)
+    // per entry.
+    return 12 + (lru_storage->value_size() + 12) * lru_storage->size();
+  }
+
+  GenericLruStorage *storage_;
+};
+
 GenericLruStorage::GenericLruStorage(
     const char *file_name, size_t value_size, size_t size, uint32 seed)
     : file_name_(file_name), value_size_(value_size),
-      size_(size), seed_(seed), value_buffer_(new char[value_size + 1]) {
+      size_(size), seed_(seed), value_buffer_(new char[value_size + 1]),
+      last_access_time_(0), value_view_valid_(false) {
 }
 
 GenericLruStorage::~GenericLruStorage() {
+  if (budget_client_.get() != NULL) {
+    storage::CacheBudgetManager::GetInstance()->Unregister(
+        budget_client_.get());
+  }
 }
 
 bool GenericLruStorage::EnsureStorage() {
-  scoped_lock lock(&g_storage_ensure_mutex);
+  {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    if (!EnsureStorageUnlocked()) {
+      return false;
+    }
+  }
+  RegisterBudgetClient();
+  return true;
+}
+
+bool GenericLruStorage::EnsureStorageUnlocked() {
   if (lru_storage_.get()) {
     // We already have prepared storage.
     return true;
@@ -155,40 +212,139 @@ bool GenericLruStorage::EnsureStorage() {
   return true;
 }
 
-bool GenericLruStorage::Insert(const string &key, const char *value) {
-  if (!EnsureStorage()) {
+bool GenericLruStorage::EnsureValueViewUnlocked() {
+  if (value_view_valid_) {
+    return true;
+  }
+  if (!EnsureStorageUnlocked()) {
     return false;
   }
-  const size_t value_size = strnlen(value, value_size_ + 1);
-  if (value_size > value_size_) {
-    LOG(DFATAL) << "Too long value: [" << value << "] size: " << value_size;
+  if (!lru_storage_->GetAllValues(&value_view_)) {
     return false;
   }
-  // LRUStorage only accepts fixed-length value, so we should allocate enough
-  // memory to avoid illegal access.
-  memcpy(value_buffer_.get(), value, value_size + 1);
-  return lru_storage_->Insert(key, value_buffer_.get());
+  value_view_valid_ = true;
+  return true;
+}
+
+void GenericLruStorage::RegisterBudgetClient() {
+  BudgetClient *client = NULL;
+  {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    if (budget_client_.get() != NULL) {
+      return;
+    }
+    budget_client_.reset(new BudgetClient(this));
+    client = budget_client_.get();
+  }
+  // Register() takes the manager lock, which the manager holds while
+  // calling the client, so it must not be called under the storage mutex.
+  storage::CacheBudgetManager::GetInstance()->Register(
+      "GenericLruStorage:" + file_name_, client);
+}
+
+bool GenericLruStorage::Insert(const string &key, const char *value) {
+  bool result = false;
+  {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    if (!EnsureStorageUnlocked()) {
+      return false;
+    }
+    last_access_time_ = Clock::GetTime();
+    const size_t value_size = strnlen(value, value_size_ + 1);
+    if (value_size > value_size_) {
+      LOG(DFATAL) << "Too long value: [" << value << "] size: " << value_size;
+      return false;
+    }
+    // LRUStorage only accepts fixed-length value, so we should allocate
+    // enough memory to avoid illegal access.
+    memcpy(value_buffer_.get(), value, value_size + 1);
+    result = lru_storage_->Insert(key, value_buffer_.get());
+    if (result && value_view_valid_) {
+      // Mirror the insertion in the view.  The histories store the
+      // value itself as the key (see SessionHandler::InsertToStorage()),
+      // so deduplicating by value matches the storage's key-based
+      // overwrite, and the oldest entry falls off when the storage is
+      // full.  The view holds the same |value_size_| bytes that
+      // LRUStorage::GetAllValues() would return for this entry.
+      const string value_str(value_buffer_.get(), value_size_);
+      for (std::vector<string>::iterator it = value_view_.begin();
+           it != value_view_.end(); ++it) {
+        if (*it == value_str) {
+          value_view_.erase(it);
+          break;
+        }
+      }
+      value_view_.insert(value_view_.begin(), value_str);
+      if (value_view_.size() > size_) {
+        value_view_.resize(size_);
+      }
+    }
+  }
+  RegisterBudgetClient();
+  return result;
 }
 
 const char *GenericLruStorage::Lookup(const string &key) {
-  if (!EnsureStorage()) {
-    return NULL;
+  const char *result = NULL;
+  {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    if (!EnsureStorageUnlocked()) {
+      return NULL;
+    }
+    last_access_time_ = Clock::GetTime();
+    result = lru_storage_->Lookup(key);
   }
-  return lru_storage_->Lookup(key);
+  RegisterBudgetClient();
+  return result;
 }
 
 bool GenericLruStorage::GetAllValues(std::vector<string> *values) {
-  if (!EnsureStorage()) {
-    return false;
+  bool result = false;
+  {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    last_access_time_ = Clock::GetTime();
+    result = EnsureValueViewUnlocked();
+    if (result) {
+      *values = value_view_;
+    }
   }
-  return lru_storage_->GetAllValues(values);
+  RegisterBudgetClient();
+  return result;
+}
+
+bool GenericLruStorage::GetRecentValues(size_t max_size,
+                                        std::vector<string> *values) {
+  bool result = false;
+  {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    last_access_time_ = Clock::GetTime();
+    result = EnsureValueViewUnlocked();
+    if (result) {
+      values->assign(
+          value_view_.begin(),
+          value_view_.begin() + std::min(max_size, value_view_.size()));
+    }
+  }
+  RegisterBudgetClient();
+  return result;
 }
 
 bool GenericLruStorage::Clear() {
-  if (!EnsureStorage()) {
-    return false;
+  bool result = false;
+  {
+    scoped_lock lock(&g_storage_ensure_mutex);
+    if (!EnsureStorageUnlocked()) {
+      return false;
+    }
+    last_access_time_ = Clock::GetTime();
+    result = lru_storage_->Clear();
+    if (result) {
+      value_view_.clear();
+      value_view_valid_ = true;
+    }
   }
-  return lru_storage_->Clear();
+  RegisterBudgetClient();
+  return result;
 }
 
 }  // namespace mozc
@@ -31,6 +31,7 @@
 #define MOZC_SESSION_GENERIC_STORAGE_MANAGER_H_
 
 #include <memory>
+#include <vector>
 
 #include "base/port.h"
 #include "protocol/commands.pb.h"
@@ -89,6 +90,18 @@ class GenericStorageInterface {
   // Lists all the values.
   // If something goes wrong, returns false.
   virtual bool GetAllValues(std::vector<string> *values) = 0;
+  // Lists at most |max_size| values, newest first.  The default
+  // implementation trims the result of GetAllValues(); subclasses can
+  // provide a cheaper version.
+  virtual bool GetRecentValues(size_t max_size, std::vector<string> *values) {
+    if (!GetAllValues(values)) {
+      return false;
+    }
+    if (values->size() > max_size) {
+      values->resize(max_size);
+    }
+    return true;
+  }
   // Clears all the entries.
   virtual bool Clear() = 0;
 };
@@ -106,11 +119,19 @@ class GenericLruStorage : public GenericStorageInterface {
   // the oldest value is disposed.
   virtual bool Insert(const string &key, const char *value);
 
+  // The returned pointer is valid until the next mutation or until the
+  // cache budget manager trims this storage; copy the value promptly.
   virtual const char *Lookup(const string &key);
 
-  // The order is new to old.
+  // The order is new to old.  Served from the in-memory view (see
+  // |value_view_|); only the first read after construction scans the
+  // underlying file.
   virtual bool GetAllValues(std::vector<string> *values);
 
+  // The order is new to old.  Like GetAllValues(), served from the
+  // in-memory view.
+  virtual bool GetRecentValues(size_t max_size, std::vector<string> *values);
+
   virtual bool Clear();
 
  protected:
@@ -120,6 +141,18 @@ class GenericLruStorage : public GenericStorageInterface {
 
  private:
   friend class GenericLruStorageProxy;
+  class BudgetClient;
+
+  // Opens the storage if not opened yet.  The caller must hold the
+  // storage mutex.
+  bool EnsureStorageUnlocked();
+  // Builds |value_view_| from the storage if it is not valid yet.  The
+  // caller must hold the storage mutex.
+  bool EnsureValueViewUnlocked();
+  // Registers |budget_client_| with CacheBudgetManager on the first open.
+  // Must be called without holding the storage mutex.
+  void RegisterBudgetClient();
+
   std::unique_ptr<mozc::storage::LRUStorage> lru_storage_;
   const string file_name_;
   const size_t value_size_;
@@ -127,6 +160,19 @@ class GenericLruStorage : public GenericStorageInterface {
   const uint32 seed_;
   // Temporary buffer to insert a value into this storage.
   std::unique_ptr<char[]> value_buffer_;
+  // Reports this storage to the cache budget manager; a trim closes the
+  // lazily opened storage, which is reopened on the next access.
+  std::unique_ptr<BudgetClient> budget_client_;
+  // Clock::GetTime() of the latest operation.
+  uint64 last_access_time_;
+  // In-memory view of the stored values, deduplicated and ordered new
+  // to old, i.e. the result of GetAllValues().  Seeded from the file on
+  // the first read and maintained incrementally by Insert() and
+  // Clear() afterwards, so repeated reads do not scan the mmapped
+  // file.  Bounded by |size_| entries, the view stays valid even after
+  // the cache budget manager trims the file mapping.
+  std::vector<string> value_view_;
+  bool value_view_valid_;
 
   DISALLOW_COPY_AND_ASSIGN(GenericLruStorage);
 };
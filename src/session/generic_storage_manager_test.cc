@@ -97,10 +97,49 @@ TEST(GenericLruStorageTest, BasicOperations) {
     EXPECT_EQ(Util::StringPrintf(kPrintFormat, i), values.at(kSize - i));
   }
 
+  // Most recent values only.
+  storage.GetRecentValues(3, &values);
+  EXPECT_EQ(3, values.size());
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(Util::StringPrintf(kPrintFormat, kSize - i), values.at(i));
+  }
+
   // Clean
   storage.Clear();
   storage.GetAllValues(&values);
   EXPECT_TRUE(values.empty());
 }
 
+// Re-inserting an already stored value must move it to the front of the
+// listed order instead of duplicating it.  This is served by the
+// in-memory view maintained by Insert().
+TEST(GenericLruStorageTest, ReinsertKeepsValuesDeduplicated) {
+  const int kValueSize = 4;
+  const int kSize = 4;
+  const string path = mozc::FileUtil::JoinPath(
+      FLAGS_test_tmpdir, "generic_storage_view_test.db");
+
+  GenericLruStorage storage(path.data(), kValueSize, kSize, 456);
+  ASSERT_TRUE(storage.Clear());
+
+  // The histories use the value itself as the key.
+  const char *kValues[] = {"aaaa", "bbbb", "cccc"};
+  for (size_t i = 0; i < arraysize(kValues); ++i) {
+    ASSERT_TRUE(storage.Insert(kValues[i], kValues[i]));
+  }
+  ASSERT_TRUE(storage.Insert(kValues[0], kValues[0]));
+
+  std::vector<string> values;
+  ASSERT_TRUE(storage.GetAllValues(&values));
+  ASSERT_EQ(3, values.size());
+  EXPECT_EQ("aaaa", values[0]);
+  EXPECT_EQ("cccc", values[1]);
+  EXPECT_EQ("bbbb", values[2]);
+
+  ASSERT_TRUE(storage.GetRecentValues(2, &values));
+  ASSERT_EQ(2, values.size());
+  EXPECT_EQ("aaaa", values[0]);
+  EXPECT_EQ("cccc", values[1]);
+}
+
 }  // namespace mozc
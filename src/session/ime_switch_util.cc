@@ -29,11 +29,13 @@
 
 #include "session/ime_switch_util.h"
 
+#include <algorithm>
 #include <set>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/port.h"
 #include "base/singleton.h"
 #include "config/config_handler.h"
@@ -46,22 +48,56 @@ namespace {
 
 class ImeSwitchUtilImpl {
  public:
-  ImeSwitchUtilImpl() {
+  ImeSwitchUtilImpl() : config_fingerprint_(0), keys_bitmap_(0) {
     config::Config config;
     config::ConfigHandler::GetConfig(&config);
     ReloadConfig(config);
   }
 
   bool IsDirectModeCommand(const commands::KeyEvent &key) const {
-    return KeyInfoUtil::ContainsKey(direct_mode_keys_, key);
+    KeyInformation key_info;
+    if (!KeyEventUtil::GetKeyInformation(key, &key_info)) {
+      return false;
+    }
+    // Almost every key typed in direct mode is not a direct mode
+    // command; reject those with one bit test before the binary search.
+    if (!(keys_bitmap_ & KeyBit(key_info))) {
+      return false;
+    }
+    return std::binary_search(direct_mode_keys_.begin(),
+                              direct_mode_keys_.end(), key_info);
   }
 
   void ReloadConfig(const config::Config &config) {
+    // Only the keymap selection and the custom table affect the
+    // extracted keys; skip the keymap re-parse when they are unchanged.
+    const uint64 fingerprint = Hash::FingerprintWithSeed(
+        config.custom_keymap_table(),
+        static_cast<uint32>(config.session_keymap()));
+    if (fingerprint == config_fingerprint_) {
+      return;
+    }
     direct_mode_keys_ = KeyInfoUtil::ExtractSortedDirectModeKeys(config);
+    keys_bitmap_ = 0;
+    for (size_t i = 0; i < direct_mode_keys_.size(); ++i) {
+      keys_bitmap_ |= KeyBit(direct_mode_keys_[i]);
+    }
+    config_fingerprint_ = fingerprint;
   }
 
  private:
+  // Maps a key to its bit in |keys_bitmap_| with a multiplicative hash.
+  static uint64 KeyBit(KeyInformation key_info) {
+    return static_cast<uint64>(1)
+        << ((key_info * 0x9E3779B97F4A7C15ull) >> 58);
+  }
+
   std::vector<KeyInformation> direct_mode_keys_;
+  // Fingerprint of the config fields the keys were extracted from.
+  uint64 config_fingerprint_;
+  // One bit per KeyBit() bucket of |direct_mode_keys_|; a clear bit
+  // proves the key is not in the list.
+  uint64 keys_bitmap_;
 
   DISALLOW_COPY_AND_ASSIGN(ImeSwitchUtilImpl);
 };
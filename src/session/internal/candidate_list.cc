@@ -40,6 +40,7 @@
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "protocol/commands.pb.h"
 
 namespace mozc {
 namespace session {
@@ -120,7 +121,9 @@ CandidateList::CandidateList(const bool rotate)
       candidates_(new std::vector<Candidate *>),
       next_available_id_(0),
       added_candidates_(new std::map<uint64, int>),
-      alternative_ids_(new std::map<int, int>) {
+      alternative_ids_(new std::map<int, int>),
+      cached_page_begin_(0),
+      page_layout_valid_(false) {
 }
 
 CandidateList::~CandidateList() {
@@ -139,6 +142,7 @@ void CandidateList::Clear() {
   next_available_id_ = 0;
   added_candidates_->clear();
   alternative_ids_->clear();
+  InvalidatePageLayout();
 }
 
 const Candidate &CandidateList::GetDeepestFocusedCandidate() const {
@@ -155,6 +159,7 @@ void CandidateList::AddCandidate(const int id, const string &value) {
 void CandidateList::AddCandidateWithAttributes(const int id,
                                                const string &value,
                                                const Attributes attributes) {
+  InvalidatePageLayout();
   if (id >= 0) {
     DCHECK(id >= next_available_id_);
     // If id is not for T13N candidate, update |last_added_id_|.
@@ -192,12 +197,14 @@ void CandidateList::AddSubCandidateList(CandidateList *subcandidate_list) {
   candidates_->push_back(new_candidate);
 
   new_candidate->set_subcandidate_list(subcandidate_list);
+  InvalidatePageLayout();
 }
 
 CandidateList *CandidateList::AllocateSubCandidateList(const bool rotate) {
   Candidate *new_candidate = candidate_pool_->Alloc();
   candidates_->push_back(new_candidate);
 
+  InvalidatePageLayout();
   return new_candidate->allocate_subcandidate_list(rotate);
 }
 
@@ -211,12 +218,35 @@ const string &CandidateList::name() const {
 
 void CandidateList::set_page_size(const size_t page_size) {
   page_size_ = page_size;
+  InvalidatePageLayout();
 }
 
 size_t CandidateList::page_size() const {
   return page_size_;
 }
 
+const commands::Candidates *CandidateList::cached_page_layout(
+    const size_t page_begin) const {
+  if (!page_layout_valid_ || cached_page_begin_ != page_begin) {
+    return nullptr;
+  }
+  return cached_page_layout_.get();
+}
+
+void CandidateList::set_cached_page_layout(
+    const size_t page_begin, const commands::Candidates &layout) const {
+  if (cached_page_layout_ == nullptr) {
+    cached_page_layout_.reset(new commands::Candidates);
+  }
+  cached_page_layout_->CopyFrom(layout);
+  cached_page_begin_ = page_begin;
+  page_layout_valid_ = true;
+}
+
+void CandidateList::InvalidatePageLayout() {
+  page_layout_valid_ = false;
+}
+
 size_t CandidateList::size() const {
   return candidates_->size();
 }
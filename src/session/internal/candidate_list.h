@@ -43,6 +43,10 @@ namespace mozc {
 
 template <class T> class ObjectPool;
 
+namespace commands {
+class Candidates;
+}  // namespace commands
+
 namespace session {
 class CandidateList;  // This is fully declared at the bottom.
 
@@ -143,6 +147,20 @@ class CandidateList {
   // page.  This is a function for shortcut key operation.
   bool MoveToPageIndex(size_t index);
 
+  // Page layout cache used by SessionOutput::FillCandidates.  The cached
+  // proto holds the rendered rows of the page starting at |page_begin|.
+  // Focus moves within a page keep the cache; structural edits
+  // (Clear, AddCandidate, set_page_size, ...) invalidate it, and a page
+  // change simply misses because the begin index differs.
+  //
+  // Returns the cached rows for the page starting at |page_begin|, or
+  // nullptr on a cache miss.
+  const commands::Candidates *cached_page_layout(size_t page_begin) const;
+  // Stores the rendered rows of the page starting at |page_begin|.
+  void set_cached_page_layout(size_t page_begin,
+                              const commands::Candidates &layout) const;
+  void InvalidatePageLayout();
+
  private:
   CandidateList *mutable_focused_subcandidate_list();
 
@@ -170,6 +188,12 @@ class CandidateList {
   // these ids, they should be converted with this map.
   std::unique_ptr<std::map<int, int>> alternative_ids_;
 
+  // Rendered rows of one candidate page; see cached_page_layout().
+  // Mutable because the cache is maintained while rendering a const list.
+  mutable std::unique_ptr<commands::Candidates> cached_page_layout_;
+  mutable size_t cached_page_begin_;
+  mutable bool page_layout_valid_;
+
   DISALLOW_COPY_AND_ASSIGN(CandidateList);
 };
 
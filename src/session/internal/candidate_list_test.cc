@@ -32,6 +32,7 @@
 #include <memory>
 #include <string>
 
+#include "protocol/commands.pb.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -472,5 +473,42 @@ TEST_F(CandidateListTest, NextAvailableId) {
   EXPECT_EQ(214, sub_sub_list_2_1_->next_available_id());
 }
 
+TEST_F(CandidateListTest, CachedPageLayout) {
+  CandidateList candidate_list(true);
+  candidate_list.AddCandidate(0, "0");
+  candidate_list.AddCandidate(1, "1");
+
+  // Nothing is cached yet.
+  EXPECT_TRUE(candidate_list.cached_page_layout(0) == nullptr);
+
+  commands::Candidates layout;
+  layout.add_candidate()->set_index(0);
+  layout.add_candidate()->set_index(1);
+  candidate_list.set_cached_page_layout(0, layout);
+
+  const commands::Candidates *cached = candidate_list.cached_page_layout(0);
+  ASSERT_TRUE(cached != nullptr);
+  EXPECT_EQ(2, cached->candidate_size());
+
+  // Another page misses.
+  EXPECT_TRUE(candidate_list.cached_page_layout(9) == nullptr);
+
+  // Focus moves within the list keep the cache.
+  candidate_list.MoveNext();
+  EXPECT_TRUE(candidate_list.cached_page_layout(0) != nullptr);
+
+  // Structural edits invalidate it.
+  candidate_list.AddCandidate(2, "2");
+  EXPECT_TRUE(candidate_list.cached_page_layout(0) == nullptr);
+
+  candidate_list.set_cached_page_layout(0, layout);
+  candidate_list.set_page_size(5);
+  EXPECT_TRUE(candidate_list.cached_page_layout(0) == nullptr);
+
+  candidate_list.set_cached_page_layout(0, layout);
+  candidate_list.Clear();
+  EXPECT_TRUE(candidate_list.cached_page_layout(0) == nullptr);
+}
+
 }  // namespace session
 }  // namespace mozc
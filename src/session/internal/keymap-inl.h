@@ -39,6 +39,65 @@
 namespace mozc {
 namespace keymap {
 
+// Layout of the direct-indexed table; see KeyMap<T>::GetTableIndex().
+// The rows are the combinations of the Ctrl/Alt/Shift modifier bits,
+// which KeyEventUtil::GetKeyInformation packs into the lowest bits of
+// the modifier field, and the columns are the ASCII key codes followed
+// by the special keys.
+const uint32 kKeyMapTableModifiers = 8;
+const uint32 kKeyMapTableKeyCodes = 128;
+const uint32 kKeyMapTableWidth =
+    kKeyMapTableKeyCodes + commands::KeyEvent::NUM_SPECIALKEYS;
+const uint32 kKeyMapTableSize = kKeyMapTableModifiers * kKeyMapTableWidth;
+
+template<typename T>
+bool KeyMap<T>::GetTableIndex(KeyInformation key, size_t *index) {
+  // |Modifiers(16bit)|SpecialKey(16bit)|Unicode(32bit)|
+  const uint32 modifiers = static_cast<uint32>(key >> 48);
+  const uint32 special_key = static_cast<uint32>((key >> 32) & 0xffff);
+  const uint32 key_code = static_cast<uint32>(key & 0xffffffff);
+  if (modifiers >= kKeyMapTableModifiers) {
+    return false;
+  }
+  uint32 code;
+  if (special_key != commands::KeyEvent::NO_SPECIALKEY) {
+    if (key_code != 0 ||
+        special_key >= commands::KeyEvent::NUM_SPECIALKEYS) {
+      return false;
+    }
+    code = kKeyMapTableKeyCodes + special_key;
+  } else {
+    if (key_code >= kKeyMapTableKeyCodes) {
+      return false;
+    }
+    code = key_code;
+  }
+  *index = modifiers * kKeyMapTableWidth + code;
+  return true;
+}
+
+template<typename T>
+bool KeyMap<T>::LookupCommand(KeyInformation key,
+                              CommandsType *command) const {
+  size_t index;
+  if (GetTableIndex(key, &index)) {
+    // Representable keys are never stored in |keymap_|, so a miss here
+    // is final.
+    if (table_.empty() || table_[index] < 0) {
+      return false;
+    }
+    *command = static_cast<CommandsType>(table_[index]);
+    return true;
+  }
+
+  typename KeyToCommandMap::const_iterator it = keymap_.find(key);
+  if (it == keymap_.end()) {
+    return false;
+  }
+  *command = it->second;
+  return true;
+}
+
 template<typename T>
 bool KeyMap<T>::GetCommand(const commands::KeyEvent &key_event,
                            CommandsType* command) const {
@@ -51,18 +110,12 @@ bool KeyMap<T>::GetCommand(const commands::KeyEvent &key_event,
     return false;
   }
 
-  typename KeyToCommandMap::const_iterator it = keymap_.find(key);
-  if (it != keymap_.end()) {
-    *command = it->second;
+  if (LookupCommand(key, command)) {
     return true;
   }
 
   if (KeyEventUtil::MaybeGetKeyStub(normalized_key_event, &key)) {
-    it = keymap_.find(key);
-    if (it != keymap_.end()) {
-      *command = it->second;
-      return true;
-    }
+    return LookupCommand(key, command);
   }
 
   return false;
@@ -76,13 +129,22 @@ bool KeyMap<T>::AddRule(const commands::KeyEvent &key_event,
     return false;
   }
 
-  keymap_[key] = command;
+  size_t index;
+  if (GetTableIndex(key, &index)) {
+    if (table_.empty()) {
+      table_.assign(kKeyMapTableSize, -1);
+    }
+    table_[index] = static_cast<int16>(command);
+  } else {
+    keymap_[key] = command;
+  }
   return true;
 }
 
 template<typename T>
 void KeyMap<T>::Clear() {
   keymap_.clear();
+  table_.clear();
 }
 
 }  // namespace keymap
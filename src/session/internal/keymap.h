@@ -36,6 +36,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "composer/key_event_util.h"
 #include "protocol/config.pb.h"
@@ -61,7 +62,23 @@ class KeyMap : public KeyMapInterface<typename T::Commands> {
 
  private:
   typedef std::map<KeyInformation, CommandsType> KeyToCommandMap;
+
+  // Computes the slot of |key| in the direct-indexed table, which covers
+  // Ctrl/Alt/Shift combinations of the ASCII keys and the special keys.
+  // Returns false for keys outside the table (non-ASCII key codes or
+  // other modifier bits); those stay in |keymap_|.
+  static bool GetTableIndex(KeyInformation key, size_t *index);
+
+  // Looks |key| up in the table or, if the key is not representable
+  // there, in |keymap_|.
+  bool LookupCommand(KeyInformation key, CommandsType *command) const;
+
   KeyToCommandMap keymap_;
+
+  // Direct-indexed table; allocated on the first AddRule() of a
+  // representable key, -1 marks an empty slot.  Most key events resolve
+  // here with one indexed load instead of a map lookup.
+  std::vector<int16> table_;
 };
 
 class KeyMapManager {
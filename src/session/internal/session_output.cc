@@ -162,12 +162,31 @@ void SessionOutput::FillCandidates(const Segment &segment,
   candidate_list.GetPageRange(candidate_list.focused_index(),
                               &c_begin, &c_end);
 
-  // Store candidates.
-  for (size_t i = c_begin; i <= c_end; ++i) {
-    commands::Candidates_Candidate *candidate_proto =
-      candidates_proto->add_candidate();
-    candidate_proto->set_index(i);
-    FillCandidate(segment, candidate_list.candidate(i), candidate_proto);
+  // Store candidates.  Rows of the current page are cached in the
+  // candidate list, so moving the focus within a page reuses the layout
+  // computed for the previous update.
+  const commands::Candidates *cached_page =
+      candidate_list.cached_page_layout(c_begin);
+  if (cached_page != nullptr) {
+    candidates_proto->MergeFrom(*cached_page);
+  } else {
+    bool cacheable = true;
+    for (size_t i = c_begin; i <= c_end; ++i) {
+      commands::Candidates_Candidate *candidate_proto =
+        candidates_proto->add_candidate();
+      candidate_proto->set_index(i);
+      FillCandidate(segment, candidate_list.candidate(i), candidate_proto);
+      // A row showing a subcandidate list embeds its focused id, which
+      // changes as the inner focus moves, so such pages are not cached.
+      if (candidate_list.candidate(i).IsSubcandidateList()) {
+        cacheable = false;
+      }
+    }
+    if (cacheable) {
+      commands::Candidates page_rows;
+      page_rows.mutable_candidate()->CopyFrom(candidates_proto->candidate());
+      candidate_list.set_cached_page_layout(c_begin, page_rows);
+    }
   }
 
   // Store subcandidates.
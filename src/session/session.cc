@@ -39,6 +39,7 @@
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
+#include "base/trace.h"
 #include "base/url.h"
 #include "base/util.h"
 #include "base/version.h"
@@ -361,6 +362,9 @@ bool Session::SendCommand(commands::Command *command) {
     case commands::SessionCommand::CONVERT_NEXT_PAGE:
       result = ConvertNextPage(command);
       break;
+    case commands::SessionCommand::GET_CANDIDATE_WORDS_PAGE:
+      result = GetCandidateWordsPage(command);
+      break;
     case commands::SessionCommand::TURN_ON_IME:
       result = MakeSureIMEOn(command);
       break;
@@ -475,6 +479,7 @@ bool Session::TestSendKey(commands::Command *command) {
 }
 
 bool Session::SendKey(commands::Command *command) {
+  ScopedTraceEvent trace_event("Session::SendKey");
   UpdateTime();
   UpdatePreferences(command);
   TransformInput(command->mutable_input());
@@ -1390,6 +1395,18 @@ const commands::ApplicationInfo &Session::application_info() const {
   return context_->application_info();
 }
 
+EngineInterface *Session::engine() {
+  return engine_;
+}
+
+size_t Session::UsedBytes() const {
+  return context_->converter().UsedBytes();
+}
+
+void Session::Compact() {
+  context_->mutable_converter()->Compact();
+}
+
 uint64 Session::create_session_time() const {
   return context_->create_time();
 }
@@ -2562,6 +2579,20 @@ bool Session::ConvertNextPage(commands::Command *command) {
   return true;
 }
 
+bool Session::GetCandidateWordsPage(commands::Command *command) {
+  // Candidate lists are sent while converting and, for suggestions and
+  // predictions, while composing.
+  if (!(context_->state() &
+        (ImeContext::COMPOSITION | ImeContext::CONVERSION))) {
+    return DoNothing(command);
+  }
+  command->mutable_output()->set_consumed(true);
+  context_->mutable_converter()->SetCandidateWordsPageIndex(
+      command->input().command().candidate_words_page_index());
+  Output(command);
+  return true;
+}
+
 bool Session::ConvertPrev(commands::Command *command) {
   command->mutable_output()->set_consumed(true);
   context_->mutable_converter()->CandidatePrev();
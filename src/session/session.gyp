@@ -103,6 +103,7 @@
         '../protocol/protocol.gyp:config_proto',
         '../protocol/protocol.gyp:engine_builder_proto',
         '../protocol/protocol.gyp:user_dictionary_storage_proto',
+        '../storage/storage.gyp:storage',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         'session_base.gyp:generic_storage_manager',
         ':session_watch_dog',
@@ -130,6 +131,17 @@
         '../usage_stats/usage_stats_base.gyp:usage_stats_protocol',
       ],
     },
+    {
+      'target_name': 'session_play_log',
+      'type': 'static_library',
+      'sources': [
+        'session_play_log.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../protocol/protocol.gyp:commands_proto',
+      ],
+    },
     {
       'target_name': 'session_server',
       'type': 'static_library',
@@ -144,6 +156,7 @@
         '../usage_stats/usage_stats.gyp:usage_stats_uploader',
         '../protocol/protocol.gyp:commands_proto',
         'session_handler',
+        'session_play_log',
         'session_usage_observer',
       ],
     },
@@ -171,6 +184,21 @@
         'session_server',
       ],
     },
+    {
+      'target_name': 'session_handler_benchmark_main',
+      'type': 'executable',
+      'sources': [
+        'session_handler_benchmark_main.cc',
+      ],
+      'dependencies': [
+        '../composer/composer.gyp:key_parser',
+        '../engine/engine.gyp:engine_factory',
+        'random_keyevents_generator',
+        'session',
+        'session_handler',
+        'session_play_log',
+      ],
+    },
     {
       'target_name': 'gen_session_stress_test_data',
       'type': 'none',
@@ -156,6 +156,9 @@ class Session : public SessionInterface {
   bool ConvertNextPage(mozc::commands::Command *command);
   // Shows the previous page of candidates.
   bool ConvertPrevPage(mozc::commands::Command *command);
+  // Sends the requested page of the all_candidate_words list without
+  // moving the focus.
+  bool GetCandidateWordsPage(mozc::commands::Command *command);
   bool ConvertCancel(mozc::commands::Command *command);
   bool PredictAndConvert(mozc::commands::Command *command);
   // Note: Commit() also triggers zero query suggestion.
@@ -243,6 +246,8 @@ class Session : public SessionInterface {
 
   virtual void SetTable(const mozc::composer::Table *table);
 
+  virtual mozc::EngineInterface *engine();
+
   // Set client capability for this session.  Used by unittest.
   virtual void set_client_capability(
       const mozc::commands::Capability &capability);
@@ -254,6 +259,13 @@ class Session : public SessionInterface {
   // Get application information
   virtual const mozc::commands::ApplicationInfo &application_info() const;
 
+  // Approximate heap bytes retained by this session's converter.
+  virtual size_t UsedBytes() const;
+
+  // Returns pooled converter capacity to the heap; see
+  // SessionInterface::Compact().
+  virtual void Compact();
+
   // Return the time when this instance was created.
   virtual uint64 create_session_time() const;
 
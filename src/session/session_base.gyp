@@ -83,6 +83,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../base/base.gyp:hash',
         '../config/config.gyp:config_handler',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
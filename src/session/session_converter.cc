@@ -119,7 +119,8 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
       candidate_list_(new CandidateList(true)),
       candidate_list_visible_(false),
       request_(request),
-      client_revision_(0) {
+      client_revision_(0),
+      candidate_words_page_index_(-1) {
   conversion_preferences_.use_history = true;
   conversion_preferences_.max_history_size = kDefaultMaxHistorySize;
   conversion_preferences_.request_suggestion = true;
@@ -142,6 +143,17 @@ const ConversionPreferences &SessionConverter::conversion_preferences() const {
   return conversion_preferences_;
 }
 
+Segments *SessionConverter::mutable_segments() {
+  if (!segments_.unique()) {
+    // |segments_| is shared with an undo snapshot; detach before the
+    // mutation so the snapshot keeps the state it was taken with.
+    std::shared_ptr<Segments> detached(new Segments);
+    detached->CopyFrom(*segments_);
+    segments_.swap(detached);
+  }
+  return segments_.get();
+}
+
 bool SessionConverter::Convert(const composer::Composer &composer) {
   return ConvertWithPreferences(composer, conversion_preferences_);
 }
@@ -151,12 +163,14 @@ bool SessionConverter::ConvertWithPreferences(
     const ConversionPreferences &preferences) {
   DCHECK(CheckState(COMPOSITION | SUGGESTION | CONVERSION));
 
-  segments_->set_request_type(Segments::CONVERSION);
-  SetConversionPreferences(preferences, segments_.get());
+  mutable_segments()->set_request_type(Segments::CONVERSION);
+  SetConversionPreferences(preferences, mutable_segments());
 
-  const ConversionRequest conversion_request(&composer, request_, config_);
+  ConversionRequest conversion_request(&composer, request_, config_);
+  conversion_request.set_conversion_deadline_msec(
+      request_->conversion_deadline_msec());
   if (!converter_->StartConversionForRequest(conversion_request,
-                                             segments_.get())) {
+                                             mutable_segments())) {
     LOG(WARNING) << "StartConversionForRequest() failed";
     ResetState();
     return false;
@@ -342,8 +356,10 @@ bool SessionConverter::SwitchKanaType(const composer::Composer &composer) {
     if (segments_->conversion_segments_size() != 1) {
       string composition;
       GetPreedit(0, segments_->conversion_segments_size(), &composition);
-      const ConversionRequest conversion_request(&composer, request_, config_);
-      converter_->ResizeSegment(segments_.get(),
+      ConversionRequest conversion_request(&composer, request_, config_);
+      conversion_request.set_conversion_deadline_msec(
+          request_->conversion_deadline_msec());
+      converter_->ResizeSegment(mutable_segments(),
                                 conversion_request,
                                 0, Util::CharsLen(composition));
       UpdateCandidateList();
@@ -423,9 +439,11 @@ bool SessionConverter::SuggestWithPreferences(
   }
 
   // Initialize the segments for suggestion.
-  SetConversionPreferences(preferences, segments_.get());
+  SetConversionPreferences(preferences, mutable_segments());
 
   ConversionRequest conversion_request(&composer, request_, config_);
+  conversion_request.set_conversion_deadline_msec(
+      request_->suggestion_deadline_msec());
   const size_t cursor = composer.GetCursor();
   if (cursor == composer.GetLength() || cursor == 0 ||
       !request_->mixed_conversion()) {
@@ -434,13 +452,13 @@ bool SessionConverter::SuggestWithPreferences(
     conversion_request.set_use_actual_converter_for_realtime_conversion(
         FLAGS_use_actual_converter_for_realtime_conversion);
     if (!converter_->StartSuggestionForRequest(conversion_request,
-                                               segments_.get())) {
+                                               mutable_segments())) {
       // TODO(komatsu): Because suggestion is a prefix search, once
       // StartSuggestion returns false, this GetSuggestion always
       // returns false.  Refactor it.
       VLOG(1) << "StartSuggestionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter_->CancelConversion(mutable_segments());
       return false;
     }
   } else {
@@ -452,10 +470,10 @@ bool SessionConverter::SuggestWithPreferences(
     // characters will be used in the below process, which conflicts
     // with *partial* prediction.
     if (!converter_->StartPartialSuggestionForRequest(conversion_request,
-                                                      segments_.get())) {
+                                                      mutable_segments())) {
       VLOG(1) << "StartPartialSuggestionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter_->CancelConversion(mutable_segments());
       return false;
     }
   }
@@ -493,8 +511,8 @@ bool SessionConverter::PredictWithPreferences(
   ResetResult();
 
   // Initialize the segments for prediction
-  segments_->set_request_type(Segments::PREDICTION);
-  SetConversionPreferences(preferences, segments_.get());
+  mutable_segments()->set_request_type(Segments::PREDICTION);
+  SetConversionPreferences(preferences, mutable_segments());
 
   const bool predict_first =
       !CheckState(PREDICTION) && IsEmptySegment(previous_suggestions_);
@@ -506,14 +524,16 @@ bool SessionConverter::PredictWithPreferences(
        candidate_list_->focused() &&
        candidate_list_->focused_index() == candidate_list_->last_index());
 
-  segments_->clear_conversion_segments();
+  mutable_segments()->clear_conversion_segments();
 
   if (predict_expand || predict_first) {
     ConversionRequest conversion_request(&composer, request_, config_);
+    conversion_request.set_conversion_deadline_msec(
+        request_->conversion_deadline_msec());
     conversion_request.set_use_actual_converter_for_realtime_conversion(
         FLAGS_use_actual_converter_for_realtime_conversion);
     if (!converter_->StartPredictionForRequest(conversion_request,
-                                               segments_.get())) {
+                                               mutable_segments())) {
       LOG(WARNING) << "StartPredictionForRequest() failed";
 
       // TODO(komatsu): Perform refactoring after checking the stability test.
@@ -530,7 +550,7 @@ bool SessionConverter::PredictWithPreferences(
   // Merge suggestions and prediction
   string preedit;
   composer.GetQueryForPrediction(&preedit);
-  PrependCandidates(previous_suggestions_, preedit, segments_.get());
+  PrependCandidates(previous_suggestions_, preedit, mutable_segments());
 
   segment_index_ = 0;
   state_ = PREDICTION;
@@ -566,16 +586,18 @@ bool SessionConverter::ExpandSuggestionWithPreferences(
   //     after implemention of partial conversion.
 
   // Initialize the segments for prediction.
-  SetConversionPreferences(preferences, segments_.get());
+  SetConversionPreferences(preferences, mutable_segments());
 
   string preedit;
   composer.GetQueryForPrediction(&preedit);
 
-  // We do not need "segments_->clear_conversion_segments()".
+  // We do not need "mutable_segments()->clear_conversion_segments()".
   // Without this statement we can add additional candidates into
   // existing segments.
 
   ConversionRequest conversion_request(&composer, request_, config_);
+  conversion_request.set_conversion_deadline_msec(
+      request_->suggestion_deadline_msec());
 
   const size_t cursor = composer.GetCursor();
   if (cursor == composer.GetLength() || cursor == 0 ||
@@ -588,25 +610,25 @@ bool SessionConverter::ExpandSuggestionWithPreferences(
     // TODO(matsuzakit or yamaguchi): Add ExpandSuggestion method
     //    to Converter class.
     if (!converter_->StartPredictionForRequest(conversion_request,
-                                               segments_.get())) {
+                                               mutable_segments())) {
       LOG(WARNING) << "StartPredictionForRequest() failed";
     }
   } else {
     // c.f. SuggestWithPreferences for ConversionRequest flags.
     if (!converter_->StartPartialPredictionForRequest(conversion_request,
-                                                      segments_.get())) {
+                                                      mutable_segments())) {
       VLOG(1) << "StartPartialPredictionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter_->CancelConversion(mutable_segments());
       return false;
     }
   }
   // Overwrite the request type to SUGGESTION.
   // Without this logic, a candidate gets focused that is unexpected behavior.
-  segments_->set_request_type(Segments::SUGGESTION);
+  mutable_segments()->set_request_type(Segments::SUGGESTION);
 
   // Merge suggestions and predictions.
-  PrependCandidates(previous_suggestions_, preedit, segments_.get());
+  PrependCandidates(previous_suggestions_, preedit, mutable_segments());
 
   segment_index_ = 0;
   // Call AppendCandidateList instead of UpdateCandidateList because
@@ -648,7 +670,7 @@ void SessionConverter::Cancel() {
   ResetResult();
 
   // Clear segments and keep the context
-  converter_->CancelConversion(segments_.get());
+  converter_->CancelConversion(mutable_segments());
   ResetState();
 }
 
@@ -657,7 +679,7 @@ void SessionConverter::Reset() {
 
   // Even if composition mode, call ResetConversion
   // in order to clear history segments.
-  converter_->ResetConversion(segments_.get());
+  converter_->ResetConversion(mutable_segments());
 
   if (CheckState(COMPOSITION)) {
     return;
@@ -680,13 +702,13 @@ void SessionConverter::Commit(const composer::Composer &composer,
   }
 
   for (size_t i = 0; i < segments_->conversion_segments_size(); ++i) {
-    converter_->CommitSegmentValue(segments_.get(),
+    converter_->CommitSegmentValue(mutable_segments(),
                                    i,
                                    GetCandidateIndexForConverter(i));
   }
   CommitUsageStats(state_, context);
   ConversionRequest conversion_request(&composer, request_, config_);
-  converter_->FinishConversion(conversion_request, segments_.get());
+  converter_->FinishConversion(conversion_request, mutable_segments());
   ResetState();
 }
 
@@ -716,7 +738,7 @@ bool SessionConverter::CommitSuggestionInternal(
       *consumed_key_size < composer.GetLength()) {
     // A candidate was chosen from partial suggestion.
     converter_->CommitPartialSuggestionSegmentValue(
-        segments_.get(),
+        mutable_segments(),
         0,
         GetCandidateIndexForConverter(0),
         Util::SubString(preedit, 0, *consumed_key_size),
@@ -730,12 +752,12 @@ bool SessionConverter::CommitSuggestionInternal(
     DCHECK_GT(segments_->conversion_segments_size(), 0);
   } else {
     // Not partial suggestion so let's reset the state.
-    converter_->CommitSegmentValue(segments_.get(),
+    converter_->CommitSegmentValue(mutable_segments(),
                                    0,
                                    GetCandidateIndexForConverter(0));
     CommitUsageStats(SessionConverterInterface::SUGGESTION, context);
     ConversionRequest conversion_request(&composer, request_, config_);
-    converter_->FinishConversion(conversion_request, segments_.get());
+    converter_->FinishConversion(conversion_request, mutable_segments());
     DCHECK_EQ(0, segments_->conversion_segments_size());
     ResetState();
   }
@@ -817,7 +839,7 @@ void SessionConverter::CommitSegmentsInternal(
   std::vector<size_t> candidate_ids;
   for (size_t i = 0; i < segments_to_commit; ++i) {
     // Get the i-th (0 origin) conversion segment and the selected candidate.
-    Segment *segment = segments_->mutable_conversion_segment(i);
+    Segment *segment = mutable_segments()->mutable_conversion_segment(i);
     if (segment == NULL) {
       LOG(ERROR) << "There is no segment on position " << i;
       return;
@@ -830,7 +852,7 @@ void SessionConverter::CommitSegmentsInternal(
     // Collect candidate's id for each segment.
     candidate_ids.push_back(GetCandidateIndexForConverter(i));
   }
-  converter_->CommitSegments(segments_.get(), candidate_ids);
+  converter_->CommitSegments(mutable_segments(), candidate_ids);
 
   // Commit the [0, segments_to_commit - 1] conversion segment.
   CommitUsageStatsWithSegmentsSize(state_, context, segments_to_commit);
@@ -852,11 +874,11 @@ void SessionConverter::CommitPreedit(const composer::Composer &composer,
   SessionOutput::FillPreeditResult(preedit, result_.get());
 
   ConverterUtil::InitSegmentsFromString(key, normalized_preedit,
-                                        segments_.get());
+                                        mutable_segments());
 
   CommitUsageStats(SessionConverterInterface::COMPOSITION, context);
   ConversionRequest conversion_request(&composer, request_, config_);
-  converter_->FinishConversion(conversion_request, segments_.get());
+  converter_->FinishConversion(conversion_request, mutable_segments());
   ResetState();
 }
 
@@ -877,7 +899,7 @@ void SessionConverter::CommitHead(
 }
 
 void SessionConverter::Revert() {
-  converter_->RevertConversion(segments_.get());
+  converter_->RevertConversion(mutable_segments());
 }
 
 void SessionConverter::SegmentFocusInternal(size_t index) {
@@ -935,8 +957,10 @@ void SessionConverter::ResizeSegmentWidth(const composer::Composer &composer,
   }
   ResetResult();
 
-  const ConversionRequest conversion_request(&composer, request_, config_);
-  if (!converter_->ResizeSegment(segments_.get(),
+  ConversionRequest conversion_request(&composer, request_, config_);
+  conversion_request.set_conversion_deadline_msec(
+      request_->conversion_deadline_msec());
+  if (!converter_->ResizeSegment(mutable_segments(),
                                  conversion_request,
                                  segment_index_, delta)) {
     return;
@@ -1077,11 +1101,107 @@ void SessionConverter::SetCandidateListVisible(bool visible) {
   candidate_list_visible_ = visible;
 }
 
+void SessionConverter::SetCandidateWordsPageIndex(size_t page_index) {
+  candidate_words_page_index_ = static_cast<int>(page_index);
+}
+
+size_t SessionConverter::UsedBytes() const {
+  return segments_->RetainedBytes() +
+         previous_suggestions_.RetainedBytes() +
+         last_all_candidate_words_.capacity();
+}
+
+void SessionConverter::Compact() {
+  if (CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
+    // An active conversion still references the pooled candidates and
+    // the cached lattice.
+    return;
+  }
+  if (!segments_.unique()) {
+    // Shared with an undo snapshot; compacting would also drop the
+    // capacity the snapshot may be restored into.
+    return;
+  }
+  segments_->Compact();
+}
+
 void SessionConverter::PopOutput(
     const composer::Composer &composer, commands::Output *output) {
   FillOutput(composer, output);
   updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
   ResetResult();
+  MaybePaginateCandidateWords(output);
+  MaybeElideAllCandidateWords(output);
+}
+
+void SessionConverter::MaybePaginateCandidateWords(commands::Output *output) {
+  const int page_index = candidate_words_page_index_;
+  candidate_words_page_index_ = -1;  // one-shot; see the declaration
+  const uint32 page_size = request_->candidate_words_page_size();
+  if (page_size == 0 || !output->has_all_candidate_words()) {
+    return;
+  }
+
+  commands::CandidateList *list = output->mutable_all_candidate_words();
+  const uint32 total = list->candidates_size();
+  list->set_total_size(total);
+  if (total <= page_size) {
+    return;
+  }
+
+  uint32 page = 0;
+  if (page_index >= 0) {
+    page = page_index;
+  } else if (list->has_focused_index()) {
+    page = list->focused_index() / page_size;
+  }
+  page = std::min(page, (total - 1) / page_size);
+
+  const uint32 begin = page * page_size;
+  const uint32 end = std::min(begin + page_size, total);
+  list->mutable_candidates()->DeleteSubrange(end, total - end);
+  list->mutable_candidates()->DeleteSubrange(0, begin);
+  list->set_page_start(begin);
+  // Index and focused_index are relative to the sent part; see
+  // candidates.proto.
+  for (int i = 0; i < list->candidates_size(); ++i) {
+    list->mutable_candidates(i)->set_index(i);
+  }
+  if (list->has_focused_index()) {
+    if (list->focused_index() >= begin && list->focused_index() < end) {
+      list->set_focused_index(list->focused_index() - begin);
+    } else {
+      list->clear_focused_index();
+    }
+  }
+}
+
+void SessionConverter::MaybeElideAllCandidateWords(commands::Output *output) {
+  if (!request_->candidate_list_diff()) {
+    return;
+  }
+  if (!output->has_all_candidate_words()) {
+    // This output carries no candidate list, so the client may drop
+    // the list it holds.  Send the full list next time.
+    last_all_candidate_words_.clear();
+    return;
+  }
+
+  // The focused index changes on every cursor move over an otherwise
+  // identical list, which is exactly the case this elision targets, so
+  // it is excluded from the comparison.
+  commands::CandidateList content = output->all_candidate_words();
+  content.clear_focused_index();
+  string serialized;
+  content.SerializeToString(&serialized);
+  if (serialized == last_all_candidate_words_) {
+    // Keep the focused index and the category; drop the candidate
+    // words, which the client already has.
+    output->mutable_all_candidate_words()->clear_candidates();
+    output->set_all_candidate_words_unchanged(true);
+    return;
+  }
+  last_all_candidate_words_.swap(serialized);
 }
 
 namespace {
@@ -1179,7 +1299,11 @@ SessionConverter* SessionConverter::Clone() const {
   // moment it's ok because the current design guarantees that the converter is
   // singleton. However, we should refactor such bad design; see also the
   // comment right above.
-  session_converter->segments_->CopyFrom(*segments_);
+  // Share the Segments with the clone instead of deep-copying it.
+  // Cloning is done for undo snapshots, and either side detaches by
+  // copying on its next mutation (see mutable_segments()), so a
+  // snapshot of even a large conversion is a reference count bump.
+  session_converter->segments_ = segments_;
   session_converter->segment_index_ = segment_index_;
   session_converter->previous_suggestions_.CopyFrom(previous_suggestions_);
   session_converter->conversion_preferences_ = conversion_preferences();
@@ -1214,14 +1338,14 @@ void SessionConverter::ResetState() {
 
 void SessionConverter::SegmentFocus() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  converter_->FocusSegmentValue(segments_.get(),
+  converter_->FocusSegmentValue(mutable_segments(),
                                 segment_index_,
                                 GetCandidateIndexForConverter(segment_index_));
 }
 
 void SessionConverter::SegmentFix() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  converter_->CommitSegmentValue(segments_.get(),
+  converter_->CommitSegmentValue(mutable_segments(),
                                  segment_index_,
                                  GetCandidateIndexForConverter(segment_index_));
 }
@@ -1599,7 +1723,7 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
   if (!context.has_preceding_text()) {
     // In this case, reset history segments when the revision is mismatched.
     if (revision_changed) {
-      converter_->ResetConversion(segments_.get());
+      converter_->ResetConversion(mutable_segments());
     }
     return;
   }
@@ -1608,7 +1732,7 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
   // If preceding text is empty, it is OK to reset the history segments by
   // calling ResetConversion.
   if (preceding_text.empty()) {
-    converter_->ResetConversion(segments_.get());
+    converter_->ResetConversion(mutable_segments());
     return;
   }
 
@@ -1646,7 +1770,7 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
 
   // Here we reconstruct history segments from |preceding_text| regardless
   // of revision mismatch. If it fails the history segments is cleared anyway.
-  converter_->ReconstructHistory(segments_.get(), preceding_text);
+  converter_->ReconstructHistory(mutable_segments(), preceding_text);
 }
 
 void SessionConverter::UpdateSelectedCandidateIndex() {
@@ -231,6 +231,19 @@ class SessionConverter : public SessionConverterInterface {
   // Operation for the candidate list.
   virtual void SetCandidateListVisible(bool visible);
 
+  // Selects the page of the all_candidate_words list sent by the next
+  // output; see SessionCommand::GET_CANDIDATE_WORDS_PAGE.
+  virtual void SetCandidateWordsPageIndex(size_t page_index);
+
+  // Approximate heap bytes retained by the segments and suggestion
+  // buffers.
+  virtual size_t UsedBytes() const;
+
+  // Returns pooled capacity kept for future conversions to the heap.
+  // No-op while a conversion is in progress or while the segments are
+  // shared with an undo snapshot.
+  virtual void Compact();
+
   // Fills protocol buffers and update the internal status.
   virtual void PopOutput(const composer::Composer &composer,
                          commands::Output *output);
@@ -350,6 +363,26 @@ class SessionConverter : public SessionConverterInterface {
 
   bool IsEmptySegment(const Segment &segment) const;
 
+  // Returns |segments_| for mutation.  The Segments may be shared with
+  // the undo snapshot of the session (see Clone()); the first mutation
+  // after a snapshot detaches this converter by copying, so taking a
+  // snapshot itself is only a reference count bump and the deep copy
+  // happens at most once, on the next conversion.
+  Segments *mutable_segments();
+
+  // Drops the candidate words of |output|'s all_candidate_words and
+  // marks the output as unchanged when the client opted in via
+  // Request::candidate_list_diff and the content is identical to the
+  // list sent by the previous output.
+  void MaybeElideAllCandidateWords(commands::Output *output);
+
+  // Trims |output|'s all_candidate_words to one page when the client
+  // opted in via Request::candidate_words_page_size.  The page follows
+  // the focused candidate unless SetCandidateWordsPageIndex() selected
+  // one explicitly; page_start and total_size let the client place the
+  // page in the whole list.
+  void MaybePaginateCandidateWords(commands::Output *output);
+
   // Handles selected_indices for usage stats.
   void InitializeSelectedCandidateIndices();
   void UpdateSelectedCandidateIndex();
@@ -365,7 +398,9 @@ class SessionConverter : public SessionConverterInterface {
   SessionConverterInterface::State state_;
 
   const ConverterInterface *converter_;
-  std::unique_ptr<Segments> segments_;
+  // Shared with the undo snapshot when one exists; mutations must go
+  // through mutable_segments(), which detaches from the snapshot.
+  std::shared_ptr<Segments> segments_;
   size_t segment_index_;
 
   // Previous suggestions to be merged with the current predictions.
@@ -398,6 +433,17 @@ class SessionConverter : public SessionConverterInterface {
   // OnStartComposition for details.
   int32 client_revision_;
 
+  // Serialized content (without the focused index) of the
+  // all_candidate_words list sent by the previous output.  Used by
+  // MaybeElideAllCandidateWords(); empty when the previous output had
+  // no candidate list.
+  string last_all_candidate_words_;
+
+  // Page of the all_candidate_words list requested with
+  // SetCandidateWordsPageIndex() for the next output only, or -1 to
+  // follow the focused candidate.
+  int candidate_words_page_index_;
+
   DISALLOW_COPY_AND_ASSIGN(SessionConverter);
 };
 
@@ -228,6 +228,19 @@ class SessionConverterInterface {
   // Operation for the candidate list.
   virtual void SetCandidateListVisible(bool visible) = 0;
 
+  // Selects the page of the all_candidate_words list sent by the next
+  // output; see SessionCommand::GET_CANDIDATE_WORDS_PAGE.  Effective
+  // only when Request::candidate_words_page_size is set; later outputs
+  // go back to following the focused candidate.
+  virtual void SetCandidateWordsPageIndex(size_t page_index) = 0;
+
+  // Approximate heap bytes retained by the converter's buffers.
+  virtual size_t UsedBytes() const = 0;
+
+  // Returns pooled capacity kept warm for future conversions to the
+  // heap.  Called when the session has been idle for a while.
+  virtual void Compact() = 0;
+
   // Fill protocol buffers and update internal status.
   virtual void PopOutput(
       const composer::Composer &composer, commands::Output *output) = 0;
@@ -112,7 +112,7 @@ class SessionConverterTest : public ::testing::Test {
 
   static void SetSegments(const Segments &src, SessionConverter *converter) {
     CHECK(converter);
-    converter->segments_->CopyFrom(src);
+    converter->mutable_segments()->CopyFrom(src);
   }
 
   static const commands::Result &GetResult(const SessionConverter &converter) {
@@ -2444,6 +2444,122 @@ TEST_F(SessionConverterTest, OutputAllCandidateWords) {
   }
 }
 
+TEST_F(SessionConverterTest, AllCandidateWordsDiff) {
+  request_->set_candidate_list_diff(true);
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  Segments segments;
+  SetKamaboko(&segments);
+  const string kKamabokono = "かまぼこの";
+  const string kInbou = "いんぼう";
+  composer_->InsertCharacterPreedit(kKamabokono + kInbou);
+
+  FillT13Ns(&segments, composer_.get());
+  convertermock_->SetStartConversionForRequest(&segments, true);
+
+  commands::Output output;
+
+  EXPECT_TRUE(converter.Convert(*composer_));
+  {
+    // The first output carries the full list.
+    output.Clear();
+    converter.PopOutput(*composer_, &output);
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_FALSE(output.all_candidate_words_unchanged());
+    EXPECT_EQ(5, output.all_candidate_words().candidates_size());
+    EXPECT_EQ(0, output.all_candidate_words().focused_index());
+  }
+
+  converter.CandidateNext(*composer_);
+  {
+    // Moving the focus does not change the content, so only the
+    // focused index is sent.
+    output.Clear();
+    converter.PopOutput(*composer_, &output);
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_TRUE(output.all_candidate_words_unchanged());
+    EXPECT_EQ(0, output.all_candidate_words().candidates_size());
+    EXPECT_EQ(1, output.all_candidate_words().focused_index());
+    EXPECT_EQ(commands::CONVERSION, output.all_candidate_words().category());
+  }
+
+  converter.SegmentFocusRight();
+  {
+    // The candidate list of the next segment has different content.
+    output.Clear();
+    converter.PopOutput(*composer_, &output);
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_FALSE(output.all_candidate_words_unchanged());
+    EXPECT_EQ(5, output.all_candidate_words().candidates_size());
+  }
+}
+
+TEST_F(SessionConverterTest, AllCandidateWordsPagination) {
+  request_->set_candidate_words_page_size(2);
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  Segments segments;
+  SetKamaboko(&segments);
+  const string kKamabokono = "かまぼこの";
+  const string kInbou = "いんぼう";
+  composer_->InsertCharacterPreedit(kKamabokono + kInbou);
+
+  FillT13Ns(&segments, composer_.get());
+  convertermock_->SetStartConversionForRequest(&segments, true);
+
+  commands::Output output;
+
+  EXPECT_TRUE(converter.Convert(*composer_));
+  {
+    // Only the page containing the focused candidate is sent.
+    // The whole list has 5 entries; see the AllCandidateWords test.
+    output.Clear();
+    converter.PopOutput(*composer_, &output);
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_EQ(2, output.all_candidate_words().candidates_size());
+    EXPECT_EQ(0, output.all_candidate_words().page_start());
+    EXPECT_EQ(5, output.all_candidate_words().total_size());
+    EXPECT_EQ(0, output.all_candidate_words().focused_index());
+  }
+
+  converter.CandidateNext(*composer_);
+  converter.CandidateNext(*composer_);
+  {
+    // The focus moved to the second page; indices are relative to it.
+    output.Clear();
+    converter.PopOutput(*composer_, &output);
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_EQ(2, output.all_candidate_words().candidates_size());
+    EXPECT_EQ(2, output.all_candidate_words().page_start());
+    EXPECT_EQ(0, output.all_candidate_words().focused_index());
+    EXPECT_EQ(0, output.all_candidate_words().candidates(0).index());
+    EXPECT_EQ(1, output.all_candidate_words().candidates(1).index());
+  }
+
+  converter.SetCandidateWordsPageIndex(2);
+  {
+    // An explicitly requested page keeps the focus where it is; the
+    // focused candidate is not on this page, so no index is sent.
+    // The last page may be shorter than the page size.
+    output.Clear();
+    converter.PopOutput(*composer_, &output);
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_EQ(1, output.all_candidate_words().candidates_size());
+    EXPECT_EQ(4, output.all_candidate_words().page_start());
+    EXPECT_EQ(5, output.all_candidate_words().total_size());
+    EXPECT_FALSE(output.all_candidate_words().has_focused_index());
+  }
+
+  {
+    // The page request was one-shot; the next output follows the
+    // focused candidate again.
+    output.Clear();
+    converter.PopOutput(*composer_, &output);
+    ASSERT_TRUE(output.has_all_candidate_words());
+    EXPECT_EQ(2, output.all_candidate_words().page_start());
+  }
+}
+
 TEST_F(SessionConverterTest, GetPreeditAndGetConversion) {
   Segments segments;
 
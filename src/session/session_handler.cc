@@ -44,12 +44,17 @@
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
 #include "base/process.h"
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
+#include "base/scheduler.h"
 #include "base/singleton.h"
+#include "base/startup_stats.h"
 #include "base/stopwatch.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/table.h"
 #include "config/character_form_manager.h"
 #include "config/config_handler.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
 #include "dictionary/user_dictionary_session_handler.h"
 #include "engine/engine_interface.h"
 #include "engine/user_data_manager_interface.h"
@@ -170,6 +175,7 @@ void SessionHandler::Init(
   table_manager_.reset(new composer::TableManager);
   request_.reset(new commands::Request);
   config_.reset(new config::Config);
+  InitCommandHandlers();
 
   if (FLAGS_restricted) {
     VLOG(1) << "Server starts with restricted mode";
@@ -233,6 +239,7 @@ bool SessionHandler::IsAvailable() const {
 bool SessionHandler::StartWatchDog() {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   if (!session_watch_dog_->IsRunning()) {
+    session_watch_dog_->SetLivenessWord(&last_eval_time_);
     session_watch_dog_->Start("WatchDog");
   }
   return session_watch_dog_->IsRunning();
@@ -391,6 +398,12 @@ bool SessionHandler::InsertToStorage(commands::Command *command) {
 
   for (int i = 0; i < storage_entry.value_size(); ++i) {
     const string &value = storage_entry.value(i);
+    // The values come from the client verbatim and are later served
+    // back as candidates; drop broken encodings at this boundary.
+    if (!Util::IsValidUtf8(value)) {
+      LOG(WARNING) << "Skipping invalid UTF-8 value";
+      continue;
+    }
     storage->Insert(value, value.c_str());
   }
 
@@ -461,6 +474,54 @@ bool SessionHandler::ClearStorage(commands::Command *command) {
   return storage->Clear();
 }
 
+void SessionHandler::InitCommandHandlers() {
+  command_handlers_.assign(commands::Input::CommandType_ARRAYSIZE, NULL);
+  command_handlers_[commands::Input::CREATE_SESSION] =
+      &SessionHandler::CreateSession;
+  command_handlers_[commands::Input::DELETE_SESSION] =
+      &SessionHandler::DeleteSession;
+  command_handlers_[commands::Input::SEND_KEY] = &SessionHandler::SendKey;
+  command_handlers_[commands::Input::TEST_SEND_KEY] =
+      &SessionHandler::TestSendKey;
+  command_handlers_[commands::Input::SEND_COMMAND] =
+      &SessionHandler::SendCommand;
+  command_handlers_[commands::Input::SYNC_DATA] = &SessionHandler::SyncData;
+  command_handlers_[commands::Input::CLEAR_USER_HISTORY] =
+      &SessionHandler::ClearUserHistory;
+  command_handlers_[commands::Input::CLEAR_USER_PREDICTION] =
+      &SessionHandler::ClearUserPrediction;
+  command_handlers_[commands::Input::CLEAR_UNUSED_USER_PREDICTION] =
+      &SessionHandler::ClearUnusedUserPrediction;
+  command_handlers_[commands::Input::GET_CONFIG] =
+      &SessionHandler::GetStoredConfig;
+  command_handlers_[commands::Input::SET_CONFIG] =
+      &SessionHandler::SetStoredConfig;
+  command_handlers_[commands::Input::SET_IMPOSED_CONFIG] =
+      &SessionHandler::SetImposedConfig;
+  command_handlers_[commands::Input::SET_REQUEST] = &SessionHandler::SetRequest;
+  command_handlers_[commands::Input::SHUTDOWN] = &SessionHandler::Shutdown;
+  command_handlers_[commands::Input::RELOAD] = &SessionHandler::Reload;
+  command_handlers_[commands::Input::CLEANUP] = &SessionHandler::Cleanup;
+  command_handlers_[commands::Input::INSERT_TO_STORAGE] =
+      &SessionHandler::InsertToStorage;
+  command_handlers_[commands::Input::READ_ALL_FROM_STORAGE] =
+      &SessionHandler::ReadAllFromStorage;
+  command_handlers_[commands::Input::CLEAR_STORAGE] =
+      &SessionHandler::ClearStorage;
+  command_handlers_[commands::Input::SEND_USER_DICTIONARY_COMMAND] =
+      &SessionHandler::SendUserDictionaryCommand;
+  command_handlers_[commands::Input::SEND_ENGINE_RELOAD_REQUEST] =
+      &SessionHandler::SendEngineReloadRequest;
+  command_handlers_[commands::Input::NO_OPERATION] =
+      &SessionHandler::NoOperation;
+  command_handlers_[commands::Input::GET_STARTUP_STATS] =
+      &SessionHandler::GetStartupStats;
+  command_handlers_[commands::Input::DUMP_PERFORMANCE_TRACE] =
+      &SessionHandler::DumpPerformanceTrace;
+  command_handlers_[commands::Input::GET_MEMORY_STATS] =
+      &SessionHandler::GetMemoryStats;
+}
+
 bool SessionHandler::EvalCommand(commands::Command *command) {
   if (!is_available_) {
     LOG(ERROR) << "SessionHandler is not available.";
@@ -472,74 +533,23 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   stopwatch_->Start();
 
   switch (command->input().type()) {
-    case commands::Input::CREATE_SESSION:
-      eval_succeeded = CreateSession(command);
-      break;
-    case commands::Input::DELETE_SESSION:
-      eval_succeeded = DeleteSession(command);
-      break;
     case commands::Input::SEND_KEY:
-      eval_succeeded = SendKey(command);
-      break;
     case commands::Input::TEST_SEND_KEY:
-      eval_succeeded = TestSendKey(command);
-      break;
     case commands::Input::SEND_COMMAND:
-      eval_succeeded = SendCommand(command);
-      break;
-    case commands::Input::SYNC_DATA:
-      eval_succeeded = SyncData(command);
-      break;
-    case commands::Input::CLEAR_USER_HISTORY:
-      eval_succeeded = ClearUserHistory(command);
-      break;
-    case commands::Input::CLEAR_USER_PREDICTION:
-      eval_succeeded = ClearUserPrediction(command);
-      break;
-    case commands::Input::CLEAR_UNUSED_USER_PREDICTION:
-      eval_succeeded = ClearUnusedUserPrediction(command);
-      break;
-    case commands::Input::GET_CONFIG:
-      eval_succeeded = GetStoredConfig(command);
-      break;
-    case commands::Input::SET_CONFIG:
-      eval_succeeded = SetStoredConfig(command);
-      break;
-    case commands::Input::SET_IMPOSED_CONFIG:
-      eval_succeeded = SetImposedConfig(command);
-      break;
-    case commands::Input::SET_REQUEST:
-      eval_succeeded = SetRequest(command);
-      break;
-    case commands::Input::SHUTDOWN:
-      eval_succeeded = Shutdown(command);
-      break;
-    case commands::Input::RELOAD:
-      eval_succeeded = Reload(command);
-      break;
-    case commands::Input::CLEANUP:
-      eval_succeeded = Cleanup(command);
-      break;
-    case commands::Input::INSERT_TO_STORAGE:
-      eval_succeeded = InsertToStorage(command);
-      break;
-    case commands::Input::READ_ALL_FROM_STORAGE:
-      eval_succeeded = ReadAllFromStorage(command);
-      break;
-    case commands::Input::CLEAR_STORAGE:
-      eval_succeeded = ClearStorage(command);
-      break;
-    case commands::Input::SEND_USER_DICTIONARY_COMMAND:
-      eval_succeeded = SendUserDictionaryCommand(command);
-      break;
-    case commands::Input::SEND_ENGINE_RELOAD_REQUEST:
-      eval_succeeded = SendEngineReloadRequest(command);
-      break;
-    case commands::Input::NO_OPERATION:
-      eval_succeeded = NoOperation(command);
+      // The user is typing; defer idle-priority background jobs.
+      Scheduler::NotifyUserActivity();
       break;
     default:
-      eval_succeeded = false;
+      break;
+  }
+
+  const int command_type = command->input().type();
+  if (command_type >= 0 &&
+      command_type < static_cast<int>(command_handlers_.size()) &&
+      command_handlers_[command_type] != NULL) {
+    eval_succeeded = (this->*command_handlers_[command_type])(command);
+  } else {
+    eval_succeeded = false;
   }
 
   if (eval_succeeded) {
@@ -564,6 +574,9 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   UsageStats::UpdateTiming("ElapsedTimeUSec",
                            stopwatch_->GetElapsedMicroseconds());
 
+  // Liveness word for the session watch dog; see StartWatchDog().
+  last_eval_time_ = Clock::GetTime();
+
   return is_available_;
 }
 
@@ -650,23 +663,26 @@ bool SessionHandler::CreateSession(commands::Command *command) {
     session_map_->Erase(oldest_element->key);
     VLOG(1) << "Session is FULL, oldest SessionID "
             << oldest_element->key << " is removed";
+    MaybeRetireOldEngines();
   }
 
-  if (engine_builder_ &&
-      session_map_->Size() == 0 &&
-      engine_builder_->HasResponse()) {
+  if (engine_builder_ && engine_builder_->HasResponse()) {
     auto *response =
         command->mutable_output()->mutable_engine_reload_response();
     engine_builder_->GetResponse(response);
     if (response->status() == EngineReloadResponse::RELOAD_READY) {
-      if (engine_->GetUserDataManager()) {
-        engine_->GetUserDataManager()->Wait();
-      }
-      engine_.reset();
+      // The current engine is not destroyed here: the live sessions
+      // keep converting on it and it is retired once the last of them
+      // is gone, so the swap does not block on in-flight conversions
+      // or on the user data of the old engine.  Only this new session
+      // and the ones created after it use the new engine.
+      old_engines_.push_back(std::move(engine_));
       engine_ = engine_builder_->BuildFromPreparedData();
       LOG_IF(FATAL, !engine_) << "Critical failure in engine replace";
       table_manager_->ClearCaches();
+      engine_is_warm_ = false;
       response->set_status(EngineReloadResponse::RELOADED);
+      MaybeRetireOldEngines();
     }
     engine_builder_->Clear();
   }
@@ -712,9 +728,49 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
   UsageStats::IncrementCount("SessionCreated");
 
+  WarmupEngine();
+
   return true;
 }
 
+void SessionHandler::WarmupEngine() {
+  if (engine_is_warm_) {
+    return;
+  }
+  engine_is_warm_ = true;
+
+  // Construct singletons that modules registered for explicit warmup
+  // (see SingletonWarmupRegistrar) so they don't initialize lazily
+  // inside a later keystroke.
+  SingletonWarmup::WarmupAll();
+
+  // The first conversion after startup pays for all the lazily
+  // initialized conversion structures at once: the suggestion filter,
+  // boundary data, table parsing and the first dictionary page faults.
+  // Run a canned miniature conversion here so the user's first real
+  // keystroke does not.  This is done synchronously because the engine
+  // is single-threaded; a background warmup could race with the first
+  // key event.  Once the structures are initialized the canned
+  // conversion costs no more than a steady-state one.
+  ConverterInterface *converter = engine_->GetConverter();
+  if (converter == NULL) {
+    return;
+  }
+  const char kWarmupKey[] = "あたたかい";
+  {
+    Segments segments;
+    segments.set_user_history_enabled(false);
+    converter->StartConversion(&segments, kWarmupKey);
+  }
+  {
+    // Also touch the suggestion path, which initializes the dictionary
+    // predictor and the suggestion filter.
+    Segments segments;
+    segments.set_user_history_enabled(false);
+    converter->StartSuggestion(&segments, kWarmupKey);
+  }
+}
+
 bool SessionHandler::DeleteSession(commands::Command *command) {
   DeleteSessionID(command->input().id());
   if (engine_->GetUserDataManager()) {
@@ -760,12 +816,31 @@ bool SessionHandler::Cleanup(commands::Command *command) {
   const uint64 last_command_timeout =
       suspend_time + std::max(10, std::min(FLAGS_last_command_timeout, 7200));
 
+  // IsApplicationAlive() costs a system call per session, so instead of
+  // probing every session on every Cleanup, only a rotating window of
+  // kMaxLivenessProbesPerCleanup sessions is probed each pass.  The
+  // timeout checks below are plain arithmetic and still cover every
+  // session; a session of a dead application is collected by the
+  // timeouts at the latest, the probe merely collects it earlier.
+  const size_t kMaxLivenessProbesPerCleanup = 8;
+
+  // Sessions idle for this long but not yet timed out have their
+  // pooled conversion buffers returned to the heap; see
+  // SessionInterface::Compact().
+  const uint64 kCompactSessionAfterIdleSec = 300;
+  const size_t session_count = session_map_->Size();
+
   std::vector<SessionID> remove_ids;
+  size_t index = 0;
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
-       element != NULL; element = element->next) {
+       element != NULL; element = element->next, ++index) {
     session::SessionInterface *session = element->value;
-    if (!IsApplicationAlive(session)) {
+    const bool probe_liveness =
+        session_count <= kMaxLivenessProbesPerCleanup ||
+        ((index + session_count - cleanup_probe_offset_) % session_count) <
+            kMaxLivenessProbesPerCleanup;
+    if (probe_liveness && !IsApplicationAlive(session)) {
       VLOG(2) << "Application is not alive. Removing: " << element->key;
       remove_ids.push_back(element->key);
     } else if (session->last_command_time() == 0) {
@@ -775,13 +850,26 @@ bool SessionHandler::Cleanup(commands::Command *command) {
         remove_ids.push_back(element->key);
       }
     } else {  // some commands are executed already
-      if ((current_time - session->last_command_time()) >=
-          last_command_timeout) {
+      const uint64 idle_sec = current_time - session->last_command_time();
+      if (idle_sec >= last_command_timeout) {
         remove_ids.push_back(element->key);
+      } else if (idle_sec >= kCompactSessionAfterIdleSec) {
+        // The session survives but has been idle long enough that the
+        // pooled conversion buffers are unlikely to be hot; return them
+        // to the heap.  Compact() is cheap when nothing is retained, so
+        // re-running it on later Cleanup passes is fine.
+        session->Compact();
       }
     }
   }
 
+  if (session_count > kMaxLivenessProbesPerCleanup) {
+    cleanup_probe_offset_ =
+        (cleanup_probe_offset_ + kMaxLivenessProbesPerCleanup) % session_count;
+  } else {
+    cleanup_probe_offset_ = 0;
+  }
+
   for (size_t i = 0; i < remove_ids.size(); ++i) {
     DeleteSessionID(remove_ids[i]);
     VLOG(1) << "Session ID " << remove_ids[i] << " is removed by server";
@@ -790,6 +878,11 @@ bool SessionHandler::Cleanup(commands::Command *command) {
   // Sync all data. This is a regression bug fix http://b/3033708
   engine_->GetUserDataManager()->Sync();
 
+  // Surface singletons that initialized lazily after the warmup stage;
+  // deferred to here because it must not run inside a singleton
+  // constructor.
+  SingletonWarmup::LogLazyConstructions();
+
   // timeout is enabled.
   if (FLAGS_timeout > 0 &&
       last_session_empty_time_ != 0 &&
@@ -831,6 +924,44 @@ bool SessionHandler::NoOperation(commands::Command *command) {
   return true;
 }
 
+bool SessionHandler::GetStartupStats(commands::Command *command) {
+  std::vector<StartupStats::Phase> phases;
+  StartupStats::GetPhases(&phases);
+  commands::Output *output = command->mutable_output();
+  for (size_t i = 0; i < phases.size(); ++i) {
+    commands::Output::StartupPhase *phase = output->add_startup_phase();
+    phase->set_name(phases[i].name);
+    phase->set_begin_usec(phases[i].begin_usec);
+    phase->set_duration_usec(phases[i].duration_usec);
+  }
+  return true;
+}
+
+bool SessionHandler::DumpPerformanceTrace(commands::Command *command) {
+  Trace::DumpJson(
+      command->mutable_output()->mutable_performance_trace());
+  return true;
+}
+
+bool SessionHandler::GetMemoryStats(commands::Command *command) {
+  const uint64 current_time = Clock::GetTime();
+  commands::Output *output = command->mutable_output();
+  for (const SessionElement *element = session_map_->Head();
+       element != NULL; element = element->next) {
+    const session::SessionInterface *session = element->value;
+    commands::Output::SessionMemoryEntry *entry =
+        output->add_session_memory();
+    entry->set_session_id(element->key);
+    entry->set_used_bytes(session->UsedBytes());
+    const uint64 last_time = (session->last_command_time() != 0) ?
+        session->last_command_time() : session->create_session_time();
+    if (current_time >= last_time) {
+      entry->set_idle_sec(current_time - last_time);
+    }
+  }
+  return true;
+}
+
 // Create Random Session ID in order to make the session id unpredicable
 SessionID SessionHandler::CreateNewSessionID() {
   SessionID id = 0;
@@ -858,6 +989,8 @@ bool SessionHandler::DeleteSessionID(SessionID id) {
 
   session_map_->Erase(id);   // remove from LRU
 
+  MaybeRetireOldEngines();
+
   // if session gets empty, save the timestamp
   if (last_session_empty_time_ == 0 &&
       session_map_->Size() == 0) {
@@ -866,4 +999,35 @@ bool SessionHandler::DeleteSessionID(SessionID id) {
 
   return true;
 }
+
+void SessionHandler::MaybeRetireOldEngines() {
+  if (old_engines_.empty()) {
+    return;
+  }
+
+  // Collect the engines still pinned by a live session.
+  std::vector<const EngineInterface *> in_use;
+  for (SessionElement *element =
+           const_cast<SessionElement *>(session_map_->Head());
+       element != nullptr; element = element->next) {
+    if (element->value != nullptr) {
+      in_use.push_back(element->value->engine());
+    }
+  }
+
+  for (size_t i = 0; i < old_engines_.size(); ) {
+    if (std::find(in_use.begin(), in_use.end(), old_engines_[i].get()) !=
+        in_use.end()) {
+      ++i;
+      continue;
+    }
+    // Let the asynchronous user data operations of the old engine
+    // finish before its storage goes away.
+    if (old_engines_[i]->GetUserDataManager()) {
+      old_engines_[i]->GetUserDataManager()->Wait();
+    }
+    old_engines_.erase(old_engines_.begin() + i);
+    VLOG(1) << "Replaced engine is retired";
+  }
+}
 }  // namespace mozc
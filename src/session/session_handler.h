@@ -35,6 +35,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "composer/table.h"
@@ -143,10 +144,25 @@ class SessionHandler : public SessionHandlerInterface {
   bool SendUserDictionaryCommand(commands::Command *command);
   bool SendEngineReloadRequest(commands::Command *command);
   bool NoOperation(commands::Command *command);
+  bool GetStartupStats(commands::Command *command);
+  bool DumpPerformanceTrace(commands::Command *command);
+  bool GetMemoryStats(commands::Command *command);
+
+  // Fills |command_handlers_|; see the comment on the member.
+  void InitCommandHandlers();
 
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
+  // Destroys the entries of |old_engines_| which no live session uses
+  // anymore.  Called after an engine swap and after session removals.
+  void MaybeRetireOldEngines();
+
+  // Runs a canned miniature conversion to initialize the lazily
+  // created conversion structures, so that the first real keystroke
+  // does not pay for them.  Effective once per engine instance.
+  void WarmupEngine();
+
   std::unique_ptr<SessionMap> session_map_;
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   std::unique_ptr<SessionWatchDog> session_watch_dog_;
@@ -156,12 +172,25 @@ class SessionHandler : public SessionHandlerInterface {
   // enabling session watch dog for android.
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
   bool is_available_ = false;
+  bool engine_is_warm_ = false;
   uint32 max_session_size_ = 0;
   uint64 last_session_empty_time_ = 0;
   uint64 last_cleanup_time_ = 0;
   uint64 last_create_session_time_ = 0;
+  // Liveness word for the session watch dog: updated with the current
+  // time whenever EvalCommand() finishes, and read by the watch dog
+  // thread without any locking or IPC.
+  volatile uint64 last_eval_time_ = 0;
+  // Start of the window of sessions whose client process is probed in
+  // the next Cleanup(); see the comment there.
+  size_t cleanup_probe_offset_ = 0;
 
   std::unique_ptr<EngineInterface> engine_;
+  // Engines replaced by a reload which are still pinned by sessions
+  // created on them.  Each session keeps converting on the engine it
+  // was created with; a replaced engine is destroyed once the last
+  // such session is gone.  See MaybeRetireOldEngines().
+  std::vector<std::unique_ptr<EngineInterface> > old_engines_;
   std::unique_ptr<EngineBuilderInterface> engine_builder_;
   std::unique_ptr<session::SessionObserverHandler> observer_handler_;
   std::unique_ptr<Stopwatch> stopwatch_;
@@ -171,6 +200,13 @@ class SessionHandler : public SessionHandlerInterface {
   std::unique_ptr<commands::Request> request_;
   std::unique_ptr<config::Config> config_;
 
+  // Dispatch table for EvalCommand(), indexed by
+  // commands::Input::CommandType and filled once in Init().  Command
+  // types without a handler keep a NULL entry and fail the command,
+  // like the default label of the switch this table replaced.
+  typedef bool (SessionHandler::*CommandHandler)(commands::Command *command);
+  std::vector<CommandHandler> command_handlers_;
+
   DISALLOW_COPY_AND_ASSIGN(SessionHandler);
 };
 
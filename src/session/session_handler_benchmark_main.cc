@@ -0,0 +1,536 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// In-process latency benchmark for the session layer.
+//
+// The tool drives SessionHandler directly (no IPC) with deterministic
+// workloads: conversion scenarios built from the stress test sentences,
+// random key sequences from RandomKeyEventsGenerator, and optionally a
+// recorded key script.  Per-command latencies are bucketed (SendKey,
+// Convert, CandidateNext, Commit, ...) and reported as percentiles
+// together with the process memory high-water mark, so the output can be
+// diffed against a stored baseline as a release gate:
+//
+//   session_handler_benchmark_main --update_baseline --baseline=base.txt
+//   ... make changes ...
+//   session_handler_benchmark_main --baseline=base.txt
+//
+// The second invocation exits non-zero if a latency percentile regresses
+// by more than --max_regression_percent against the baseline.
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/number_util.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
+#include "composer/key_parser.h"
+#include "engine/engine_factory.h"
+#include "protocol/commands.pb.h"
+#include "session/random_keyevents_generator.h"
+#include "session/session_handler.h"
+#include "session/session_play_log.h"
+
+DEFINE_uint64(random_seed, 1, "Seed for RandomKeyEventsGenerator. "
+              "Keep the default for reproducible runs.");
+DEFINE_int32(sentences, 200, "Number of test sentences to convert.");
+DEFINE_int32(random_keyevents, 2500,
+             "Number of random key events to replay.");
+DEFINE_string(script, "", "Optional key script to replay: one key per line "
+              "in the KeyParser format, '#' starts a comment line.");
+DEFINE_string(play_log, "", "Optional session play log to replay, as "
+              "recorded by mozc_server with --session_play_log_file.");
+DEFINE_bool(play_log_timing, false,
+            "Reproduce the recorded inter-event delays while replaying "
+            "--play_log instead of replaying as fast as possible.");
+DEFINE_string(baseline, "", "Baseline file to diff against.");
+DEFINE_bool(update_baseline, false,
+            "Write the measured stats to --baseline instead of diffing.");
+DEFINE_double(max_regression_percent, 10.0,
+              "Allowed relative regression per percentile.");
+
+namespace mozc {
+namespace {
+
+// Returns the peak resident set size of this process in kilobytes, or 0
+// where it cannot be obtained.
+uint64 GetMemoryHighWaterKB() {
+#ifdef OS_LINUX
+  InputFileStream status("/proc/self/status");
+  string line;
+  while (std::getline(status, line)) {
+    if (Util::StartsWith(line, "VmHWM:")) {
+      std::vector<StringPiece> fields;
+      Util::SplitStringUsing(line, " \t", &fields);
+      uint64 kb = 0;
+      if (fields.size() >= 2 && NumberUtil::SafeStrToUInt64(fields[1], &kb)) {
+        return kb;
+      }
+    }
+  }
+#endif  // OS_LINUX
+  return 0;
+}
+
+// Latency samples in microseconds, bucketed by command label.
+class LatencyRecorder {
+ public:
+  void Add(const string &label, uint32 usec) {
+    samples_[label].push_back(usec);
+  }
+
+  // Percentile over a sorted copy; |rank| in [0, 100].
+  static uint32 Percentile(std::vector<uint32> *samples, int rank) {
+    if (samples->empty()) {
+      return 0;
+    }
+    std::sort(samples->begin(), samples->end());
+    const size_t index =
+        std::min(samples->size() - 1, samples->size() * rank / 100);
+    return (*samples)[index];
+  }
+
+  // Emits one "label size avg p50 p95 p99 max" line per bucket.
+  void Report(std::map<string, std::vector<uint32> > *stats) {
+    for (std::map<string, std::vector<uint32> >::iterator it =
+             samples_.begin();
+         it != samples_.end(); ++it) {
+      std::vector<uint32> &times = it->second;
+      (*stats)[it->first].push_back(Percentile(&times, 50));
+      (*stats)[it->first].push_back(Percentile(&times, 95));
+      (*stats)[it->first].push_back(Percentile(&times, 99));
+    }
+  }
+
+  const std::map<string, std::vector<uint32> > &samples() const {
+    return samples_;
+  }
+
+ private:
+  std::map<string, std::vector<uint32> > samples_;
+};
+
+// Thin deterministic driver around SessionHandler.
+class BenchmarkClient {
+ public:
+  BenchmarkClient()
+      : handler_(std::unique_ptr<EngineInterface>(EngineFactory::Create())),
+        id_(0) {}
+
+  bool CreateSession() {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::CREATE_SESSION);
+    handler_.EvalCommand(&command);
+    id_ = command.output().id();
+    return id_ != 0;
+  }
+
+  void DeleteSession() {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::DELETE_SESSION);
+    command.mutable_input()->set_id(id_);
+    handler_.EvalCommand(&command);
+  }
+
+  // Sends |key| and records the elapsed time under |label|.
+  void SendKey(const commands::KeyEvent &key, const string &label,
+               LatencyRecorder *recorder, commands::Output *output) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::SEND_KEY);
+    command.mutable_input()->set_id(id_);
+    command.mutable_input()->mutable_key()->CopyFrom(key);
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    handler_.EvalCommand(&command);
+    stopwatch.Stop();
+    recorder->Add(label,
+                  static_cast<uint32>(stopwatch.GetElapsedMicroseconds()));
+    output->CopyFrom(command.output());
+  }
+
+  // Evaluates an arbitrary prepared command (play log replay builds its
+  // own inputs) and returns the elapsed time in microseconds.
+  uint32 EvalRaw(commands::Command *command) {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    handler_.EvalCommand(command);
+    stopwatch.Stop();
+    return static_cast<uint32>(stopwatch.GetElapsedMicroseconds());
+  }
+
+  void Revert() {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+    command.mutable_input()->set_id(id_);
+    command.mutable_input()->mutable_command()->set_type(
+        commands::SessionCommand::REVERT);
+    handler_.EvalCommand(&command);
+  }
+
+ private:
+  SessionHandler handler_;
+  uint64 id_;
+};
+
+// Classifies a key in a conversion scenario into its latency bucket.
+// The first space after composing converts; further spaces cycle
+// candidates; enter commits.
+string ClassifyKey(const commands::KeyEvent &key, bool *converting) {
+  if (key.has_special_key()) {
+    switch (key.special_key()) {
+      case commands::KeyEvent::SPACE:
+        if (!*converting) {
+          *converting = true;
+          return "Convert";
+        }
+        return "CandidateNext";
+      case commands::KeyEvent::DOWN:
+        if (*converting) {
+          return "CandidateNext";
+        }
+        break;
+      case commands::KeyEvent::ENTER:
+        *converting = false;
+        return "Commit";
+      default:
+        break;
+    }
+  }
+  return "SendKey";
+}
+
+// Converts the stress test sentences: type romaji, convert, cycle two
+// candidates, commit.
+void RunConversionScenario(BenchmarkClient *client,
+                           LatencyRecorder *recorder) {
+  size_t size = 0;
+  const char **sentences =
+      session::RandomKeyEventsGenerator::GetTestSentences(&size);
+  CHECK_GT(size, 0);
+  size = std::min(static_cast<size_t>(FLAGS_sentences), size);
+
+  commands::Output output;
+  for (size_t i = 0; i < size; ++i) {
+    string romaji;
+    Util::HiraganaToRomanji(sentences[i], &romaji);
+    std::vector<commands::KeyEvent> keys;
+    for (ConstChar32Iterator iter(romaji); !iter.Done(); iter.Next()) {
+      const char32 ucs4 = iter.Get();
+      if (ucs4 >= static_cast<char32>('a') && ucs4 <= static_cast<char32>('z')) {
+        commands::KeyEvent key;
+        key.set_key_code(static_cast<int>(ucs4));
+        keys.push_back(key);
+      }
+    }
+    if (keys.empty()) {
+      continue;
+    }
+    for (int j = 0; j < 3; ++j) {
+      commands::KeyEvent key;
+      key.set_special_key(commands::KeyEvent::SPACE);
+      keys.push_back(key);
+    }
+    {
+      commands::KeyEvent key;
+      key.set_special_key(commands::KeyEvent::ENTER);
+      keys.push_back(key);
+    }
+
+    bool converting = false;
+    for (size_t j = 0; j < keys.size(); ++j) {
+      client->SendKey(keys[j], ClassifyKey(keys[j], &converting), recorder,
+                      &output);
+    }
+  }
+}
+
+// Replays random key sequences; every event lands in one bucket since the
+// generator mixes commands unpredictably.
+void RunRandomScenario(BenchmarkClient *client, LatencyRecorder *recorder) {
+  session::RandomKeyEventsGenerator::InitSeed(
+      static_cast<uint32>(FLAGS_random_seed));
+  commands::Output output;
+  std::vector<commands::KeyEvent> keys;
+  size_t keyevents_size = 0;
+  while (keyevents_size < static_cast<size_t>(FLAGS_random_keyevents)) {
+    keys.clear();
+    session::RandomKeyEventsGenerator::GenerateSequence(&keys);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      ++keyevents_size;
+      client->SendKey(keys[i], "RandomKey", recorder, &output);
+    }
+  }
+  client->Revert();
+}
+
+// Replays a recorded key script, one key per line in KeyParser format.
+void RunScriptScenario(const string &path, BenchmarkClient *client,
+                       LatencyRecorder *recorder) {
+  InputFileStream input(path.c_str());
+  CHECK(input.good()) << "Cannot open: " << path;
+  commands::Output output;
+  string line;
+  bool converting = false;
+  while (std::getline(input, line)) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    commands::KeyEvent key;
+    if (!KeyParser::ParseKey(line, &key)) {
+      LOG(ERROR) << "Skipping unparsable key: " << line;
+      continue;
+    }
+    client->SendKey(key, ClassifyKey(key, &converting), recorder, &output);
+  }
+}
+
+// Replays a session play log recorded with --session_play_log_file.
+// Recorded session ids belong to the original server process, so each
+// distinct id is remapped to a session created lazily in this process;
+// recorded CREATE_SESSION commands are skipped for the same reason.
+// Latencies are bucketed by command type under a "Log" prefix.
+void RunPlayLogScenario(const string &path, BenchmarkClient *client,
+                        LatencyRecorder *recorder) {
+  session::SessionPlayLogReader reader;
+  CHECK(reader.Open(path)) << "Cannot open play log: " << path;
+
+  std::map<uint64, uint64> session_ids;
+  uint64 prev_timestamp_usec = 0;
+  uint64 timestamp_usec = 0;
+  commands::Input input;
+  while (reader.Next(&timestamp_usec, &input)) {
+    if (FLAGS_play_log_timing && prev_timestamp_usec != 0 &&
+        timestamp_usec > prev_timestamp_usec) {
+      // Idle gaps (window switches, the user walking away) are capped so
+      // a replay never stalls for minutes.
+      Util::Sleep(static_cast<int>(std::min<uint64>(
+          (timestamp_usec - prev_timestamp_usec) / 1000, 1000)));
+    }
+    prev_timestamp_usec = timestamp_usec;
+
+    if (input.type() == commands::Input::CREATE_SESSION) {
+      continue;
+    }
+    commands::Command command;
+    command.mutable_input()->CopyFrom(input);
+    if (input.has_id()) {
+      uint64 &mapped_id = session_ids[input.id()];
+      if (mapped_id == 0) {
+        commands::Command create_command;
+        create_command.mutable_input()->set_type(
+            commands::Input::CREATE_SESSION);
+        client->EvalRaw(&create_command);
+        mapped_id = create_command.output().id();
+        CHECK(mapped_id != 0) << "CreateSession failed during replay";
+      }
+      command.mutable_input()->set_id(mapped_id);
+    }
+    const uint32 elapsed = client->EvalRaw(&command);
+    recorder->Add("Log" + commands::Input::CommandType_Name(input.type()),
+                  elapsed);
+    if (input.type() == commands::Input::DELETE_SESSION && input.has_id()) {
+      session_ids.erase(input.id());
+    }
+  }
+
+  // Recorded sessions without a matching DELETE_SESSION (the server was
+  // still running) are torn down here to keep runs comparable.
+  for (std::map<uint64, uint64>::const_iterator it = session_ids.begin();
+       it != session_ids.end(); ++it) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::DELETE_SESSION);
+    command.mutable_input()->set_id(it->second);
+    client->EvalRaw(&command);
+  }
+}
+
+// Baseline file: one "label p50 p95 p99" line per bucket plus a final
+// "MemoryHighWaterKB value" line.
+void WriteBaseline(const string &path,
+                   const std::map<string, std::vector<uint32> > &stats,
+                   uint64 memory_kb) {
+  OutputFileStream output(path.c_str());
+  CHECK(output.good()) << "Cannot write: " << path;
+  for (std::map<string, std::vector<uint32> >::const_iterator it =
+           stats.begin();
+       it != stats.end(); ++it) {
+    output << it->first;
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      output << " " << it->second[i];
+    }
+    output << std::endl;
+  }
+  output << "MemoryHighWaterKB " << memory_kb << std::endl;
+}
+
+bool ReadBaseline(const string &path,
+                  std::map<string, std::vector<uint32> > *stats,
+                  uint64 *memory_kb) {
+  InputFileStream input(path.c_str());
+  if (!input.good()) {
+    return false;
+  }
+  string line;
+  while (std::getline(input, line)) {
+    std::vector<StringPiece> fields;
+    Util::SplitStringUsing(line, " ", &fields);
+    if (fields.size() < 2) {
+      continue;
+    }
+    if (fields[0] == "MemoryHighWaterKB") {
+      NumberUtil::SafeStrToUInt64(fields[1], memory_kb);
+      continue;
+    }
+    std::vector<uint32> values;
+    for (size_t i = 1; i < fields.size(); ++i) {
+      uint32 value = 0;
+      if (!NumberUtil::SafeStrToUInt32(fields[i], &value)) {
+        return false;
+      }
+      values.push_back(value);
+    }
+    (*stats)[string(fields[0])].swap(values);
+  }
+  return true;
+}
+
+// Returns the number of percentiles exceeding the baseline by more than
+// --max_regression_percent.
+int DiffAgainstBaseline(
+    const std::map<string, std::vector<uint32> > &stats,
+    const std::map<string, std::vector<uint32> > &baseline) {
+  static const char *kPercentileNames[] = { "p50", "p95", "p99" };
+  int regressions = 0;
+  for (std::map<string, std::vector<uint32> >::const_iterator it =
+           stats.begin();
+       it != stats.end(); ++it) {
+    std::map<string, std::vector<uint32> >::const_iterator base =
+        baseline.find(it->first);
+    if (base == baseline.end()) {
+      std::cout << it->first << ": no baseline entry, skipped" << std::endl;
+      continue;
+    }
+    const size_t size = std::min(it->second.size(), base->second.size());
+    for (size_t i = 0; i < size && i < arraysize(kPercentileNames); ++i) {
+      const uint32 current = it->second[i];
+      const uint32 expected = base->second[i];
+      const double change = expected == 0
+          ? 0.0
+          : 100.0 * (static_cast<double>(current) - expected) / expected;
+      std::cout << Util::StringPrintf(
+          "%s %s: %u usec (baseline %u, %+.1f%%)",
+          it->first.c_str(), kPercentileNames[i], current, expected, change);
+      if (change > FLAGS_max_regression_percent) {
+        std::cout << "  REGRESSION";
+        ++regressions;
+      }
+      std::cout << std::endl;
+    }
+  }
+  return regressions;
+}
+
+int Run() {
+  BenchmarkClient client;
+  CHECK(client.CreateSession()) << "CreateSession failed";
+
+  LatencyRecorder recorder;
+  RunConversionScenario(&client, &recorder);
+  RunRandomScenario(&client, &recorder);
+  if (!FLAGS_script.empty()) {
+    RunScriptScenario(FLAGS_script, &client, &recorder);
+  }
+  if (!FLAGS_play_log.empty()) {
+    RunPlayLogScenario(FLAGS_play_log, &client, &recorder);
+  }
+  client.DeleteSession();
+
+  const uint64 memory_kb = GetMemoryHighWaterKB();
+  std::map<string, std::vector<uint32> > stats;
+  recorder.Report(&stats);
+
+  for (std::map<string, std::vector<uint32> >::const_iterator it =
+           stats.begin();
+       it != stats.end(); ++it) {
+    const std::vector<uint32> &samples =
+        recorder.samples().find(it->first)->second;
+    std::cout << Util::StringPrintf(
+        "%s: size=%d p50=%u p95=%u p99=%u",
+        it->first.c_str(), static_cast<int>(samples.size()),
+        it->second[0], it->second[1], it->second[2]) << std::endl;
+  }
+  std::cout << "MemoryHighWaterKB: " << memory_kb << std::endl;
+
+  if (FLAGS_baseline.empty()) {
+    return 0;
+  }
+  if (FLAGS_update_baseline) {
+    WriteBaseline(FLAGS_baseline, stats, memory_kb);
+    std::cout << "Baseline written to " << FLAGS_baseline << std::endl;
+    return 0;
+  }
+  std::map<string, std::vector<uint32> > baseline;
+  uint64 baseline_memory_kb = 0;
+  if (!ReadBaseline(FLAGS_baseline, &baseline, &baseline_memory_kb)) {
+    LOG(ERROR) << "Cannot read baseline: " << FLAGS_baseline;
+    return 1;
+  }
+  const int regressions = DiffAgainstBaseline(stats, baseline);
+  if (baseline_memory_kb > 0 && memory_kb > 0) {
+    const double change = 100.0 *
+        (static_cast<double>(memory_kb) - baseline_memory_kb) /
+        baseline_memory_kb;
+    std::cout << Util::StringPrintf(
+        "MemoryHighWaterKB: %llu (baseline %llu, %+.1f%%)",
+        static_cast<unsigned long long>(memory_kb),
+        static_cast<unsigned long long>(baseline_memory_kb),
+        change) << std::endl;
+    if (change > FLAGS_max_regression_percent) {
+      std::cout << "  REGRESSION" << std::endl;
+      return regressions + 1;
+    }
+  }
+  return regressions;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  return mozc::Run();
+}
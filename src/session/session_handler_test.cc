@@ -131,6 +131,18 @@ class MockEngineBuilder : public EngineBuilderInterface {
   int num_clear_called_ = 0;
 };
 
+// EngineStub which reports its destruction; used to observe when a
+// replaced engine is retired.
+class DestructionNotifierEngineStub : public EngineStub {
+ public:
+  explicit DestructionNotifierEngineStub(bool *destroyed)
+      : destroyed_(destroyed) {}
+  ~DestructionNotifierEngineStub() override { *destroyed_ = true; }
+
+ private:
+  bool *destroyed_;
+};
+
 EngineReloadResponse::Status SendDummyEngineCommand(SessionHandler *handler) {
   commands::Command command;
   command.mutable_input()->set_type(
@@ -282,6 +294,41 @@ TEST_F(SessionHandlerTest, LastCommandTimeout) {
   EXPECT_FALSE(IsGoodSession(&handler, id));
 }
 
+TEST_F(SessionHandlerTest, GetMemoryStatsTest) {
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  SessionHandler handler(CreateMockDataEngine());
+
+  uint64 id1 = 0;
+  uint64 id2 = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id1));
+  clock.PutClockForward(3, 0);
+  EXPECT_TRUE(CreateSession(&handler, &id2));
+  clock.PutClockForward(2, 0);
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_MEMORY_STATS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  ASSERT_EQ(2, command.output().session_memory_size());
+
+  bool found1 = false;
+  bool found2 = false;
+  for (int i = 0; i < command.output().session_memory_size(); ++i) {
+    const commands::Output::SessionMemoryEntry &entry =
+        command.output().session_memory(i);
+    if (entry.session_id() == id1) {
+      found1 = true;
+      EXPECT_EQ(5, entry.idle_sec());
+    } else if (entry.session_id() == id2) {
+      found2 = true;
+      EXPECT_EQ(2, entry.idle_sec());
+    }
+  }
+  EXPECT_TRUE(found1);
+  EXPECT_TRUE(found2);
+}
+
 TEST_F(SessionHandlerTest, ShutdownTest) {
   SessionHandler handler(CreateMockDataEngine());
 
@@ -647,8 +694,10 @@ TEST_F(SessionHandlerTest, EngineReload_InvalidData) {
 // sessions exist in create session event.
 TEST_F(SessionHandlerTest, EngineReload_SessionExists) {
   MockEngineBuilder *engine_builder = new MockEngineBuilder();
+  bool old_engine_destroyed = false;
   SessionHandler handler(
-      std::unique_ptr<EngineStub>(new EngineStub()),
+      std::unique_ptr<EngineInterface>(
+          new DestructionNotifierEngineStub(&old_engine_destroyed)),
       std::unique_ptr<MockEngineBuilder>(engine_builder));
 
   // A session is created before data is loaded.
@@ -661,23 +710,23 @@ TEST_F(SessionHandlerTest, EngineReload_SessionExists) {
   // Emulate the state where async data load is complete.
   engine_builder->set_state(MockEngineBuilder::State::RELOAD_READY);
 
-  // Another session is created.  Since the handler already holds one session
-  // (id1), engine reload should not happen.
+  // Another session is created.  The engine is swapped right away even
+  // though the session id1 still exists: the new session converts on
+  // the new engine while id1 keeps the old engine alive.
   uint64 id2 = 0;
   ASSERT_TRUE(CreateSession(&handler, &id2));
-  EXPECT_EQ(0, engine_builder->num_build_from_prepared_data_called());
-  EXPECT_EQ(0, engine_builder->num_clear_called());
+  EXPECT_EQ(1, engine_builder->num_build_from_prepared_data_called());
+  EXPECT_EQ(1, engine_builder->num_clear_called());
+  EXPECT_FALSE(old_engine_destroyed);
 
-  // All the sessions were deleted.
-  ASSERT_TRUE(DeleteSession(&handler, id1));
+  // Deleting the session created on the new engine does not retire the
+  // old engine.
   ASSERT_TRUE(DeleteSession(&handler, id2));
+  EXPECT_FALSE(old_engine_destroyed);
 
-  // A new session is created.  Since the handler holds no session, engine is
-  // reloaded at this timing.
-  uint64 id3 = 0;
-  ASSERT_TRUE(CreateSession(&handler, &id3));
-  EXPECT_EQ(1, engine_builder->num_build_from_prepared_data_called());
-  EXPECT_EQ(1, engine_builder->num_clear_called());
+  // Deleting the last session created on the old engine does.
+  ASSERT_TRUE(DeleteSession(&handler, id1));
+  EXPECT_TRUE(old_engine_destroyed);
 }
 
 }  // namespace mozc
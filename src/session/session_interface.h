@@ -48,6 +48,8 @@ namespace composer {
 class Table;
 }  // namespace composer
 
+class EngineInterface;
+
 namespace session {
 class SessionInterface {
  public:
@@ -69,6 +71,11 @@ class SessionInterface {
   // Set composition Table. Currently, this is especial for session::Session.
   virtual void SetTable(const composer::Table *table) {}
 
+  // Returns the engine this session converts with, or NULL.
+  // SessionHandler uses it to keep a replaced engine alive until the
+  // sessions created on it are gone.
+  virtual EngineInterface *engine() { return NULL; }
+
   // Set client capability for this session.  Used by unittest.
   virtual void set_client_capability(
       const commands::Capability &capability) = 0;
@@ -80,6 +87,14 @@ class SessionInterface {
   // Get application information
   virtual const commands::ApplicationInfo &application_info() const = 0;
 
+  // Approximate heap bytes retained by this session's buffers.
+  virtual size_t UsedBytes() const { return 0; }
+
+  // Returns pooled capacity kept for future conversions to the heap.
+  // SessionHandler calls this on sessions that have been idle for a
+  // while; implementations must keep the session state intact.
+  virtual void Compact() {}
+
   // Return the time when this instance was created.
   virtual uint64 create_session_time() const = 0;
 
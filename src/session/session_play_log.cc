@@ -0,0 +1,271 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/session_play_log.h"
+
+#include <cstring>
+#include <ios>
+#include <string>
+
+#include "base/clock.h"
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/util.h"
+#include "protocol/commands.pb.h"
+
+DEFINE_string(session_play_log_file, "",
+              "Record every session input to this file for offline replay "
+              "with session_handler_benchmark_main. "
+              "Empty (the default) disables recording.");
+DEFINE_int32(session_play_log_max_size, 8 * 1024 * 1024,
+             "Rotate the session play log when it would exceed this many "
+             "bytes. Two generations are kept.");
+DEFINE_string(session_play_log_key_contents, "drop",
+              "What recorded key events carry: 'keep' records typed text "
+              "verbatim, 'hash' replaces it with stable pseudonyms, "
+              "'drop' removes it.");
+
+namespace mozc {
+namespace session {
+namespace {
+
+// Identifies a play log file and its record layout; bump the digit when
+// the layout changes.
+const char kPlayLogMagic[] = "MZPLAYLOG1\n";
+const size_t kPlayLogMagicSize = arraysize(kPlayLogMagic) - 1;
+
+const char kRotatedSuffix[] = ".old";
+
+// A record larger than this cannot be a serialized commands::Input; the
+// reader treats it as corruption rather than allocating the buffer.
+const uint32 kMaxRecordSize = 16 * 1024 * 1024;
+
+// Replaces |value| with a pseudonym derived from its fingerprint, or
+// clears it, depending on |policy|.
+void HashOrDropString(SessionPlayLogRecorder::KeyContentPolicy policy,
+                      string *value) {
+  if (policy == SessionPlayLogRecorder::HASH_KEY_CONTENTS) {
+    *value = Util::StringPrintf("h%08x", Hash::Fingerprint32(*value));
+  } else {
+    value->clear();
+  }
+}
+
+}  // namespace
+
+SessionPlayLogRecorder::SessionPlayLogRecorder(const string &path,
+                                               size_t max_file_size,
+                                               KeyContentPolicy policy)
+    : path_(path),
+      max_file_size_(max_file_size),
+      policy_(policy),
+      written_size_(0) {
+  RotateUnlocked();
+}
+
+SessionPlayLogRecorder::~SessionPlayLogRecorder() {}
+
+void SessionPlayLogRecorder::EvalCommandHandler(
+    const commands::Command &command) {
+  commands::Input input = command.input();
+  FilterKeyContents(policy_, &input);
+
+  string payload;
+  input.SerializeToString(&payload);
+  const uint32 payload_size = static_cast<uint32>(payload.size());
+
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  const uint64 timestamp_usec = sec * 1000000 + usec;
+
+  scoped_lock l(&mutex_);
+  if (stream_ == nullptr || !stream_->good()) {
+    return;
+  }
+  if (written_size_ + sizeof(payload_size) + sizeof(timestamp_usec) +
+          payload.size() > max_file_size_) {
+    RotateUnlocked();
+    if (stream_ == nullptr || !stream_->good()) {
+      return;
+    }
+  }
+  // The sizes and timestamps are written in host byte order; the log is
+  // replayed on the machine that recorded it.
+  stream_->write(reinterpret_cast<const char *>(&payload_size),
+                 sizeof(payload_size));
+  stream_->write(reinterpret_cast<const char *>(&timestamp_usec),
+                 sizeof(timestamp_usec));
+  stream_->write(payload.data(), payload.size());
+  // One record per flush keeps the log complete up to a crash.  Records
+  // arrive at human typing speed, so the extra write barely registers.
+  stream_->flush();
+  written_size_ += sizeof(payload_size) + sizeof(timestamp_usec) +
+                   payload.size();
+}
+
+void SessionPlayLogRecorder::RotateUnlocked() {
+  stream_.reset();
+  if (FileUtil::FileExists(path_) &&
+      !FileUtil::AtomicRename(path_, path_ + kRotatedSuffix)) {
+    LOG(ERROR) << "Cannot rotate play log: " << path_;
+    return;
+  }
+  stream_.reset(new OutputFileStream(
+      path_.c_str(), std::ios::out | std::ios::binary | std::ios::trunc));
+  if (!stream_->good()) {
+    LOG(ERROR) << "Cannot open play log: " << path_;
+    stream_.reset();
+    return;
+  }
+  stream_->write(kPlayLogMagic, kPlayLogMagicSize);
+  written_size_ = kPlayLogMagicSize;
+}
+
+// static
+SessionPlayLogRecorder *SessionPlayLogRecorder::CreateFromFlags() {
+  if (FLAGS_session_play_log_file.empty()) {
+    return nullptr;
+  }
+  KeyContentPolicy policy = DROP_KEY_CONTENTS;
+  if (FLAGS_session_play_log_key_contents == "keep") {
+    policy = KEEP_KEY_CONTENTS;
+  } else if (FLAGS_session_play_log_key_contents == "hash") {
+    policy = HASH_KEY_CONTENTS;
+  } else if (FLAGS_session_play_log_key_contents != "drop") {
+    LOG(WARNING) << "Unknown --session_play_log_key_contents: "
+                 << FLAGS_session_play_log_key_contents
+                 << ", recording without key contents";
+  }
+  LOG(INFO) << "Recording session play log to "
+            << FLAGS_session_play_log_file;
+  return new SessionPlayLogRecorder(
+      FLAGS_session_play_log_file,
+      static_cast<size_t>(FLAGS_session_play_log_max_size), policy);
+}
+
+// static
+void SessionPlayLogRecorder::FilterKeyContents(KeyContentPolicy policy,
+                                               commands::Input *input) {
+  if (policy == KEEP_KEY_CONTENTS) {
+    return;
+  }
+  if (input->has_key()) {
+    commands::KeyEvent *key = input->mutable_key();
+    if (key->has_key_code()) {
+      if (policy == HASH_KEY_CONTENTS) {
+        // Map onto 'a'..'z' so the replayed key still drives the
+        // composer through a realistic path.
+        key->set_key_code('a' + Hash::Fingerprint32(key->key_code()) % 26);
+      } else {
+        key->clear_key_code();
+      }
+    }
+    if (key->has_key_string()) {
+      HashOrDropString(policy, key->mutable_key_string());
+      if (key->key_string().empty()) {
+        key->clear_key_string();
+      }
+    }
+    // Touch coordinates could be used to reconstruct typed characters.
+    key->clear_probable_key_event();
+  }
+  if (input->has_command() && input->command().has_text()) {
+    HashOrDropString(policy, input->mutable_command()->mutable_text());
+    if (input->command().text().empty()) {
+      input->mutable_command()->clear_text();
+    }
+  }
+}
+
+SessionPlayLogReader::SessionPlayLogReader() {}
+
+SessionPlayLogReader::~SessionPlayLogReader() {}
+
+bool SessionPlayLogReader::Open(const string &path) {
+  const string rotated = path + kRotatedSuffix;
+  if (FileUtil::FileExists(rotated)) {
+    next_path_ = path;
+    return OpenFile(rotated);
+  }
+  next_path_.clear();
+  return OpenFile(path);
+}
+
+bool SessionPlayLogReader::OpenFile(const string &path) {
+  stream_.reset(new InputFileStream(
+      path.c_str(), std::ios::in | std::ios::binary));
+  if (!stream_->good()) {
+    LOG(ERROR) << "Cannot open play log: " << path;
+    stream_.reset();
+    return false;
+  }
+  char magic[kPlayLogMagicSize];
+  if (!stream_->read(magic, kPlayLogMagicSize) ||
+      memcmp(magic, kPlayLogMagic, kPlayLogMagicSize) != 0) {
+    LOG(ERROR) << "Not a play log: " << path;
+    stream_.reset();
+    return false;
+  }
+  return true;
+}
+
+bool SessionPlayLogReader::Next(uint64 *timestamp_usec,
+                                commands::Input *input) {
+  while (stream_ != nullptr) {
+    uint32 payload_size = 0;
+    if (stream_->read(reinterpret_cast<char *>(&payload_size),
+                      sizeof(payload_size)) &&
+        stream_->read(reinterpret_cast<char *>(timestamp_usec),
+                      sizeof(*timestamp_usec)) &&
+        payload_size <= kMaxRecordSize) {
+      string payload(payload_size, '\0');
+      if (stream_->read(&payload[0], payload_size) &&
+          input->ParseFromString(payload)) {
+        return true;
+      }
+    }
+    // End of this generation (or a record truncated by a crash, which
+    // by construction can only be the last one); move on to the
+    // current file if one is still pending.
+    stream_.reset();
+    if (next_path_.empty() || !OpenFile(next_path_)) {
+      return false;
+    }
+    next_path_.clear();
+  }
+  return false;
+}
+
+}  // namespace session
+}  // namespace mozc
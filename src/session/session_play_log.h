@@ -0,0 +1,148 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Opt-in capture of the session input stream for offline replay.
+//
+// SessionPlayLogRecorder is a SessionObserverInterface which appends
+// every commands::Input it observes, together with a wall-clock
+// timestamp, to a size-bounded log on disk.  The log can later be fed
+// through a fresh SessionHandler (see session_handler_benchmark_main.cc)
+// to reproduce a real typing session, including its timing, against a
+// modified engine.
+//
+// The log is a local binary file: each record is a fixed header
+// (payload size and timestamp in host byte order) followed by a
+// serialized commands::Input.  Two generations are kept; when the
+// current file exceeds the size limit it is rotated to "<path>.old" and
+// a new one is started, so the log behaves as a ring holding roughly
+// the most recent 2 * max_file_size bytes of input.
+//
+// Key contents are personal data, so recording is disabled by default
+// and the key payload is filtered before it is written.  The policy
+// decides what survives:
+//   KEEP_KEY_CONTENTS  record inputs verbatim (faithful replay).
+//   HASH_KEY_CONTENTS  replace typed characters and strings with
+//                      stable pseudonyms derived from their
+//                      fingerprints.  Replay exercises the same code
+//                      paths with the same rhythm but different text.
+//   DROP_KEY_CONTENTS  remove typed characters and strings entirely.
+//                      Only command types, special keys, modifiers and
+//                      timing remain.
+#ifndef MOZC_SESSION_SESSION_PLAY_LOG_H_
+#define MOZC_SESSION_SESSION_PLAY_LOG_H_
+
+#include <memory>
+#include <string>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "session/session_observer_interface.h"
+
+namespace mozc {
+
+class InputFileStream;
+class OutputFileStream;
+
+namespace commands {
+class Command;
+class Input;
+}  // namespace commands
+
+namespace session {
+
+class SessionPlayLogRecorder : public SessionObserverInterface {
+ public:
+  enum KeyContentPolicy {
+    KEEP_KEY_CONTENTS,
+    HASH_KEY_CONTENTS,
+    DROP_KEY_CONTENTS,
+  };
+
+  // Records to |path|, rotating to "<path>.old" whenever the current
+  // file would exceed |max_file_size| bytes.  A file left at |path| by
+  // a previous run is rotated out immediately so every generation is a
+  // single contiguous recording.
+  SessionPlayLogRecorder(const string &path, size_t max_file_size,
+                         KeyContentPolicy policy);
+  virtual ~SessionPlayLogRecorder();
+
+  virtual void EvalCommandHandler(const commands::Command &command);
+
+  // Returns a recorder configured from the --session_play_log_* flags,
+  // or NULL when --session_play_log_file is empty (the default).  The
+  // caller owns the result.
+  static SessionPlayLogRecorder *CreateFromFlags();
+
+  // Rewrites the fields of |input| that carry typed text according to
+  // |policy|.  Exposed for testing and for CreateFromFlags().
+  static void FilterKeyContents(KeyContentPolicy policy,
+                                commands::Input *input);
+
+ private:
+  void RotateUnlocked();
+
+  const string path_;
+  const size_t max_file_size_;
+  const KeyContentPolicy policy_;
+  size_t written_size_;
+  std::unique_ptr<OutputFileStream> stream_;
+  Mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionPlayLogRecorder);
+};
+
+// Reads back a log written by SessionPlayLogRecorder in recording
+// order: the rotated-out generation first (if it exists), then the
+// current file.
+class SessionPlayLogReader {
+ public:
+  SessionPlayLogReader();
+  ~SessionPlayLogReader();
+
+  // Opens the log recorded to |path|.  Returns false when neither
+  // generation exists or the file header is not a play log.
+  bool Open(const string &path);
+
+  // Fills the next record.  Returns false at the end of the log or on
+  // a truncated record (a process killed mid-write leaves one).
+  bool Next(uint64 *timestamp_usec, commands::Input *input);
+
+ private:
+  bool OpenFile(const string &path);
+
+  std::unique_ptr<InputFileStream> stream_;
+  string next_path_;  // current generation, read after "<path>.old".
+
+  DISALLOW_COPY_AND_ASSIGN(SessionPlayLogReader);
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_SESSION_PLAY_LOG_H_
@@ -0,0 +1,176 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/session_play_log.h"
+
+#include <memory>
+#include <string>
+
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/port.h"
+#include "protocol/commands.pb.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+DECLARE_string(test_tmpdir);
+
+namespace mozc {
+namespace session {
+namespace {
+
+commands::Command MakeKeyCommand(uint64 id, uint32 key_code,
+                                 const string &key_string) {
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::SEND_KEY);
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->mutable_key()->set_key_code(key_code);
+  if (!key_string.empty()) {
+    command.mutable_input()->mutable_key()->set_key_string(key_string);
+  }
+  return command;
+}
+
+class SessionPlayLogTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    path_ = FileUtil::JoinPath(FLAGS_test_tmpdir, "play_log.db");
+    FileUtil::Unlink(path_);
+    FileUtil::Unlink(path_ + ".old");
+  }
+
+  string path_;
+};
+
+TEST_F(SessionPlayLogTest, RecordAndReadBack) {
+  SessionPlayLogRecorder recorder(
+      path_, 1 << 20, SessionPlayLogRecorder::KEEP_KEY_CONTENTS);
+  recorder.EvalCommandHandler(MakeKeyCommand(1, 'a', ""));
+  recorder.EvalCommandHandler(MakeKeyCommand(1, 'i', "\xE3\x81\x84"));
+  recorder.EvalCommandHandler(MakeKeyCommand(2, 'u', ""));
+
+  SessionPlayLogReader reader;
+  ASSERT_TRUE(reader.Open(path_));
+  uint64 timestamp_usec = 0;
+  uint64 prev_timestamp_usec = 0;
+  commands::Input input;
+
+  ASSERT_TRUE(reader.Next(&timestamp_usec, &input));
+  EXPECT_EQ(commands::Input::SEND_KEY, input.type());
+  EXPECT_EQ(1, input.id());
+  EXPECT_EQ('a', input.key().key_code());
+  prev_timestamp_usec = timestamp_usec;
+
+  ASSERT_TRUE(reader.Next(&timestamp_usec, &input));
+  EXPECT_EQ("\xE3\x81\x84", input.key().key_string());
+  EXPECT_LE(prev_timestamp_usec, timestamp_usec);
+  prev_timestamp_usec = timestamp_usec;
+
+  ASSERT_TRUE(reader.Next(&timestamp_usec, &input));
+  EXPECT_EQ(2, input.id());
+  EXPECT_LE(prev_timestamp_usec, timestamp_usec);
+
+  EXPECT_FALSE(reader.Next(&timestamp_usec, &input));
+}
+
+TEST_F(SessionPlayLogTest, HashKeyContents) {
+  commands::Input input;
+  input.set_type(commands::Input::SEND_KEY);
+  input.mutable_key()->set_key_code('x');
+  input.mutable_key()->set_key_string("\xE3\x81\x82");
+  commands::Input hashed = input;
+  SessionPlayLogRecorder::FilterKeyContents(
+      SessionPlayLogRecorder::HASH_KEY_CONTENTS, &hashed);
+
+  // Contents are replaced, not removed, and the pseudonyms are stable.
+  EXPECT_TRUE(hashed.key().has_key_code());
+  EXPECT_NE(input.key().key_code(), hashed.key().key_code());
+  EXPECT_GE(hashed.key().key_code(), 'a');
+  EXPECT_LE(hashed.key().key_code(), 'z');
+  EXPECT_TRUE(hashed.key().has_key_string());
+  EXPECT_NE(input.key().key_string(), hashed.key().key_string());
+
+  commands::Input hashed_again = input;
+  SessionPlayLogRecorder::FilterKeyContents(
+      SessionPlayLogRecorder::HASH_KEY_CONTENTS, &hashed_again);
+  EXPECT_EQ(hashed.key().key_code(), hashed_again.key().key_code());
+  EXPECT_EQ(hashed.key().key_string(), hashed_again.key().key_string());
+}
+
+TEST_F(SessionPlayLogTest, DropKeyContents) {
+  commands::Input input;
+  input.set_type(commands::Input::SEND_KEY);
+  input.mutable_key()->set_key_code('x');
+  input.mutable_key()->set_key_string("\xE3\x81\x82");
+  input.mutable_key()->set_special_key(commands::KeyEvent::ENTER);
+  input.mutable_key()->add_modifier_keys(commands::KeyEvent::SHIFT);
+  input.mutable_command()->set_type(commands::SessionCommand::SUBMIT);
+  input.mutable_command()->set_text("secret");
+  SessionPlayLogRecorder::FilterKeyContents(
+      SessionPlayLogRecorder::DROP_KEY_CONTENTS, &input);
+
+  EXPECT_FALSE(input.key().has_key_code());
+  EXPECT_FALSE(input.key().has_key_string());
+  EXPECT_FALSE(input.command().has_text());
+  // Everything that carries no text survives.
+  EXPECT_EQ(commands::KeyEvent::ENTER, input.key().special_key());
+  EXPECT_EQ(1, input.key().modifier_keys_size());
+  EXPECT_EQ(commands::SessionCommand::SUBMIT, input.command().type());
+}
+
+TEST_F(SessionPlayLogTest, Rotation) {
+  // Small enough that 100 records span several generations.
+  SessionPlayLogRecorder recorder(
+      path_, 256, SessionPlayLogRecorder::KEEP_KEY_CONTENTS);
+  for (uint32 i = 0; i < 100; ++i) {
+    recorder.EvalCommandHandler(MakeKeyCommand(1, 'a' + i % 26, ""));
+  }
+  EXPECT_TRUE(FileUtil::FileExists(path_));
+  EXPECT_TRUE(FileUtil::FileExists(path_ + ".old"));
+
+  // The ring keeps a contiguous suffix of the recording ending in the
+  // last record; older generations have been dropped.
+  SessionPlayLogReader reader;
+  ASSERT_TRUE(reader.Open(path_));
+  uint64 timestamp_usec = 0;
+  commands::Input input;
+  int read_count = 0;
+  uint32 last_key_code = 0;
+  while (reader.Next(&timestamp_usec, &input)) {
+    ++read_count;
+    last_key_code = input.key().key_code();
+  }
+  EXPECT_GT(read_count, 0);
+  EXPECT_LT(read_count, 100);
+  EXPECT_EQ('a' + 99 % 26, last_key_code);
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
@@ -37,11 +37,13 @@
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/scheduler.h"
+#include "base/trace.h"
 #include "engine/engine_factory.h"
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
 #include "protocol/commands.pb.h"
 #include "session/session_handler.h"
+#include "session/session_play_log.h"
 #include "session/session_usage_observer.h"
 #include "usage_stats/usage_stats_uploader.h"
 
@@ -67,12 +69,16 @@ namespace mozc {
 SessionServer::SessionServer()
     : IPCServer(kSessionName, kNumConnections, kTimeOut),
       usage_observer_(new session::SessionUsageObserver()),
+      play_log_recorder_(session::SessionPlayLogRecorder::CreateFromFlags()),
       session_handler_(new SessionHandler(
       std::unique_ptr<Engine>(EngineFactory::Create()))) {
   using usage_stats::UsageStatsUploader;
   // start session watch dog timer
   session_handler_->StartWatchDog();
   session_handler_->AddObserver(usage_observer_.get());
+  if (play_log_recorder_ != nullptr) {
+    session_handler_->AddObserver(play_log_recorder_.get());
+  }
 
   // start usage stats timer
   // send usage stats within 6 min later
@@ -83,7 +89,7 @@ SessionServer::SessionServer()
       UsageStatsUploader::kDefaultSchedulerDelay,
       UsageStatsUploader::kDefaultSchedulerRandomDelay,
       &UsageStatsUploader::Send,
-      nullptr));
+      nullptr).set_priority(Scheduler::JobSetting::PRIORITY_IDLE));
 
   // Send a notification event to the UI.
   NamedEventNotifier notifier(kEventName);
@@ -104,44 +110,48 @@ bool SessionServer::Process(const char *request,
                             size_t request_size,
                             char *response,
                             size_t *response_size) {
+  // Covers one full IPC request: parse, evaluation and serialization.
+  ScopedTraceEvent trace_event("SessionServer::Process");
   if (!session_handler_) {
     LOG(WARNING) << "handler is not available";
     return false;   // shutdown the server if handler doesn't exist
   }
 
-  commands::Command command;   // can define as a private member?
-  if (!command.mutable_input()->ParseFromArray(request, request_size)) {
+  // |command_| is a reused member; Clear() keeps the underlying
+  // allocations alive for the next request.
+  command_.Clear();
+  if (!command_.mutable_input()->ParseFromArray(request, request_size)) {
     LOG(WARNING) << "Invalid request";
     *response_size = 0;
     return true;
   }
 
-  if (!session_handler_->EvalCommand(&command)) {
+  if (!session_handler_->EvalCommand(&command_)) {
     LOG(WARNING) << "EvalCommand() returned false. Exiting the loop.";
     *response_size = 0;
     return false;
   }
 
-  string output;
-  if (!command.output().SerializeToString(&output)) {
-    LOG(WARNING) << "SerializeToString() failed";
-    *response_size = 0;
-    return true;
-  }
-
   // TODO(taku) automatically increase the buffer.
   // Needs to fix IPCServer as well
-  if (*response_size < output.size()) {
+  const int output_size = command_.output().ByteSize();
+  if (*response_size < static_cast<size_t>(output_size)) {
     LOG(WARNING) << "response size < output.size";
     *response_size = 0;
     return true;
   }
 
-  ::memcpy(response, output.data(), output.size());
-  *response_size = output.size();
+  // Serialize directly into the IPC response buffer instead of going
+  // through an intermediate string.
+  if (!command_.output().SerializeToArray(response, output_size)) {
+    LOG(WARNING) << "SerializeToArray() failed";
+    *response_size = 0;
+    return true;
+  }
+  *response_size = output_size;
 
   // debug message
-  VLOG(2) << command.DebugString();
+  VLOG(2) << command_.DebugString();
 
   return true;
 }
@@ -36,12 +36,14 @@
 
 #include "base/port.h"
 #include "ipc/ipc.h"
+#include "protocol/commands.pb.h"
 
 namespace mozc {
 class EngineInterface;
 class SessionHandlerInterface;
 
 namespace session {
+class SessionPlayLogRecorder;
 class SessionUsageObserver;
 }  // namespace session
 
@@ -69,8 +71,15 @@ class SessionServer: public IPCServer {
 
  private:
   std::unique_ptr<session::SessionUsageObserver> usage_observer_;
+  // NULL unless recording is enabled with --session_play_log_file.
+  std::unique_ptr<session::SessionPlayLogRecorder> play_log_recorder_;
   std::unique_ptr<SessionHandlerInterface> session_handler_;
 
+  // Reused across Process() calls to avoid constructing and destructing
+  // a message object for every key event.  Process() is invoked only
+  // from the IPC receive thread.
+  commands::Command command_;
+
   DISALLOW_COPY_AND_ASSIGN(SessionServer);
 };
 
@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 
+#include "base/allocation_counter.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -3703,6 +3704,35 @@ TEST_F(SessionTest, InsertCharacterWithShiftKey) {
   }
 }
 
+TEST_F(SessionTest, SteadyStateTypingAllocationGuard) {
+  // Guards the steady-state composing path (no conversion) against
+  // allocation regressions: once buffers and caches are warm, typing one
+  // more sequence must not allocate more than the previous identical
+  // sequence did.  The long-term target is zero allocations per key.
+  const char *kKeys[] = { "k", "a", "k", "i", "k", "u", "k", "e", "k", "o" };
+
+  std::unique_ptr<Session> session(new Session(engine_.get()));
+  InitSessionToPrecomposition(session.get());
+  commands::Command command;
+
+  uint64 first_pass_count = 0;
+  for (int pass = 0; pass < 4; ++pass) {
+    ScopedAllocationCounter counter;
+    for (size_t i = 0; i < arraysize(kKeys); ++i) {
+      SendKey(kKeys[i], session.get(), &command);
+    }
+    session->EditCancel(&command);
+    if (pass < 2) {
+      continue;  // Warming up.
+    }
+    if (pass == 2) {
+      first_pass_count = counter.allocation_count();
+    } else {
+      EXPECT_LE(counter.allocation_count(), first_pass_count);
+    }
+  }
+}
+
 TEST_F(SessionTest, ExitTemporaryAlphanumModeAfterCommitingSugesstion) {
   // This is a unittest against http://b/2977131.
   {
@@ -75,6 +75,7 @@
         'session_test.cc',
       ],
       'dependencies': [
+        '../base/base.gyp:allocation_counter',
         '../converter/converter_base.gyp:converter_mock',
         '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
         '../engine/engine.gyp:engine',
@@ -156,6 +157,7 @@
       'sources': [
         'output_util_test.cc',
         'session_observer_handler_test.cc',
+        'session_play_log_test.cc',
         'session_usage_observer_test.cc',
         'session_usage_stats_util_test.cc',
       ],
@@ -171,6 +173,7 @@
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         '../usage_stats/usage_stats_test.gyp:usage_stats_testing_util',
         'session.gyp:session_handler',
+        'session.gyp:session_play_log',
         'session.gyp:session_usage_observer',
         'session_base.gyp:keymap',
         'session_base.gyp:keymap_factory',
@@ -118,7 +118,7 @@ SessionUsageObserver::SessionUsageObserver() {
       kSaveCacheStatsInterval,  // delay start
       0,  // random delay 0 (no internet connection from this job)
       &SessionUsageObserver::SaveCachedStats,
-      &usage_cache_));
+      &usage_cache_).set_priority(Scheduler::JobSetting::PRIORITY_IDLE));
 }
 
 SessionUsageObserver::~SessionUsageObserver() {
@@ -65,7 +65,8 @@ const float kMinimumLatestCPULoad = 0.66f;
 
 SessionWatchDog::SessionWatchDog(int32 interval_sec)
     : interval_sec_(interval_sec),
-      client_(NULL), cpu_stats_(NULL), event_(new UnnamedEvent) {
+      client_(NULL), cpu_stats_(NULL), liveness_word_(NULL),
+      event_(new UnnamedEvent) {
   // allow [1..600].
   interval_sec_ = std::max(1, std::min(interval_sec_, 600));
   DCHECK(event_->IsAvailable())
@@ -84,6 +85,10 @@ void SessionWatchDog::SetCPUStatsInterface(CPUStatsInterface *cpu_stats) {
   cpu_stats_ = cpu_stats;
 }
 
+void SessionWatchDog::SetLivenessWord(const volatile uint64 *liveness_word) {
+  liveness_word_ = liveness_word;
+}
+
 void SessionWatchDog::Terminate() {
   if (!IsRunning()) {
     return;
@@ -184,12 +189,24 @@ void SessionWatchDog::Run() {
     last_cleanup_time = current_cleanup_time;
 
     VLOG(2) << "Sending Cleanup command";
+    const uint64 cleanup_sent_time = Clock::GetTime();
     client_->set_timeout(kCleanupTimeout);
     if (client_->Cleanup()) {
       VLOG(2) << "Cleanup command succeeded";
       continue;
     }
 
+    // The server updates the liveness word whenever it finishes a
+    // command.  If the word advanced while the Cleanup command was in
+    // flight, the server is processing commands and is merely slow or
+    // loaded; the Ping escalation below would waste its dispatch cost
+    // and could end in LOG(FATAL) on a healthy server.
+    if (liveness_word_ != NULL && *liveness_word_ >= cleanup_sent_time) {
+      LOG(WARNING) << "Cleanup failed but the server is processing commands. "
+                   << "Skipping ping";
+      continue;
+    }
+
     LOG(WARNING) << "Cleanup failed "
                  << "execute PingCommand to check server is running";
 
@@ -216,6 +233,14 @@ void SessionWatchDog::Run() {
         VLOG(1) << "Parent thread is already terminated";
         return;
       }
+      // Final check of the liveness word before killing the server:
+      // the ping trials above take several seconds, which is enough
+      // time for a loaded server to have resumed processing.
+      if (liveness_word_ != NULL && *liveness_word_ >= cleanup_sent_time) {
+        LOG(WARNING) << "Ping failed but the server is processing commands. "
+                     << "Skipping FATAL";
+        continue;
+      }
 #ifndef NO_LOGGING
       // We have received crash dumps caused by the following LOG(FATAL).
       // Unfortunately, we cannot investigate the cause of this error,
@@ -61,6 +61,14 @@ class SessionWatchDog : public Thread {
   // mainly for unittesting.
   void SetCPUStatsInterface(CPUStatsInterface *cpu_stats);
 
+  // Set the address of the liveness word, which the server updates with
+  // the current time whenever it finishes a command.  The watch dog
+  // runs inside the server process and reads it without IPC: when the
+  // word has advanced while a Cleanup command was in flight, the server
+  // is processing commands (merely slow), so the Ping escalation is
+  // skipped.  This method doesn't take the ownership.
+  void SetLivenessWord(const volatile uint64 *liveness_word);
+
   explicit SessionWatchDog(int32 interval_sec);
   virtual ~SessionWatchDog();
 
@@ -88,6 +96,7 @@ class SessionWatchDog : public Thread {
   int32 interval_sec_;
   client::ClientInterface *client_;
   CPUStatsInterface *cpu_stats_;
+  const volatile uint64 *liveness_word_;
   std::unique_ptr<UnnamedEvent> event_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionWatchDog);
@@ -0,0 +1,180 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "storage/cache_budget_manager.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/flags.h"
+#include "base/logging.h"
+#include "base/scheduler.h"
+#include "base/singleton.h"
+
+DEFINE_uint64(cache_memory_budget, 0,
+              "Total byte budget for the in-memory caches registered with "
+              "CacheBudgetManager. 0 disables enforcement.");
+
+namespace mozc {
+namespace storage {
+namespace {
+
+const char kEnforceJobName[] = "CacheBudgetEnforcer";
+const uint32 kEnforceIntervalMsec = 60 * 1000;          // 1 min
+const uint32 kMaxEnforceIntervalMsec = 5 * 60 * 1000;   // 5 min
+const uint32 kEnforceDelayMsec = 60 * 1000;             // 1 min
+const uint32 kEnforceRandomDelayMsec = 30 * 1000;       // 30 sec
+
+}  // namespace
+
+CacheBudgetManager::CacheBudgetManager()
+    : budget_(FLAGS_cache_memory_budget), job_started_(false) {}
+
+CacheBudgetManager::~CacheBudgetManager() {
+  if (job_started_) {
+    Scheduler::RemoveJob(kEnforceJobName);
+  }
+}
+
+// static
+CacheBudgetManager *CacheBudgetManager::GetInstance() {
+  return Singleton<CacheBudgetManager>::get();
+}
+
+void CacheBudgetManager::Register(const string &name, Client *client) {
+  DCHECK(client);
+  bool start_job = false;
+  {
+    scoped_lock lock(&mutex_);
+    ClientInfo info;
+    info.name = name;
+    info.client = client;
+    clients_.push_back(info);
+    if (!job_started_ && this == Singleton<CacheBudgetManager>::get()) {
+      job_started_ = true;
+      start_job = true;
+    }
+  }
+  // Scheduler::AddJob is called outside the lock because the callback
+  // may fire immediately on some platforms.
+  if (start_job) {
+    Scheduler::AddJob(Scheduler::JobSetting(
+        kEnforceJobName, kEnforceIntervalMsec, kMaxEnforceIntervalMsec,
+        kEnforceDelayMsec, kEnforceRandomDelayMsec,
+        &CacheBudgetManager::EnforceCallback, this));
+  }
+}
+
+void CacheBudgetManager::Unregister(Client *client) {
+  scoped_lock lock(&mutex_);
+  for (size_t i = 0; i < clients_.size(); ++i) {
+    if (clients_[i].client == client) {
+      clients_.erase(clients_.begin() + i);
+      return;
+    }
+  }
+}
+
+void CacheBudgetManager::SetBudget(size_t budget) {
+  scoped_lock lock(&mutex_);
+  budget_ = budget;
+}
+
+size_t CacheBudgetManager::budget() const {
+  scoped_lock lock(&mutex_);
+  return budget_;
+}
+
+size_t CacheBudgetManager::TotalUsedBytes() const {
+  scoped_lock lock(&mutex_);
+  return TotalUsedBytesUnlocked();
+}
+
+size_t CacheBudgetManager::TotalUsedBytesUnlocked() const {
+  size_t total = 0;
+  for (size_t i = 0; i < clients_.size(); ++i) {
+    total += clients_[i].client->UsedBytes();
+  }
+  return total;
+}
+
+bool CacheBudgetManager::Enforce() {
+  scoped_lock lock(&mutex_);
+  if (budget_ == 0) {
+    return true;
+  }
+
+  size_t total = TotalUsedBytesUnlocked();
+  if (total <= budget_) {
+    return true;
+  }
+
+  // Each client is asked at most once per enforcement pass, coldest
+  // first.
+  std::vector<bool> visited(clients_.size(), false);
+  while (total > budget_) {
+    int coldest = -1;
+    for (size_t i = 0; i < clients_.size(); ++i) {
+      if (visited[i] || clients_[i].client->UsedBytes() == 0) {
+        continue;
+      }
+      if (coldest < 0 ||
+          clients_[i].client->LastAccessTime() <
+              clients_[coldest].client->LastAccessTime()) {
+        coldest = static_cast<int>(i);
+      }
+    }
+    if (coldest < 0) {
+      LOG(WARNING) << "cannot enforce cache budget: " << total << " > "
+                   << budget_;
+      return false;
+    }
+    visited[coldest] = true;
+    const size_t released =
+        clients_[coldest].client->ReleaseBytes(total - budget_);
+    VLOG(1) << "trimmed cache " << clients_[coldest].name << " by "
+            << released << " bytes";
+    // Some clients apply the release lazily on their owning thread, so
+    // trust the reported number instead of re-polling UsedBytes().
+    total -= std::min(released, total);
+  }
+
+  return true;
+}
+
+// static
+bool CacheBudgetManager::EnforceCallback(void *data) {
+  CacheBudgetManager *manager = static_cast<CacheBudgetManager *>(data);
+  DCHECK(manager);
+  return manager->Enforce();
+}
+
+}  // namespace storage
+}  // namespace mozc
@@ -0,0 +1,117 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_STORAGE_CACHE_BUDGET_MANAGER_H_
+#define MOZC_STORAGE_CACHE_BUDGET_MANAGER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+
+namespace mozc {
+namespace storage {
+
+// Process-wide registry of memory caches under a common byte budget.
+//
+// Each cache registers a Client which reports its approximate heap
+// usage and knows how to shrink itself.  A periodic scheduler job (and
+// explicit Enforce() calls) trims the coldest clients -- the ones with
+// the oldest last access -- until the total drops under the budget.
+// With a budget of 0 (the default) enforcement is disabled and
+// registration is free.
+//
+// All methods are thread-safe.  Client methods are invoked with the
+// manager lock held, so they must not call back into the manager.
+class CacheBudgetManager {
+ public:
+  class Client {
+   public:
+    virtual ~Client() {}
+
+    // Returns the approximate number of heap bytes currently held.
+    virtual size_t UsedBytes() const = 0;
+
+    // Returns the time (seconds, Clock::GetTime()) of the most recent
+    // access.  The coldest client is trimmed first.
+    virtual uint64 LastAccessTime() const = 0;
+
+    // Releases roughly |bytes| (more is fine) and returns the number of
+    // bytes actually released.
+    virtual size_t ReleaseBytes(size_t bytes) = 0;
+  };
+
+  CacheBudgetManager();
+  ~CacheBudgetManager();
+
+  // Returns the process-wide instance.  Its budget is initialized from
+  // the --cache_memory_budget flag and its Enforce() runs periodically
+  // on the scheduler.
+  static CacheBudgetManager *GetInstance();
+
+  // Registers/unregisters a client.  |name| is used for logging.
+  // The client must stay valid until Unregister() returns.
+  void Register(const string &name, Client *client);
+  void Unregister(Client *client);
+
+  // Global budget in bytes.  0 disables enforcement.
+  void SetBudget(size_t budget);
+  size_t budget() const;
+
+  // Sum of UsedBytes() over the registered clients.
+  size_t TotalUsedBytes() const;
+
+  // Trims the coldest clients until the total usage drops under the
+  // budget.  Returns true when the total is under the budget afterwards
+  // (trivially true when enforcement is disabled).
+  bool Enforce();
+
+ private:
+  struct ClientInfo {
+    string name;
+    Client *client;
+  };
+
+  static bool EnforceCallback(void *data);
+
+  size_t TotalUsedBytesUnlocked() const;
+
+  std::vector<ClientInfo> clients_;
+  size_t budget_;
+  bool job_started_;
+  mutable Mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(CacheBudgetManager);
+};
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_CACHE_BUDGET_MANAGER_H_
@@ -0,0 +1,154 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "storage/cache_budget_manager.h"
+
+#include <algorithm>
+
+#include "base/port.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+class FakeClient : public CacheBudgetManager::Client {
+ public:
+  FakeClient(size_t used_bytes, uint64 last_access_time)
+      : used_bytes_(used_bytes),
+        last_access_time_(last_access_time),
+        release_calls_(0) {}
+
+  virtual size_t UsedBytes() const { return used_bytes_; }
+  virtual uint64 LastAccessTime() const { return last_access_time_; }
+
+  virtual size_t ReleaseBytes(size_t bytes) {
+    ++release_calls_;
+    const size_t released = std::min(bytes, used_bytes_);
+    used_bytes_ -= released;
+    return released;
+  }
+
+  size_t used_bytes() const { return used_bytes_; }
+  int release_calls() const { return release_calls_; }
+
+ private:
+  size_t used_bytes_;
+  uint64 last_access_time_;
+  int release_calls_;
+};
+
+TEST(CacheBudgetManagerTest, ZeroBudgetDisablesEnforcement) {
+  CacheBudgetManager manager;
+  FakeClient client(1000, 1);
+  manager.Register("client", &client);
+
+  manager.SetBudget(0);
+  EXPECT_TRUE(manager.Enforce());
+  EXPECT_EQ(1000, client.used_bytes());
+  EXPECT_EQ(0, client.release_calls());
+
+  manager.Unregister(&client);
+}
+
+TEST(CacheBudgetManagerTest, EnforceTrimsColdestClientFirst) {
+  CacheBudgetManager manager;
+  FakeClient cold(600, 10);
+  FakeClient hot(600, 20);
+  manager.Register("cold", &cold);
+  manager.Register("hot", &hot);
+  EXPECT_EQ(1200, manager.TotalUsedBytes());
+
+  // 200 bytes over budget; the cold client alone can cover it.
+  manager.SetBudget(1000);
+  EXPECT_TRUE(manager.Enforce());
+  EXPECT_EQ(400, cold.used_bytes());
+  EXPECT_EQ(600, hot.used_bytes());
+  EXPECT_EQ(0, hot.release_calls());
+
+  manager.Unregister(&cold);
+  manager.Unregister(&hot);
+}
+
+TEST(CacheBudgetManagerTest, EnforceSpillsOverToWarmerClients) {
+  CacheBudgetManager manager;
+  FakeClient cold(100, 10);
+  FakeClient hot(600, 20);
+  manager.Register("cold", &cold);
+  manager.Register("hot", &hot);
+
+  manager.SetBudget(300);
+  EXPECT_TRUE(manager.Enforce());
+  EXPECT_EQ(0, cold.used_bytes());
+  EXPECT_EQ(300, hot.used_bytes());
+
+  manager.Unregister(&cold);
+  manager.Unregister(&hot);
+}
+
+TEST(CacheBudgetManagerTest, EnforceAsksEachClientAtMostOnce) {
+  // A client which never releases anything must not be retried forever.
+  class StubbornClient : public CacheBudgetManager::Client {
+   public:
+    StubbornClient() : release_calls_(0) {}
+    virtual size_t UsedBytes() const { return 1000; }
+    virtual uint64 LastAccessTime() const { return 1; }
+    virtual size_t ReleaseBytes(size_t bytes) {
+      ++release_calls_;
+      return 0;
+    }
+    int release_calls_;
+  };
+
+  CacheBudgetManager manager;
+  StubbornClient client;
+  manager.Register("stubborn", &client);
+
+  manager.SetBudget(100);
+  EXPECT_FALSE(manager.Enforce());
+  EXPECT_EQ(1, client.release_calls_);
+
+  manager.Unregister(&client);
+}
+
+TEST(CacheBudgetManagerTest, UnregisteredClientIsNotTouched) {
+  CacheBudgetManager manager;
+  FakeClient client(1000, 1);
+  manager.Register("client", &client);
+  manager.Unregister(&client);
+  EXPECT_EQ(0, manager.TotalUsedBytes());
+
+  manager.SetBudget(100);
+  EXPECT_TRUE(manager.Enforce());
+  EXPECT_EQ(0, client.release_calls());
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace mozc
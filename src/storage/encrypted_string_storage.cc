@@ -35,10 +35,12 @@
 
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "base/encryptor.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/password_manager.h"
@@ -53,6 +55,84 @@ const size_t kSaltSize = 32;
 
 // Maximum file size (64Mbyte)
 const size_t kMaxFileSize = 64 * 1024 * 1024;
+
+// Chunked files start with this marker; in the legacy layout the file
+// starts with the random salt instead.
+const uint32 kChunkedStorageMagic = 0x72f3a81d;  // random seed
+const uint32 kChunkedStorageVersion = 1;
+
+const size_t kChunkedHeaderSize =
+    sizeof(kChunkedStorageMagic) + sizeof(kChunkedStorageVersion) + kSaltSize;
+
+// Derives the initialization vector of a record from the salt and the
+// record index, so that identical plaintext stored in different records
+// never produces identical ciphertext under the same key.
+void MakeChunkIv(const string &salt, uint32 chunk_index,
+                 std::vector<uint8> *iv) {
+  iv->resize(2 * sizeof(uint64));
+  const uint64 lo = Hash::FingerprintWithSeed(salt, 2 * chunk_index);
+  const uint64 hi = Hash::FingerprintWithSeed(salt, 2 * chunk_index + 1);
+  memcpy(&(*iv)[0], &lo, sizeof(lo));
+  memcpy(&(*iv)[sizeof(lo)], &hi, sizeof(hi));
+}
+
+struct ChunkRecord {
+  uint32 plain_size;
+  uint32 encrypted_size;
+  size_t offset;  // offset of the ciphertext in the file
+};
+
+// Collects the complete records of a chunked file.  A record that is
+// cut short -- the remainder of an interrupted append -- is dropped
+// with a warning and |*has_truncated_tail| is set.
+bool IndexChunks(const char *buf, size_t size,
+                 std::vector<ChunkRecord> *records,
+                 bool *has_truncated_tail) {
+  *has_truncated_tail = false;
+  size_t pos = kChunkedHeaderSize;
+  while (pos < size) {
+    ChunkRecord record;
+    if (pos + 2 * sizeof(uint32) > size) {
+      *has_truncated_tail = true;
+      break;
+    }
+    memcpy(&record.plain_size, buf + pos, sizeof(uint32));
+    memcpy(&record.encrypted_size, buf + pos + sizeof(uint32),
+           sizeof(uint32));
+    pos += 2 * sizeof(uint32);
+    if (record.encrypted_size > kMaxFileSize ||
+        record.plain_size > record.encrypted_size ||
+        pos + record.encrypted_size > size) {
+      *has_truncated_tail = true;
+      break;
+    }
+    record.offset = pos;
+    pos += record.encrypted_size;
+    records->push_back(record);
+  }
+  if (*has_truncated_tail) {
+    LOG(WARNING) << "dropping truncated chunk tail";
+  }
+  return true;
+}
+
+bool IsChunkedImage(const char *buf, size_t size) {
+  if (size < kChunkedHeaderSize) {
+    return false;
+  }
+  uint32 magic = 0;
+  memcpy(&magic, buf, sizeof(magic));
+  if (magic != kChunkedStorageMagic) {
+    return false;
+  }
+  uint32 version = 0;
+  memcpy(&version, buf + sizeof(magic), sizeof(version));
+  if (version != kChunkedStorageVersion) {
+    LOG(ERROR) << "Incompatible chunked storage version: " << version;
+    return false;
+  }
+  return true;
+}
 }  // namespace
 
 EncryptedStringStorage::EncryptedStringStorage(const string &filename)
@@ -83,6 +163,20 @@ bool EncryptedStringStorage::Load(string *output) const {
       return false;
     }
 
+    if (IsChunkedImage(mmap.begin(), mmap.size())) {
+      // Chunked layout: the whole string is the concatenation of all
+      // records.
+      std::vector<string> chunks;
+      if (!LoadChunks(0, &chunks)) {
+        return false;
+      }
+      output->clear();
+      for (size_t i = 0; i < chunks.size(); ++i) {
+        output->append(chunks[i]);
+      }
+      return true;
+    }
+
     // copy salt
     salt.assign(mmap.begin(), kSaltSize);
 
@@ -93,6 +187,61 @@ bool EncryptedStringStorage::Load(string *output) const {
   return Decrypt(salt, output);
 }
 
+bool EncryptedStringStorage::LoadChunks(size_t max_chunks,
+                                        std::vector<string> *chunks) const {
+  DCHECK(chunks);
+  chunks->clear();
+
+  Mmap mmap;
+  if (!mmap.Open(filename_.c_str(), "r")) {
+    LOG(ERROR) << "cannot open user history file";
+    return false;
+  }
+
+  if (mmap.size() > kMaxFileSize) {
+    LOG(ERROR) << "file size is too big.";
+    return false;
+  }
+
+  if (!IsChunkedImage(mmap.begin(), mmap.size())) {
+    // A legacy file is one big record.
+    string data;
+    if (!Load(&data)) {
+      return false;
+    }
+    chunks->push_back(data);
+    return true;
+  }
+
+  const string salt(
+      mmap.begin() + sizeof(kChunkedStorageMagic) +
+          sizeof(kChunkedStorageVersion),
+      kSaltSize);
+
+  std::vector<ChunkRecord> records;
+  bool has_truncated_tail = false;
+  IndexChunks(mmap.begin(), mmap.size(), &records, &has_truncated_tail);
+
+  size_t first = 0;
+  if (max_chunks != 0 && records.size() > max_chunks) {
+    first = records.size() - max_chunks;
+  }
+  for (size_t i = first; i < records.size(); ++i) {
+    string data(mmap.begin() + records[i].offset, records[i].encrypted_size);
+    if (!DecryptChunk(salt, static_cast<uint32>(i), &data)) {
+      LOG(ERROR) << "cannot decrypt chunk " << i;
+      return false;
+    }
+    if (data.size() != records[i].plain_size) {
+      LOG(ERROR) << "chunk " << i << " has unexpected size: " << data.size();
+      return false;
+    }
+    chunks->push_back(data);
+  }
+
+  return true;
+}
+
 bool EncryptedStringStorage::Decrypt(const string &salt, string *data) const {
   DCHECK(data);
 
@@ -192,5 +341,200 @@ bool EncryptedStringStorage::Encrypt(const string &salt, string *data) const {
   return true;
 }
 
+bool EncryptedStringStorage::EncryptChunk(const string &salt,
+                                          uint32 chunk_index,
+                                          string *data) const {
+  DCHECK(data);
+
+  string password;
+  if (!PasswordManager::GetPassword(&password)) {
+    LOG(ERROR) << "PasswordManager::GetPassword() failed";
+    return false;
+  }
+
+  if (password.empty()) {
+    LOG(ERROR) << "password is empty";
+    return false;
+  }
+
+  std::vector<uint8> iv;
+  MakeChunkIv(salt, chunk_index, &iv);
+
+  Encryptor::Key key;
+  if (!key.DeriveFromPassword(password, salt, &iv[0])) {
+    LOG(ERROR) << "Encryptor::Key::DeriveFromPassword() failed";
+    return false;
+  }
+
+  if (!Encryptor::EncryptString(key, data)) {
+    LOG(ERROR) << "Encryptor::EncryptString() failed";
+    return false;
+  }
+
+  return true;
+}
+
+bool EncryptedStringStorage::DecryptChunk(const string &salt,
+                                          uint32 chunk_index,
+                                          string *data) const {
+  DCHECK(data);
+
+  string password;
+  if (!PasswordManager::GetPassword(&password)) {
+    LOG(ERROR) << "PasswordManager::GetPassword() failed";
+    return false;
+  }
+
+  if (password.empty()) {
+    LOG(ERROR) << "password is empty";
+    return false;
+  }
+
+  std::vector<uint8> iv;
+  MakeChunkIv(salt, chunk_index, &iv);
+
+  Encryptor::Key key;
+  if (!key.DeriveFromPassword(password, salt, &iv[0])) {
+    LOG(ERROR) << "Encryptor::Key::DeriveFromPassword() failed";
+    return false;
+  }
+
+  if (!Encryptor::DecryptString(key, data)) {
+    LOG(ERROR) << "Encryptor::DecryptString() failed";
+    return false;
+  }
+
+  return true;
+}
+
+bool EncryptedStringStorage::AppendChunk(const string &chunk) const {
+  uint32 chunk_index = 0;
+  bool needs_rewrite = false;
+  std::vector<string> rewrite_chunks;
+
+  {
+    Mmap mmap;
+    if (!mmap.Open(filename_.c_str(), "r")) {
+      // Missing file: start a fresh chunked file.
+      needs_rewrite = true;
+    } else if (!IsChunkedImage(mmap.begin(), mmap.size())) {
+      // Legacy layout: convert the existing string into record 0 first.
+      string data;
+      if (!Load(&data)) {
+        LOG(ERROR) << "cannot convert legacy file: " << filename_;
+        return false;
+      }
+      rewrite_chunks.push_back(data);
+      needs_rewrite = true;
+    } else {
+      std::vector<ChunkRecord> records;
+      bool has_truncated_tail = false;
+      IndexChunks(mmap.begin(), mmap.size(), &records, &has_truncated_tail);
+      if (has_truncated_tail) {
+        // Rewrite the file from the surviving records so that the new
+        // record is not appended after garbage.
+        if (!LoadChunks(0, &rewrite_chunks)) {
+          return false;
+        }
+        needs_rewrite = true;
+      } else {
+        chunk_index = static_cast<uint32>(records.size());
+      }
+    }
+  }
+
+  // The mmap above must be closed before the file is replaced.
+  if (needs_rewrite) {
+    if (!RewriteChunks(rewrite_chunks)) {
+      return false;
+    }
+    chunk_index = static_cast<uint32>(rewrite_chunks.size());
+  }
+
+  string salt;
+  {
+    Mmap mmap;
+    if (!mmap.Open(filename_.c_str(), "r") ||
+        mmap.size() < kChunkedHeaderSize) {
+      LOG(ERROR) << "cannot open: " << filename_;
+      return false;
+    }
+    salt.assign(mmap.begin() + sizeof(kChunkedStorageMagic) +
+                    sizeof(kChunkedStorageVersion),
+                kSaltSize);
+  }
+
+  string data = chunk;
+  if (!EncryptChunk(salt, chunk_index, &data)) {
+    return false;
+  }
+
+  OutputFileStream ofs(filename_.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::app);
+  if (!ofs) {
+    LOG(ERROR) << "failed to append: " << filename_;
+    return false;
+  }
+  const uint32 plain_size = static_cast<uint32>(chunk.size());
+  const uint32 encrypted_size = static_cast<uint32>(data.size());
+  ofs.write(reinterpret_cast<const char *>(&plain_size), sizeof(plain_size));
+  ofs.write(reinterpret_cast<const char *>(&encrypted_size),
+            sizeof(encrypted_size));
+  ofs.write(data.data(), data.size());
+
+  return true;
+}
+
+bool EncryptedStringStorage::RewriteChunks(
+    const std::vector<string> &chunks) const {
+  string salt;
+  salt.resize(kSaltSize);
+  Util::GetRandomSequence(&salt[0], kSaltSize);
+
+  const string tmp_filename = filename_ + ".tmp";
+  {
+    OutputFileStream ofs(tmp_filename.c_str(),
+                         std::ios::out | std::ios::binary);
+    if (!ofs) {
+      LOG(ERROR) << "failed to write: " << tmp_filename;
+      return false;
+    }
+
+    ofs.write(reinterpret_cast<const char *>(&kChunkedStorageMagic),
+              sizeof(kChunkedStorageMagic));
+    ofs.write(reinterpret_cast<const char *>(&kChunkedStorageVersion),
+              sizeof(kChunkedStorageVersion));
+    ofs.write(salt.data(), salt.size());
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      string data = chunks[i];
+      if (!EncryptChunk(salt, static_cast<uint32>(i), &data)) {
+        return false;
+      }
+      const uint32 plain_size = static_cast<uint32>(chunks[i].size());
+      const uint32 encrypted_size = static_cast<uint32>(data.size());
+      ofs.write(reinterpret_cast<const char *>(&plain_size),
+                sizeof(plain_size));
+      ofs.write(reinterpret_cast<const char *>(&encrypted_size),
+                sizeof(encrypted_size));
+      ofs.write(data.data(), data.size());
+    }
+  }
+
+  if (!FileUtil::AtomicRename(tmp_filename, filename_)) {
+    LOG(ERROR) << "AtomicRename failed";
+    return false;
+  }
+
+#ifdef OS_WIN
+  if (!FileUtil::HideFile(filename_)) {
+    LOG(ERROR) << "Cannot make hidden: " << filename_
+               << " " << ::GetLastError();
+  }
+#endif
+
+  return true;
+}
+
 }  // namespace storage
 }  // namespace mozc
@@ -31,6 +31,7 @@
 #define MOZC_STORAGE_ENCRYPTED_STRING_STORAGE_H_
 
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 
@@ -45,6 +46,19 @@ class StringStorageInterface {
   virtual bool Save(const string &input) const = 0;
 };
 
+// Stores a string in an encrypted file.
+//
+// Two on-disk layouts are supported:
+//  - The legacy layout: |salt|ciphertext of the whole string|.
+//    Save() writes this layout.
+//  - The chunked layout: |magic|version|salt| followed by records of
+//    |plain_size|encrypted_size|ciphertext|.  Each record is encrypted
+//    independently with an initialization vector derived from the salt
+//    and the record index, so new records can be appended without
+//    re-encrypting the existing data and records can be decrypted
+//    selectively.  AppendChunk() writes this layout.
+// Load() detects the layout, so callers do not need to know how the
+// file was produced.
 class EncryptedStringStorage : public StringStorageInterface {
  public:
   explicit EncryptedStringStorage(const string &filename);
@@ -53,11 +67,33 @@ class EncryptedStringStorage : public StringStorageInterface {
   virtual bool Load(string *output) const;
   virtual bool Save(const string &input) const;
 
+  // Appends one encrypted record to the file.  A missing file is
+  // created and a file in the legacy layout is first converted to the
+  // chunked layout.  Note that Load() returns the concatenation of all
+  // records, so appending serialized protocol buffer messages yields
+  // their merge on load.
+  bool AppendChunk(const string &chunk) const;
+
+  // Loads the newest |max_chunks| records in file order.
+  // |max_chunks| == 0 means all records.  Also accepts a file in the
+  // legacy layout, which is treated as a single record.
+  bool LoadChunks(size_t max_chunks, std::vector<string> *chunks) const;
+
  protected:
   virtual bool Encrypt(const string &salt, string *data) const;
   virtual bool Decrypt(const string &salt, string *data) const;
 
+  // Per-record variants used by the chunked layout.  |chunk_index| is
+  // mixed into the initialization vector.
+  virtual bool EncryptChunk(const string &salt, uint32 chunk_index,
+                            string *data) const;
+  virtual bool DecryptChunk(const string &salt, uint32 chunk_index,
+                            string *data) const;
+
  private:
+  // Rewrites the whole file in the chunked layout with a fresh salt.
+  bool RewriteChunks(const std::vector<string> &chunks) const;
+
   string filename_;
 
   DISALLOW_COPY_AND_ASSIGN(EncryptedStringStorage);
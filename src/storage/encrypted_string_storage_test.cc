@@ -31,6 +31,7 @@
 
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
@@ -83,6 +84,9 @@ class EncryptedStringStorageTest : public testing::Test {
     SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
     filename_ = FileUtil::JoinPath(SystemUtil::GetUserProfileDirectory(),
                                    "encrypted_string_storage_for_test.db");
+    // Remove the storage left by an earlier test; a leftover legacy image
+    // would otherwise be migrated into an extra chunk by AppendChunk().
+    FileUtil::Unlink(filename_);
 
     storage_.reset(new TestEncryptedStringStorage(filename_));
   }
@@ -125,6 +129,73 @@ TEST_F(EncryptedStringStorageTest, Encrypt) {
   EXPECT_LT(original_data.size(), result.size());
   EXPECT_TRUE(result.find(original_data) == string::npos);
 }
+TEST_F(EncryptedStringStorageTest, AppendChunkAndLoad) {
+  ASSERT_TRUE(storage_->AppendChunk("first"));
+  ASSERT_TRUE(storage_->AppendChunk("second"));
+  ASSERT_TRUE(storage_->AppendChunk("third"));
+
+  // Load() returns the concatenation of all records.
+  string output;
+  ASSERT_TRUE(storage_->Load(&output));
+  EXPECT_EQ("firstsecondthird", output);
+
+  std::vector<string> chunks;
+  ASSERT_TRUE(storage_->LoadChunks(0, &chunks));
+  ASSERT_EQ(3, chunks.size());
+  EXPECT_EQ("first", chunks[0]);
+  EXPECT_EQ("second", chunks[1]);
+  EXPECT_EQ("third", chunks[2]);
+
+  // Partial load returns the newest records.
+  ASSERT_TRUE(storage_->LoadChunks(2, &chunks));
+  ASSERT_EQ(2, chunks.size());
+  EXPECT_EQ("second", chunks[0]);
+  EXPECT_EQ("third", chunks[1]);
+}
+
+TEST_F(EncryptedStringStorageTest, AppendChunkMigratesLegacyFile) {
+  ASSERT_TRUE(storage_->Save("legacy"));
+  ASSERT_TRUE(storage_->AppendChunk("-appended"));
+
+  string output;
+  ASSERT_TRUE(storage_->Load(&output));
+  EXPECT_EQ("legacy-appended", output);
+
+  std::vector<string> chunks;
+  ASSERT_TRUE(storage_->LoadChunks(0, &chunks));
+  ASSERT_EQ(2, chunks.size());
+  EXPECT_EQ("legacy", chunks[0]);
+  EXPECT_EQ("-appended", chunks[1]);
+}
+
+TEST_F(EncryptedStringStorageTest, TruncatedChunkTailIsDropped) {
+  ASSERT_TRUE(storage_->AppendChunk("first"));
+  ASSERT_TRUE(storage_->AppendChunk("second"));
+
+  // Simulate an interrupted append: only a fragment of the next record
+  // made it to the disk.
+  {
+    OutputFileStream ofs(filename_.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::app);
+    const uint32 plain_size = 100;
+    const uint32 encrypted_size = 112;
+    ofs.write(reinterpret_cast<const char *>(&plain_size),
+              sizeof(plain_size));
+    ofs.write(reinterpret_cast<const char *>(&encrypted_size),
+              sizeof(encrypted_size));
+    ofs.write("x", 1);
+  }
+
+  std::vector<string> chunks;
+  ASSERT_TRUE(storage_->LoadChunks(0, &chunks));
+  ASSERT_EQ(2, chunks.size());
+
+  // The next append repairs the file.
+  ASSERT_TRUE(storage_->AppendChunk("third"));
+  ASSERT_TRUE(storage_->LoadChunks(0, &chunks));
+  ASSERT_EQ(3, chunks.size());
+  EXPECT_EQ("third", chunks[2]);
+}
 #endif  // OS_ANDROID
 
 }  // namespace storage
@@ -54,6 +54,13 @@ inline uint32 BitsToWords(uint32 bits) {
   return words;
 }
 
+// Serialized blocked filters start with this marker instead of the bit
+// vector size; see ExistenceFilter::Read().
+const uint32 kBlockedFilterMagic = 0xb10cf117;
+
+// Probe block size of the blocked layout: one 64-byte cache line.
+const uint32 kProbeBlockBits = 512;
+
 }  // namespace
 
 class ExistenceFilter::BlockBitmap {
@@ -151,7 +158,9 @@ void ExistenceFilter::BlockBitmap::Clear() {
 ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k)
     : vec_size_(m ? m : 1),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      blocked_(false),
+      num_probe_blocks_(0) {
   CHECK_LT(num_hashes_, 8);
   rep_.reset(new BlockBitmap(m ? m : 1, true));
   rep_->Clear();
@@ -159,11 +168,17 @@ ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k)
 
 // this is private constructor
 ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
-                                 bool is_mutable)
+                                 bool is_mutable, bool blocked)
     : vec_size_(m ? m : 1),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      blocked_(blocked),
+      num_probe_blocks_(blocked ? (m ? m : 1) / kProbeBlockBits : 0) {
   CHECK_LT(num_hashes_, 8);
+  if (blocked_) {
+    CHECK_EQ(vec_size_ % kProbeBlockBits, 0);
+    CHECK_GT(num_probe_blocks_, 0);
+  }
   rep_.reset(new BlockBitmap(m ? m : 1, is_mutable));
   rep_->Clear();
 }
@@ -172,8 +187,9 @@ ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
 ExistenceFilter *
 ExistenceFilter::CreateImmutableExietenceFilter(uint32 m,
                                                 uint32 n,
-                                                int k) {
-  return new ExistenceFilter(m, n, k, false);
+                                                int k,
+                                                bool blocked) {
+  return new ExistenceFilter(m, n, k, false, blocked);
 }
 
 ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
@@ -200,6 +216,33 @@ ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
   return filter;
 }
 
+ExistenceFilter* ExistenceFilter::CreateOptimalBlocked(
+    size_t size_in_bytes, uint32 estimated_insertions) {
+  CHECK_LT(size_in_bytes, (1 << 29))
+                             << "Requested size is too big";
+  CHECK_GT(estimated_insertions, 0);
+  // Round up to whole probe blocks.
+  const uint32 m = (size_in_bytes * 8 + kProbeBlockBits - 1) /
+                   kProbeBlockBits * kProbeBlockBits;
+  const uint32 n = estimated_insertions;
+
+  int optimal_k = static_cast<int>((static_cast<float>(m) / n * log(2.0))
+                                   + 0.5);
+  if (optimal_k < 1) {
+    optimal_k = 1;
+  }
+  if (optimal_k > 7) {
+    optimal_k = 7;
+  }
+
+  VLOG(1) << "optimal_k: " << optimal_k;
+
+  ExistenceFilter *filter = new ExistenceFilter(m, n, optimal_k,
+                                                true, true);
+  CHECK(filter);
+  return filter;
+}
+
 ExistenceFilter::~ExistenceFilter() {
 }
 
@@ -237,6 +280,21 @@ bool ExistenceFilter::BlockBitmap::GetMutableFragment(uint32 *iter,
 }
 
 bool ExistenceFilter::Exists(uint64 hash) const {
+  if (blocked_) {
+    // All probes hit the 512-bit block selected by the hash, so a lookup
+    // touches a single cache line.
+    const uint32 base =
+        static_cast<uint32>(hash % num_probe_blocks_) * kProbeBlockBits;
+    for (size_t i = 0; i < num_hashes_; ++i) {
+      hash = RotateLeft64(hash, 8);
+      const uint32 index =
+          base + static_cast<uint32>(hash & (kProbeBlockBits - 1));
+      if (!rep_->Get(index)) {
+        return false;
+      }
+    }
+    return true;
+  }
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -248,6 +306,15 @@ bool ExistenceFilter::Exists(uint64 hash) const {
 }
 
 void ExistenceFilter::Insert(uint64 hash) {
+  if (blocked_) {
+    const uint32 base =
+        static_cast<uint32>(hash % num_probe_blocks_) * kProbeBlockBits;
+    for (size_t i = 0; i < num_hashes_; ++i) {
+      hash = RotateLeft64(hash, 8);
+      rep_->Set(base + static_cast<uint32>(hash & (kProbeBlockBits - 1)));
+    }
+    return;
+  }
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -276,7 +343,8 @@ size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
 // allocate 'buf' and write filter to the buf.
 // 'size' will hold the size of buf
 void ExistenceFilter::Write(char **buf, size_t *size) {
-  const int require_bytes = sizeof(Header) + Size();
+  const int require_bytes =
+      (blocked_ ? sizeof(kBlockedFilterMagic) : 0) + sizeof(Header) + Size();
 
   *buf = new char[require_bytes];
   CHECK(*buf);
@@ -285,6 +353,10 @@ void ExistenceFilter::Write(char **buf, size_t *size) {
   char *buf_ptr = *buf;
 
   // write header
+  if (blocked_) {
+    memcpy(buf_ptr, &kBlockedFilterMagic, sizeof(kBlockedFilterMagic));
+    buf_ptr += sizeof(kBlockedFilterMagic);
+  }
   memcpy(buf_ptr, &vec_size_, sizeof(vec_size_));
   buf_ptr += sizeof(vec_size_);
   memcpy(buf_ptr, &expected_nelts_, sizeof(expected_nelts_));
@@ -325,8 +397,22 @@ bool ExistenceFilter::ReadHeader(const char *buf, Header* header) {
 
 ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   Header header;
-  const uint32 header_bytes =
+  uint32 header_bytes =
       sizeof(header.m) + sizeof(header.n) + sizeof(header.k);
+
+  // The blocked layout is marked with a leading magic word; data in the
+  // old layout starts with the bit vector size instead.
+  bool blocked = false;
+  uint32 magic = 0;
+  if (size >= sizeof(magic)) {
+    memcpy(&magic, buf, sizeof(magic));
+    if (magic == kBlockedFilterMagic) {
+      blocked = true;
+      buf += sizeof(magic);
+      header_bytes += sizeof(magic);
+    }
+  }
+
   if (size < header_bytes) {
     LOG(ERROR) << "Not enough bufsize: could not read header";
     return NULL;
@@ -336,13 +422,17 @@ ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
     LOG(ERROR) << "Invalid format: could not read header";
     return NULL;
   }
-  buf += header_bytes;
+  if (blocked && (header.m == 0 || header.m % kProbeBlockBits != 0)) {
+    LOG(ERROR) << "Invalid blocked filter size: " << header.m;
+    return NULL;
+  }
+  buf += sizeof(header.m) + sizeof(header.n) + sizeof(header.k);
 
   const uint32 filter_size = BitsToWords(header.m);
   const uint32 filter_bytes = filter_size * sizeof(uint32);
   VLOG(1) << "Reading bloom filter with size: " << filter_bytes << " bytes, "
           << "estimated insertions: " << header.n << " (k: " << header.k
-          << ")";
+          << ", blocked: " << blocked << ")";
 
 
   if (size < header_bytes + filter_bytes) {
@@ -353,7 +443,8 @@ ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   ExistenceFilter* filter =
       ExistenceFilter::CreateImmutableExietenceFilter(header.m,
                                                       header.n,
-                                                      header.k);
+                                                      header.k,
+                                                      blocked);
   char **ptr = NULL;
   size_t n = 0;
   size_t read = 0;
@@ -135,6 +135,64 @@ TEST(ExistenceFilterTest, ReadWriteTest) {
   delete [] buf;
 }
 
+TEST(ExistenceFilterTest, BlockedRunTest) {
+  int n = 50000;
+  int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 50000);
+  LOG(INFO) << "Blocked test " << m << " " << n;
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimalBlocked(m, n));
+
+  for (int i = 0; i < n; ++i) {
+    int val = i * 2;
+    uint64 hash = Hash::Fingerprint(val);
+    filter->Insert(hash);
+  }
+
+  CheckValues(filter.get(), m, n);
+
+  // Read() should detect the blocked layout from the serialized data.
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  std::unique_ptr<ExistenceFilter> filter2(ExistenceFilter::Read(buf, size));
+  ASSERT_TRUE(filter2.get() != NULL);
+  CheckValues(filter2.get(), m, n);
+  filter2.reset();
+  delete[] buf;
+}
+
+TEST(ExistenceFilterTest, BlockedReadWriteTest) {
+  std::vector<string> words;
+  words.push_back("a");
+  words.push_back("b");
+  words.push_back("c");
+
+  static const float kErrorRate = 0.0001;
+  int num_bytes =
+      ExistenceFilter::MinFilterSizeInBytesForErrorRate(kErrorRate,
+                                                        words.size());
+
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimalBlocked(num_bytes, words.size()));
+
+  for (int i = 0; i < words.size(); ++i) {
+    filter->Insert(Hash::Fingerprint(words[i]));
+  }
+
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  std::unique_ptr<ExistenceFilter> filter_read(
+      ExistenceFilter::Read(buf, size));
+  ASSERT_TRUE(filter_read.get() != NULL);
+
+  for (int i = 0; i < words.size(); ++i) {
+    EXPECT_TRUE(filter_read->Exists(Hash::Fingerprint(words[i])));
+  }
+
+  delete [] buf;
+}
+
 TEST(ExistenceFilterTest, InsertAndExistsTest) {
   std::vector<string> words;
   words.push_back("a");
@@ -29,6 +29,8 @@
 
 #include "storage/louds/bit_stream.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 
 namespace mozc {
@@ -49,6 +51,35 @@ void BitStream::PushBit(int bit) {
   ++num_bits_;
 }
 
+void BitStream::PushBits(uint32 value, size_t num_bits) {
+  DCHECK_LE(num_bits, 32);
+  DCHECK(num_bits == 32 || (value >> num_bits) == 0);
+
+  // Fill up the current partial byte first.
+  const size_t shift = num_bits_ % 8;
+  if (shift != 0 && num_bits > 0) {
+    const size_t taken = std::min(num_bits, 8 - shift);
+    *image_.rbegin() |= static_cast<char>(
+        (value & ((1 << taken) - 1)) << shift);
+    value >>= taken;
+    num_bits -= taken;
+    num_bits_ += taken;
+  }
+
+  // Append the remaining whole bytes directly.
+  while (num_bits >= 8) {
+    image_.push_back(static_cast<char>(value & 0xFF));
+    value >>= 8;
+    num_bits -= 8;
+    num_bits_ += 8;
+  }
+
+  if (num_bits > 0) {
+    image_.push_back(static_cast<char>(value & ((1 << num_bits) - 1)));
+    num_bits_ += num_bits;
+  }
+}
+
 void BitStream::FillPadding32() {
   const size_t remaining = image_.length() % 4;
   if (remaining != 0) {
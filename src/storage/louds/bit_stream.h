@@ -49,6 +49,17 @@ class BitStream {
 
   void PushBit(int bit);
 
+  // Pushes the |num_bits| least significant bits of |value| at once, in
+  // the same order as |num_bits| PushBit() calls from bit 0 upwards.
+  // |num_bits| must not exceed 32.  Whole bytes are appended directly,
+  // so this is the preferred way to emit runs of bits in builders.
+  void PushBits(uint32 value, size_t num_bits);
+
+  // Reserves the backing store for |num_bits| bits.  Builders that know
+  // their element counts should call this up front to avoid repeated
+  // reallocation while the image grows.
+  void Reserve(size_t num_bits) { image_.reserve((num_bits + 7) / 8); }
+
   // Fills the padding (0-bit) until the size is aligned to 32bit boundary.
   void FillPadding32();
 
@@ -64,6 +64,29 @@ TEST_F(BitStreamTest, Pattern2) {
   EXPECT_EQ(string(64, '\xCC'), bit_stream.image());
 }
 
+TEST_F(BitStreamTest, PushBits) {
+  // Pushing words must produce the same image as bit-by-bit pushes.
+  BitStream bit_stream;
+  for (int i = 0; i < 16; ++i) {
+    bit_stream.PushBits(0xAAAAAAAA, 32);
+  }
+  EXPECT_EQ(64 * 8, bit_stream.num_bits());
+  EXPECT_EQ(string(64, '\xAA'), bit_stream.image());
+}
+
+TEST_F(BitStreamTest, PushBitsUnaligned) {
+  // Spans crossing byte boundaries keep the LSB-first bit order.
+  BitStream bit_stream;
+  bit_stream.PushBit(0);
+  bit_stream.PushBit(1);
+  bit_stream.PushBits(0x2A, 6);      // 0b101010
+  bit_stream.PushBits(0xCCAA, 16);
+  bit_stream.PushBits(0x0, 0);
+  bit_stream.PushBits(0x1, 3);
+  EXPECT_EQ(27, bit_stream.num_bits());
+  EXPECT_EQ(string("\xAA\xAA\xCC\x01", 4), bit_stream.image());
+}
+
 TEST_F(BitStreamTest, FillPadding32) {
   BitStream bit_stream;
 
@@ -36,48 +36,87 @@ namespace storage {
 namespace louds {
 namespace {
 
-// Select1 is not used, so cache is unnecessary.
-const size_t kLb0CacheSize = 1024;
-const size_t kLb1CacheSize = 0;
-
 inline int ReadInt32(const uint8 *data) {
   return *reinterpret_cast<const int32*>(data);
 }
 
 }  // namespace
 
-void BitVectorBasedArray::Open(const uint8 *image) {
+void BitVectorBasedArray::Open(const uint8 *image,
+                               size_t offset_sample_interval) {
+  DCHECK_GT(offset_sample_interval, 0);
   const int index_length = ReadInt32(image);
   const int base_length = ReadInt32(image + 4);
   const int step_length = ReadInt32(image + 8);
   // Check 0 padding.
   CHECK_EQ(ReadInt32(image + 12), 0);
 
-  index_.Init(image + 16, index_length, kLb0CacheSize, kLb1CacheSize);
+  // Get() neither ranks nor selects anymore (the offset directory below
+  // replaces Select0), so no caches are needed on the index.
+  index_.Init(image + 16, index_length);
   base_length_ = base_length;
   step_length_ = step_length;
+  offset_sample_interval_ = offset_sample_interval;
   data_ = reinterpret_cast<const char*>(image + 16 + index_length);
+
+  // Build the offset directory in a single pass over the bit vector.
+  // Trailing padding 0-bits are sampled as if they started elements,
+  // which is harmless since those indices are never queried.
+  offset_samples_.clear();
+  const size_t num_bits = 8 * index_length;
+  size_t element_index = 0;
+  size_t one_count = 0;
+  for (size_t bit_index = 0; bit_index < num_bits; ++bit_index) {
+    if (index_.Get(bit_index)) {
+      ++one_count;
+      continue;
+    }
+    if (element_index % offset_sample_interval_ == 0) {
+      const OffsetSample sample = {
+        static_cast<uint32>(bit_index), static_cast<uint32>(one_count),
+      };
+      offset_samples_.push_back(sample);
+    }
+    ++element_index;
+  }
 }
 
 void BitVectorBasedArray::Close() {
   index_.Reset();
   base_length_ = 0;
   step_length_ = 0;
+  offset_sample_interval_ = 0;
+  offset_samples_.clear();
   data_ = 0;
 }
 
 const char *BitVectorBasedArray::Get(size_t index, size_t *length) const {
   DCHECK(length);
-  const int bit_index = index_.Select0(index + 1);
-  const int data_index =
-      base_length_ * index + step_length_ * index_.Rank1(bit_index);
-  // Linear search.
-  int i = bit_index + 1;
+  DCHECK_LT(index / offset_sample_interval_, offset_samples_.size());
+  const OffsetSample &sample = offset_samples_[index / offset_sample_interval_];
+  size_t bit_index = sample.bit_index;
+  size_t one_count = sample.one_count;
+
+  // Walk from the sampled element to the requested one.  Each element
+  // is its start 0-bit followed by a run of 1-bits, so skipping one
+  // means scanning to the next 0-bit.
+  for (size_t remaining = index % offset_sample_interval_; remaining > 0;
+       --remaining) {
+    size_t i = bit_index + 1;
+    while (index_.Get(i)) {
+      ++i;
+    }
+    one_count += i - bit_index - 1;
+    bit_index = i;
+  }
+
+  // Linear search for the length of the requested element.
+  size_t i = bit_index + 1;
   while (index_.Get(i)) {
     ++i;
   }
   *length = base_length_ + step_length_ * (i - bit_index - 1);
-  return data_ + data_index;
+  return data_ + base_length_ * index + step_length_ * one_count;
 }
 
 }  // namespace louds
@@ -30,6 +30,8 @@
 #ifndef MOZC_STORAGE_LOUDS_BIT_VECTOR_BASED_ARRAY_H_
 #define MOZC_STORAGE_LOUDS_BIT_VECTOR_BASED_ARRAY_H_
 
+#include <vector>
+
 #include "base/port.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
@@ -44,7 +46,14 @@ class BitVectorBasedArray {
   BitVectorBasedArray() {
   }
 
-  void Open(const uint8 *image);
+  // Opens the array on |image|.  Open() also builds an in-memory offset
+  // directory holding every |offset_sample_interval|-th element's
+  // position, so Get() costs one directory load plus a scan over at
+  // most that many elements instead of a Select0 per access.  Smaller
+  // intervals trade memory (8 bytes per sample) for faster access.
+  static const size_t kDefaultOffsetSampleInterval = 64;
+  void Open(const uint8 *image,
+            size_t offset_sample_interval = kDefaultOffsetSampleInterval);
   void Close();
 
   // Returns a pointer to the element and its length.
@@ -52,9 +61,18 @@ class BitVectorBasedArray {
   const char *Get(size_t index, size_t *length) const;
 
  private:
+  // Position of a sampled element: its start bit in the bit vector and
+  // the number of 1-bits before it (which determines its byte offset).
+  struct OffsetSample {
+    uint32 bit_index;
+    uint32 one_count;
+  };
+
   SimpleSuccinctBitVectorIndex index_;
   size_t base_length_;
   size_t step_length_;
+  size_t offset_sample_interval_;
+  std::vector<OffsetSample> offset_samples_;
   const char *data_;
 
   DISALLOW_COPY_AND_ASSIGN(BitVectorBasedArray);
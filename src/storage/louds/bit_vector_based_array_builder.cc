@@ -29,6 +29,8 @@
 
 #include "storage/louds/bit_vector_based_array_builder.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "storage/louds/bit_stream.h"
 
@@ -74,6 +76,15 @@ void BitVectorBasedArrayBuilder::Build() {
   BitStream bit_stream;
   string data;
 
+  // Size the outputs ahead: every element costs at least one bit and
+  // base_length_ bytes of (padded) data, plus one sentinel bit.
+  size_t total_length = 0;
+  for (size_t i = 0; i < elements_.size(); ++i) {
+    total_length += elements_[i].length();
+  }
+  bit_stream.Reserve(elements_.size() + total_length / step_length_ + 1);
+  data.reserve(std::max(total_length, elements_.size() * base_length_));
+
   // Output to the bit_stream and the data.
   for (size_t i = 0; i < elements_.size(); ++i) {
     const string &element = elements_[i];
@@ -89,8 +100,9 @@ void BitVectorBasedArrayBuilder::Build() {
     size_t output_length = base_length_ + num_steps * step_length_;
     DCHECK_GE(output_length, element.length());
     bit_stream.PushBit(0);
-    for (int j = 0; j < num_steps; ++j) {
-      bit_stream.PushBit(1);
+    for (int remaining = num_steps; remaining > 0; remaining -= 32) {
+      const int chunk = std::min(remaining, 32);
+      bit_stream.PushBits(chunk == 32 ? ~0u : (1u << chunk) - 1, chunk);
     }
 
     // Output word data (excluding '\0' termination) and then padding by '\0'
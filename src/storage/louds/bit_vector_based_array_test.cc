@@ -82,4 +82,32 @@ TEST_F(BitVectorBasedArrayTest, Get) {
 
   array.Close();
 }
+
+TEST_F(BitVectorBasedArrayTest, OffsetSampleInterval) {
+  // Elements of growing length so sampled and scanned elements have
+  // different sizes.
+  BitVectorBasedArrayBuilder builder;
+  const size_t kNumElements = 100;
+  for (size_t i = 0; i < kNumElements; ++i) {
+    builder.Add(string(i % 13, 'a' + i % 26));
+  }
+  builder.SetSize(2, 1);
+  builder.Build();
+
+  // Every element must be found regardless of the sampling interval.
+  const size_t kIntervals[] = { 1, 3, 8, 64, 1000 };
+  for (size_t j = 0; j < arraysize(kIntervals); ++j) {
+    BitVectorBasedArray array;
+    array.Open(reinterpret_cast<const uint8*>(builder.image().data()),
+               kIntervals[j]);
+    for (size_t i = 0; i < kNumElements; ++i) {
+      size_t length;
+      const char *result = array.Get(i, &length);
+      EXPECT_LE(i % 13, length);
+      EXPECT_EQ(string(i % 13, 'a' + i % 26),
+                string(result, i % 13));
+    }
+    array.Close();
+  }
+}
 }  // namespace
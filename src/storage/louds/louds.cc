@@ -41,7 +41,32 @@ void Louds::Init(const uint8 *image, int length,
                  size_t bitvec_lb0_cache_size, size_t bitvec_lb1_cache_size,
                  size_t select0_cache_size, size_t select1_cache_size) {
   index_.Init(image, length, bitvec_lb0_cache_size, bitvec_lb1_cache_size);
+  InitSelectCaches(select0_cache_size, select1_cache_size);
+}
+
+size_t Louds::RankDirectorySize(int length) {
+  // |index_| is default-constructed, so the chunk size is 32 and no
+  // word-level rank directory is built.
+  return SimpleSuccinctBitVectorIndex::RankDirectorySize(length, 32, false);
+}
+
+void Louds::InitWithSharedRankDirectory(const uint8 *image, int length,
+                                        size_t bitvec_lb0_cache_size,
+                                        size_t bitvec_lb1_cache_size,
+                                        size_t select0_cache_size,
+                                        size_t select1_cache_size,
+                                        void *rank_directory,
+                                        bool init_rank_directory) {
+  index_.InitWithSharedRankDirectory(image, length,
+                                     bitvec_lb0_cache_size,
+                                     bitvec_lb1_cache_size,
+                                     false,  // No word-level rank directory.
+                                     rank_directory, init_rank_directory);
+  InitSelectCaches(select0_cache_size, select1_cache_size);
+}
 
+void Louds::InitSelectCaches(size_t select0_cache_size,
+                             size_t select1_cache_size) {
   // Cap the cache sizes.
   if (select0_cache_size > index_.GetNum0Bits()) {
     select0_cache_size = index_.GetNum0Bits();
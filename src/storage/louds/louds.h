@@ -106,6 +106,22 @@ class Louds {
     Init(image, length, 0, 0, 0, 0);
   }
 
+  // Returns the size in bytes of the rank directory that Init() builds
+  // over a bit array of |length| bytes.
+  static size_t RankDirectorySize(int length);
+
+  // Variant of Init() that keeps the rank directory of the underlying bit
+  // vector in caller-owned memory of RankDirectorySize(length) bytes; see
+  // SimpleSuccinctBitVectorIndex::InitWithSharedRankDirectory().  The
+  // select caches are always built locally.
+  void InitWithSharedRankDirectory(const uint8 *image, int length,
+                                   size_t bitvec_lb0_cache_size,
+                                   size_t bitvec_lb1_cache_size,
+                                   size_t select0_cache_size,
+                                   size_t select1_cache_size,
+                                   void *rank_directory,
+                                   bool init_rank_directory);
+
   // Explicitly clears the internal bit array.
   void Reset();
 
@@ -170,6 +186,10 @@ class Louds {
   }
 
  private:
+  // Builds the select caches over the initialized |index_|; shared tail of
+  // the two Init() variants.
+  void InitSelectCaches(size_t select0_cache_size, size_t select1_cache_size);
+
   SimpleSuccinctBitVectorIndex index_;
   size_t select0_cache_size_;
   size_t select1_cache_size_;
@@ -50,7 +50,53 @@ bool LoudsTrie::Open(const uint8 *image,
                      size_t louds_lb1_cache_size,
                      size_t louds_select0_cache_size,
                      size_t louds_select1_cache_size,
-                     size_t termvec_lb1_cache_size) {
+                     size_t termvec_lb1_cache_size,
+                     size_t child_cache_levels) {
+  return OpenInternal(image, louds_lb0_cache_size, louds_lb1_cache_size,
+                      louds_select0_cache_size, louds_select1_cache_size,
+                      termvec_lb1_cache_size, child_cache_levels,
+                      nullptr, false);
+}
+
+size_t LoudsTrie::SharedRankDirectorySize(const uint8 *image) {
+  const int louds_size = ReadInt32(image);
+  const int terminal_size = ReadInt32(image + 4);
+  // The layout is the LOUDS directory followed by the terminal bit vector
+  // directory; see OpenInternal().  The LOUDS directory is a multiple of
+  // sizeof(int) bytes, so the terminal directory stays aligned, but the
+  // word-level index at its end is byte-granular; round the total up so
+  // that a directory packed after this one is aligned again.
+  const size_t size =
+      Louds::RankDirectorySize(louds_size) +
+      SimpleSuccinctBitVectorIndex::RankDirectorySize(terminal_size, 32, true);
+  return (size + sizeof(int) - 1) & ~(sizeof(int) - 1);
+}
+
+bool LoudsTrie::OpenWithSharedRankDirectories(const uint8 *image,
+                                              size_t louds_lb0_cache_size,
+                                              size_t louds_lb1_cache_size,
+                                              size_t louds_select0_cache_size,
+                                              size_t louds_select1_cache_size,
+                                              size_t termvec_lb1_cache_size,
+                                              size_t child_cache_levels,
+                                              void *rank_directories,
+                                              bool init_rank_directories) {
+  DCHECK(rank_directories != nullptr);
+  return OpenInternal(image, louds_lb0_cache_size, louds_lb1_cache_size,
+                      louds_select0_cache_size, louds_select1_cache_size,
+                      termvec_lb1_cache_size, child_cache_levels,
+                      rank_directories, init_rank_directories);
+}
+
+bool LoudsTrie::OpenInternal(const uint8 *image,
+                             size_t louds_lb0_cache_size,
+                             size_t louds_lb1_cache_size,
+                             size_t louds_select0_cache_size,
+                             size_t louds_select1_cache_size,
+                             size_t termvec_lb1_cache_size,
+                             size_t child_cache_levels,
+                             void *rank_directories,
+                             bool init_rank_directories) {
   // Reads a binary image data, which is compatible with rx.
   // The format is as follows:
   // [trie size: little endian 4byte int]
@@ -84,14 +130,38 @@ bool LoudsTrie::Open(const uint8 *image,
   const uint8 *terminal_image = louds_image + louds_size;
   const uint8 *edge_character = terminal_image + terminal_size;
 
-  louds_.Init(louds_image, louds_size,
-              louds_lb0_cache_size, louds_lb1_cache_size,
-              louds_select0_cache_size, louds_select1_cache_size);
-  terminal_bit_vector_.Init(terminal_image, terminal_size,
-                            0,  // Select0 is not carried out.
-                            termvec_lb1_cache_size);
+  if (rank_directories == nullptr) {
+    louds_.Init(louds_image, louds_size,
+                louds_lb0_cache_size, louds_lb1_cache_size,
+                louds_select0_cache_size, louds_select1_cache_size);
+    terminal_bit_vector_.Init(terminal_image, terminal_size,
+                              0,  // Select0 is not carried out.
+                              termvec_lb1_cache_size,
+                              // Every GetKeyIdOfTerminalNode() performs Rank1,
+                              // so build the word-level rank directory too.
+                              true);
+  } else {
+    // Caller-owned (typically shared) rank directories: the LOUDS directory
+    // first, then the terminal bit vector's; see SharedRankDirectorySize().
+    uint8 *louds_directory = reinterpret_cast<uint8 *>(rank_directories);
+    uint8 *terminal_directory =
+        louds_directory + Louds::RankDirectorySize(louds_size);
+    louds_.InitWithSharedRankDirectory(
+        louds_image, louds_size,
+        louds_lb0_cache_size, louds_lb1_cache_size,
+        louds_select0_cache_size, louds_select1_cache_size,
+        louds_directory, init_rank_directories);
+    terminal_bit_vector_.InitWithSharedRankDirectory(
+        terminal_image, terminal_size,
+        0,  // Select0 is not carried out.
+        termvec_lb1_cache_size,
+        true,  // Word-level rank directory, as in Open().
+        terminal_directory, init_rank_directories);
+  }
   edge_character_ = reinterpret_cast<const char*>(edge_character);
 
+  BuildChildCache(child_cache_levels);
+
   return true;
 }
 
@@ -99,9 +169,71 @@ void LoudsTrie::Close() {
   louds_.Reset();
   terminal_bit_vector_.Reset();
   edge_character_ = nullptr;
+  child_cache_limit_ = 1;
+  child_cache_begin_.clear();
+  child_cache_labels_.clear();
+  child_cache_first_child_.clear();
+}
+
+void LoudsTrie::BuildChildCache(size_t num_levels) {
+  child_cache_limit_ = 1;
+  child_cache_begin_.clear();
+  child_cache_labels_.clear();
+  child_cache_first_child_.clear();
+  if (num_levels == 0) {
+    return;
+  }
+
+  // Index 0 of the arrays is unused so that they can be indexed directly by
+  // node ID; see the comment in the header.
+  child_cache_begin_.push_back(0);
+  child_cache_begin_.push_back(0);
+  child_cache_first_child_.resize(1);
+
+  int level_begin = 1;  // ID range of the current level:
+  int level_end = 2;    // [level_begin, level_end).
+  for (size_t level = 0; level < num_levels && level_begin < level_end;
+       ++level) {
+    for (int node_id = level_begin; node_id < level_end; ++node_id) {
+      Node node;
+      louds_.InitNodeFromNodeId(node_id, &node);
+      louds_.MoveToFirstChild(&node);
+      child_cache_first_child_.push_back(node);
+      while (louds_.IsValidNode(node)) {
+        child_cache_labels_.push_back(GetEdgeLabelToParentNode(node));
+        Louds::MoveToNextSibling(&node);
+      }
+      child_cache_begin_.push_back(
+          static_cast<int>(child_cache_labels_.size()));
+    }
+    level_begin = level_end;
+    // Node IDs are assigned in BFS order starting at 2 for the root's first
+    // child, so the next level ends right after all the edges decoded so far.
+    level_end = static_cast<int>(2 + child_cache_labels_.size());
+  }
+  child_cache_limit_ = level_begin;
 }
 
 bool LoudsTrie::MoveToChildByLabel(char label, Node *node) const {
+  if (node->node_id() < child_cache_limit_) {
+    // The children of this node were decoded at Open() time; scan the plain
+    // label array instead of the bit vector.
+    const int node_id = node->node_id();
+    Node child = child_cache_first_child_[node_id];
+    const char *iter = child_cache_labels_.data() + child_cache_begin_[node_id];
+    const char *end =
+        child_cache_labels_.data() + child_cache_begin_[node_id + 1];
+    for (; iter != end; ++iter, Louds::MoveToNextSibling(&child)) {
+      if (*iter == label) {
+        *node = child;
+        return true;
+      }
+    }
+    // Invalid; one edge past the last child, as in the uncached path below.
+    *node = child;
+    return false;
+  }
+
   MoveToFirstChild(node);
   while (IsValidNode(*node)) {
     if (GetEdgeLabelToParentNode(*node) == label) {
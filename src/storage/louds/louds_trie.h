@@ -31,6 +31,7 @@
 #define MOZC_STORAGE_LOUDS_LOUDS_TRIE_H_
 
 #include <memory>
+#include <vector>
 
 #include "base/port.h"
 #include "base/string_piece.h"
@@ -49,26 +50,67 @@ class LoudsTrie {
   // This class stores a traversal state.
   typedef Louds::Node Node;
 
-  LoudsTrie() : edge_character_(nullptr) {}
+  LoudsTrie() : edge_character_(nullptr), child_cache_limit_(1) {}
   ~LoudsTrie() {}
 
   // Opens the binary image and constructs the data structure.  The first four
   // cache sizes are passed to the underlying LOUDS.  See louds.h for more
-  // information of cache size.  The last one is passed to the underlying
-  // terminal bit vector.  This class doesn't own the "data", so it is caller's
-  // reponsibility to keep the data alive until Close is invoked.  See .cc file
-  // for the detailed format of the binary image.
+  // information of cache size.  The next one is passed to the underlying
+  // terminal bit vector.  |child_cache_levels| is the number of top trie
+  // levels for which the edges are decoded into a plain adjacency cache at
+  // open time; MoveToChildByLabel() on nodes of those levels then runs on
+  // decoded arrays without touching the bit vector.  The top of a trie never
+  // changes and is visited by every traversal, so a few levels suffice.
+  // This class doesn't own the "data", so it is caller's reponsibility to
+  // keep the data alive until Close is invoked.  See .cc file for the
+  // detailed format of the binary image.
   bool Open(const uint8 *data,
             size_t louds_lb0_cache_size,
             size_t louds_lb1_cache_size,
             size_t louds_select0_cache_size,
             size_t louds_select1_cache_size,
-            size_t termvec_lb1_cache_size);
+            size_t termvec_lb1_cache_size,
+            size_t child_cache_levels);
+
+  bool Open(const uint8 *data,
+            size_t louds_lb0_cache_size,
+            size_t louds_lb1_cache_size,
+            size_t louds_select0_cache_size,
+            size_t louds_select1_cache_size,
+            size_t termvec_lb1_cache_size) {
+    return Open(data, louds_lb0_cache_size, louds_lb1_cache_size,
+                louds_select0_cache_size, louds_select1_cache_size,
+                termvec_lb1_cache_size, 0);
+  }
 
   bool Open(const uint8 *data) {
-    return Open(data, 0, 0, 0, 0, 0);
+    return Open(data, 0, 0, 0, 0, 0, 0);
   }
 
+  // Returns the size in bytes of the rank directories (of the LOUDS and of
+  // the terminal bit vector) that Open() builds for the image |data|.  The
+  // returned size is rounded up to the alignment the directories require,
+  // so directories of several tries can be packed back to back.
+  static size_t SharedRankDirectorySize(const uint8 *data);
+
+  // Variant of Open() that keeps the rank directories in caller-owned
+  // memory of SharedRankDirectorySize(data) bytes, e.g. a named
+  // shared-memory segment mapped by several processes opening the same
+  // image.  When |init_rank_directories| is true the directories are
+  // computed and stored there; otherwise the memory must already hold the
+  // directories built from the same image, and it is only read.  The
+  // lower-bound, select and child caches are always built locally; they
+  // are small compared to the directories.
+  bool OpenWithSharedRankDirectories(const uint8 *data,
+                                     size_t louds_lb0_cache_size,
+                                     size_t louds_lb1_cache_size,
+                                     size_t louds_select0_cache_size,
+                                     size_t louds_select1_cache_size,
+                                     size_t termvec_lb1_cache_size,
+                                     size_t child_cache_levels,
+                                     void *rank_directories,
+                                     bool init_rank_directories);
+
   // Destructs the internal data structure explicitly (the destructor will do
   // clean up too).
   void Close();
@@ -195,6 +237,22 @@ class LoudsTrie {
   }
 
  private:
+  // Shared implementation of Open() and OpenWithSharedRankDirectories();
+  // |rank_directories| == nullptr selects the heap-building path.
+  bool OpenInternal(const uint8 *data,
+                    size_t louds_lb0_cache_size,
+                    size_t louds_lb1_cache_size,
+                    size_t louds_select0_cache_size,
+                    size_t louds_select1_cache_size,
+                    size_t termvec_lb1_cache_size,
+                    size_t child_cache_levels,
+                    void *rank_directories,
+                    bool init_rank_directories);
+
+  // Decodes the edges of the top |num_levels| trie levels into the child
+  // cache arrays below.  Called from Open().
+  void BuildChildCache(size_t num_levels);
+
   Louds louds_;  // Tree structure representation by LOUDS.
 
   // Bit-vector to represent whether each node in LOUDS tree is terminal.
@@ -210,6 +268,18 @@ class LoudsTrie {
   // In other words, id=2 in louds_ corresponds to edge_character_[1].
   const char *edge_character_;
 
+  // Decoded adjacency cache for the top trie levels; see Open().  Nodes are
+  // numbered in BFS order, so the cached nodes occupy the contiguous ID
+  // range [1, child_cache_limit_), and the arrays below are indexed directly
+  // by node ID (index 0 is unused).  The labels of node |i|'s children are
+  // child_cache_labels_[child_cache_begin_[i]] ...
+  // child_cache_labels_[child_cache_begin_[i + 1] - 1], in sibling order
+  // starting at child_cache_first_child_[i].
+  int child_cache_limit_;
+  std::vector<int> child_cache_begin_;
+  std::vector<char> child_cache_labels_;
+  std::vector<Node> child_cache_first_child_;
+
   DISALLOW_COPY_AND_ASSIGN(LoudsTrie);
 };
 
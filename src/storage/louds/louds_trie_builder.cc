@@ -30,6 +30,7 @@
 #include "storage/louds/louds_trie_builder.h"
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "base/logging.h"
@@ -43,12 +44,72 @@ namespace louds {
 LoudsTrieBuilder::LoudsTrieBuilder() : built_(false) {
 }
 
+namespace {
+
+struct LabelFrequencyGreaterThan {
+  inline bool operator()(const std::pair<uint64, int> &lhs,
+                         const std::pair<uint64, int> &rhs) const {
+    if (lhs.first != rhs.first) {
+      return lhs.first > rhs.first;
+    }
+    return lhs.second < rhs.second;
+  }
+};
+
+// Lexicographic less-than under the alphabet permutation defined by
+// |label_rank|.  Words sharing a prefix remain adjacent in the sorted list,
+// which is all Build() relies on; only the relative order of siblings
+// changes.
+class WordLabelRankLessThan {
+ public:
+  explicit WordLabelRankLessThan(const std::vector<uint8> &label_rank)
+      : label_rank_(&label_rank) {
+  }
+
+  bool operator()(const string &lhs, const string &rhs) const {
+    const size_t min_length = std::min(lhs.length(), rhs.length());
+    for (size_t i = 0; i < min_length; ++i) {
+      const uint8 lhs_rank = (*label_rank_)[static_cast<uint8>(lhs[i])];
+      const uint8 rhs_rank = (*label_rank_)[static_cast<uint8>(rhs[i])];
+      if (lhs_rank != rhs_rank) {
+        return lhs_rank < rhs_rank;
+      }
+    }
+    return lhs.length() < rhs.length();
+  }
+
+ private:
+  const std::vector<uint8> *label_rank_;
+};
+
+}  // namespace
+
 void LoudsTrieBuilder::Add(const string &word) {
   CHECK(!built_);
   CHECK(!word.empty());
   word_list_.push_back(word);
 }
 
+void LoudsTrieBuilder::SetLabelFrequency(
+    const std::vector<uint64> &label_frequency) {
+  CHECK(!built_);
+  CHECK_EQ(label_frequency.size(), 256);
+
+  // Rank the labels by descending frequency.  Ties are broken by the byte
+  // value to keep the image deterministic.
+  std::vector<std::pair<uint64, int> > labels;
+  labels.reserve(256);
+  for (int label = 0; label < 256; ++label) {
+    labels.push_back(std::make_pair(label_frequency[label], label));
+  }
+  std::sort(labels.begin(), labels.end(), LabelFrequencyGreaterThan());
+
+  label_rank_.resize(256);
+  for (int rank = 0; rank < 256; ++rank) {
+    label_rank_[labels[rank].second] = rank;
+  }
+}
+
 namespace {
 
 // A pair of word and its original index in the (sorted) word_list_.
@@ -95,7 +156,12 @@ void LoudsTrieBuilder::Build() {
   CHECK(!built_);
 
   // Initialize for the build. Sort and de-dup the words.
-  std::sort(word_list_.begin(), word_list_.end());
+  if (label_rank_.empty()) {
+    std::sort(word_list_.begin(), word_list_.end());
+  } else {
+    std::sort(word_list_.begin(), word_list_.end(),
+              WordLabelRankLessThan(label_rank_));
+  }
   word_list_.erase(std::unique(word_list_.begin(), word_list_.end()),
                    word_list_.end());
   std::vector<Entry> entry_list;
@@ -110,9 +176,19 @@ void LoudsTrieBuilder::Build() {
   BitStream terminal_stream;
   string edge_character;
 
-  // Push root.
-  trie_stream.PushBit(1);
-  trie_stream.PushBit(0);
+  // Size the streams ahead.  The trie has at most one node per input
+  // character plus the root, each node costs one edge bit and one stop
+  // bit in the LOUDS stream, one terminal bit and one edge character.
+  size_t total_length = 0;
+  for (size_t i = 0; i < word_list_.size(); ++i) {
+    total_length += word_list_[i].length();
+  }
+  trie_stream.Reserve(2 * (total_length + 1));
+  terminal_stream.Reserve(total_length + 1);
+  edge_character.reserve(total_length + 1);
+
+  // Push root ('1' for the edge, '0' as the stop bit).
+  trie_stream.PushBits(0x1, 2);
   edge_character.push_back('\0');
   terminal_stream.PushBit(0);
 
@@ -222,9 +298,12 @@ const string &LoudsTrieBuilder::image() const {
 int LoudsTrieBuilder::GetId(const string &word) const {
   CHECK(built_);
 
-  // Binary search the word.
-  std::vector<string>::const_iterator iter =
-      std::lower_bound(word_list_.begin(), word_list_.end(), word);
+  // Binary search the word.  The word list must be searched with the same
+  // ordering used for sorting it in Build().
+  std::vector<string>::const_iterator iter = label_rank_.empty()
+      ? std::lower_bound(word_list_.begin(), word_list_.end(), word)
+      : std::lower_bound(word_list_.begin(), word_list_.end(), word,
+                         WordLabelRankLessThan(label_rank_));
   if (iter == word_list_.end() || *iter != word) {
     // Not found.
     return -1;
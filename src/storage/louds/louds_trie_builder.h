@@ -47,6 +47,13 @@ class LoudsTrieBuilder {
   // before Build invocation.
   void Add(const string &word);
 
+  // Sets the observed frequency of each edge label (byte); |label_frequency|
+  // must have 256 entries.  When set, Build() places the children of every
+  // node in descending label frequency order instead of byte order, so that
+  // linear sibling scans during traversal reach hot children with fewer
+  // advances.  It is necessary to call this method before Build invocation.
+  void SetLabelFrequency(const std::vector<uint64> &label_frequency);
+
   // Builds the trie image.
   void Build();
 
@@ -65,6 +72,11 @@ class LoudsTrieBuilder {
   std::vector<int> id_list_;
   string image_;
 
+  // Maps each label (byte) to its position in the sibling ordering.
+  // Empty unless SetLabelFrequency() is called; then words are ordered
+  // in plain byte order.
+  std::vector<uint8> label_rank_;
+
   DISALLOW_COPY_AND_ASSIGN(LoudsTrieBuilder);
 };
 
@@ -78,13 +78,24 @@ struct CacheSizeParam {
         louds_lb1_cache_size(lb1),
         louds_select0_cache_size(s0),
         louds_select1_cache_size(s1),
-        termvec_lb1_cache_size(term_lb1) {}
+        termvec_lb1_cache_size(term_lb1),
+        child_cache_levels(0) {}
+
+  CacheSizeParam(size_t lb0, size_t lb1, size_t s0, size_t s1, size_t term_lb1,
+                 size_t levels)
+      : louds_lb0_cache_size(lb0),
+        louds_lb1_cache_size(lb1),
+        louds_select0_cache_size(s0),
+        louds_select1_cache_size(s1),
+        termvec_lb1_cache_size(term_lb1),
+        child_cache_levels(levels) {}
 
   size_t louds_lb0_cache_size;
   size_t louds_lb1_cache_size;
   size_t louds_select0_cache_size;
   size_t louds_select1_cache_size;
   size_t termvec_lb1_cache_size;
+  size_t child_cache_levels;
 };
 
 class LoudsTrieTest : public ::testing::TestWithParam<CacheSizeParam> {};
@@ -127,7 +138,11 @@ class LoudsTrieTest : public ::testing::TestWithParam<CacheSizeParam> {};
           CacheSizeParam(1, 1, 1, 1, 1),                                \
           CacheSizeParam(2, 2, 2, 2, 2),                                \
           CacheSizeParam(8, 8, 8, 8, 8),                                \
-          CacheSizeParam(1024, 1024, 1024, 1024, 1024)));
+          CacheSizeParam(1024, 1024, 1024, 1024, 1024),                 \
+          CacheSizeParam(0, 0, 0, 0, 0, 1),                             \
+          CacheSizeParam(0, 0, 0, 0, 0, 2),                             \
+          CacheSizeParam(1, 1, 1, 1, 1, 3),                             \
+          CacheSizeParam(1024, 1024, 1024, 1024, 1024, 8)));
 
 TEST_P(LoudsTrieTest, NodeBasedApis) {
   // Create the following trie (* stands for non-terminal nodes):
@@ -157,7 +172,8 @@ TEST_P(LoudsTrieTest, NodeBasedApis) {
             param.louds_lb1_cache_size,
             param.louds_select0_cache_size,
             param.louds_select1_cache_size,
-            param.termvec_lb1_cache_size);
+            param.termvec_lb1_cache_size,
+            param.child_cache_levels);
 
   char buf[LoudsTrie::kMaxDepth + 1];  // for RestoreKeyString().
 
@@ -377,7 +393,8 @@ TEST_P(LoudsTrieTest, HasKey) {
             param.louds_lb1_cache_size,
             param.louds_select0_cache_size,
             param.louds_select1_cache_size,
-            param.termvec_lb1_cache_size);
+            param.termvec_lb1_cache_size,
+            param.child_cache_levels);
 
   EXPECT_TRUE(trie.HasKey("a"));
   EXPECT_TRUE(trie.HasKey("abc"));
@@ -433,6 +450,82 @@ TEST(LoudsTrieTest, ExactSearch) {
 }
 INSTANTIATE_TEST_CASE(GenHasKeyTest);
 
+TEST(LoudsTrieTest, LabelFrequencyOrdersSiblings) {
+  LoudsTrieBuilder builder;
+  builder.Add("a");
+  builder.Add("ac");
+  builder.Add("b");
+  builder.Add("ba");
+  builder.Add("bc");
+  builder.Add("c");
+
+  std::vector<uint64> label_frequency(256, 0);
+  label_frequency['b'] = 100;
+  label_frequency['c'] = 10;
+  label_frequency['a'] = 1;
+  builder.SetLabelFrequency(label_frequency);
+  builder.Build();
+
+  LoudsTrie trie;
+  trie.Open(reinterpret_cast<const uint8 *>(builder.image().data()));
+
+  // Siblings are laid out in descending frequency order.
+  LoudsTrie::Node node;
+  trie.MoveToFirstChild(&node);
+  EXPECT_EQ('b', trie.GetEdgeLabelToParentNode(node));
+  trie.MoveToNextSibling(&node);
+  EXPECT_EQ('c', trie.GetEdgeLabelToParentNode(node));
+  trie.MoveToNextSibling(&node);
+  EXPECT_EQ('a', trie.GetEdgeLabelToParentNode(node));
+
+  // All keys are still searchable with ids consistent with the builder.
+  EXPECT_EQ(builder.GetId("a"), trie.ExactSearch("a"));
+  EXPECT_EQ(builder.GetId("ac"), trie.ExactSearch("ac"));
+  EXPECT_EQ(builder.GetId("b"), trie.ExactSearch("b"));
+  EXPECT_EQ(builder.GetId("ba"), trie.ExactSearch("ba"));
+  EXPECT_EQ(builder.GetId("bc"), trie.ExactSearch("bc"));
+  EXPECT_EQ(builder.GetId("c"), trie.ExactSearch("c"));
+  EXPECT_EQ(-1, trie.ExactSearch("ab"));
+  EXPECT_EQ(-1, trie.ExactSearch("bb"));
+  trie.Close();
+}
+
+TEST(LoudsTrieTest, SharedRankDirectories) {
+  LoudsTrieBuilder builder;
+  builder.Add("a");
+  builder.Add("abc");
+  builder.Add("abcd");
+  builder.Add("ae");
+  builder.Add("aecd");
+  builder.Add("b");
+  builder.Add("bcx");
+  builder.Build();
+  const uint8 *image = reinterpret_cast<const uint8 *>(builder.image().data());
+
+  // The writer builds the directories into caller-owned memory; a reader
+  // mapping the same memory must get the same search results without
+  // rebuilding them.
+  std::vector<char> directories(LoudsTrie::SharedRankDirectorySize(image));
+  LoudsTrie writer;
+  ASSERT_TRUE(writer.OpenWithSharedRankDirectories(
+      image, 2, 2, 4, 4, 2, 1, directories.data(), true));
+  LoudsTrie reader;
+  ASSERT_TRUE(reader.OpenWithSharedRankDirectories(
+      image, 0, 0, 0, 0, 0, 0, directories.data(), false));
+
+  const char *keys[] = {"a", "abc", "abcd", "ae", "aecd", "b", "bcx"};
+  for (size_t i = 0; i < arraysize(keys); ++i) {
+    EXPECT_EQ(builder.GetId(keys[i]), writer.ExactSearch(keys[i])) << keys[i];
+    EXPECT_EQ(builder.GetId(keys[i]), reader.ExactSearch(keys[i])) << keys[i];
+  }
+  EXPECT_EQ(-1, writer.ExactSearch("ab"));
+  EXPECT_EQ(-1, reader.ExactSearch("ab"));
+  EXPECT_EQ(-1, reader.ExactSearch("bcxyz"));
+
+  reader.Close();
+  writer.Close();
+}
+
 TEST_P(LoudsTrieTest, PrefixSearch) {
   LoudsTrieBuilder builder;
   builder.Add("aa");
@@ -452,7 +545,8 @@ TEST_P(LoudsTrieTest, PrefixSearch) {
             param.louds_lb1_cache_size,
             param.louds_select0_cache_size,
             param.louds_select1_cache_size,
-            param.termvec_lb1_cache_size);
+            param.termvec_lb1_cache_size,
+            param.child_cache_levels);
   {
     const StringPiece kKey = "abc";
     std::vector<RecordCallbackArgs::CallbackArgs> actual;
@@ -534,7 +628,8 @@ TEST_P(LoudsTrieTest, RestoreKeyString) {
             param.louds_lb1_cache_size,
             param.louds_select0_cache_size,
             param.louds_select1_cache_size,
-            param.termvec_lb1_cache_size);
+            param.termvec_lb1_cache_size,
+            param.child_cache_levels);
 
   char buffer[LoudsTrie::kMaxDepth + 1];
   EXPECT_EQ("aa", trie.RestoreKeyString(builder.GetId("aa"), buffer));
@@ -46,28 +46,32 @@ namespace {
 class ZeroBitAdapter : public AdapterBase<int> {
  public:
   // Needs to be default constructive to create invalid iterator.
-  ZeroBitAdapter() : index_(nullptr), chunk_size_(0) {}
+  ZeroBitAdapter() : index_begin_(nullptr), chunk_size_(0) {}
 
-  ZeroBitAdapter(const std::vector<int>* index, int chunk_size)
-      : index_(index), chunk_size_(chunk_size) {}
+  ZeroBitAdapter(const int *index_begin, int chunk_size)
+      : index_begin_(index_begin), chunk_size_(chunk_size) {}
 
   value_type operator()(const int *ptr) const {
     // The number of 0-bits
     //   = (total num bits) - (1-bits)
     //   = (chunk_size [bytes] * 8 [bits/byte] * (ptr's offset) - (1-bits)
-    return chunk_size_ * 8 * (ptr - index_->data()) - *ptr;
+    return chunk_size_ * 8 * (ptr - index_begin_) - *ptr;
   }
 
  private:
-  const std::vector<int> *index_;
+  const int *index_begin_;
   int chunk_size_;
 };
 
 #ifdef __GNUC__
-// TODO(hidehiko): Support XMM and 64-bits popcount for 64bits architectures.
+// TODO(hidehiko): Support XMM for wider scanning.
 inline int BitCount1(uint32 x) {
   return __builtin_popcount(x);
 }
+
+inline int BitCount1(uint64 x) {
+  return __builtin_popcountll(x);
+}
 #else
 int BitCount1(uint32 x) {
   x = ((x & 0xaaaaaaaa) >> 1) + (x & 0x55555555);
@@ -94,12 +98,56 @@ inline bool IsPowerOfTwo(int value) {
 // Returns 1-bits in the data[0] ... data[length - 1].
 int Count1Bits(const uint32 *data, int length) {
   int num_bits = 0;
+#ifdef __GNUC__
+  // Scan two words at a time with the 64-bit popcount.  The image is only
+  // guaranteed to be 32-bit aligned, so combine the words manually instead
+  // of dereferencing an uint64 pointer.
+  for (; length >= 2; data += 2, length -= 2) {
+    num_bits += BitCount1(data[0] | (static_cast<uint64>(data[1]) << 32));
+  }
+#endif
   for (; length > 0; ++data, --length) {
     num_bits += BitCount1(*data);
   }
   return num_bits;
 }
 
+// Returns the position of the n-th (1-origin) 1-bit of |word|, as a 0-origin
+// bit index.  Binary search on popcounts of progressively narrower low parts;
+// this replaces a bit-by-bit scan of up to 32 iterations.
+// REQUIRES: |word| contains at least n 1-bits.
+inline int Select1Bit(uint32 word, int n) {
+  int index = 0;
+  int count = BitCount1(word & 0xffff);
+  if (count < n) {
+    n -= count;
+    index += 16;
+    word >>= 16;
+  }
+  count = BitCount1(word & 0xff);
+  if (count < n) {
+    n -= count;
+    index += 8;
+    word >>= 8;
+  }
+  count = BitCount1(word & 0xf);
+  if (count < n) {
+    n -= count;
+    index += 4;
+    word >>= 4;
+  }
+  count = BitCount1(word & 0x3);
+  if (count < n) {
+    n -= count;
+    index += 2;
+    word >>= 2;
+  }
+  if (static_cast<int>(word & 1) < n) {
+    ++index;
+  }
+  return index;
+}
+
 // Stores index (the camulative number of the 1-bits from begin of each chunk).
 void InitIndex(
     const uint8 *data, int length, int chunk_size, std::vector<int> *index) {
@@ -127,50 +175,139 @@ void InitIndex(
   CHECK_EQ(chunk_length + 1, index->size());
 }
 
-void InitLowerBound0Cache(const std::vector<int> &index, int chunk_size,
+// Stores the second level of the rank directory: for each 32-bit word, the
+// number of 1-bits from the beginning of its chunk to the word (exclusive).
+// One sentinel entry is appended for a trailing partial chunk.  The counts
+// fit in uint8 as long as a chunk is at most 32 bytes (the prefix of the
+// last word of a chunk holds at most 224 bits).
+void InitWordIndex(
+    const uint8 *data, int length, int chunk_size,
+    std::vector<uint8> *word_index) {
+  DCHECK_LE(chunk_size, 32);
+  DCHECK_EQ(length % 4, 0);
+
+  const int num_words = length / 4;
+  const int words_per_chunk = chunk_size / 4;
+  word_index->clear();
+  word_index->reserve(num_words + 1);
+
+  const uint32 *words = reinterpret_cast<const uint32 *>(data);
+  int num_bits = 0;
+  for (int i = 0; i < num_words; ++i) {
+    if (i % words_per_chunk == 0) {
+      num_bits = 0;
+    }
+    word_index->push_back(num_bits);
+    num_bits += BitCount1(words[i]);
+  }
+  word_index->push_back(num_bits);
+}
+
+void InitLowerBound0Cache(const int *index, int index_size, int chunk_size,
                           size_t increment, size_t size,
                           std::vector<const int *> *cache) {
   DCHECK_GT(increment, 0);
   cache->clear();
   cache->reserve(size + 2);
-  cache->push_back(index.data());
-  ZeroBitAdapter adapter(&index, chunk_size);
+  cache->push_back(index);
+  ZeroBitAdapter adapter(index, chunk_size);
   for (size_t i = 1; i <= size; ++i) {
     const int target_index = increment * i;
     const int *ptr = std::lower_bound(
-        MakeIteratorAdapter(index.data(), adapter),
-        MakeIteratorAdapter(index.data() + index.size(), adapter),
+        MakeIteratorAdapter(index, adapter),
+        MakeIteratorAdapter(index + index_size, adapter),
         target_index).base();
     cache->push_back(ptr);
   }
-  cache->push_back(index.data() + index.size());
+  cache->push_back(index + index_size);
 }
 
-void InitLowerBound1Cache(const std::vector<int> &index, int chunk_size,
+void InitLowerBound1Cache(const int *index, int index_size, int chunk_size,
                           size_t increment, size_t size,
                           std::vector<const int *> *cache) {
   DCHECK_GT(increment, 0);
   cache->clear();
   cache->reserve(size + 2);
-  cache->push_back(index.data());
+  cache->push_back(index);
   for (size_t i = 1; i <= size; ++i) {
     const int target_index = increment * i;
-    const int *ptr = std::lower_bound(index.data(), index.data() + index.size(),
-                                      target_index);
+    const int *ptr = std::lower_bound(index, index + index_size, target_index);
     cache->push_back(ptr);
   }
-  cache->push_back(index.data() + index.size());
+  cache->push_back(index + index_size);
 }
 
 }  // namespace
 
 void SimpleSuccinctBitVectorIndex::Init(const uint8 *data, int length,
                                         size_t lb0_cache_size,
-                                        size_t lb1_cache_size) {
+                                        size_t lb1_cache_size,
+                                        bool build_word_rank_index) {
   data_ = data;
   length_ = length;
   InitIndex(data, length, chunk_size_, &index_);
+  if (build_word_rank_index) {
+    InitWordIndex(data, length, chunk_size_, &word_index_);
+  } else {
+    word_index_.clear();
+  }
+  index_data_ = index_.data();
+  index_size_ = index_.size();
+  word_index_data_ = word_index_.empty() ? nullptr : word_index_.data();
 
+  InitLowerBoundCaches(lb0_cache_size, lb1_cache_size);
+}
+
+size_t SimpleSuccinctBitVectorIndex::RankDirectorySize(
+    int length, int chunk_size, bool build_word_rank_index) {
+  const int chunk_length = (length + chunk_size - 1) / chunk_size;
+  size_t size = (chunk_length + 1) * sizeof(int);  // Including a sentinel.
+  if (build_word_rank_index) {
+    size += length / 4 + 1;
+  }
+  return size;
+}
+
+void SimpleSuccinctBitVectorIndex::InitWithSharedRankDirectory(
+    const uint8 *data, int length,
+    size_t lb0_cache_size, size_t lb1_cache_size,
+    bool build_word_rank_index,
+    void *rank_directory, bool init_rank_directory) {
+  data_ = data;
+  length_ = length;
+  index_.clear();
+  word_index_.clear();
+
+  // The directory layout is the per-chunk index followed by the word-level
+  // index; see RankDirectorySize().  |rank_directory| comes from mmap and
+  // thus is sufficiently aligned for the int array at its beginning.
+  int *directory_index = reinterpret_cast<int *>(rank_directory);
+  const int chunk_length = (length + chunk_size_ - 1) / chunk_size_;
+  index_data_ = directory_index;
+  index_size_ = chunk_length + 1;
+  word_index_data_ =
+      build_word_rank_index
+          ? reinterpret_cast<const uint8 *>(directory_index + index_size_)
+          : nullptr;
+
+  if (init_rank_directory) {
+    std::vector<int> index;
+    InitIndex(data, length, chunk_size_, &index);
+    DCHECK_EQ(static_cast<size_t>(index_size_), index.size());
+    std::copy(index.begin(), index.end(), directory_index);
+    if (build_word_rank_index) {
+      std::vector<uint8> word_index;
+      InitWordIndex(data, length, chunk_size_, &word_index);
+      std::copy(word_index.begin(), word_index.end(),
+                reinterpret_cast<uint8 *>(directory_index + index_size_));
+    }
+  }
+
+  InitLowerBoundCaches(lb0_cache_size, lb1_cache_size);
+}
+
+void SimpleSuccinctBitVectorIndex::InitLowerBoundCaches(
+    size_t lb0_cache_size, size_t lb1_cache_size) {
   // TODO(noriyukit): Currently, we simply use uniform increment width for lower
   // bound cache.  Nonuniform increment width may improve performance.
   lb0_cache_increment_ =
@@ -178,22 +315,26 @@ void SimpleSuccinctBitVectorIndex::Init(const uint8 *data, int length,
   if (lb0_cache_increment_ == 0) {
     lb0_cache_increment_ = 1;
   }
-  InitLowerBound0Cache(index_, chunk_size_, lb0_cache_increment_,
-                       lb0_cache_size, &lb0_cache_);
+  InitLowerBound0Cache(index_data_, index_size_, chunk_size_,
+                       lb0_cache_increment_, lb0_cache_size, &lb0_cache_);
 
   lb1_cache_increment_ =
       lb1_cache_size == 0 ? GetNum1Bits() : GetNum1Bits() / lb1_cache_size;
   if (lb1_cache_increment_ == 0) {
     lb1_cache_increment_ = 1;
   }
-  InitLowerBound1Cache(index_, chunk_size_, lb1_cache_increment_,
-                       lb1_cache_size, &lb1_cache_);
+  InitLowerBound1Cache(index_data_, index_size_, chunk_size_,
+                       lb1_cache_increment_, lb1_cache_size, &lb1_cache_);
 }
 
 void SimpleSuccinctBitVectorIndex::Reset() {
   data_ = nullptr;
   length_ = 0;
+  index_data_ = nullptr;
+  index_size_ = 0;
+  word_index_data_ = nullptr;
   index_.clear();
+  word_index_.clear();
   lb0_cache_increment_ = 1;
   lb0_cache_.clear();
   lb1_cache_increment_ = 1;
@@ -203,7 +344,20 @@ void SimpleSuccinctBitVectorIndex::Reset() {
 int SimpleSuccinctBitVectorIndex::Rank1(int n) const {
   // Look up pre-computed 1-bits for the preceding chunks.
   const int num_chunks = n / (chunk_size_ * 8);
-  int result = index_[n / (chunk_size_ * 8)];
+  int result = index_data_[n / (chunk_size_ * 8)];
+
+  if (word_index_data_ != nullptr) {
+    // Second directory level: look up the 1-bits of the chunk's preceding
+    // words instead of recounting them.
+    if (n % (chunk_size_ * 8) > 0) {
+      result += word_index_data_[n / 32];
+      if (n % 32 > 0) {
+        result += BitCount1(reinterpret_cast<const uint32 *>(data_)[n / 32]
+                            << (32 - n % 32));
+      }
+    }
+    return result;
+  }
 
   // Count 1-bits for remaining "words".
   result += Count1Bits(
@@ -232,15 +386,15 @@ int SimpleSuccinctBitVectorIndex::Select0(int n) const {
   DCHECK_GE(lb0_cache_index, 0);
 
   // Binary search on chunks.
-  ZeroBitAdapter adapter(&index_, chunk_size_);
+  ZeroBitAdapter adapter(index_data_, chunk_size_);
   const int *chunk_ptr =
       std::lower_bound(
           MakeIteratorAdapter(lb0_cache_[lb0_cache_index], adapter),
           MakeIteratorAdapter(lb0_cache_[lb0_cache_index + 1], adapter), n)
           .base();
-  const int chunk_index = (chunk_ptr - index_.data()) - 1;
+  const int chunk_index = (chunk_ptr - index_data_) - 1;
   DCHECK_GE(chunk_index, 0);
-  n -= chunk_size_ * 8 * chunk_index - index_[chunk_index];
+  n -= chunk_size_ * 8 * chunk_index - index_data_[chunk_index];
 
   // Linear search on remaining "words"
   const uint32 *ptr =
@@ -254,14 +408,8 @@ int SimpleSuccinctBitVectorIndex::Select0(int n) const {
     ++ptr;
   }
 
-  int index = (ptr - reinterpret_cast<const uint32 *>(data_)) * 32;
-  for (uint32 word = ~(*ptr); n > 0; word >>= 1, ++index) {
-    n -= (word & 1);
-  }
-
-  // Index points to the "next bit" of the target one.
-  // Thus, subtract one to adjust.
-  return index - 1;
+  return (ptr - reinterpret_cast<const uint32 *>(data_)) * 32 +
+         Select1Bit(~(*ptr), n);
 }
 
 int SimpleSuccinctBitVectorIndex::Select1(int n) const {
@@ -277,9 +425,9 @@ int SimpleSuccinctBitVectorIndex::Select1(int n) const {
   // Binary search on chunks.
   const int *chunk_ptr = std::lower_bound(lb1_cache_[lb1_cache_index],
                                           lb1_cache_[lb1_cache_index + 1], n);
-  const int chunk_index = (chunk_ptr - index_.data()) - 1;
+  const int chunk_index = (chunk_ptr - index_data_) - 1;
   DCHECK_GE(chunk_index, 0);
-  n -= index_[chunk_index];
+  n -= index_data_[chunk_index];
 
   // Linear search on remaining "words"
   const uint32 *ptr =
@@ -293,14 +441,8 @@ int SimpleSuccinctBitVectorIndex::Select1(int n) const {
     ++ptr;
   }
 
-  int index = (ptr - reinterpret_cast<const uint32 *>(data_)) * 32;
-  for (uint32 word = *ptr; n > 0; word >>= 1, ++index) {
-    n -= (word & 1);
-  }
-
-  // Index points to the "next bit" of the target one.
-  // Thus, subtract one to adjust.
-  return index - 1;
+  return (ptr - reinterpret_cast<const uint32 *>(data_)) * 32 +
+         Select1Bit(*ptr, n);
 }
 
 }  // namespace louds
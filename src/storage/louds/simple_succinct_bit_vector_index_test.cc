@@ -190,4 +190,80 @@ TEST_P(SimpleSuccinctBitVectorIndexTest, Pattern2) {
 }
 INSTANTIATE_TEST_CASE(GenPattern2Test);
 
+TEST(SimpleSuccinctBitVectorIndexWordRankTest, MatchesScanImplementation) {
+  // A mix of dense, sparse and irregular bytes whose length (100 bytes) is
+  // not a multiple of the default 32-byte chunk size, so the trailing
+  // partial chunk is covered as well.
+  string data;
+  for (int i = 0; i < 100; ++i) {
+    data.push_back(static_cast<char>(i * 89 + 13));
+  }
+
+  SimpleSuccinctBitVectorIndex scan_vector;
+  scan_vector.Init(reinterpret_cast<const uint8 *>(data.data()), data.length(),
+                   0, 0, false);
+  SimpleSuccinctBitVectorIndex word_rank_vector;
+  word_rank_vector.Init(reinterpret_cast<const uint8 *>(data.data()),
+                        data.length(), 0, 0, true);
+
+  const int num_bits = data.length() * 8;
+  for (int n = 0; n <= num_bits; ++n) {
+    EXPECT_EQ(scan_vector.Rank0(n), word_rank_vector.Rank0(n)) << n;
+    EXPECT_EQ(scan_vector.Rank1(n), word_rank_vector.Rank1(n)) << n;
+  }
+  for (int n = 1; n <= scan_vector.GetNum0Bits(); ++n) {
+    EXPECT_EQ(scan_vector.Select0(n), word_rank_vector.Select0(n)) << n;
+  }
+  for (int n = 1; n <= scan_vector.GetNum1Bits(); ++n) {
+    EXPECT_EQ(scan_vector.Select1(n), word_rank_vector.Select1(n)) << n;
+  }
+}
+
+TEST(SimpleSuccinctBitVectorIndexSharedRankDirectoryTest,
+     MatchesPrivateImplementation) {
+  string data;
+  for (int i = 0; i < 100; ++i) {
+    data.push_back(static_cast<char>(i * 89 + 13));
+  }
+  const uint8 *bits = reinterpret_cast<const uint8 *>(data.data());
+
+  SimpleSuccinctBitVectorIndex private_vector;
+  private_vector.Init(bits, data.length(), 4, 4, true);
+
+  // The first opener computes the directory into caller-owned memory.
+  // uint64 storage guarantees the alignment for the int array at the
+  // beginning of the directory.
+  const size_t directory_size =
+      SimpleSuccinctBitVectorIndex::RankDirectorySize(data.length(), 32, true);
+  const size_t directory_words =
+      (directory_size + sizeof(uint64) - 1) / sizeof(uint64);
+  std::vector<uint64> directory(directory_words);
+  SimpleSuccinctBitVectorIndex builder_vector;
+  builder_vector.InitWithSharedRankDirectory(
+      bits, data.length(), 4, 4, true, directory.data(), true);
+
+  // A second process attaches to the already filled directory, typically
+  // mapped at a different address; simulate the different address by moving
+  // the directory to another buffer.
+  std::vector<uint64> directory_copy(directory);
+  SimpleSuccinctBitVectorIndex attached_vector;
+  attached_vector.InitWithSharedRankDirectory(
+      bits, data.length(), 4, 4, true, directory_copy.data(), false);
+
+  const int num_bits = data.length() * 8;
+  for (int n = 0; n <= num_bits; ++n) {
+    EXPECT_EQ(private_vector.Rank0(n), builder_vector.Rank0(n)) << n;
+    EXPECT_EQ(private_vector.Rank1(n), builder_vector.Rank1(n)) << n;
+    EXPECT_EQ(private_vector.Rank1(n), attached_vector.Rank1(n)) << n;
+  }
+  for (int n = 1; n <= private_vector.GetNum0Bits(); ++n) {
+    EXPECT_EQ(private_vector.Select0(n), builder_vector.Select0(n)) << n;
+    EXPECT_EQ(private_vector.Select0(n), attached_vector.Select0(n)) << n;
+  }
+  for (int n = 1; n <= private_vector.GetNum1Bits(); ++n) {
+    EXPECT_EQ(private_vector.Select1(n), builder_vector.Select1(n)) << n;
+    EXPECT_EQ(private_vector.Select1(n), attached_vector.Select1(n)) << n;
+  }
+}
+
 }  // namespace
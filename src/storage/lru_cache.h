@@ -30,12 +30,17 @@
 #ifndef MOZC_STORAGE_LRU_CACHE_H_
 #define MOZC_STORAGE_LRU_CACHE_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <string>
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "storage/cache_budget_manager.h"
 
 namespace mozc {
 namespace storage {
@@ -96,6 +101,19 @@ class LRUCache {
   // Returns the number of entries currently in the cache.
   size_t Size() const;
 
+  // Evicts up to |num_elements| least recently used entries and returns
+  // the number of evicted entries.
+  size_t EvictTail(size_t num_elements);
+
+  // Puts this cache under the process-wide cache budget (see
+  // CacheBudgetManager).  |bytes_per_element| approximates the heap cost
+  // of one entry including the Key/Value payload.  Trim requests from
+  // the budget manager are applied at the next Insert() so that the
+  // cache is only ever mutated by its owning thread.  The client is
+  // unregistered when the cache is destroyed.
+  void RegisterCacheBudgetClient(const string &name,
+                                 size_t bytes_per_element);
+
   bool HasKey(const Key &key) const;
 
   // Returns the head of LRU list
@@ -137,6 +155,56 @@ class LRUCache {
   // lookup is not necessary.
   bool Evict(Element* element);
 
+  // Applies evictions requested by the budget manager from another
+  // thread; called from Insert().
+  void ApplyPendingEvictions();
+
+  // Reports this cache to CacheBudgetManager.  Only atomics are shared
+  // with the manager thread; the cache itself is never touched from
+  // ReleaseBytes().
+  class BudgetClient : public CacheBudgetManager::Client {
+   public:
+    BudgetClient(LRUCache *cache, size_t bytes_per_element)
+        : cache_(cache),
+          bytes_per_element_(bytes_per_element),
+          used_bytes_(0),
+          last_access_time_(Clock::GetTime()) {}
+
+    virtual size_t UsedBytes() const {
+      return used_bytes_.load(std::memory_order_relaxed);
+    }
+
+    virtual uint64 LastAccessTime() const {
+      return last_access_time_.load(std::memory_order_relaxed);
+    }
+
+    virtual size_t ReleaseBytes(size_t bytes) {
+      const size_t num_elements =
+          (bytes + bytes_per_element_ - 1) / bytes_per_element_;
+      cache_->pending_evictions_.fetch_add(num_elements,
+                                           std::memory_order_relaxed);
+      // The eviction is deferred to the owning thread; report the
+      // expected amount.
+      const size_t used = used_bytes_.load(std::memory_order_relaxed);
+      return std::min(used, num_elements * bytes_per_element_);
+    }
+
+    // Called by the owning thread on every cache access.
+    void Touch() {
+      last_access_time_.store(Clock::GetTime(), std::memory_order_relaxed);
+      used_bytes_.store(cache_->Size() * bytes_per_element_,
+                        std::memory_order_relaxed);
+    }
+
+   private:
+    LRUCache *cache_;
+    const size_t bytes_per_element_;
+    std::atomic<size_t> used_bytes_;
+    std::atomic<uint64> last_access_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(BudgetClient);
+  };
+
   typedef std::map<Key, Element*> Table;
 
   Table* table_;
@@ -155,6 +223,8 @@ class LRUCache {
   size_t block_capacity_;   // how many Elements can be stored in current blocks
   size_t next_block_size_;  // size of the next block to allocate
   size_t max_elements_;     // maximum elements to hold
+  std::unique_ptr<BudgetClient> budget_client_;
+  std::atomic<size_t> pending_evictions_;
 
   DISALLOW_COPY_AND_ASSIGN(LRUCache);
 };
@@ -285,7 +355,8 @@ LRUCache<Key, Value>::LRUCache(size_t max_elements)
     lru_tail_(NULL),
     block_count_(0),
     block_capacity_(0),
-    max_elements_(max_elements) {
+    max_elements_(max_elements),
+    pending_evictions_(0) {
   ::memset(blocks_, 0, sizeof(blocks_));
   table_ = new Table;
   CHECK(table_);
@@ -307,6 +378,9 @@ LRUCache<Key, Value>::LRUCache(size_t max_elements)
 
 template<typename Key, typename Value>
 LRUCache<Key, Value>::~LRUCache() {
+  if (budget_client_ != nullptr) {
+    CacheBudgetManager::GetInstance()->Unregister(budget_client_.get());
+  }
   // To free all the memory that I have allocated I need to delete table_ and
   // any used entries in blocks_.
   delete table_;
@@ -327,6 +401,9 @@ void LRUCache<Key, Value>::Insert(const Key& key,
 template<typename Key, typename Value>
 typename LRUCache<Key, Value>::Element *
 LRUCache<Key, Value>::Insert(const Key& key) {
+  if (budget_client_ != nullptr) {
+    ApplyPendingEvictions();
+  }
   bool erased = false;
   Element* e = LookupInternal(key);
   if (e != NULL) {
@@ -347,6 +424,9 @@ LRUCache<Key, Value>::Insert(const Key& key) {
   (*table_)[key] = e;
   PushLRUHead(e);
 
+  if (budget_client_ != nullptr) {
+    budget_client_->Touch();
+  }
   return e;
 }
 
@@ -355,6 +435,9 @@ Value* LRUCache<Key, Value>::MutableLookup(const Key& key) {
   Element* e = LookupInternal(key);
   if (e != NULL) {
     PushLRUHead(e);
+    if (budget_client_ != nullptr) {
+      budget_client_->Touch();
+    }
     return &(e->value);
   }
   return NULL;
@@ -407,6 +490,42 @@ size_t LRUCache<Key, Value>::Size() const {
   return table_->size();
 }
 
+template<typename Key, typename Value>
+size_t LRUCache<Key, Value>::EvictTail(size_t num_elements) {
+  size_t evicted = 0;
+  while (evicted < num_elements && lru_tail_ != NULL) {
+    if (!Evict(lru_tail_)) {
+      break;
+    }
+    ++evicted;
+  }
+  if (budget_client_ != nullptr) {
+    budget_client_->Touch();
+  }
+  return evicted;
+}
+
+template<typename Key, typename Value>
+void LRUCache<Key, Value>::ApplyPendingEvictions() {
+  const size_t num_elements = pending_evictions_.exchange(0);
+  if (num_elements > 0) {
+    const size_t evicted = EvictTail(num_elements);
+    VLOG(1) << "evicted " << evicted << " entries on budget request";
+  }
+}
+
+template<typename Key, typename Value>
+void LRUCache<Key, Value>::RegisterCacheBudgetClient(
+    const string &name, size_t bytes_per_element) {
+  DCHECK_GT(bytes_per_element, 0);
+  if (budget_client_ != nullptr) {
+    return;
+  }
+  budget_client_.reset(new BudgetClient(this, bytes_per_element));
+  budget_client_->Touch();
+  CacheBudgetManager::GetInstance()->Register(name, budget_client_.get());
+}
+
 }  // namespace storage
 }  // namespace mozc
 #endif  // MOZC_STORAGE_LRU_CACHE_H_
@@ -30,6 +30,7 @@
 #include "storage/lru_storage.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
@@ -45,8 +46,11 @@
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/mmap.h"
+#include "base/mutex.h"
 #include "base/port.h"
+#include "base/scheduler.h"
 #include "base/util.h"
+#include "storage/cache_budget_manager.h"
 
 namespace mozc {
 namespace storage {
@@ -55,6 +59,13 @@ namespace {
 const size_t kMaxLRUSize   = 1000000;  // 1M
 const size_t kMaxValueSize = 1024;     // 1024 byte
 
+// Journal file used in write-behind mode; see EnableWriteBehind().
+const char kJournalFileSuffix[] = ".journal";
+
+// Flush interval of the scheduled write-behind flush job.
+const uint32 kFlushIntervalMsec = 60 * 1000;          // 1 min
+const uint32 kMaxFlushIntervalMsec = 5 * 60 * 1000;   // 5 min
+
 template <class T>
 inline void ReadValue(char **ptr, T *value) {
   memcpy(value, *ptr, sizeof(*value));
@@ -93,6 +104,52 @@ class CompareByTimeStamp {
 };
 }  // namespace
 
+// Reports the size of the write-behind image to CacheBudgetManager and
+// leaves write-behind mode when asked to release memory.  The manager
+// calls UsedBytes()/LastAccessTime()/ReleaseBytes() from its own thread,
+// so the counters are atomics updated by the storage under |mutex_|.
+class LRUStorage::BudgetClient : public CacheBudgetManager::Client {
+ public:
+  explicit BudgetClient(LRUStorage *storage)
+      : storage_(storage), used_bytes_(0), last_access_time_(0) {}
+
+  virtual size_t UsedBytes() const {
+    return used_bytes_.load(std::memory_order_relaxed);
+  }
+
+  virtual uint64 LastAccessTime() const {
+    return last_access_time_.load(std::memory_order_relaxed);
+  }
+
+  virtual size_t ReleaseBytes(size_t bytes) {
+    const size_t used = used_bytes_.load(std::memory_order_relaxed);
+    if (used == 0) {
+      return 0;
+    }
+    // Dropping the in-memory image is all-or-nothing.
+    if (!storage_->DisableWriteBehind()) {
+      return 0;
+    }
+    return used;
+  }
+
+  void SetUsedBytes(size_t used_bytes) {
+    used_bytes_.store(used_bytes, std::memory_order_relaxed);
+    Touch();
+  }
+
+  void Touch() {
+    last_access_time_.store(Clock::GetTime(), std::memory_order_relaxed);
+  }
+
+ private:
+  LRUStorage *storage_;
+  std::atomic<size_t> used_bytes_;
+  std::atomic<uint64> last_access_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(BudgetClient);
+};
+
 class LRUStorage::Node {
  public:
   Node(): next(NULL), prev(NULL), value(NULL) {
@@ -159,6 +216,10 @@ class LRUStorage::LRUList {
     return last_;
   }
 
+  Node *GetTopNode() {
+    return top_;
+  }
+
   void MoveToTop(Node *node) {
     if (node->prev != NULL) {  // this is top
       Node *prev = node->prev;
@@ -257,20 +318,33 @@ bool LRUStorage::CreateStorageFile(const char *filename,
 
 // Reopen file after initializing mapped page.
 bool LRUStorage::Clear() {
+  scoped_lock lock(&mutex_);
+  char *data = NULL;
+  size_t data_size = 0;
+  if (write_behind_) {
+    data = &write_behind_buffer_[0];
+    data_size = write_behind_buffer_.size();
+  } else if (mmap_.get() != NULL) {
+    data = mmap_->begin();
+    data_size = mmap_->size();
+  }
   // Don't need to clear the page if the lru list is empty
-  if (mmap_.get() == NULL || lru_list_.get() == NULL ||
+  if (data == NULL || lru_list_.get() == NULL ||
       lru_list_->size() == 0) {
     return true;
   }
   const size_t offset =
       sizeof(value_size_) + sizeof(size_) + sizeof(seed_);
-  if (offset >= mmap_->size()) {   // should not happen
+  if (offset >= data_size) {   // should not happen
     return false;
   }
-  memset(mmap_->begin() + offset, '\0', mmap_->size() - offset);
+  memset(data + offset, '\0', data_size - offset);
   lru_list_.reset();
   map_.clear();
-  Open(mmap_->begin(), mmap_->size());
+  Open(data, data_size);
+  if (write_behind_ && !Checkpoint()) {
+    return false;
+  }
   return true;
 }
 
@@ -283,6 +357,7 @@ bool LRUStorage::Merge(const char *filename) {
 }
 
 bool LRUStorage::Merge(const LRUStorage &storage) {
+  scoped_lock lock(&mutex_);
   if (storage.value_size() !=  value_size()) {
     return false;
   }
@@ -335,6 +410,11 @@ bool LRUStorage::Merge(const LRUStorage &storage) {
     memset(begin_ + new_size, '\0', old_size - new_size);
   }
 
+  if (write_behind_) {
+    const bool result =
+        Open(&write_behind_buffer_[0], write_behind_buffer_.size());
+    return Checkpoint() && result;
+  }
   return Open(mmap_->begin(), mmap_->size());
 }
 
@@ -343,7 +423,9 @@ LRUStorage::LRUStorage()
       size_(0),
       seed_(0),
       last_item_(NULL),
-      begin_(NULL), end_(NULL) {}
+      begin_(NULL), end_(NULL),
+      write_behind_(false),
+      journal_size_(0) {}
 
 LRUStorage::~LRUStorage() {
   Close();
@@ -463,7 +545,7 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
     return false;
   }
 
-  const size_t file_size = mmap_->size() - 12;
+  const size_t file_size = ptr_size - 12;
   if ((value_size_ + 12) * size_ != file_size) {
     LOG(ERROR) << "LRU file is broken";
     return false;
@@ -494,6 +576,25 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
 }
 
 void LRUStorage::Close() {
+  if (budget_client_.get() != NULL) {
+    // Unregister before taking |mutex_|; the manager may be calling the
+    // client on its own thread.
+    CacheBudgetManager::GetInstance()->Unregister(budget_client_.get());
+    budget_client_.reset();
+  }
+  if (write_behind_) {
+    // Remove the flush job before taking the lock; a running callback may
+    // be blocked on |mutex_|.
+    Scheduler::RemoveJob(flush_job_name_);
+    scoped_lock lock(&mutex_);
+    if (!Checkpoint()) {
+      LOG(ERROR) << "cannot write back " << filename_;
+    }
+    write_behind_ = false;
+    write_behind_buffer_.clear();
+    dirty_.clear();
+    journal_size_ = 0;
+  }
   filename_.clear();
   mmap_.reset();
   lru_list_.reset();
@@ -505,6 +606,10 @@ const char* LRUStorage::Lookup(const string &key) const {
   return Lookup(key, &last_access_time);
 }
 
+uint64 LRUStorage::GetFingerprint(const string &key) const {
+  return Hash::FingerprintWithSeed(key, seed_);
+}
+
 const char* LRUStorage::Lookup(const string &key,
                                uint32 *last_access_time) const {
   const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
@@ -534,16 +639,37 @@ bool LRUStorage::GetAllValues(std::vector<string> *values) const {
   return true;
 }
 
+bool LRUStorage::GetRecentValues(size_t max_size,
+                                 std::vector<string> *values) const {
+  if (lru_list_.get() == NULL) {
+    return false;
+  }
+  DCHECK(values);
+  values->clear();
+  for (const Node *node = lru_list_->GetTopNode();
+       node != NULL && values->size() < max_size;
+       node = node->next) {
+    DCHECK(node->value);
+    values->push_back(string(GetValue(node->value), value_size_));
+  }
+  return true;
+}
+
 bool LRUStorage::Touch(const string &key) {
   if (lru_list_.get() == NULL) {
     return false;
   }
 
+  scoped_lock lock(&mutex_);
+  if (budget_client_.get() != NULL) {
+    budget_client_->Touch();
+  }
   const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
   std::map<uint64, Node *>::iterator it = map_.find(fp);
   if (it != map_.end()) {     // find in the cache
     Update(it->second->value);
     lru_list_->MoveToTop(it->second);
+    MarkDirty(it->second->value);
     return true;
   }
   return false;
@@ -554,11 +680,16 @@ bool LRUStorage::Insert(const string &key, const char *value) {
     return false;
   }
 
+  scoped_lock lock(&mutex_);
+  if (budget_client_.get() != NULL) {
+    budget_client_->Touch();
+  }
   const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
   std::map<uint64, Node *>::iterator it = map_.find(fp);
   if (it != map_.end()) {     // find in the cache
     Update(it->second->value, fp, value, value_size_);
     lru_list_->MoveToTop(it->second);
+    MarkDirty(it->second->value);
   } else if (lru_list_->size() >= size_ ||
              last_item_ == NULL) {  // not found, but cache is FULL
     Node *node = lru_list_->GetLastNode();
@@ -570,13 +701,15 @@ bool LRUStorage::Insert(const string &key, const char *value) {
     lru_list_->MoveToTop(node);
     Update(node->value, fp, value, value_size_);
     map_.insert(std::make_pair(fp, node));
-  } else if (last_item_ < mmap_->end()) {  // not found, cahce is not FULL
+    MarkDirty(node->value);
+  } else if (last_item_ < end_) {  // not found, cahce is not FULL
     Node *node = lru_list_->Add(last_item_);
     lru_list_->MoveToTop(node);
     Update(node->value, fp, value, value_size_);
     map_.insert(std::make_pair(fp, node));
+    MarkDirty(node->value);
     last_item_ += (value_size_ + 12);
-    if (last_item_ >= mmap_->end()) {
+    if (last_item_ >= end_) {
       last_item_ = NULL;
     }
   } else {
@@ -592,16 +725,221 @@ bool LRUStorage::TryInsert(const string &key, const char *value) {
     return false;
   }
 
+  scoped_lock lock(&mutex_);
+  if (budget_client_.get() != NULL) {
+    budget_client_->Touch();
+  }
   const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
   std::map<uint64, Node *>::iterator it = map_.find(fp);
   if (it != map_.end()) {     // find in the cache
     Update(it->second->value, fp, value, value_size_);
     lru_list_->MoveToTop(it->second);
+    MarkDirty(it->second->value);
+  }
+
+  return true;
+}
+
+bool LRUStorage::EnableWriteBehind() {
+  if (write_behind_) {
+    return true;
+  }
+  if (mmap_.get() == NULL || lru_list_.get() == NULL) {
+    LOG(ERROR) << "not opened";
+    return false;
+  }
+
+  size_t image_size = 0;
+  {
+    scoped_lock lock(&mutex_);
+    write_behind_buffer_.assign(mmap_->begin(), mmap_->end());
+    journal_filename_ = filename_ + kJournalFileSuffix;
+    flush_job_name_ = "LRUStorageFlush:" + filename_;
+    dirty_.clear();
+    journal_size_ = 0;
+
+    // A leftover journal means the last session crashed before writing
+    // the image back; merge it into the copied image.
+    ReplayJournal();
+
+    // From now on the in-memory copy is the backing store; the mapping is
+    // released so that no dirty page ever reaches the file system between
+    // checkpoints.
+    mmap_.reset();
+    if (!Open(&write_behind_buffer_[0], write_behind_buffer_.size())) {
+      LOG(ERROR) << "cannot reopen the in-memory image";
+      return false;
+    }
+    write_behind_ = true;
+
+    // Persist the replayed state and remove the journal so that replay is
+    // not repeated on the next session.
+    if (!Checkpoint()) {
+      LOG(ERROR) << "cannot write back " << filename_;
+    }
+    image_size = write_behind_buffer_.size();
+  }
+
+  // Register() and AddJob() take other locks, so |mutex_| must not be
+  // held here; ReleaseBytes() locks them in the opposite order.
+  if (budget_client_.get() == NULL) {
+    budget_client_.reset(new BudgetClient(this));
+    CacheBudgetManager::GetInstance()->Register(
+        "LRUStorage:" + filename_, budget_client_.get());
   }
+  budget_client_->SetUsedBytes(image_size);
 
+  Scheduler::AddJob(Scheduler::JobSetting(
+      flush_job_name_, kFlushIntervalMsec, kMaxFlushIntervalMsec,
+      kFlushIntervalMsec, kFlushIntervalMsec / 2,
+      &LRUStorage::FlushCallback,
+      this).set_priority(Scheduler::JobSetting::PRIORITY_IDLE));
   return true;
 }
 
+bool LRUStorage::DisableWriteBehind() {
+  if (!write_behind_) {
+    return true;
+  }
+  // Remove the flush job before taking the lock; a running callback may
+  // be blocked on |mutex_|.
+  Scheduler::RemoveJob(flush_job_name_);
+  scoped_lock lock(&mutex_);
+  if (!write_behind_) {
+    return true;
+  }
+  if (!Checkpoint()) {
+    LOG(ERROR) << "cannot write back " << filename_;
+    return false;
+  }
+  write_behind_ = false;
+  std::vector<char>().swap(write_behind_buffer_);
+  if (budget_client_.get() != NULL) {
+    budget_client_->SetUsedBytes(0);
+  }
+  // Map the checkpointed file again.  |filename_| is copied because
+  // Open() reassigns it.
+  const string filename = filename_;
+  if (!Open(filename.c_str())) {
+    LOG(ERROR) << "cannot reopen " << filename;
+    return false;
+  }
+  return true;
+}
+
+bool LRUStorage::Flush() {
+  scoped_lock lock(&mutex_);
+  if (!write_behind_ || dirty_.empty()) {
+    return true;
+  }
+
+  const bool new_journal = (journal_size_ == 0);
+  OutputFileStream ofs(journal_filename_.c_str(),
+                       new_journal
+                           ? std::ios::binary | std::ios::out
+                           : std::ios::binary | std::ios::out | std::ios::app);
+  if (!ofs) {
+    LOG(ERROR) << "cannot open " << journal_filename_;
+    return false;
+  }
+  if (new_journal) {
+    const uint32 value_size_uint32 = static_cast<uint32>(value_size_);
+    const uint32 size_uint32 = static_cast<uint32>(size_);
+    ofs.write(reinterpret_cast<const char *>(&value_size_uint32),
+              sizeof(value_size_uint32));
+    ofs.write(reinterpret_cast<const char *>(&size_uint32),
+              sizeof(size_uint32));
+    ofs.write(reinterpret_cast<const char *>(&seed_), sizeof(seed_));
+    journal_size_ += 12;
+  }
+  for (std::set<uint32>::const_iterator it = dirty_.begin();
+       it != dirty_.end(); ++it) {
+    const uint32 index = *it;
+    ofs.write(reinterpret_cast<const char *>(&index), sizeof(index));
+    ofs.write(begin_ + index * (value_size_ + 12), value_size_ + 12);
+    journal_size_ += sizeof(index) + value_size_ + 12;
+  }
+  if (!ofs.good()) {
+    LOG(ERROR) << "cannot write " << journal_filename_;
+    return false;
+  }
+  dirty_.clear();
+
+  // Once replaying the journal costs as much as rewriting the file,
+  // checkpoint and start over.
+  if (journal_size_ > write_behind_buffer_.size()) {
+    return Checkpoint();
+  }
+  return true;
+}
+
+bool LRUStorage::FlushCallback(void *data) {
+  return static_cast<LRUStorage *>(data)->Flush();
+}
+
+void LRUStorage::ReplayJournal() {
+  if (!FileUtil::FileExists(journal_filename_)) {
+    return;
+  }
+  Mmap journal;
+  if (!journal.Open(journal_filename_.c_str(), "r")) {
+    LOG(ERROR) << "cannot open " << journal_filename_;
+    return;
+  }
+  if (journal.size() < 12 ||
+      *reinterpret_cast<const uint32 *>(journal.begin()) != value_size_ ||
+      *reinterpret_cast<const uint32 *>(journal.begin() + 4) != size_ ||
+      *reinterpret_cast<const uint32 *>(journal.begin() + 8) != seed_) {
+    LOG(ERROR) << "journal is broken or stale: " << journal_filename_;
+    return;
+  }
+  const size_t record_size = 4 + value_size_ + 12;
+  size_t pos = 12;
+  // A trailing partial record is dropped; every complete record before it
+  // was written by a finished Flush() and is safe to apply.
+  while (pos + record_size <= journal.size()) {
+    const uint32 index =
+        *reinterpret_cast<const uint32 *>(journal.begin() + pos);
+    if (index < size_) {
+      memcpy(&write_behind_buffer_[12 + index * (value_size_ + 12)],
+             journal.begin() + pos + 4, value_size_ + 12);
+    }
+    pos += record_size;
+  }
+}
+
+bool LRUStorage::Checkpoint() {
+  const string tmp_filename = filename_ + ".tmp";
+  {
+    OutputFileStream ofs(tmp_filename.c_str(),
+                         std::ios::binary | std::ios::out);
+    if (!ofs) {
+      LOG(ERROR) << "cannot open " << tmp_filename;
+      return false;
+    }
+    ofs.write(&write_behind_buffer_[0], write_behind_buffer_.size());
+    if (!ofs.good()) {
+      LOG(ERROR) << "cannot write " << tmp_filename;
+      return false;
+    }
+  }
+  if (!FileUtil::AtomicRename(tmp_filename, filename_)) {
+    LOG(ERROR) << "AtomicRename failed: " << tmp_filename;
+    return false;
+  }
+  FileUtil::Unlink(journal_filename_);
+  dirty_.clear();
+  journal_size_ = 0;
+  return true;
+}
+
+void LRUStorage::MarkDirty(const char *ptr) {
+  if (!write_behind_) {
+    return;
+  }
+  dirty_.insert(static_cast<uint32>((ptr - begin_) / (value_size_ + 12)));
+}
+
 size_t LRUStorage::value_size() const {
   return value_size_;
 }
@@ -627,6 +965,7 @@ void LRUStorage::Write(size_t i,
                        const string &value,
                        uint32 last_access_time) {
   DCHECK_LT(i, size_);
+  scoped_lock lock(&mutex_);
   char *ptr = begin_ + (i * (value_size_ + 12));
   memcpy(ptr,     reinterpret_cast<const char *>(&fp), 8);
   memcpy(ptr + 8, reinterpret_cast<const char *>(&last_access_time), 4);
@@ -635,6 +974,7 @@ void LRUStorage::Write(size_t i,
   } else {
     LOG(ERROR) << "value size is not " << value_size_ << " byte.";
   }
+  MarkDirty(ptr);
 }
 
 void LRUStorage::Read(size_t i,
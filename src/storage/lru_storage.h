@@ -32,9 +32,11 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
+#include "base/mutex.h"
 #include "base/port.h"
 
 namespace mozc {
@@ -51,6 +53,31 @@ class LRUStorage {
   bool Open(const char *filename);
   void Close();
 
+  // Switches this storage to write-behind mode.  Mutations are applied to
+  // an in-memory copy of the file and recorded in a dirty set; Flush()
+  // appends the dirty entries to a journal file ("<filename>.journal") in
+  // one sequential write.  A flush job is registered with Scheduler so
+  // that batches are written periodically, and Close() writes the whole
+  // image back to |filename| and removes the journal.  If a journal is
+  // left over from a crashed session, it is replayed here.
+  // The storage must be opened before this method is called.
+  // The in-memory image is also registered with CacheBudgetManager; when
+  // the process is over its cache budget the manager may leave
+  // write-behind mode again via DisableWriteBehind().
+  bool EnableWriteBehind();
+
+  // Leaves write-behind mode: writes the in-memory image back to the
+  // storage file, frees the image and maps the file again.  No-op when
+  // write-behind mode is off.
+  bool DisableWriteBehind();
+
+  // Appends the mutations accumulated since the last flush to the journal
+  // file.  When the journal outgrows the storage, the whole image is
+  // written back to the storage file instead and the journal is removed.
+  // Returns true if there is nothing to flush.  No-op unless
+  // EnableWriteBehind() has been called.
+  bool Flush();
+
   // Try to open exisiting database
   // If the file is broken or cannot open, tries to recreate
   // new file
@@ -65,10 +92,20 @@ class LRUStorage {
 
   const char *Lookup(const string &key) const;
 
+  // Returns the fingerprint of |key| used as the internal index key.
+  // Exposed so that clients maintaining their own aggregated view of
+  // the entries (built with Read()) can key it consistently.
+  uint64 GetFingerprint(const string &key) const;
+
   // Returns all values.
   // The order is new to old (*values->begin() is the newest).
   bool GetAllValues(std::vector<string> *values) const;
 
+  // Returns at most |max_size| values, newest first.  Unlike
+  // GetAllValues(), the cost only depends on |max_size|, so this is the
+  // method of choice when only the most recent entries are displayed.
+  bool GetRecentValues(size_t max_size, std::vector<string> *values) const;
+
   // clear all LRU cache;
   // mapped file is also initialized
   bool Clear();
@@ -125,12 +162,29 @@ class LRUStorage {
                                 size_t size,
                                 uint32 seed);
  private:
+  class BudgetClient;
   class LRUList;
   class Node;
 
   // load from memory buffer
   bool Open(char *ptr, size_t ptr_size);
 
+  // Scheduler callback; |data| is the LRUStorage instance.
+  static bool FlushCallback(void *data);
+
+  // Applies the entries of a leftover journal file to the write-behind
+  // image.  A trailing partial record, which a crash during Flush() may
+  // leave, is ignored.
+  void ReplayJournal();
+
+  // Writes the whole write-behind image back to the storage file and
+  // removes the journal.  The caller must hold |mutex_|.
+  bool Checkpoint();
+
+  // Records the entry at |ptr| as modified since the last flush.
+  // No-op unless write-behind mode is enabled.
+  void MarkDirty(const char *ptr);
+
   size_t value_size_;
   size_t size_;
   uint32 seed_;
@@ -142,6 +196,23 @@ class LRUStorage {
   std::unique_ptr<LRUList> lru_list_;
   std::unique_ptr<Mmap> mmap_;
 
+  // Write-behind mode; see EnableWriteBehind().  |write_behind_buffer_|
+  // replaces the mmap as the backing store, |dirty_| holds the indices of
+  // the entries modified since the last flush, and |journal_size_| is the
+  // number of bytes appended to the journal since the last checkpoint.
+  // |mutex_| serializes mutations against the scheduled flush job.
+  bool write_behind_;
+  std::vector<char> write_behind_buffer_;
+  std::set<uint32> dirty_;
+  size_t journal_size_;
+  string journal_filename_;
+  string flush_job_name_;
+  Mutex mutex_;
+
+  // Registered with CacheBudgetManager while write-behind mode is (or has
+  // been) enabled; see EnableWriteBehind().
+  std::unique_ptr<BudgetClient> budget_client_;
+
   DISALLOW_COPY_AND_ASSIGN(LRUStorage);
 };
 
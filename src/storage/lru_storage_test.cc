@@ -146,6 +146,36 @@ TEST_F(LRUStorageTest, LRUStorageTest) {
   }
 }
 
+TEST_F(LRUStorageTest, GetRecentValuesTest) {
+  const string file = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 100, 0x76fef);
+  LRUStorage storage;
+  ASSERT_TRUE(storage.Open(file.c_str()));
+
+  std::vector<string> values;
+  EXPECT_TRUE(storage.GetRecentValues(10, &values));
+  EXPECT_TRUE(values.empty());
+
+  for (int i = 0; i < 20; ++i) {
+    const string key = Util::StringPrintf("key%d", i);
+    const string value = Util::StringPrintf("%4d", i);
+    storage.Insert(key, value.data());
+  }
+
+  // The newest comes first, as in GetAllValues().
+  EXPECT_TRUE(storage.GetRecentValues(3, &values));
+  ASSERT_EQ(3, values.size());
+  EXPECT_EQ("  19", values[0]);
+  EXPECT_EQ("  18", values[1]);
+  EXPECT_EQ("  17", values[2]);
+
+  // A larger limit returns everything.
+  EXPECT_TRUE(storage.GetRecentValues(100, &values));
+  std::vector<string> all_values;
+  EXPECT_TRUE(storage.GetAllValues(&all_values));
+  EXPECT_EQ(all_values, values);
+}
+
 struct Entry {
   uint64 key;
   uint32 last_access_time;
@@ -312,6 +342,70 @@ TEST_F(LRUStorageTest, Merge) {
   FileUtil::Unlink(file2);
 }
 
+TEST_F(LRUStorageTest, WriteBehindTest) {
+  const string file = GetTemporaryFilePath();
+  const string journal = file + ".journal";
+  const string crash_file = file + ".crash";
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 100, 0x76fef);
+
+  uint32 value = 10;
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(file.c_str()));
+    ASSERT_TRUE(storage.EnableWriteBehind());
+    storage.Insert("key1", reinterpret_cast<const char *>(&value));
+    value = 20;
+    storage.Insert("key2", reinterpret_cast<const char *>(&value));
+
+    // Mutations stay in memory until the journal is flushed.
+    {
+      LRUStorage reader;
+      ASSERT_TRUE(reader.Open(file.c_str()));
+      EXPECT_TRUE(reader.Lookup("key1") == NULL);
+    }
+
+    EXPECT_TRUE(storage.Flush());
+    EXPECT_TRUE(FileUtil::FileExists(journal));
+
+    // Simulate a crash after the flush: keep copies of the storage file,
+    // which has not been updated yet, and the journal.
+    FileUtil::CopyFile(file, crash_file);
+    FileUtil::CopyFile(journal, crash_file + ".journal");
+  }
+
+  // Close() wrote the image back and removed the journal.
+  EXPECT_FALSE(FileUtil::FileExists(journal));
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(file.c_str()));
+    const uint32 *v =
+        reinterpret_cast<const uint32 *>(storage.Lookup("key2"));
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ(20, *v);
+  }
+
+  // The journal of the "crashed" session is replayed on the next
+  // EnableWriteBehind() even though its storage file was never updated.
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(crash_file.c_str()));
+    EXPECT_TRUE(storage.Lookup("key1") == NULL);
+    ASSERT_TRUE(storage.EnableWriteBehind());
+    const uint32 *v1 =
+        reinterpret_cast<const uint32 *>(storage.Lookup("key1"));
+    ASSERT_TRUE(v1 != NULL);
+    EXPECT_EQ(10, *v1);
+    const uint32 *v2 =
+        reinterpret_cast<const uint32 *>(storage.Lookup("key2"));
+    ASSERT_TRUE(v2 != NULL);
+    EXPECT_EQ(20, *v2);
+    // Replay checkpoints immediately, so the journal is gone.
+    EXPECT_FALSE(FileUtil::FileExists(crash_file + ".journal"));
+  }
+
+  FileUtil::Unlink(crash_file);
+}
+
 TEST_F(LRUStorageTest, InvalidFileOpenTest) {
   LRUStorage storage;
   EXPECT_FALSE(storage.Insert("test", NULL));
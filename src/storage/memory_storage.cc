@@ -83,6 +83,12 @@ class MemoryStorageImpl : public storage::StorageInterface {
     return data_.size();
   }
 
+  virtual bool GetAllEntries(std::map<string, string> *entries) const {
+    CHECK(entries);
+    *entries = data_;
+    return true;
+  }
+
   MemoryStorageImpl() {}
   virtual ~MemoryStorageImpl() {}
 
@@ -29,6 +29,8 @@
 
 #include "storage/registry.h"
 
+#include <atomic>
+#include <map>
 #include <memory>
 #include <string>
 
@@ -59,6 +61,7 @@ class StorageInitializer {
             SystemUtil::GetUserProfileDirectory(), kRegistryFileName))) {
       LOG(ERROR) << "cannot open registry";
     }
+    RebuildSnapshot();
   }
 
   StorageInterface *GetStorage() const {
@@ -71,17 +74,45 @@ class StorageInitializer {
 
   void SetStorage(StorageInterface *storage) {
     current_storage_ = storage;
+    RebuildSnapshot();
+  }
+
+  // Copies the storage contents into a fresh immutable map and publishes
+  // it for lock-free lookups.  Must be called with g_mutex held after
+  // every mutation.  The registry holds at most a handful of small
+  // entries and is rarely written, so the copy is cheap.
+  void RebuildSnapshot() {
+    std::shared_ptr<std::map<string, string> > entries(
+        new std::map<string, string>);
+    if (GetStorage()->GetAllEntries(entries.get())) {
+      std::atomic_store(
+          &snapshot_,
+          std::shared_ptr<const std::map<string, string> >(entries));
+    } else {
+      // The storage cannot be enumerated; readers fall back to locked
+      // lookups.
+      std::atomic_store(&snapshot_,
+                        std::shared_ptr<const std::map<string, string> >());
+    }
+  }
+
+  std::shared_ptr<const std::map<string, string> > GetSnapshot() const {
+    return std::atomic_load(&snapshot_);
   }
 
  private:
   std::unique_ptr<StorageInterface> default_storage_;
   StorageInterface *current_storage_;
+  std::shared_ptr<const std::map<string, string> > snapshot_;
 };
 }  // namespace
 
 bool Registry::Erase(const string &key) {
   scoped_lock l(&g_mutex);
-  return Singleton<StorageInitializer>::get()->GetStorage()->Erase(key);
+  StorageInitializer *initializer = Singleton<StorageInitializer>::get();
+  const bool result = initializer->GetStorage()->Erase(key);
+  initializer->RebuildSnapshot();
+  return result;
 }
 
 bool Registry::Sync() {
@@ -92,7 +123,10 @@ bool Registry::Sync() {
 // clear internal keys and values
 bool Registry::Clear() {
   scoped_lock l(&g_mutex);
-  return Singleton<StorageInitializer>::get()->GetStorage()->Clear();
+  StorageInitializer *initializer = Singleton<StorageInitializer>::get();
+  const bool result = initializer->GetStorage()->Clear();
+  initializer->RebuildSnapshot();
+  return result;
 }
 
 void Registry::SetStorage(StorageInterface *handler) {
@@ -102,13 +136,31 @@ void Registry::SetStorage(StorageInterface *handler) {
 }
 
 bool Registry::LookupInternal(const string &key, string *value) {
-  scoped_lock l(&g_mutex);   // just for safe
+  // Fast path: read from the immutable snapshot without taking the
+  // global lock.  Writers publish a whole new snapshot, so the map we
+  // hold here never changes under us.
+  const std::shared_ptr<const std::map<string, string> > snapshot =
+      Singleton<StorageInitializer>::get()->GetSnapshot();
+  if (snapshot != nullptr) {
+    std::map<string, string>::const_iterator it = snapshot->find(key);
+    if (it == snapshot->end()) {
+      return false;
+    }
+    *value = it->second;
+    return true;
+  }
+
+  // The storage does not support snapshots.
+  scoped_lock l(&g_mutex);
   return Singleton<StorageInitializer>::get()->GetStorage()->Lookup(key, value);
 }
 
 bool Registry::InsertInternal(const string &key, const string &value) {
   scoped_lock l(&g_mutex);
-  return Singleton<StorageInitializer>::get()->GetStorage()->Insert(key, value);
+  StorageInitializer *initializer = Singleton<StorageInitializer>::get();
+  const bool result = initializer->GetStorage()->Insert(key, value);
+  initializer->RebuildSnapshot();
+  return result;
 }
 }  // namespace storage
 }  // namespace mozc
@@ -44,7 +44,10 @@ class StorageInterface;
 // The idea of Registry module is the same as Windows Registry.
 // You can use it for saving small data like timestamp, auth_token.
 // DO NOT USE it to save big data or data which are frequently updated.
-// Lookup() and Insert() do process-wide global lock and it may be slow.
+// Lookup() reads an immutable snapshot of the storage which is replaced
+// atomically on every mutation, so lookups never block behind writers.
+// Insert() and the other mutating methods do process-wide global lock
+// and they may be slow.
 // All methods are thread-safe.
 //
 // TODO(taku): Currently, Registry won't guarantee that two processes
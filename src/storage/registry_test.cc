@@ -91,5 +91,27 @@ TEST(RegistryTest, TinyStorageTest) {
     EXPECT_EQ(expected, value);
   }
 }
+
+TEST(RegistryTest, MutationsAreVisibleToLookup) {
+  SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+
+  // Lookup() reads a snapshot which is republished on every mutation;
+  // make sure each kind of mutation is reflected immediately.
+  string value;
+  EXPECT_TRUE(Registry::Insert("snapshot_key", string("first")));
+  EXPECT_TRUE(Registry::Lookup("snapshot_key", &value));
+  EXPECT_EQ("first", value);
+
+  EXPECT_TRUE(Registry::Insert("snapshot_key", string("second")));
+  EXPECT_TRUE(Registry::Lookup("snapshot_key", &value));
+  EXPECT_EQ("second", value);
+
+  EXPECT_TRUE(Registry::Erase("snapshot_key"));
+  EXPECT_FALSE(Registry::Lookup("snapshot_key", &value));
+
+  EXPECT_TRUE(Registry::Insert("snapshot_key", string("third")));
+  EXPECT_TRUE(Registry::Clear());
+  EXPECT_FALSE(Registry::Lookup("snapshot_key", &value));
+}
 }  // namespace storage
 }  // namespace mozc
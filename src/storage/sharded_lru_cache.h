@@ -0,0 +1,259 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_STORAGE_SHARDED_LRU_CACHE_H_
+#define MOZC_STORAGE_SHARDED_LRU_CACHE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/port.h"
+
+namespace mozc {
+namespace storage {
+
+// A bounded cache designed for concurrent use, unlike LRUCache whose
+// Lookup() mutates the intrusive LRU list and therefore needs external
+// serialization even between readers.
+//
+// The capacity is split over several shards selected by the key hash, so
+// writers on different shards do not contend.  Within a shard, recency is
+// approximated with the CLOCK algorithm: a lookup hit only sets a
+// per-entry reference bit (a relaxed atomic store) under the shard's
+// reader lock, so concurrent lookups scale; eviction sweeps a clock hand
+// that skips and clears referenced entries.  Insert() and Erase() take
+// the shard's writer lock.
+//
+// Lookup() copies the value out instead of returning a pointer, since a
+// concurrent eviction could reuse the entry.  Use a cheap-to-copy value
+// type such as std::shared_ptr<const T> for large payloads.
+template <typename Key, typename Value, typename HashFunc = std::hash<Key> >
+class ShardedLRUCache {
+ public:
+  // Constructs a cache that holds at most |max_elements| entries in
+  // |num_shards| shards.  Each shard gets an equal part of the capacity,
+  // so a pathological key distribution can evict earlier than a true LRU
+  // of the same total size would.
+  ShardedLRUCache(size_t max_elements, size_t num_shards)
+      : shards_(num_shards) {
+    CHECK_GT(num_shards, 0);
+    const size_t shard_capacity =
+        std::max<size_t>(1, (max_elements + num_shards - 1) / num_shards);
+    for (size_t i = 0; i < num_shards; ++i) {
+      shards_[i].reset(new Shard(shard_capacity));
+    }
+  }
+
+  ~ShardedLRUCache() {}
+
+  // Adds the key/value pair, overwriting the value of an existing key.
+  // Evicts an entry of the target shard when the shard is full.
+  void Insert(const Key &key, const Value &value) {
+    ShardFor(key)->Insert(key, value);
+  }
+
+  // Copies the value for |key| into |*value| and returns true, or returns
+  // false if the key is not cached.  Marks the entry as recently used.
+  bool Lookup(const Key &key, Value *value) const {
+    return ShardFor(key)->Lookup(key, value);
+  }
+
+  // Same as Lookup() but does not affect the eviction order.
+  bool LookupWithoutInsert(const Key &key, Value *value) const {
+    return ShardFor(key)->LookupWithoutInsert(key, value);
+  }
+
+  // Removes the entry, returning true if it was cached.
+  bool Erase(const Key &key) {
+    return ShardFor(key)->Erase(key);
+  }
+
+  bool HasKey(const Key &key) const {
+    return ShardFor(key)->HasKey(key);
+  }
+
+  // Removes all entries.
+  void Clear() {
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      shards_[i]->Clear();
+    }
+  }
+
+  // Returns the number of cached entries.  The result is a snapshot and
+  // may be stale as soon as it is returned when writers are active.
+  size_t Size() const {
+    size_t size = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      size += shards_[i]->Size();
+    }
+    return size;
+  }
+
+ private:
+  class Shard {
+   public:
+    explicit Shard(size_t capacity) : slots_(capacity), hand_(0) {}
+
+    void Insert(const Key &key, const Value &value) {
+      scoped_writer_lock lock(&mutex_);
+      typename Table::iterator it = table_.find(key);
+      if (it != table_.end()) {
+        Slot &slot = slots_[it->second];
+        slot.value = value;
+        slot.referenced.store(true, std::memory_order_relaxed);
+        return;
+      }
+      const size_t index = NextVictim();
+      Slot &slot = slots_[index];
+      if (slot.used) {
+        table_.erase(slot.key);
+      }
+      slot.used = true;
+      slot.key = key;
+      slot.value = value;
+      slot.referenced.store(true, std::memory_order_relaxed);
+      table_[key] = index;
+    }
+
+    bool Lookup(const Key &key, Value *value) const {
+      scoped_reader_lock lock(&mutex_);
+      typename Table::const_iterator it = table_.find(key);
+      if (it == table_.end()) {
+        return false;
+      }
+      const Slot &slot = slots_[it->second];
+      slot.referenced.store(true, std::memory_order_relaxed);
+      *value = slot.value;
+      return true;
+    }
+
+    bool LookupWithoutInsert(const Key &key, Value *value) const {
+      scoped_reader_lock lock(&mutex_);
+      typename Table::const_iterator it = table_.find(key);
+      if (it == table_.end()) {
+        return false;
+      }
+      *value = slots_[it->second].value;
+      return true;
+    }
+
+    bool Erase(const Key &key) {
+      scoped_writer_lock lock(&mutex_);
+      typename Table::iterator it = table_.find(key);
+      if (it == table_.end()) {
+        return false;
+      }
+      Slot &slot = slots_[it->second];
+      slot.used = false;
+      slot.value = Value();
+      table_.erase(it);
+      return true;
+    }
+
+    bool HasKey(const Key &key) const {
+      scoped_reader_lock lock(&mutex_);
+      return table_.find(key) != table_.end();
+    }
+
+    void Clear() {
+      scoped_writer_lock lock(&mutex_);
+      for (size_t i = 0; i < slots_.size(); ++i) {
+        slots_[i].used = false;
+        slots_[i].referenced.store(false, std::memory_order_relaxed);
+        slots_[i].value = Value();
+      }
+      table_.clear();
+      hand_ = 0;
+    }
+
+    size_t Size() const {
+      scoped_reader_lock lock(&mutex_);
+      return table_.size();
+    }
+
+   private:
+    struct Slot {
+      Slot() : used(false), referenced(false) {}
+
+      bool used;
+      // Set by readers on a hit; mutable so that Lookup() stays const and
+      // can run under the reader lock.
+      mutable std::atomic<bool> referenced;
+      Key key;
+      Value value;
+
+     private:
+      DISALLOW_COPY_AND_ASSIGN(Slot);
+    };
+
+    // Advances the clock hand to a free or unreferenced slot, giving
+    // referenced slots a second chance.  Terminates within two sweeps
+    // because the first sweep clears every reference bit.
+    // The caller must hold the writer lock.
+    size_t NextVictim() {
+      for (;;) {
+        Slot &slot = slots_[hand_];
+        const size_t index = hand_;
+        hand_ = (hand_ + 1) % slots_.size();
+        if (!slot.used ||
+            !slot.referenced.exchange(false, std::memory_order_relaxed)) {
+          return index;
+        }
+      }
+    }
+
+    typedef std::map<Key, size_t> Table;
+
+    std::vector<Slot> slots_;
+    Table table_;
+    size_t hand_;
+    mutable ReaderWriterMutex mutex_;
+
+    DISALLOW_COPY_AND_ASSIGN(Shard);
+  };
+
+  Shard *ShardFor(const Key &key) const {
+    return shards_[HashFunc()(key) % shards_.size()].get();
+  }
+
+  std::vector<std::unique_ptr<Shard> > shards_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardedLRUCache);
+};
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_SHARDED_LRU_CACHE_H_
@@ -0,0 +1,173 @@
+// Copyright 2010-2018, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "storage/sharded_lru_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "base/port.h"
+#include "base/thread.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+TEST(ShardedLRUCacheTest, BasicOperations) {
+  ShardedLRUCache<uint64, int> cache(100, 4);
+  EXPECT_EQ(0, cache.Size());
+
+  int value = 0;
+  EXPECT_FALSE(cache.Lookup(1, &value));
+  EXPECT_FALSE(cache.HasKey(1));
+
+  cache.Insert(1, 10);
+  cache.Insert(2, 20);
+  EXPECT_EQ(2, cache.Size());
+  EXPECT_TRUE(cache.HasKey(1));
+  ASSERT_TRUE(cache.Lookup(1, &value));
+  EXPECT_EQ(10, value);
+  ASSERT_TRUE(cache.Lookup(2, &value));
+  EXPECT_EQ(20, value);
+
+  // Overwriting does not grow the cache.
+  cache.Insert(1, 11);
+  EXPECT_EQ(2, cache.Size());
+  ASSERT_TRUE(cache.Lookup(1, &value));
+  EXPECT_EQ(11, value);
+
+  EXPECT_TRUE(cache.Erase(2));
+  EXPECT_FALSE(cache.Erase(2));
+  EXPECT_FALSE(cache.Lookup(2, &value));
+  EXPECT_EQ(1, cache.Size());
+
+  cache.Clear();
+  EXPECT_EQ(0, cache.Size());
+  EXPECT_FALSE(cache.Lookup(1, &value));
+}
+
+TEST(ShardedLRUCacheTest, CapacityIsBounded) {
+  ShardedLRUCache<uint64, int> cache(16, 4);
+  for (uint64 i = 0; i < 1000; ++i) {
+    cache.Insert(i, static_cast<int>(i));
+  }
+  EXPECT_LE(cache.Size(), 16);
+  // The most recent key of some shard must still be there.
+  int value = 0;
+  ASSERT_TRUE(cache.Lookup(999, &value));
+  EXPECT_EQ(999, value);
+}
+
+TEST(ShardedLRUCacheTest, ReferencedEntryGetsSecondChance) {
+  // Single shard of capacity 4 makes the clock deterministic.
+  ShardedLRUCache<uint64, int> cache(4, 1);
+  for (uint64 i = 0; i < 4; ++i) {
+    cache.Insert(i, static_cast<int>(i));
+  }
+  // All four entries carry the reference bit from insertion, so this
+  // eviction sweeps once over the shard and replaces the oldest entry.
+  cache.Insert(4, 4);
+  EXPECT_FALSE(cache.HasKey(0));
+  // Now only key 4 is referenced.  Referencing key 1 makes the clock pass
+  // over it and evict key 2 instead.
+  int value = 0;
+  ASSERT_TRUE(cache.Lookup(1, &value));
+  cache.Insert(5, 5);
+  EXPECT_TRUE(cache.HasKey(1));
+  EXPECT_FALSE(cache.HasKey(2));
+  EXPECT_TRUE(cache.HasKey(5));
+}
+
+TEST(ShardedLRUCacheTest, SharedPtrValue) {
+  ShardedLRUCache<uint64, std::shared_ptr<const string> > cache(8, 2);
+  cache.Insert(1, std::make_shared<const string>("foo"));
+  std::shared_ptr<const string> value;
+  ASSERT_TRUE(cache.Lookup(1, &value));
+  ASSERT_TRUE(value != nullptr);
+  EXPECT_EQ("foo", *value);
+  // The copied-out reference stays valid after the entry is evicted.
+  cache.Clear();
+  EXPECT_EQ("foo", *value);
+}
+
+class CacheReaderThread : public Thread {
+ public:
+  CacheReaderThread(ShardedLRUCache<uint64, int> *cache, uint64 max_key)
+      : cache_(cache), max_key_(max_key), num_hits_(0) {}
+
+  virtual void Run() {
+    int value = 0;
+    for (int iter = 0; iter < 10000; ++iter) {
+      for (uint64 key = 0; key < max_key_; ++key) {
+        if (cache_->Lookup(key, &value)) {
+          EXPECT_EQ(static_cast<int>(key), value);
+          ++num_hits_;
+        }
+      }
+    }
+  }
+
+  int num_hits() const { return num_hits_; }
+
+ private:
+  ShardedLRUCache<uint64, int> *cache_;
+  const uint64 max_key_;
+  int num_hits_;
+
+  DISALLOW_COPY_AND_ASSIGN(CacheReaderThread);
+};
+
+TEST(ShardedLRUCacheTest, ConcurrentReadersAndWriter) {
+  const uint64 kMaxKey = 64;
+  ShardedLRUCache<uint64, int> cache(32, 4);
+
+  std::unique_ptr<CacheReaderThread> threads[4];
+  for (size_t i = 0; i < arraysize(threads); ++i) {
+    threads[i].reset(new CacheReaderThread(&cache, kMaxKey));
+    threads[i]->Start("CacheReaderThread");
+  }
+  for (int iter = 0; iter < 10000; ++iter) {
+    const uint64 key = iter % kMaxKey;
+    cache.Insert(key, static_cast<int>(key));
+    if (iter % 7 == 0) {
+      cache.Erase((iter * 13) % kMaxKey);
+    }
+  }
+  int num_hits = 0;
+  for (size_t i = 0; i < arraysize(threads); ++i) {
+    threads[i]->Join();
+    num_hits += threads[i]->num_hits();
+  }
+  EXPECT_GT(num_hits, 0);
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace mozc
@@ -34,6 +34,7 @@
       'type': 'static_library',
       'toolsets': ['target', 'host'],
       'sources': [
+        'cache_budget_manager.cc',
         'encrypted_string_storage.cc',
         'existence_filter.cc',
         'lru_storage.cc',
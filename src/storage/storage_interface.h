@@ -30,6 +30,7 @@
 #ifndef MOZC_STORAGE_STORAGE_INTERFACE_H_
 #define MOZC_STORAGE_STORAGE_INTERFACE_H_
 
+#include <map>
 #include <string>
 
 #include "base/port.h"
@@ -74,6 +75,13 @@ class StorageInterface {
   // Returns the number of keys, not a number of bytes.
   virtual size_t Size() const = 0;
 
+  // Copies all key-value pairs into |entries|.
+  // Returns false if the implementation does not support enumeration.
+  // The default implementation does not.
+  virtual bool GetAllEntries(std::map<string, string> *entries) const {
+    return false;
+  }
+
   StorageInterface() {}
   virtual ~StorageInterface() {}
 };
@@ -33,11 +33,13 @@
       'target_name': 'storage_test',
       'type': 'executable',
       'sources': [
+        'cache_budget_manager_test.cc',
         'encrypted_string_storage_test.cc',
         'existence_filter_test.cc',
         'lru_storage_test.cc',
         'memory_storage_test.cc',
         'registry_test.cc',
+        'sharded_lru_cache_test.cc',
         'tiny_storage_test.cc',
       ],
       'dependencies': [
@@ -33,10 +33,13 @@
 #include <Windows.h>
 #endif  // OS_WIN
 
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
@@ -48,7 +51,8 @@ namespace mozc {
 namespace storage {
 namespace {
 
-const uint32 kStorageVersion = 0;
+const uint32 kStorageVersion = 0;     // legacy whole-snapshot format
+const uint32 kStorageLogVersion = 1;  // append-log format
 const uint32 kStorageMagicId = 0x431fe241;  // random seed
 const size_t kMaxElementSize = 1024;        // max map size
 const size_t kMaxKeySize     = 4096;        // 4k for key/value
@@ -57,6 +61,17 @@ const size_t kMaxValueSize   = 4096;        // 4k for key/value
 // so 10Mbyte data is reasonable upper bound for file size
 const size_t kMaxFileSize     = 1024 * 1024 * 10;  // 10Mbyte
 
+// Operations recorded in the append log.
+const uint32 kLogInsert = 0;
+const uint32 kLogErase  = 1;
+const uint32 kLogClear  = 2;
+
+// Compact the log when it holds this many times more records than live
+// entries (but not before the log is reasonably long).  The log is
+// therefore never larger than kCompactionFactor * kMaxFileSize.
+const size_t kCompactionFactor = 4;
+const size_t kMinRecordsBeforeCompaction = 64;
+
 template<typename T>
 bool ReadData(char **begin, const char *end, T *value) {
   if (*begin + sizeof(*value) > end) {
@@ -98,16 +113,38 @@ class TinyStorageImpl : public StorageInterface {
   virtual size_t Size() const {
     return dic_.size();
   }
+  virtual bool GetAllEntries(std::map<string, string> *entries) const;
 
  private:
+  struct LogRecord {
+    uint32 op;
+    string key;
+    string value;
+  };
+
+  // Replays an append log.  |begin| points just after the magic word.
+  bool OpenLog(char **begin, const char *end);
+
+  // Rewrites the whole file as a compacted log of pure inserts.
+  bool Compact();
+
+  static void WriteRecord(const LogRecord &record, std::ostream *ofs);
+
   string filename_;
   bool should_sync_;
+  // True when the on-disk file is a well-formed log we can append to.
+  // False for legacy snapshot files, missing files and truncated logs;
+  // the next Sync() then rewrites the file via Compact().
+  bool log_is_valid_;
+  size_t num_log_records_;         // records in the on-disk log
+  std::vector<LogRecord> pending_;  // mutations not yet appended
   std::map<string, string> dic_;
 
   DISALLOW_COPY_AND_ASSIGN(TinyStorageImpl);
 };
 
-TinyStorageImpl::TinyStorageImpl() : should_sync_(true) {
+TinyStorageImpl::TinyStorageImpl()
+    : should_sync_(true), log_is_valid_(false), num_log_records_(0) {
   // the each entry consumes at most
   // sizeof(uint32) * 2 (key/value length) +
   // kMaxKeySize + kMaxValueSize
@@ -125,7 +162,15 @@ TinyStorageImpl::~TinyStorageImpl() {
 bool TinyStorageImpl::Open(const string &filename) {
   Mmap mmap;
   dic_.clear();
+  pending_.clear();
+  log_is_valid_ = false;
+  num_log_records_ = 0;
   filename_ = filename;
+  // Repair an interrupted Compact() before reading the file.
+  if (!FileUtil::RecoverPagedWrite(filename)) {
+    LOG(ERROR) << "cannot recover " << filename;
+    return false;
+  }
   if (!mmap.Open(filename.c_str(), "r")) {
     LOG(WARNING) << "cannot open:" << filename;
     // here we return true if we cannot open the file.
@@ -134,7 +179,7 @@ bool TinyStorageImpl::Open(const string &filename) {
     return true;
   }
 
-  if (mmap.size() > kMaxFileSize) {
+  if (mmap.size() > kCompactionFactor * kMaxFileSize) {
     LOG(ERROR) << "tring to open too big file";
     return false;
   }
@@ -145,18 +190,31 @@ bool TinyStorageImpl::Open(const string &filename) {
   uint32 version = 0;
   uint32 magic = 0;
   uint32 size = 0;
-  // magic is used for checking whether given file is correct or not.
-  // magic = (file_size ^ kStorageMagicId)
   if (!ReadData<uint32>(&begin, end, &magic)) {
     LOG(ERROR) << "cannot read magic";
     return false;
   }
 
+  // Log files start with the plain magic id.  In the legacy snapshot
+  // format the first word is (file_size ^ kStorageMagicId), which cannot
+  // collide with the plain id because the file is never empty.
+  if (magic == kStorageMagicId) {
+    return OpenLog(&begin, end);
+  }
+
+  // Legacy snapshot format:
+  // magic is used for checking whether given file is correct or not.
+  // magic = (file_size ^ kStorageMagicId)
   if ((magic ^ kStorageMagicId) != mmap.size()) {
     LOG(ERROR) << "file magic is broken";
     return false;
   }
 
+  if (mmap.size() > kMaxFileSize) {
+    LOG(ERROR) << "tring to open too big file";
+    return false;
+  }
+
   if (!ReadData<uint32>(&begin, end, &version)) {
     LOG(ERROR) << "cannot read version";
     return false;
@@ -214,71 +272,174 @@ bool TinyStorageImpl::Open(const string &filename) {
     return false;
   }
 
+  // |log_is_valid_| stays false, so the next Sync() rewrites the file
+  // in the log format.
+  return true;
+}
+
+// Format of the append log following the |magic|version| header:
+// |op(uint32)|key_size(uint32)|key|value_size(uint32)|value|   (insert)
+// |op(uint32)|key_size(uint32)|key|                            (erase)
+// |op(uint32)|                                                 (clear)
+bool TinyStorageImpl::OpenLog(char **begin, const char *end) {
+  uint32 version = 0;
+  if (!ReadData<uint32>(begin, end, &version)) {
+    LOG(ERROR) << "cannot read version";
+    return false;
+  }
+
+  if (version != kStorageLogVersion) {
+    LOG(ERROR) << "Incompatible version";
+    return false;
+  }
+
+  log_is_valid_ = true;
+  while (*begin < end) {
+    // A record that cannot be read completely is the trailing remainder
+    // of an interrupted append.  Keep everything replayed so far and let
+    // the next Sync() rewrite the file.
+    bool broken = true;
+    uint32 op = 0;
+    uint32 key_size = 0;
+    uint32 value_size = 0;
+    string key;
+    string value;
+    do {
+      if (!ReadData<uint32>(begin, end, &op)) {
+        break;
+      }
+      if (op == kLogClear) {
+        broken = false;
+        break;
+      }
+      if (op != kLogInsert && op != kLogErase) {
+        break;
+      }
+      if (!ReadData<uint32>(begin, end, &key_size) ||
+          *begin + key_size > end) {
+        break;
+      }
+      key.assign(*begin, key_size);
+      *begin += key_size;
+      if (op == kLogErase) {
+        broken = false;
+        break;
+      }
+      if (!ReadData<uint32>(begin, end, &value_size) ||
+          *begin + value_size > end) {
+        break;
+      }
+      value.assign(*begin, value_size);
+      *begin += value_size;
+      broken = false;
+    } while (false);
+
+    if (broken) {
+      LOG(WARNING) << "dropping truncated log tail: " << filename_;
+      log_is_valid_ = false;
+      should_sync_ = true;
+      return true;
+    }
+
+    switch (op) {
+      case kLogInsert:
+        if (IsInvalid(key, value, dic_.size())) {
+          return false;
+        }
+        dic_[key] = value;
+        break;
+      case kLogErase:
+        dic_.erase(key);
+        break;
+      case kLogClear:
+        dic_.clear();
+        break;
+    }
+    ++num_log_records_;
+  }
+
   return true;
 }
 
-// Format of storage:
-// |magic(uint32 file_size ^ kStorageVersion)|version(uint32)|size(uint32)|
-// |key_size(uint32)|key(variable length)|
-// |value_size(uint32)|value(variable length)| ...
+// static
+void TinyStorageImpl::WriteRecord(const LogRecord &record,
+                                  std::ostream *ofs) {
+  ofs->write(reinterpret_cast<const char *>(&record.op), sizeof(record.op));
+  if (record.op == kLogClear) {
+    return;
+  }
+  const uint32 key_size = static_cast<uint32>(record.key.size());
+  ofs->write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+  ofs->write(record.key.data(), key_size);
+  if (record.op == kLogErase) {
+    return;
+  }
+  const uint32 value_size = static_cast<uint32>(record.value.size());
+  ofs->write(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+  ofs->write(record.value.data(), value_size);
+}
+
+// Sync() appends the pending mutations to the log.  The whole file is
+// rewritten only by Compact(), so frequent small updates no longer pay
+// for the size of the entire storage.
 bool TinyStorageImpl::Sync() {
   if (!should_sync_) {
     VLOG(2) << "Already synced";
     return true;
   }
 
-  const string output_filename = filename_ + ".tmp";
+  if (!log_is_valid_ ||
+      num_log_records_ + pending_.size() >
+          std::max(kMinRecordsBeforeCompaction,
+                   kCompactionFactor * dic_.size())) {
+    return Compact();
+  }
 
-  OutputFileStream ofs(output_filename.c_str(),
-                       std::ios::binary | std::ios::out);
+  OutputFileStream ofs(filename_.c_str(),
+                       std::ios::binary | std::ios::out | std::ios::app);
   if (!ofs) {
-    LOG(ERROR) << "cannot open " << output_filename;
+    LOG(ERROR) << "cannot open " << filename_;
     return false;
   }
 
-  uint32 magic = 0;
-  uint32 size = 0;
-  ofs.write(reinterpret_cast<const char *>(&magic),
-            sizeof(magic));
-  ofs.write(reinterpret_cast<const char *>(&kStorageVersion),
-            sizeof(kStorageVersion));
-  ofs.write(reinterpret_cast<const char *>(&size),
-            sizeof(size));
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    WriteRecord(pending_[i], &ofs);
+  }
+  ofs.close();
+
+  num_log_records_ += pending_.size();
+  pending_.clear();
+  should_sync_ = false;
+
+  return true;
+}
 
+bool TinyStorageImpl::Compact() {
+  // The compacted image usually shares a long prefix with the file on
+  // the disk (std::map keeps the keys sorted), so the paged writer
+  // rewrites only the pages that actually changed.
+  std::ostringstream image;
+  image.write(reinterpret_cast<const char *>(&kStorageMagicId),
+              sizeof(kStorageMagicId));
+  image.write(reinterpret_cast<const char *>(&kStorageLogVersion),
+              sizeof(kStorageLogVersion));
+
+  size_t size = 0;
   for (std::map<string, string>::const_iterator it = dic_.begin();
        it != dic_.end(); ++it) {
     if (it->first.empty()) {
       continue;
     }
-    const string &key = it->first;
-    const string &value = it->second;
-    const uint32 key_size = static_cast<uint32>(key.size());
-    const uint32 value_size = static_cast<uint32>(value.size());
-    ofs.write(reinterpret_cast<const char *>(&key_size),
-              sizeof(key_size));
-    ofs.write(key.data(), key_size);
-    ofs.write(reinterpret_cast<const char *>(&value_size),
-              sizeof(value_size));
-    ofs.write(value.data(), value_size);
+    LogRecord record;
+    record.op = kLogInsert;
+    record.key = it->first;
+    record.value = it->second;
+    WriteRecord(record, &image);
     ++size;
   }
 
-  magic = static_cast<uint32>(ofs.tellp());
-  ofs.seekp(0);
-  magic ^= kStorageMagicId;
-
-  ofs.write(reinterpret_cast<const char *>(&magic),
-            sizeof(magic));
-  ofs.write(reinterpret_cast<const char *>(&kStorageVersion),
-            sizeof(kStorageVersion));
-  ofs.write(reinterpret_cast<const char *>(&size),
-            sizeof(size));
-
-  // should call close(). Othrwise AtomicRename will be failed.
-  ofs.close();
-
-  if (!FileUtil::AtomicRename(output_filename, filename_)) {
-    LOG(ERROR) << "AtomicRename failed";
+  if (!FileUtil::WritePaged(filename_, image.str())) {
+    LOG(ERROR) << "WritePaged failed: " << filename_;
     return false;
   }
 
@@ -289,6 +450,9 @@ bool TinyStorageImpl::Sync() {
   }
 #endif
 
+  num_log_records_ = size;
+  pending_.clear();
+  log_is_valid_ = true;
   should_sync_ = false;
 
   return true;
@@ -300,6 +464,11 @@ bool TinyStorageImpl::Insert(const string &key, const string &value) {
     return false;
   }
   dic_[key] = value;
+  LogRecord record;
+  record.op = kLogInsert;
+  record.key = key;
+  record.value = value;
+  pending_.push_back(record);
   should_sync_ = true;
   return true;
 }
@@ -311,6 +480,10 @@ bool TinyStorageImpl::Erase(const string &key) {
     return false;
   }
   dic_.erase(it);
+  LogRecord record;
+  record.op = kLogErase;
+  record.key = key;
+  pending_.push_back(record);
   should_sync_ = true;
   return true;
 }
@@ -327,8 +500,15 @@ bool TinyStorageImpl::Lookup(const string &key, string *value) const {
 
 bool TinyStorageImpl::Clear() {
   dic_.clear();
+  pending_.clear();
   should_sync_ = true;
-  return Sync();
+  return Compact();
+}
+
+bool TinyStorageImpl::GetAllEntries(std::map<string, string> *entries) const {
+  DCHECK(entries);
+  *entries = dic_;
+  return true;
 }
 
 }  // namespace
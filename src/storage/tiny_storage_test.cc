@@ -36,6 +36,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/port.h"
 #include "storage/storage_interface.h"
@@ -172,5 +173,152 @@ TEST_F(TinyStorageTest, TinyStorageTest) {
   }
 }
 
+TEST_F(TinyStorageTest, AppendLogReopenTest) {
+  const string filename = GetTemporaryFilePath();
+
+  {
+    std::unique_ptr<StorageInterface> storage(CreateStorage());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_TRUE(storage->Insert("key1", "value1"));
+    EXPECT_TRUE(storage->Insert("key2", "value2"));
+    EXPECT_TRUE(storage->Sync());
+    // Appends after the first sync only add log records.
+    EXPECT_TRUE(storage->Insert("key3", "value3"));
+    EXPECT_TRUE(storage->Erase("key1"));
+    EXPECT_TRUE(storage->Sync());
+  }
+
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_EQ(2, storage->Size());
+  string value;
+  EXPECT_FALSE(storage->Lookup("key1", &value));
+  EXPECT_TRUE(storage->Lookup("key2", &value));
+  EXPECT_EQ("value2", value);
+  EXPECT_TRUE(storage->Lookup("key3", &value));
+  EXPECT_EQ("value3", value);
+}
+
+TEST_F(TinyStorageTest, TruncatedLogTailTest) {
+  const string filename = GetTemporaryFilePath();
+
+  {
+    std::unique_ptr<StorageInterface> storage(CreateStorage());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_TRUE(storage->Insert("key1", "value1"));
+    EXPECT_TRUE(storage->Sync());
+  }
+
+  // Simulate an interrupted append: only a fragment of the next record
+  // made it to the disk.
+  {
+    OutputFileStream ofs(filename.c_str(),
+                         std::ios::binary | std::ios::out | std::ios::app);
+    const uint32 op = 0;  // insert
+    const uint32 key_size = 100;
+    ofs.write(reinterpret_cast<const char *>(&op), sizeof(op));
+    ofs.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+  }
+
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(filename));
+  EXPECT_EQ(1, storage->Size());
+  string value;
+  EXPECT_TRUE(storage->Lookup("key1", &value));
+  EXPECT_EQ("value1", value);
+
+  // Syncing after the recovery rewrites the file into a clean log.
+  EXPECT_TRUE(storage->Insert("key2", "value2"));
+  EXPECT_TRUE(storage->Sync());
+  std::unique_ptr<StorageInterface> storage2(CreateStorage());
+  EXPECT_TRUE(storage2->Open(filename));
+  EXPECT_EQ(2, storage2->Size());
+}
+
+TEST_F(TinyStorageTest, LegacySnapshotFormatTest) {
+  const string filename = GetTemporaryFilePath();
+
+  // Write a storage file in the legacy whole-snapshot format:
+  // |file_size ^ magic_id|version(0)|size|key_size|key|value_size|value|
+  {
+    const uint32 kLegacyMagicId = 0x431fe241;
+    const string key = "legacy_key";
+    const string value = "legacy_value";
+    const uint32 key_size = static_cast<uint32>(key.size());
+    const uint32 value_size = static_cast<uint32>(value.size());
+    const uint32 file_size =
+        4 * sizeof(uint32) + key_size + value_size + sizeof(uint32);
+    const uint32 magic = file_size ^ kLegacyMagicId;
+    const uint32 version = 0;
+    const uint32 size = 1;
+    OutputFileStream ofs(filename.c_str(), std::ios::binary | std::ios::out);
+    ofs.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+    ofs.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    ofs.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    ofs.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+    ofs.write(key.data(), key_size);
+    ofs.write(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+    ofs.write(value.data(), value_size);
+  }
+
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(filename));
+  string value;
+  EXPECT_TRUE(storage->Lookup("legacy_key", &value));
+  EXPECT_EQ("legacy_value", value);
+
+  // The first sync migrates the file to the log format.
+  EXPECT_TRUE(storage->Insert("key1", "value1"));
+  EXPECT_TRUE(storage->Sync());
+
+  std::unique_ptr<StorageInterface> storage2(CreateStorage());
+  EXPECT_TRUE(storage2->Open(filename));
+  EXPECT_EQ(2, storage2->Size());
+  EXPECT_TRUE(storage2->Lookup("legacy_key", &value));
+  EXPECT_EQ("legacy_value", value);
+}
+
+TEST_F(TinyStorageTest, CompactionBoundsLogTest) {
+  const string filename = GetTemporaryFilePath();
+
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(filename));
+  // Rewrite the same key many times with a sync per update.  Compaction
+  // must keep the log from growing with the number of updates.
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(storage->Insert("key", "value"));
+    EXPECT_TRUE(storage->Sync());
+  }
+
+  EXPECT_EQ(1, storage->Size());
+  size_t file_size = 0;
+  {
+    InputFileStream ifs(filename.c_str(),
+                        std::ios::binary | std::ios::in | std::ios::ate);
+    file_size = static_cast<size_t>(ifs.tellg());
+  }
+  // Header + at most ~65 single-entry records.
+  EXPECT_LT(file_size, 2000);
+
+  std::unique_ptr<StorageInterface> storage2(CreateStorage());
+  EXPECT_TRUE(storage2->Open(filename));
+  string value;
+  EXPECT_TRUE(storage2->Lookup("key", &value));
+  EXPECT_EQ("value", value);
+}
+
+TEST_F(TinyStorageTest, GetAllEntriesTest) {
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(GetTemporaryFilePath()));
+  EXPECT_TRUE(storage->Insert("key1", "value1"));
+  EXPECT_TRUE(storage->Insert("key2", "value2"));
+
+  std::map<string, string> entries;
+  EXPECT_TRUE(storage->GetAllEntries(&entries));
+  EXPECT_EQ(2, entries.size());
+  EXPECT_EQ("value1", entries["key1"]);
+  EXPECT_EQ("value2", entries["key2"]);
+}
+
 }  // namespace storage
 }  // namespace mozc
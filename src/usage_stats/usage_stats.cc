@@ -30,9 +30,13 @@
 #include "usage_stats/usage_stats.h"
 
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
 #include <numeric>
 
 #include "base/logging.h"
+#include "base/singleton.h"
 #include "config/stats_config_util.h"
 #include "storage/registry.h"
 #include "usage_stats/usage_stats.pb.h"
@@ -105,6 +109,147 @@ bool SetterInternal(const string &name, const Stats &stats) {
   }
   return true;
 }
+
+// In-memory accumulation of COUNT and TIMING stats.  IncrementCountBy()
+// and UpdateTiming() record events here with relaxed atomic operations
+// and Flush() merges the accumulated values into the registry, so the
+// per-event cost no longer includes a registry transaction (global mutex
+// plus a protobuf round trip).  This makes per-keystroke instrumentation
+// affordable.
+//
+// An event racing with Flush() may have its fields split across two
+// flush windows (e.g. its time counted in one window and its sample
+// count in the next); counts and totals are conserved across flushes,
+// only the per-window breakdown is approximate, which is fine for
+// aggregate statistics.
+class StatsCache {
+ public:
+  StatsCache() : slots_(new Slot[arraysize(kStatsList)]) {
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      index_[kStatsList[i]] = i;
+    }
+  }
+
+  // Returns false iff |name| is not a listed stat.
+  bool IncrementBy(const string &name, uint32 val) {
+    Slot *slot = FindSlot(name);
+    if (slot == NULL) {
+      return false;
+    }
+    slot->count.fetch_add(val, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool AddTiming(const string &name, uint32 val) {
+    Slot *slot = FindSlot(name);
+    if (slot == NULL) {
+      return false;
+    }
+    slot->total.fetch_add(val, std::memory_order_relaxed);
+    slot->num.fetch_add(1, std::memory_order_relaxed);
+    UpdateMin(&slot->min, val);
+    UpdateMax(&slot->max, val);
+    return true;
+  }
+
+  // Merges every pending value into the registry and resets the slots.
+  void Flush() {
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      Slot *slot = &slots_[i];
+      const uint32 count = slot->count.exchange(0, std::memory_order_relaxed);
+      if (count > 0) {
+        const string name(kStatsList[i]);
+        Stats stats;
+        if (GetterInternal(name, Stats::COUNT, &stats)) {
+          stats.set_count(stats.count() + count);
+        } else {
+          stats.set_name(name);
+          stats.set_type(Stats::COUNT);
+          stats.set_count(count);
+        }
+        SetterInternal(name, stats);
+      }
+      const uint32 num = slot->num.exchange(0, std::memory_order_relaxed);
+      if (num > 0) {
+        const uint64 total =
+            slot->total.exchange(0, std::memory_order_relaxed);
+        const uint32 min =
+            slot->min.exchange(kuint32max, std::memory_order_relaxed);
+        const uint32 max = slot->max.exchange(0, std::memory_order_relaxed);
+        const string name(kStatsList[i]);
+        Stats stats;
+        if (GetterInternal(name, Stats::TIMING, &stats)) {
+          stats.set_num_timings(stats.num_timings() + num);
+          stats.set_total_time(stats.total_time() + total);
+          stats.set_min_time(std::min(stats.min_time(), min));
+          stats.set_max_time(std::max(stats.max_time(), max));
+        } else {
+          stats.set_name(name);
+          stats.set_type(Stats::TIMING);
+          stats.set_num_timings(num);
+          stats.set_total_time(total);
+          stats.set_min_time(min);
+          stats.set_max_time(max);
+        }
+        stats.set_avg_time(stats.total_time() / stats.num_timings());
+        SetterInternal(name, stats);
+      }
+    }
+  }
+
+  // Drops every pending value without writing it out.
+  void Clear() {
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      Slot *slot = &slots_[i];
+      slot->count.store(0, std::memory_order_relaxed);
+      slot->num.store(0, std::memory_order_relaxed);
+      slot->total.store(0, std::memory_order_relaxed);
+      slot->min.store(kuint32max, std::memory_order_relaxed);
+      slot->max.store(0, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  struct Slot {
+    Slot() : count(0), total(0), num(0), min(kuint32max), max(0) {}
+    std::atomic<uint32> count;
+    std::atomic<uint64> total;
+    std::atomic<uint32> num;
+    std::atomic<uint32> min;
+    std::atomic<uint32> max;
+  };
+
+  Slot *FindSlot(const string &name) {
+    const std::map<string, size_t>::const_iterator it = index_.find(name);
+    return it == index_.end() ? NULL : &slots_[it->second];
+  }
+
+  static void UpdateMin(std::atomic<uint32> *target, uint32 val) {
+    uint32 current = target->load(std::memory_order_relaxed);
+    while (val < current &&
+           !target->compare_exchange_weak(current, val,
+                                          std::memory_order_relaxed)) {
+    }
+  }
+
+  static void UpdateMax(std::atomic<uint32> *target, uint32 val) {
+    uint32 current = target->load(std::memory_order_relaxed);
+    while (val > current &&
+           !target->compare_exchange_weak(current, val,
+                                          std::memory_order_relaxed)) {
+    }
+  }
+
+  std::map<string, size_t> index_;
+  std::unique_ptr<Slot[]> slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(StatsCache);
+};
+
+// Pre-construct the cache at warmup instead of on the first recorded
+// stat, which builds the index over kStatsList.
+const SingletonWarmupRegistrar<StatsCache> g_warmup_registrar;
+
 }  // namespace
 
 bool UsageStats::IsListed(const string &name) {
@@ -117,6 +262,9 @@ bool UsageStats::IsListed(const string &name) {
 }
 
 void UsageStats::ClearStats() {
+  // Note: the in-memory cache is intentionally left untouched.  Pending
+  // values there have not been uploaded yet and will be merged into the
+  // (now empty) registry at the next Flush().
   string stats_str;
   Stats stats;
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
@@ -139,18 +287,30 @@ void UsageStats::ClearStats() {
 }
 
 void UsageStats::ClearAllStatsForTest() {
+  Singleton<StatsCache>::get()->Clear();
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
     const string key = string(kRegistryPrefix) + kStatsList[i];
     storage::Registry::Erase(key);
   }
 }
 
+void UsageStats::Flush() {
+  Singleton<StatsCache>::get()->Flush();
+}
+
 void UsageStats::IncrementCountBy(const string &name, uint32 val) {
   DCHECK(IsListed(name)) << name << " is not in the list";
   if (!config::StatsConfigUtil::IsEnabled()) {
     return;
   }
 
+  // Record the event in memory only; Flush() merges it into the
+  // registry later.  Unlisted names (possible in release builds) keep
+  // the old direct write.
+  if (Singleton<StatsCache>::get()->IncrementBy(name, val)) {
+    return;
+  }
+
   Stats stats;
   if (GetterInternal(name, Stats::COUNT, &stats)) {
     stats.set_count(stats.count() + val);
@@ -169,6 +329,10 @@ void UsageStats::UpdateTiming(const string &name, uint32 val) {
     return;
   }
 
+  if (Singleton<StatsCache>::get()->AddTiming(name, val)) {
+    return;
+  }
+
   Stats stats;
   if (GetterInternal(name, Stats::TIMING, &stats)) {
     stats.set_num_timings(stats.num_timings() + 1);
@@ -219,6 +383,7 @@ void UsageStats::SetBoolean(const string &name, bool val) {
 
 bool UsageStats::GetCountForTest(const string &name, uint32 *value) {
   CHECK(value != NULL);
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::COUNT, &stats)) {
     return false;
@@ -268,6 +433,7 @@ bool UsageStats::GetTimingForTest(const string &name,
                                   uint32 *avg_time,
                                   uint32 *min_time,
                                   uint32 *max_time) {
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::TIMING, &stats)) {
     return false;
@@ -316,6 +482,7 @@ bool UsageStats::GetVirtualKeyboardForTest(const string &name, Stats *stats) {
 }
 
 bool UsageStats::GetStatsForTest(const string &name, Stats *stats) {
+  Flush();
   return LoadStats(name, stats);
 }
 
@@ -368,6 +535,7 @@ void UsageStats::StoreTouchEventStats(
 }
 
 bool UsageStats::Sync() {
+  Flush();
   if (!storage::Registry::Sync()) {
     LOG(ERROR) << "sync failed";
     return false;
@@ -77,7 +77,14 @@ class UsageStats {
       const string &name,
       const std::map<string, TouchEventStatsMap> &touch_stats);
 
+  // Writes the count and timing values accumulated in memory by
+  // IncrementCount()/UpdateTiming() through to the registry.  Called
+  // automatically from Sync() and from the getters below; cheap when
+  // nothing is pending.
+  static void Flush();
+
   // Synchronizes (writes) usage data into disk. Returns false on failure.
+  // Implies Flush().
   static bool Sync();
 
   // Clears existing data exept for Integer and Boolean stats.
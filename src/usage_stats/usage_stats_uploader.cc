@@ -248,6 +248,8 @@ void UsageStatsUploader::SetClientIdHandler(
 
 void UsageStatsUploader::LoadStats(UploadUtil *uploader) {
   DCHECK(uploader);
+  // Make sure in-memory counts and timings are visible in the registry.
+  UsageStats::Flush();
   string stats_str;
   Stats stats;
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {